@@ -314,6 +314,15 @@ const char *tizyoutube::get_prev_url (const bool a_remove_current_url)
   return current_url_.empty () ? NULL : current_url_.c_str ();
 }
 
+int tizyoutube::prefetch_url (const int a_offset)
+{
+  int rc = 0;
+  bool resolved = false;
+  try_catch_wrapper (resolved = bp::extract< bool > (
+                         py_yt_proxy_.attr ("prefetch_stream_url") (a_offset)));
+  return (rc || !resolved) ? 1 : 0;
+}
+
 void tizyoutube::clear_queue ()
 {
   int rc = 0;
@@ -271,6 +271,22 @@ const char *tiz_youtube_get_next_url (tiz_youtube_t *ap_youtube,
 const char *tiz_youtube_get_prev_url (tiz_youtube_t *ap_youtube,
                                       const bool a_remove_current_url);
 
+/**
+ * Resolve ahead of time the url of a stream further down the playback queue,
+ * so that a later call to tiz_youtube_get_next_url does not have to wait for
+ * it. The playback queue pointer does not move.
+ *
+ * @ingroup libtizyoutube
+ *
+ * @param ap_youtube The tiz_youtube handle.
+ * @param a_offset The position of the stream, relative to the current one (1
+ * is the next stream).
+ *
+ * @return 0 on success, 1 if there is no stream at that position or its url
+ * could not be resolved.
+ */
+int tiz_youtube_prefetch_url (tiz_youtube_t *ap_youtube, const int a_offset);
+
 /**
  * Retrieve the current audio stream's title.
  *
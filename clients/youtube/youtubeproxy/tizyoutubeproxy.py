@@ -746,6 +746,32 @@ class tizyoutubeproxy(object):
             logging.info("IOError exception")
             return self.next_url()
 
+    def prefetch_stream_url(self, offset):
+        """ Resolve ahead of time the url of the stream that is 'offset'
+        positions after the current one, so that next_url does not have to
+        wait for it.
+
+        :param offset: a position relative to the current stream (1 is the
+        next stream)
+
+        :return: True if there was a stream to resolve at that position
+
+        """
+        total_streams = len(self.queue)
+        if offset <= 0 or offset >= total_streams:
+            return False
+        index = (self.queue_index + offset) % total_streams
+        if index < 0:
+            index += total_streams
+        try:
+            # This is the item that __retrieve_stream_url will look up
+            stream = self.queue[index]
+            self.__resolve_stream(stream)
+            return True
+        except (KeyError, AttributeError, IOError):
+            logging.info("Could not prefetch the stream url")
+            return False
+
     def __update_play_queue_order(self):
         """ Update the queue playback order.
 
@@ -780,16 +806,7 @@ class tizyoutubeproxy(object):
                 self.queue[stream['q']] = stream
 
             stream = self.queue[queue_index]
-            if not stream.get('v') or not stream.get('a'):
-                logging.info("ytid : %s", stream['i'].ytid)
-                video = stream.get('v')
-                if not video:
-                    video = pafy.new(stream['i'].ytid)
-                audio = video.getbestaudio(preftype="webm")
-                if not audio:
-                    logging.info("no suitable audio found")
-                    raise AttributeError()
-                stream.update({'a': audio, 'v': video})
+            self.__resolve_stream(stream)
 
             # streams = stream.get('v').audiostreams[::-1]
             # pprint.pprint(streams)
@@ -802,6 +819,22 @@ class tizyoutubeproxy(object):
             logging.info("Could not retrieve the stream url!")
             raise
 
+    def __resolve_stream(self, stream):
+        """ Obtain the audio stream object of a queue item, unless it has
+        already been obtained.
+
+        """
+        if not stream.get('v') or not stream.get('a'):
+            logging.info("ytid : %s", stream['i'].ytid)
+            video = stream.get('v')
+            if not video:
+                video = pafy.new(stream['i'].ytid)
+            audio = video.getbestaudio(preftype="webm")
+            if not audio:
+                logging.info("no suitable audio found")
+                raise AttributeError()
+            stream.update({'a': audio, 'v': video})
+
     def add_to_playback_queue(self, audio=None, video=None, info=None):
         """ Add to the playback queue. """
 
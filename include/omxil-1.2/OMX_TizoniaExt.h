@@ -77,6 +77,8 @@
 #define OMX_TizoniaIndexParamChromecastSession       OMX_IndexVendorStartUnused + 21 /**< reference: OMX_TIZONIA_PARAM_CHROMECASTSESSIONTYPE */
 #define OMX_TizoniaIndexParamAudioPlexSession        OMX_IndexVendorStartUnused + 22 /**< reference: OMX_TIZONIA_AUDIO_PARAM_PLEXSESSIONTYPE */
 #define OMX_TizoniaIndexParamAudioPlexPlaylist       OMX_IndexVendorStartUnused + 23 /**< reference: OMX_TIZONIA_AUDIO_PARAM_PLEXPLAYLISTTYPE */
+#define OMX_TizoniaIndexConfigAudioReplayGain        OMX_IndexVendorStartUnused + 24 /**< reference: OMX_TIZONIA_AUDIO_CONFIG_REPLAYGAINTYPE */
+#define OMX_TizoniaIndexConfigHttpSourceBuffering    OMX_IndexVendorStartUnused + 25 /**< reference: OMX_TIZONIA_CONFIG_HTTPSOURCEBUFFERINGTYPE */
 
 /**
  * OMX_AUDIO_CODINGTYPE extensions
@@ -559,4 +561,61 @@ typedef struct OMX_TIZONIA_AUDIO_PARAM_PLEXPLAYLISTTYPE {
     OMX_U8 cPlaylistName[OMX_MAX_STRINGNAME_SIZE];
 } OMX_TIZONIA_AUDIO_PARAM_PLEXPLAYLISTTYPE;
 
+/**
+ * Loudness normalization (ReplayGain / EBU R128) on pcm renderers
+ * References:
+ * - https://wiki.hydrogenaud.io/index.php?title=ReplayGain_2.0_specification
+ * - https://tech.ebu.ch/docs/r/r128.pdf
+ *
+ * Gains are expressed in millibels (mB, i.e. 1/100 dB) and peaks as linear
+ * sample amplitudes in Q16 format (i.e. 65536 means full scale).
+ */
+typedef enum OMX_TIZONIA_AUDIO_REPLAYGAINMODETYPE {
+    OMX_AUDIO_ReplayGainModeOff = 0, /**< No loudness normalization (Default). */
+    OMX_AUDIO_ReplayGainModeTrack,   /**< Apply the track gain. */
+    OMX_AUDIO_ReplayGainModeAlbum,   /**< Apply the album gain, or the track
+                                        gain if the album gain is unknown. */
+    OMX_AUDIO_ReplayGainModeKhronosExtensions = 0x6F000000, /**< Reserved region for introducing Khronos Standard Extensions */
+    OMX_AUDIO_ReplayGainModeVendorStartUnused = 0x7F000000, /**< Reserved region for introducing Vendor Extensions */
+    OMX_AUDIO_ReplayGainModeMax = 0x7FFFFFFF
+} OMX_TIZONIA_AUDIO_REPLAYGAINMODETYPE;
+
+typedef struct OMX_TIZONIA_AUDIO_CONFIG_REPLAYGAINTYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_TIZONIA_AUDIO_REPLAYGAINMODETYPE eMode;
+    OMX_BOOL bTrackGainValid;
+    OMX_S32 nTrackGain;  /**< Track gain, in mB */
+    OMX_U32 nTrackPeak;  /**< Track peak, Q16. 0 if unknown */
+    OMX_BOOL bAlbumGainValid;
+    OMX_S32 nAlbumGain;  /**< Album gain, in mB */
+    OMX_U32 nAlbumPeak;  /**< Album peak, Q16. 0 if unknown */
+    OMX_S32 nPreamp;     /**< Additional gain applied on top of the selected
+                            gain, in mB. Default 0 */
+    OMX_BOOL bPreventClipping; /**< Limit the gain so that the known peak does
+                                  not exceed full scale. Default OMX_TRUE */
+} OMX_TIZONIA_AUDIO_CONFIG_REPLAYGAINTYPE;
+
+/**
+ * Status of the jitter buffer of the http source (read-only)
+ *
+ * The amount of data kept ahead of playback adapts to the stream: it grows
+ * after the buffer runs dry and shrinks back slowly while data arrives
+ * steadily. Durations are estimated from the stream's nominal bit rate.
+ */
+typedef struct OMX_TIZONIA_CONFIG_HTTPSOURCEBUFFERINGTYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_U32 nFillBytes;   /**< Data currently buffered, in bytes */
+    OMX_U32 nFillMs;      /**< Data currently buffered, in ms */
+    OMX_U32 nTargetBytes; /**< Current buffering target, in bytes */
+    OMX_U32 nTargetMs;    /**< Current buffering target, in ms */
+    OMX_U32 nJitterMs;    /**< Longest recent gap between data arrivals, in
+                             ms */
+    OMX_U32 nUnderruns;   /**< Number of times the buffer has run dry since
+                             the stream started */
+} OMX_TIZONIA_CONFIG_HTTPSOURCEBUFFERINGTYPE;
+
 #endif /* OMX_TizoniaExt_h */
@@ -111,6 +111,57 @@ opusport_GetParameter (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
   return OMX_ErrorNone;
 }
 
+static OMX_ERRORTYPE
+opusport_SetParameter_common (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                              OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  tiz_opusport_t * p_obj = (tiz_opusport_t *) ap_obj;
+  const OMX_TIZONIA_AUDIO_PARAM_OPUSTYPE * p_opustype
+    = (OMX_TIZONIA_AUDIO_PARAM_OPUSTYPE *) ap_struct;
+
+  assert (p_obj);
+  assert (p_opustype);
+
+  switch (p_opustype->nSampleRate)
+    {
+      case 8000:
+      case 12000:
+      case 16000:
+      case 24000:
+      case 22050:
+      case 32000:
+      case 44100:
+      case 48000:
+        {
+          break;
+        }
+      default:
+        {
+          TIZ_ERROR (ap_hdl,
+                     "[%s] : OMX_ErrorBadParameter : "
+                     "Sample rate not supported [%d]. "
+                     "Returning...",
+                     tiz_idx_to_str (a_index), p_opustype->nSampleRate);
+          return OMX_ErrorBadParameter;
+        }
+    };
+
+  /* Apply the new default values */
+  p_obj->opustype_.nChannels = p_opustype->nChannels;
+  p_obj->opustype_.nBitRate = p_opustype->nBitRate;
+  p_obj->opustype_.nSampleRate = p_opustype->nSampleRate;
+  p_obj->opustype_.nFrameDuration = p_opustype->nFrameDuration;
+  p_obj->opustype_.nEncoderComplexity = p_opustype->nEncoderComplexity;
+  p_obj->opustype_.bPacketLossResilience = p_opustype->bPacketLossResilience;
+  p_obj->opustype_.bForwardErrorCorrection
+    = p_opustype->bForwardErrorCorrection;
+  p_obj->opustype_.bDtx = p_opustype->bDtx;
+  p_obj->opustype_.eChannelMode = p_opustype->eChannelMode;
+  p_obj->opustype_.eFormat = p_opustype->eFormat;
+
+  return OMX_ErrorNone;
+}
+
 static OMX_ERRORTYPE
 opusport_SetParameter (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
                        OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
@@ -122,29 +173,6 @@ opusport_SetParameter (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
       const OMX_TIZONIA_AUDIO_PARAM_OPUSTYPE * p_opustype
         = (OMX_TIZONIA_AUDIO_PARAM_OPUSTYPE *) ap_struct;
 
-      switch (p_opustype->nSampleRate)
-        {
-          case 8000:
-          case 16000:
-          case 24000:
-          case 22050:
-          case 32000:
-          case 44100:
-          case 48000:
-            {
-              break;
-            }
-          default:
-            {
-              TIZ_ERROR (ap_hdl,
-                         "[%s] : OMX_ErrorBadParameter : "
-                         "Sample rate not supported [%d]. "
-                         "Returning...",
-                         tiz_idx_to_str (a_index), p_opustype->nSampleRate);
-              return OMX_ErrorBadParameter;
-            }
-        };
-
       /* Do now allow changes to sampling rate or num of channels if this is
        * a slave output port */
       {
@@ -166,28 +194,30 @@ opusport_SetParameter (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
           }
       }
 
-      /* Apply the new default values */
-      p_obj->opustype_.nChannels = p_opustype->nChannels;
-      p_obj->opustype_.nBitRate = p_opustype->nBitRate;
-      p_obj->opustype_.nSampleRate = p_opustype->nSampleRate;
-      p_obj->opustype_.nFrameDuration = p_opustype->nFrameDuration;
-      p_obj->opustype_.nEncoderComplexity = p_opustype->nEncoderComplexity;
-      p_obj->opustype_.bPacketLossResilience
-        = p_opustype->bPacketLossResilience;
-      p_obj->opustype_.bForwardErrorCorrection
-        = p_opustype->bForwardErrorCorrection;
-      p_obj->opustype_.bDtx = p_opustype->bDtx;
-      p_obj->opustype_.eChannelMode = p_opustype->eChannelMode;
-      p_obj->opustype_.eFormat = p_opustype->eFormat;
+      return opusport_SetParameter_common (ap_obj, ap_hdl, a_index, ap_struct);
     }
-  else
+
+  /* Try the parent's indexes */
+  return super_SetParameter (typeOf (ap_obj, "tizopusport"), ap_obj, ap_hdl,
+                             a_index, ap_struct);
+}
+
+static OMX_ERRORTYPE
+opusport_SetParameter_internal (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                                OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  TIZ_TRACE (ap_hdl, "PORT [%d] SetParameter [%s]...", tiz_port_index (ap_obj),
+             tiz_idx_to_str (a_index));
+
+  /* The component itself may update the stream parameters of a slave port */
+  if (OMX_TizoniaIndexParamAudioOpus == a_index)
     {
-      /* Try the parent's indexes */
-      return super_SetParameter (typeOf (ap_obj, "tizopusport"), ap_obj, ap_hdl,
-                                 a_index, ap_struct);
+      return opusport_SetParameter_common (ap_obj, ap_hdl, a_index, ap_struct);
     }
 
-  return OMX_ErrorNone;
+  /* Try the parent's indexes */
+  return super_SetParameter (typeOf (ap_obj, "tizopusport"), ap_obj, ap_hdl,
+                             a_index, ap_struct);
 }
 
 static bool
@@ -435,6 +465,8 @@ tiz_opusport_init (void * ap_tos, void * ap_hdl)
      /* TIZ_CLASS_COMMENT: */
      tiz_api_SetParameter, opusport_SetParameter,
      /* TIZ_CLASS_COMMENT: */
+     tiz_port_SetParameter_internal, opusport_SetParameter_internal,
+     /* TIZ_CLASS_COMMENT: */
      tiz_port_check_tunnel_compat, opusport_check_tunnel_compat,
      /* TIZ_CLASS_COMMENT: */
      tiz_port_apply_slaving_behaviour, opusport_apply_slaving_behaviour,
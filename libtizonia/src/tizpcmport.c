@@ -92,6 +92,7 @@ pcmport_SetParameter_common (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
             {
               case 8:
               case 16:
+              case 24:
               case 32:
                 {
                   break;
@@ -156,6 +157,8 @@ pcmport_ctor (void * ap_obj, va_list * app)
     tiz_port_register_index (p_obj, OMX_IndexConfigAudioVolume));
   tiz_check_omx_ret_null (
     tiz_port_register_index (p_obj, OMX_IndexConfigAudioMute));
+  tiz_check_omx_ret_null (
+    tiz_port_register_index (p_obj, OMX_TizoniaIndexConfigAudioReplayGain));
 
   /* Initialize the OMX_AUDIO_PARAM_PCMMODETYPE structure */
   if ((p_pcmmode = va_arg (*app, OMX_AUDIO_PARAM_PCMMODETYPE *)))
@@ -188,6 +191,13 @@ pcmport_ctor (void * ap_obj, va_list * app)
       p_obj->mute_ = *p_mute;
     }
 
+  /* Loudness normalization is disabled by default */
+  TIZ_INIT_OMX_PORT_STRUCT (p_obj->replaygain_, p_base->portdef_.nPortIndex);
+  p_obj->replaygain_.eMode = OMX_AUDIO_ReplayGainModeOff;
+  p_obj->replaygain_.bTrackGainValid = OMX_FALSE;
+  p_obj->replaygain_.bAlbumGainValid = OMX_FALSE;
+  p_obj->replaygain_.bPreventClipping = OMX_TRUE;
+
   /* TODO: Extract this from the va_list */
   p_base->portdef_.eDomain = OMX_PortDomainAudio;
   /* NOTE: MIME type is gone in 1.2 */
@@ -325,6 +335,14 @@ pcmport_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
 
       default:
         {
+          if (OMX_TizoniaIndexConfigAudioReplayGain == a_index)
+            {
+              OMX_TIZONIA_AUDIO_CONFIG_REPLAYGAINTYPE * p_replaygain
+                = (OMX_TIZONIA_AUDIO_CONFIG_REPLAYGAINTYPE *) ap_struct;
+
+              *p_replaygain = p_obj->replaygain_;
+              break;
+            }
           /* Try the parent's indexes */
           return super_GetConfig (typeOf (ap_obj, "tizpcmport"), ap_obj, ap_hdl,
                                   a_index, ap_struct);
@@ -382,9 +400,33 @@ pcmport_SetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
 
       default:
         {
-          /* Try the parent's indexes */
-          rc = super_SetConfig (typeOf (ap_obj, "tizpcmport"), ap_obj, ap_hdl,
-                                a_index, ap_struct);
+          if (OMX_TizoniaIndexConfigAudioReplayGain == a_index)
+            {
+              const OMX_TIZONIA_AUDIO_CONFIG_REPLAYGAINTYPE * p_replaygain
+                = (OMX_TIZONIA_AUDIO_CONFIG_REPLAYGAINTYPE *) ap_struct;
+
+              if (p_replaygain->eMode > OMX_AUDIO_ReplayGainModeAlbum)
+                {
+                  TIZ_ERROR (ap_hdl,
+                             "[OMX_ErrorBadParameter] : PORT [%d] "
+                             "SetConfig [%s]... Invalid mode [%d]",
+                             tiz_port_dir (p_obj), tiz_idx_to_str (a_index),
+                             p_replaygain->eMode);
+                  rc = OMX_ErrorBadParameter;
+                }
+              else
+                {
+                  const OMX_U32 pid = p_obj->replaygain_.nPortIndex;
+                  p_obj->replaygain_ = *p_replaygain;
+                  p_obj->replaygain_.nPortIndex = pid;
+                }
+            }
+          else
+            {
+              /* Try the parent's indexes */
+              rc = super_SetConfig (typeOf (ap_obj, "tizpcmport"), ap_obj,
+                                    ap_hdl, a_index, ap_struct);
+            }
         }
         break;
     };
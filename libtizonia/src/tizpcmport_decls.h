@@ -43,6 +43,7 @@ struct tiz_pcmport
   OMX_AUDIO_PARAM_PCMMODETYPE pcmmode_;
   OMX_AUDIO_CONFIG_VOLUMETYPE volume_;
   OMX_AUDIO_CONFIG_MUTETYPE mute_;
+  OMX_TIZONIA_AUDIO_CONFIG_REPLAYGAINTYPE replaygain_;
 };
 
 typedef struct tiz_pcmport_class tiz_pcmport_class_t;
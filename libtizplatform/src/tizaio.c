@@ -0,0 +1,334 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizaio.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Asynchronous file I/O
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "tizplatform.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.platform.aio"
+#endif
+
+#define AIO_MAX_THREADS 8
+
+struct tiz_aio
+{
+  tiz_aio_notify_f pf_notify;
+  void * p_arg;
+  int nthreads;
+  tiz_thread_t threads[AIO_MAX_THREADS];
+  /* The members below are protected by the mutex */
+  tiz_mutex_t mutex;
+  tiz_cond_t cond; /* signalled on new requests, and when one is done */
+  tiz_vector_t * p_pending;
+  tiz_vector_t * p_done;
+  int running;
+  bool notified;
+  bool stop;
+};
+
+static void
+perform (tiz_aio_req_t * ap_req)
+{
+  char * p_data = NULL;
+  size_t done = 0;
+
+  assert (ap_req);
+  p_data = ap_req->p_data;
+  ap_req->error = 0;
+
+  if (ETIZAioOpDataSync == ap_req->op)
+    {
+      while (0 != fdatasync (ap_req->fd))
+        {
+          if (EINTR != errno)
+            {
+              ap_req->error = errno;
+              break;
+            }
+        }
+      ap_req->result = (0 == ap_req->error) ? 0 : -1;
+      return;
+    }
+
+  while (done < ap_req->nbytes)
+    {
+      ssize_t n = ETIZAioOpRead == ap_req->op
+                    ? pread (ap_req->fd, p_data + done, ap_req->nbytes - done,
+                             ap_req->offset + (off_t) done)
+                    : pwrite (ap_req->fd, p_data + done, ap_req->nbytes - done,
+                              ap_req->offset + (off_t) done);
+      if (n < 0)
+        {
+          if (EINTR == errno)
+            {
+              continue;
+            }
+          ap_req->error = errno;
+          break;
+        }
+      if (0 == n)
+        {
+          /* End of file */
+          break;
+        }
+      done += (size_t) n;
+    }
+
+  ap_req->result = (0 == ap_req->error) ? (ssize_t) done : -1;
+}
+
+/* Must be called with the mutex held */
+static bool
+complete (tiz_aio_t * ap_aio, tiz_aio_req_t * ap_req)
+{
+  bool notify = false;
+  assert (ap_aio);
+  assert (ap_req);
+  if (OMX_ErrorNone != tiz_vector_push_back (ap_aio->p_done, ap_req))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to store a completion");
+    }
+  if (!ap_aio->notified)
+    {
+      ap_aio->notified = true;
+      notify = true;
+    }
+  return notify;
+}
+
+static void *
+aio_thread_func (void * p_arg)
+{
+  tiz_aio_t * p_aio = p_arg;
+  assert (p_aio);
+
+  (void) tiz_mutex_lock (&(p_aio->mutex));
+  while (!p_aio->stop)
+    {
+      if (tiz_vector_length (p_aio->p_pending) > 0)
+        {
+          tiz_aio_req_t req = *(tiz_aio_req_t *) tiz_vector_front (
+            p_aio->p_pending);
+          bool notify = false;
+          tiz_vector_erase (p_aio->p_pending, 0, 1);
+          p_aio->running++;
+          (void) tiz_mutex_unlock (&(p_aio->mutex));
+
+          perform (&req);
+
+          (void) tiz_mutex_lock (&(p_aio->mutex));
+          p_aio->running--;
+          notify = complete (p_aio, &req);
+          (void) tiz_cond_broadcast (&(p_aio->cond));
+          if (notify && p_aio->pf_notify)
+            {
+              /* Don't hold the lock while calling out */
+              (void) tiz_mutex_unlock (&(p_aio->mutex));
+              p_aio->pf_notify (p_aio->p_arg);
+              (void) tiz_mutex_lock (&(p_aio->mutex));
+            }
+        }
+      else
+        {
+          (void) tiz_cond_wait (&(p_aio->cond), &(p_aio->mutex));
+        }
+    }
+  (void) tiz_mutex_unlock (&(p_aio->mutex));
+  return NULL;
+}
+
+OMX_ERRORTYPE
+tiz_aio_init (tiz_aio_ptr_t * app_aio, const int a_nthreads,
+              tiz_aio_notify_f apf_notify, void * ap_arg)
+{
+  tiz_aio_t * p_aio = NULL;
+  int i = 0;
+
+  assert (app_aio);
+  assert (apf_notify);
+
+  tiz_check_null_ret_oom ((p_aio = tiz_mem_calloc (1, sizeof (tiz_aio_t))));
+
+  p_aio->pf_notify = apf_notify;
+  p_aio->p_arg = ap_arg;
+
+  if (OMX_ErrorNone != tiz_mutex_init (&(p_aio->mutex))
+      || OMX_ErrorNone != tiz_cond_init (&(p_aio->cond))
+      || OMX_ErrorNone
+           != tiz_vector_init (&(p_aio->p_pending), sizeof (tiz_aio_req_t))
+      || OMX_ErrorNone
+           != tiz_vector_init (&(p_aio->p_done), sizeof (tiz_aio_req_t)))
+    {
+      tiz_aio_destroy (p_aio);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  for (i = 0; i < MAX (1, MIN (a_nthreads, AIO_MAX_THREADS)); ++i)
+    {
+      if (OMX_ErrorNone
+          != tiz_thread_create (&(p_aio->threads[i]), 0, 0, aio_thread_func,
+                                p_aio))
+        {
+          tiz_aio_destroy (p_aio);
+          return OMX_ErrorInsufficientResources;
+        }
+      (void) tiz_thread_setname (&(p_aio->threads[i]),
+                                 (const OMX_STRING) "tizaio");
+      p_aio->nthreads++;
+    }
+
+  *app_aio = p_aio;
+  return OMX_ErrorNone;
+}
+
+void
+tiz_aio_destroy (tiz_aio_t * ap_aio)
+{
+  if (ap_aio)
+    {
+      int i = 0;
+      if (ap_aio->nthreads > 0)
+        {
+          (void) tiz_mutex_lock (&(ap_aio->mutex));
+          ap_aio->stop = true;
+          (void) tiz_cond_broadcast (&(ap_aio->cond));
+          (void) tiz_mutex_unlock (&(ap_aio->mutex));
+        }
+      for (i = 0; i < ap_aio->nthreads; ++i)
+        {
+          void * p_result = NULL;
+          (void) tiz_thread_join (&(ap_aio->threads[i]), &p_result);
+        }
+      tiz_vector_destroy (ap_aio->p_done);
+      tiz_vector_destroy (ap_aio->p_pending);
+      if (ap_aio->cond)
+        {
+          (void) tiz_cond_destroy (&(ap_aio->cond));
+        }
+      if (ap_aio->mutex)
+        {
+          (void) tiz_mutex_destroy (&(ap_aio->mutex));
+        }
+      tiz_mem_free (ap_aio);
+    }
+}
+
+OMX_ERRORTYPE
+tiz_aio_submit (tiz_aio_t * ap_aio, const tiz_aio_req_t * ap_reqs,
+                const size_t a_nreqs)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  size_t i = 0;
+
+  assert (ap_aio);
+  assert (ap_reqs || 0 == a_nreqs);
+
+  (void) tiz_mutex_lock (&(ap_aio->mutex));
+  for (i = 0; i < a_nreqs && OMX_ErrorNone == rc; ++i)
+    {
+      rc = tiz_vector_push_back (ap_aio->p_pending, (OMX_PTR) & (ap_reqs[i]));
+    }
+  /* One wake-up for the whole batch */
+  (void) tiz_cond_broadcast (&(ap_aio->cond));
+  (void) tiz_mutex_unlock (&(ap_aio->mutex));
+
+  return rc;
+}
+
+size_t
+tiz_aio_reap (tiz_aio_t * ap_aio, tiz_aio_req_t * ap_reqs, const size_t a_max)
+{
+  size_t count = 0;
+
+  assert (ap_aio);
+  assert (ap_reqs || 0 == a_max);
+
+  (void) tiz_mutex_lock (&(ap_aio->mutex));
+  count = MIN (a_max, (size_t) tiz_vector_length (ap_aio->p_done));
+  if (count > 0)
+    {
+      size_t i = 0;
+      for (i = 0; i < count; ++i)
+        {
+          ap_reqs[i] = *(tiz_aio_req_t *) tiz_vector_at (ap_aio->p_done,
+                                                         (OMX_S32) i);
+        }
+      tiz_vector_erase (ap_aio->p_done, 0, (OMX_S32) count);
+    }
+  if (0 == tiz_vector_length (ap_aio->p_done))
+    {
+      ap_aio->notified = false;
+    }
+  (void) tiz_mutex_unlock (&(ap_aio->mutex));
+
+  return count;
+}
+
+void
+tiz_aio_drain (tiz_aio_t * ap_aio)
+{
+  assert (ap_aio);
+
+  (void) tiz_mutex_lock (&(ap_aio->mutex));
+  while (tiz_vector_length (ap_aio->p_pending) > 0 || ap_aio->running > 0)
+    {
+      (void) tiz_cond_wait (&(ap_aio->cond), &(ap_aio->mutex));
+    }
+  (void) tiz_mutex_unlock (&(ap_aio->mutex));
+}
+
+void
+tiz_aio_cancel (tiz_aio_t * ap_aio)
+{
+  assert (ap_aio);
+
+  (void) tiz_mutex_lock (&(ap_aio->mutex));
+  while (tiz_vector_length (ap_aio->p_pending) > 0)
+    {
+      tiz_aio_req_t * p_req = tiz_vector_front (ap_aio->p_pending);
+      p_req->result = -1;
+      p_req->error = ECANCELED;
+      /* No need to notify; the caller reaps these straight away */
+      (void) complete (ap_aio, p_req);
+      tiz_vector_erase (ap_aio->p_pending, 0, 1);
+    }
+  while (ap_aio->running > 0)
+    {
+      (void) tiz_cond_wait (&(ap_aio->cond), &(ap_aio->mutex));
+    }
+  (void) tiz_mutex_unlock (&(ap_aio->mutex));
+}
@@ -0,0 +1,171 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizaio.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Asynchronous file I/O
+ *
+ *
+ */
+
+#ifndef TIZAIO_H
+#define TIZAIO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup tizaio Asynchronous file I/O
+ *
+ * Positional reads and writes performed by a small pool of worker threads,
+ * so that a slow file system does not block the caller's thread. Requests
+ * are submitted in batches; the owner is told through a notification
+ * callback when there are completions to collect, and collects them on its
+ * own thread.
+ *
+ * @ingroup libtizplatform
+ */
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+/**
+ * Asynchronous I/O engine opaque handle.
+ * @ingroup tizaio
+ */
+typedef struct tiz_aio tiz_aio_t;
+typedef /*@null@ */ tiz_aio_t * tiz_aio_ptr_t;
+
+/**
+ * The kind of operation of a request.
+ * @ingroup tizaio
+ */
+typedef enum tiz_aio_op {
+  ETIZAioOpRead,
+  ETIZAioOpWrite,
+  ETIZAioOpDataSync /**< fdatasync; p_data, nbytes and offset are unused */
+} tiz_aio_op_t;
+
+/**
+ * An I/O request. Reads stop short only at the end of the file; writes
+ * only complete once all the data has been written, or on error. With a
+ * single worker thread, requests complete in the order they were submitted,
+ * so a sync covers all the writes queued before it.
+ * @ingroup tizaio
+ */
+typedef struct tiz_aio_req tiz_aio_req_t;
+struct tiz_aio_req
+{
+  tiz_aio_op_t op;
+  int fd;
+  void * p_data;
+  size_t nbytes;
+  off_t offset;
+  void * p_cookie; /**< Opaque to the engine */
+  ssize_t result;  /**< On completion, the bytes transferred, or -1 */
+  int error;       /**< On completion, errno (ECANCELED if cancelled) */
+};
+
+/**
+ * Called from a worker thread when there are completions to be reaped. It is
+ * not called again until tiz_aio_reap has collected all of them.
+ * @ingroup tizaio
+ */
+typedef void (*tiz_aio_notify_f) (void * ap_arg);
+
+/**
+ * Create an I/O engine.
+ *
+ * @ingroup tizaio
+ *
+ * @param app_aio A reference to the engine that will be created.
+ *
+ * @param a_nthreads The number of worker threads.
+ *
+ * @param apf_notify The notification callback.
+ *
+ * @param ap_arg The argument of the notification callback.
+ *
+ * @return OMX_ErrorNone if success, OMX_ErrorInsufficientResources otherwise.
+ */
+OMX_ERRORTYPE
+tiz_aio_init (tiz_aio_ptr_t * app_aio, const int a_nthreads,
+              tiz_aio_notify_f apf_notify, void * ap_arg);
+
+/**
+ * Cancel the pending requests, wait for the ones in progress and destroy the
+ * engine.
+ *
+ * @ingroup tizaio
+ */
+void
+tiz_aio_destroy (tiz_aio_t * ap_aio);
+
+/**
+ * Queue a batch of requests.
+ *
+ * @ingroup tizaio
+ *
+ * @return OMX_ErrorNone if success, OMX_ErrorInsufficientResources otherwise.
+ */
+OMX_ERRORTYPE
+tiz_aio_submit (tiz_aio_t * ap_aio, const tiz_aio_req_t * ap_reqs,
+                const size_t a_nreqs);
+
+/**
+ * Collect completed requests, in order of completion.
+ *
+ * @ingroup tizaio
+ *
+ * @return The number of requests copied into ap_reqs.
+ */
+size_t
+tiz_aio_reap (tiz_aio_t * ap_aio, tiz_aio_req_t * ap_reqs,
+              const size_t a_max);
+
+/**
+ * Wait until all the requests submitted so far have completed. They can then
+ * be reaped without waiting for a notification.
+ *
+ * @ingroup tizaio
+ */
+void
+tiz_aio_drain (tiz_aio_t * ap_aio);
+
+/**
+ * Complete the requests that haven't started yet with ECANCELED and wait
+ * until those in progress have finished. All of them can then be reaped
+ * without waiting for a notification.
+ *
+ * @ingroup tizaio
+ */
+void
+tiz_aio_cancel (tiz_aio_t * ap_aio);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZAIO_H */
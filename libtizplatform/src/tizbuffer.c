@@ -282,6 +282,25 @@ tiz_buffer_seek (tiz_buffer_t * ap_buf, const long offset, const int whence)
   return rc;
 }
 
+int
+tiz_buffer_discard (tiz_buffer_t * ap_buf, const int a_nbytes)
+{
+  int nbytes = 0;
+  assert (ap_buf);
+  assert (ap_buf->alloc_len >= (ap_buf->offset + ap_buf->filled_len));
+  if (a_nbytes > 0)
+    {
+      nbytes = MIN (a_nbytes, ap_buf->offset);
+      if (nbytes > 0)
+        {
+          memmove (ap_buf->p_store, ap_buf->p_store + nbytes,
+                   (ap_buf->offset - nbytes) + ap_buf->filled_len);
+          ap_buf->offset -= nbytes;
+        }
+    }
+  return nbytes;
+}
+
 void
 tiz_buffer_clear (tiz_buffer_t * ap_buf)
 {
@@ -190,6 +190,23 @@ int
 tiz_buffer_seek (tiz_buffer_t * ap_buf, const long a_offset,
                  const int a_whence);
 
+/**
+ * @brief Drop data that sits behind the position marker.
+ *
+ * This is meant for buffers in TIZ_BUFFER_SEEKABLE mode, where data already
+ * read is otherwise kept until the buffer is cleared. The oldest data goes
+ * first; the data ahead of the position marker is never dropped. After this
+ * operation, tiz_buffer_offset returns a value smaller by the number of bytes
+ * discarded.
+ *
+ * @ingroup tizbuffer
+ * @param ap_buf The dynamic buffer handle.
+ * @param a_nbytes The maximum number of bytes to drop.
+ * @return The number of bytes actually dropped.
+ */
+int
+tiz_buffer_discard (tiz_buffer_t * ap_buf, const int a_nbytes);
+
 #ifdef __cplusplus
 }
 #endif
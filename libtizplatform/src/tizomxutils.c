@@ -36,6 +36,7 @@
 #include "tizplatform.h"
 
 #include <assert.h>
+#include <math.h>
 #include <string.h>
 
 typedef struct tiz_cmd_str tiz_cmd_str_t;
@@ -659,6 +660,10 @@ static const tiz_idx_str_t tiz_idx_to_str_tbl[] = {
    (const OMX_STRING) "OMX_TizoniaIndexParamAudioPlexSession"},
   {OMX_TizoniaIndexParamAudioPlexPlaylist,
    (const OMX_STRING) "OMX_TizoniaIndexParamAudioPlexPlaylist"},
+  {OMX_TizoniaIndexConfigAudioReplayGain,
+   (const OMX_STRING) "OMX_TizoniaIndexConfigAudioReplayGain"},
+  {OMX_TizoniaIndexConfigHttpSourceBuffering,
+   (const OMX_STRING) "OMX_TizoniaIndexConfigHttpSourceBuffering"},
   {OMX_IndexKhronosExtensions, (const OMX_STRING) "OMX_IndexKhronosExtensions"},
   {OMX_IndexVendorStartUnused, (const OMX_STRING) "OMX_IndexVendorStartUnused"},
   {OMX_IndexMax, (const OMX_STRING) "OMX_IndexMax"}};
@@ -862,3 +867,54 @@ tiz_util_set_eos_flag (OMX_BUFFERHEADERTYPE * p_hdr)
   assert (p_hdr);
   p_hdr->nFlags |= OMX_BUFFERFLAG_EOS;
 }
+
+float
+tiz_util_replaygain_to_db (
+  const OMX_TIZONIA_AUDIO_CONFIG_REPLAYGAINTYPE * ap_rg, const float a_min_db,
+  const float a_max_db)
+{
+  float gain = 0.f;
+  OMX_U32 peak = 0;
+
+  assert (ap_rg);
+
+  if (OMX_AUDIO_ReplayGainModeAlbum == ap_rg->eMode && ap_rg->bAlbumGainValid)
+    {
+      gain = ap_rg->nAlbumGain / 100.f;
+      peak = ap_rg->nAlbumPeak;
+    }
+  else if (OMX_AUDIO_ReplayGainModeOff != ap_rg->eMode
+           && ap_rg->bTrackGainValid)
+    {
+      gain = ap_rg->nTrackGain / 100.f;
+      peak = ap_rg->nTrackPeak;
+    }
+  else
+    {
+      /* Normalization disabled, or no loudness info for this track */
+      return 0.f;
+    }
+
+  gain += ap_rg->nPreamp / 100.f;
+
+  if (ap_rg->bPreventClipping && peak > 0)
+    {
+      /* Largest gain that keeps the known peak at or below full scale */
+      const float max_gain = -20.f * log10f (peak / 65536.f);
+      if (gain > max_gain)
+        {
+          gain = max_gain;
+        }
+    }
+
+  if (gain > a_max_db)
+    {
+      gain = a_max_db;
+    }
+  else if (gain < a_min_db)
+    {
+      gain = a_min_db;
+    }
+
+  return gain;
+}
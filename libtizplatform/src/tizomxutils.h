@@ -37,6 +37,7 @@ extern "C" {
 #include <OMX_Component.h>
 #include <OMX_Audio.h>
 #include <OMX_Core.h>
+#include <OMX_TizoniaExt.h>
 
 #include "tizmem.h"
 
@@ -82,6 +83,14 @@ tiz_util_reset_eos_flag (OMX_BUFFERHEADERTYPE * p_hdr);
 void
 tiz_util_set_eos_flag (OMX_BUFFERHEADERTYPE * p_hdr);
 
+/* The gain, in dB, that a renderer must apply for a ReplayGain config: 0 dB
+   when normalization is off or there is no loudness info, and otherwise
+   limited to [a_min_db, a_max_db] */
+float
+tiz_util_replaygain_to_db (
+  const OMX_TIZONIA_AUDIO_CONFIG_REPLAYGAINTYPE * ap_rg, const float a_min_db,
+  const float a_max_db);
+
 #ifdef __cplusplus
 }
 #endif
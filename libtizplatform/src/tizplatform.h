@@ -56,6 +56,9 @@
 #include "tizprintf.h"
 #include "tizshufflelst.h"
 #include "tizurltransfer.h"
+#include "tizaio.h"
+#include "tizshmring.h"
+#include "tizshared.h"
 
 /** @} */
 
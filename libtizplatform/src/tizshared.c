@@ -0,0 +1,138 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizshared.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Process-wide shared objects
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tizplatform.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.platform.shared"
+#endif
+
+typedef struct shared_obj shared_obj_t;
+struct shared_obj
+{
+  char * p_name;
+  void * p_obj;
+  tiz_shared_destroy_f pf_destroy;
+  int refs;
+  shared_obj_t * p_next;
+};
+
+/* Components may be created on any thread, at any time */
+static pthread_mutex_t g_shared_mutex = PTHREAD_MUTEX_INITIALIZER;
+static shared_obj_t * gp_shared_list = NULL;
+
+/* To be called with the mutex locked */
+static shared_obj_t **
+find_obj (const char * ap_name)
+{
+  shared_obj_t ** pp_obj = &gp_shared_list;
+  assert (ap_name);
+  while (*pp_obj && 0 != strcmp ((*pp_obj)->p_name, ap_name))
+    {
+      pp_obj = &((*pp_obj)->p_next);
+    }
+  return pp_obj;
+}
+
+void *
+tiz_shared_acquire (const char * ap_name, tiz_shared_create_f apf_create,
+                    tiz_shared_destroy_f apf_destroy)
+{
+  shared_obj_t * p_obj = NULL;
+  void * p_result = NULL;
+
+  assert (ap_name);
+  assert (apf_create);
+  assert (apf_destroy);
+
+  (void) pthread_mutex_lock (&g_shared_mutex);
+  if ((p_obj = *find_obj (ap_name)))
+    {
+      p_obj->refs++;
+      p_result = p_obj->p_obj;
+    }
+  else if ((p_obj = tiz_mem_calloc (1, sizeof (shared_obj_t))))
+    {
+      if ((p_obj->p_name = strdup (ap_name))
+          && (p_obj->p_obj = apf_create ()))
+        {
+          p_obj->pf_destroy = apf_destroy;
+          p_obj->refs = 1;
+          p_obj->p_next = gp_shared_list;
+          gp_shared_list = p_obj;
+          p_result = p_obj->p_obj;
+        }
+      else
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to create [%s]", ap_name);
+          free (p_obj->p_name);
+          tiz_mem_free (p_obj);
+        }
+    }
+  (void) pthread_mutex_unlock (&g_shared_mutex);
+  return p_result;
+}
+
+void
+tiz_shared_release (const char * ap_name)
+{
+  shared_obj_t ** pp_obj = NULL;
+  shared_obj_t * p_obj = NULL;
+
+  assert (ap_name);
+
+  (void) pthread_mutex_lock (&g_shared_mutex);
+  pp_obj = find_obj (ap_name);
+  if ((p_obj = *pp_obj) && --(p_obj->refs) == 0)
+    {
+      *pp_obj = p_obj->p_next;
+    }
+  else
+    {
+      p_obj = NULL;
+    }
+  (void) pthread_mutex_unlock (&g_shared_mutex);
+
+  /* Outside the lock; destroying may take a while */
+  if (p_obj)
+    {
+      (void) p_obj->pf_destroy (p_obj->p_obj);
+      free (p_obj->p_name);
+      tiz_mem_free (p_obj);
+    }
+}
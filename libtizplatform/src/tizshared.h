@@ -0,0 +1,95 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizshared.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Process-wide shared objects
+ *
+ *
+ */
+
+#ifndef TIZSHARED_H
+#define TIZSHARED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup tizshared Process-wide shared objects
+ *
+ * Reference-counted objects looked up by name, so that components loaded
+ * from different plugins can share e.g. a library context. The object is
+ * created by the first user and destroyed when the last one releases it.
+ *
+ * @ingroup libtizplatform
+ */
+
+/**
+ * Creates the shared object.
+ * @ingroup tizshared
+ */
+typedef void * (*tiz_shared_create_f) (void);
+
+/**
+ * Destroys the shared object. The return value is ignored.
+ *
+ * @note The object may outlive the component that created it, so this is
+ * best a library function (e.g. zmq_ctx_term) rather than one in a plugin
+ * that could have been unloaded by then.
+ *
+ * @ingroup tizshared
+ */
+typedef int (*tiz_shared_destroy_f) (void * ap_obj);
+
+/**
+ * Get a reference to a shared object, creating it if needed.
+ *
+ * @ingroup tizshared
+ *
+ * @param ap_name The object's name.
+ *
+ * @param apf_create Called to create the object, if it doesn't exist.
+ *
+ * @param apf_destroy Called to destroy the object, once it is no longer
+ * referenced.
+ *
+ * @return The object, or NULL if it could not be created.
+ */
+void *
+tiz_shared_acquire (const char * ap_name, tiz_shared_create_f apf_create,
+                    tiz_shared_destroy_f apf_destroy);
+
+/**
+ * Drop a reference obtained with tiz_shared_acquire.
+ *
+ * @ingroup tizshared
+ *
+ * @param ap_name The object's name.
+ */
+void
+tiz_shared_release (const char * ap_name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZSHARED_H */
@@ -0,0 +1,543 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizshmring.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Shared memory byte ring
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include "tizplatform.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.platform.shmring"
+#endif
+
+#define SHM_RING_MAGIC 0x544d5352 /* "TMSR" */
+#define SHM_RING_VERSION 1
+#define SHM_RING_NFDS 3
+#define SHM_RING_SEALS (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)
+
+/* The control block at the start of the memfd. Each side's index lives in
+   its own cache line, next to the flag that only the other side clears */
+typedef struct shm_ring_ctl shm_ring_ctl_t;
+struct shm_ring_ctl
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t capacity;
+  char pad0[48];
+  /* Written by the producer */
+  uint64_t head;
+  uint32_t closed;
+  uint32_t writer_waiting;
+  char pad1[48];
+  /* Written by the consumer */
+  uint64_t tail;
+  uint32_t reader_waiting;
+  char pad2[52];
+};
+
+/* What travels along with the descriptors */
+typedef struct shm_ring_hello shm_ring_hello_t;
+struct shm_ring_hello
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t capacity;
+};
+
+struct tiz_shm_ring
+{
+  int mem_fd;
+  int data_fd;
+  int space_fd;
+  void * p_map;
+  size_t map_size;
+  shm_ring_ctl_t * p_ctl;
+  unsigned char * p_data;
+  /* Never read back from the shared control block, which the peer can
+     scribble over */
+  size_t capacity;
+  uint64_t head; /* producer's own copy */
+  uint64_t tail; /* consumer's own copy */
+};
+
+static size_t
+ctl_size (void)
+{
+  const long page = sysconf (_SC_PAGESIZE);
+  return page > (long) sizeof (shm_ring_ctl_t) ? (size_t) page
+                                               : sizeof (shm_ring_ctl_t);
+}
+
+static size_t
+round_up_pow2 (size_t a_value)
+{
+  size_t pow2 = 1;
+  while (pow2 < a_value)
+    {
+      pow2 <<= 1;
+    }
+  return pow2;
+}
+
+static void
+close_fd (int * ap_fd)
+{
+  assert (ap_fd);
+  if (*ap_fd >= 0)
+    {
+      (void) close (*ap_fd);
+      *ap_fd = -1;
+    }
+}
+
+/* Consume a pending notification, if any; the descriptors are
+   non-blocking */
+static void
+drain_fd (const int a_fd)
+{
+  eventfd_t value = 0;
+  (void) eventfd_read (a_fd, &value);
+}
+
+static void
+signal_fd (const int a_fd)
+{
+  (void) eventfd_write (a_fd, 1);
+}
+
+static OMX_ERRORTYPE
+map_ring (tiz_shm_ring_t * ap_ring)
+{
+  assert (ap_ring);
+  ap_ring->map_size = ctl_size () + ap_ring->capacity;
+  ap_ring->p_map = mmap (NULL, ap_ring->map_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, ap_ring->mem_fd, 0);
+  if (MAP_FAILED == ap_ring->p_map)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "mmap failed (%s)", strerror (errno));
+      ap_ring->p_map = NULL;
+      return OMX_ErrorInsufficientResources;
+    }
+  ap_ring->p_ctl = ap_ring->p_map;
+  ap_ring->p_data = (unsigned char *) ap_ring->p_map + ctl_size ();
+  return OMX_ErrorNone;
+}
+
+static tiz_shm_ring_t *
+alloc_ring (void)
+{
+  tiz_shm_ring_t * p_ring = tiz_mem_calloc (1, sizeof (tiz_shm_ring_t));
+  if (p_ring)
+    {
+      p_ring->mem_fd = -1;
+      p_ring->data_fd = -1;
+      p_ring->space_fd = -1;
+    }
+  return p_ring;
+}
+
+/* The bytes the producer has written and the consumer hasn't read yet, or
+   more than the capacity if the shared indices make no sense */
+static uint64_t
+used_bytes (const tiz_shm_ring_t * ap_ring, const uint64_t a_head,
+            const uint64_t a_tail)
+{
+  const uint64_t used = a_head - a_tail;
+  if (used > ap_ring->capacity)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR,
+               "Corrupted ring indices : head [%llu] tail [%llu]",
+               (unsigned long long) a_head, (unsigned long long) a_tail);
+    }
+  return used;
+}
+
+static size_t
+free_space (tiz_shm_ring_t * ap_ring)
+{
+  const uint64_t tail
+    = __atomic_load_n (&(ap_ring->p_ctl->tail), __ATOMIC_ACQUIRE);
+  const uint64_t used = used_bytes (ap_ring, ap_ring->head, tail);
+  return used > ap_ring->capacity ? 0 : ap_ring->capacity - (size_t) used;
+}
+
+static size_t
+available_data (tiz_shm_ring_t * ap_ring)
+{
+  const uint64_t head
+    = __atomic_load_n (&(ap_ring->p_ctl->head), __ATOMIC_ACQUIRE);
+  const uint64_t used = used_bytes (ap_ring, head, ap_ring->tail);
+  return used > ap_ring->capacity ? 0 : (size_t) used;
+}
+
+OMX_ERRORTYPE
+tiz_shm_ring_create (tiz_shm_ring_ptr_t * app_ring, const char * ap_name,
+                     const size_t a_capacity)
+{
+  tiz_shm_ring_t * p_ring = NULL;
+
+  assert (app_ring);
+  assert (a_capacity > 0);
+
+  tiz_check_null_ret_oom ((p_ring = alloc_ring ()));
+  p_ring->capacity = round_up_pow2 (MAX (a_capacity, ctl_size ()));
+
+  p_ring->mem_fd
+    = memfd_create (ap_name ? ap_name : "tizshmring",
+                    MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  p_ring->data_fd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+  p_ring->space_fd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (p_ring->mem_fd < 0 || p_ring->data_fd < 0 || p_ring->space_fd < 0
+      || 0 != ftruncate (p_ring->mem_fd,
+                         (off_t) (ctl_size () + p_ring->capacity))
+      || 0 != fcntl (p_ring->mem_fd, F_ADD_SEALS, SHM_RING_SEALS)
+      || OMX_ErrorNone != map_ring (p_ring))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to create the ring (%s)",
+               strerror (errno));
+      tiz_shm_ring_destroy (p_ring);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  /* ftruncate has zeroed everything else */
+  p_ring->p_ctl->magic = SHM_RING_MAGIC;
+  p_ring->p_ctl->version = SHM_RING_VERSION;
+  p_ring->p_ctl->capacity = p_ring->capacity;
+
+  *app_ring = p_ring;
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE
+tiz_shm_ring_send (const tiz_shm_ring_t * ap_ring, const int a_sock)
+{
+  shm_ring_hello_t hello;
+  struct msghdr msg;
+  struct iovec iov;
+  union
+  {
+    char buf[CMSG_SPACE (SHM_RING_NFDS * sizeof (int))];
+    struct cmsghdr align;
+  } ctrl;
+  struct cmsghdr * p_cmsg = NULL;
+  int fds[SHM_RING_NFDS];
+  ssize_t sent = 0;
+
+  assert (ap_ring);
+  assert (a_sock >= 0);
+
+  hello.magic = SHM_RING_MAGIC;
+  hello.version = SHM_RING_VERSION;
+  hello.capacity = ap_ring->capacity;
+  fds[0] = ap_ring->mem_fd;
+  fds[1] = ap_ring->data_fd;
+  fds[2] = ap_ring->space_fd;
+
+  memset (&msg, 0, sizeof (msg));
+  memset (&ctrl, 0, sizeof (ctrl));
+  iov.iov_base = &hello;
+  iov.iov_len = sizeof (hello);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl.buf;
+  msg.msg_controllen = sizeof (ctrl.buf);
+  p_cmsg = CMSG_FIRSTHDR (&msg);
+  p_cmsg->cmsg_level = SOL_SOCKET;
+  p_cmsg->cmsg_type = SCM_RIGHTS;
+  p_cmsg->cmsg_len = CMSG_LEN (sizeof (fds));
+  memcpy (CMSG_DATA (p_cmsg), fds, sizeof (fds));
+
+  do
+    {
+      sent = sendmsg (a_sock, &msg, MSG_NOSIGNAL);
+    }
+  while (sent < 0 && EINTR == errno);
+
+  if (sent != (ssize_t) sizeof (hello))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to send the ring (%s)",
+               sent < 0 ? strerror (errno) : "short write");
+      return OMX_ErrorUndefined;
+    }
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE
+tiz_shm_ring_receive (tiz_shm_ring_ptr_t * app_ring, const int a_sock)
+{
+  tiz_shm_ring_t * p_ring = NULL;
+  shm_ring_hello_t hello;
+  struct msghdr msg;
+  struct iovec iov;
+  union
+  {
+    char buf[CMSG_SPACE (SHM_RING_NFDS * sizeof (int))];
+    struct cmsghdr align;
+  } ctrl;
+  struct cmsghdr * p_cmsg = NULL;
+  struct stat st;
+  ssize_t received = 0;
+  int seals = 0;
+
+  assert (app_ring);
+  assert (a_sock >= 0);
+
+  tiz_check_null_ret_oom ((p_ring = alloc_ring ()));
+
+  memset (&msg, 0, sizeof (msg));
+  memset (&ctrl, 0, sizeof (ctrl));
+  iov.iov_base = &hello;
+  iov.iov_len = sizeof (hello);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl.buf;
+  msg.msg_controllen = sizeof (ctrl.buf);
+
+  do
+    {
+      received = recvmsg (a_sock, &msg, MSG_CMSG_CLOEXEC);
+    }
+  while (received < 0 && EINTR == errno);
+
+  /* Keep the descriptors only if they are exactly the expected ones; any
+     others that came along must be closed, or they would leak */
+  for (p_cmsg = received > 0 ? CMSG_FIRSTHDR (&msg) : NULL; p_cmsg;
+       p_cmsg = CMSG_NXTHDR (&msg, p_cmsg))
+    {
+      if (SOL_SOCKET == p_cmsg->cmsg_level && SCM_RIGHTS == p_cmsg->cmsg_type)
+        {
+          int fds[SHM_RING_NFDS];
+          const size_t nfds
+            = (p_cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+          if (SHM_RING_NFDS == nfds && p_ring->mem_fd < 0)
+            {
+              memcpy (fds, CMSG_DATA (p_cmsg), sizeof (fds));
+              p_ring->mem_fd = fds[0];
+              p_ring->data_fd = fds[1];
+              p_ring->space_fd = fds[2];
+            }
+          else
+            {
+              size_t i = 0;
+              for (i = 0; i < nfds; ++i)
+                {
+                  int fd = -1;
+                  memcpy (&fd, CMSG_DATA (p_cmsg) + i * sizeof (int),
+                          sizeof (int));
+                  close_fd (&fd);
+                }
+            }
+        }
+    }
+
+  /* Only trust a sealed memfd of the advertised size */
+  if (received != (ssize_t) sizeof (hello) || (msg.msg_flags & MSG_CTRUNC)
+      || p_ring->mem_fd < 0 || SHM_RING_MAGIC != hello.magic
+      || SHM_RING_VERSION != hello.version || 0 == hello.capacity
+      || (hello.capacity & (hello.capacity - 1)) != 0
+      || 0 != fstat (p_ring->mem_fd, &st)
+      || (uint64_t) st.st_size != ctl_size () + hello.capacity
+      || (seals = fcntl (p_ring->mem_fd, F_GET_SEALS)) < 0
+      || (seals & SHM_RING_SEALS) != SHM_RING_SEALS)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Invalid ring received (%s)",
+               received < 0 ? strerror (errno) : "bad message");
+      tiz_shm_ring_destroy (p_ring);
+      return OMX_ErrorUndefined;
+    }
+
+  p_ring->capacity = (size_t) hello.capacity;
+  if (OMX_ErrorNone != map_ring (p_ring))
+    {
+      tiz_shm_ring_destroy (p_ring);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  p_ring->head = __atomic_load_n (&(p_ring->p_ctl->head), __ATOMIC_ACQUIRE);
+  p_ring->tail = __atomic_load_n (&(p_ring->p_ctl->tail), __ATOMIC_ACQUIRE);
+
+  *app_ring = p_ring;
+  return OMX_ErrorNone;
+}
+
+void
+tiz_shm_ring_destroy (tiz_shm_ring_t * ap_ring)
+{
+  if (ap_ring)
+    {
+      if (ap_ring->p_map)
+        {
+          (void) munmap (ap_ring->p_map, ap_ring->map_size);
+        }
+      close_fd (&(ap_ring->mem_fd));
+      close_fd (&(ap_ring->data_fd));
+      close_fd (&(ap_ring->space_fd));
+      tiz_mem_free (ap_ring);
+    }
+}
+
+size_t
+tiz_shm_ring_write (tiz_shm_ring_t * ap_ring, const void * ap_data,
+                    const size_t a_nbytes)
+{
+  size_t space = 0;
+  size_t n = 0;
+  size_t first = 0;
+  size_t offset = 0;
+
+  assert (ap_ring);
+  assert (ap_data || 0 == a_nbytes);
+
+  if (0 == (space = free_space (ap_ring)))
+    {
+      /* Ask the consumer for a wake-up, then look again, in case it made
+         room before seeing the request */
+      drain_fd (ap_ring->space_fd);
+      __atomic_store_n (&(ap_ring->p_ctl->writer_waiting), 1,
+                        __ATOMIC_SEQ_CST);
+      if (0 == (space = free_space (ap_ring)))
+        {
+          return 0;
+        }
+    }
+
+  n = MIN (space, a_nbytes);
+  offset = (size_t) (ap_ring->head & (ap_ring->capacity - 1));
+  first = MIN (n, ap_ring->capacity - offset);
+  memcpy (ap_ring->p_data + offset, ap_data, first);
+  memcpy (ap_ring->p_data, (const unsigned char *) ap_data + first,
+          n - first);
+
+  ap_ring->head += n;
+  __atomic_store_n (&(ap_ring->p_ctl->head), ap_ring->head, __ATOMIC_RELEASE);
+  __atomic_thread_fence (__ATOMIC_SEQ_CST);
+  if (__atomic_exchange_n (&(ap_ring->p_ctl->reader_waiting), 0,
+                           __ATOMIC_SEQ_CST))
+    {
+      signal_fd (ap_ring->data_fd);
+    }
+
+  return n;
+}
+
+size_t
+tiz_shm_ring_read (tiz_shm_ring_t * ap_ring, void * ap_data,
+                   const size_t a_nbytes)
+{
+  size_t avail = 0;
+  size_t n = 0;
+  size_t first = 0;
+  size_t offset = 0;
+
+  assert (ap_ring);
+  assert (ap_data || 0 == a_nbytes);
+
+  if (0 == (avail = available_data (ap_ring)))
+    {
+      drain_fd (ap_ring->data_fd);
+      __atomic_store_n (&(ap_ring->p_ctl->reader_waiting), 1,
+                        __ATOMIC_SEQ_CST);
+      if (0 == (avail = available_data (ap_ring)))
+        {
+          return 0;
+        }
+    }
+
+  n = MIN (avail, a_nbytes);
+  offset = (size_t) (ap_ring->tail & (ap_ring->capacity - 1));
+  first = MIN (n, ap_ring->capacity - offset);
+  memcpy (ap_data, ap_ring->p_data + offset, first);
+  memcpy ((unsigned char *) ap_data + first, ap_ring->p_data, n - first);
+
+  ap_ring->tail += n;
+  __atomic_store_n (&(ap_ring->p_ctl->tail), ap_ring->tail, __ATOMIC_RELEASE);
+  __atomic_thread_fence (__ATOMIC_SEQ_CST);
+  if (__atomic_exchange_n (&(ap_ring->p_ctl->writer_waiting), 0,
+                           __ATOMIC_SEQ_CST))
+    {
+      signal_fd (ap_ring->space_fd);
+    }
+
+  return n;
+}
+
+void
+tiz_shm_ring_close (tiz_shm_ring_t * ap_ring)
+{
+  assert (ap_ring);
+  __atomic_store_n (&(ap_ring->p_ctl->closed), 1, __ATOMIC_RELEASE);
+  /* Always wake the consumer; it may be waiting without having asked */
+  signal_fd (ap_ring->data_fd);
+}
+
+bool
+tiz_shm_ring_eos (const tiz_shm_ring_t * ap_ring)
+{
+  assert (ap_ring);
+  return __atomic_load_n (&(ap_ring->p_ctl->closed), __ATOMIC_ACQUIRE)
+         && __atomic_load_n (&(ap_ring->p_ctl->head), __ATOMIC_ACQUIRE)
+              == ap_ring->tail;
+}
+
+int
+tiz_shm_ring_data_fd (const tiz_shm_ring_t * ap_ring)
+{
+  assert (ap_ring);
+  return ap_ring->data_fd;
+}
+
+int
+tiz_shm_ring_space_fd (const tiz_shm_ring_t * ap_ring)
+{
+  assert (ap_ring);
+  return ap_ring->space_fd;
+}
+
+size_t
+tiz_shm_ring_capacity (const tiz_shm_ring_t * ap_ring)
+{
+  assert (ap_ring);
+  return ap_ring->capacity;
+}
@@ -0,0 +1,187 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizshmring.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Shared memory byte ring
+ *
+ *
+ */
+
+#ifndef TIZSHMRING_H
+#define TIZSHMRING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup tizshmring Shared memory byte ring
+ *
+ * A single-producer, single-consumer byte ring that lives in a memfd, so
+ * that it can be shared with another process. The side that creates the
+ * ring hands its file descriptors to the other side over a Unix domain
+ * socket. Each side has an eventfd that becomes readable when the other
+ * side has made progress: the consumer waits on the 'data' descriptor, the
+ * producer on the 'space' one. The eventfds are only written to when the
+ * other side has found the ring empty (or full) and is waiting, so a
+ * steady stream of data costs no system calls.
+ *
+ * The creator seals the size of the memfd, and the indices found in the
+ * shared header are validated on every access, so a misbehaving peer can
+ * corrupt the data but cannot make the other side fault.
+ *
+ * @ingroup libtizplatform
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+/**
+ * Shared memory ring opaque handle.
+ * @ingroup tizshmring
+ */
+typedef struct tiz_shm_ring tiz_shm_ring_t;
+typedef /*@null@ */ tiz_shm_ring_t * tiz_shm_ring_ptr_t;
+
+/**
+ * Create a ring.
+ *
+ * @ingroup tizshmring
+ *
+ * @param app_ring A reference to the ring that will be created.
+ *
+ * @param ap_name The name of the memfd (for debugging only).
+ *
+ * @param a_capacity The minimum capacity in bytes. It is rounded up to a
+ * power of two.
+ *
+ * @return OMX_ErrorNone if success, OMX_ErrorInsufficientResources otherwise.
+ */
+OMX_ERRORTYPE
+tiz_shm_ring_create (tiz_shm_ring_ptr_t * app_ring, const char * ap_name,
+                     const size_t a_capacity);
+
+/**
+ * Send the ring's descriptors over a connected Unix domain socket.
+ *
+ * @ingroup tizshmring
+ *
+ * @return OMX_ErrorNone if success, OMX_ErrorUndefined otherwise.
+ */
+OMX_ERRORTYPE
+tiz_shm_ring_send (const tiz_shm_ring_t * ap_ring, const int a_sock);
+
+/**
+ * Attach to a ring whose descriptors are received from a connected Unix
+ * domain socket. Blocks until they arrive, unless the socket is
+ * non-blocking or has a receive timeout.
+ *
+ * @ingroup tizshmring
+ *
+ * @return OMX_ErrorNone if success, OMX_ErrorInsufficientResources or
+ * OMX_ErrorUndefined otherwise.
+ */
+OMX_ERRORTYPE
+tiz_shm_ring_receive (tiz_shm_ring_ptr_t * app_ring, const int a_sock);
+
+/**
+ * Unmap the ring and close its descriptors.
+ *
+ * @ingroup tizshmring
+ */
+void
+tiz_shm_ring_destroy (tiz_shm_ring_t * ap_ring);
+
+/**
+ * Copy data into the ring (producer side). When the ring is full, the
+ * 'space' descriptor will become readable once the consumer makes room.
+ *
+ * @ingroup tizshmring
+ *
+ * @return The number of bytes written, possibly less than a_nbytes.
+ */
+size_t
+tiz_shm_ring_write (tiz_shm_ring_t * ap_ring, const void * ap_data,
+                    const size_t a_nbytes);
+
+/**
+ * Copy data out of the ring (consumer side). When the ring is empty, the
+ * 'data' descriptor will become readable once the producer adds more, or
+ * closes the ring.
+ *
+ * @ingroup tizshmring
+ *
+ * @return The number of bytes read, possibly less than a_nbytes.
+ */
+size_t
+tiz_shm_ring_read (tiz_shm_ring_t * ap_ring, void * ap_data,
+                   const size_t a_nbytes);
+
+/**
+ * Mark the end of the stream (producer side).
+ *
+ * @ingroup tizshmring
+ */
+void
+tiz_shm_ring_close (tiz_shm_ring_t * ap_ring);
+
+/**
+ * Whether the producer has closed the ring and all the data has been read
+ * (consumer side).
+ *
+ * @ingroup tizshmring
+ */
+bool
+tiz_shm_ring_eos (const tiz_shm_ring_t * ap_ring);
+
+/**
+ * The descriptor the consumer waits on, for readability.
+ *
+ * @ingroup tizshmring
+ */
+int
+tiz_shm_ring_data_fd (const tiz_shm_ring_t * ap_ring);
+
+/**
+ * The descriptor the producer waits on, for readability.
+ *
+ * @ingroup tizshmring
+ */
+int
+tiz_shm_ring_space_fd (const tiz_shm_ring_t * ap_ring);
+
+/**
+ * The capacity of the ring, in bytes.
+ *
+ * @ingroup tizshmring
+ */
+size_t
+tiz_shm_ring_capacity (const tiz_shm_ring_t * ap_ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZSHMRING_H */
@@ -0,0 +1,549 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizurlcache.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - On-disk cache of downloaded URL contents
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tizplatform.h"
+#include "tizurlcache.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.platform.urlcache"
+#endif
+
+#define URLCACHE_SIZE_KEY "OMX.Aratelia.audio_source.http.track_cache_size_mb"
+#define URLCACHE_DIR_KEY "OMX.Aratelia.audio_source.http.track_cache_dir"
+
+/* Every entry starts with this, followed by the key and the headers, each one
+ * preceded by its length */
+#define URLCACHE_MAGIC "TIZUC1\n"
+#define URLCACHE_MAGIC_LEN (sizeof (URLCACHE_MAGIC) - 1)
+#define URLCACHE_MAX_KEY_LEN 4096
+#define URLCACHE_MAX_HEADERS_LEN (64 * 1024)
+#define URLCACHE_PART_SUFFIX ".part"
+/* Partial entries left behind by a process that died are removed after
+ * this many seconds */
+#define URLCACHE_STALE_PART_SECONDS (24 * 60 * 60)
+
+typedef struct urlcache_config urlcache_config_t;
+struct urlcache_config
+{
+  bool enabled;
+  off_t max_bytes;
+  char dir[PATH_MAX];
+  tiz_mutex_t mutex;
+  unsigned int part_counter;
+};
+
+struct tiz_urlcache_writer
+{
+  FILE * p_file;
+  char * p_key;
+  tiz_buffer_t * p_headers;
+  bool body_started;
+  bool failed;
+  char part_path[PATH_MAX];
+  char path[PATH_MAX];
+};
+
+struct tiz_urlcache_reader
+{
+  FILE * p_file;
+  char * p_headers;
+  size_t headers_len;
+};
+
+typedef struct urlcache_entry urlcache_entry_t;
+struct urlcache_entry
+{
+  char name[NAME_MAX + 1];
+  time_t mtime;
+  off_t size;
+};
+
+static pthread_once_t g_urlcache_once = PTHREAD_ONCE_INIT;
+static urlcache_config_t g_urlcache;
+
+static bool
+make_dirs (char * ap_path)
+{
+  char * p = ap_path;
+  assert (ap_path);
+
+  while ((p = strchr (p + 1, '/')))
+    {
+      *p = '\0';
+      if (mkdir (ap_path, 0700) != 0 && errno != EEXIST)
+        {
+          *p = '/';
+          return false;
+        }
+      *p = '/';
+    }
+  return (mkdir (ap_path, 0700) == 0 || errno == EEXIST);
+}
+
+static void
+init_urlcache (void)
+{
+  const char * p_size = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION,
+                                              URLCACHE_SIZE_KEY);
+  const char * p_dir = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION,
+                                             URLCACHE_DIR_KEY);
+  long size_mb = p_size ? strtol (p_size, NULL, 10) : 0;
+  int len = 0;
+
+  g_urlcache.enabled = false;
+  if (size_mb <= 0)
+    {
+      return;
+    }
+
+  if (p_dir && strlen (p_dir) > 0)
+    {
+      len = snprintf (g_urlcache.dir, sizeof (g_urlcache.dir), "%s", p_dir);
+    }
+  else
+    {
+      const char * p_xdg = getenv ("XDG_CACHE_HOME");
+      const char * p_home = getenv ("HOME");
+      if (p_xdg && strlen (p_xdg) > 0)
+        {
+          len = snprintf (g_urlcache.dir, sizeof (g_urlcache.dir),
+                          "%s/tizonia/tracks", p_xdg);
+        }
+      else
+        {
+          len = snprintf (g_urlcache.dir, sizeof (g_urlcache.dir),
+                          "%s/.cache/tizonia/tracks", p_home ? p_home : "/tmp");
+        }
+    }
+
+  if (len <= 0 || len >= (int) sizeof (g_urlcache.dir) - NAME_MAX - 2
+      || !make_dirs (g_urlcache.dir)
+      || OMX_ErrorNone != tiz_mutex_init (&(g_urlcache.mutex)))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to use [%s] as the track cache",
+               g_urlcache.dir);
+      return;
+    }
+
+  g_urlcache.max_bytes = (off_t) size_mb * 1024 * 1024;
+  g_urlcache.enabled = true;
+  TIZ_LOG (TIZ_PRIORITY_NOTICE, "Track cache at [%s] (%ld MB)",
+           g_urlcache.dir, size_mb);
+}
+
+/* 64-bit FNV-1a */
+static uint64_t
+hash_key (const char * ap_key)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+  assert (ap_key);
+  while (*ap_key)
+    {
+      h ^= (unsigned char) *ap_key++;
+      h *= 0x100000001b3ULL;
+    }
+  return h;
+}
+
+static void
+entry_path (char * ap_buf, const size_t a_len, const char * ap_key)
+{
+  (void) snprintf (ap_buf, a_len, "%s/%016llx", g_urlcache.dir,
+                   (unsigned long long) hash_key (ap_key));
+}
+
+static int
+compare_entries (const void * ap_a, const void * ap_b)
+{
+  const urlcache_entry_t * p_a = ap_a;
+  const urlcache_entry_t * p_b = ap_b;
+  return (p_a->mtime > p_b->mtime) - (p_a->mtime < p_b->mtime);
+}
+
+/* Drop the least recently used entries until the cache fits in its cap */
+static void
+evict_entries (void)
+{
+  urlcache_entry_t * p_entries = NULL;
+  size_t nentries = 0;
+  size_t capacity = 0;
+  off_t total = 0;
+  const time_t now = time (NULL);
+  struct dirent * p_dirent = NULL;
+  DIR * p_dir = opendir (g_urlcache.dir);
+
+  if (!p_dir)
+    {
+      return;
+    }
+
+  while ((p_dirent = readdir (p_dir)))
+    {
+      struct stat st;
+      if ('.' == p_dirent->d_name[0]
+          || fstatat (dirfd (p_dir), p_dirent->d_name, &st, 0) != 0
+          || !S_ISREG (st.st_mode))
+        {
+          continue;
+        }
+
+      if (strstr (p_dirent->d_name, URLCACHE_PART_SUFFIX))
+        {
+          if (now - st.st_mtime > URLCACHE_STALE_PART_SECONDS)
+            {
+              (void) unlinkat (dirfd (p_dir), p_dirent->d_name, 0);
+            }
+          continue;
+        }
+
+      if (nentries == capacity)
+        {
+          urlcache_entry_t * p_new = NULL;
+          capacity = capacity ? capacity * 2 : 64;
+          if (!(p_new = tiz_mem_realloc (p_entries,
+                                         capacity * sizeof (urlcache_entry_t))))
+            {
+              break;
+            }
+          p_entries = p_new;
+        }
+      (void) snprintf (p_entries[nentries].name,
+                       sizeof (p_entries[nentries].name), "%s",
+                       p_dirent->d_name);
+      p_entries[nentries].mtime = st.st_mtime;
+      p_entries[nentries].size = st.st_size;
+      total += st.st_size;
+      ++nentries;
+    }
+
+  if (total > g_urlcache.max_bytes && p_entries)
+    {
+      size_t i = 0;
+      qsort (p_entries, nentries, sizeof (urlcache_entry_t), compare_entries);
+      for (i = 0; i < nentries && total > g_urlcache.max_bytes; ++i)
+        {
+          if (0 == unlinkat (dirfd (p_dir), p_entries[i].name, 0))
+            {
+              TIZ_LOG (TIZ_PRIORITY_TRACE, "Evicted [%s] (%ld bytes)",
+                       p_entries[i].name, (long) p_entries[i].size);
+              total -= p_entries[i].size;
+            }
+        }
+    }
+
+  tiz_mem_free (p_entries);
+  (void) closedir (p_dir);
+}
+
+static void
+write_bytes (tiz_urlcache_writer_t * ap_writer, const void * ap_data,
+             const size_t a_nbytes)
+{
+  assert (ap_writer);
+  if (!ap_writer->failed && a_nbytes > 0
+      && fwrite (ap_data, 1, a_nbytes, ap_writer->p_file) != a_nbytes)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to write to [%s] (%s)",
+               ap_writer->part_path, strerror (errno));
+      ap_writer->failed = true;
+    }
+}
+
+static void
+write_prologue (tiz_urlcache_writer_t * ap_writer)
+{
+  const uint32_t key_len = strlen (ap_writer->p_key);
+  const uint32_t headers_len = tiz_buffer_available (ap_writer->p_headers);
+
+  assert (ap_writer);
+  assert (!ap_writer->body_started);
+
+  write_bytes (ap_writer, URLCACHE_MAGIC, URLCACHE_MAGIC_LEN);
+  write_bytes (ap_writer, &key_len, sizeof (key_len));
+  write_bytes (ap_writer, ap_writer->p_key, key_len);
+  write_bytes (ap_writer, &headers_len, sizeof (headers_len));
+  write_bytes (ap_writer, tiz_buffer_get (ap_writer->p_headers), headers_len);
+  ap_writer->body_started = true;
+}
+
+static bool
+read_bytes (FILE * ap_file, void * ap_data, const size_t a_nbytes)
+{
+  return (fread (ap_data, 1, a_nbytes, ap_file) == a_nbytes);
+}
+
+bool
+tiz_urlcache_enabled (void)
+{
+  (void) pthread_once (&g_urlcache_once, init_urlcache);
+  return g_urlcache.enabled;
+}
+
+OMX_ERRORTYPE
+tiz_urlcache_writer_open (tiz_urlcache_writer_ptr_t * app_writer,
+                          const char * ap_key)
+{
+  tiz_urlcache_writer_t * p_writer = NULL;
+  unsigned int counter = 0;
+
+  assert (app_writer);
+  assert (ap_key);
+
+  if (!tiz_urlcache_enabled () || strlen (ap_key) > URLCACHE_MAX_KEY_LEN)
+    {
+      return OMX_ErrorNotImplemented;
+    }
+
+  tiz_check_null_ret_oom (
+    (p_writer = tiz_mem_calloc (1, sizeof (tiz_urlcache_writer_t))));
+
+  (void) tiz_mutex_lock (&(g_urlcache.mutex));
+  counter = ++g_urlcache.part_counter;
+  (void) tiz_mutex_unlock (&(g_urlcache.mutex));
+
+  entry_path (p_writer->path, sizeof (p_writer->path), ap_key);
+  (void) snprintf (p_writer->part_path, sizeof (p_writer->part_path),
+                   "%s.%d.%u" URLCACHE_PART_SUFFIX, p_writer->path,
+                   (int) getpid (), counter);
+
+  if (!(p_writer->p_key = strdup (ap_key))
+      || OMX_ErrorNone != tiz_buffer_init (&(p_writer->p_headers), 1024)
+      || !(p_writer->p_file = fopen (p_writer->part_path, "wb")))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to create [%s]",
+               p_writer->part_path);
+      tiz_buffer_destroy (p_writer->p_headers);
+      free (p_writer->p_key);
+      tiz_mem_free (p_writer);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  *app_writer = p_writer;
+  return OMX_ErrorNone;
+}
+
+void
+tiz_urlcache_writer_add_header (tiz_urlcache_writer_t * ap_writer,
+                                const void * ap_data, const size_t a_nbytes)
+{
+  assert (ap_writer);
+  if (ap_writer->body_started
+      || tiz_buffer_available (ap_writer->p_headers) + a_nbytes
+           > URLCACHE_MAX_HEADERS_LEN
+      || tiz_buffer_push (ap_writer->p_headers, ap_data, a_nbytes)
+           < (int) a_nbytes)
+    {
+      ap_writer->failed = true;
+    }
+}
+
+void
+tiz_urlcache_writer_write (tiz_urlcache_writer_t * ap_writer,
+                           const void * ap_data, const size_t a_nbytes)
+{
+  assert (ap_writer);
+  if (!ap_writer->body_started)
+    {
+      write_prologue (ap_writer);
+    }
+  write_bytes (ap_writer, ap_data, a_nbytes);
+}
+
+void
+tiz_urlcache_writer_close (tiz_urlcache_writer_t * ap_writer,
+                           const bool a_commit)
+{
+  bool committed = false;
+
+  if (!ap_writer)
+    {
+      return;
+    }
+
+  if (!ap_writer->body_started)
+    {
+      write_prologue (ap_writer);
+    }
+
+  if (0 != fclose (ap_writer->p_file))
+    {
+      ap_writer->failed = true;
+    }
+
+  if (a_commit && !ap_writer->failed)
+    {
+      (void) tiz_mutex_lock (&(g_urlcache.mutex));
+      if (0 == rename (ap_writer->part_path, ap_writer->path))
+        {
+          committed = true;
+          evict_entries ();
+        }
+      (void) tiz_mutex_unlock (&(g_urlcache.mutex));
+    }
+
+  if (!committed)
+    {
+      (void) unlink (ap_writer->part_path);
+    }
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s] %s", ap_writer->p_key,
+           committed ? "cached" : "discarded");
+
+  tiz_buffer_destroy (ap_writer->p_headers);
+  free (ap_writer->p_key);
+  tiz_mem_free (ap_writer);
+}
+
+OMX_ERRORTYPE
+tiz_urlcache_reader_open (tiz_urlcache_reader_ptr_t * app_reader,
+                          const char * ap_key)
+{
+  tiz_urlcache_reader_t * p_reader = NULL;
+  char path[PATH_MAX];
+  char magic[URLCACHE_MAGIC_LEN];
+  char * p_stored_key = NULL;
+  uint32_t key_len = 0;
+  uint32_t headers_len = 0;
+  FILE * p_file = NULL;
+  bool found = false;
+
+  assert (app_reader);
+  assert (ap_key);
+
+  if (!tiz_urlcache_enabled ())
+    {
+      return OMX_ErrorContentURIError;
+    }
+
+  entry_path (path, sizeof (path), ap_key);
+  if (!(p_file = fopen (path, "rb")))
+    {
+      return OMX_ErrorContentURIError;
+    }
+
+  /* Verify the entry's key too, in case two keys hash to the same name */
+  if (read_bytes (p_file, magic, URLCACHE_MAGIC_LEN)
+      && 0 == memcmp (magic, URLCACHE_MAGIC, URLCACHE_MAGIC_LEN)
+      && read_bytes (p_file, &key_len, sizeof (key_len))
+      && key_len == strlen (ap_key)
+      && (p_stored_key = tiz_mem_alloc (key_len + 1))
+      && read_bytes (p_file, p_stored_key, key_len)
+      && 0 == memcmp (p_stored_key, ap_key, key_len)
+      && read_bytes (p_file, &headers_len, sizeof (headers_len))
+      && headers_len <= URLCACHE_MAX_HEADERS_LEN
+      && (p_reader = tiz_mem_calloc (1, sizeof (tiz_urlcache_reader_t)))
+      && (p_reader->p_headers = tiz_mem_alloc (headers_len + 1))
+      && read_bytes (p_file, p_reader->p_headers, headers_len))
+    {
+      p_reader->p_headers[headers_len] = '\0';
+      p_reader->headers_len = headers_len;
+      p_reader->p_file = p_file;
+      found = true;
+      /* This is now the most recently used entry */
+      (void) futimens (fileno (p_file), NULL);
+    }
+
+  tiz_mem_free (p_stored_key);
+
+  if (!found)
+    {
+      if (p_reader)
+        {
+          tiz_mem_free (p_reader->p_headers);
+          tiz_mem_free (p_reader);
+        }
+      (void) fclose (p_file);
+      return OMX_ErrorContentURIError;
+    }
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s] found in the cache", ap_key);
+  *app_reader = p_reader;
+  return OMX_ErrorNone;
+}
+
+const char *
+tiz_urlcache_reader_headers (const tiz_urlcache_reader_t * ap_reader,
+                             size_t * ap_nbytes)
+{
+  assert (ap_reader);
+  assert (ap_nbytes);
+  *ap_nbytes = ap_reader->headers_len;
+  return ap_reader->p_headers;
+}
+
+ssize_t
+tiz_urlcache_reader_read (tiz_urlcache_reader_t * ap_reader, void * ap_data,
+                          const size_t a_nbytes)
+{
+  size_t nbytes = 0;
+  assert (ap_reader);
+  nbytes = fread (ap_data, 1, a_nbytes, ap_reader->p_file);
+  if (0 == nbytes && ferror (ap_reader->p_file))
+    {
+      return -1;
+    }
+  return nbytes;
+}
+
+void
+tiz_urlcache_reader_unread (tiz_urlcache_reader_t * ap_reader,
+                            const size_t a_nbytes)
+{
+  assert (ap_reader);
+  (void) fseeko (ap_reader->p_file, -(off_t) a_nbytes, SEEK_CUR);
+}
+
+void
+tiz_urlcache_reader_close (tiz_urlcache_reader_t * ap_reader)
+{
+  if (ap_reader)
+    {
+      (void) fclose (ap_reader->p_file);
+      tiz_mem_free (ap_reader->p_headers);
+      tiz_mem_free (ap_reader);
+    }
+}
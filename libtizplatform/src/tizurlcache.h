@@ -0,0 +1,139 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizurlcache.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - On-disk cache of downloaded URL contents
+ *
+ * Entries are addressed by a client-supplied key (e.g. a track id) and hold
+ * the HTTP headers and the body of a complete download. The cache is capped
+ * in size; the least recently used entries are evicted first. Its size and
+ * location are configured in tizonia.conf.
+ */
+
+#ifndef TIZURLCACHE_H
+#define TIZURLCACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+/**
+ * Cache entry writer opaque handle.
+ */
+typedef struct tiz_urlcache_writer tiz_urlcache_writer_t;
+typedef /*@null@ */ tiz_urlcache_writer_t * tiz_urlcache_writer_ptr_t;
+
+/**
+ * Cache entry reader opaque handle.
+ */
+typedef struct tiz_urlcache_reader tiz_urlcache_reader_t;
+typedef /*@null@ */ tiz_urlcache_reader_t * tiz_urlcache_reader_ptr_t;
+
+/**
+ * Whether the cache has been enabled in the configuration file.
+ */
+bool
+tiz_urlcache_enabled (void);
+
+/**
+ * Start a new entry. Nothing is visible to readers until the entry is
+ * committed.
+ *
+ * @return OMX_ErrorNone if success, OMX_ErrorNotImplemented if the cache is
+ * disabled, OMX_ErrorInsufficientResources otherwise.
+ */
+OMX_ERRORTYPE
+tiz_urlcache_writer_open (tiz_urlcache_writer_ptr_t * app_writer,
+                          const char * ap_key);
+
+/**
+ * Append a header line. All headers must be added before any body data.
+ */
+void
+tiz_urlcache_writer_add_header (tiz_urlcache_writer_t * ap_writer,
+                                const void * ap_data, const size_t a_nbytes);
+
+/**
+ * Append body data.
+ */
+void
+tiz_urlcache_writer_write (tiz_urlcache_writer_t * ap_writer,
+                           const void * ap_data, const size_t a_nbytes);
+
+/**
+ * Finish the entry. When a_commit is true and no write has failed, the entry
+ * replaces any previous one with the same key and the least recently used
+ * entries are evicted as needed. Otherwise the entry is discarded.
+ */
+void
+tiz_urlcache_writer_close (tiz_urlcache_writer_t * ap_writer,
+                           const bool a_commit);
+
+/**
+ * Open the entry for a key. A successful lookup marks the entry as the most
+ * recently used.
+ *
+ * @return OMX_ErrorNone if the entry exists, OMX_ErrorContentURIError
+ * otherwise.
+ */
+OMX_ERRORTYPE
+tiz_urlcache_reader_open (tiz_urlcache_reader_ptr_t * app_reader,
+                          const char * ap_key);
+
+/**
+ * The headers stored with the entry, as they were received (one line after
+ * another, each one terminated by CRLF).
+ */
+const char *
+tiz_urlcache_reader_headers (const tiz_urlcache_reader_t * ap_reader,
+                             size_t * ap_nbytes);
+
+/**
+ * Read the next chunk of body data.
+ *
+ * @return The number of bytes read, 0 at the end of the entry, or -1 on error.
+ */
+ssize_t
+tiz_urlcache_reader_read (tiz_urlcache_reader_t * ap_reader, void * ap_data,
+                          const size_t a_nbytes);
+
+/**
+ * Step back so that the last a_nbytes bytes are read again.
+ */
+void
+tiz_urlcache_reader_unread (tiz_urlcache_reader_t * ap_reader,
+                            const size_t a_nbytes);
+
+void
+tiz_urlcache_reader_close (tiz_urlcache_reader_t * ap_reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZURLCACHE_H */
@@ -0,0 +1,930 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizurlprefetch.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Parallel byte-range download of a URL
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <curl/curl.h>
+
+#include "tizplatform.h"
+#include "tizurlprefetch.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.platform.urlprefetch"
+#endif
+
+#define URLPREFETCH_SEGMENT_SIZE (256 * 1024)
+#define URLPREFETCH_MAX_CONNECTIONS 8
+/* How far ahead of the read position segments are requested */
+#define URLPREFETCH_WINDOW_SEGMENTS 64
+#define URLPREFETCH_MAX_RETRIES 3
+#define URLPREFETCH_MAX_HEADERS_LEN (64 * 1024)
+#define URLPREFETCH_WAIT_MS 100
+/* How long the thread sleeps, at most, when there is nothing to download
+   until the reader moves */
+#define URLPREFETCH_IDLE_WAIT_MS 1000
+
+typedef enum urlprefetch_segment_state urlprefetch_segment_state_t;
+enum urlprefetch_segment_state
+{
+  ESegmentPending,
+  ESegmentFetching,
+  ESegmentDone
+};
+
+typedef struct urlprefetch_segment urlprefetch_segment_t;
+struct urlprefetch_segment
+{
+  urlprefetch_segment_state_t state;
+  size_t filled; /* bytes stored from the start of the segment */
+  int retries;
+};
+
+typedef struct urlprefetch_conn urlprefetch_conn_t;
+struct urlprefetch_conn
+{
+  tiz_urlprefetch_t * p_prefetch;
+  CURL * p_curl;
+  size_t segment;
+  bool probe; /* the first request, which learns the headers and the size */
+  long status;
+  char range[64];
+};
+
+struct tiz_urlprefetch
+{
+  char * p_url;
+  char * p_user_agent;
+  void * p_curl_share;
+  int nconns;
+  tiz_urlprefetch_notify_f pf_notify;
+  void * p_arg;
+  FILE * p_file;
+  int fd;
+  CURLM * p_multi;
+  urlprefetch_conn_t conns[URLPREFETCH_MAX_CONNECTIONS];
+  int probe_retries;
+  tiz_thread_t thread;
+  bool thread_started;
+  /* The members below are protected by the mutex */
+  tiz_mutex_t mutex;
+  tiz_cond_t cond; /* signalled when the reader moves, or on stop */
+  bool idle;       /* the thread is waiting on the condition */
+  bool stop;
+  bool failed;
+  bool headers_ready;
+  bool reader_waiting;
+  tiz_buffer_t * p_headers;
+  char content_range[128];
+  off_t content_length;
+  bool ranged; /* otherwise, the whole resource is segment 0 */
+  off_t total; /* -1 while unknown */
+  size_t nsegments;
+  urlprefetch_segment_t * p_segments;
+  off_t read_pos;
+};
+
+static inline off_t
+segment_start (const tiz_urlprefetch_t * ap_prefetch, const size_t a_segment)
+{
+  assert (ap_prefetch);
+  return ap_prefetch->ranged ? (off_t) a_segment * URLPREFETCH_SEGMENT_SIZE
+                             : 0;
+}
+
+/* The size of a segment, or -1 if the end of the resource is unknown */
+static off_t
+segment_size (const tiz_urlprefetch_t * ap_prefetch, const size_t a_segment)
+{
+  assert (ap_prefetch);
+  if (!ap_prefetch->ranged)
+    {
+      return ap_prefetch->total;
+    }
+  return MIN (URLPREFETCH_SEGMENT_SIZE,
+              ap_prefetch->total - segment_start (ap_prefetch, a_segment));
+}
+
+static inline size_t
+segment_at (const tiz_urlprefetch_t * ap_prefetch, const off_t a_offset)
+{
+  return ap_prefetch->ranged ? (size_t) (a_offset / URLPREFETCH_SEGMENT_SIZE)
+                             : 0;
+}
+
+/* Whether the reader would now find data it previously went without. To be
+ * called with the mutex locked. */
+static bool
+wake_reader (tiz_urlprefetch_t * ap_prefetch)
+{
+  bool wake = false;
+  assert (ap_prefetch);
+  if (ap_prefetch->reader_waiting)
+    {
+      wake = ap_prefetch->failed || !ap_prefetch->p_segments;
+      if (!wake)
+        {
+          const size_t seg = segment_at (ap_prefetch, ap_prefetch->read_pos);
+          wake = (seg >= ap_prefetch->nsegments
+                  || ap_prefetch->p_segments[seg].state == ESegmentDone
+                  || ap_prefetch->read_pos
+                       < segment_start (ap_prefetch, seg)
+                           + (off_t) ap_prefetch->p_segments[seg].filled);
+        }
+      ap_prefetch->reader_waiting = !wake;
+    }
+  return wake;
+}
+
+static void
+notify_if_needed (tiz_urlprefetch_t * ap_prefetch)
+{
+  bool wake = false;
+  assert (ap_prefetch);
+  (void) tiz_mutex_lock (&(ap_prefetch->mutex));
+  wake = wake_reader (ap_prefetch);
+  (void) tiz_mutex_unlock (&(ap_prefetch->mutex));
+  if (wake)
+    {
+      ap_prefetch->pf_notify (ap_prefetch->p_arg);
+    }
+}
+
+static bool
+header_is (const char * ap_line, const size_t a_len, const char * ap_name)
+{
+  const size_t name_len = strlen (ap_name);
+  return (a_len > name_len && ap_line[name_len] == ':'
+          && strncasecmp (ap_line, ap_name, name_len) == 0);
+}
+
+static void
+copy_header_value (char * ap_dst, const size_t a_dst_len,
+                   const char * ap_line, const size_t a_len)
+{
+  const char * p_value = memchr (ap_line, ':', a_len);
+  size_t len = 0;
+  assert (p_value);
+  ++p_value;
+  while (p_value < ap_line + a_len && (*p_value == ' ' || *p_value == '\t'))
+    {
+      ++p_value;
+    }
+  len = MIN ((size_t) (ap_line + a_len - p_value), a_dst_len - 1);
+  memcpy (ap_dst, p_value, len);
+  ap_dst[len] = '\0';
+}
+
+/* The probe's headers are complete. To be called with the mutex locked. */
+static bool
+finish_headers (tiz_urlprefetch_t * ap_prefetch, const long a_status)
+{
+  char line[64];
+  assert (ap_prefetch);
+
+  if (206 == a_status)
+    {
+      /* "bytes 0-262143/4189230" */
+      const char * p_total = strchr (ap_prefetch->content_range, '/');
+      long long total = -1;
+      if (!p_total || sscanf (p_total + 1, "%lld", &total) != 1 || total <= 0)
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "Unusable Content-Range [%s]",
+                   ap_prefetch->content_range);
+          return false;
+        }
+      ap_prefetch->ranged = true;
+      ap_prefetch->total = total;
+      ap_prefetch->nsegments
+        = (total + URLPREFETCH_SEGMENT_SIZE - 1) / URLPREFETCH_SEGMENT_SIZE;
+    }
+  else
+    {
+      /* The server ignored the Range header */
+      TIZ_LOG (TIZ_PRIORITY_NOTICE, "[%s] doesn't support ranges",
+               ap_prefetch->p_url);
+      ap_prefetch->ranged = false;
+      ap_prefetch->total = ap_prefetch->content_length;
+      ap_prefetch->nsegments = 1;
+    }
+
+  if (!(ap_prefetch->p_segments = tiz_mem_calloc (
+          ap_prefetch->nsegments, sizeof (urlprefetch_segment_t))))
+    {
+      return false;
+    }
+  /* The probe is downloading the first segment */
+  ap_prefetch->p_segments[0].state = ESegmentFetching;
+
+  if (ap_prefetch->total >= 0)
+    {
+      const int len = snprintf (line, sizeof (line), "Content-Length: %lld\r\n",
+                                (long long) ap_prefetch->total);
+      (void) tiz_buffer_push (ap_prefetch->p_headers, line, len);
+    }
+  ap_prefetch->headers_ready = true;
+  return true;
+}
+
+static size_t
+probe_header_cback (urlprefetch_conn_t * ap_conn, const char * ap_line,
+                    const size_t a_len)
+{
+  tiz_urlprefetch_t * p_prefetch = ap_conn->p_prefetch;
+  bool ok = true;
+
+  (void) tiz_mutex_lock (&(p_prefetch->mutex));
+  if (a_len > 5 && strncmp (ap_line, "HTTP/", 5) == 0)
+    {
+      /* A new response (e.g. after a redirect); forget the previous one */
+      tiz_buffer_clear (p_prefetch->p_headers);
+      p_prefetch->content_range[0] = '\0';
+      p_prefetch->content_length = -1;
+      ok = (tiz_buffer_push (p_prefetch->p_headers, ap_line, a_len)
+            == (int) a_len);
+    }
+  else if (a_len <= 2)
+    {
+      /* End of the headers of a response; redirects are followed by curl */
+      if (ap_conn->status >= 200 && ap_conn->status < 300)
+        {
+          ok = finish_headers (p_prefetch, ap_conn->status);
+        }
+    }
+  else if (header_is (ap_line, a_len, "Content-Range"))
+    {
+      copy_header_value (p_prefetch->content_range,
+                         sizeof (p_prefetch->content_range), ap_line, a_len);
+    }
+  else if (header_is (ap_line, a_len, "Content-Length"))
+    {
+      char value[32];
+      copy_header_value (value, sizeof (value), ap_line, a_len);
+      p_prefetch->content_length = strtoll (value, NULL, 10);
+    }
+  else if (tiz_buffer_available (p_prefetch->p_headers) + a_len
+           <= URLPREFETCH_MAX_HEADERS_LEN)
+    {
+      ok = (tiz_buffer_push (p_prefetch->p_headers, ap_line, a_len)
+            == (int) a_len);
+    }
+  (void) tiz_mutex_unlock (&(p_prefetch->mutex));
+
+  if (ok && p_prefetch->headers_ready)
+    {
+      notify_if_needed (p_prefetch);
+    }
+  return ok ? a_len : 0;
+}
+
+static size_t
+header_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
+{
+  urlprefetch_conn_t * p_conn = userdata;
+  const size_t nbytes = size * nmemb;
+  assert (p_conn);
+
+  if (nbytes > 5 && strncmp (ptr, "HTTP/", 5) == 0)
+    {
+      p_conn->status = 0;
+      (void) sscanf ((const char *) ptr, "%*s %ld", &(p_conn->status));
+    }
+
+  if (p_conn->probe && !p_conn->p_prefetch->headers_ready)
+    {
+      return probe_header_cback (p_conn, ptr, nbytes);
+    }
+  return nbytes;
+}
+
+static size_t
+write_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
+{
+  urlprefetch_conn_t * p_conn = userdata;
+  tiz_urlprefetch_t * p_prefetch = NULL;
+  urlprefetch_segment_t * p_seg = NULL;
+  const size_t nbytes = size * nmemb;
+  size_t nwrite = nbytes;
+  off_t offset = 0;
+  off_t seg_size = 0;
+  const char * p_data = ptr;
+
+  assert (p_conn);
+  p_prefetch = p_conn->p_prefetch;
+  assert (p_prefetch);
+
+  /* Parallel requests are only good if the server honours the range */
+  if (!p_prefetch->headers_ready
+      || (p_prefetch->ranged && 206 != p_conn->status))
+    {
+      return 0;
+    }
+
+  (void) tiz_mutex_lock (&(p_prefetch->mutex));
+  p_seg = &(p_prefetch->p_segments[p_conn->segment]);
+  offset = segment_start (p_prefetch, p_conn->segment) + p_seg->filled;
+  seg_size = segment_size (p_prefetch, p_conn->segment);
+  (void) tiz_mutex_unlock (&(p_prefetch->mutex));
+
+  if (seg_size >= 0)
+    {
+      nwrite = MIN (nwrite, (size_t) (seg_size - (off_t) p_seg->filled));
+    }
+
+  while (nwrite > 0)
+    {
+      const ssize_t n = pwrite (p_prefetch->fd, p_data, nwrite, offset);
+      if (n < 0 && errno == EINTR)
+        {
+          continue;
+        }
+      if (n <= 0)
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to write to the temp file (%s)",
+                   strerror (errno));
+          return 0;
+        }
+      (void) tiz_mutex_lock (&(p_prefetch->mutex));
+      p_seg->filled += n;
+      (void) tiz_mutex_unlock (&(p_prefetch->mutex));
+      p_data += n;
+      offset += n;
+      nwrite -= n;
+    }
+
+  notify_if_needed (p_prefetch);
+  return nbytes;
+}
+
+static bool
+start_conn (tiz_urlprefetch_t * ap_prefetch, urlprefetch_conn_t * ap_conn,
+            const size_t a_segment, const bool a_probe)
+{
+  off_t from = 0;
+  assert (ap_prefetch);
+  assert (ap_conn);
+  assert (!ap_conn->p_curl);
+
+  if (!(ap_conn->p_curl = curl_easy_init ()))
+    {
+      return false;
+    }
+
+  ap_conn->p_prefetch = ap_prefetch;
+  ap_conn->segment = a_segment;
+  ap_conn->probe = a_probe;
+  ap_conn->status = 0;
+
+  if (a_probe)
+    {
+      (void) snprintf (ap_conn->range, sizeof (ap_conn->range), "0-%d",
+                       URLPREFETCH_SEGMENT_SIZE - 1);
+    }
+  else
+    {
+      /* A retried segment carries on from where it was left */
+      from = segment_start (ap_prefetch, a_segment)
+             + ap_prefetch->p_segments[a_segment].filled;
+      if (ap_prefetch->ranged)
+        {
+          (void) snprintf (
+            ap_conn->range, sizeof (ap_conn->range), "%lld-%lld",
+            (long long) from,
+            (long long) (segment_start (ap_prefetch, a_segment)
+                         + segment_size (ap_prefetch, a_segment) - 1));
+        }
+      else
+        {
+          /* Without ranges, a retry has to start from scratch */
+          ap_prefetch->p_segments[a_segment].filled = 0;
+          ap_conn->range[0] = '\0';
+        }
+    }
+
+  (void) curl_easy_setopt (ap_conn->p_curl, CURLOPT_URL, ap_prefetch->p_url);
+  (void) curl_easy_setopt (ap_conn->p_curl, CURLOPT_PRIVATE, ap_conn);
+  (void) curl_easy_setopt (ap_conn->p_curl, CURLOPT_USERAGENT,
+                           ap_prefetch->p_user_agent);
+  (void) curl_easy_setopt (ap_conn->p_curl, CURLOPT_HEADERFUNCTION,
+                           header_cback);
+  (void) curl_easy_setopt (ap_conn->p_curl, CURLOPT_HEADERDATA, ap_conn);
+  (void) curl_easy_setopt (ap_conn->p_curl, CURLOPT_WRITEFUNCTION,
+                           write_cback);
+  (void) curl_easy_setopt (ap_conn->p_curl, CURLOPT_WRITEDATA, ap_conn);
+  if (ap_conn->range[0] != '\0')
+    {
+      (void) curl_easy_setopt (ap_conn->p_curl, CURLOPT_RANGE, ap_conn->range);
+    }
+  (void) curl_easy_setopt (ap_conn->p_curl, CURLOPT_FOLLOWLOCATION, 1L);
+  (void) curl_easy_setopt (ap_conn->p_curl, CURLOPT_MAXREDIRS, 5L);
+  (void) curl_easy_setopt (ap_conn->p_curl, CURLOPT_NETRC, 1L);
+  (void) curl_easy_setopt (ap_conn->p_curl, CURLOPT_FAILONERROR, 1L);
+  (void) curl_easy_setopt (ap_conn->p_curl, CURLOPT_NOPROGRESS, 1L);
+  (void) curl_easy_setopt (ap_conn->p_curl, CURLOPT_SSL_VERIFYHOST, 0L);
+  (void) curl_easy_setopt (ap_conn->p_curl, CURLOPT_SSL_VERIFYPEER, 0L);
+  if (ap_prefetch->p_curl_share)
+    {
+      (void) curl_easy_setopt (ap_conn->p_curl, CURLOPT_SHARE,
+                               ap_prefetch->p_curl_share);
+    }
+
+  if (CURLM_OK != curl_multi_add_handle (ap_prefetch->p_multi, ap_conn->p_curl))
+    {
+      curl_easy_cleanup (ap_conn->p_curl);
+      ap_conn->p_curl = NULL;
+      return false;
+    }
+  return true;
+}
+
+static void
+stop_conn (tiz_urlprefetch_t * ap_prefetch, urlprefetch_conn_t * ap_conn)
+{
+  assert (ap_prefetch);
+  assert (ap_conn);
+  if (ap_conn->p_curl)
+    {
+      (void) curl_multi_remove_handle (ap_prefetch->p_multi, ap_conn->p_curl);
+      curl_easy_cleanup (ap_conn->p_curl);
+      ap_conn->p_curl = NULL;
+    }
+}
+
+/* The next segment to download: the first pending one from the read
+ * position onwards, then any pending one before it. To be called with the
+ * mutex locked. */
+static bool
+next_segment (tiz_urlprefetch_t * ap_prefetch, size_t * ap_segment)
+{
+  const size_t first = segment_at (ap_prefetch, ap_prefetch->read_pos);
+  const size_t last
+    = MIN (ap_prefetch->nsegments, first + URLPREFETCH_WINDOW_SEGMENTS);
+  size_t i = 0;
+
+  for (i = first; i < last; ++i)
+    {
+      if (ESegmentPending == ap_prefetch->p_segments[i].state)
+        {
+          *ap_segment = i;
+          return true;
+        }
+    }
+  for (i = 0; i < MIN (first, ap_prefetch->nsegments); ++i)
+    {
+      if (ESegmentPending == ap_prefetch->p_segments[i].state)
+        {
+          *ap_segment = i;
+          return true;
+        }
+    }
+  return false;
+}
+
+/* To be called with the mutex locked */
+static bool
+all_segments_done (const tiz_urlprefetch_t * ap_prefetch)
+{
+  size_t i = 0;
+  if (!ap_prefetch->p_segments)
+    {
+      return false;
+    }
+  for (i = 0; i < ap_prefetch->nsegments; ++i)
+    {
+      if (ESegmentDone != ap_prefetch->p_segments[i].state)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+static void
+schedule_segments (tiz_urlprefetch_t * ap_prefetch)
+{
+  int i = 0;
+  assert (ap_prefetch);
+
+  /* Without ranges, this only restarts the download of the whole resource
+     after a failure */
+  (void) tiz_mutex_lock (&(ap_prefetch->mutex));
+  if (ap_prefetch->headers_ready && !ap_prefetch->failed)
+    {
+      for (i = 0; i < ap_prefetch->nconns; ++i)
+        {
+          size_t seg = 0;
+          urlprefetch_conn_t * p_conn = &(ap_prefetch->conns[i]);
+          if (p_conn->p_curl)
+            {
+              continue;
+            }
+          if (!next_segment (ap_prefetch, &seg))
+            {
+              break;
+            }
+          if (!start_conn (ap_prefetch, p_conn, seg, false))
+            {
+              break;
+            }
+          ap_prefetch->p_segments[seg].state = ESegmentFetching;
+        }
+    }
+  (void) tiz_mutex_unlock (&(ap_prefetch->mutex));
+}
+
+static void
+on_conn_done (tiz_urlprefetch_t * ap_prefetch, urlprefetch_conn_t * ap_conn,
+              const CURLcode a_result)
+{
+  urlprefetch_segment_t * p_seg = NULL;
+  bool failed = false;
+  bool probe_failed = false;
+  assert (ap_prefetch);
+  assert (ap_conn);
+
+  (void) tiz_mutex_lock (&(ap_prefetch->mutex));
+  if (!ap_prefetch->p_segments)
+    {
+      /* The probe failed before the headers were complete */
+      probe_failed = true;
+    }
+  else
+    {
+      const off_t seg_size = segment_size (ap_prefetch, ap_conn->segment);
+      p_seg = &(ap_prefetch->p_segments[ap_conn->segment]);
+      if ((seg_size >= 0 && (off_t) p_seg->filled == seg_size)
+          || (seg_size < 0 && CURLE_OK == a_result))
+        {
+          p_seg->state = ESegmentDone;
+          if (ap_prefetch->total < 0)
+            {
+              ap_prefetch->total = p_seg->filled;
+            }
+        }
+      else if (++(p_seg->retries) > URLPREFETCH_MAX_RETRIES)
+        {
+          failed = true;
+        }
+      else
+        {
+          TIZ_LOG (TIZ_PRIORITY_NOTICE, "Retrying segment [%lu] (%s)",
+                   (unsigned long) ap_conn->segment,
+                   curl_easy_strerror (a_result));
+          p_seg->state = ESegmentPending;
+        }
+    }
+  (void) tiz_mutex_unlock (&(ap_prefetch->mutex));
+
+  stop_conn (ap_prefetch, ap_conn);
+
+  if (probe_failed)
+    {
+      failed = (++(ap_prefetch->probe_retries) > URLPREFETCH_MAX_RETRIES
+                || !start_conn (ap_prefetch, ap_conn, 0, true));
+    }
+
+  if (failed)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Download of [%s] failed (%s)",
+               ap_prefetch->p_url, curl_easy_strerror (a_result));
+      (void) tiz_mutex_lock (&(ap_prefetch->mutex));
+      ap_prefetch->failed = true;
+      ap_prefetch->reader_waiting = true;
+      (void) tiz_mutex_unlock (&(ap_prefetch->mutex));
+    }
+  notify_if_needed (ap_prefetch);
+}
+
+/* Wake the thread if it is waiting for the reader to move. To be called
+ * with the mutex locked. */
+static void
+kick_thread (tiz_urlprefetch_t * ap_prefetch)
+{
+  assert (ap_prefetch);
+  if (ap_prefetch->idle)
+    {
+      ap_prefetch->idle = false;
+      (void) tiz_cond_signal (&(ap_prefetch->cond));
+    }
+}
+
+/* curl_multi_wait returns at once when no transfer is active, e.g. when the
+ * window ahead of the reader is complete. Wait for the reader instead. */
+static void
+wait_for_work (tiz_urlprefetch_t * ap_prefetch, const int a_running)
+{
+  assert (ap_prefetch);
+  if (a_running > 0)
+    {
+      (void) curl_multi_wait (ap_prefetch->p_multi, NULL, 0,
+                              URLPREFETCH_WAIT_MS, NULL);
+    }
+  else
+    {
+      (void) tiz_mutex_lock (&(ap_prefetch->mutex));
+      if (!ap_prefetch->stop)
+        {
+          ap_prefetch->idle = true;
+          (void) tiz_cond_timedwait (&(ap_prefetch->cond),
+                                     &(ap_prefetch->mutex),
+                                     URLPREFETCH_IDLE_WAIT_MS);
+          ap_prefetch->idle = false;
+        }
+      (void) tiz_mutex_unlock (&(ap_prefetch->mutex));
+    }
+}
+
+static void *
+prefetch_thread_func (void * p_arg)
+{
+  tiz_urlprefetch_t * p_prefetch = p_arg;
+  bool done = false;
+  assert (p_prefetch);
+
+  (void) tiz_thread_setname (&(p_prefetch->thread),
+                             (const OMX_STRING) "tizurlprefetch");
+
+  if (!start_conn (p_prefetch, &(p_prefetch->conns[0]), 0, true))
+    {
+      (void) tiz_mutex_lock (&(p_prefetch->mutex));
+      p_prefetch->failed = true;
+      p_prefetch->reader_waiting = true;
+      (void) tiz_mutex_unlock (&(p_prefetch->mutex));
+      notify_if_needed (p_prefetch);
+      return NULL;
+    }
+
+  while (!done)
+    {
+      int running = 0;
+      int msgs_left = 0;
+      CURLMsg * p_msg = NULL;
+
+      schedule_segments (p_prefetch);
+      (void) curl_multi_perform (p_prefetch->p_multi, &running);
+      while ((p_msg = curl_multi_info_read (p_prefetch->p_multi, &msgs_left)))
+        {
+          if (CURLMSG_DONE == p_msg->msg)
+            {
+              urlprefetch_conn_t * p_conn = NULL;
+              (void) curl_easy_getinfo (p_msg->easy_handle, CURLINFO_PRIVATE,
+                                        &p_conn);
+              assert (p_conn);
+              on_conn_done (p_prefetch, p_conn, p_msg->data.result);
+            }
+        }
+
+      (void) tiz_mutex_lock (&(p_prefetch->mutex));
+      done = (p_prefetch->stop || p_prefetch->failed
+              || all_segments_done (p_prefetch));
+      (void) tiz_mutex_unlock (&(p_prefetch->mutex));
+
+      if (!done)
+        {
+          wait_for_work (p_prefetch, running);
+        }
+    }
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "Prefetch thread of [%s] exiting",
+           p_prefetch->p_url);
+  return NULL;
+}
+
+OMX_ERRORTYPE
+tiz_urlprefetch_init (tiz_urlprefetch_ptr_t * app_prefetch,
+                      const char * ap_url, const char * ap_user_agent,
+                      void * ap_curl_share, const int a_connections,
+                      tiz_urlprefetch_notify_f apf_notify, void * ap_arg)
+{
+  tiz_urlprefetch_t * p_prefetch = NULL;
+
+  assert (app_prefetch);
+  assert (ap_url);
+  assert (apf_notify);
+
+  tiz_check_null_ret_oom (
+    (p_prefetch = tiz_mem_calloc (1, sizeof (tiz_urlprefetch_t))));
+
+  p_prefetch->fd = -1;
+  p_prefetch->nconns
+    = MAX (1, MIN (a_connections, URLPREFETCH_MAX_CONNECTIONS));
+  p_prefetch->p_curl_share = ap_curl_share;
+  p_prefetch->pf_notify = apf_notify;
+  p_prefetch->p_arg = ap_arg;
+  p_prefetch->content_length = -1;
+  p_prefetch->total = -1;
+
+  /* The temporary file is unlinked already; the ranges not yet downloaded
+   * are holes */
+  if (!(p_prefetch->p_url = strdup (ap_url))
+      || !(p_prefetch->p_user_agent = strdup (ap_user_agent ? ap_user_agent
+                                                            : "tizonia"))
+      || OMX_ErrorNone != tiz_mutex_init (&(p_prefetch->mutex))
+      || OMX_ErrorNone != tiz_cond_init (&(p_prefetch->cond))
+      || OMX_ErrorNone != tiz_buffer_init (&(p_prefetch->p_headers), 1024)
+      || !(p_prefetch->p_file = tmpfile ())
+      || !(p_prefetch->p_multi = curl_multi_init ()))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to set up the prefetch of [%s]",
+               ap_url);
+      tiz_urlprefetch_destroy (p_prefetch);
+      return OMX_ErrorInsufficientResources;
+    }
+  p_prefetch->fd = fileno (p_prefetch->p_file);
+
+  if (OMX_ErrorNone
+      != tiz_thread_create (&(p_prefetch->thread), 0, 0, prefetch_thread_func,
+                            p_prefetch))
+    {
+      tiz_urlprefetch_destroy (p_prefetch);
+      return OMX_ErrorInsufficientResources;
+    }
+  p_prefetch->thread_started = true;
+
+  *app_prefetch = p_prefetch;
+  return OMX_ErrorNone;
+}
+
+void
+tiz_urlprefetch_destroy (tiz_urlprefetch_t * ap_prefetch)
+{
+  if (ap_prefetch)
+    {
+      int i = 0;
+      if (ap_prefetch->thread_started)
+        {
+          void * p_result = NULL;
+          (void) tiz_mutex_lock (&(ap_prefetch->mutex));
+          ap_prefetch->stop = true;
+          kick_thread (ap_prefetch);
+          (void) tiz_mutex_unlock (&(ap_prefetch->mutex));
+          (void) tiz_thread_join (&(ap_prefetch->thread), &p_result);
+        }
+      for (i = 0; i < URLPREFETCH_MAX_CONNECTIONS; ++i)
+        {
+          stop_conn (ap_prefetch, &(ap_prefetch->conns[i]));
+        }
+      if (ap_prefetch->p_multi)
+        {
+          (void) curl_multi_cleanup (ap_prefetch->p_multi);
+        }
+      if (ap_prefetch->p_file)
+        {
+          (void) fclose (ap_prefetch->p_file);
+        }
+      tiz_buffer_destroy (ap_prefetch->p_headers);
+      if (ap_prefetch->cond)
+        {
+          (void) tiz_cond_destroy (&(ap_prefetch->cond));
+        }
+      if (ap_prefetch->mutex)
+        {
+          (void) tiz_mutex_destroy (&(ap_prefetch->mutex));
+        }
+      tiz_mem_free (ap_prefetch->p_segments);
+      free (ap_prefetch->p_user_agent);
+      free (ap_prefetch->p_url);
+      tiz_mem_free (ap_prefetch);
+    }
+}
+
+const char *
+tiz_urlprefetch_headers (tiz_urlprefetch_t * ap_prefetch, size_t * ap_nbytes)
+{
+  const char * p_headers = NULL;
+  assert (ap_prefetch);
+  assert (ap_nbytes);
+
+  (void) tiz_mutex_lock (&(ap_prefetch->mutex));
+  if (ap_prefetch->headers_ready)
+    {
+      /* The headers don't change once they are ready */
+      p_headers = tiz_buffer_get (ap_prefetch->p_headers);
+      *ap_nbytes = tiz_buffer_available (ap_prefetch->p_headers);
+    }
+  else
+    {
+      ap_prefetch->reader_waiting = true;
+      errno = ap_prefetch->failed ? EIO : EAGAIN;
+    }
+  (void) tiz_mutex_unlock (&(ap_prefetch->mutex));
+  return p_headers;
+}
+
+ssize_t
+tiz_urlprefetch_read (tiz_urlprefetch_t * ap_prefetch, void * ap_data,
+                      const size_t a_nbytes)
+{
+  off_t pos = 0;
+  off_t avail = 0;
+  ssize_t nread = 0;
+  size_t seg = 0;
+  urlprefetch_segment_t * p_seg = NULL;
+
+  assert (ap_prefetch);
+  assert (ap_data);
+
+  (void) tiz_mutex_lock (&(ap_prefetch->mutex));
+  pos = ap_prefetch->read_pos;
+  if (ap_prefetch->headers_ready && ap_prefetch->total >= 0
+      && pos >= ap_prefetch->total)
+    {
+      (void) tiz_mutex_unlock (&(ap_prefetch->mutex));
+      return 0;
+    }
+
+  if (ap_prefetch->headers_ready)
+    {
+      seg = segment_at (ap_prefetch, pos);
+      p_seg = &(ap_prefetch->p_segments[seg]);
+      avail = segment_start (ap_prefetch, seg) + (off_t) p_seg->filled - pos;
+    }
+
+  /* Whatever was downloaded before a failure is still served; the error is
+     only reported once the reader gets to data that will never arrive */
+  if (avail <= 0)
+    {
+      ap_prefetch->reader_waiting = !ap_prefetch->failed;
+      errno = ap_prefetch->failed ? EIO : EAGAIN;
+      (void) tiz_mutex_unlock (&(ap_prefetch->mutex));
+      return -1;
+    }
+  (void) tiz_mutex_unlock (&(ap_prefetch->mutex));
+
+  /* Stored data doesn't change, so it is read without the lock */
+  do
+    {
+      nread = pread (ap_prefetch->fd, ap_data, MIN ((off_t) a_nbytes, avail),
+                     pos);
+    }
+  while (nread < 0 && errno == EINTR);
+
+  if (nread <= 0)
+    {
+      errno = EIO;
+      return -1;
+    }
+
+  (void) tiz_mutex_lock (&(ap_prefetch->mutex));
+  ap_prefetch->read_pos = pos + nread;
+  kick_thread (ap_prefetch);
+  (void) tiz_mutex_unlock (&(ap_prefetch->mutex));
+  return nread;
+}
+
+void
+tiz_urlprefetch_seek (tiz_urlprefetch_t * ap_prefetch, const off_t a_offset)
+{
+  assert (ap_prefetch);
+  (void) tiz_mutex_lock (&(ap_prefetch->mutex));
+  ap_prefetch->read_pos = MAX (0, a_offset);
+  kick_thread (ap_prefetch);
+  (void) tiz_mutex_unlock (&(ap_prefetch->mutex));
+}
+
+void
+tiz_urlprefetch_unread (tiz_urlprefetch_t * ap_prefetch,
+                        const size_t a_nbytes)
+{
+  assert (ap_prefetch);
+  (void) tiz_mutex_lock (&(ap_prefetch->mutex));
+  ap_prefetch->read_pos -= MIN ((off_t) a_nbytes, ap_prefetch->read_pos);
+  kick_thread (ap_prefetch);
+  (void) tiz_mutex_unlock (&(ap_prefetch->mutex));
+}
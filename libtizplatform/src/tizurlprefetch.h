@@ -0,0 +1,135 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizurlprefetch.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Parallel byte-range download of a URL
+ *
+ * The resource is split in fixed-size segments which are downloaded with
+ * several concurrent Range requests into a sparse temporary file. Segments
+ * are requested in order starting at the read position, so the data needed
+ * next always comes first. Servers that ignore Range requests are downloaded
+ * sequentially over a single connection.
+ *
+ * The downloads run on a thread owned by the prefetcher; the reader is told
+ * through a notification callback when it has something new to look at.
+ */
+
+#ifndef TIZURLPREFETCH_H
+#define TIZURLPREFETCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+/**
+ * Parallel range downloader opaque handle.
+ */
+typedef struct tiz_urlprefetch tiz_urlprefetch_t;
+typedef /*@null@ */ tiz_urlprefetch_t * tiz_urlprefetch_ptr_t;
+
+/**
+ * Called from the prefetcher's thread when a read or a headers request that
+ * previously found nothing is now likely to succeed, or when the download
+ * has failed.
+ */
+typedef void (*tiz_urlprefetch_notify_f) (void * ap_arg);
+
+/**
+ * Start downloading a URL.
+ *
+ * @param app_prefetch A reference to the prefetcher that will be created.
+ *
+ * @param ap_url The URL.
+ *
+ * @param ap_user_agent The user agent string.
+ *
+ * @param ap_curl_share A curl share handle (CURLSH) to use with the
+ * connections, or NULL.
+ *
+ * @param a_connections The maximum number of concurrent Range requests.
+ *
+ * @param apf_notify The notification callback.
+ *
+ * @param ap_arg The argument of the notification callback.
+ *
+ * @return OMX_ErrorNone if success, OMX_ErrorInsufficientResources otherwise.
+ */
+OMX_ERRORTYPE
+tiz_urlprefetch_init (tiz_urlprefetch_ptr_t * app_prefetch,
+                      const char * ap_url, const char * ap_user_agent,
+                      void * ap_curl_share, const int a_connections,
+                      tiz_urlprefetch_notify_f apf_notify, void * ap_arg);
+
+/**
+ * Stop the downloads and remove the temporary file.
+ */
+void
+tiz_urlprefetch_destroy (tiz_urlprefetch_t * ap_prefetch);
+
+/**
+ * The headers of the resource, one line after another, each one terminated
+ * by CRLF. The Content-Length header holds the size of the whole resource
+ * (when known) rather than the size of the first range.
+ *
+ * @return The headers, or NULL. errno is EAGAIN when they haven't arrived
+ * yet, or EIO if the download has failed.
+ */
+const char *
+tiz_urlprefetch_headers (tiz_urlprefetch_t * ap_prefetch, size_t * ap_nbytes);
+
+/**
+ * Read data at the current position.
+ *
+ * @return The number of bytes read, 0 at the end of the resource, or -1.
+ * errno is EAGAIN when the data at the current position hasn't been
+ * downloaded yet, or EIO if the download has failed before getting to it.
+ * Data that was already downloaded is still returned after a failure.
+ */
+ssize_t
+tiz_urlprefetch_read (tiz_urlprefetch_t * ap_prefetch, void * ap_data,
+                      const size_t a_nbytes);
+
+/**
+ * Move the read position. Segments are fetched in order from the new
+ * position onwards; the ones already downloaded are read straight away.
+ */
+void
+tiz_urlprefetch_seek (tiz_urlprefetch_t * ap_prefetch, const off_t a_offset);
+
+/**
+ * Step back so that the last a_nbytes bytes are read again.
+ */
+void
+tiz_urlprefetch_unread (tiz_urlprefetch_t * ap_prefetch,
+                        const size_t a_nbytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZURLPREFETCH_H */
@@ -32,6 +32,7 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -40,12 +41,24 @@
 #include <tizplatform.h>
 
 #include "tizurltransfer.h"
+#include "tizurlcache.h"
+#include "tizurlprefetch.h"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
 #undef TIZ_LOG_CATEGORY_NAME
 #define TIZ_LOG_CATEGORY_NAME "tiz.platform.urltrans"
 #endif
 
+/* Maximum number of idle easy handles kept for reuse */
+#define URLTRANS_EASY_POOL_SIZE 4
+/* Size of the reads from a track cache entry */
+#define URLTRANS_CACHE_CHUNK_SIZE 16384
+
+/* Sharing of the connection cache was added in libcurl 7.57.0 */
+#if LIBCURL_VERSION_NUM >= 0x073900
+#define URLTRANS_SHARE_CONNECTIONS
+#endif
+
 /* forward declarations */
 static void
 destroy_curl_resources (tiz_urltrans_t * ap_trans);
@@ -65,6 +78,10 @@ static inline OMX_ERRORTYPE
 stop_io_watcher (tiz_urltrans_t * ap_trans);
 static void
 report_connection_lost_event (tiz_urltrans_t * ap_trans);
+static size_t
+shared_header_cback (void * ptr, size_t size, size_t nmemb, void * userdata);
+static size_t
+shared_write_cback (void * ptr, size_t size, size_t nmemb, void * userdata);
 
 /* These macros assume the existence of an "ap_trans" local variable */
 #define bail_on_curl_error(expr)                                           \
@@ -150,6 +167,48 @@ report_connection_lost_event (tiz_urltrans_t * ap_trans);
     }                                                                          \
   while (0)
 
+/* Process-wide curl state. The DNS cache, the TLS session cache and (with
+ * newer libcurls) the connection cache are shared between all the transfers
+ * in the process, so that consecutive tracks from the same server don't need
+ * a new handshake. */
+typedef struct urltrans_curl_share urltrans_curl_share_t;
+struct urltrans_curl_share
+{
+  CURLSH * p_share;
+  tiz_mutex_t locks[CURL_LOCK_DATA_LAST];
+  tiz_mutex_t pool_mutex;
+  CURL * pool[URLTRANS_EASY_POOL_SIZE];
+  int pool_count;
+};
+
+static pthread_once_t g_curl_share_once = PTHREAD_ONCE_INIT;
+static urltrans_curl_share_t * gp_curl_share = NULL;
+
+/* Process-wide curl multi handle, for the transfers that opt in with
+ * tiz_urltrans_use_shared_multi. Its sockets and its timer are watched
+ * directly on the event loop thread. The mutex serialises every use of the
+ * multi handle, whichever thread it comes from. */
+typedef struct urltrans_curl_multi urltrans_curl_multi_t;
+struct urltrans_curl_multi
+{
+  CURLM * p_multi;
+  tiz_mutex_t mutex;
+  tiz_event_timer_t * p_ev_timer;
+  uint32_t watcher_id;
+};
+
+/* The io watcher of a socket in the shared multi handle (assigned to the
+ * socket with curl_multi_assign) */
+typedef struct urltrans_curl_socket urltrans_curl_socket_t;
+struct urltrans_curl_socket
+{
+  tiz_event_io_t * p_ev_io;
+  int action;
+};
+
+static pthread_once_t g_curl_multi_once = PTHREAD_ONCE_INIT;
+static urltrans_curl_multi_t * gp_curl_multi = NULL;
+
 typedef enum httpsrc_curl_state_id httpsrc_curl_state_id_t;
 enum httpsrc_curl_state_id
 {
@@ -198,6 +257,10 @@ struct tiz_urltrans
   tiz_buffer_t * p_store_;
   int internal_buffer_size_;
   int internal_buffer_size_initial_;
+  /* Underrun accounting. The store is 'drained' while the client takes the
+   * data as fast as it arrives */
+  bool drained_;
+  OMX_U32 underruns_;
   CURL * p_curl_;        /* curl easy */
   CURLM * p_curl_multi_; /* curl multi */
   struct curl_slist * p_http_ok_aliases_;
@@ -206,6 +269,30 @@ struct tiz_urltrans
   unsigned int curl_version_;
   char curl_err[CURL_ERROR_SIZE];
   bool handshake_error_found;
+  /* Shared multi handle mode. The store, the headers and the flags below are
+   * written by the curl callbacks, which may run on any thread, and so they
+   * are protected by the shared mutex */
+  bool shared_multi_;
+  tiz_urltrans_notify_f pf_notify_;
+  tiz_mutex_t shared_mutex_;
+  tiz_buffer_t * p_headers_;
+  int unseen_bytes_;
+  bool shared_paused_;
+  bool shared_done_;
+  bool notify_pending_;
+  CURLcode shared_result_;
+  /* Track cache. While the reader is open, the transfer is being served from
+   * disk instead of from the network */
+  char * p_cache_key_;
+  tiz_urlcache_writer_t * p_cache_writer_;
+  tiz_urlcache_reader_t * p_cache_reader_;
+  bool cache_paused_;
+  /* Parallel range download. When a transfer is started with the prefetcher
+   * enabled, it is served from the prefetcher in the same way as from a
+   * track cache entry */
+  int prefetch_connections_;
+  tiz_urlprefetch_t * p_prefetch_;
+  bool prefetch_headers_sent_;
 };
 
 /*@observer@*/ const char *
@@ -255,7 +342,9 @@ httpsrc_curl_state_to_str (const httpsrc_curl_state_id_t a_state)
         "ct [%s] rt [%s]",                                                    \
         start_or_end_str, httpsrc_curl_state_to_str (ap_trans->curl_state_),  \
         ap_trans->sockfd_,                                                    \
-        (ap_trans->p_store_ ? tiz_buffer_available (ap_trans->p_store_) : 0), \
+        ((ap_trans->p_store_ && !ap_trans->shared_multi_)                    \
+           ? tiz_buffer_available (ap_trans->p_store_)                        \
+           : 0),                                                              \
         ap_trans->curl_timeout_, (ap_trans->awaiting_io_ev_ ? "Y" : "N"),     \
         (ap_trans->awaiting_curl_timer_ev_ ? "Y" : "N"),                      \
         (ap_trans->awaiting_reconnect_timer_ev_ ? "Y" : "N"));                \
@@ -265,7 +354,9 @@ httpsrc_curl_state_to_str (const httpsrc_curl_state_id_t a_state)
 #define ASSERT_ASYNC_EVENTS(ap_trans)                       \
   do                                                        \
     {                                                       \
-      if (is_transfer_running (ap_trans))                   \
+      if (!ap_trans->shared_multi_                          \
+          && !is_served_locally (ap_trans)                  \
+          && is_transfer_running (ap_trans))                \
         {                                                   \
           assert (ap_trans->awaiting_curl_timer_ev_         \
                   || ap_trans->awaiting_reconnect_timer_ev_ \
@@ -303,6 +394,13 @@ is_transfer_running (tiz_urltrans_t * ap_trans)
   return (ECurlStateTransfering == ap_trans->curl_state_);
 }
 
+static inline bool
+is_served_locally (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  return (ap_trans->p_cache_reader_ || ap_trans->p_prefetch_);
+}
+
 static inline bool
 is_passed_buffer_high_watermark (tiz_urltrans_t * ap_trans)
 {
@@ -311,19 +409,398 @@ is_passed_buffer_high_watermark (tiz_urltrans_t * ap_trans)
           >= ap_trans->internal_buffer_size_initial_);
 }
 
+static void
+curl_share_lock_cback (CURL * ap_curl, curl_lock_data a_data,
+                       curl_lock_access a_access, void * ap_userp)
+{
+  urltrans_curl_share_t * p_share = ap_userp;
+  assert (p_share);
+  assert (a_data < CURL_LOCK_DATA_LAST);
+  (void) tiz_mutex_lock (&(p_share->locks[a_data]));
+}
+
+static void
+curl_share_unlock_cback (CURL * ap_curl, curl_lock_data a_data,
+                         void * ap_userp)
+{
+  urltrans_curl_share_t * p_share = ap_userp;
+  assert (p_share);
+  assert (a_data < CURL_LOCK_DATA_LAST);
+  (void) tiz_mutex_unlock (&(p_share->locks[a_data]));
+}
+
+static void
+init_curl_share (void)
+{
+  urltrans_curl_share_t * p_share = NULL;
+  int i = 0;
+
+  /* This is only released when the process exits. Its curl_global_init
+   * reference keeps libcurl initialised for as long as the caches live */
+  if (CURLE_OK != curl_global_init (CURL_GLOBAL_ALL)
+      || !(p_share = calloc (1, sizeof (urltrans_curl_share_t))))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to alloc the curl share");
+      return;
+    }
+
+  for (i = 0; i < CURL_LOCK_DATA_LAST; ++i)
+    {
+      if (OMX_ErrorNone != tiz_mutex_init (&(p_share->locks[i])))
+        {
+          return;
+        }
+    }
+  if (OMX_ErrorNone != tiz_mutex_init (&(p_share->pool_mutex)))
+    {
+      return;
+    }
+
+  if ((p_share->p_share = curl_share_init ()))
+    {
+      (void) curl_share_setopt (p_share->p_share, CURLSHOPT_LOCKFUNC,
+                                curl_share_lock_cback);
+      (void) curl_share_setopt (p_share->p_share, CURLSHOPT_UNLOCKFUNC,
+                                curl_share_unlock_cback);
+      (void) curl_share_setopt (p_share->p_share, CURLSHOPT_USERDATA,
+                                p_share);
+      (void) curl_share_setopt (p_share->p_share, CURLSHOPT_SHARE,
+                                CURL_LOCK_DATA_DNS);
+      (void) curl_share_setopt (p_share->p_share, CURLSHOPT_SHARE,
+                                CURL_LOCK_DATA_SSL_SESSION);
+#ifdef URLTRANS_SHARE_CONNECTIONS
+      (void) curl_share_setopt (p_share->p_share, CURLSHOPT_SHARE,
+                                CURL_LOCK_DATA_CONNECT);
+#endif
+    }
+
+  gp_curl_share = p_share;
+}
+
+static urltrans_curl_share_t *
+get_curl_share (void)
+{
+  (void) pthread_once (&g_curl_share_once, init_curl_share);
+  return gp_curl_share;
+}
+
+static CURL *
+acquire_curl_easy (void)
+{
+  urltrans_curl_share_t * p_share = get_curl_share ();
+  CURL * p_curl = NULL;
+
+  if (p_share)
+    {
+      (void) tiz_mutex_lock (&(p_share->pool_mutex));
+      if (p_share->pool_count > 0)
+        {
+          p_curl = p_share->pool[--(p_share->pool_count)];
+        }
+      (void) tiz_mutex_unlock (&(p_share->pool_mutex));
+    }
+
+  return p_curl ? p_curl : curl_easy_init ();
+}
+
+static void
+release_curl_easy (CURL * ap_curl)
+{
+  urltrans_curl_share_t * p_share = get_curl_share ();
+
+  if (!ap_curl)
+    {
+      return;
+    }
+
+  if (p_share)
+    {
+      /* The handle keeps its caches across a reset; only the options go */
+      curl_easy_reset (ap_curl);
+      (void) tiz_mutex_lock (&(p_share->pool_mutex));
+      if (p_share->pool_count < URLTRANS_EASY_POOL_SIZE)
+        {
+          p_share->pool[(p_share->pool_count)++] = ap_curl;
+          ap_curl = NULL;
+        }
+      (void) tiz_mutex_unlock (&(p_share->pool_mutex));
+    }
+
+  if (ap_curl)
+    {
+      curl_easy_cleanup (ap_curl);
+    }
+}
+
+static void
+shared_multi_check_completions (urltrans_curl_multi_t * ap_multi);
+
+static inline void
+lock_multi (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  if (ap_trans->shared_multi_)
+    {
+      (void) tiz_mutex_lock (&(gp_curl_multi->mutex));
+    }
+}
+
+static inline void
+unlock_multi (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  if (ap_trans->shared_multi_)
+    {
+      (void) tiz_mutex_unlock (&(gp_curl_multi->mutex));
+    }
+}
+
+static inline void
+lock_store (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  if (ap_trans->shared_multi_)
+    {
+      (void) tiz_mutex_lock (&(ap_trans->shared_mutex_));
+    }
+}
+
+static inline void
+unlock_store (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  if (ap_trans->shared_multi_)
+    {
+      (void) tiz_mutex_unlock (&(ap_trans->shared_mutex_));
+    }
+}
+
+/* NOTE: The shared_multi_* io and timer callbacks run on the event loop
+ * thread */
+static void
+shared_multi_io_cback (void * ap_arg0, tiz_event_io_t * ap_ev_io,
+                       void * ap_arg1, const uint32_t a_id, int a_fd,
+                       int a_events)
+{
+  urltrans_curl_multi_t * p_multi = ap_arg0;
+  int running_handles = 0;
+  int curl_ev_bitmask = 0;
+  assert (p_multi);
+
+  if (a_events & TIZ_EVENT_READ)
+    {
+      curl_ev_bitmask |= CURL_CSELECT_IN;
+    }
+  if (a_events & TIZ_EVENT_WRITE)
+    {
+      curl_ev_bitmask |= CURL_CSELECT_OUT;
+    }
+
+  (void) tiz_mutex_lock (&(p_multi->mutex));
+  (void) curl_multi_socket_action (p_multi->p_multi, a_fd, curl_ev_bitmask,
+                                   &running_handles);
+  shared_multi_check_completions (p_multi);
+  (void) tiz_mutex_unlock (&(p_multi->mutex));
+}
+
+static void
+shared_multi_timer_cback (void * ap_arg0, tiz_event_timer_t * ap_ev_timer,
+                          void * ap_arg1, const uint32_t a_id)
+{
+  urltrans_curl_multi_t * p_multi = ap_arg0;
+  int running_handles = 0;
+  assert (p_multi);
+
+  (void) tiz_mutex_lock (&(p_multi->mutex));
+  /* Timers that have been replaced may still fire once */
+  if (ap_ev_timer == p_multi->p_ev_timer)
+    {
+      (void) curl_multi_socket_action (p_multi->p_multi, CURL_SOCKET_TIMEOUT,
+                                       0, &running_handles);
+      shared_multi_check_completions (p_multi);
+    }
+  (void) tiz_mutex_unlock (&(p_multi->mutex));
+}
+
+/* NOTE: The shared_multi_*_cback functions below are called by libcurl with
+ * the shared mutex held */
+static int
+shared_multi_socket_cback (CURL * easy, curl_socket_t s, int action,
+                           void * userp, void * socketp)
+{
+  urltrans_curl_multi_t * p_multi = userp;
+  urltrans_curl_socket_t * p_sock = socketp;
+  assert (p_multi);
+
+  TIZ_LOG (TIZ_PRIORITY_DEBUG, "shared socket [%d] action [%d]", s, action);
+
+  if (CURL_POLL_REMOVE == action || CURL_POLL_NONE == action)
+    {
+      if (p_sock)
+        {
+          if (p_sock->p_ev_io)
+            {
+              tiz_event_io_destroy (p_sock->p_ev_io);
+            }
+          free (p_sock);
+          (void) curl_multi_assign (p_multi->p_multi, s, NULL);
+        }
+      return 0;
+    }
+
+  if (!p_sock)
+    {
+      if (!(p_sock = calloc (1, sizeof (urltrans_curl_socket_t))))
+        {
+          return -1;
+        }
+      (void) curl_multi_assign (p_multi->p_multi, s, p_sock);
+    }
+
+  if (action != p_sock->action)
+    {
+      /* Watchers can't be modified while active; replace it instead */
+      if (p_sock->p_ev_io)
+        {
+          tiz_event_io_destroy (p_sock->p_ev_io);
+          p_sock->p_ev_io = NULL;
+        }
+      p_sock->action = action;
+      if (OMX_ErrorNone
+          == tiz_event_io_init (&(p_sock->p_ev_io), p_multi,
+                                shared_multi_io_cback, NULL))
+        {
+          tiz_event_io_set (p_sock->p_ev_io, s,
+                            (CURL_POLL_IN == action
+                               ? TIZ_EVENT_READ
+                               : CURL_POLL_OUT == action
+                                   ? TIZ_EVENT_WRITE
+                                   : TIZ_EVENT_READ_OR_WRITE),
+                            false);
+          (void) tiz_event_io_start (p_sock->p_ev_io, ++(p_multi->watcher_id));
+        }
+    }
+  return 0;
+}
+
+static int
+shared_multi_timer_cback_curl (CURLM * multi, long timeout_ms, void * userp)
+{
+  urltrans_curl_multi_t * p_multi = userp;
+  assert (p_multi);
+
+  if (p_multi->p_ev_timer)
+    {
+      tiz_event_timer_destroy (p_multi->p_ev_timer);
+      p_multi->p_ev_timer = NULL;
+    }
+
+  if (timeout_ms >= 0
+      && OMX_ErrorNone
+           == tiz_event_timer_init (&(p_multi->p_ev_timer), p_multi,
+                                    shared_multi_timer_cback, NULL))
+    {
+      tiz_event_timer_set (p_multi->p_ev_timer,
+                           ((double) timeout_ms / (double) 1000), 0.);
+      (void) tiz_event_timer_start (p_multi->p_ev_timer,
+                                    ++(p_multi->watcher_id));
+    }
+  return 0;
+}
+
+static void
+notify_owner (tiz_urltrans_t * ap_trans)
+{
+  bool notify = false;
+  assert (ap_trans);
+  assert (ap_trans->pf_notify_);
+
+  /* One notification at a time is enough; the owner picks up everything
+   * that is pending when it gets to it */
+  (void) tiz_mutex_lock (&(ap_trans->shared_mutex_));
+  if (!ap_trans->notify_pending_)
+    {
+      ap_trans->notify_pending_ = notify = true;
+    }
+  (void) tiz_mutex_unlock (&(ap_trans->shared_mutex_));
+
+  if (notify)
+    {
+      ap_trans->pf_notify_ (ap_trans->p_parent_);
+    }
+}
+
+static void
+shared_multi_check_completions (urltrans_curl_multi_t * ap_multi)
+{
+  CURLMsg * p_msg = NULL;
+  int msgs_left = 0;
+  assert (ap_multi);
+
+  while ((p_msg = curl_multi_info_read (ap_multi->p_multi, &msgs_left)))
+    {
+      if (CURLMSG_DONE == p_msg->msg)
+        {
+          CURL * p_curl = p_msg->easy_handle;
+          tiz_urltrans_t * p_trans = NULL;
+          (void) curl_easy_getinfo (p_curl, CURLINFO_PRIVATE, &p_trans);
+          /* Done with this easy handle for now; this also makes its
+           * connection available to the other transfers */
+          (void) curl_multi_remove_handle (ap_multi->p_multi, p_curl);
+          if (p_trans)
+            {
+              (void) tiz_mutex_lock (&(p_trans->shared_mutex_));
+              p_trans->shared_done_ = true;
+              p_trans->shared_result_ = p_msg->data.result;
+              (void) tiz_mutex_unlock (&(p_trans->shared_mutex_));
+              notify_owner (p_trans);
+            }
+        }
+    }
+}
+
+static void
+init_curl_multi (void)
+{
+  urltrans_curl_multi_t * p_multi = NULL;
+
+  /* Like the share, this lives until the process exits */
+  (void) get_curl_share ();
+  if (!(p_multi = calloc (1, sizeof (urltrans_curl_multi_t)))
+      || OMX_ErrorNone != tiz_mutex_init (&(p_multi->mutex))
+      || !(p_multi->p_multi = curl_multi_init ()))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to alloc the shared curl multi");
+      return;
+    }
+
+  (void) curl_multi_setopt (p_multi->p_multi, CURLMOPT_SOCKETFUNCTION,
+                            shared_multi_socket_cback);
+  (void) curl_multi_setopt (p_multi->p_multi, CURLMOPT_SOCKETDATA, p_multi);
+  (void) curl_multi_setopt (p_multi->p_multi, CURLMOPT_TIMERFUNCTION,
+                            shared_multi_timer_cback_curl);
+  (void) curl_multi_setopt (p_multi->p_multi, CURLMOPT_TIMERDATA, p_multi);
+
+  gp_curl_multi = p_multi;
+}
+
+static urltrans_curl_multi_t *
+get_curl_multi (void)
+{
+  (void) pthread_once (&g_curl_multi_once, init_curl_multi);
+  return gp_curl_multi;
+}
+
+/* Options that stay the same for the lifetime of the transfer object. These
+ * are set once, when the easy handle is taken from the pool. */
 static OMX_ERRORTYPE
-start_curl (tiz_urltrans_t * ap_trans)
+configure_curl (tiz_urltrans_t * ap_trans)
 {
   OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
-
-  TIZ_LOG (TIZ_PRIORITY_TRACE, "starting curl : STATE [%s]",
-           httpsrc_curl_state_to_str (ap_trans->curl_state_));
+  urltrans_curl_share_t * p_share = get_curl_share ();
 
   assert (ap_trans->p_curl_);
   assert (ap_trans->p_curl_multi_);
-  assert (is_transfer_stopped (ap_trans) || is_transfer_paused (ap_trans));
-
-  set_curl_state (ap_trans, ECurlStateTransfering);
 
   /* associate the processor with the curl handle */
   bail_on_curl_error (
@@ -353,19 +830,26 @@ start_curl (tiz_urltrans_t * ap_trans)
   bail_on_curl_error (
     curl_easy_setopt (ap_trans->p_curl_, CURLOPT_NOPROGRESS, 1));
 
-  bail_on_curl_error (curl_easy_setopt (
-    ap_trans->p_curl_, CURLOPT_CONNECTTIMEOUT, ap_trans->connect_timeout_));
   bail_on_curl_error (
     curl_easy_setopt (ap_trans->p_curl_, CURLOPT_SSL_VERIFYHOST, 0));
   bail_on_curl_error (
     curl_easy_setopt (ap_trans->p_curl_, CURLOPT_SSL_VERIFYPEER, 0));
 
-  bail_on_curl_error (curl_easy_setopt (ap_trans->p_curl_, CURLOPT_URL,
-                                        ap_trans->p_uri_param_->contentURI));
-
   bail_on_curl_error (curl_easy_setopt (ap_trans->p_curl_, CURLOPT_HTTPHEADER,
                                         ap_trans->p_http_headers_));
 
+  /* Keep idle connections alive, so that the next track can reuse them */
+#if LIBCURL_VERSION_NUM >= 0x071900
+  bail_on_curl_error (
+    curl_easy_setopt (ap_trans->p_curl_, CURLOPT_TCP_KEEPALIVE, 1L));
+#endif
+
+  if (p_share && p_share->p_share)
+    {
+      bail_on_curl_error (
+        curl_easy_setopt (ap_trans->p_curl_, CURLOPT_SHARE, p_share->p_share));
+    }
+
   /* #ifdef _DEBUG */
   bail_on_curl_error (curl_easy_setopt (ap_trans->p_curl_, CURLOPT_VERBOSE, 1));
   bail_on_curl_error (
@@ -385,9 +869,43 @@ start_curl (tiz_urltrans_t * ap_trans)
     ap_trans->p_curl_multi_, CURLMOPT_TIMERFUNCTION, curl_timer_cback));
   bail_on_curl_multi_error (
     curl_multi_setopt (ap_trans->p_curl_multi_, CURLMOPT_TIMERDATA, ap_trans));
+
+  /* all ok */
+  rc = OMX_ErrorNone;
+
+end:
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+start_curl (tiz_urltrans_t * ap_trans)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "starting curl : STATE [%s]",
+           httpsrc_curl_state_to_str (ap_trans->curl_state_));
+
+  assert (ap_trans->p_curl_);
+  assert (ap_trans->p_curl_multi_);
+  assert (is_transfer_stopped (ap_trans) || is_transfer_paused (ap_trans));
+
+  set_curl_state (ap_trans, ECurlStateTransfering);
+
+  /* Everything else was set in configure_curl */
+  bail_on_curl_error (curl_easy_setopt (
+    ap_trans->p_curl_, CURLOPT_CONNECTTIMEOUT, ap_trans->connect_timeout_));
+  bail_on_curl_error (curl_easy_setopt (ap_trans->p_curl_, CURLOPT_URL,
+                                        ap_trans->p_uri_param_->contentURI));
+
   /* Add the easy handle to the multi */
-  bail_on_curl_multi_error (
-    curl_multi_add_handle (ap_trans->p_curl_multi_, ap_trans->p_curl_));
+  {
+    CURLMcode add_rc = CURLM_OK;
+    lock_multi (ap_trans);
+    add_rc = curl_multi_add_handle (ap_trans->p_curl_multi_, ap_trans->p_curl_);
+    unlock_multi (ap_trans);
+    bail_on_curl_multi_error (add_rc);
+  }
 
   /* all ok */
   rc = OMX_ErrorNone;
@@ -547,6 +1065,13 @@ kickstart_curl_socket (tiz_urltrans_t * ap_trans, int * ap_running_handles)
 {
   assert (ap_trans);
   assert (ap_running_handles);
+  if (ap_trans->shared_multi_)
+    {
+      /* The shared multi handle drives itself from the event loop; and its
+       * running handles count isn't this transfer's anyway */
+      *ap_running_handles = 1;
+      return OMX_ErrorNone;
+    }
   do
     {
       on_curl_multi_error_ret_omx_oom (curl_multi_socket_action (
@@ -562,7 +1087,23 @@ resume_curl (tiz_urltrans_t * ap_trans)
 {
   assert (ap_trans);
 
-  if (is_transfer_paused (ap_trans))
+  if (is_transfer_paused (ap_trans) && ap_trans->shared_multi_)
+    {
+      CURLcode pause_rc = CURLE_OK;
+      set_curl_state (ap_trans, ECurlStateTransfering);
+      lock_store (ap_trans);
+      ap_trans->shared_paused_ = false;
+      unlock_store (ap_trans);
+      /* Unpausing schedules a timeout on the shared multi handle, which
+       * then gets the transfer going again */
+      lock_multi (ap_trans);
+      pause_rc = curl_easy_pause (ap_trans->p_curl_, CURLPAUSE_CONT);
+      unlock_multi (ap_trans);
+      on_curl_error_ret_omx_oom (pause_rc);
+      /* Present whatever arrived while the transfer was paused */
+      notify_owner (ap_trans);
+    }
+  else if (is_transfer_paused (ap_trans))
     {
       int running_handles = 0;
 
@@ -607,13 +1148,34 @@ copy_to_omx_buffer (OMX_BUFFERHEADERTYPE * ap_hdr, void * ap_src,
   return n;
 }
 
+/* An underrun is counted each time the store runs dry after the initial
+   buffering, having held data back before */
+static void
+update_underrun_status (tiz_urltrans_t * ap_trans, const bool a_drained)
+{
+  assert (ap_trans);
+  if (0 == ap_trans->internal_buffer_size_initial_
+      && !is_served_locally (ap_trans))
+    {
+      if (a_drained && !ap_trans->drained_)
+        {
+          ap_trans->underruns_++;
+          TIZ_LOG (TIZ_PRIORITY_NOTICE, "Buffer underrun [%u]",
+                   ap_trans->underruns_);
+        }
+      ap_trans->drained_ = a_drained;
+    }
+}
+
 static OMX_ERRORTYPE
 send_from_internal_buffer (tiz_urltrans_t * p_trans)
 {
   OMX_BUFFERHEADERTYPE * p_out = NULL;
   int nbytes_available = 0;
+  bool delivered = false;
   assert (p_trans);
 
+  lock_store (p_trans);
   while (
     (nbytes_available = tiz_buffer_available (p_trans->p_store_)) > 0
     && (p_out = p_trans->buffer_cbacks_.pf_buf_emptied (p_trans->p_parent_))
@@ -628,7 +1190,13 @@ send_from_internal_buffer (tiz_urltrans_t * p_trans)
       p_trans->buffer_cbacks_.pf_buf_filled (p_out, p_trans->p_parent_);
       (void) tiz_buffer_advance (p_trans->p_store_, nbytes_copied);
       p_out = NULL;
+      delivered = true;
     }
+  if (nbytes_available > 0 || delivered)
+    {
+      update_underrun_status (p_trans, 0 == nbytes_available);
+    }
+  unlock_store (p_trans);
   return OMX_ErrorNone;
 }
 
@@ -637,6 +1205,47 @@ reset_initial_buffer_size (tiz_urltrans_t * ap_trans)
 {
   assert (ap_trans);
   ap_trans->internal_buffer_size_initial_ = ap_trans->internal_buffer_size_;
+  ap_trans->drained_ = true;
+}
+
+/* Whether the transfer that has just finished got the whole resource */
+static bool
+is_transfer_complete (tiz_urltrans_t * ap_trans)
+{
+  CURLMsg * p_msg = NULL;
+  int msgs_left = 0;
+  assert (ap_trans);
+
+  if (ap_trans->shared_multi_)
+    {
+      return (CURLE_OK == ap_trans->shared_result_);
+    }
+
+  while ((p_msg = curl_multi_info_read (ap_trans->p_curl_multi_, &msgs_left)))
+    {
+      if (CURLMSG_DONE == p_msg->msg && p_msg->easy_handle == ap_trans->p_curl_)
+        {
+          return (CURLE_OK == p_msg->data.result);
+        }
+    }
+  return false;
+}
+
+/* NOTE: With the shared multi handle, the writer is fed from curl's
+ * callbacks, so it is only touched with the store locked */
+static void
+close_cache_entries (tiz_urltrans_t * ap_trans, const bool a_commit)
+{
+  tiz_urlcache_writer_t * p_writer = NULL;
+  assert (ap_trans);
+  lock_store (ap_trans);
+  p_writer = ap_trans->p_cache_writer_;
+  ap_trans->p_cache_writer_ = NULL;
+  unlock_store (ap_trans);
+  tiz_urlcache_writer_close (p_writer, a_commit);
+  tiz_urlcache_reader_close (ap_trans->p_cache_reader_);
+  ap_trans->p_cache_reader_ = NULL;
+  ap_trans->cache_paused_ = false;
 }
 
 static void
@@ -644,6 +1253,11 @@ report_connection_lost_event (tiz_urltrans_t * ap_trans)
 {
   bool auto_reconnect = false;
   assert (ap_trans);
+  if (ap_trans->p_cache_writer_)
+    {
+      /* Only complete downloads make it into the cache */
+      close_cache_entries (ap_trans, is_transfer_complete (ap_trans));
+    }
   stop_curl_timer_watcher (ap_trans);
   assert (ap_trans->info_cbacks_.pf_connection_lost);
   set_curl_state (ap_trans, ECurlStateStopped);
@@ -677,6 +1291,10 @@ curl_header_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
   URLTRANS_LOG_CBACK_START (p_trans);
   stop_reconnect_timer_watcher (p_trans);
   p_trans->info_cbacks_.pf_header_avail (p_trans->p_parent_, ptr, nbytes);
+  if (p_trans->p_cache_writer_)
+    {
+      tiz_urlcache_writer_add_header (p_trans->p_cache_writer_, ptr, nbytes);
+    }
   URLTRANS_LOG_CBACK_END (p_trans);
   return nbytes;
 }
@@ -691,6 +1309,7 @@ static size_t
 curl_write_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
 {
   tiz_urltrans_t * p_trans = userdata;
+  const void * p_data = ptr;
   size_t nbytes = size * nmemb;
   size_t rc = nbytes;
   assert (p_trans);
@@ -735,6 +1354,7 @@ curl_write_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
                   nbytes -= nbytes_copied;
                   ptr += nbytes_copied;
                 }
+              update_underrun_status (p_trans, 0 == nbytes);
             }
 
           if (nbytes > 0)
@@ -768,7 +1388,70 @@ curl_write_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
         }
     }
 
-  URLTRANS_LOG_CBACK_END (p_trans);
+  /* Curl delivers paused data again, so only what has been taken is cached */
+  if (p_trans->p_cache_writer_ && rc == size * nmemb)
+    {
+      tiz_urlcache_writer_write (p_trans->p_cache_writer_, p_data, rc);
+    }
+
+  URLTRANS_LOG_CBACK_END (p_trans);
+  return rc;
+}
+
+/* The header and write callbacks used with the shared multi handle. These may
+   run on the event loop thread, so they only stash the data away and let the
+   owner know. */
+static size_t
+shared_header_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
+{
+  tiz_urltrans_t * p_trans = userdata;
+  size_t nbytes = size * nmemb;
+  assert (p_trans);
+  (void) tiz_mutex_lock (&(p_trans->shared_mutex_));
+  (void) tiz_buffer_push (p_trans->p_headers_, ptr, nbytes);
+  if (p_trans->p_cache_writer_)
+    {
+      tiz_urlcache_writer_add_header (p_trans->p_cache_writer_, ptr, nbytes);
+    }
+  (void) tiz_mutex_unlock (&(p_trans->shared_mutex_));
+  notify_owner (p_trans);
+  return nbytes;
+}
+
+static size_t
+shared_write_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
+{
+  tiz_urltrans_t * p_trans = userdata;
+  size_t nbytes = size * nmemb;
+  size_t rc = nbytes;
+  assert (p_trans);
+
+  (void) tiz_mutex_lock (&(p_trans->shared_mutex_));
+  if (tiz_buffer_available (p_trans->p_store_)
+      > (2 * p_trans->internal_buffer_size_))
+    {
+      /* Curl will deliver this again after the owner resumes the transfer */
+      p_trans->shared_paused_ = true;
+      rc = CURL_WRITEFUNC_PAUSE;
+    }
+  else if (nbytes > 0)
+    {
+      int nbytes_stored = tiz_buffer_push (p_trans->p_store_, ptr, nbytes);
+      p_trans->unseen_bytes_ += nbytes_stored;
+      if (p_trans->p_cache_writer_)
+        {
+          tiz_urlcache_writer_write (p_trans->p_cache_writer_, ptr, nbytes);
+        }
+      if (nbytes_stored < (int) nbytes)
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR,
+                   "Unable to store all the data (wanted %d, stored %d).",
+                   (int) nbytes, nbytes_stored);
+        }
+    }
+  (void) tiz_mutex_unlock (&(p_trans->shared_mutex_));
+
+  notify_owner (p_trans);
   return rc;
 }
 
@@ -987,6 +1670,213 @@ destroy_events (tiz_urltrans_t * ap_trans)
   ap_trans->p_ev_reconnect_timer_ = NULL;
 }
 
+static void
+deliver_header_lines (tiz_urltrans_t * ap_trans, const char * ap_headers,
+                      int a_nbytes)
+{
+  assert (ap_trans);
+  /* Headers are delivered line by line, as curl does */
+  while (a_nbytes > 0)
+    {
+      const char * p_eol = memchr (ap_headers, '\n', a_nbytes);
+      const int len = p_eol ? (p_eol - ap_headers) + 1 : a_nbytes;
+      stop_reconnect_timer_watcher (ap_trans);
+      ap_trans->info_cbacks_.pf_header_avail (ap_trans->p_parent_, ap_headers,
+                                              len);
+      ap_headers += len;
+      a_nbytes -= len;
+    }
+}
+
+/* Write through to the cache while streaming; the entry becomes visible only
+ * if the download completes */
+static void
+open_cache_writer (tiz_urltrans_t * ap_trans)
+{
+  tiz_urlcache_writer_t * p_writer = NULL;
+  assert (ap_trans);
+  if (ap_trans->p_cache_key_)
+    {
+      close_cache_entries (ap_trans, false);
+      (void) tiz_urlcache_writer_open (&p_writer, ap_trans->p_cache_key_);
+      lock_store (ap_trans);
+      ap_trans->p_cache_writer_ = p_writer;
+      unlock_store (ap_trans);
+    }
+}
+
+static void
+stop_prefetch (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  tiz_urlprefetch_destroy (ap_trans->p_prefetch_);
+  ap_trans->p_prefetch_ = NULL;
+  ap_trans->prefetch_headers_sent_ = false;
+}
+
+static ssize_t
+read_locally (tiz_urltrans_t * ap_trans, void * ap_data, const size_t a_nbytes)
+{
+  assert (ap_trans);
+  if (ap_trans->p_cache_reader_)
+    {
+      return tiz_urlcache_reader_read (ap_trans->p_cache_reader_, ap_data,
+                                       a_nbytes);
+    }
+  return tiz_urlprefetch_read (ap_trans->p_prefetch_, ap_data, a_nbytes);
+}
+
+static void
+unread_locally (tiz_urltrans_t * ap_trans, const size_t a_nbytes)
+{
+  assert (ap_trans);
+  if (ap_trans->p_cache_reader_)
+    {
+      tiz_urlcache_reader_unread (ap_trans->p_cache_reader_, a_nbytes);
+    }
+  else
+    {
+      tiz_urlprefetch_unread (ap_trans->p_prefetch_, a_nbytes);
+    }
+}
+
+static void
+end_local_transfer (tiz_urltrans_t * ap_trans, const bool a_complete)
+{
+  assert (ap_trans);
+  /* A prefetched download that completed makes it into the cache */
+  close_cache_entries (ap_trans, a_complete && ap_trans->p_prefetch_);
+  stop_prefetch (ap_trans);
+  report_connection_lost_event (ap_trans);
+}
+
+/* The prefetcher may not have the headers yet; they are looked for again on
+ * the next notification */
+static bool
+send_prefetched_headers (tiz_urltrans_t * ap_trans)
+{
+  size_t nbytes = 0;
+  const char * p_headers = NULL;
+  assert (ap_trans);
+  assert (ap_trans->p_prefetch_);
+
+  if (!(p_headers = tiz_urlprefetch_headers (ap_trans->p_prefetch_, &nbytes)))
+    {
+      if (EAGAIN != errno)
+        {
+          end_local_transfer (ap_trans, false);
+        }
+      return false;
+    }
+
+  ap_trans->prefetch_headers_sent_ = true;
+  if (ap_trans->p_cache_writer_)
+    {
+      tiz_urlcache_writer_add_header (ap_trans->p_cache_writer_, p_headers,
+                                      nbytes);
+    }
+  deliver_header_lines (ap_trans, p_headers, nbytes);
+  return (NULL != ap_trans->p_prefetch_);
+}
+
+/* Move data from the cache entry or the prefetcher into the store, in the
+ * same way curl's write callback would, until the store is full, the client
+ * asks for a pause or the prefetcher has nothing more for now. */
+static void
+serve_locally (tiz_urltrans_t * ap_trans)
+{
+  char chunk[URLTRANS_CACHE_CHUNK_SIZE];
+  assert (ap_trans);
+  assert (is_served_locally (ap_trans));
+
+  send_from_internal_buffer (ap_trans);
+  if (ap_trans->p_prefetch_ && !ap_trans->prefetch_headers_sent_
+      && !send_prefetched_headers (ap_trans))
+    {
+      return;
+    }
+
+  while (is_served_locally (ap_trans) && !ap_trans->cache_paused_
+         && is_transfer_running (ap_trans)
+         && tiz_buffer_available (ap_trans->p_store_)
+              <= ap_trans->internal_buffer_size_)
+    {
+      const ssize_t nbytes = read_locally (ap_trans, chunk, sizeof (chunk));
+      if (nbytes < 0 && EAGAIN == errno && ap_trans->p_prefetch_)
+        {
+          /* The prefetcher notifies when there is more */
+          break;
+        }
+      if (nbytes <= 0)
+        {
+          /* All the data has been read; this is the end of the transfer */
+          end_local_transfer (ap_trans, 0 == nbytes);
+          break;
+        }
+      if (ap_trans->info_cbacks_.pf_data_avail (ap_trans->p_parent_, chunk,
+                                                nbytes))
+        {
+          /* This chunk is delivered again once the transfer is resumed */
+          unread_locally (ap_trans, nbytes);
+          set_curl_state (ap_trans, ECurlStatePaused);
+        }
+      else
+        {
+          (void) tiz_buffer_push (ap_trans->p_store_, chunk, nbytes);
+          if (ap_trans->p_cache_writer_)
+            {
+              tiz_urlcache_writer_write (ap_trans->p_cache_writer_, chunk,
+                                         nbytes);
+            }
+          send_from_internal_buffer (ap_trans);
+        }
+    }
+}
+
+static OMX_ERRORTYPE
+start_from_cache (tiz_urltrans_t * ap_trans)
+{
+  size_t nbytes = 0;
+  const char * p_headers = NULL;
+  assert (ap_trans);
+  assert (ap_trans->p_cache_reader_);
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE, "Serving [%s] from the track cache",
+           ap_trans->p_cache_key_);
+  set_curl_state (ap_trans, ECurlStateTransfering);
+  ap_trans->cache_paused_ = false;
+  p_headers = tiz_urlcache_reader_headers (ap_trans->p_cache_reader_, &nbytes);
+  deliver_header_lines (ap_trans, p_headers, nbytes);
+  if (ap_trans->p_cache_reader_)
+    {
+      serve_locally (ap_trans);
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+start_prefetch (tiz_urltrans_t * ap_trans)
+{
+  urltrans_curl_share_t * p_share = get_curl_share ();
+  assert (ap_trans);
+  assert (!ap_trans->p_prefetch_);
+  assert (ap_trans->pf_notify_);
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE, "Prefetching [%s] over up to [%d] connections",
+           ap_trans->p_uri_param_->contentURI, ap_trans->prefetch_connections_);
+  tiz_check_omx (tiz_urlprefetch_init (
+    &(ap_trans->p_prefetch_), (const char *) ap_trans->p_uri_param_->contentURI,
+    ap_trans->p_comp_name_, p_share ? p_share->p_share : NULL,
+    ap_trans->prefetch_connections_, ap_trans->pf_notify_,
+    ap_trans->p_parent_));
+  ap_trans->prefetch_headers_sent_ = false;
+  ap_trans->cache_paused_ = false;
+  ap_trans->handshake_error_found = false;
+  set_curl_state (ap_trans, ECurlStateTransfering);
+  serve_locally (ap_trans);
+  return OMX_ErrorNone;
+}
+
 static OMX_ERRORTYPE
 allocate_curl_resources (tiz_urltrans_t * ap_trans)
 {
@@ -1006,8 +1896,8 @@ allocate_curl_resources (tiz_urltrans_t * ap_trans)
       ap_trans->curl_version_ = p_version_info->version_num;
     }
 
-  /* Init the curl easy handle */
-  tiz_check_null_ret_oom ((ap_trans->p_curl_ = curl_easy_init ()));
+  /* Take an easy handle from the process-wide pool */
+  tiz_check_null_ret_oom ((ap_trans->p_curl_ = acquire_curl_easy ()));
   /* Now init the curl multi handle */
   bail_on_oom ((ap_trans->p_curl_multi_ = curl_multi_init ()));
   /* this is to ask libcurl to accept ICY OK headers*/
@@ -1017,6 +1907,9 @@ allocate_curl_resources (tiz_urltrans_t * ap_trans)
   bail_on_oom ((ap_trans->p_http_headers_ = curl_slist_append (
                   ap_trans->p_http_headers_, "Icy-MetaData:0")));
 
+  goto_end_on_omx_error (configure_curl (ap_trans),
+                         "Unable to configure the curl handles");
+
   /* all ok */
   rc = OMX_ErrorNone;
 
@@ -1035,14 +1928,24 @@ static void
 destroy_curl_resources (tiz_urltrans_t * ap_trans)
 {
   assert (ap_trans);
+  if (ap_trans->p_curl_multi_ && ap_trans->p_curl_)
+    {
+      lock_multi (ap_trans);
+      curl_multi_remove_handle (ap_trans->p_curl_multi_, ap_trans->p_curl_);
+      unlock_multi (ap_trans);
+    }
+  /* Return the easy handle to the pool before its option lists go away */
+  release_curl_easy (ap_trans->p_curl_);
+  ap_trans->p_curl_ = NULL;
   curl_slist_free_all (ap_trans->p_http_ok_aliases_);
   ap_trans->p_http_ok_aliases_ = NULL;
   curl_slist_free_all (ap_trans->p_http_headers_);
   ap_trans->p_http_headers_ = NULL;
-  curl_multi_cleanup (ap_trans->p_curl_multi_);
+  if (!ap_trans->shared_multi_)
+    {
+      curl_multi_cleanup (ap_trans->p_curl_multi_);
+    }
   ap_trans->p_curl_multi_ = NULL;
-  curl_easy_cleanup (ap_trans->p_curl_);
-  ap_trans->p_curl_ = NULL;
 }
 
 OMX_ERRORTYPE
@@ -1097,6 +2000,8 @@ tiz_urltrans_init (tiz_urltrans_ptr_t * app_trans, void * ap_parent,
           p_trans->p_store_ = NULL;
           p_trans->internal_buffer_size_ = 0;
           p_trans->internal_buffer_size_initial_ = 0;
+          p_trans->drained_ = true;
+          p_trans->underruns_ = 0;
           p_trans->p_curl_ = NULL;
           p_trans->p_curl_multi_ = NULL;
           p_trans->p_http_ok_aliases_ = NULL;
@@ -1104,6 +2009,22 @@ tiz_urltrans_init (tiz_urltrans_ptr_t * app_trans, void * ap_parent,
           p_trans->curl_state_ = ECurlStateStopped;
           p_trans->curl_version_ = 0;
           p_trans->handshake_error_found = false;
+          p_trans->shared_multi_ = false;
+          p_trans->pf_notify_ = NULL;
+          p_trans->shared_mutex_ = NULL;
+          p_trans->p_headers_ = NULL;
+          p_trans->unseen_bytes_ = 0;
+          p_trans->shared_paused_ = false;
+          p_trans->shared_done_ = false;
+          p_trans->notify_pending_ = false;
+          p_trans->shared_result_ = CURLE_OK;
+          p_trans->p_cache_key_ = NULL;
+          p_trans->p_cache_writer_ = NULL;
+          p_trans->p_cache_reader_ = NULL;
+          p_trans->cache_paused_ = false;
+          p_trans->prefetch_connections_ = 0;
+          p_trans->p_prefetch_ = NULL;
+          p_trans->prefetch_headers_sent_ = false;
 
           rc = allocate_temp_data_store (p_trans);
           goto_end_on_omx_error (rc, "Unable to alloc the data store");
@@ -1132,9 +2053,20 @@ tiz_urltrans_destroy (tiz_urltrans_t * ap_trans)
 {
   if (ap_trans)
     {
+      stop_prefetch (ap_trans);
+      close_cache_entries (ap_trans, false);
+      tiz_mem_free (ap_trans->p_cache_key_);
+      ap_trans->p_cache_key_ = NULL;
+      destroy_curl_resources (ap_trans);
       destroy_temp_data_store (ap_trans);
       destroy_events (ap_trans);
-      destroy_curl_resources (ap_trans);
+      if (ap_trans->shared_mutex_)
+        {
+          tiz_buffer_destroy (ap_trans->p_headers_);
+          ap_trans->p_headers_ = NULL;
+          (void) tiz_mutex_destroy (&(ap_trans->shared_mutex_));
+          ap_trans->shared_mutex_ = NULL;
+        }
       curl_global_cleanup ();
     }
 }
@@ -1147,7 +2079,14 @@ tiz_urltrans_set_uri (tiz_urltrans_t * ap_trans,
   assert (ap_uri_param);
   URLTRANS_LOG_API_START (ap_trans);
   ap_trans->p_uri_param_ = ap_uri_param;
+  stop_prefetch (ap_trans);
+  /* A cache key only applies to the URI it was given for */
+  close_cache_entries (ap_trans, false);
+  tiz_mem_free (ap_trans->p_cache_key_);
+  ap_trans->p_cache_key_ = NULL;
+  lock_multi (ap_trans);
   curl_multi_remove_handle (ap_trans->p_curl_multi_, ap_trans->p_curl_);
+  unlock_multi (ap_trans);
   bail_on_curl_error (curl_easy_setopt (ap_trans->p_curl_, CURLOPT_URL,
                                         ap_trans->p_uri_param_->contentURI));
   set_curl_state (ap_trans, ECurlStateStopped);
@@ -1175,6 +2114,22 @@ tiz_urltrans_set_internal_buffer_size (tiz_urltrans_t * ap_trans,
   URLTRANS_LOG_API_START (ap_trans);
   ap_trans->internal_buffer_size_ = ap_trans->internal_buffer_size_initial_
     = a_nbytes;
+  ap_trans->drained_ = true;
+}
+
+void
+tiz_urltrans_adjust_internal_buffer_size (tiz_urltrans_t * ap_trans,
+                                          const int a_nbytes)
+{
+  assert (ap_trans);
+  assert (a_nbytes > 0);
+  URLTRANS_LOG_API_START (ap_trans);
+  ap_trans->internal_buffer_size_ = a_nbytes;
+  if (ap_trans->internal_buffer_size_initial_ > 0)
+    {
+      /* Still buffering before the first delivery */
+      ap_trans->internal_buffer_size_initial_ = a_nbytes;
+    }
 }
 
 OMX_ERRORTYPE
@@ -1183,9 +2138,32 @@ tiz_urltrans_start (tiz_urltrans_t * ap_trans)
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (ap_trans);
   URLTRANS_LOG_API_START (ap_trans);
-  if (is_transfer_stopped (ap_trans) || is_transfer_paused (ap_trans))
+  if (is_served_locally (ap_trans))
+    {
+      /* Carry on from where the cache entry or the prefetcher was left */
+      ap_trans->cache_paused_ = false;
+      set_curl_state (ap_trans, ECurlStateTransfering);
+      serve_locally (ap_trans);
+    }
+  else if (is_transfer_stopped (ap_trans) && ap_trans->p_cache_key_
+           && OMX_ErrorNone
+                == tiz_urlcache_reader_open (&(ap_trans->p_cache_reader_),
+                                             ap_trans->p_cache_key_))
+    {
+      rc = start_from_cache (ap_trans);
+    }
+  else if (is_transfer_stopped (ap_trans) && ap_trans->prefetch_connections_ > 0)
+    {
+      open_cache_writer (ap_trans);
+      rc = start_prefetch (ap_trans);
+    }
+  else if (is_transfer_stopped (ap_trans) || is_transfer_paused (ap_trans))
     {
       int running_handles = 0;
+      if (is_transfer_stopped (ap_trans))
+        {
+          open_cache_writer (ap_trans);
+        }
       tiz_check_omx (start_curl (ap_trans));
       assert (ap_trans->p_curl_multi_);
       ap_trans->handshake_error_found = false;
@@ -1203,6 +2181,14 @@ tiz_urltrans_pause (tiz_urltrans_t * ap_trans)
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (ap_trans);
   URLTRANS_LOG_API_START (ap_trans);
+  ap_trans->cache_paused_ = true;
+  if (ap_trans->shared_multi_ && is_transfer_running (ap_trans))
+    {
+      /* The shared multi handle keeps running; pause the transfer itself */
+      lock_multi (ap_trans);
+      (void) curl_easy_pause (ap_trans->p_curl_, CURLPAUSE_ALL);
+      unlock_multi (ap_trans);
+    }
   tiz_check_omx (stop_io_watcher (ap_trans));
   tiz_check_omx (stop_curl_timer_watcher (ap_trans));
   rc = stop_reconnect_timer_watcher (ap_trans);
@@ -1217,6 +2203,27 @@ tiz_urltrans_unpause (tiz_urltrans_t * ap_trans)
   int running_handles = 0;
   assert (ap_trans);
   URLTRANS_LOG_API_START (ap_trans);
+  ap_trans->cache_paused_ = false;
+  if (is_served_locally (ap_trans))
+    {
+      if (is_transfer_running (ap_trans))
+        {
+          serve_locally (ap_trans);
+        }
+      URLTRANS_LOG_API_END (ap_trans);
+      return OMX_ErrorNone;
+    }
+  if (ap_trans->shared_multi_)
+    {
+      if (is_transfer_running (ap_trans))
+        {
+          lock_multi (ap_trans);
+          (void) curl_easy_pause (ap_trans->p_curl_, CURLPAUSE_CONT);
+          unlock_multi (ap_trans);
+        }
+      URLTRANS_LOG_API_END (ap_trans);
+      return OMX_ErrorNone;
+    }
   tiz_check_omx (restart_curl_timer_watcher (ap_trans));
   tiz_check_omx (kickstart_curl_socket (ap_trans, &running_handles));
   URLTRANS_LOG_API_END (ap_trans);
@@ -1231,9 +2238,23 @@ tiz_urltrans_cancel (tiz_urltrans_t * ap_trans)
   URLTRANS_LOG_API_START (ap_trans);
   tiz_urltrans_pause (ap_trans);
   set_curl_state (ap_trans, ECurlStateStopped);
+  stop_prefetch (ap_trans);
+  close_cache_entries (ap_trans, false);
   if (ap_trans->p_curl_multi_)
     {
+      lock_multi (ap_trans);
       curl_multi_remove_handle (ap_trans->p_curl_multi_, ap_trans->p_curl_);
+      unlock_multi (ap_trans);
+    }
+  if (ap_trans->shared_multi_)
+    {
+      /* Nothing that was pending for the old transfer matters now */
+      lock_store (ap_trans);
+      tiz_buffer_clear (ap_trans->p_headers_);
+      ap_trans->unseen_bytes_ = 0;
+      ap_trans->shared_paused_ = false;
+      ap_trans->shared_done_ = false;
+      unlock_store (ap_trans);
     }
   ap_trans->sockfd_ = -1;
   ap_trans->awaiting_io_ev_ = false;
@@ -1249,7 +2270,20 @@ tiz_urltrans_flush_buffer (tiz_urltrans_t * ap_trans)
   URLTRANS_LOG_API_START (ap_trans);
   if (ap_trans->p_store_)
     {
-      tiz_buffer_clear (ap_trans->p_store_);
+      lock_store (ap_trans);
+      if (ap_trans->unseen_bytes_ > 0)
+        {
+          /* The client hasn't seen this data yet, so it is kept, in the same
+           * way that curl would deliver it again after a pause */
+          const int avail = tiz_buffer_available (ap_trans->p_store_);
+          (void) tiz_buffer_advance (
+            ap_trans->p_store_, avail - MIN (ap_trans->unseen_bytes_, avail));
+        }
+      else
+        {
+          tiz_buffer_clear (ap_trans->p_store_);
+        }
+      unlock_store (ap_trans);
     }
   URLTRANS_LOG_API_END (ap_trans);
 }
@@ -1261,10 +2295,21 @@ tiz_urltrans_on_buffers_ready (tiz_urltrans_t * ap_trans)
   assert (ap_trans);
   URLTRANS_LOG_API_START (ap_trans);
   rc = send_from_internal_buffer (ap_trans);
-  if (is_transfer_paused (ap_trans))
+  if (is_served_locally (ap_trans))
+    {
+      if (!ap_trans->cache_paused_)
+        {
+          set_curl_state (ap_trans, ECurlStateTransfering);
+          serve_locally (ap_trans);
+        }
+    }
+  else if (is_transfer_paused (ap_trans))
     {
-      if (tiz_buffer_available (ap_trans->p_store_)
-          <= ap_trans->internal_buffer_size_)
+      int nbytes_available = 0;
+      lock_store (ap_trans);
+      nbytes_available = tiz_buffer_available (ap_trans->p_store_);
+      unlock_store (ap_trans);
+      if (nbytes_available <= ap_trans->internal_buffer_size_)
         {
           rc = resume_curl (ap_trans);
         }
@@ -1360,7 +2405,9 @@ tiz_urltrans_on_timer_ready (tiz_urltrans_t * ap_trans,
                       ap_trans->p_uri_param_->contentURI);
       TIZ_PRINTF_RED ("Re-connecting in %.1f seconds.\n",
                       ap_trans->reconnect_timeout_);
+      lock_multi (ap_trans);
       curl_multi_remove_handle (ap_trans->p_curl_multi_, ap_trans->p_curl_);
+      unlock_multi (ap_trans);
       start_curl (ap_trans);
       tiz_check_omx (kickstart_curl_socket (ap_trans, &running_handles));
     }
@@ -1372,12 +2419,22 @@ tiz_urltrans_on_timer_ready (tiz_urltrans_t * ap_trans,
 OMX_U32
 tiz_urltrans_bytes_available (tiz_urltrans_t * ap_trans)
 {
+  OMX_U32 nbytes = 0;
   assert (ap_trans);
   if (ap_trans->p_store_)
     {
-      return tiz_buffer_available (ap_trans->p_store_);
+      lock_store (ap_trans);
+      nbytes = tiz_buffer_available (ap_trans->p_store_);
+      unlock_store (ap_trans);
     }
-  return 0;
+  return nbytes;
+}
+
+OMX_U32
+tiz_urltrans_underruns (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  return ap_trans->underruns_;
 }
 
 bool
@@ -1392,3 +2449,181 @@ tiz_urltrans_handshake_error_found (tiz_urltrans_t * ap_trans)
     }
   return false;
 }
+
+OMX_ERRORTYPE
+tiz_urltrans_use_shared_multi (tiz_urltrans_t * ap_trans,
+                               tiz_urltrans_notify_f apf_notify)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
+  urltrans_curl_multi_t * p_multi = get_curl_multi ();
+
+  assert (ap_trans);
+  assert (apf_notify);
+  assert (is_transfer_stopped (ap_trans));
+
+  if (ap_trans->shared_multi_)
+    {
+      return OMX_ErrorNone;
+    }
+
+  if (!p_multi)
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+
+  tiz_check_omx (tiz_mutex_init (&(ap_trans->shared_mutex_)));
+  goto_end_on_omx_error (tiz_buffer_init (&(ap_trans->p_headers_), 1024),
+                         "Unable to alloc the headers store");
+
+  bail_on_curl_error (curl_easy_setopt (
+    ap_trans->p_curl_, CURLOPT_HEADERFUNCTION, shared_header_cback));
+  bail_on_curl_error (curl_easy_setopt (
+    ap_trans->p_curl_, CURLOPT_WRITEFUNCTION, shared_write_cback));
+
+  /* The private multi handle has no easy handles yet */
+  curl_multi_cleanup (ap_trans->p_curl_multi_);
+  ap_trans->p_curl_multi_ = p_multi->p_multi;
+  ap_trans->pf_notify_ = apf_notify;
+  ap_trans->shared_multi_ = true;
+
+  /* all ok */
+  rc = OMX_ErrorNone;
+
+end:
+
+  return rc;
+}
+
+OMX_ERRORTYPE
+tiz_urltrans_on_notification (tiz_urltrans_t * ap_trans)
+{
+  bool pause_needed = false;
+  bool paused = false;
+  bool done = false;
+  char * p_headers = NULL;
+  int nheaders = 0;
+
+  assert (ap_trans);
+  URLTRANS_LOG_API_START (ap_trans);
+
+  if (ap_trans->p_prefetch_)
+    {
+      if (is_transfer_running (ap_trans))
+        {
+          serve_locally (ap_trans);
+        }
+      URLTRANS_LOG_API_END (ap_trans);
+      return OMX_ErrorNone;
+    }
+
+  if (!ap_trans->shared_multi_)
+    {
+      /* Left over from a prefetched transfer that has finished */
+      URLTRANS_LOG_API_END (ap_trans);
+      return OMX_ErrorNone;
+    }
+
+  (void) tiz_mutex_lock (&(ap_trans->shared_mutex_));
+  ap_trans->notify_pending_ = false;
+  nheaders = tiz_buffer_available (ap_trans->p_headers_);
+  if (nheaders > 0 && (p_headers = tiz_mem_alloc (nheaders)))
+    {
+      memcpy (p_headers, tiz_buffer_get (ap_trans->p_headers_), nheaders);
+    }
+  tiz_buffer_clear (ap_trans->p_headers_);
+  (void) tiz_mutex_unlock (&(ap_trans->shared_mutex_));
+
+  if (p_headers)
+    {
+      deliver_header_lines (ap_trans, p_headers, nheaders);
+      tiz_mem_free (p_headers);
+    }
+
+  /* NOTE: The store stays locked while the client looks at the new data,
+   * as curl's write callback may be appending to it concurrently */
+  (void) tiz_mutex_lock (&(ap_trans->shared_mutex_));
+  /* The data the client hasn't had a chance to look at is at the tail of the
+   * store */
+  if (ap_trans->unseen_bytes_ > 0 && !is_transfer_paused (ap_trans))
+    {
+      const int avail = tiz_buffer_available (ap_trans->p_store_);
+      const int nbytes = MIN (ap_trans->unseen_bytes_, avail);
+      set_curl_state (ap_trans, ECurlStateTransfering);
+      pause_needed = ap_trans->info_cbacks_.pf_data_avail (
+        ap_trans->p_parent_,
+        (char *) tiz_buffer_get (ap_trans->p_store_) + (avail - nbytes),
+        nbytes);
+      /* As curl does after a pause, this data is presented again once the
+       * transfer is resumed */
+      ap_trans->unseen_bytes_ = pause_needed ? nbytes : 0;
+    }
+
+  paused = ap_trans->shared_paused_;
+  done = ap_trans->shared_done_;
+  ap_trans->shared_done_ = false;
+  (void) tiz_mutex_unlock (&(ap_trans->shared_mutex_));
+
+  if (done)
+    {
+      report_connection_lost_event (ap_trans);
+    }
+  else if (pause_needed)
+    {
+      /* The client wants to look at what it has got so far */
+      set_curl_state (ap_trans, ECurlStatePaused);
+      lock_multi (ap_trans);
+      (void) curl_easy_pause (ap_trans->p_curl_, CURLPAUSE_RECV);
+      unlock_multi (ap_trans);
+    }
+  else if (is_transfer_running (ap_trans))
+    {
+      bool passed_watermark = false;
+      if (paused)
+        {
+          set_curl_state (ap_trans, ECurlStatePaused);
+        }
+      lock_store (ap_trans);
+      passed_watermark = is_passed_buffer_high_watermark (ap_trans);
+      unlock_store (ap_trans);
+      if (passed_watermark)
+        {
+          /* Reset the cache size */
+          ap_trans->internal_buffer_size_initial_ = 0;
+          send_from_internal_buffer (ap_trans);
+        }
+    }
+
+  URLTRANS_LOG_API_END (ap_trans);
+  return OMX_ErrorNone;
+}
+
+void
+tiz_urltrans_set_cache_key (tiz_urltrans_t * ap_trans, const char * ap_key)
+{
+  assert (ap_trans);
+  close_cache_entries (ap_trans, false);
+  tiz_mem_free (ap_trans->p_cache_key_);
+  ap_trans->p_cache_key_ = NULL;
+  if (ap_key && strlen (ap_key) > 0 && tiz_urlcache_enabled ())
+    {
+      const size_t len = strlen (ap_key);
+      if ((ap_trans->p_cache_key_ = tiz_mem_alloc (len + 1)))
+        {
+          memcpy (ap_trans->p_cache_key_, ap_key, len + 1);
+        }
+    }
+}
+
+OMX_ERRORTYPE
+tiz_urltrans_use_range_prefetch (tiz_urltrans_t * ap_trans,
+                                 const int a_connections,
+                                 tiz_urltrans_notify_f apf_notify)
+{
+  assert (ap_trans);
+  assert (apf_notify);
+  assert (!ap_trans->pf_notify_ || ap_trans->pf_notify_ == apf_notify);
+  assert (is_transfer_stopped (ap_trans));
+  ap_trans->pf_notify_ = apf_notify;
+  ap_trans->prefetch_connections_ = MAX (0, a_connections);
+  return OMX_ErrorNone;
+}
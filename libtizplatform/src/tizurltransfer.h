@@ -110,6 +110,19 @@ typedef bool (*tiz_urltrans_data_available_f) (OMX_PTR ap_arg,
  */
 typedef bool (*tiz_urltrans_connection_lost_f) (OMX_PTR ap_arg);
 
+/**
+ * This callback is invoked when a transfer that uses the shared multi handle
+ * has news for its owner (headers, data or the end of the transfer).
+ *
+ * @note This is called from the event loop thread (or from any thread that
+ * is operating on the shared multi handle). The client should just post an
+ * event to its own thread and call tiz_urltrans_on_notification from there.
+ *
+ * @param ap_arg The client data structure.
+ *
+ */
+typedef void (*tiz_urltrans_notify_f) (OMX_PTR ap_arg);
+
 /**
  * @brief Buffer callbacks registration structure (typedef).
  * @ingroup tizurltransfer
@@ -299,6 +312,20 @@ void
 tiz_urltrans_set_uri (tiz_urltrans_t * ap_trans,
                       OMX_PARAM_CONTENTURITYPE * ap_uri_param);
 
+/**
+ * Identify the resource at the current URI for the track cache (see
+ * tizurlcache.h). When the cache is enabled and holds an entry for the key,
+ * the next start is served from disk; otherwise the download is written
+ * through to the cache. Setting a new URI clears the key.
+ *
+ * @param ap_trans The URL transfer object.
+ *
+ * @param ap_key A key that is stable across sessions (e.g. a track id), or
+ * NULL.
+ */
+void
+tiz_urltrans_set_cache_key (tiz_urltrans_t * ap_trans, const char * ap_key);
+
 void
 tiz_urltrans_set_connect_timeout (tiz_urltrans_t * ap_trans,
                                   const long a_connect_timeout);
@@ -307,6 +334,20 @@ void
 tiz_urltrans_set_internal_buffer_size (tiz_urltrans_t * ap_trans,
                                        const int a_nbytes);
 
+/**
+ * Change the size of the internal buffer while the transfer is in progress.
+ * Unlike tiz_urltrans_set_internal_buffer_size, this does not restart the
+ * initial buffering if that has already finished. The new size decides how
+ * much data is kept before the transfer is paused.
+ *
+ * @param ap_trans The URL transfer object.
+ *
+ * @param a_nbytes The new size, in bytes.
+ */
+void
+tiz_urltrans_adjust_internal_buffer_size (tiz_urltrans_t * ap_trans,
+                                          const int a_nbytes);
+
 OMX_ERRORTYPE
 tiz_urltrans_start (tiz_urltrans_t * ap_trans);
 
@@ -333,9 +374,75 @@ OMX_ERRORTYPE
 tiz_urltrans_on_timer_ready (tiz_urltrans_t * ap_trans,
                              tiz_event_timer_t * ap_ev_timer);
 
+/**
+ * Move the transfer to the process-wide curl multi handle. The shared handle
+ * is driven from the event loop thread, so the io and timer callbacks are no
+ * longer used for the transfer itself (only for the reconnect timer). Must be
+ * called before the transfer is started.
+ *
+ * @param ap_trans The URL transfer object.
+ *
+ * @param apf_notify The notification callback.
+ *
+ * @return OMX_ErrorNone if success, OMX_ErrorInsufficientResources otherwise.
+ */
+OMX_ERRORTYPE
+tiz_urltrans_use_shared_multi (tiz_urltrans_t * ap_trans,
+                               tiz_urltrans_notify_f apf_notify);
+
+/**
+ * Download the resource with several concurrent Range requests (see
+ * tizurlprefetch.h) instead of a single sequential one. The prefetched data
+ * is delivered through the usual callbacks; the notification callback
+ * signals that tiz_urltrans_on_notification should be called. Servers that
+ * don't support ranges are downloaded over a single connection. Must be
+ * called before the transfer is started.
+ *
+ * @param ap_trans The URL transfer object.
+ *
+ * @param a_connections The maximum number of concurrent requests; 0
+ * disables the prefetch.
+ *
+ * @param apf_notify The notification callback. If the transfer also uses the
+ * shared multi handle, it must be the same callback.
+ *
+ * @return OMX_ErrorNone.
+ */
+OMX_ERRORTYPE
+tiz_urltrans_use_range_prefetch (tiz_urltrans_t * ap_trans,
+                                 const int a_connections,
+                                 tiz_urltrans_notify_f apf_notify);
+
+/**
+ * Process whatever the shared multi handle or the prefetcher has produced for
+ * this transfer since the last notification. Must be called from the owner's
+ * thread.
+ *
+ * @note The data available callback is invoked with the transfer's store
+ * locked; it must not call back into the transfer.
+ *
+ * @param ap_trans The URL transfer object.
+ *
+ * @return OMX_ErrorNone if success, OMX_ErrorInsufficientResources otherwise.
+ */
+OMX_ERRORTYPE
+tiz_urltrans_on_notification (tiz_urltrans_t * ap_trans);
+
 OMX_U32
 tiz_urltrans_bytes_available (tiz_urltrans_t * ap_trans);
 
+/**
+ * The number of times the internal buffer has run dry, after the initial
+ * buffering, since the transfer object was created. Transfers served from the
+ * track cache or the range prefetcher are not accounted for.
+ *
+ * @param ap_trans The URL transfer object.
+ *
+ * @return The number of underruns.
+ */
+OMX_U32
+tiz_urltrans_underruns (tiz_urltrans_t * ap_trans);
+
 bool
 tiz_urltrans_handshake_error_found (tiz_urltrans_t * ap_trans);
 
@@ -0,0 +1,220 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_aio.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tests for the asynchronous file I/O API implementation
+ *
+ *
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define AIO_TEST_NREQS 8
+#define AIO_TEST_REQ_SIZE 4096
+
+static void
+aio_test_notify (void *ap_arg)
+{
+  tiz_sem_t *p_sem = ap_arg;
+  (void) tiz_sem_post (p_sem);
+}
+
+static size_t
+aio_test_reap_all (tiz_aio_t *ap_aio, tiz_sem_t *ap_sem,
+                   tiz_aio_req_t *ap_reqs, const size_t a_nreqs)
+{
+  size_t reaped = 0;
+  while (reaped < a_nreqs)
+    {
+      if (OMX_ErrorNone != tiz_sem_timedwait (ap_sem, 5000))
+        {
+          break;
+        }
+      reaped += tiz_aio_reap (ap_aio, ap_reqs + reaped, a_nreqs - reaped);
+    }
+  return reaped;
+}
+
+START_TEST (test_aio_write_then_read)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  tiz_aio_t *p_aio = NULL;
+  tiz_sem_t sem;
+  tiz_aio_req_t reqs[AIO_TEST_NREQS];
+  tiz_aio_req_t done[AIO_TEST_NREQS];
+  static unsigned char in[AIO_TEST_NREQS * AIO_TEST_REQ_SIZE];
+  static unsigned char out[AIO_TEST_NREQS * AIO_TEST_REQ_SIZE];
+  FILE *p_file = tmpfile ();
+  int i;
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_aio_write_then_read");
+
+  fail_if (p_file == NULL);
+  fail_if (tiz_sem_init (&sem, 0) != OMX_ErrorNone);
+  error = tiz_aio_init (&p_aio, 3, aio_test_notify, &sem);
+  fail_if (error != OMX_ErrorNone);
+
+  for (i = 0; i < AIO_TEST_NREQS * AIO_TEST_REQ_SIZE; i++)
+    {
+      in[i] = (unsigned char) (i * 7);
+    }
+
+  /* Write the chunks, last one first */
+  for (i = 0; i < AIO_TEST_NREQS; i++)
+    {
+      const int chunk = AIO_TEST_NREQS - 1 - i;
+      reqs[i].op = ETIZAioOpWrite;
+      reqs[i].fd = fileno (p_file);
+      reqs[i].p_data = in + chunk * AIO_TEST_REQ_SIZE;
+      reqs[i].nbytes = AIO_TEST_REQ_SIZE;
+      reqs[i].offset = chunk * AIO_TEST_REQ_SIZE;
+      reqs[i].p_cookie = NULL;
+    }
+  fail_if (tiz_aio_submit (p_aio, reqs, AIO_TEST_NREQS) != OMX_ErrorNone);
+  tiz_aio_drain (p_aio);
+  fail_if (tiz_aio_reap (p_aio, done, AIO_TEST_NREQS) != AIO_TEST_NREQS);
+  for (i = 0; i < AIO_TEST_NREQS; i++)
+    {
+      fail_if (done[i].result != AIO_TEST_REQ_SIZE);
+    }
+  /* Consume the notification of the writes */
+  fail_if (tiz_sem_timedwait (&sem, 5000) != OMX_ErrorNone);
+
+  /* Read them back, plus one request past the end of the file */
+  for (i = 0; i < AIO_TEST_NREQS; i++)
+    {
+      reqs[i].op = ETIZAioOpRead;
+      reqs[i].p_data = out + i * AIO_TEST_REQ_SIZE;
+      reqs[i].offset = i * AIO_TEST_REQ_SIZE;
+      reqs[i].p_cookie = (void *) (intptr_t) i;
+    }
+  reqs[AIO_TEST_NREQS - 1].nbytes = 2 * AIO_TEST_REQ_SIZE;
+  fail_if (tiz_aio_submit (p_aio, reqs, AIO_TEST_NREQS) != OMX_ErrorNone);
+  fail_if (aio_test_reap_all (p_aio, &sem, done, AIO_TEST_NREQS)
+           != AIO_TEST_NREQS);
+  for (i = 0; i < AIO_TEST_NREQS; i++)
+    {
+      /* The short read at the end of the file is not an error */
+      fail_if (done[i].error != 0);
+      fail_if (done[i].result != AIO_TEST_REQ_SIZE);
+    }
+  fail_if (memcmp (in, out, sizeof (in)) != 0);
+
+  tiz_aio_destroy (p_aio);
+  (void) tiz_sem_destroy (&sem);
+  fclose (p_file);
+}
+END_TEST
+
+START_TEST (test_aio_cancel)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  tiz_aio_t *p_aio = NULL;
+  tiz_sem_t sem;
+  tiz_aio_req_t reqs[AIO_TEST_NREQS];
+  tiz_aio_req_t done[AIO_TEST_NREQS];
+  static unsigned char data[AIO_TEST_REQ_SIZE];
+  FILE *p_file = tmpfile ();
+  size_t reaped = 0;
+  int i;
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_aio_cancel");
+
+  fail_if (p_file == NULL);
+  fail_if (tiz_sem_init (&sem, 0) != OMX_ErrorNone);
+  error = tiz_aio_init (&p_aio, 1, aio_test_notify, &sem);
+  fail_if (error != OMX_ErrorNone);
+
+  for (i = 0; i < AIO_TEST_NREQS; i++)
+    {
+      reqs[i].op = ETIZAioOpWrite;
+      reqs[i].fd = fileno (p_file);
+      reqs[i].p_data = data;
+      reqs[i].nbytes = AIO_TEST_REQ_SIZE;
+      reqs[i].offset = i * AIO_TEST_REQ_SIZE;
+      reqs[i].p_cookie = NULL;
+    }
+  fail_if (tiz_aio_submit (p_aio, reqs, AIO_TEST_NREQS) != OMX_ErrorNone);
+  tiz_aio_cancel (p_aio);
+
+  /* Every request is accounted for, either written or cancelled */
+  reaped = tiz_aio_reap (p_aio, done, AIO_TEST_NREQS);
+  fail_if (reaped != AIO_TEST_NREQS);
+  for (i = 0; i < AIO_TEST_NREQS; i++)
+    {
+      fail_if (done[i].result != AIO_TEST_REQ_SIZE
+               && done[i].error != ECANCELED);
+    }
+  fail_if (tiz_aio_reap (p_aio, done, AIO_TEST_NREQS) != 0);
+
+  tiz_aio_destroy (p_aio);
+  (void) tiz_sem_destroy (&sem);
+  fclose (p_file);
+}
+END_TEST
+
+START_TEST (test_aio_datasync)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  tiz_aio_t *p_aio = NULL;
+  tiz_sem_t sem;
+  tiz_aio_req_t reqs[2];
+  tiz_aio_req_t done[2];
+  static unsigned char data[AIO_TEST_REQ_SIZE];
+  FILE *p_file = tmpfile ();
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_aio_datasync");
+
+  fail_if (p_file == NULL);
+  fail_if (tiz_sem_init (&sem, 0) != OMX_ErrorNone);
+  error = tiz_aio_init (&p_aio, 1, aio_test_notify, &sem);
+  fail_if (error != OMX_ErrorNone);
+
+  reqs[0].op = ETIZAioOpWrite;
+  reqs[0].fd = fileno (p_file);
+  reqs[0].p_data = data;
+  reqs[0].nbytes = AIO_TEST_REQ_SIZE;
+  reqs[0].offset = 0;
+  reqs[0].p_cookie = (void *) (intptr_t) 0;
+  reqs[1].op = ETIZAioOpDataSync;
+  reqs[1].fd = fileno (p_file);
+  reqs[1].p_data = NULL;
+  reqs[1].nbytes = 0;
+  reqs[1].offset = 0;
+  reqs[1].p_cookie = (void *) (intptr_t) 1;
+  fail_if (tiz_aio_submit (p_aio, reqs, 2) != OMX_ErrorNone);
+  fail_if (aio_test_reap_all (p_aio, &sem, done, 2) != 2);
+
+  /* One worker thread: the sync completes after the write */
+  fail_if ((intptr_t) done[0].p_cookie != 0);
+  fail_if (done[0].result != AIO_TEST_REQ_SIZE);
+  fail_if ((intptr_t) done[1].p_cookie != 1);
+  fail_if (done[1].result != 0 || done[1].error != 0);
+
+  tiz_aio_destroy (p_aio);
+  (void) tiz_sem_destroy (&sem);
+  fclose (p_file);
+}
+END_TEST
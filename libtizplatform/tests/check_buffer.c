@@ -0,0 +1,101 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_buffer.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tests for the dynamic buffer API implementation
+ *
+ *
+ */
+
+START_TEST (test_buffer_seekable_push_and_seek)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  tiz_buffer_t *p_buf = NULL;
+  unsigned char data[64];
+  int i;
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_buffer_seekable_push_and_seek");
+
+  for (i = 0; i < 64; i++)
+    {
+      data[i] = i;
+    }
+
+  error = tiz_buffer_init (&p_buf, 16);
+  fail_if (error != OMX_ErrorNone);
+  fail_if (tiz_buffer_seek_mode (p_buf, TIZ_BUFFER_SEEKABLE) != 0);
+
+  fail_if (tiz_buffer_push (p_buf, data, 32) != 32);
+  fail_if (tiz_buffer_advance (p_buf, 20) != 20);
+  /* Data already read stays in the store */
+  fail_if (tiz_buffer_push (p_buf, data + 32, 32) != 32);
+  fail_if (tiz_buffer_offset (p_buf) != 20);
+  fail_if (tiz_buffer_available (p_buf) != 44);
+
+  fail_if (tiz_buffer_seek (p_buf, 4, TIZ_BUFFER_SEEK_SET) != 0);
+  fail_if (tiz_buffer_available (p_buf) != 60);
+  fail_if (*(unsigned char *) tiz_buffer_get (p_buf) != 4);
+
+  tiz_buffer_destroy (p_buf);
+}
+END_TEST
+
+START_TEST (test_buffer_discard)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  tiz_buffer_t *p_buf = NULL;
+  unsigned char data[64];
+  int i;
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_buffer_discard");
+
+  for (i = 0; i < 64; i++)
+    {
+      data[i] = i;
+    }
+
+  error = tiz_buffer_init (&p_buf, 64);
+  fail_if (error != OMX_ErrorNone);
+  fail_if (tiz_buffer_seek_mode (p_buf, TIZ_BUFFER_SEEKABLE) != 0);
+
+  fail_if (tiz_buffer_push (p_buf, data, 64) != 64);
+  fail_if (tiz_buffer_advance (p_buf, 40) != 40);
+
+  /* Only the data behind the position marker may go */
+  fail_if (tiz_buffer_discard (p_buf, 30) != 30);
+  fail_if (tiz_buffer_offset (p_buf) != 10);
+  fail_if (tiz_buffer_available (p_buf) != 24);
+  fail_if (*(unsigned char *) tiz_buffer_get (p_buf) != 40);
+
+  fail_if (tiz_buffer_discard (p_buf, 100) != 10);
+  fail_if (tiz_buffer_offset (p_buf) != 0);
+  fail_if (tiz_buffer_available (p_buf) != 24);
+  fail_if (*(unsigned char *) tiz_buffer_get (p_buf) != 40);
+
+  /* Nothing behind the marker now */
+  fail_if (tiz_buffer_discard (p_buf, 1) != 0);
+  fail_if (tiz_buffer_seek (p_buf, 0, TIZ_BUFFER_SEEK_SET) != 0);
+  fail_if (tiz_buffer_available (p_buf) != 24);
+
+  tiz_buffer_destroy (p_buf);
+}
+END_TEST
@@ -0,0 +1,82 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_shared.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tests for the process-wide shared objects API
+ *
+ *
+ */
+
+static int g_shared_test_created = 0;
+static int g_shared_test_destroyed = 0;
+static int g_shared_test_obj = 0;
+
+static void *
+shared_test_create (void)
+{
+  g_shared_test_created++;
+  return &g_shared_test_obj;
+}
+
+static int
+shared_test_destroy (void *ap_obj)
+{
+  fail_if (ap_obj != &g_shared_test_obj);
+  g_shared_test_destroyed++;
+  return 0;
+}
+
+START_TEST (test_shared_acquire_and_release)
+{
+  void *p_first = NULL;
+  void *p_second = NULL;
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_shared_acquire_and_release");
+
+  /* The second user gets the object the first one created */
+  p_first = tiz_shared_acquire ("check_shared", shared_test_create,
+                                shared_test_destroy);
+  p_second = tiz_shared_acquire ("check_shared", shared_test_create,
+                                 shared_test_destroy);
+  fail_if (p_first != &g_shared_test_obj);
+  fail_if (p_second != p_first);
+  fail_if (g_shared_test_created != 1);
+
+  /* It only goes away with the last reference */
+  tiz_shared_release ("check_shared");
+  fail_if (g_shared_test_destroyed != 0);
+  tiz_shared_release ("check_shared");
+  fail_if (g_shared_test_destroyed != 1);
+
+  /* And it is created again on demand */
+  p_first = tiz_shared_acquire ("check_shared", shared_test_create,
+                                shared_test_destroy);
+  fail_if (p_first != &g_shared_test_obj);
+  fail_if (g_shared_test_created != 2);
+  tiz_shared_release ("check_shared");
+  fail_if (g_shared_test_destroyed != 2);
+
+  /* Releasing an unknown name is harmless */
+  tiz_shared_release ("check_shared");
+  fail_if (g_shared_test_destroyed != 2);
+}
+END_TEST
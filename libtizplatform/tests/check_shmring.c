@@ -0,0 +1,256 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_shmring.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tests for the shared memory ring API implementation
+ *
+ *
+ */
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#define SHM_RING_TEST_CAPACITY 4096
+#define SHM_RING_TEST_STREAM_BYTES (1024 * 1024 + 17)
+
+static bool
+shm_ring_test_readable (const int a_fd, const int a_timeout_ms)
+{
+  struct pollfd pfd;
+  pfd.fd = a_fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  return poll (&pfd, 1, a_timeout_ms) == 1 && (pfd.revents & POLLIN);
+}
+
+/* Creates a ring and attaches to it as the other process would */
+static void
+shm_ring_test_pair (tiz_shm_ring_t ** app_prod, tiz_shm_ring_t ** app_cons)
+{
+  int socks[2];
+  fail_if (socketpair (AF_UNIX, SOCK_STREAM, 0, socks) != 0);
+  fail_if (tiz_shm_ring_create (app_cons, "check_shmring",
+                                SHM_RING_TEST_CAPACITY)
+           != OMX_ErrorNone);
+  fail_if (tiz_shm_ring_send (*app_cons, socks[0]) != OMX_ErrorNone);
+  fail_if (tiz_shm_ring_receive (app_prod, socks[1]) != OMX_ErrorNone);
+  close (socks[0]);
+  close (socks[1]);
+}
+
+START_TEST (test_shm_ring_send_and_receive)
+{
+  tiz_shm_ring_t *p_prod = NULL;
+  tiz_shm_ring_t *p_cons = NULL;
+  static unsigned char in[3 * SHM_RING_TEST_CAPACITY];
+  static unsigned char out[3 * SHM_RING_TEST_CAPACITY];
+  size_t cap = 0;
+  size_t i = 0;
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_shm_ring_send_and_receive");
+
+  shm_ring_test_pair (&p_prod, &p_cons);
+  cap = tiz_shm_ring_capacity (p_prod);
+  fail_if (cap != tiz_shm_ring_capacity (p_cons));
+  fail_if (cap < SHM_RING_TEST_CAPACITY || (cap & (cap - 1)) != 0);
+  fail_if (cap > SHM_RING_TEST_CAPACITY * 2);
+
+  for (i = 0; i < sizeof (in); i++)
+    {
+      in[i] = (unsigned char) (i * 13);
+    }
+
+  /* An empty ring asks for a wake-up, which the next write delivers */
+  fail_if (tiz_shm_ring_read (p_cons, out, 1) != 0);
+  fail_if (shm_ring_test_readable (tiz_shm_ring_data_fd (p_cons), 0));
+  fail_if (tiz_shm_ring_write (p_prod, in, 100) != 100);
+  fail_if (!shm_ring_test_readable (tiz_shm_ring_data_fd (p_cons), 0));
+  fail_if (tiz_shm_ring_read (p_cons, out, sizeof (out)) != 100);
+  fail_if (memcmp (in, out, 100) != 0);
+
+  /* Fill it across the end of the buffer */
+  fail_if (tiz_shm_ring_write (p_prod, in, sizeof (in)) != cap);
+  fail_if (tiz_shm_ring_write (p_prod, in, 1) != 0);
+  fail_if (shm_ring_test_readable (tiz_shm_ring_space_fd (p_prod), 0));
+  fail_if (tiz_shm_ring_read (p_cons, out, 10) != 10);
+  fail_if (!shm_ring_test_readable (tiz_shm_ring_space_fd (p_prod), 0));
+  fail_if (tiz_shm_ring_read (p_cons, out + 10, sizeof (out)) != cap - 10);
+  fail_if (memcmp (in, out, cap) != 0);
+
+  /* The end of the stream is only seen once the data has been read */
+  fail_if (tiz_shm_ring_write (p_prod, in, 5) != 5);
+  tiz_shm_ring_close (p_prod);
+  fail_if (tiz_shm_ring_eos (p_cons));
+  fail_if (!shm_ring_test_readable (tiz_shm_ring_data_fd (p_cons), 0));
+  fail_if (tiz_shm_ring_read (p_cons, out, sizeof (out)) != 5);
+  fail_if (!tiz_shm_ring_eos (p_cons));
+
+  tiz_shm_ring_destroy (p_prod);
+  tiz_shm_ring_destroy (p_cons);
+}
+END_TEST
+
+START_TEST (test_shm_ring_bad_message)
+{
+  tiz_shm_ring_t *p_ring = NULL;
+  int socks[2];
+  const char junk[] = "not a ring";
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_shm_ring_bad_message");
+
+  fail_if (socketpair (AF_UNIX, SOCK_STREAM, 0, socks) != 0);
+  fail_if (write (socks[0], junk, sizeof (junk)) != sizeof (junk));
+  fail_if (tiz_shm_ring_receive (&p_ring, socks[1]) == OMX_ErrorNone);
+  fail_if (p_ring != NULL);
+  close (socks[0]);
+  close (socks[1]);
+}
+END_TEST
+
+START_TEST (test_shm_ring_wrong_fds)
+{
+  tiz_shm_ring_t *p_ring = NULL;
+  int socks[2];
+  int pipe_fds[2];
+  int first_free = -1;
+  char byte = 0;
+  struct msghdr msg;
+  struct iovec iov;
+  union
+  {
+    char buf[CMSG_SPACE (sizeof (int))];
+    struct cmsghdr align;
+  } ctrl;
+  struct cmsghdr *p_cmsg = NULL;
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_shm_ring_wrong_fds");
+
+  fail_if (socketpair (AF_UNIX, SOCK_STREAM, 0, socks) != 0);
+  fail_if (pipe (pipe_fds) != 0);
+
+  /* A single descriptor instead of the three the ring needs */
+  memset (&msg, 0, sizeof (msg));
+  memset (&ctrl, 0, sizeof (ctrl));
+  iov.iov_base = &byte;
+  iov.iov_len = sizeof (byte);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl.buf;
+  msg.msg_controllen = sizeof (ctrl.buf);
+  p_cmsg = CMSG_FIRSTHDR (&msg);
+  p_cmsg->cmsg_level = SOL_SOCKET;
+  p_cmsg->cmsg_type = SCM_RIGHTS;
+  p_cmsg->cmsg_len = CMSG_LEN (sizeof (int));
+  memcpy (CMSG_DATA (p_cmsg), &pipe_fds[0], sizeof (int));
+  fail_if (sendmsg (socks[0], &msg, 0) != sizeof (byte));
+  close (pipe_fds[0]);
+
+  /* The received descriptor takes the lowest free number */
+  first_free = dup (socks[1]);
+  fail_if (first_free < 0);
+  close (first_free);
+
+  fail_if (tiz_shm_ring_receive (&p_ring, socks[1]) == OMX_ErrorNone);
+  fail_if (p_ring != NULL);
+  fail_if (fcntl (first_free, F_GETFD) != -1);
+
+  close (pipe_fds[1]);
+  close (socks[0]);
+  close (socks[1]);
+}
+END_TEST
+
+static void *
+shm_ring_test_producer (void *ap_arg)
+{
+  tiz_shm_ring_t *p_prod = ap_arg;
+  unsigned char chunk[1000];
+  size_t sent = 0;
+
+  while (sent < SHM_RING_TEST_STREAM_BYTES)
+    {
+      const size_t len = MIN (sizeof (chunk), SHM_RING_TEST_STREAM_BYTES - sent);
+      size_t done = 0;
+      size_t i = 0;
+      for (i = 0; i < len; i++)
+        {
+          chunk[i] = (unsigned char) ((sent + i) % 251);
+        }
+      while (done < len)
+        {
+          const size_t n = tiz_shm_ring_write (p_prod, chunk + done,
+                                               len - done);
+          if (0 == n)
+            {
+              (void) shm_ring_test_readable (tiz_shm_ring_space_fd (p_prod),
+                                             1000);
+            }
+          done += n;
+        }
+      sent += len;
+    }
+  tiz_shm_ring_close (p_prod);
+  return NULL;
+}
+
+START_TEST (test_shm_ring_stream)
+{
+  tiz_shm_ring_t *p_prod = NULL;
+  tiz_shm_ring_t *p_cons = NULL;
+  tiz_thread_t thread;
+  void *p_result = NULL;
+  unsigned char buf[777];
+  size_t received = 0;
+  bool corrupted = false;
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_shm_ring_stream");
+
+  shm_ring_test_pair (&p_prod, &p_cons);
+  fail_if (tiz_thread_create (&thread, 0, 0, shm_ring_test_producer, p_prod)
+           != OMX_ErrorNone);
+
+  while (!tiz_shm_ring_eos (p_cons))
+    {
+      const size_t n = tiz_shm_ring_read (p_cons, buf, sizeof (buf));
+      size_t i = 0;
+      if (0 == n)
+        {
+          (void) shm_ring_test_readable (tiz_shm_ring_data_fd (p_cons), 1000);
+        }
+      for (i = 0; i < n; i++)
+        {
+          corrupted |= buf[i] != (unsigned char) ((received + i) % 251);
+        }
+      received += n;
+    }
+
+  fail_if (tiz_thread_join (&thread, &p_result) != OMX_ErrorNone);
+  fail_if (corrupted);
+  fail_if (received != SHM_RING_TEST_STREAM_BYTES);
+
+  tiz_shm_ring_destroy (p_prod);
+  tiz_shm_ring_destroy (p_cons);
+}
+END_TEST
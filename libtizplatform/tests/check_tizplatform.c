@@ -46,11 +46,15 @@
 #include "./check_queue.c"
 #include "./check_pqueue.c"
 #include "./check_vector.c"
+#include "./check_buffer.c"
 #include "./check_rc.c"
 #include "./check_soa.c"
 #include "./check_event.c"
 #include "./check_http_parser.c"
 #include "./check_map.c"
+#include "./check_aio.c"
+#include "./check_shmring.c"
+#include "./check_shared.c"
 
 #define EVENT_API_TEST_TIMEOUT 100
 
@@ -145,6 +149,21 @@ platform_vector_suite (void)
   return s;
 }
 
+Suite *
+platform_buffer_suite (void)
+{
+  TCase *tc_buffer = NULL;
+  Suite *s = suite_create ("Dynamic buffer implementation");
+
+  /* buffer API test case */
+  tc_buffer = tcase_create ("buffer");
+  tcase_add_test (tc_buffer, test_buffer_seekable_push_and_seek);
+  tcase_add_test (tc_buffer, test_buffer_discard);
+  suite_add_tcase (s, tc_buffer);
+
+  return s;
+}
+
 Suite *
 platform_rcfile_suite (void)
 {
@@ -227,6 +246,53 @@ platform_map_suite (void)
 
 }
 
+Suite *
+platform_aio_suite (void)
+{
+  TCase *tc_aio = NULL;
+  Suite *s = suite_create ("Asynchronous file I/O");
+
+  /* aio API test case */
+  tc_aio = tcase_create ("aio");
+  tcase_add_test (tc_aio, test_aio_write_then_read);
+  tcase_add_test (tc_aio, test_aio_cancel);
+  tcase_add_test (tc_aio, test_aio_datasync);
+  suite_add_tcase (s, tc_aio);
+
+  return s;
+}
+
+Suite *
+platform_shm_ring_suite (void)
+{
+  TCase *tc_shm_ring = NULL;
+  Suite *s = suite_create ("Shared memory ring");
+
+  /* shm ring API test case */
+  tc_shm_ring = tcase_create ("shm ring");
+  tcase_add_test (tc_shm_ring, test_shm_ring_send_and_receive);
+  tcase_add_test (tc_shm_ring, test_shm_ring_bad_message);
+  tcase_add_test (tc_shm_ring, test_shm_ring_wrong_fds);
+  tcase_add_test (tc_shm_ring, test_shm_ring_stream);
+  suite_add_tcase (s, tc_shm_ring);
+
+  return s;
+}
+
+Suite *
+platform_shared_suite (void)
+{
+  TCase *tc_shared = NULL;
+  Suite *s = suite_create ("Shared objects");
+
+  /* shared objects API test case */
+  tc_shared = tcase_create ("shared objects");
+  tcase_add_test (tc_shared, test_shared_acquire_and_release);
+  suite_add_tcase (s, tc_shared);
+
+  return s;
+}
+
 int
 main (void)
 {
@@ -242,10 +308,14 @@ main (void)
   srunner_add_suite (sr, platform_queue_suite ());
   srunner_add_suite (sr, platform_pqueue_suite ());
   srunner_add_suite (sr, platform_vector_suite ());
+  srunner_add_suite (sr, platform_buffer_suite ());
   srunner_add_suite (sr, platform_rcfile_suite ());
   srunner_add_suite (sr, platform_soa_suite ());
   srunner_add_suite (sr, platform_http_parser_suite ());
   srunner_add_suite (sr, platform_map_suite ());
+  srunner_add_suite (sr, platform_aio_suite ());
+  srunner_add_suite (sr, platform_shm_ring_suite ());
+  srunner_add_suite (sr, platform_shared_suite ());
 /*   srunner_add_suite (sr, platform_event_suite ()); */
   srunner_run_all (sr, CK_VERBOSE);
   number_failed = srunner_ntests_failed (sr);
@@ -30,10 +30,17 @@
 #include <config.h>
 #endif
 
+#include <string.h>
+
+#include <OMX_TizoniaExt.h>
+
 #include "tizgraph.hpp"
 #include "tizgraphfsm.hpp"
 #include "tizgraphcmd.hpp"
 #include "tizgraphops.hpp"
+#include "tizgraphutil.hpp"
+#include "tizloudness.hpp"
+#include "tizprobe.hpp"
 
 #include "tizdecgraph.hpp"
 
@@ -126,3 +133,58 @@ bool graph::decops::is_disabled_evt_required () const
   // disabled in the graph. See comment in do_disable_comp_ports.
   return false;
 }
+
+void graph::decops::normalize_loudness ()
+{
+  const OMX_TIZONIA_AUDIO_REPLAYGAINMODETYPE mode
+      = tiz::graph::util::get_replaygain_mode ();
+  if (OMX_AUDIO_ReplayGainModeOff == mode || !probe_ptr_ || handles_.empty ())
+  {
+    return;
+  }
+
+  OMX_TIZONIA_AUDIO_CONFIG_REPLAYGAINTYPE replaygain;
+  memset (&replaygain, 0, sizeof (replaygain));
+  replaygain.eMode = mode;
+  replaygain.nPreamp = static_cast< OMX_S32 > (
+      tiz::graph::util::get_replaygain_preamp () * 100.0);
+  replaygain.bPreventClipping = OMX_TRUE;
+
+  // Tags take precedence; otherwise fall back to whatever the background
+  // analyzer has measured for this file. Tracks with no loudness info at all
+  // are played at unity gain.
+  double gain = 0.0;
+  double peak = 0.0;
+  tiz::loudness::info info;
+  if (probe_ptr_->replaygain_track (gain, peak))
+  {
+    replaygain.bTrackGainValid = OMX_TRUE;
+    replaygain.nTrackGain = static_cast< OMX_S32 > (gain * 100.0);
+    replaygain.nTrackPeak = static_cast< OMX_U32 > (peak * 65536.0);
+  }
+  else if (tiz::loudness::db::instance ().lookup (probe_ptr_->get_uri (),
+                                                 info))
+  {
+    replaygain.bTrackGainValid = OMX_TRUE;
+    replaygain.nTrackGain = static_cast< OMX_S32 > (info.gain_ * 100.0);
+    replaygain.nTrackPeak = static_cast< OMX_U32 > (info.peak_ * 65536.0);
+  }
+
+  if (probe_ptr_->replaygain_album (gain, peak))
+  {
+    replaygain.bAlbumGainValid = OMX_TRUE;
+    replaygain.nAlbumGain = static_cast< OMX_S32 > (gain * 100.0);
+    replaygain.nAlbumPeak = static_cast< OMX_U32 > (peak * 65536.0);
+  }
+
+  // The renderer is the last component in all the decoding graphs
+  const OMX_U32 input_port = 0;
+  const OMX_ERRORTYPE rc = tiz::graph::util::apply_replaygain (
+      handles_.back (), input_port, replaygain);
+  if (OMX_ErrorNone != rc)
+  {
+    // Not fatal; the track is simply played without normalization
+    TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : unable to apply replaygain",
+             tiz_err_to_str (rc));
+  }
+}
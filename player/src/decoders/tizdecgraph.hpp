@@ -64,6 +64,9 @@ namespace tiz
     public:
       void do_disable_comp_ports (const int comp_id, const int port_id);
       bool is_disabled_evt_required () const;
+
+    protected:
+      void normalize_loudness ();
     };
 
   }  // namespace graph
@@ -44,12 +44,14 @@ namespace tiz
     public:
       httpservconfig (const tizplaylist_ptr_t &playlist, const std::string &host,
                       const std::string &ip_address, const long int port,
+                      const int max_clients,
                       const std::vector<int> &sampling_rate_list,
                       const std::vector< std::string > &bitrate_mode_list,
                       const std::string &station_name,
                       const std::string &station_genre,
                       const bool &icy_metadata_enabled)
         : config (playlist), host_ (host), addr_ (ip_address), port_ (port),
+          max_clients_ (max_clients),
           sampling_rate_list_ (sampling_rate_list), bitrate_mode_list_ (bitrate_mode_list),
           station_name_ (station_name), station_genre_ (station_genre),
           icy_metadata_enabled_ (icy_metadata_enabled)
@@ -75,6 +77,11 @@ namespace tiz
         return port_;
       }
 
+      int get_max_clients () const
+      {
+        return max_clients_;
+      }
+
       const std::vector<int> &get_sampling_rates () const
       {
         return sampling_rate_list_;
@@ -104,6 +111,7 @@ namespace tiz
       const std::string host_;
       const std::string addr_;
       const long int port_;
+      const int max_clients_;
       const std::vector<int> sampling_rate_list_;
       const std::vector< std::string > bitrate_mode_list_;
       const std::string station_name_;
@@ -1018,6 +1018,8 @@ graph::ops::probe_stream (const OMX_PORTDOMAINTYPE omx_domain,
         do_ack_metadata ();
       }
 
+      normalize_loudness ();
+
       // Everything went well..
       rc = OMX_ErrorNone;
     }
@@ -1033,6 +1035,12 @@ bool graph::ops::probe_stream_hook ()
   return true;
 }
 
+void graph::ops::normalize_loudness ()
+{
+  // Default implementation. Graphs that end in a pcm renderer override this
+  // to configure the ReplayGain settings for the track just probed.
+}
+
 OMX_ERRORTYPE
 graph::ops::transition_source (const OMX_STATETYPE to_state)
 {
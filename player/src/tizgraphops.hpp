@@ -216,6 +216,7 @@ namespace tiz
           stream_info_dump_func_t stream_info_dump_f, const bool quiet = false);
 
       virtual bool probe_stream_hook ();
+      virtual void normalize_loudness ();
       virtual OMX_ERRORTYPE transition_source (const OMX_STATETYPE to_state);
       virtual OMX_ERRORTYPE transition_comp (const int comp_id,
                                              const OMX_STATETYPE to_state);
@@ -29,6 +29,8 @@
 #include <config.h>
 #endif
 
+#include <stdlib.h>
+
 #include <boost/foreach.hpp>
 #include <string>
 
@@ -540,6 +542,20 @@ graph::util::apply_mute (const OMX_HANDLETYPE handle, const OMX_U32 pid)
   return rc;
 }
 
+OMX_ERRORTYPE
+graph::util::apply_replaygain (
+    const OMX_HANDLETYPE handle, const OMX_U32 pid,
+    OMX_TIZONIA_AUDIO_CONFIG_REPLAYGAINTYPE &replaygain)
+{
+  replaygain.nSize = sizeof (OMX_TIZONIA_AUDIO_CONFIG_REPLAYGAINTYPE);
+  replaygain.nVersion.nVersion = OMX_VERSION;
+  replaygain.nPortIndex = pid;
+  return OMX_SetConfig (
+      handle,
+      static_cast< OMX_INDEXTYPE > (OMX_TizoniaIndexConfigAudioReplayGain),
+      &replaygain);
+}
+
 OMX_ERRORTYPE
 graph::util::apply_playlist_jump (const OMX_HANDLETYPE handle,
                                   const OMX_S32 jump)
@@ -1075,6 +1091,54 @@ bool graph::util::is_mpris_enabled ()
   return is_enabled;
 }
 
+OMX_TIZONIA_AUDIO_REPLAYGAINMODETYPE
+graph::util::get_replaygain_mode ()
+{
+  OMX_TIZONIA_AUDIO_REPLAYGAINMODETYPE mode = OMX_AUDIO_ReplayGainModeOff;
+  const char *p_mode = tiz_rcfile_get_value ("tizonia", "replaygain-mode");
+  if (p_mode)
+  {
+    std::string mode_str;
+    mode_str.assign (p_mode);
+    if (mode_str.compare ("track") == 0)
+    {
+      mode = OMX_AUDIO_ReplayGainModeTrack;
+    }
+    else if (mode_str.compare ("album") == 0)
+    {
+      mode = OMX_AUDIO_ReplayGainModeAlbum;
+    }
+  }
+  return mode;
+}
+
+double graph::util::get_replaygain_preamp ()
+{
+  double preamp = 0.0;
+  const char *p_preamp
+      = tiz_rcfile_get_value ("tizonia", "replaygain-preamp");
+  if (p_preamp)
+  {
+    preamp = strtod (p_preamp, NULL);
+  }
+  return preamp;
+}
+
+unsigned int graph::util::get_replaygain_analyzer_threads ()
+{
+  // Two analyzer threads, unless configured otherwise; zero disables the
+  // background analysis.
+  unsigned int nthreads = 2;
+  const char *p_nthreads
+      = tiz_rcfile_get_value ("tizonia", "replaygain-analyzer-threads");
+  if (p_nthreads)
+  {
+    const long value = strtol (p_nthreads, NULL, 10);
+    nthreads = value > 0 ? static_cast< unsigned int > (value) : 0;
+  }
+  return nthreads;
+}
+
 void graph::util::copy_omx_string (
     OMX_U8 *p_dest, const std::string &omx_string,
     const size_t max_length /*  = OMX_MAX_STRINGNAME_SIZE */
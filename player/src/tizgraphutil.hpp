@@ -117,6 +117,10 @@ namespace tiz
       static OMX_ERRORTYPE apply_mute (const OMX_HANDLETYPE handle,
                                        const OMX_U32 pid);
 
+      static OMX_ERRORTYPE apply_replaygain (
+          const OMX_HANDLETYPE handle, const OMX_U32 pid,
+          OMX_TIZONIA_AUDIO_CONFIG_REPLAYGAINTYPE &replaygain);
+
       static OMX_ERRORTYPE apply_playlist_jump (const OMX_HANDLETYPE handle,
                                                 const OMX_S32 jump);
 
@@ -239,6 +243,12 @@ namespace tiz
 
       static bool is_mpris_enabled ();
 
+      static OMX_TIZONIA_AUDIO_REPLAYGAINMODETYPE get_replaygain_mode ();
+
+      static double get_replaygain_preamp ();
+
+      static unsigned int get_replaygain_analyzer_threads ();
+
       static void copy_omx_string (OMX_U8 *p_dest,
                                    const std::string &omx_string,
                                    const size_t max_length
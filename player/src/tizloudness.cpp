@@ -0,0 +1,572 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizloudness.cpp
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  EBU R128 loudness analysis and persistent loudness database
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+
+#include <sndfile.h>
+
+#include <fileref.h>
+#include <tpropertymap.h>
+
+#include "tizloudness.hpp"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.play.loudness"
+#endif
+
+#define LOUDNESS_ABSOLUTE_GATE_LUFS -70.0
+#define LOUDNESS_RELATIVE_GATE_LU -10.0
+#define LOUDNESS_ANALYZER_CHUNK_FRAMES 4096
+#define LOUDNESS_DB_SAVE_INTERVAL 16
+
+namespace loudness = tiz::loudness;
+
+namespace
+{
+  const double pi = 3.14159265358979323846;
+
+  inline double energy_to_lufs (const double energy)
+  {
+    return -0.691 + 10.0 * log10 (energy);
+  }
+
+  inline double lufs_to_energy (const double lufs)
+  {
+    return pow (10.0, (lufs + 0.691) / 10.0);
+  }
+
+  std::string cache_dir ()
+  {
+    const char *p_xdg = getenv ("XDG_CACHE_HOME");
+    if (p_xdg && strlen (p_xdg) > 0)
+    {
+      return std::string (p_xdg).append ("/tizonia");
+    }
+    const char *p_home = getenv ("HOME");
+    return std::string (p_home ? p_home : "/tmp").append ("/.cache/tizonia");
+  }
+}
+
+//
+// meter
+//
+loudness::meter::meter (const unsigned int sample_rate,
+                        const unsigned int channels)
+  : channels_ (channels),
+    sub_block_frames_ (std::max (sample_rate / 10, 1U)),
+    sub_block_count_ (0),
+    state_ (channels * 8, 0.0),
+    weights_ (channels, 1.0),
+    sub_block_energy_ (0.0),
+    sub_blocks_ (),
+    blocks_ (),
+    peak_ (0.0)
+{
+  const double fs = sample_rate;
+
+  // K-weighting, stage 1: high-shelf modelling the acoustic effect of the
+  // head (BS.1770-4). Coefficients re-derived for the actual sample rate.
+  {
+    const double f0 = 1681.974450955533;
+    const double G = 3.999843853973347;
+    const double Q = 0.7071752369554196;
+    const double K = tan (pi * f0 / fs);
+    const double Vh = pow (10.0, G / 20.0);
+    const double Vb = pow (Vh, 0.4996667741545416);
+    const double a0 = 1.0 + K / Q + K * K;
+    shelf_.b0_ = (Vh + Vb * K / Q + K * K) / a0;
+    shelf_.b1_ = 2.0 * (K * K - Vh) / a0;
+    shelf_.b2_ = (Vh - Vb * K / Q + K * K) / a0;
+    shelf_.a1_ = 2.0 * (K * K - 1.0) / a0;
+    shelf_.a2_ = (1.0 - K / Q + K * K) / a0;
+  }
+
+  // K-weighting, stage 2: RLB high-pass
+  {
+    const double f0 = 38.13547087602444;
+    const double Q = 0.5003270373238773;
+    const double K = tan (pi * f0 / fs);
+    const double a0 = 1.0 + K / Q + K * K;
+    highpass_.b0_ = 1.0;
+    highpass_.b1_ = -2.0;
+    highpass_.b2_ = 1.0;
+    highpass_.a1_ = 2.0 * (K * K - 1.0) / a0;
+    highpass_.a2_ = (1.0 - K / Q + K * K) / a0;
+  }
+
+  // Channel weights for 5.0 / 5.1 layouts: surrounds +1.5 dB, LFE ignored
+  if (5 == channels_)
+  {
+    weights_[3] = weights_[4] = 1.41;
+  }
+  else if (6 == channels_)
+  {
+    weights_[3] = 0.0;
+    weights_[4] = weights_[5] = 1.41;
+  }
+}
+
+void loudness::meter::add_frames (const float *p_frames, const size_t nframes)
+{
+  assert (p_frames);
+  for (size_t i = 0; i < nframes; ++i)
+  {
+    for (unsigned int c = 0; c < channels_; ++c)
+    {
+      const double x = p_frames[i * channels_ + c];
+      const double ax = fabs (x);
+      if (ax > peak_)
+      {
+        peak_ = ax;
+      }
+
+      if (weights_[c] > 0.0)
+      {
+        double *s = &state_[c * 8];
+        const double y1 = shelf_.b0_ * x + shelf_.b1_ * s[0]
+                          + shelf_.b2_ * s[1] - shelf_.a1_ * s[2]
+                          - shelf_.a2_ * s[3];
+        s[1] = s[0];
+        s[0] = x;
+        s[3] = s[2];
+        s[2] = y1;
+
+        const double y2 = highpass_.b0_ * y1 + highpass_.b1_ * s[4]
+                          + highpass_.b2_ * s[5] - highpass_.a1_ * s[6]
+                          - highpass_.a2_ * s[7];
+        s[5] = s[4];
+        s[4] = y1;
+        s[7] = s[6];
+        s[6] = y2;
+
+        sub_block_energy_ += weights_[c] * y2 * y2;
+      }
+    }
+
+    if (++sub_block_count_ == sub_block_frames_)
+    {
+      end_sub_block ();
+    }
+  }
+}
+
+void loudness::meter::end_sub_block ()
+{
+  // 400 ms gating blocks with 75% overlap are built out of four consecutive
+  // 100 ms sub-blocks.
+  sub_blocks_.push_back (sub_block_energy_ / sub_block_frames_);
+  if (sub_blocks_.size () > 4)
+  {
+    sub_blocks_.pop_front ();
+  }
+  if (4 == sub_blocks_.size ())
+  {
+    double energy = 0.0;
+    for (std::deque< double >::const_iterator it = sub_blocks_.begin ();
+         it != sub_blocks_.end (); ++it)
+    {
+      energy += *it;
+    }
+    blocks_.push_back (energy / 4.0);
+  }
+  sub_block_energy_ = 0.0;
+  sub_block_count_ = 0;
+}
+
+bool loudness::meter::integrated (double &lufs) const
+{
+  const double abs_gate = lufs_to_energy (LOUDNESS_ABSOLUTE_GATE_LUFS);
+  double sum = 0.0;
+  size_t count = 0;
+
+  for (std::vector< double >::const_iterator it = blocks_.begin ();
+       it != blocks_.end (); ++it)
+  {
+    if (*it > abs_gate)
+    {
+      sum += *it;
+      ++count;
+    }
+  }
+
+  if (0 == count)
+  {
+    return false;
+  }
+
+  const double rel_gate
+      = std::max (abs_gate, (sum / count)
+                                * pow (10.0, LOUDNESS_RELATIVE_GATE_LU / 10.0));
+  sum = 0.0;
+  count = 0;
+  for (std::vector< double >::const_iterator it = blocks_.begin ();
+       it != blocks_.end (); ++it)
+  {
+    if (*it > rel_gate)
+    {
+      sum += *it;
+      ++count;
+    }
+  }
+
+  if (0 == count)
+  {
+    return false;
+  }
+
+  lufs = energy_to_lufs (sum / count);
+  return true;
+}
+
+double loudness::meter::peak () const
+{
+  return peak_;
+}
+
+//
+// db
+//
+loudness::db &loudness::db::instance ()
+{
+  static db the_db;
+  return the_db;
+}
+
+loudness::db::db ()
+  : path_ (cache_dir ().append ("/loudness.db")), entries_ (), dirty_ (false)
+{
+  (void)tiz_mutex_init (&mutex_);
+  (void)tiz_mutex_init (&save_mutex_);
+  load ();
+}
+
+loudness::db::~db ()
+{
+  save ();
+  tiz_mutex_destroy (&save_mutex_);
+  tiz_mutex_destroy (&mutex_);
+}
+
+bool loudness::db::file_mtime (const std::string &uri, long &mtime)
+{
+  struct stat st;
+  if (0 != stat (uri.c_str (), &st))
+  {
+    return false;
+  }
+  mtime = static_cast< long >(st.st_mtime);
+  return true;
+}
+
+void loudness::db::load ()
+{
+  // One entry per line: <mtime> <gain> <peak> <path>
+  std::ifstream in (path_.c_str ());
+  std::string line;
+  while (in && std::getline (in, line))
+  {
+    std::istringstream fields (line);
+    entry e;
+    std::string path;
+    if (fields >> e.mtime_ >> e.info_.gain_ >> e.info_.peak_)
+    {
+      fields.get ();  // skip the separator
+      std::getline (fields, path);
+      if (!path.empty ())
+      {
+        entries_[path] = e;
+      }
+    }
+  }
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s] : %lu entries", path_.c_str (),
+           (unsigned long)entries_.size ());
+}
+
+bool loudness::db::lookup (const std::string &uri, info &result)
+{
+  bool found = false;
+  long mtime = 0;
+  if (file_mtime (uri, mtime))
+  {
+    (void)tiz_mutex_lock (&mutex_);
+    entry_map_t::const_iterator it = entries_.find (uri);
+    if (it != entries_.end () && it->second.mtime_ == mtime)
+    {
+      result = it->second.info_;
+      found = true;
+    }
+    (void)tiz_mutex_unlock (&mutex_);
+  }
+  return found;
+}
+
+void loudness::db::store (const std::string &uri, const info &result)
+{
+  entry e;
+  if (file_mtime (uri, e.mtime_))
+  {
+    e.info_ = result;
+    (void)tiz_mutex_lock (&mutex_);
+    entries_[uri] = e;
+    dirty_ = true;
+    (void)tiz_mutex_unlock (&mutex_);
+  }
+}
+
+void loudness::db::save ()
+{
+  // The analyzer threads and stop () may save at the same time. Saves are
+  // done one at a time, and the snapshot is taken inside, so the last save
+  // to finish always writes the latest entries.
+  entry_map_t snapshot;
+  (void)tiz_mutex_lock (&save_mutex_);
+  (void)tiz_mutex_lock (&mutex_);
+  if (dirty_)
+  {
+    snapshot = entries_;
+    dirty_ = false;
+  }
+  (void)tiz_mutex_unlock (&mutex_);
+
+  if (!snapshot.empty ())
+  {
+    write (snapshot);
+  }
+  (void)tiz_mutex_unlock (&save_mutex_);
+}
+
+void loudness::db::write (const entry_map_t &snapshot)
+{
+  boost::system::error_code ec;
+  boost::filesystem::create_directories (
+      boost::filesystem::path (path_).parent_path (), ec);
+
+  // Write to a temporary file first so that a crash never leaves a
+  // truncated db behind.
+  const std::string tmp_path (std::string (path_).append (".tmp"));
+  {
+    std::ofstream out (tmp_path.c_str (), std::ios::trunc);
+    if (!out)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : unable to open for writing",
+               tmp_path.c_str ());
+      return;
+    }
+    out.precision (6);
+    out << std::fixed;
+    for (entry_map_t::const_iterator it = snapshot.begin ();
+         it != snapshot.end (); ++it)
+    {
+      out << it->second.mtime_ << " " << it->second.info_.gain_ << " "
+          << it->second.info_.peak_ << " " << it->first << "\n";
+    }
+  }
+
+  if (0 != rename (tmp_path.c_str (), path_.c_str ()))
+  {
+    TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : rename failed", path_.c_str ());
+  }
+}
+
+//
+// analyzer
+//
+void *loudness::analyzer_thread_func (void *p_arg)
+{
+  analyzer *p_analyzer = static_cast< analyzer * >(p_arg);
+  std::string uri;
+
+  assert (p_analyzer);
+
+  while (p_analyzer->next_uri (uri))
+  {
+    info result;
+    if (analyzer::has_replaygain_tags (uri)
+        || db::instance ().lookup (uri, result))
+    {
+      continue;
+    }
+
+    if (p_analyzer->analyze (uri, result))
+    {
+      TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s] : gain %.2f dB peak %.6f",
+               uri.c_str (), result.gain_, result.peak_);
+      db::instance ().store (uri, result);
+
+      bool save_now = false;
+      tiz_check_omx_ret_null (tiz_mutex_lock (&(p_analyzer->mutex_)));
+      save_now = (0 == (++(p_analyzer->analyzed_) % LOUDNESS_DB_SAVE_INTERVAL));
+      tiz_check_omx_ret_null (tiz_mutex_unlock (&(p_analyzer->mutex_)));
+      if (save_now)
+      {
+        db::instance ().save ();
+      }
+    }
+  }
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "analyzer thread exiting...");
+  return NULL;
+}
+
+loudness::analyzer::analyzer (const uri_lst_t &uri_list,
+                              const unsigned int nthreads)
+  : pending_ (uri_list.rbegin (), uri_list.rend ()),
+    nthreads_ (nthreads),
+    threads_ (),
+    stopping_ (false),
+    analyzed_ (0)
+{
+  // pending_ is kept in reverse order so that next_uri can pop from the
+  // back and still hand out tracks in playback order.
+  (void)tiz_mutex_init (&mutex_);
+}
+
+loudness::analyzer::~analyzer ()
+{
+  stop ();
+  tiz_mutex_destroy (&mutex_);
+}
+
+OMX_ERRORTYPE
+loudness::analyzer::start ()
+{
+  for (unsigned int i = 0; i < nthreads_; ++i)
+  {
+    tiz_thread_t thread;
+    tiz_check_omx (
+        tiz_thread_create (&thread, 0, 0, analyzer_thread_func, this));
+    threads_.push_back (thread);
+  }
+  return OMX_ErrorNone;
+}
+
+void loudness::analyzer::stop ()
+{
+  (void)tiz_mutex_lock (&mutex_);
+  stopping_ = true;
+  (void)tiz_mutex_unlock (&mutex_);
+
+  for (std::vector< tiz_thread_t >::iterator it = threads_.begin ();
+       it != threads_.end (); ++it)
+  {
+    void *p_result = NULL;
+    tiz_thread_join (&(*it), &p_result);
+  }
+  threads_.clear ();
+  db::instance ().save ();
+}
+
+bool loudness::analyzer::next_uri (std::string &uri)
+{
+  bool found = false;
+  (void)tiz_mutex_lock (&mutex_);
+  if (!stopping_ && !pending_.empty ())
+  {
+    uri = pending_.back ();
+    pending_.pop_back ();
+    found = true;
+  }
+  (void)tiz_mutex_unlock (&mutex_);
+  return found;
+}
+
+bool loudness::analyzer::is_stopping ()
+{
+  bool stopping = true;
+  (void)tiz_mutex_lock (&mutex_);
+  stopping = stopping_;
+  (void)tiz_mutex_unlock (&mutex_);
+  return stopping;
+}
+
+bool loudness::analyzer::has_replaygain_tags (const std::string &uri)
+{
+  TagLib::FileRef file_ref (uri.c_str ());
+  if (file_ref.isNull () || !file_ref.file ())
+  {
+    return false;
+  }
+  return file_ref.file ()->properties ().contains ("REPLAYGAIN_TRACK_GAIN");
+}
+
+bool loudness::analyzer::analyze (const std::string &uri, info &result)
+{
+  SF_INFO sf_info;
+  memset (&sf_info, 0, sizeof (sf_info));
+  SNDFILE *p_sf = sf_open (uri.c_str (), SFM_READ, &sf_info);
+  if (!p_sf)
+  {
+    // Not a format libsndfile can decode; nothing to measure.
+    return false;
+  }
+
+  if (sf_info.channels <= 0 || sf_info.samplerate <= 0)
+  {
+    sf_close (p_sf);
+    return false;
+  }
+
+  meter m (sf_info.samplerate, sf_info.channels);
+  std::vector< float > frames (LOUDNESS_ANALYZER_CHUNK_FRAMES
+                               * sf_info.channels);
+  sf_count_t nframes = 0;
+  while (!is_stopping () && (nframes = sf_readf_float (
+                                 p_sf, &frames[0],
+                                 LOUDNESS_ANALYZER_CHUNK_FRAMES)) > 0)
+  {
+    m.add_frames (&frames[0], static_cast< size_t >(nframes));
+  }
+  sf_close (p_sf);
+
+  double lufs = 0.0;
+  if (is_stopping () || !m.integrated (lufs))
+  {
+    return false;
+  }
+
+  result.gain_ = reference_lufs - lufs;
+  result.peak_ = m.peak ();
+  return true;
+}
@@ -0,0 +1,168 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizloudness.hpp
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  EBU R128 loudness analysis and persistent loudness database
+ *
+ *
+ */
+
+#ifndef TIZLOUDNESS_HPP
+#define TIZLOUDNESS_HPP
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <OMX_Core.h>
+
+#include <tizplatform.h>
+
+#include "tizgraphtypes.hpp"
+
+namespace tiz
+{
+  namespace loudness
+  {
+    /* ReplayGain 2.0 reference level, in LUFS */
+    const double reference_lufs = -18.0;
+
+    struct info
+    {
+      info () : gain_ (0.0), peak_ (0.0)
+      {
+      }
+      double gain_;  // dB, relative to reference_lufs
+      double peak_;  // linear sample peak (1.0 is full scale)
+    };
+
+    /**
+     * ITU-R BS.1770 / EBU R128 integrated loudness meter. Input is
+     * interleaved float PCM.
+     */
+    class meter
+    {
+    public:
+      meter (const unsigned int sample_rate, const unsigned int channels);
+
+      void add_frames (const float *p_frames, const size_t nframes);
+      bool integrated (double &lufs) const;
+      double peak () const;
+
+    private:
+      struct biquad
+      {
+        double b0_, b1_, b2_, a1_, a2_;
+      };
+
+      void end_sub_block ();
+
+    private:
+      unsigned int channels_;
+      size_t sub_block_frames_;  // 100 ms worth of frames
+      size_t sub_block_count_;
+      biquad shelf_;
+      biquad highpass_;
+      std::vector< double > state_;    // 4 delay elements per stage/channel
+      std::vector< double > weights_;  // per-channel weighting
+      double sub_block_energy_;
+      std::deque< double > sub_blocks_;  // last four 100 ms sub-blocks
+      std::vector< double > blocks_;     // 400 ms gating blocks
+      double peak_;
+    };
+
+    /**
+     * Process-wide, thread-safe store of loudness measurements. Entries are
+     * keyed by file path and invalidated when the file's mtime changes.
+     */
+    class db
+    {
+    public:
+      static db &instance ();
+
+      bool lookup (const std::string &uri, info &result);
+      void store (const std::string &uri, const info &result);
+      void save ();
+
+    private:
+      db ();
+      ~db ();
+      db (const db &);
+      db &operator= (const db &);
+
+      void load ();
+      static bool file_mtime (const std::string &uri, long &mtime);
+
+    private:
+      struct entry
+      {
+        long mtime_;
+        info info_;
+      };
+      typedef std::map< std::string, entry > entry_map_t;
+
+      void write (const entry_map_t &snapshot);
+
+      std::string path_;
+      entry_map_t entries_;
+      bool dirty_;
+      tiz_mutex_t mutex_;
+      tiz_mutex_t save_mutex_;  // serializes save ()
+    };
+
+    void *analyzer_thread_func (void *p_arg);
+
+    /**
+     * Offline analyzer. A small pool of background threads measures the
+     * tracks that carry no ReplayGain tags and are not in the db yet, so that
+     * playback never pays for the analysis.
+     */
+    class analyzer
+    {
+    public:
+      analyzer (const uri_lst_t &uri_list, const unsigned int nthreads);
+      ~analyzer ();
+
+      OMX_ERRORTYPE start ();
+      void stop ();
+
+    private:
+      friend void *analyzer_thread_func (void *);
+
+      bool next_uri (std::string &uri);
+      bool is_stopping ();
+      bool analyze (const std::string &uri, info &result);
+      static bool has_replaygain_tags (const std::string &uri);
+
+    private:
+      uri_lst_t pending_;
+      unsigned int nthreads_;
+      std::vector< tiz_thread_t > threads_;
+      tiz_mutex_t mutex_;
+      bool stopping_;
+      size_t analyzed_;
+    };
+  }  // namespace loudness
+}  // namespace tiz
+
+#endif  // TIZLOUDNESS_HPP
@@ -63,6 +63,8 @@
 #include "tizdaemon.hpp"
 #include "tizgraphmgr.hpp"
 #include "tizgraphtypes.hpp"
+#include "tizgraphutil.hpp"
+#include "tizloudness.hpp"
 #include "tizomxutil.hpp"
 #include <decoders/tizdecgraphmgr.hpp>
 #include <httpclnt/tizhttpclntmgr.hpp>
@@ -747,6 +749,22 @@ tiz::playapp::decode_local ()
   assert (playlist);
   playlist->print_info ();
 
+  // Measure the loudness of untagged tracks in the background, so that it is
+  // known by the time they come up for playback.
+  boost::shared_ptr< tiz::loudness::analyzer > p_analyzer;
+  const unsigned int analyzer_threads
+      = tiz::graph::util::get_replaygain_analyzer_threads ();
+  if (OMX_AUDIO_ReplayGainModeOff != tiz::graph::util::get_replaygain_mode ()
+      && analyzer_threads > 0)
+  {
+    p_analyzer = boost::make_shared< tiz::loudness::analyzer > (
+        file_list, analyzer_threads);
+    if (OMX_ErrorNone != p_analyzer->start ())
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to start the loudness analyzer");
+    }
+  }
+
   // Instantiate the decode manager
   tiz::graphmgr::mgr_ptr_t p_mgr
       = boost::make_shared< tiz::graphmgr::decodemgr > ();
@@ -762,6 +780,11 @@ tiz::playapp::decode_local ()
   p_mgr->quit ();
   p_mgr->deinit ();
 
+  if (p_analyzer)
+  {
+    p_analyzer->stop ();
+  }
+
   return rc;
 }
 
@@ -771,6 +794,7 @@ tiz::playapp::serve_stream ()
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   const uri_lst_t &uri_list = popts_.uri_list ();
   const long int port = popts_.port ();
+  const int max_clients = popts_.max_clients ();
   const bool shuffle = popts_.shuffle ();
   const bool recurse = popts_.recurse ();
   const bool icy_metadata = popts_.icy_metadata ();
@@ -837,8 +861,9 @@ tiz::playapp::serve_stream ()
 
   tizgraphconfig_ptr_t config
       = boost::make_shared< tiz::graph::httpservconfig > (
-          playlist, hostname, ip_address, port, sampling_rate_list,
-          bitrate_list, station_name, station_genre, icy_metadata);
+          playlist, hostname, ip_address, port, max_clients,
+          sampling_rate_list, bitrate_list, station_name, station_genre,
+          icy_metadata);
 
   // Instantiate the http streaming manager
   tiz::graphmgr::mgr_ptr_t p_mgr
@@ -30,6 +30,7 @@
 #include <config.h>
 #endif
 
+#include <stdlib.h>
 #include <string>
 
 #include <boost/algorithm/string/trim.hpp>
@@ -775,6 +776,48 @@ unsigned int tiz::probe::retrieve_meta_data_uint (
   return 0;
 }
 
+bool tiz::probe::retrieve_replaygain (const char *gain_key,
+                                      const char *peak_key, double &gain,
+                                      double &peak) const
+{
+  bool found = false;
+  assert (gain_key);
+  assert (peak_key);
+  if (!meta_file_.isNull () && meta_file_.file ())
+  {
+    // TagLib maps Xiph comments, APE items and ID3v2 TXXX frames to the same
+    // property keys, e.g. REPLAYGAIN_TRACK_GAIN = "-6.54 dB"
+    const TagLib::PropertyMap props = meta_file_.file ()->properties ();
+    TagLib::PropertyMap::ConstIterator it = props.find (gain_key);
+    if (it != props.end () && !it->second.isEmpty ())
+    {
+      const std::string gain_str = it->second.front ().to8Bit ();
+      char *p_end = NULL;
+      gain = strtod (gain_str.c_str (), &p_end);
+      found = (p_end != gain_str.c_str ());
+      peak = 0.0;
+      it = props.find (peak_key);
+      if (found && it != props.end () && !it->second.isEmpty ())
+      {
+        peak = strtod (it->second.front ().to8Bit ().c_str (), NULL);
+      }
+    }
+  }
+  return found;
+}
+
+bool tiz::probe::replaygain_track (double &gain, double &peak) const
+{
+  return retrieve_replaygain ("REPLAYGAIN_TRACK_GAIN", "REPLAYGAIN_TRACK_PEAK",
+                              gain, peak);
+}
+
+bool tiz::probe::replaygain_album (double &gain, double &peak) const
+{
+  return retrieve_replaygain ("REPLAYGAIN_ALBUM_GAIN", "REPLAYGAIN_ALBUM_PEAK",
+                              gain, peak);
+}
+
 std::string tiz::probe::title () const
 {
   return retrieve_meta_data_str (&TagLib::Tag::title);
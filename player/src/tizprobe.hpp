@@ -34,6 +34,7 @@
 
 #include <fileref.h>
 #include <tag.h>
+#include <tpropertymap.h>
 
 #include <OMX_Core.h>
 #include <OMX_Component.h>
@@ -74,6 +75,12 @@ namespace tiz
     std::string track () const;
     std::string genre () const;
 
+    /* ReplayGain information. Gains are in dB and peaks are linear sample
+       amplitudes (1.0 is full scale). These return false when the stream
+       carries no ReplayGain tags. */
+    bool replaygain_track (double &gain, double &peak) const;
+    bool replaygain_album (double &gain, double &peak) const;
+
     /* Meta-data information. These methods are currently used by the http
        streaming use case. */
     std::string get_stream_title ();
@@ -120,6 +127,8 @@ namespace tiz
         TagLib::String (TagLib::Tag::*TagFunction)() const) const;
     unsigned int retrieve_meta_data_uint (
         TagLib::uint (TagLib::Tag::*TagFunction)() const) const;
+    bool retrieve_replaygain (const char *gain_key, const char *peak_key,
+                              double &gain, double &peak) const;
 
   private:
     std::string uri_;
@@ -70,6 +70,8 @@ namespace po = boost::program_options;
 namespace
 {
   const int TIZ_STREAMING_SERVER_DEFAULT_PORT = 8010;
+  const int TIZ_STREAMING_SERVER_DEFAULT_MAX_CLIENTS = 64;
+  const int TIZ_STREAMING_SERVER_MAX_CLIENTS_LIMIT = 1024;
   const int TIZ_MAX_BITRATE_MODES = 2;
 
   struct program_option_is_defaulted
@@ -309,6 +311,7 @@ tiz::programopts::programopts (int argc, char *argv[])
     comp_name_ (),
     role_name_ (),
     port_ (TIZ_STREAMING_SERVER_DEFAULT_PORT),
+    max_clients_ (TIZ_STREAMING_SERVER_DEFAULT_MAX_CLIENTS),
     station_name_ ("Tizonia Radio"),
     station_genre_ ("Unknown Genre"),
     no_icy_metadata_ (false),
@@ -666,6 +669,11 @@ int tiz::programopts::port () const
   return port_;
 }
 
+int tiz::programopts::max_clients () const
+{
+  return max_clients_;
+}
+
 const std::string &tiz::programopts::station_name () const
 {
   return station_name_;
@@ -1389,6 +1397,9 @@ void tiz::programopts::init_streaming_server_options ()
       ("port,p", po::value (&port_),
        "TCP port to be used for Icecast/SHOUTcast streaming. Default: 8010.")
       /* TIZ_CLASS_COMMENT: */
+      ("max-clients", po::value (&max_clients_),
+       "Maximum number of simultaneous listeners. Default: 64.")
+      /* TIZ_CLASS_COMMENT: */
       ("station-name", po::value (&station_name_),
        "The Icecast/SHOUTcast station name. Optional.")
       /* TIZ_CLASS_COMMENT: */
@@ -1419,7 +1430,8 @@ void tiz::programopts::init_streaming_server_options ()
   register_consume_function (
       &tiz::programopts::consume_streaming_server_options);
   all_streaming_server_options_
-      = boost::assign::list_of ("server") ("port") ("station-name") (
+      = boost::assign::list_of ("server") ("port") ("max-clients") (
+            "station-name") (
             "station-genre") ("no-icy-metadata") ("bitrate-modes") (
             "sampling-rates")
             .convert_to_container< std::vector< std::string > > ();
@@ -1951,6 +1963,7 @@ int tiz::programopts::consume_streaming_server_options (bool &done,
   {
     done = true;
     PO_RETURN_IF_FAIL (validate_port_argument (msg));
+    PO_RETURN_IF_FAIL (validate_max_clients_argument (msg));
     PO_RETURN_IF_FAIL (validate_bitrates_argument (msg));
     PO_RETURN_IF_FAIL (validate_sampling_rates_argument (msg));
     rc = consume_input_file_uris_option ();
@@ -2787,6 +2800,25 @@ bool tiz::programopts::validate_port_argument (std::string &msg) const
   return rc;
 }
 
+bool tiz::programopts::validate_max_clients_argument (std::string &msg) const
+{
+  bool rc = true;
+  if (vm_.count ("max-clients"))
+  {
+    if (max_clients_ < 1
+        || max_clients_ > TIZ_STREAMING_SERVER_MAX_CLIENTS_LIMIT)
+    {
+      rc = false;
+      std::ostringstream oss;
+      oss << "Invalid argument : " << max_clients_ << "\n"
+          << "Please provide a number of clients in the range [1-"
+          << TIZ_STREAMING_SERVER_MAX_CLIENTS_LIMIT << "]";
+      msg.assign (oss.str ());
+    }
+  }
+  return rc;
+}
+
 bool tiz::programopts::validate_bitrates_argument (std::string &msg)
 {
   bool rc = true;
@@ -67,6 +67,7 @@ namespace tiz
     const std::string &component_name () const;
     const std::string &component_role () const;
     int port () const;
+    int max_clients () const;
     const std::string &station_name () const;
     const std::string &station_genre () const;
     bool icy_metadata () const;
@@ -150,6 +151,7 @@ namespace tiz
     bool validate_youtube_client_options () const;
     bool validate_plex_client_options () const;
     bool validate_port_argument (std::string &msg) const;
+    bool validate_max_clients_argument (std::string &msg) const;
     bool validate_bitrates_argument (std::string &msg);
     bool validate_sampling_rates_argument (std::string &msg);
 
@@ -188,6 +190,7 @@ namespace tiz
     std::string comp_name_;
     std::string role_name_;
     int port_;
+    int max_clients_;
     std::string station_name_;
     std::string station_genre_;
     bool no_icy_metadata_;
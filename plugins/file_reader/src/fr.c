@@ -75,7 +75,8 @@ instantiate_audio_port (OMX_HANDLETYPE ap_hdl)
     ARATELIA_FILE_READER_PORT_NONCONTIGUOUS,
     ARATELIA_FILE_READER_PORT_ALIGNMENT,
     ARATELIA_FILE_READER_PORT_SUPPLIERPREF,
-    {ARATELIA_FILE_READER_PORT_INDEX, NULL, NULL, NULL},
+    {ARATELIA_FILE_READER_PORT_INDEX, fr_prc_alloc_buffer_hook,
+     fr_prc_free_buffer_hook, NULL},
     -1 /* use -1 for now */
   };
 
@@ -93,7 +94,8 @@ instantiate_video_port (OMX_HANDLETYPE ap_hdl)
     ARATELIA_FILE_READER_PORT_NONCONTIGUOUS,
     ARATELIA_FILE_READER_PORT_ALIGNMENT,
     ARATELIA_FILE_READER_PORT_SUPPLIERPREF,
-    {ARATELIA_FILE_READER_PORT_INDEX, NULL, NULL, NULL},
+    {ARATELIA_FILE_READER_PORT_INDEX, fr_prc_alloc_buffer_hook,
+     fr_prc_free_buffer_hook, NULL},
     -1 /* use -1 for now */
   };
 
@@ -111,7 +113,8 @@ instantiate_image_port (OMX_HANDLETYPE ap_hdl)
     ARATELIA_FILE_READER_PORT_NONCONTIGUOUS,
     ARATELIA_FILE_READER_PORT_ALIGNMENT,
     ARATELIA_FILE_READER_PORT_SUPPLIERPREF,
-    {ARATELIA_FILE_READER_PORT_INDEX, NULL, NULL, NULL},
+    {ARATELIA_FILE_READER_PORT_INDEX, fr_prc_alloc_buffer_hook,
+     fr_prc_free_buffer_hook, NULL},
     -1 /* use -1 for now */
   };
 
@@ -129,7 +132,8 @@ instantiate_other_port (OMX_HANDLETYPE ap_hdl)
     ARATELIA_FILE_READER_PORT_NONCONTIGUOUS,
     ARATELIA_FILE_READER_PORT_ALIGNMENT,
     ARATELIA_FILE_READER_PORT_SUPPLIERPREF,
-    {ARATELIA_FILE_READER_PORT_INDEX, NULL, NULL, NULL},
+    {ARATELIA_FILE_READER_PORT_INDEX, fr_prc_alloc_buffer_hook,
+     fr_prc_free_buffer_hook, NULL},
     -1 /* use -1 for now */
   };
 
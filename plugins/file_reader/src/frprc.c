@@ -31,16 +31,21 @@
 #endif
 
 #include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
 #include <string.h>
 #include <errno.h>
 #include <limits.h>
 #include <assert.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <OMX_Core.h>
 
 #include <tizplatform.h>
 
 #include <tizkernel.h>
+#include <tizscheduler.h>
 
 #include "fr.h"
 #include "frprc_decls.h"
@@ -51,10 +56,153 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.file_reader.prc"
 #endif
 
+#define FR_BUFFER_MAGIC 0x46524246 /* 'FRBF' */
+#define FR_MMAP_READAHEAD_BYTES (1024 * 1024)
+#define FR_AIO_THREADS 2
+
 /* Forward declarations */
 static OMX_ERRORTYPE
 fr_prc_deallocate_resources (void *);
 
+/* Port-private data of the buffers allocated by the output port. Headers
+   may have their pBuffer pointed into the file mapping, so this is what
+   keeps track of the memory that was actually allocated. */
+typedef struct fr_buffer fr_buffer_t;
+struct fr_buffer
+{
+  OMX_U32 magic;
+  OMX_U8 * p_data;
+};
+
+OMX_U8 *
+fr_prc_alloc_buffer_hook (OMX_U32 * ap_size, OMX_PTR * app_port_priv,
+                          void * ap_args)
+{
+  fr_buffer_t * p_fbuf = NULL;
+  assert (ap_size && *ap_size > 0);
+  assert (app_port_priv);
+
+  if ((p_fbuf = tiz_mem_calloc (1, sizeof (fr_buffer_t))))
+    {
+      if (!(p_fbuf->p_data = tiz_mem_calloc ((size_t) *ap_size, 1)))
+        {
+          tiz_mem_free (p_fbuf);
+          return NULL;
+        }
+      p_fbuf->magic = FR_BUFFER_MAGIC;
+      *app_port_priv = p_fbuf;
+      return p_fbuf->p_data;
+    }
+  return NULL;
+}
+
+void
+fr_prc_free_buffer_hook (OMX_PTR ap_buf, OMX_PTR ap_port_priv,
+                         void * ap_args)
+{
+  fr_buffer_t * p_fbuf = ap_port_priv;
+  if (p_fbuf)
+    {
+      /* Don't trust ap_buf; it may be pointing into the file mapping */
+      assert (FR_BUFFER_MAGIC == p_fbuf->magic);
+      tiz_mem_free (p_fbuf->p_data);
+      tiz_mem_free (p_fbuf);
+    }
+  else
+    {
+      tiz_mem_free (ap_buf);
+    }
+}
+
+static inline fr_buffer_t *
+own_buffer (OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  fr_buffer_t * p_fbuf = NULL;
+  assert (ap_hdr);
+  p_fbuf = ap_hdr->pOutputPortPrivate;
+  return (p_fbuf && FR_BUFFER_MAGIC == p_fbuf->magic) ? p_fbuf : NULL;
+}
+
+static bool
+use_mmap (void)
+{
+  const char * p_value = tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION, "OMX.Aratelia.file_reader.binary.use_mmap");
+  return (p_value && 0 == strncmp (p_value, "true", 4));
+}
+
+static void
+map_file (fr_prc_t * ap_prc)
+{
+  struct stat st;
+  void * p_map = NULL;
+
+  assert (ap_prc);
+  assert (ap_prc->p_file_);
+  assert (!ap_prc->p_map_);
+
+  if (0 != fstat (fileno (ap_prc->p_file_), &st) || st.st_size <= 0
+      || (uintmax_t) st.st_size > SIZE_MAX)
+    {
+      return;
+    }
+
+  /* A private mapping, so that a consumer that decodes in place can't write
+     to the file */
+  p_map = mmap (NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                fileno (ap_prc->p_file_), 0);
+  if (MAP_FAILED == p_map)
+    {
+      TIZ_WARN (handleOf (ap_prc), "Unable to map the file (%s); will use fread",
+                strerror (errno));
+      return;
+    }
+
+  (void) madvise (p_map, (size_t) st.st_size, MADV_SEQUENTIAL);
+  ap_prc->p_map_ = p_map;
+  ap_prc->map_len_ = (size_t) st.st_size;
+  ap_prc->map_pos_ = 0;
+  ap_prc->map_advised_ = 0;
+  TIZ_NOTICE (handleOf (ap_prc), "Mapped [%zu] bytes", ap_prc->map_len_);
+}
+
+static inline void
+unmap_file (fr_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_map_)
+    {
+      (void) munmap (ap_prc->p_map_, ap_prc->map_len_);
+      ap_prc->p_map_ = NULL;
+      ap_prc->map_len_ = 0;
+      ap_prc->map_pos_ = 0;
+      ap_prc->map_advised_ = 0;
+    }
+}
+
+static void
+advise_readahead (fr_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  assert (ap_prc->p_map_);
+
+  /* Keep the kernel fetching pages one readahead window ahead of the read
+     position */
+  if (ap_prc->map_advised_ < ap_prc->map_len_
+      && ap_prc->map_advised_ < ap_prc->map_pos_ + FR_MMAP_READAHEAD_BYTES)
+    {
+      const long page = sysconf (_SC_PAGESIZE);
+      size_t start = ap_prc->map_pos_ > ap_prc->map_advised_
+                       ? ap_prc->map_pos_
+                       : ap_prc->map_advised_;
+      size_t end = MIN (ap_prc->map_len_,
+                        ap_prc->map_pos_ + 2 * FR_MMAP_READAHEAD_BYTES);
+      start -= start % (size_t) (page > 0 ? page : 4096);
+      (void) madvise (ap_prc->p_map_ + start, end - start, MADV_WILLNEED);
+      ap_prc->map_advised_ = end;
+    }
+}
+
 static inline void
 close_file (fr_prc_t * ap_prc)
 {
@@ -74,15 +222,34 @@ delete_uri (fr_prc_t * ap_prc)
   ap_prc->p_uri_param_ = NULL;
 }
 
+static void
+refresh_file_size (fr_prc_t * ap_prc)
+{
+  struct stat st;
+  assert (ap_prc);
+  assert (ap_prc->p_file_);
+  if (0 == fstat (fileno (ap_prc->p_file_), &st))
+    {
+      ap_prc->file_size_ = st.st_size;
+    }
+}
+
 static inline void
 reset_stream_parameters (fr_prc_t * ap_prc)
 {
   assert (ap_prc);
   ap_prc->counter_ = 0;
   ap_prc->eos_ = false;
+  ap_prc->map_pos_ = 0;
+  ap_prc->map_advised_ = 0;
+  assert (0 == ap_prc->nreads_);
+  ap_prc->read_head_ = 0;
+  ap_prc->read_offset_ = 0;
+  ap_prc->file_size_ = 0;
   if (ap_prc->p_file_)
     {
       rewind (ap_prc->p_file_);
+      refresh_file_size (ap_prc);
     }
 }
 
@@ -130,45 +297,280 @@ obtain_uri (fr_prc_t * ap_prc)
 }
 
 static OMX_ERRORTYPE
-read_into_buffer (const void * ap_obj, OMX_BUFFERHEADERTYPE * p_hdr)
+map_into_buffer (fr_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * p_hdr)
 {
-  fr_prc_t * p_prc = (fr_prc_t *) ap_obj;
-  assert (p_prc);
+  fr_buffer_t * p_fbuf = own_buffer (p_hdr);
+  const size_t remaining = ap_prc->map_len_ - ap_prc->map_pos_;
+  const size_t nbytes = MIN (remaining, (size_t) p_hdr->nAllocLen);
+
+  assert (ap_prc);
+  assert (ap_prc->p_map_);
+
+  advise_readahead (ap_prc);
+
+  if (p_fbuf)
+    {
+      /* Hand out the mapped file data itself */
+      p_hdr->pBuffer = ap_prc->p_map_ + ap_prc->map_pos_;
+    }
+  else
+    {
+      /* Not our buffer (e.g. the IL client supplied it); copy into it */
+      memcpy (p_hdr->pBuffer, ap_prc->p_map_ + ap_prc->map_pos_, nbytes);
+    }
+
+  ap_prc->map_pos_ += nbytes;
+  p_hdr->nFilledLen = nbytes;
+  ap_prc->counter_ += nbytes;
 
-  if (p_prc->p_file_ && !(p_prc->eos_))
+  if (ap_prc->map_pos_ >= ap_prc->map_len_)
     {
-      int bytes_read = 0;
-      if (!(bytes_read
-            = fread (p_hdr->pBuffer, 1, p_hdr->nAllocLen, p_prc->p_file_)))
+      TIZ_NOTICE (handleOf (ap_prc),
+                  "End of file reached EOS in HEADER [%p]", p_hdr);
+      p_hdr->nFlags |= OMX_BUFFERFLAG_EOS;
+      ap_prc->eos_ = true;
+    }
+
+  TIZ_TRACE (handleOf (ap_prc),
+             "Mapping into HEADER [%p]...nFilledLen[%d] counter [%d]", p_hdr,
+             p_hdr->nFilledLen, ap_prc->counter_);
+
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+release_output_header (fr_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  assert (ap_prc);
+  assert (ap_hdr);
+  return tiz_krn_release_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                 ARATELIA_FILE_READER_PORT_INDEX, ap_hdr);
+}
+
+static void
+reap_reads (fr_prc_t * ap_prc)
+{
+  tiz_aio_req_t done[FR_MAX_READS_IN_FLIGHT];
+  size_t ndone = 0;
+  size_t i = 0;
+
+  assert (ap_prc);
+  assert (ap_prc->p_aio_);
+
+  ndone = tiz_aio_reap (ap_prc->p_aio_, done, FR_MAX_READS_IN_FLIGHT);
+  for (i = 0; i < ndone; ++i)
+    {
+      fr_read_t * p_read = done[i].p_cookie;
+      assert (p_read);
+      p_read->done = true;
+      p_read->result = done[i].result;
+      p_read->error = done[i].error;
+    }
+}
+
+/* Completed reads are released in file order, which is not necessarily the
+   order in which they complete */
+static OMX_ERRORTYPE
+release_completed_reads (fr_prc_t * ap_prc)
+{
+  assert (ap_prc);
+
+  while (ap_prc->nreads_ > 0 && ap_prc->reads_[ap_prc->read_head_].done)
+    {
+      fr_read_t * p_read = &(ap_prc->reads_[ap_prc->read_head_]);
+      OMX_BUFFERHEADERTYPE * p_hdr = p_read->p_hdr;
+
+      if (p_read->result < 0)
         {
-          if (feof (p_prc->p_file_))
-            {
-              TIZ_NOTICE (
-                handleOf (p_prc),
-                "End of file reached bytes_read=[%d] EOS in HEADER [%p]",
-                bytes_read, p_hdr);
-              p_hdr->nFlags |= OMX_BUFFERFLAG_EOS;
-              p_prc->eos_ = true;
-            }
-          else
-            {
-              TIZ_ERROR (handleOf (p_prc), "An error occurred while reading");
-              return OMX_ErrorInsufficientResources;
-            }
+          TIZ_ERROR (handleOf (ap_prc),
+                     "An error occurred while reading (%s)",
+                     strerror (p_read->error));
+          return OMX_ErrorInsufficientResources;
         }
 
-      p_hdr->nFilledLen = bytes_read;
-      p_prc->counter_ += p_hdr->nFilledLen;
+      p_hdr->nFilledLen = (OMX_U32) p_read->result;
+      ap_prc->counter_ += p_hdr->nFilledLen;
 
-      TIZ_TRACE (handleOf (p_prc),
-                 "Reading into HEADER [%p]...nFilledLen[%d] "
-                 "counter [%d] bytes_read[%d]",
-                 p_hdr, p_hdr->nFilledLen, p_prc->counter_, bytes_read);
-    }
+      if (!ap_prc->eos_
+          && (p_read->last || p_read->result < (ssize_t) p_hdr->nAllocLen))
+        {
+          TIZ_NOTICE (handleOf (ap_prc),
+                      "End of file reached bytes_read=[%d] EOS in HEADER [%p]",
+                      p_hdr->nFilledLen, p_hdr);
+          p_hdr->nFlags |= OMX_BUFFERFLAG_EOS;
+          ap_prc->eos_ = true;
+        }
 
+      TIZ_TRACE (handleOf (ap_prc),
+                 "Reading into HEADER [%p]...nFilledLen[%d] counter [%d]",
+                 p_hdr, p_hdr->nFilledLen, ap_prc->counter_);
+
+      ap_prc->read_head_ = (ap_prc->read_head_ + 1) % FR_MAX_READS_IN_FLIGHT;
+      ap_prc->nreads_--;
+      tiz_check_omx (release_output_header (ap_prc, p_hdr));
+    }
   return OMX_ErrorNone;
 }
 
+static OMX_ERRORTYPE
+submit_reads (fr_prc_t * ap_prc)
+{
+  tiz_aio_req_t reqs[FR_MAX_READS_IN_FLIGHT];
+  size_t nreqs = 0;
+
+  assert (ap_prc);
+  assert (ap_prc->p_aio_);
+
+  if (ap_prc->read_offset_ >= ap_prc->file_size_)
+    {
+      /* The file may have grown since we last looked */
+      refresh_file_size (ap_prc);
+    }
+
+  while (!ap_prc->eos_ && ap_prc->nreads_ < FR_MAX_READS_IN_FLIGHT
+         && (ap_prc->read_offset_ < ap_prc->file_size_
+             || 0 == ap_prc->nreads_))
+    {
+      OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+      fr_buffer_t * p_fbuf = NULL;
+      fr_read_t * p_read = NULL;
+
+      tiz_check_omx (tiz_krn_claim_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                           ARATELIA_FILE_READER_PORT_INDEX, 0,
+                                           &p_hdr));
+      if (!p_hdr)
+        {
+          break;
+        }
+
+      TIZ_TRACE (handleOf (ap_prc), "Claimed HEADER [%p]...nFilledLen [%d]",
+                 p_hdr, p_hdr->nFilledLen);
+      p_hdr->nOffset = 0;
+      p_hdr->nFilledLen = 0;
+      if ((p_fbuf = own_buffer (p_hdr)))
+        {
+          /* Make sure the header is not left pointing into an old mapping */
+          p_hdr->pBuffer = p_fbuf->p_data;
+        }
+
+      if (ap_prc->read_offset_ >= ap_prc->file_size_)
+        {
+          /* Nothing left to read; just signal the end of the stream */
+          TIZ_NOTICE (handleOf (ap_prc), "End of file reached EOS in HEADER [%p]",
+                      p_hdr);
+          p_hdr->nFlags |= OMX_BUFFERFLAG_EOS;
+          ap_prc->eos_ = true;
+          tiz_check_omx (release_output_header (ap_prc, p_hdr));
+          break;
+        }
+
+      p_read = &(ap_prc->reads_[(ap_prc->read_head_ + ap_prc->nreads_)
+                                % FR_MAX_READS_IN_FLIGHT]);
+      p_read->p_hdr = p_hdr;
+      p_read->offset = ap_prc->read_offset_;
+      p_read->done = false;
+      p_read->result = 0;
+      p_read->error = 0;
+      ap_prc->read_offset_ += p_hdr->nAllocLen;
+      p_read->last = (ap_prc->read_offset_ >= ap_prc->file_size_);
+      ap_prc->nreads_++;
+
+      reqs[nreqs].op = ETIZAioOpRead;
+      reqs[nreqs].fd = fileno (ap_prc->p_file_);
+      reqs[nreqs].p_data = p_hdr->pBuffer;
+      reqs[nreqs].nbytes = p_hdr->nAllocLen;
+      reqs[nreqs].offset = p_read->offset;
+      reqs[nreqs].p_cookie = p_read;
+      nreqs++;
+    }
+
+  return nreqs > 0 ? tiz_aio_submit (ap_prc->p_aio_, reqs, nreqs)
+                   : OMX_ErrorNone;
+}
+
+/* Cancel the reads in flight and hand back their headers empty */
+static OMX_ERRORTYPE
+cancel_reads (fr_prc_t * ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (ap_prc);
+
+  if (ap_prc->p_aio_)
+    {
+      tiz_aio_cancel (ap_prc->p_aio_);
+      reap_reads (ap_prc);
+    }
+
+  if (ap_prc->nreads_ > 0)
+    {
+      /* Resume from the first read that was not delivered */
+      ap_prc->read_offset_ = ap_prc->reads_[ap_prc->read_head_].offset;
+    }
+
+  while (ap_prc->nreads_ > 0)
+    {
+      fr_read_t * p_read = &(ap_prc->reads_[ap_prc->read_head_]);
+      assert (p_read->done);
+      p_read->p_hdr->nFilledLen = 0;
+      ap_prc->read_head_ = (ap_prc->read_head_ + 1) % FR_MAX_READS_IN_FLIGHT;
+      ap_prc->nreads_--;
+      if (OMX_ErrorNone != release_output_header (ap_prc, p_read->p_hdr))
+        {
+          rc = OMX_ErrorInsufficientResources;
+        }
+    }
+
+  return rc;
+}
+
+static void
+aio_completion_handler (OMX_PTR ap_prc, tiz_event_pluggable_t * ap_event)
+{
+  fr_prc_t * p_prc = ap_prc;
+  assert (p_prc);
+  assert (ap_event);
+
+  if (p_prc->p_aio_)
+    {
+      reap_reads (p_prc);
+    }
+
+  /* Headers can't be handed out or claimed while paused, or stopped */
+  if (p_prc->p_aio_ && p_prc->started_ && !p_prc->paused_
+      && !p_prc->port_disabled_)
+    {
+      if (OMX_ErrorNone != release_completed_reads (p_prc)
+          || OMX_ErrorNone != submit_reads (p_prc))
+        {
+          tiz_srv_issue_err_event ((OMX_PTR) p_prc,
+                                   OMX_ErrorInsufficientResources);
+        }
+    }
+  tiz_mem_free (ap_event);
+}
+
+/**
+ * Called by the I/O engine when there are completed reads.
+ *
+ * @note This function is called from one of the engine's threads!
+ */
+static void
+aio_completion (void * ap_arg)
+{
+  fr_prc_t * p_prc = ap_arg;
+  tiz_event_pluggable_t * p_event = NULL;
+  assert (p_prc);
+
+  p_event = tiz_mem_calloc (1, sizeof (tiz_event_pluggable_t));
+  if (p_event)
+    {
+      p_event->p_servant = p_prc;
+      p_event->p_data = NULL;
+      p_event->pf_hdlr = aio_completion_handler;
+      tiz_comp_event_pluggable (handleOf (p_prc), p_event);
+    }
+}
+
 /*
  * frprc
  */
@@ -180,6 +582,13 @@ fr_prc_ctor (void * ap_obj, va_list * app)
   assert (p_prc);
   p_prc->p_file_ = NULL;
   p_prc->p_uri_param_ = NULL;
+  p_prc->p_map_ = NULL;
+  p_prc->map_len_ = 0;
+  p_prc->p_aio_ = NULL;
+  p_prc->nreads_ = 0;
+  p_prc->started_ = false;
+  p_prc->paused_ = false;
+  p_prc->port_disabled_ = false;
   reset_stream_parameters (p_prc);
   return p_prc;
 }
@@ -214,12 +623,31 @@ fr_prc_allocate_resources (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
       return OMX_ErrorInsufficientResources;
     }
 
+  if (use_mmap ())
+    {
+      map_file (p_prc);
+    }
+
+  if (!p_prc->p_map_)
+    {
+      /* Reads are done off the component's thread, so that a slow file
+         system doesn't hold up the processing of commands */
+      tiz_check_omx (
+        tiz_aio_init (&(p_prc->p_aio_), FR_AIO_THREADS, aio_completion, p_prc));
+    }
+
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
 fr_prc_deallocate_resources (void * ap_obj)
 {
+  fr_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  (void) cancel_reads (p_prc);
+  tiz_aio_destroy (p_prc->p_aio_);
+  p_prc->p_aio_ = NULL;
+  unmap_file (ap_obj);
   close_file (ap_obj);
   delete_uri (ap_obj);
   return OMX_ErrorNone;
@@ -228,7 +656,10 @@ fr_prc_deallocate_resources (void * ap_obj)
 static OMX_ERRORTYPE
 fr_prc_prepare_to_transfer (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
 {
-  reset_stream_parameters (ap_obj);
+  fr_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  reset_stream_parameters (p_prc);
+  p_prc->started_ = true;
   return OMX_ErrorNone;
 }
 
@@ -241,7 +672,11 @@ fr_prc_transfer_and_process (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
 static OMX_ERRORTYPE
 fr_prc_stop_and_return (void * ap_obj)
 {
-  return OMX_ErrorNone;
+  fr_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  p_prc->started_ = false;
+  p_prc->paused_ = false;
+  return cancel_reads (p_prc);
 }
 
 /*
@@ -251,10 +686,15 @@ fr_prc_stop_and_return (void * ap_obj)
 static OMX_ERRORTYPE
 fr_prc_buffers_ready (const void * ap_obj)
 {
-  const fr_prc_t * p_prc = ap_obj;
+  fr_prc_t * p_prc = (fr_prc_t *) ap_obj;
 
   assert (ap_obj);
 
+  if (p_prc->p_aio_)
+    {
+      return submit_reads (p_prc);
+    }
+
   if (!p_prc->eos_)
     {
       OMX_BUFFERHEADERTYPE * p_hdr = NULL;
@@ -267,7 +707,7 @@ fr_prc_buffers_ready (const void * ap_obj)
                      p_hdr, p_hdr->nFilledLen);
           p_hdr->nOffset = 0;
           p_hdr->nFilledLen = 0;
-          tiz_check_omx (read_into_buffer (p_prc, p_hdr));
+          tiz_check_omx (map_into_buffer (p_prc, p_hdr));
           tiz_check_omx (
             tiz_krn_release_buffer (tiz_get_krn (handleOf (p_prc)),
                                     ARATELIA_FILE_READER_PORT_INDEX, p_hdr));
@@ -277,6 +717,54 @@ fr_prc_buffers_ready (const void * ap_obj)
   return OMX_ErrorNone;
 }
 
+static OMX_ERRORTYPE
+fr_prc_pause (const void * ap_obj)
+{
+  fr_prc_t * p_prc = (fr_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->paused_ = true;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+fr_prc_resume (const void * ap_obj)
+{
+  fr_prc_t * p_prc = (fr_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->paused_ = false;
+  if (p_prc->p_aio_ && !p_prc->port_disabled_)
+    {
+      /* Hand out whatever was read while paused */
+      tiz_check_omx (release_completed_reads (p_prc));
+      return submit_reads (p_prc);
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+fr_prc_port_flush (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  return cancel_reads ((fr_prc_t *) ap_obj);
+}
+
+static OMX_ERRORTYPE
+fr_prc_port_disable (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  fr_prc_t * p_prc = (fr_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->port_disabled_ = true;
+  return cancel_reads (p_prc);
+}
+
+static OMX_ERRORTYPE
+fr_prc_port_enable (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  fr_prc_t * p_prc = (fr_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->port_disabled_ = false;
+  return OMX_ErrorNone;
+}
+
 /*
  * fr_prc_class
  */
@@ -335,6 +823,16 @@ fr_prc_init (void * ap_tos, void * ap_hdl)
      tiz_srv_stop_and_return, fr_prc_stop_and_return,
      /* TIZ_CLASS_COMMENT: */
      tiz_prc_buffers_ready, fr_prc_buffers_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_pause, fr_prc_pause,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_resume, fr_prc_resume,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_flush, fr_prc_port_flush,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_disable, fr_prc_port_disable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_enable, fr_prc_port_enable,
      /* TIZ_CLASS_COMMENT: stop value */
      0);
 
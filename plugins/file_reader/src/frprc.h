@@ -33,11 +33,23 @@
 extern "C" {
 #endif
 
+#include <OMX_Types.h>
+
 void *
 fr_prc_class_init (void * ap_tos, void * ap_hdl);
 void *
 fr_prc_init (void * ap_tos, void * ap_hdl);
 
+/* Buffer allocation hooks of the output port. These let the processor point
+   the buffer headers into the file mapping, when memory-mapped reading is
+   enabled */
+OMX_U8 *
+fr_prc_alloc_buffer_hook (OMX_U32 * ap_size, OMX_PTR * app_port_priv,
+                          void * ap_args);
+void
+fr_prc_free_buffer_hook (OMX_PTR ap_buf, OMX_PTR ap_port_priv,
+                         void * ap_args);
+
 #ifdef __cplusplus
 }
 #endif
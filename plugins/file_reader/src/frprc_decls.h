@@ -34,9 +34,26 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <tizplatform.h>
 
 #include <tizprc_decls.h>
 
+#define FR_MAX_READS_IN_FLIGHT 8
+
+typedef struct fr_read fr_read_t;
+struct fr_read
+{
+  OMX_BUFFERHEADERTYPE * p_hdr;
+  off_t offset;
+  bool last;
+  bool done;
+  ssize_t result;
+  int error;
+};
+
 typedef struct fr_prc fr_prc_t;
 struct fr_prc
 {
@@ -46,6 +63,19 @@ struct fr_prc
   OMX_PARAM_CONTENTURITYPE * p_uri_param_;
   OMX_U32 counter_;
   bool eos_;
+  OMX_U8 * p_map_;
+  size_t map_len_;
+  size_t map_pos_;
+  size_t map_advised_;
+  tiz_aio_t * p_aio_;
+  fr_read_t reads_[FR_MAX_READS_IN_FLIGHT];
+  OMX_U32 read_head_;
+  OMX_U32 nreads_;
+  off_t read_offset_;
+  off_t file_size_;
+  bool started_;
+  bool paused_;
+  bool port_disabled_;
 };
 
 typedef struct fr_prc_class fr_prc_class_t;
@@ -30,8 +30,12 @@
 #include <config.h>
 #endif
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <limits.h>
 #include <assert.h>
@@ -52,6 +56,20 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.file_writer.prc"
 #endif
 
+#define FW_AIO_THREADS 2
+
+static size_t
+get_config_bytes (const char * ap_key)
+{
+  const char * p_value
+    = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, ap_key);
+  return (p_value && atoi (p_value) > 0) ? (size_t) atoi (p_value) * 1024 : 0;
+}
+
+/* Forward declarations */
+static void
+free_blocks (fw_prc_t * ap_prc);
+
 static OMX_ERRORTYPE
 obtain_uri (fw_prc_t * ap_prc)
 {
@@ -108,6 +126,22 @@ fw_proc_ctor (void * ap_obj, va_list * app)
   p_prc->p_uri_param_ = NULL;
   p_prc->counter_ = 0;
   p_prc->eos_ = false;
+  p_prc->p_aio_ = NULL;
+  p_prc->write_head_ = 0;
+  p_prc->nwrites_ = 0;
+  p_prc->write_offset_ = 0;
+  p_prc->started_ = false;
+  p_prc->paused_ = false;
+  p_prc->port_disabled_ = false;
+  p_prc->block_size_ = 0;
+  p_prc->sync_bytes_ = 0;
+  memset (p_prc->blocks_, 0, sizeof (p_prc->blocks_));
+  p_prc->fill_block_ = 0;
+  p_prc->npending_ = 0;
+  p_prc->unsynced_ = 0;
+  p_prc->dropped_offset_ = 0;
+  p_prc->p_eos_hdr_ = NULL;
+  p_prc->wb_error_ = 0;
   return p_prc;
 }
 
@@ -117,6 +151,9 @@ fw_proc_dtor (void * ap_obj)
   fw_prc_t * p_prc = ap_obj;
   assert (p_prc);
 
+  tiz_aio_destroy (p_prc->p_aio_);
+  free_blocks (p_prc);
+
   if (p_prc->p_file_)
     {
       fclose (p_prc->p_file_);
@@ -130,37 +167,499 @@ fw_proc_dtor (void * ap_obj)
   return super_dtor (typeOf (ap_obj, "fwprc"), ap_obj);
 }
 
+/*
+ * Write-behind mode: the data is copied into large blocks and the headers
+ * returned straight away; full blocks are written by a single I/O thread, so
+ * that writes and syncs complete in order.
+ */
+
 static OMX_ERRORTYPE
-fw_proc_write_buffer (const void * ap_obj, OMX_BUFFERHEADERTYPE * p_hdr)
+alloc_blocks (fw_prc_t * ap_prc)
 {
-  fw_prc_t * p_prc = (fw_prc_t *) ap_obj;
-  assert (p_prc);
+  OMX_PARAM_PORTDEFINITIONTYPE port_def;
+  int i = 0;
+
+  assert (ap_prc);
+
+  TIZ_INIT_OMX_PORT_STRUCT (port_def, ARATELIA_FILE_WRITER_PORT_INDEX);
+  tiz_check_omx (
+    tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+                          OMX_IndexParamPortDefinition, &port_def));
+
+  /* A header must never need more than the block being filled and the next
+     one */
+  ap_prc->block_size_ = MAX (ap_prc->block_size_, port_def.nBufferSize);
+
+  for (i = 0; i < FW_WB_NBLOCKS; ++i)
+    {
+      tiz_check_null_ret_oom ((ap_prc->blocks_[i].p_data
+                               = tiz_mem_alloc (ap_prc->block_size_)));
+      ap_prc->blocks_[i].len = 0;
+      ap_prc->blocks_[i].busy = false;
+    }
+
+  TIZ_NOTICE (handleOf (ap_prc),
+              "Write-behind: block size [%zu] sync interval [%zu]",
+              ap_prc->block_size_, ap_prc->sync_bytes_);
+  return OMX_ErrorNone;
+}
+
+static void
+free_blocks (fw_prc_t * ap_prc)
+{
+  int i = 0;
+  assert (ap_prc);
+  for (i = 0; i < FW_WB_NBLOCKS; ++i)
+    {
+      tiz_mem_free (ap_prc->blocks_[i].p_data);
+      ap_prc->blocks_[i].p_data = NULL;
+      ap_prc->blocks_[i].len = 0;
+      ap_prc->blocks_[i].busy = false;
+    }
+}
+
+/* Start the writeback of the block just written, and drop the pages of the
+   blocks before it, which are clean by now, so that a long capture doesn't
+   fill up the page cache */
+static void
+drop_written_pages (fw_prc_t * ap_prc, const fw_block_t * ap_block)
+{
+  const int fd = fileno (ap_prc->p_file_);
+  assert (ap_block);
+  (void) sync_file_range (fd, ap_block->offset, (off_t) ap_block->len,
+                          SYNC_FILE_RANGE_WRITE);
+  if (ap_block->offset > ap_prc->dropped_offset_)
+    {
+      (void) posix_fadvise (fd, ap_prc->dropped_offset_,
+                            ap_block->offset - ap_prc->dropped_offset_,
+                            POSIX_FADV_DONTNEED);
+      ap_prc->dropped_offset_ = ap_block->offset;
+    }
+}
+
+static void
+block_written (fw_prc_t * ap_prc, const tiz_aio_req_t * ap_req)
+{
+  fw_block_t * p_block = NULL;
+
+  assert (ap_prc);
+  assert (ap_req);
+  assert (ap_prc->npending_ > 0);
+
+  ap_prc->npending_--;
+  if (ap_req->result < 0 && 0 == ap_prc->wb_error_)
+    {
+      ap_prc->wb_error_ = ap_req->error;
+    }
+
+  /* Syncs have no block */
+  if ((p_block = ap_req->p_cookie))
+    {
+      if (ap_req->result >= 0)
+        {
+          drop_written_pages (ap_prc, p_block);
+        }
+      p_block->len = 0;
+      p_block->busy = false;
+    }
+}
+
+static OMX_ERRORTYPE
+submit_block (fw_prc_t * ap_prc, const bool a_sync)
+{
+  fw_block_t * p_block = NULL;
+  tiz_aio_req_t reqs[2];
+  size_t nreqs = 0;
+
+  assert (ap_prc);
+  assert (ap_prc->p_aio_);
+
+  p_block = &(ap_prc->blocks_[ap_prc->fill_block_]);
+  if (!p_block->busy && p_block->len > 0)
+    {
+      p_block->busy = true;
+      p_block->offset = ap_prc->write_offset_;
+      reqs[nreqs].op = ETIZAioOpWrite;
+      reqs[nreqs].fd = fileno (ap_prc->p_file_);
+      reqs[nreqs].p_data = p_block->p_data;
+      reqs[nreqs].nbytes = p_block->len;
+      reqs[nreqs].offset = p_block->offset;
+      reqs[nreqs].p_cookie = p_block;
+      ap_prc->write_offset_ += (off_t) p_block->len;
+      ap_prc->unsynced_ += p_block->len;
+      ap_prc->fill_block_ = (ap_prc->fill_block_ + 1) % FW_WB_NBLOCKS;
+      nreqs++;
+    }
+
+  /* This bounds the amount of data lost if the system goes down */
+  if (ap_prc->sync_bytes_ > 0 && ap_prc->unsynced_ > 0
+      && (a_sync || ap_prc->unsynced_ >= ap_prc->sync_bytes_))
+    {
+      reqs[nreqs].op = ETIZAioOpDataSync;
+      reqs[nreqs].fd = fileno (ap_prc->p_file_);
+      reqs[nreqs].p_data = NULL;
+      reqs[nreqs].nbytes = 0;
+      reqs[nreqs].offset = 0;
+      reqs[nreqs].p_cookie = NULL;
+      ap_prc->unsynced_ = 0;
+      nreqs++;
+    }
+
+  ap_prc->npending_ += nreqs;
+  return nreqs > 0 ? tiz_aio_submit (ap_prc->p_aio_, reqs, nreqs)
+                   : OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+check_write_error (fw_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (0 != ap_prc->wb_error_)
+    {
+      TIZ_ERROR (handleOf (ap_prc), "An error occurred while writing (%s)",
+                 strerror (ap_prc->wb_error_));
+      return OMX_ErrorInsufficientResources;
+    }
+  return OMX_ErrorNone;
+}
+
+/* The EOS header is held until everything before it has been written. A
+   write error is only reported once the header is back, so that the
+   component is never left waiting for it. */
+static OMX_ERRORTYPE
+release_eos_header (fw_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+
+  assert (ap_prc);
+
+  if ((p_hdr = ap_prc->p_eos_hdr_) && 0 == ap_prc->npending_)
+    {
+      TIZ_DEBUG (handleOf (ap_prc), "OMX_BUFFERFLAG_EOS in HEADER [%p]", p_hdr);
+      ap_prc->p_eos_hdr_ = NULL;
+      tiz_srv_issue_event ((OMX_PTR) ap_prc, OMX_EventBufferFlag,
+                           ARATELIA_FILE_WRITER_PORT_INDEX, p_hdr->nFlags,
+                           NULL);
+      tiz_check_omx (
+        tiz_krn_release_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                ARATELIA_FILE_WRITER_PORT_INDEX, p_hdr));
+    }
+  return check_write_error (ap_prc);
+}
+
+static OMX_ERRORTYPE
+fill_blocks (fw_prc_t * ap_prc)
+{
+  assert (ap_prc);
+
+  tiz_check_omx (release_eos_header (ap_prc));
 
-  if (p_prc->p_file_ && !(p_prc->eos_) && p_hdr->nFilledLen > 0)
+  /* Only claim a header when both the block being filled and the next one
+     are free, as a header may spill over into the next block */
+  while (!ap_prc->eos_ && !ap_prc->p_eos_hdr_
+         && !ap_prc->blocks_[ap_prc->fill_block_].busy
+         && !ap_prc->blocks_[(ap_prc->fill_block_ + 1) % FW_WB_NBLOCKS].busy)
     {
-      int elems_written = 0;
-      if (1 != (elems_written = fwrite (p_hdr->pBuffer + p_hdr->nOffset,
-                                        p_hdr->nFilledLen, 1, p_prc->p_file_)))
+      OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+
+      tiz_check_omx (tiz_krn_claim_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                           ARATELIA_FILE_WRITER_PORT_INDEX, 0,
+                                           &p_hdr));
+      if (!p_hdr)
+        {
+          break;
+        }
+
+      while (p_hdr->nFilledLen > 0)
+        {
+          fw_block_t * p_block = &(ap_prc->blocks_[ap_prc->fill_block_]);
+          const size_t count
+            = MIN (p_hdr->nFilledLen, ap_prc->block_size_ - p_block->len);
+          assert (!p_block->busy);
+          memcpy (p_block->p_data + p_block->len,
+                  p_hdr->pBuffer + p_hdr->nOffset, count);
+          p_block->len += count;
+          p_hdr->nOffset += count;
+          p_hdr->nFilledLen -= count;
+          ap_prc->counter_ += count;
+          if (p_block->len == ap_prc->block_size_)
+            {
+              tiz_check_omx (submit_block (ap_prc, false));
+            }
+        }
+
+      p_hdr->nOffset = 0;
+      if (p_hdr->nFlags & OMX_BUFFERFLAG_EOS)
+        {
+          ap_prc->p_eos_hdr_ = p_hdr;
+          tiz_check_omx (submit_block (ap_prc, true));
+        }
+      else
         {
-          TIZ_ERROR (handleOf (p_prc),
-                     "elems_written [%d] p_hdr->nFilledLen [%d]: "
-                     "An error occurred while writing",
-                     elems_written, p_hdr->nFilledLen);
+          tiz_check_omx (
+            tiz_krn_release_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                    ARATELIA_FILE_WRITER_PORT_INDEX, p_hdr));
+        }
+    }
+
+  return release_eos_header (ap_prc);
+}
+
+/* Write out the partial block and wait for everything queued */
+static OMX_ERRORTYPE
+complete_blocks (fw_prc_t * ap_prc, const bool a_sync)
+{
+  tiz_aio_req_t done[2 * FW_WB_NBLOCKS];
+  size_t ndone = 0;
+  size_t i = 0;
+
+  assert (ap_prc);
+
+  if (!ap_prc->p_aio_)
+    {
+      return OMX_ErrorNone;
+    }
+
+  tiz_check_omx (submit_block (ap_prc, a_sync));
+  tiz_aio_drain (ap_prc->p_aio_);
+  while ((ndone = tiz_aio_reap (ap_prc->p_aio_, done, 2 * FW_WB_NBLOCKS)) > 0)
+    {
+      for (i = 0; i < ndone; ++i)
+        {
+          block_written (ap_prc, &(done[i]));
+        }
+    }
+  return release_eos_header (ap_prc);
+}
+
+static void
+reap_writes (fw_prc_t * ap_prc)
+{
+  tiz_aio_req_t done[FW_MAX_WRITES_IN_FLIGHT];
+  size_t ndone = 0;
+  size_t i = 0;
+
+  assert (ap_prc);
+  assert (ap_prc->p_aio_);
+
+  ndone = tiz_aio_reap (ap_prc->p_aio_, done, FW_MAX_WRITES_IN_FLIGHT);
+  for (i = 0; i < ndone; ++i)
+    {
+      fw_write_t * p_write = NULL;
+      if (ap_prc->block_size_ > 0)
+        {
+          block_written (ap_prc, &(done[i]));
+          continue;
+        }
+      p_write = done[i].p_cookie;
+      assert (p_write);
+      p_write->done = true;
+      p_write->result = done[i].result;
+      p_write->error = done[i].error;
+    }
+}
+
+/* Headers are returned in the order they were received */
+static OMX_ERRORTYPE
+release_completed_writes (fw_prc_t * ap_prc)
+{
+  assert (ap_prc);
+
+  while (ap_prc->nwrites_ > 0 && ap_prc->writes_[ap_prc->write_head_].done)
+    {
+      fw_write_t * p_write = &(ap_prc->writes_[ap_prc->write_head_]);
+      OMX_BUFFERHEADERTYPE * p_hdr = p_write->p_hdr;
+
+      if (p_write->result < 0)
+        {
+          TIZ_ERROR (handleOf (ap_prc),
+                     "p_hdr->nFilledLen [%d]: "
+                     "An error occurred while writing (%s)",
+                     p_hdr->nFilledLen, strerror (p_write->error));
           return OMX_ErrorInsufficientResources;
         }
 
+      ap_prc->counter_ += p_hdr->nFilledLen;
       p_hdr->nFilledLen = 0;
-      p_prc->counter_ += p_hdr->nFilledLen;
 
-      TIZ_TRACE (handleOf (p_prc),
-                 "Writing data from HEADER [%p]...nFilledLen [%d] "
-                 "counter [%d] elems_written [%d]",
-                 p_hdr, p_hdr->nFilledLen, p_prc->counter_, elems_written);
-    }
+      TIZ_TRACE (handleOf (ap_prc),
+                 "Written data from HEADER [%p]... counter [%d]", p_hdr,
+                 ap_prc->counter_);
 
+      if (p_hdr->nFlags & OMX_BUFFERFLAG_EOS)
+        {
+          TIZ_DEBUG (handleOf (ap_prc), "OMX_BUFFERFLAG_EOS in HEADER [%p]",
+                     p_hdr);
+          tiz_srv_issue_event ((OMX_PTR) ap_prc, OMX_EventBufferFlag,
+                               ARATELIA_FILE_WRITER_PORT_INDEX,
+                               p_hdr->nFlags, NULL);
+        }
+
+      ap_prc->write_head_ = (ap_prc->write_head_ + 1) % FW_MAX_WRITES_IN_FLIGHT;
+      ap_prc->nwrites_--;
+      tiz_check_omx (
+        tiz_krn_release_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                ARATELIA_FILE_WRITER_PORT_INDEX, p_hdr));
+    }
   return OMX_ErrorNone;
 }
 
+static OMX_ERRORTYPE
+submit_writes (fw_prc_t * ap_prc)
+{
+  tiz_aio_req_t reqs[FW_MAX_WRITES_IN_FLIGHT];
+  size_t nreqs = 0;
+
+  assert (ap_prc);
+  assert (ap_prc->p_aio_);
+
+  if (ap_prc->block_size_ > 0)
+    {
+      return fill_blocks (ap_prc);
+    }
+
+  while (!ap_prc->eos_ && ap_prc->nwrites_ < FW_MAX_WRITES_IN_FLIGHT)
+    {
+      OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+      fw_write_t * p_write = NULL;
+
+      tiz_check_omx (tiz_krn_claim_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                           ARATELIA_FILE_WRITER_PORT_INDEX, 0,
+                                           &p_hdr));
+      if (!p_hdr)
+        {
+          break;
+        }
+
+      TIZ_TRACE (handleOf (ap_prc), "Claimed HEADER [%p]...", p_hdr);
+
+      p_write = &(ap_prc->writes_[(ap_prc->write_head_ + ap_prc->nwrites_)
+                                  % FW_MAX_WRITES_IN_FLIGHT]);
+      p_write->p_hdr = p_hdr;
+      p_write->result = 0;
+      p_write->error = 0;
+      /* Empty buffers are done already; they only keep their place in the
+         queue */
+      p_write->done = (0 == p_hdr->nFilledLen);
+      ap_prc->nwrites_++;
+
+      if (p_hdr->nFilledLen > 0)
+        {
+          reqs[nreqs].op = ETIZAioOpWrite;
+          reqs[nreqs].fd = fileno (ap_prc->p_file_);
+          reqs[nreqs].p_data = p_hdr->pBuffer + p_hdr->nOffset;
+          reqs[nreqs].nbytes = p_hdr->nFilledLen;
+          reqs[nreqs].offset = ap_prc->write_offset_;
+          reqs[nreqs].p_cookie = p_write;
+          ap_prc->write_offset_ += p_hdr->nFilledLen;
+          nreqs++;
+        }
+    }
+
+  if (nreqs > 0)
+    {
+      tiz_check_omx (tiz_aio_submit (ap_prc->p_aio_, reqs, nreqs));
+    }
+
+  return release_completed_writes (ap_prc);
+}
+
+/* Write out the partial block, and hand back the headers whose writes are
+   done. The rest go back from the completion handler as their writes
+   finish; the kernel waits for them before completing the flush, the port
+   disable or the transition to Idle. */
+static OMX_ERRORTYPE
+flush_writes (fw_prc_t * ap_prc, const bool a_sync)
+{
+  assert (ap_prc);
+  if (!ap_prc->p_aio_)
+    {
+      return OMX_ErrorNone;
+    }
+  if (ap_prc->block_size_ > 0)
+    {
+      tiz_check_omx (submit_block (ap_prc, a_sync));
+      return release_eos_header (ap_prc);
+    }
+  reap_writes (ap_prc);
+  return release_completed_writes (ap_prc);
+}
+
+/* Wait for the writes in flight and hand back their headers. Only used when
+   the file is about to be closed. */
+static OMX_ERRORTYPE
+complete_writes (fw_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->block_size_ > 0)
+    {
+      return complete_blocks (ap_prc, false);
+    }
+  if (ap_prc->p_aio_)
+    {
+      tiz_aio_drain (ap_prc->p_aio_);
+      reap_writes (ap_prc);
+    }
+  return release_completed_writes (ap_prc);
+}
+
+static void
+aio_completion_handler (OMX_PTR ap_prc, tiz_event_pluggable_t * ap_event)
+{
+  fw_prc_t * p_prc = ap_prc;
+  assert (p_prc);
+  assert (ap_event);
+
+  if (p_prc->p_aio_)
+    {
+      reap_writes (p_prc);
+    }
+
+  /* Headers can't be returned or claimed while paused. When stopped, or with
+     the port disabled, the ones still held are only returned. */
+  if (p_prc->p_aio_ && !p_prc->paused_)
+    {
+      OMX_ERRORTYPE rc = OMX_ErrorNone;
+      if (p_prc->started_ && !p_prc->port_disabled_)
+        {
+          rc = submit_writes (p_prc);
+        }
+      else
+        {
+          rc = p_prc->block_size_ > 0 ? release_eos_header (p_prc)
+                                      : release_completed_writes (p_prc);
+        }
+      if (OMX_ErrorNone != rc)
+        {
+          tiz_srv_issue_err_event ((OMX_PTR) p_prc,
+                                   OMX_ErrorInsufficientResources);
+        }
+    }
+  tiz_mem_free (ap_event);
+}
+
+/**
+ * Called by the I/O engine when there are completed writes.
+ *
+ * @note This function is called from one of the engine's threads!
+ */
+static void
+aio_completion (void * ap_arg)
+{
+  fw_prc_t * p_prc = ap_arg;
+  tiz_event_pluggable_t * p_event = NULL;
+  assert (p_prc);
+
+  p_event = tiz_mem_calloc (1, sizeof (tiz_event_pluggable_t));
+  if (p_event)
+    {
+      p_event->p_servant = p_prc;
+      p_event->p_data = NULL;
+      p_event->pf_hdlr = aio_completion_handler;
+      tiz_comp_event_pluggable (handleOf (p_prc), p_event);
+    }
+}
+
 /*
  * from tiz_srv class
  */
@@ -182,6 +681,28 @@ fw_proc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
       return OMX_ErrorInsufficientResources;
     }
 
+  /* A new, truncated file */
+  p_prc->write_offset_ = 0;
+  p_prc->dropped_offset_ = 0;
+  p_prc->unsynced_ = 0;
+  p_prc->fill_block_ = 0;
+  p_prc->wb_error_ = 0;
+
+  p_prc->block_size_
+    = get_config_bytes ("OMX.Aratelia.file_writer.binary.write_behind_block_kb");
+  if (p_prc->block_size_ > 0)
+    {
+      p_prc->sync_bytes_
+        = get_config_bytes ("OMX.Aratelia.file_writer.binary.sync_interval_kb");
+      tiz_check_omx (alloc_blocks (p_prc));
+    }
+
+  /* Writes are done off the component's thread, so that a slow file system
+     doesn't hold up the processing of commands */
+  tiz_check_omx (tiz_aio_init (&(p_prc->p_aio_),
+                               p_prc->block_size_ > 0 ? 1 : FW_AIO_THREADS,
+                               aio_completion, p_prc));
+
   return OMX_ErrorNone;
 }
 
@@ -191,6 +712,12 @@ fw_proc_deallocate_resources (void * ap_obj)
   fw_prc_t * p_prc = ap_obj;
   assert (ap_obj);
 
+  (void) complete_writes (p_prc);
+  tiz_aio_destroy (p_prc->p_aio_);
+  p_prc->p_aio_ = NULL;
+  free_blocks (p_prc);
+  p_prc->block_size_ = 0;
+
   if (p_prc->p_file_)
     {
       fclose (p_prc->p_file_);
@@ -210,6 +737,7 @@ fw_proc_prepare_to_transfer (void * ap_obj, OMX_U32 a_pid)
   assert (ap_obj);
   p_prc->counter_ = 0;
   p_prc->eos_ = false;
+  p_prc->started_ = true;
   return OMX_ErrorNone;
 }
 
@@ -226,7 +754,11 @@ fw_proc_transfer_and_process (void * ap_obj, OMX_U32 a_pid)
 static OMX_ERRORTYPE
 fw_proc_stop_and_return (void * ap_obj)
 {
-  return OMX_ErrorNone;
+  fw_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  p_prc->started_ = false;
+  p_prc->paused_ = false;
+  return flush_writes (p_prc, true);
 }
 
 /*
@@ -236,32 +768,50 @@ fw_proc_stop_and_return (void * ap_obj)
 static OMX_ERRORTYPE
 fw_proc_buffers_ready (const void * ap_obj)
 {
-  const fw_prc_t * p_prc = ap_obj;
+  return submit_writes ((fw_prc_t *) ap_obj);
+}
 
-  if (!p_prc->eos_)
-    {
-      OMX_BUFFERHEADERTYPE * p_hdr = NULL;
-      tiz_check_omx (tiz_krn_claim_buffer (tiz_get_krn (handleOf (p_prc)),
-                                               ARATELIA_FILE_WRITER_PORT_INDEX,
-                                               0, &p_hdr));
-      if (p_hdr)
-        {
-          TIZ_TRACE (handleOf (p_prc), "Claimed HEADER [%p]...", p_hdr);
-          tiz_check_omx (fw_proc_write_buffer (p_prc, p_hdr));
-          if (p_hdr->nFlags & OMX_BUFFERFLAG_EOS)
-            {
-              TIZ_DEBUG (handleOf (p_prc), "OMX_BUFFERFLAG_EOS in HEADER [%p]",
-                         p_hdr);
-              tiz_srv_issue_event ((OMX_PTR) p_prc, OMX_EventBufferFlag,
-                                   ARATELIA_FILE_WRITER_PORT_INDEX,
-                                   p_hdr->nFlags, NULL);
-            }
-          tiz_check_omx (
-            tiz_krn_release_buffer (tiz_get_krn (handleOf (p_prc)),
-                                    ARATELIA_FILE_WRITER_PORT_INDEX, p_hdr));
-        }
-    }
+static OMX_ERRORTYPE
+fw_proc_pause (const void * ap_obj)
+{
+  fw_prc_t * p_prc = (fw_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->paused_ = true;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+fw_proc_resume (const void * ap_obj)
+{
+  fw_prc_t * p_prc = (fw_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->paused_ = false;
+  return p_prc->port_disabled_ ? OMX_ErrorNone : submit_writes (p_prc);
+}
+
+static OMX_ERRORTYPE
+fw_proc_port_flush (const void * ap_obj, OMX_U32 a_pid)
+{
+  /* Data already claimed is written out rather than dropped, so that the
+     file has no holes */
+  return flush_writes ((fw_prc_t *) ap_obj, false);
+}
+
+static OMX_ERRORTYPE
+fw_proc_port_disable (const void * ap_obj, OMX_U32 a_pid)
+{
+  fw_prc_t * p_prc = (fw_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->port_disabled_ = true;
+  return flush_writes (p_prc, false);
+}
 
+static OMX_ERRORTYPE
+fw_proc_port_enable (const void * ap_obj, OMX_U32 a_pid)
+{
+  fw_prc_t * p_prc = (fw_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->port_disabled_ = false;
   return OMX_ErrorNone;
 }
 
@@ -323,6 +873,16 @@ fw_prc_init (void * ap_tos, void * ap_hdl)
      tiz_srv_stop_and_return, fw_proc_stop_and_return,
      /* TIZ_CLASS_COMMENT: */
      tiz_prc_buffers_ready, fw_proc_buffers_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_pause, fw_proc_pause,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_resume, fw_proc_resume,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_flush, fw_proc_port_flush,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_disable, fw_proc_port_disable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_enable, fw_proc_port_enable,
      /* TIZ_CLASS_COMMENT: stop value */
      0);
 
@@ -34,10 +34,35 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <sys/types.h>
+
+#include <tizplatform.h>
 
 #include "fwprc.h"
 #include "tizprc_decls.h"
 
+#define FW_MAX_WRITES_IN_FLIGHT 8
+#define FW_WB_NBLOCKS 4
+
+typedef struct fw_write fw_write_t;
+struct fw_write
+{
+  OMX_BUFFERHEADERTYPE * p_hdr;
+  bool done;
+  ssize_t result;
+  int error;
+};
+
+/* A write-behind block */
+typedef struct fw_block fw_block_t;
+struct fw_block
+{
+  OMX_U8 * p_data;
+  size_t len;
+  off_t offset;
+  bool busy;
+};
+
 typedef struct fw_prc fw_prc_t;
 struct fw_prc
 {
@@ -47,6 +72,23 @@ struct fw_prc
   OMX_PARAM_CONTENTURITYPE * p_uri_param_;
   OMX_U32 counter_;
   bool eos_;
+  tiz_aio_t * p_aio_;
+  fw_write_t writes_[FW_MAX_WRITES_IN_FLIGHT];
+  OMX_U32 write_head_;
+  OMX_U32 nwrites_;
+  off_t write_offset_;
+  bool started_;
+  bool paused_;
+  bool port_disabled_;
+  size_t block_size_;
+  size_t sync_bytes_;
+  fw_block_t blocks_[FW_WB_NBLOCKS];
+  OMX_U32 fill_block_;
+  OMX_U32 npending_;
+  size_t unsynced_;
+  off_t dropped_offset_;
+  OMX_BUFFERHEADERTYPE * p_eos_hdr_;
+  int wb_error_;
 };
 
 typedef struct fw_prc_class fw_prc_class_t;
@@ -0,0 +1,59 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   flace.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - FLAC encoder component constants
+ *
+ *
+ */
+#ifndef FLACE_H
+#define FLACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+#include <OMX_TizoniaExt.h>
+
+#define ARATELIA_FLAC_ENCODER_DEFAULT_ROLE OMX_ROLE_AUDIO_ENCODER_FLAC
+#define ARATELIA_FLAC_ENCODER_COMPONENT_NAME "OMX.Aratelia.audio_encoder.flac"
+/* With libtizonia, port indexes must start at index 0 */
+#define ARATELIA_FLAC_ENCODER_INPUT_PORT_INDEX 0
+#define ARATELIA_FLAC_ENCODER_OUTPUT_PORT_INDEX 1
+#define ARATELIA_FLAC_ENCODER_PORT_MIN_BUF_COUNT 4
+#define ARATELIA_FLAC_ENCODER_PORT_MIN_INPUT_BUF_SIZE 8192 * 4
+#define ARATELIA_FLAC_ENCODER_PORT_MIN_OUTPUT_BUF_SIZE 8192 * 8
+#define ARATELIA_FLAC_ENCODER_PORT_NONCONTIGUOUS OMX_FALSE
+#define ARATELIA_FLAC_ENCODER_PORT_ALIGNMENT 0
+#define ARATELIA_FLAC_ENCODER_PORT_SUPPLIERPREF OMX_BufferSupplyInput
+/* Number of FLAC frames handed to a worker thread in one go */
+#define ARATELIA_FLAC_ENCODER_FRAMES_PER_SEGMENT 16
+/* Upper limit for the number of encoder threads */
+#define ARATELIA_FLAC_ENCODER_MAX_THREADS 16
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLACE_H */
@@ -0,0 +1,875 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   flacepool.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - FLAC encoder worker pool
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <FLAC/all.h>
+
+#include <tizplatform.h>
+
+#include "flacepool.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.flac_encoder.pool"
+#endif
+
+/* Segments per worker; while a worker encodes one segment, the component
+ * thread can be filling the next one */
+#define FLACE_SEGMENTS_PER_WORKER 2
+/* "fLaC" marker + metadata block header + STREAMINFO */
+#define FLACE_STREAM_HEADER_LEN (4 + 4 + 34)
+/* Largest interleaved PCM frame: 8 channels, 24 bits */
+#define FLACE_MAX_PCM_FRAME_LEN (8 * 3)
+
+typedef enum flace_segment_state flace_segment_state_t;
+enum flace_segment_state
+{
+  ESegmentFree = 0, /* Owned by the component thread (possibly filling) */
+  ESegmentQueued,   /* Owned by the workers */
+  ESegmentDone      /* Encoded; owned by the component thread again */
+};
+
+typedef struct flace_segment flace_segment_t;
+struct flace_segment
+{
+  flace_segment_state_t state;
+  FLAC__int32 * p_pcm;
+  size_t nframes;
+  OMX_U32 first_frame;
+  OMX_U8 * p_out;
+  size_t out_len;
+  size_t out_alloc;
+  size_t out_read;
+  bool failed;
+};
+
+typedef struct flace_worker flace_worker_t;
+struct flace_worker
+{
+  flace_pool_t * p_pool;
+  FLAC__StreamEncoder * p_enc;
+  tiz_thread_t thread;
+  bool started;
+};
+
+struct flace_pool
+{
+  flace_pool_params_t params;
+  size_t segment_frames;
+  size_t pcm_frame_len;
+  flace_worker_t * p_workers;
+  unsigned int nworkers;
+  flace_segment_t * p_segments;
+  unsigned int nsegments;
+  unsigned int head; /* next segment to be read */
+  unsigned int tail; /* segment being filled */
+  unsigned int nsubmitted;
+  OMX_U32 next_frame;
+  OMX_U8 carry[FLACE_MAX_PCM_FRAME_LEN];
+  size_t carry_len;
+  OMX_U8 header[FLACE_STREAM_HEADER_LEN];
+  size_t header_read;
+  bool drained;
+  tiz_queue_t * p_queue;
+  tiz_mutex_t mutex;
+  tiz_cond_t cond;
+  flace_pool_notify_f pf_notify;
+  void * p_notify_arg;
+};
+
+/* CRC-16, polynomial x^16 + x^15 + x^2 + 1, as used in FLAC frame footers */
+static const OMX_U16 crc16_table[256] = {
+  0x0000, 0x8005, 0x800f, 0x000a, 0x801b, 0x001e, 0x0014, 0x8011,
+  0x8033, 0x0036, 0x003c, 0x8039, 0x0028, 0x802d, 0x8027, 0x0022,
+  0x8063, 0x0066, 0x006c, 0x8069, 0x0078, 0x807d, 0x8077, 0x0072,
+  0x0050, 0x8055, 0x805f, 0x005a, 0x804b, 0x004e, 0x0044, 0x8041,
+  0x80c3, 0x00c6, 0x00cc, 0x80c9, 0x00d8, 0x80dd, 0x80d7, 0x00d2,
+  0x00f0, 0x80f5, 0x80ff, 0x00fa, 0x80eb, 0x00ee, 0x00e4, 0x80e1,
+  0x00a0, 0x80a5, 0x80af, 0x00aa, 0x80bb, 0x00be, 0x00b4, 0x80b1,
+  0x8093, 0x0096, 0x009c, 0x8099, 0x0088, 0x808d, 0x8087, 0x0082,
+  0x8183, 0x0186, 0x018c, 0x8189, 0x0198, 0x819d, 0x8197, 0x0192,
+  0x01b0, 0x81b5, 0x81bf, 0x01ba, 0x81ab, 0x01ae, 0x01a4, 0x81a1,
+  0x01e0, 0x81e5, 0x81ef, 0x01ea, 0x81fb, 0x01fe, 0x01f4, 0x81f1,
+  0x81d3, 0x01d6, 0x01dc, 0x81d9, 0x01c8, 0x81cd, 0x81c7, 0x01c2,
+  0x0140, 0x8145, 0x814f, 0x014a, 0x815b, 0x015e, 0x0154, 0x8151,
+  0x8173, 0x0176, 0x017c, 0x8179, 0x0168, 0x816d, 0x8167, 0x0162,
+  0x8123, 0x0126, 0x012c, 0x8129, 0x0138, 0x813d, 0x8137, 0x0132,
+  0x0110, 0x8115, 0x811f, 0x011a, 0x810b, 0x010e, 0x0104, 0x8101,
+  0x8303, 0x0306, 0x030c, 0x8309, 0x0318, 0x831d, 0x8317, 0x0312,
+  0x0330, 0x8335, 0x833f, 0x033a, 0x832b, 0x032e, 0x0324, 0x8321,
+  0x0360, 0x8365, 0x836f, 0x036a, 0x837b, 0x037e, 0x0374, 0x8371,
+  0x8353, 0x0356, 0x035c, 0x8359, 0x0348, 0x834d, 0x8347, 0x0342,
+  0x03c0, 0x83c5, 0x83cf, 0x03ca, 0x83db, 0x03de, 0x03d4, 0x83d1,
+  0x83f3, 0x03f6, 0x03fc, 0x83f9, 0x03e8, 0x83ed, 0x83e7, 0x03e2,
+  0x83a3, 0x03a6, 0x03ac, 0x83a9, 0x03b8, 0x83bd, 0x83b7, 0x03b2,
+  0x0390, 0x8395, 0x839f, 0x039a, 0x838b, 0x038e, 0x0384, 0x8381,
+  0x0280, 0x8285, 0x828f, 0x028a, 0x829b, 0x029e, 0x0294, 0x8291,
+  0x82b3, 0x02b6, 0x02bc, 0x82b9, 0x02a8, 0x82ad, 0x82a7, 0x02a2,
+  0x82e3, 0x02e6, 0x02ec, 0x82e9, 0x02f8, 0x82fd, 0x82f7, 0x02f2,
+  0x02d0, 0x82d5, 0x82df, 0x02da, 0x82cb, 0x02ce, 0x02c4, 0x82c1,
+  0x8243, 0x0246, 0x024c, 0x8249, 0x0258, 0x825d, 0x8257, 0x0252,
+  0x0270, 0x8275, 0x827f, 0x027a, 0x826b, 0x026e, 0x0264, 0x8261,
+  0x0220, 0x8225, 0x822f, 0x022a, 0x823b, 0x023e, 0x0234, 0x8231,
+  0x8213, 0x0216, 0x021c, 0x8219, 0x0208, 0x820d, 0x8207, 0x0202
+};
+
+/* CRC-8, polynomial x^8 + x^2 + x + 1, as used in FLAC frame headers */
+static OMX_U8
+crc8 (const OMX_U8 * ap_data, size_t a_len)
+{
+  OMX_U8 crc = 0;
+  unsigned int b = 0;
+  while (a_len--)
+    {
+      crc ^= *ap_data++;
+      for (b = 0; b < 8; ++b)
+        {
+          crc = (crc & 0x80) ? (OMX_U8) ((crc << 1) ^ 0x07)
+                             : (OMX_U8) (crc << 1);
+        }
+    }
+  return crc;
+}
+
+static OMX_U16
+crc16 (const OMX_U8 * ap_data, size_t a_len)
+{
+  OMX_U16 crc = 0;
+  while (a_len--)
+    {
+      crc = (OMX_U16) ((crc << 8) ^ crc16_table[(crc >> 8) ^ *ap_data++]);
+    }
+  return crc;
+}
+
+/* Length of the UTF-8-like coded frame number that starts with a_lead */
+static size_t
+coded_number_len (const OMX_U8 a_lead)
+{
+  size_t len = 0;
+  if (!(a_lead & 0x80))
+    {
+      return 1;
+    }
+  while (len < 8 && (a_lead & (0x80 >> len)))
+    {
+      ++len;
+    }
+  return (len >= 2 && len <= 7) ? len : 0;
+}
+
+static size_t
+code_number (OMX_U32 a_number, OMX_U8 * ap_dst)
+{
+  size_t len = 0;
+  size_t i = 0;
+
+  if (a_number < 0x80)
+    {
+      ap_dst[0] = (OMX_U8) a_number;
+      return 1;
+    }
+
+  len = a_number < 0x800 ? 2 : a_number < 0x10000
+                                 ? 3
+                                 : a_number < 0x200000
+                                     ? 4
+                                     : a_number < 0x4000000 ? 5 : 6;
+  for (i = len - 1; i > 0; --i)
+    {
+      ap_dst[i] = (OMX_U8) (0x80 | (a_number & 0x3F));
+      a_number >>= 6;
+    }
+  ap_dst[0] = (OMX_U8) ((0xFF00 >> len) | a_number);
+  return len;
+}
+
+static bool
+ensure_out_space (flace_segment_t * ap_seg, size_t a_nbytes)
+{
+  if (ap_seg->out_len + a_nbytes > ap_seg->out_alloc)
+    {
+      size_t new_alloc = (ap_seg->out_len + a_nbytes) * 2;
+      OMX_U8 * p_new = tiz_mem_realloc (ap_seg->p_out, new_alloc);
+      if (!p_new)
+        {
+          return false;
+        }
+      ap_seg->p_out = p_new;
+      ap_seg->out_alloc = new_alloc;
+    }
+  return true;
+}
+
+/* Each encoder numbers its frames from zero. Rewrite the frame number in the
+ * header with the frame's position in the whole stream; this may change the
+ * header length, so both CRCs are recomputed. */
+static bool
+append_renumbered_frame (flace_segment_t * ap_seg, const OMX_U8 * ap_frame,
+                         size_t a_len, OMX_U32 a_number)
+{
+  size_t num_len = 0;
+  size_t extra_len = 0;
+  size_t hdr_len = 0;
+  size_t body_len = 0;
+  size_t n = 0;
+  OMX_U8 * p_dst = NULL;
+  OMX_U16 crc = 0;
+  const unsigned int bs_code = ap_frame[2] >> 4;
+  const unsigned int sr_code = ap_frame[2] & 0x0F;
+
+  if (a_len < 4 + 1 + 1 + 2 || ap_frame[0] != 0xFF
+      || (ap_frame[1] & 0xFE) != 0xF8)
+    {
+      return false;
+    }
+
+  if (0 == (num_len = coded_number_len (ap_frame[4])))
+    {
+      return false;
+    }
+
+  extra_len = (6 == bs_code ? 1 : 7 == bs_code ? 2 : 0)
+              + (12 == sr_code ? 1 : (13 == sr_code || 14 == sr_code) ? 2 : 0);
+  hdr_len = 4 + num_len + extra_len;
+  if (a_len < hdr_len + 1 + 2)
+    {
+      return false;
+    }
+  body_len = a_len - hdr_len - 1 - 2;
+
+  /* The new number takes at most 6 bytes */
+  if (!ensure_out_space (ap_seg, a_len + 6))
+    {
+      return false;
+    }
+
+  p_dst = ap_seg->p_out + ap_seg->out_len;
+  memcpy (p_dst, ap_frame, 4);
+  n = 4;
+  n += code_number (a_number, p_dst + n);
+  memcpy (p_dst + n, ap_frame + 4 + num_len, extra_len);
+  n += extra_len;
+  p_dst[n] = crc8 (p_dst, n);
+  n += 1;
+  memcpy (p_dst + n, ap_frame + hdr_len + 1, body_len);
+  n += body_len;
+  crc = crc16 (p_dst, n);
+  p_dst[n++] = (OMX_U8) (crc >> 8);
+  p_dst[n++] = (OMX_U8) (crc & 0xFF);
+
+  ap_seg->out_len += n;
+  return true;
+}
+
+static FLAC__StreamEncoderWriteStatus
+write_cback (const FLAC__StreamEncoder * ap_enc, const FLAC__byte a_buffer[],
+             size_t a_bytes, unsigned a_samples, unsigned a_current_frame,
+             void * ap_client_data)
+{
+  flace_segment_t * p_seg = ap_client_data;
+  assert (p_seg);
+
+  /* Metadata is written with zero samples; the pool emits its own stream
+   * header, so the per-segment one is dropped. libFLAC hands over every
+   * frame in a single call. */
+  if (0 == a_samples)
+    {
+      return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+    }
+
+  return append_renumbered_frame (p_seg, a_buffer, a_bytes,
+                                  p_seg->first_frame + a_current_frame)
+           ? FLAC__STREAM_ENCODER_WRITE_STATUS_OK
+           : FLAC__STREAM_ENCODER_WRITE_STATUS_FATAL_ERROR;
+}
+
+static bool
+encode_segment (flace_worker_t * ap_worker, flace_segment_t * ap_seg)
+{
+  const flace_pool_params_t * p_params = &(ap_worker->p_pool->params);
+  FLAC__StreamEncoder * p_enc = ap_worker->p_enc;
+  FLAC__bool ok = true;
+
+  ok &= FLAC__stream_encoder_set_verify (p_enc, false);
+  ok &= FLAC__stream_encoder_set_streamable_subset (
+    p_enc, p_params->blocksize <= 4608);
+  ok &= FLAC__stream_encoder_set_channels (p_enc, p_params->channels);
+  ok &= FLAC__stream_encoder_set_bits_per_sample (p_enc,
+                                                  p_params->bits_per_sample);
+  ok &= FLAC__stream_encoder_set_sample_rate (p_enc, p_params->sample_rate);
+  /* The compression level also sets a default blocksize, so it goes first */
+  ok &= FLAC__stream_encoder_set_compression_level (
+    p_enc, p_params->compression_level);
+  ok &= FLAC__stream_encoder_set_blocksize (p_enc, p_params->blocksize);
+  ok &= FLAC__stream_encoder_set_total_samples_estimate (p_enc,
+                                                         ap_seg->nframes);
+  if (!ok)
+    {
+      return false;
+    }
+
+  if (FLAC__STREAM_ENCODER_INIT_STATUS_OK
+      != FLAC__stream_encoder_init_stream (p_enc, write_cback, NULL, NULL,
+                                           NULL, ap_seg))
+    {
+      return false;
+    }
+
+  ok = FLAC__stream_encoder_process_interleaved (p_enc, ap_seg->p_pcm,
+                                                 ap_seg->nframes);
+  /* finish() flushes the last (possibly short) frame */
+  ok &= FLAC__stream_encoder_finish (p_enc);
+  return ok;
+}
+
+static void *
+worker_thread_func (void * ap_arg)
+{
+  flace_worker_t * p_worker = ap_arg;
+  flace_pool_t * p_pool = NULL;
+
+  assert (p_worker);
+  p_pool = p_worker->p_pool;
+  assert (p_pool);
+
+  for (;;)
+    {
+      OMX_PTR p_item = NULL;
+      flace_segment_t * p_seg = NULL;
+      /* The pool itself is the termination request */
+      if (OMX_ErrorNone != tiz_queue_receive (p_pool->p_queue, &p_item)
+          || p_item == (OMX_PTR) p_pool)
+        {
+          break;
+        }
+      p_seg = p_item;
+
+      p_seg->out_len = 0;
+      p_seg->out_read = 0;
+      p_seg->failed = !encode_segment (p_worker, p_seg);
+      if (p_seg->failed)
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR,
+                   "Encoding of segment starting at frame [%u] failed : [%s]",
+                   p_seg->first_frame,
+                   FLAC__stream_encoder_get_resolved_state_string (
+                     p_worker->p_enc));
+          /* Drop the whole segment, the decoder will resync on the next
+           * frame */
+          p_seg->out_len = 0;
+        }
+
+      (void) tiz_mutex_lock (&(p_pool->mutex));
+      p_seg->state = ESegmentDone;
+      (void) tiz_cond_broadcast (&(p_pool->cond));
+      (void) tiz_mutex_unlock (&(p_pool->mutex));
+
+      if (p_pool->pf_notify)
+        {
+          p_pool->pf_notify (p_pool->p_notify_arg);
+        }
+    }
+
+  return NULL;
+}
+
+static flace_segment_state_t
+segment_state (flace_pool_t * ap_pool, const flace_segment_t * ap_seg)
+{
+  flace_segment_state_t state = ESegmentFree;
+  (void) tiz_mutex_lock (&(ap_pool->mutex));
+  state = ap_seg->state;
+  (void) tiz_mutex_unlock (&(ap_pool->mutex));
+  return state;
+}
+
+static void
+free_segments (flace_pool_t * ap_pool)
+{
+  unsigned int i = 0;
+  assert (ap_pool);
+  for (i = 0; i < ap_pool->nsegments; ++i)
+    {
+      tiz_mem_free (ap_pool->p_segments[i].p_pcm);
+      ap_pool->p_segments[i].p_pcm = NULL;
+      tiz_mem_free (ap_pool->p_segments[i].p_out);
+      ap_pool->p_segments[i].p_out = NULL;
+      ap_pool->p_segments[i].out_alloc = 0;
+    }
+}
+
+static void
+write_stream_header (flace_pool_t * ap_pool)
+{
+  OMX_U8 * p = ap_pool->header;
+  const flace_pool_params_t * p_params = &(ap_pool->params);
+  const OMX_U32 rate = p_params->sample_rate;
+  const OMX_U32 ch = p_params->channels - 1;
+  const OMX_U32 bps = p_params->bits_per_sample - 1;
+
+  memset (p, 0, FLACE_STREAM_HEADER_LEN);
+  memcpy (p, "fLaC", 4);
+  /* Last metadata block, type STREAMINFO, 34 bytes long */
+  p[4] = 0x80;
+  p[7] = 34;
+  p += 8;
+  /* Min and max blocksize. Frame sizes, total samples and MD5 are left as
+   * 'unknown', as the stream can't be rewound once emitted. */
+  p[0] = p[2] = (OMX_U8) (p_params->blocksize >> 8);
+  p[1] = p[3] = (OMX_U8) (p_params->blocksize & 0xFF);
+  /* 20 bits sample rate, 3 bits channels - 1, 5 bits bits per sample - 1 */
+  p[10] = (OMX_U8) (rate >> 12);
+  p[11] = (OMX_U8) ((rate >> 4) & 0xFF);
+  p[12] = (OMX_U8) (((rate & 0x0F) << 4) | (ch << 1) | (bps >> 4));
+  p[13] = (OMX_U8) ((bps & 0x0F) << 4);
+}
+
+static OMX_ERRORTYPE
+submit_segment (flace_pool_t * ap_pool)
+{
+  flace_segment_t * p_seg = &(ap_pool->p_segments[ap_pool->tail]);
+  const OMX_U32 blocksize = ap_pool->params.blocksize;
+
+  assert (ESegmentFree == p_seg->state);
+  assert (p_seg->nframes > 0);
+
+  p_seg->first_frame = ap_pool->next_frame;
+  ap_pool->next_frame += (p_seg->nframes + blocksize - 1) / blocksize;
+  ap_pool->tail = (ap_pool->tail + 1) % ap_pool->nsegments;
+  ap_pool->nsubmitted++;
+
+  (void) tiz_mutex_lock (&(ap_pool->mutex));
+  p_seg->state = ESegmentQueued;
+  (void) tiz_mutex_unlock (&(ap_pool->mutex));
+
+  return tiz_queue_send (ap_pool->p_queue, p_seg);
+}
+
+static void
+convert_frames (const flace_pool_t * ap_pool, const OMX_U8 * ap_src,
+                FLAC__int32 * ap_dst, size_t a_nframes)
+{
+  const size_t nsamples = a_nframes * ap_pool->params.channels;
+  size_t i = 0;
+
+  switch (ap_pool->params.bits_per_sample)
+    {
+      case 8:
+        {
+          for (i = 0; i < nsamples; ++i)
+            {
+              ap_dst[i] = (FLAC__int8) ap_src[i];
+            }
+        }
+        break;
+      case 16:
+        {
+          for (i = 0; i < nsamples; ++i, ap_src += 2)
+            {
+              ap_dst[i] = (FLAC__int16) (ap_src[0] | (ap_src[1] << 8));
+            }
+        }
+        break;
+      case 24:
+        {
+          for (i = 0; i < nsamples; ++i, ap_src += 3)
+            {
+              const FLAC__uint32 s
+                = ap_src[0] | (ap_src[1] << 8) | ((FLAC__uint32) ap_src[2] << 16);
+              ap_dst[i] = (FLAC__int32) (s << 8) >> 8;
+            }
+        }
+        break;
+      default:
+        {
+          assert (0);
+        }
+        break;
+    };
+}
+
+OMX_ERRORTYPE
+flace_pool_init (flace_pool_ptr_t * app_pool, unsigned int a_nworkers,
+                 flace_pool_notify_f apf_notify, void * ap_arg)
+{
+  flace_pool_t * p_pool = NULL;
+  unsigned int i = 0;
+  char name[16];
+
+  assert (app_pool);
+  assert (a_nworkers > 0);
+
+  if (NULL == (p_pool = tiz_mem_calloc (1, sizeof (flace_pool_t))))
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+
+  p_pool->nworkers = a_nworkers;
+  p_pool->nsegments = a_nworkers * FLACE_SEGMENTS_PER_WORKER;
+  p_pool->pf_notify = apf_notify;
+  p_pool->p_notify_arg = ap_arg;
+
+  if (NULL
+        == (p_pool->p_workers
+            = tiz_mem_calloc (p_pool->nworkers, sizeof (flace_worker_t)))
+      || NULL
+           == (p_pool->p_segments
+               = tiz_mem_calloc (p_pool->nsegments, sizeof (flace_segment_t)))
+      || OMX_ErrorNone != tiz_mutex_init (&(p_pool->mutex))
+      || OMX_ErrorNone != tiz_cond_init (&(p_pool->cond))
+      /* Room for every segment plus one termination request per worker, so
+       * that sending never blocks */
+      || OMX_ErrorNone
+           != tiz_queue_init (&(p_pool->p_queue),
+                              p_pool->nsegments + p_pool->nworkers))
+    {
+      flace_pool_destroy (p_pool);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  for (i = 0; i < p_pool->nworkers; ++i)
+    {
+      flace_worker_t * p_worker = &(p_pool->p_workers[i]);
+      p_worker->p_pool = p_pool;
+      if (NULL == (p_worker->p_enc = FLAC__stream_encoder_new ())
+          || OMX_ErrorNone
+               != tiz_thread_create (&(p_worker->thread), 0, 0,
+                                     worker_thread_func, p_worker))
+        {
+          flace_pool_destroy (p_pool);
+          return OMX_ErrorInsufficientResources;
+        }
+      p_worker->started = true;
+      (void) snprintf (name, sizeof (name), "tizflacenc-%u", i);
+      (void) tiz_thread_setname (&(p_worker->thread), name);
+    }
+
+  *app_pool = p_pool;
+  return OMX_ErrorNone;
+}
+
+void
+flace_pool_destroy (flace_pool_t * ap_pool)
+{
+  unsigned int i = 0;
+
+  if (!ap_pool)
+    {
+      return;
+    }
+
+  if (ap_pool->p_workers)
+    {
+      for (i = 0; i < ap_pool->nworkers; ++i)
+        {
+          if (ap_pool->p_workers[i].started)
+            {
+              (void) tiz_queue_send (ap_pool->p_queue, ap_pool);
+            }
+        }
+      for (i = 0; i < ap_pool->nworkers; ++i)
+        {
+          flace_worker_t * p_worker = &(ap_pool->p_workers[i]);
+          if (p_worker->started)
+            {
+              void * p_result = NULL;
+              (void) tiz_thread_join (&(p_worker->thread), &p_result);
+            }
+          if (p_worker->p_enc)
+            {
+              FLAC__stream_encoder_delete (p_worker->p_enc);
+            }
+        }
+      tiz_mem_free (ap_pool->p_workers);
+    }
+
+  if (ap_pool->p_segments)
+    {
+      free_segments (ap_pool);
+      tiz_mem_free (ap_pool->p_segments);
+    }
+
+  tiz_queue_destroy (ap_pool->p_queue);
+  (void) tiz_cond_destroy (&(ap_pool->cond));
+  (void) tiz_mutex_destroy (&(ap_pool->mutex));
+  tiz_mem_free (ap_pool);
+}
+
+OMX_ERRORTYPE
+flace_pool_start (flace_pool_t * ap_pool, const flace_pool_params_t * ap_params)
+{
+  unsigned int i = 0;
+
+  assert (ap_pool);
+  assert (ap_params);
+
+  if (ap_params->channels < 1 || ap_params->channels > 8
+      || (8 != ap_params->bits_per_sample && 16 != ap_params->bits_per_sample
+          && 24 != ap_params->bits_per_sample)
+      || 0 == ap_params->sample_rate || ap_params->sample_rate > 655350
+      || ap_params->frames_per_segment < 1)
+    {
+      return OMX_ErrorUnsupportedSetting;
+    }
+
+  flace_pool_reset (ap_pool);
+  free_segments (ap_pool);
+
+  ap_pool->params = *ap_params;
+  if (0 == ap_pool->params.blocksize)
+    {
+      /* Same defaults that libFLAC uses for each compression level */
+      ap_pool->params.blocksize
+        = ap_pool->params.compression_level <= 2 ? 1152 : 4096;
+    }
+  if (ap_pool->params.blocksize < 16 || ap_pool->params.blocksize > 65535)
+    {
+      return OMX_ErrorUnsupportedSetting;
+    }
+  if (ap_pool->params.compression_level > 8)
+    {
+      ap_pool->params.compression_level = 8;
+    }
+
+  ap_pool->segment_frames
+    = (size_t) ap_pool->params.blocksize * ap_pool->params.frames_per_segment;
+  ap_pool->pcm_frame_len
+    = ap_pool->params.channels * (ap_pool->params.bits_per_sample / 8);
+
+  for (i = 0; i < ap_pool->nsegments; ++i)
+    {
+      flace_segment_t * p_seg = &(ap_pool->p_segments[i]);
+      /* Compressed output is almost always smaller than the raw input */
+      p_seg->out_alloc = ap_pool->segment_frames * ap_pool->pcm_frame_len;
+      if (NULL == (p_seg->p_pcm = tiz_mem_alloc (ap_pool->segment_frames
+                                                 * ap_pool->params.channels
+                                                 * sizeof (FLAC__int32)))
+          || NULL == (p_seg->p_out = tiz_mem_alloc (p_seg->out_alloc)))
+        {
+          free_segments (ap_pool);
+          return OMX_ErrorInsufficientResources;
+        }
+    }
+
+  write_stream_header (ap_pool);
+  return OMX_ErrorNone;
+}
+
+void
+flace_pool_reset (flace_pool_t * ap_pool)
+{
+  unsigned int i = 0;
+  bool busy = true;
+
+  assert (ap_pool);
+
+  (void) tiz_mutex_lock (&(ap_pool->mutex));
+  while (busy)
+    {
+      busy = false;
+      for (i = 0; i < ap_pool->nsegments; ++i)
+        {
+          if (ESegmentQueued == ap_pool->p_segments[i].state)
+            {
+              busy = true;
+              break;
+            }
+        }
+      if (busy)
+        {
+          (void) tiz_cond_wait (&(ap_pool->cond), &(ap_pool->mutex));
+        }
+    }
+  for (i = 0; i < ap_pool->nsegments; ++i)
+    {
+      flace_segment_t * p_seg = &(ap_pool->p_segments[i]);
+      p_seg->state = ESegmentFree;
+      p_seg->nframes = 0;
+      p_seg->out_len = 0;
+      p_seg->out_read = 0;
+    }
+  (void) tiz_mutex_unlock (&(ap_pool->mutex));
+
+  ap_pool->head = 0;
+  ap_pool->tail = 0;
+  ap_pool->nsubmitted = 0;
+  ap_pool->next_frame = 0;
+  ap_pool->carry_len = 0;
+  ap_pool->header_read = 0;
+  ap_pool->drained = false;
+}
+
+size_t
+flace_pool_write (flace_pool_t * ap_pool, const OMX_U8 * ap_pcm,
+                  size_t a_nbytes)
+{
+  const size_t frame_len = ap_pool->pcm_frame_len;
+  size_t consumed = 0;
+
+  assert (ap_pool);
+  assert (ap_pcm);
+  assert (!ap_pool->drained);
+
+  while (consumed < a_nbytes)
+    {
+      flace_segment_t * p_seg = &(ap_pool->p_segments[ap_pool->tail]);
+      FLAC__int32 * p_dst = NULL;
+      size_t nframes = 0;
+
+      if (ESegmentFree != segment_state (ap_pool, p_seg))
+        {
+          /* All segments are busy */
+          break;
+        }
+
+      p_dst = p_seg->p_pcm + p_seg->nframes * ap_pool->params.channels;
+      if (ap_pool->carry_len > 0 || a_nbytes - consumed < frame_len)
+        {
+          /* A pcm frame straddles two buffers */
+          const size_t n = MIN (frame_len - ap_pool->carry_len,
+                                a_nbytes - consumed);
+          memcpy (ap_pool->carry + ap_pool->carry_len, ap_pcm + consumed, n);
+          ap_pool->carry_len += n;
+          consumed += n;
+          if (ap_pool->carry_len < frame_len)
+            {
+              break;
+            }
+          convert_frames (ap_pool, ap_pool->carry, p_dst, 1);
+          ap_pool->carry_len = 0;
+          nframes = 1;
+        }
+      else
+        {
+          nframes = MIN ((a_nbytes - consumed) / frame_len,
+                         ap_pool->segment_frames - p_seg->nframes);
+          convert_frames (ap_pool, ap_pcm + consumed, p_dst, nframes);
+          consumed += nframes * frame_len;
+        }
+
+      p_seg->nframes += nframes;
+      if (p_seg->nframes == ap_pool->segment_frames)
+        {
+          (void) submit_segment (ap_pool);
+        }
+    }
+
+  return consumed;
+}
+
+OMX_ERRORTYPE
+flace_pool_drain (flace_pool_t * ap_pool)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  flace_segment_t * p_seg = NULL;
+
+  assert (ap_pool);
+
+  if (ap_pool->drained)
+    {
+      return OMX_ErrorNone;
+    }
+
+  p_seg = &(ap_pool->p_segments[ap_pool->tail]);
+  if (ESegmentFree == segment_state (ap_pool, p_seg) && p_seg->nframes > 0)
+    {
+      rc = submit_segment (ap_pool);
+    }
+  ap_pool->drained = true;
+  return rc;
+}
+
+size_t
+flace_pool_read (flace_pool_t * ap_pool, OMX_U8 * ap_dst, size_t a_nbytes)
+{
+  size_t copied = 0;
+
+  assert (ap_pool);
+  assert (ap_dst);
+
+  if (ap_pool->header_read < FLACE_STREAM_HEADER_LEN)
+    {
+      const size_t n
+        = MIN (FLACE_STREAM_HEADER_LEN - ap_pool->header_read, a_nbytes);
+      memcpy (ap_dst, ap_pool->header + ap_pool->header_read, n);
+      ap_pool->header_read += n;
+      copied += n;
+    }
+
+  while (copied < a_nbytes && ap_pool->nsubmitted > 0)
+    {
+      flace_segment_t * p_seg = &(ap_pool->p_segments[ap_pool->head]);
+      size_t n = 0;
+
+      if (ESegmentDone != segment_state (ap_pool, p_seg))
+        {
+          /* Keep the output in order */
+          break;
+        }
+
+      n = MIN (p_seg->out_len - p_seg->out_read, a_nbytes - copied);
+      memcpy (ap_dst + copied, p_seg->p_out + p_seg->out_read, n);
+      p_seg->out_read += n;
+      copied += n;
+
+      if (p_seg->out_read == p_seg->out_len)
+        {
+          (void) tiz_mutex_lock (&(ap_pool->mutex));
+          p_seg->state = ESegmentFree;
+          (void) tiz_mutex_unlock (&(ap_pool->mutex));
+          p_seg->nframes = 0;
+          ap_pool->head = (ap_pool->head + 1) % ap_pool->nsegments;
+          ap_pool->nsubmitted--;
+        }
+    }
+
+  return copied;
+}
+
+bool
+flace_pool_finished (const flace_pool_t * ap_pool)
+{
+  assert (ap_pool);
+  return ap_pool->drained && 0 == ap_pool->nsubmitted
+         && FLACE_STREAM_HEADER_LEN == ap_pool->header_read;
+}
+
+unsigned int
+flace_pool_workers (const flace_pool_t * ap_pool)
+{
+  assert (ap_pool);
+  return ap_pool->nworkers;
+}
@@ -0,0 +1,105 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   flacepool.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - FLAC encoder worker pool
+ *
+ * FLAC frames are independent, so the PCM stream is cut into segments of a
+ * whole number of frames and each segment is encoded by its own libFLAC
+ * encoder instance on a worker thread. The encoded frames are renumbered
+ * and emitted strictly in input order, after a single STREAMINFO header.
+ */
+
+#ifndef FLACEPOOL_H
+#define FLACEPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+typedef struct flace_pool flace_pool_t;
+typedef /*@null@ */ flace_pool_t * flace_pool_ptr_t;
+
+/* Invoked from a worker thread whenever a segment has been encoded */
+typedef void (*flace_pool_notify_f) (void * ap_arg);
+
+typedef struct flace_pool_params flace_pool_params_t;
+struct flace_pool_params
+{
+  unsigned int channels;
+  unsigned int bits_per_sample;
+  unsigned int sample_rate;
+  unsigned int compression_level;
+  unsigned int blocksize;
+  unsigned int frames_per_segment;
+};
+
+OMX_ERRORTYPE
+flace_pool_init (flace_pool_ptr_t * app_pool, unsigned int a_nworkers,
+                 flace_pool_notify_f apf_notify, void * ap_arg);
+
+void
+flace_pool_destroy (flace_pool_t * ap_pool);
+
+/* Configure a new stream. Any data from a previous stream is discarded. */
+OMX_ERRORTYPE
+flace_pool_start (flace_pool_t * ap_pool, const flace_pool_params_t * ap_params);
+
+/* Discard all pending input and output. Blocks until in-flight segments have
+ * been encoded. */
+void
+flace_pool_reset (flace_pool_t * ap_pool);
+
+/* Copy interleaved little-endian PCM into the pool. Returns the number of
+ * bytes consumed, which is less than a_nbytes when all segments are busy. */
+size_t
+flace_pool_write (flace_pool_t * ap_pool, const OMX_U8 * ap_pcm,
+                  size_t a_nbytes);
+
+/* Submit the last, possibly partial, segment of the stream. */
+OMX_ERRORTYPE
+flace_pool_drain (flace_pool_t * ap_pool);
+
+/* Copy encoded data, in stream order, into ap_dst. Returns the number of
+ * bytes copied; zero if the next segment is not ready yet. */
+size_t
+flace_pool_read (flace_pool_t * ap_pool, OMX_U8 * ap_dst, size_t a_nbytes);
+
+/* True once the stream has been drained and all of it has been read. */
+bool
+flace_pool_finished (const flace_pool_t * ap_pool);
+
+/* Number of worker threads */
+unsigned int
+flace_pool_workers (const flace_pool_t * ap_pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLACEPOOL_H */
@@ -0,0 +1,549 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   flaceprc.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - FLAC Encoder processor
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <tizplatform.h>
+
+#include <tizkernel.h>
+#include <tizscheduler.h>
+
+#include "flace.h"
+#include "flaceprc.h"
+#include "flaceprc_decls.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.flac_encoder.prc"
+#endif
+
+static OMX_ERRORTYPE
+flace_proc_buffers_ready (const void * ap_obj);
+
+static unsigned int
+get_num_threads (flace_prc_t * ap_prc)
+{
+  const char * p_threads = tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION,
+    "OMX.Aratelia.audio_encoder.flac.encoder_threads");
+  long nthreads = p_threads ? strtol (p_threads, NULL, 10) : 0;
+
+  if (nthreads <= 0)
+    {
+      /* Not configured; use one thread per online CPU */
+      nthreads = sysconf (_SC_NPROCESSORS_ONLN);
+    }
+
+  nthreads = MAX (1, MIN (nthreads, ARATELIA_FLAC_ENCODER_MAX_THREADS));
+  TIZ_TRACE (handleOf (ap_prc), "Using [%ld] encoder threads", nthreads);
+  return (unsigned int) nthreads;
+}
+
+static void
+segment_encoded_handler (OMX_PTR ap_prc, tiz_event_pluggable_t * ap_event)
+{
+  flace_prc_t * p_prc = ap_prc;
+  assert (p_prc);
+  assert (ap_event);
+
+  if (!p_prc->stopped_)
+    {
+      (void) flace_proc_buffers_ready (p_prc);
+    }
+  tiz_mem_free (ap_event);
+}
+
+/**
+ * Called by the encoder pool when a segment is ready.
+ *
+ * @note This function is called from a worker thread!
+ */
+static void
+segment_encoded (void * ap_arg)
+{
+  flace_prc_t * p_prc = ap_arg;
+  tiz_event_pluggable_t * p_event = NULL;
+  assert (p_prc);
+
+  p_event = tiz_mem_calloc (1, sizeof (tiz_event_pluggable_t));
+  if (p_event)
+    {
+      p_event->p_servant = p_prc;
+      p_event->p_data = NULL;
+      p_event->pf_hdlr = segment_encoded_handler;
+      tiz_comp_event_pluggable (handleOf (p_prc), p_event);
+    }
+}
+
+static OMX_ERRORTYPE
+release_buffers (flace_prc_t * ap_prc)
+{
+  assert (ap_prc);
+
+  if (ap_prc->p_inhdr_)
+    {
+      tiz_check_omx (tiz_krn_release_buffer (
+        tiz_get_krn (handleOf (ap_prc)), ARATELIA_FLAC_ENCODER_INPUT_PORT_INDEX,
+        ap_prc->p_inhdr_));
+      ap_prc->p_inhdr_ = NULL;
+    }
+
+  if (ap_prc->p_outhdr_)
+    {
+      tiz_check_omx (tiz_krn_release_buffer (
+        tiz_get_krn (handleOf (ap_prc)),
+        ARATELIA_FLAC_ENCODER_OUTPUT_PORT_INDEX, ap_prc->p_outhdr_));
+      ap_prc->p_outhdr_ = NULL;
+    }
+
+  return OMX_ErrorNone;
+}
+
+static bool
+claim_input (flace_prc_t * ap_prc)
+{
+  bool rc = false;
+  assert (ap_prc);
+
+  if (OMX_ErrorNone
+      == tiz_krn_claim_buffer (tiz_get_krn (handleOf (ap_prc)),
+                               ARATELIA_FLAC_ENCODER_INPUT_PORT_INDEX, 0,
+                               &ap_prc->p_inhdr_))
+    {
+      if (ap_prc->p_inhdr_)
+        {
+          TIZ_TRACE (handleOf (ap_prc), "Claimed INPUT HEADER [%p]...",
+                     ap_prc->p_inhdr_);
+          rc = true;
+        }
+    }
+
+  return rc;
+}
+
+static bool
+claim_output (flace_prc_t * ap_prc)
+{
+  bool rc = false;
+  assert (ap_prc);
+
+  if (OMX_ErrorNone
+      == tiz_krn_claim_buffer (tiz_get_krn (handleOf (ap_prc)),
+                               ARATELIA_FLAC_ENCODER_OUTPUT_PORT_INDEX, 0,
+                               &ap_prc->p_outhdr_))
+    {
+      if (ap_prc->p_outhdr_)
+        {
+          TIZ_TRACE (handleOf (ap_prc), "Claimed OUTPUT HEADER [%p]...",
+                     ap_prc->p_outhdr_);
+          ap_prc->p_outhdr_->nFilledLen = 0;
+          ap_prc->p_outhdr_->nOffset = 0;
+          rc = true;
+        }
+    }
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+release_output (flace_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  assert (ap_prc->p_outhdr_);
+  tiz_check_omx (tiz_krn_release_buffer (
+    tiz_get_krn (handleOf (ap_prc)), ARATELIA_FLAC_ENCODER_OUTPUT_PORT_INDEX,
+    ap_prc->p_outhdr_));
+  ap_prc->p_outhdr_ = NULL;
+  return OMX_ErrorNone;
+}
+
+/* Hand PCM data over to the encoder pool. Returns true if any progress was
+ * made. */
+static bool
+feed_encoder (flace_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_in = NULL;
+  size_t consumed = 0;
+
+  assert (ap_prc);
+
+  if (ap_prc->eos_ || (!ap_prc->p_inhdr_ && !claim_input (ap_prc)))
+    {
+      return false;
+    }
+
+  p_in = ap_prc->p_inhdr_;
+  if (p_in->nFilledLen > 0)
+    {
+      consumed = flace_pool_write (ap_prc->p_pool_,
+                                   p_in->pBuffer + p_in->nOffset,
+                                   p_in->nFilledLen);
+      p_in->nOffset += consumed;
+      p_in->nFilledLen -= consumed;
+    }
+
+  if (0 == p_in->nFilledLen)
+    {
+      if (p_in->nFlags & OMX_BUFFERFLAG_EOS)
+        {
+          TIZ_TRACE (handleOf (ap_prc), "EOS received on INPUT HEADER [%p]",
+                     p_in);
+          ap_prc->eos_ = true;
+          (void) flace_pool_drain (ap_prc->p_pool_);
+        }
+      p_in->nOffset = 0;
+      (void) tiz_krn_release_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                     ARATELIA_FLAC_ENCODER_INPUT_PORT_INDEX,
+                                     p_in);
+      ap_prc->p_inhdr_ = NULL;
+      return true;
+    }
+
+  return consumed > 0;
+}
+
+/* Collect encoded data, in stream order. Returns true if any progress was
+ * made. */
+static bool
+collect_output (flace_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_out = NULL;
+  size_t produced = 0;
+
+  assert (ap_prc);
+
+  if (!ap_prc->p_outhdr_ && !claim_output (ap_prc))
+    {
+      return false;
+    }
+
+  p_out = ap_prc->p_outhdr_;
+  produced = flace_pool_read (ap_prc->p_pool_,
+                              p_out->pBuffer + p_out->nFilledLen,
+                              p_out->nAllocLen - p_out->nFilledLen);
+  p_out->nFilledLen += produced;
+
+  if (flace_pool_finished (ap_prc->p_pool_))
+    {
+      /* All the input has been encoded and read out; propagate EOS */
+      TIZ_TRACE (handleOf (ap_prc), "Propagating EOS on OUTPUT HEADER [%p]",
+                 p_out);
+      p_out->nFlags |= OMX_BUFFERFLAG_EOS;
+      (void) release_output (ap_prc);
+      ap_prc->eos_ = false;
+      flace_pool_reset (ap_prc->p_pool_);
+      return false;
+    }
+
+  /* Pass the buffer on when it is full, or when nothing else is ready, so
+   * that downstream gets data as soon as a segment completes */
+  if (p_out->nFilledLen == p_out->nAllocLen
+      || (0 == produced && p_out->nFilledLen > 0))
+    {
+      (void) release_output (ap_prc);
+    }
+
+  return produced > 0;
+}
+
+static OMX_ERRORTYPE
+retrieve_settings (flace_prc_t * ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  flace_pool_params_t params;
+
+  assert (ap_prc);
+
+  TIZ_INIT_OMX_PORT_STRUCT (ap_prc->pcmmode_,
+                            ARATELIA_FLAC_ENCODER_INPUT_PORT_INDEX);
+  tiz_check_omx (tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)),
+                                       handleOf (ap_prc),
+                                       OMX_IndexParamAudioPcm,
+                                       &ap_prc->pcmmode_));
+
+  TIZ_INIT_OMX_PORT_STRUCT (ap_prc->flactype_,
+                            ARATELIA_FLAC_ENCODER_OUTPUT_PORT_INDEX);
+  tiz_check_omx (tiz_api_GetParameter (
+    tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+    OMX_TizoniaIndexParamAudioFlac, &ap_prc->flactype_));
+
+  TIZ_TRACE (handleOf (ap_prc),
+             "nChannels = [%d] nBitPerSample = [%d] nSamplingRate = [%d] "
+             "nCompressionLevel = [%d] nBlockSize = [%d]",
+             ap_prc->pcmmode_.nChannels, ap_prc->pcmmode_.nBitPerSample,
+             ap_prc->pcmmode_.nSamplingRate,
+             ap_prc->flactype_.nCompressionLevel,
+             ap_prc->flactype_.nBlockSize);
+
+  if (OMX_NumericalDataSigned != ap_prc->pcmmode_.eNumData
+      || OMX_EndianLittle != ap_prc->pcmmode_.eEndian
+      || OMX_TRUE != ap_prc->pcmmode_.bInterleaved)
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorUnsupportedSetting] : Only signed, little-endian, "
+                 "interleaved PCM is supported");
+      return OMX_ErrorUnsupportedSetting;
+    }
+
+  /* The pcm port is authoritative for the stream format */
+  params.channels = ap_prc->pcmmode_.nChannels;
+  params.bits_per_sample = ap_prc->pcmmode_.nBitPerSample;
+  params.sample_rate = ap_prc->pcmmode_.nSamplingRate;
+  params.compression_level = ap_prc->flactype_.nCompressionLevel;
+  params.blocksize = ap_prc->flactype_.nBlockSize;
+  params.frames_per_segment = ARATELIA_FLAC_ENCODER_FRAMES_PER_SEGMENT;
+
+  if (OMX_ErrorNone != (rc = flace_pool_start (ap_prc->p_pool_, &params)))
+    {
+      TIZ_ERROR (handleOf (ap_prc), "[%s] : Unable to configure the encoder",
+                 tiz_err_to_str (rc));
+    }
+
+  return rc;
+}
+
+/*
+ * flaceprc
+ */
+
+static void *
+flace_proc_ctor (void * ap_obj, va_list * app)
+{
+  flace_prc_t * p_prc = super_ctor (typeOf (ap_obj, "flaceprc"), ap_obj, app);
+  assert (p_prc);
+  p_prc->p_pool_ = NULL;
+  p_prc->p_inhdr_ = NULL;
+  p_prc->p_outhdr_ = NULL;
+  p_prc->eos_ = false;
+  p_prc->stopped_ = true;
+  return p_prc;
+}
+
+static void *
+flace_proc_dtor (void * ap_obj)
+{
+  flace_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  flace_pool_destroy (p_prc->p_pool_);
+  p_prc->p_pool_ = NULL;
+  return super_dtor (typeOf (ap_obj, "flaceprc"), ap_obj);
+}
+
+/*
+ * from tiz_srv class
+ */
+
+static OMX_ERRORTYPE
+flace_proc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
+{
+  flace_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  assert (!p_prc->p_pool_);
+
+  if (OMX_ErrorNone
+      != flace_pool_init (&(p_prc->p_pool_), get_num_threads (p_prc),
+                          segment_encoded, p_prc))
+    {
+      TIZ_ERROR (handleOf (p_prc),
+                 "[OMX_ErrorInsufficientResources] : "
+                 "Unable to create the encoder threads");
+      return OMX_ErrorInsufficientResources;
+    }
+
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+flace_proc_deallocate_resources (void * ap_obj)
+{
+  flace_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  flace_pool_destroy (p_prc->p_pool_);
+  p_prc->p_pool_ = NULL;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+flace_proc_prepare_to_transfer (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  flace_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  p_prc->eos_ = false;
+  return retrieve_settings (p_prc);
+}
+
+static OMX_ERRORTYPE
+flace_proc_transfer_and_process (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  flace_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  p_prc->stopped_ = false;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+flace_proc_stop_and_return (void * ap_obj)
+{
+  flace_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  p_prc->stopped_ = true;
+  if (p_prc->p_pool_)
+    {
+      flace_pool_reset (p_prc->p_pool_);
+    }
+  return release_buffers (p_prc);
+}
+
+/*
+ * from tiz_prc class
+ */
+
+static OMX_ERRORTYPE
+flace_proc_buffers_ready (const void * ap_obj)
+{
+  flace_prc_t * p_prc = (flace_prc_t *) ap_obj;
+  bool progress = true;
+
+  assert (p_prc);
+
+  while (progress && !p_prc->stopped_)
+    {
+      /* Both calls are made on every iteration: input keeps the workers
+       * busy while output drains the segments they have finished */
+      progress = feed_encoder (p_prc);
+      progress |= collect_output (p_prc);
+    }
+
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+flace_proc_port_flush (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  flace_prc_t * p_prc = (flace_prc_t *) ap_obj;
+  assert (p_prc);
+  /* Whatever is in flight belongs to the stream being flushed */
+  p_prc->eos_ = false;
+  if (p_prc->p_pool_)
+    {
+      flace_pool_reset (p_prc->p_pool_);
+    }
+  /* Release all buffers, regardless of the port this is received on */
+  return release_buffers (p_prc);
+}
+
+static OMX_ERRORTYPE
+flace_proc_port_disable (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  /* Release all buffers, regardless of the port this is received on */
+  return release_buffers ((flace_prc_t *) ap_obj);
+}
+
+static OMX_ERRORTYPE
+flace_proc_port_enable (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  return OMX_ErrorNone;
+}
+
+/*
+ * flace_prc_class
+ */
+
+static void *
+flace_prc_class_ctor (void * ap_obj, va_list * app)
+{
+  /* NOTE: Class methods might be added in the future. None for now. */
+  return super_ctor (typeOf (ap_obj, "flaceprc_class"), ap_obj, app);
+}
+
+/*
+ * initialization
+ */
+
+void *
+flace_prc_class_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizprc = tiz_get_type (ap_hdl, "tizprc");
+  void * flaceprc_class = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (classOf (tizprc), "flaceprc_class", classOf (tizprc),
+     sizeof (flace_prc_class_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, flace_prc_class_ctor,
+     /* TIZ_CLASS_COMMENT: stop value */
+     0);
+  return flaceprc_class;
+}
+
+void *
+flace_prc_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizprc = tiz_get_type (ap_hdl, "tizprc");
+  void * flaceprc_class = tiz_get_type (ap_hdl, "flaceprc_class");
+  TIZ_LOG_CLASS (flaceprc_class);
+  void * flaceprc = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (flaceprc_class, "flaceprc", tizprc, sizeof (flace_prc_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, flace_proc_ctor,
+     /* TIZ_CLASS_COMMENT: class destructor */
+     dtor, flace_proc_dtor,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_allocate_resources, flace_proc_allocate_resources,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_deallocate_resources, flace_proc_deallocate_resources,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_prepare_to_transfer, flace_proc_prepare_to_transfer,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_transfer_and_process, flace_proc_transfer_and_process,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_stop_and_return, flace_proc_stop_and_return,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_buffers_ready, flace_proc_buffers_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_flush, flace_proc_port_flush,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_disable, flace_proc_port_disable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_enable, flace_proc_port_enable,
+     /* TIZ_CLASS_COMMENT: stop value */
+     0);
+
+  return flaceprc;
+}
@@ -0,0 +1,70 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   flaceprc_decls.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - FLAC Encoder processor class decls
+ *
+ *
+ */
+
+#ifndef FLACEPRC_DECLS_H
+#define FLACEPRC_DECLS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+#include <OMX_Core.h>
+#include <OMX_TizoniaExt.h>
+
+#include "flacepool.h"
+#include "tizprc_decls.h"
+
+typedef struct flace_prc flace_prc_t;
+struct flace_prc
+{
+  /* Object */
+  const tiz_prc_t _;
+  OMX_AUDIO_PARAM_PCMMODETYPE pcmmode_;
+  OMX_TIZONIA_AUDIO_PARAM_FLACTYPE flactype_;
+  flace_pool_t * p_pool_;
+  OMX_BUFFERHEADERTYPE * p_inhdr_;
+  OMX_BUFFERHEADERTYPE * p_outhdr_;
+  bool eos_;
+  bool stopped_;
+};
+
+typedef struct flace_prc_class flace_prc_class_t;
+struct flace_prc_class
+{
+  /* Class */
+  const tiz_prc_class_t _;
+  /* NOTE: Class methods might be added in the future */
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLACEPRC_DECLS_H */
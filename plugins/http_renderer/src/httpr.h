@@ -50,14 +50,23 @@ extern "C" {
 
 #define ICE_DEFAULT_METADATA_INTERVAL 16000
 #define ICE_INITIAL_BURST_SIZE 128000
-#define ICE_MAX_CLIENTS_PER_MOUNTPOINT 10
+#define ICE_DEFAULT_MAX_CLIENTS 64
+#define ICE_MAX_CLIENTS_PER_MOUNTPOINT 64
 #define ICE_DEFAULT_HEADER_TIMEOUT 10
-#define ICE_LISTEN_QUEUE 5
+#define ICE_LISTEN_QUEUE 128
 #define ICE_MIN_BURST_SIZE 1400
 #define ICE_MEDIUM_BURST_SIZE 2800 /* Not used for now */
-#define ICE_MAX_BURST_SIZE 4200    /* Not used for now */
+#define ICE_MAX_BURST_SIZE 4200
+/* Holds the listener's HTTP request and response */
 #define ICE_LISTENER_BUF_SIZE \
   (ICE_MAX_BURST_SIZE + OMX_TIZONIA_MAX_SHOUTCAST_METADATA_SIZE)
+/* Size of the stream history shared by all the listeners. It grows to twice
+   the initial burst size if that is larger. */
+#define ICE_RING_MIN_SIZE (256 * 1024)
+/* Upper bound of the real-time credit, in bursts */
+#define ICE_MAX_CREDIT_BURSTS 4
+/* Two ring segments plus an ICY metadata block */
+#define ICE_MAX_IOVECS 3
 
 #define ICE_SOCK_ERROR (int) -1
 
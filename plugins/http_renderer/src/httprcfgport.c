@@ -62,7 +62,7 @@ httpr_cfgport_ctor (void * ap_obj, va_list * app)
   p_obj->http_conf_.nVersion.nVersion = OMX_VERSION;
   p_obj->http_conf_.nListeningPort
     = ARATELIA_HTTP_RENDERER_DEFAULT_HTTP_SERVER_PORT;
-  p_obj->http_conf_.nMaxClients = 5;
+  p_obj->http_conf_.nMaxClients = ICE_DEFAULT_MAX_CLIENTS;
 
   return p_obj;
 }
@@ -33,6 +33,8 @@
 #include <config.h>
 #endif
 
+#define _GNU_SOURCE
+
 #include <assert.h>
 #include <stdio.h>
 #include <stdbool.h>
@@ -41,6 +43,7 @@
 #include <netinet/tcp.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netdb.h>
 #include <string.h>
 #include <errno.h>
@@ -70,15 +73,26 @@ typedef struct httpr_connection httpr_connection_t;
 typedef struct httpr_listener httpr_listener_t;
 typedef struct httpr_listener_buffer httpr_listener_buffer_t;
 typedef struct httpr_mount httpr_mount_t;
+typedef struct httpr_ring httpr_ring_t;
+typedef struct httpr_scan httpr_scan_t;
+typedef struct httpr_icy_block httpr_icy_block_t;
 
 struct httpr_listener_buffer
 {
   unsigned int len;
-  unsigned int metadata_offset;
-  unsigned int metadata_bytes;
   char * p_data;
 };
 
+/* An ICY metadata block, ready to go on the wire (length byte followed by
+ * the zero-padded title). Blocks are immutable and shared by all the
+ * listeners that are due to receive them. */
+struct httpr_icy_block
+{
+  unsigned int refs;
+  unsigned int len;
+  char data[];
+};
+
 struct httpr_mount
 {
   OMX_U8 mount_name[OMX_MAX_STRINGNAME_SIZE];
@@ -92,21 +106,38 @@ struct httpr_mount
   OMX_U32 max_clients;
 };
 
+/* The encoded stream is copied once into this ring, and every listener reads
+ * from it at its own offset. Offsets are absolute stream positions; the byte
+ * at offset 'x' lives at p_data[x % capacity]. */
+struct httpr_ring
+{
+  char * p_data;
+  size_t capacity;
+  uint64_t head; /* Stream offset of the next byte to be written */
+};
+
+/* Results of a pass over the listeners map */
+struct httpr_scan
+{
+  httpr_server_t * p_server;
+  uint64_t min_rd;
+  uint64_t max_burst_end;
+  uint64_t evict_lag; /* 0 means do not evict */
+  int nready;
+  int nevicted;
+};
+
 struct httpr_connection
 {
   httpr_listener_t * p_lstnr;
   time_t con_time;
   uint64_t sent_total;
-  unsigned int sent_last;
-  unsigned int burst_bytes;
-  OMX_S32 initial_burst_bytes;
-  bool metadata_delivered;
   int sockfd;
   char * p_host;
   char * p_ip;
   unsigned short port;
-  tiz_event_io_t * p_ev_io;
-  tiz_event_timer_t * p_ev_timer;
+  tiz_event_io_t * p_ev_rd; /* The request has arrived */
+  tiz_event_io_t * p_ev_io; /* The socket is writable again */
 };
 
 struct httpr_listener
@@ -115,12 +146,18 @@ struct httpr_listener
   httpr_connection_t * p_con;
   int respcode;
   long intro_offset;
-  unsigned long pos;
+  uint64_t rd;        /* Stream offset of the next byte to send */
+  uint64_t burst_end; /* Data up to here is sent without pacing */
+  OMX_U32 metaint_left;
+  httpr_icy_block_t * p_icy;     /* Last title block given to this listener */
+  httpr_icy_block_t * p_icy_out; /* Metadata block being sent */
+  unsigned int icy_pos;
   httpr_listener_buffer_t buf;
   tiz_http_parser_t * p_parser;
   bool need_response;
-  bool timer_started;
   bool want_metadata;
+  bool blocked; /* Waiting for the socket to become writable */
+  bool evict;
 };
 
 struct httpr_server
@@ -129,9 +166,15 @@ struct httpr_server
   int lstn_sockfd;
   char * p_ip;
   tiz_event_io_t * p_srv_ev_io;
-  OMX_U32 max_clients; /* In future, more than one will be allowed;
-                          only one allowed at the moment. */
+  bool accept_paused;
+  tiz_event_timer_t * p_ev_timer;
+  bool timer_started;
+  OMX_U32 max_clients;
   tiz_map_t * p_lstnrs;
+  httpr_ring_t ring;
+  OMX_U32 credit; /* Bytes that may be added to the ring at real-time pace */
+  httpr_icy_block_t * p_icy;       /* Current stream title; may be NULL */
+  httpr_icy_block_t * p_icy_empty; /* Zero-length block */
   OMX_BUFFERHEADERTYPE * p_hdr;
   httpr_srv_release_buffer_f pf_release_buf;
   httpr_srv_acquire_buffer_f pf_acquire_buf;
@@ -151,6 +194,52 @@ struct httpr_server
 static void
 srv_destroy_listener (httpr_listener_t * ap_lstnr);
 
+static httpr_icy_block_t *
+srv_icy_block_create (const char * ap_title)
+{
+  httpr_icy_block_t * p_icy = NULL;
+  size_t title_len = 0;
+  size_t nblocks = 0;
+
+  assert (ap_title);
+
+  /* The length byte counts 16-byte blocks */
+  title_len = strnlen (ap_title, OMX_TIZONIA_MAX_SHOUTCAST_METADATA_SIZE);
+  nblocks = (title_len + 15) / 16;
+  if ((p_icy = (httpr_icy_block_t *) tiz_mem_calloc (
+         1, sizeof (httpr_icy_block_t) + 1 + (nblocks * 16))))
+    {
+      p_icy->refs = 1;
+      p_icy->len = 1 + (nblocks * 16);
+      p_icy->data[0] = (char) nblocks;
+      memcpy (p_icy->data + 1, ap_title, title_len);
+    }
+  return p_icy;
+}
+
+static inline httpr_icy_block_t *
+srv_icy_block_ref (httpr_icy_block_t * ap_icy)
+{
+  if (ap_icy)
+    {
+      ap_icy->refs++;
+    }
+  return ap_icy;
+}
+
+static inline void
+srv_icy_block_unref (httpr_icy_block_t * ap_icy)
+{
+  if (ap_icy)
+    {
+      assert (ap_icy->refs > 0);
+      if (0 == --ap_icy->refs)
+        {
+          tiz_mem_free (ap_icy);
+        }
+    }
+}
+
 static OMX_S32
 listeners_map_compare_func (OMX_PTR ap_key1, OMX_PTR ap_key2)
 {
@@ -196,15 +285,6 @@ srv_is_recoverable_error (httpr_server_t * ap_server, int sockfd, int error)
   return rc;
 }
 
-static inline bool
-srv_is_valid_socket (int a_sockfd)
-{
-  int optval;
-  socklen_t optlen = sizeof (int);
-  return (
-    0 == getsockopt (a_sockfd, SOL_SOCKET, SO_TYPE, (void *) &optval, &optlen));
-}
-
 static inline int
 srv_get_listeners_count (const httpr_server_t * ap_server)
 {
@@ -216,17 +296,6 @@ srv_get_listeners_count (const httpr_server_t * ap_server)
   return rc;
 }
 
-static httpr_listener_t *
-srv_get_first_listener (const httpr_server_t * ap_server)
-{
-  httpr_listener_t * p_lstnr = NULL;
-  if (srv_get_listeners_count (ap_server) > 0)
-    {
-      p_lstnr = tiz_map_value_at (ap_server->p_lstnrs, 0);
-    }
-  return p_lstnr;
-}
-
 static int
 srv_set_non_blocking (const int sockfd)
 {
@@ -301,12 +370,18 @@ srv_accept_socket (httpr_server_t * ap_server, char * ap_ip,
   assert (ap_port);
   p_hdl = handleOf (ap_server->p_parent);
 
-  some_error = (!srv_is_valid_socket (ap_server->lstn_sockfd));
-  bail_on_accept_error (some_error, "Invalid server socket");
-
+  /* The accepted socket comes out non-blocking, which saves the two fcntl
+   * calls per client */
   errno = 0;
   accepted_sockfd
-    = accept (ap_server->lstn_sockfd, (struct sockaddr *) &sa, &slen);
+    = accept4 (ap_server->lstn_sockfd, (struct sockaddr *) &sa, &slen,
+               SOCK_NONBLOCK | SOCK_CLOEXEC);
+  if (ICE_SOCK_ERROR == accepted_sockfd
+      && (EAGAIN == errno || EWOULDBLOCK == errno))
+    {
+      /* The backlog has been drained; errno is left for the caller */
+      return ICE_SOCK_ERROR;
+    }
   some_error = (ICE_SOCK_ERROR == accepted_sockfd);
   bail_on_accept_error (some_error, strerror (errno));
 
@@ -336,7 +411,7 @@ srv_accept_socket (httpr_server_t * ap_server, char * ap_ip,
   TIZ_TRACE (p_hdl, "Accepted [%s:%u] fd [%d]", ap_ip, *ap_port,
              accepted_sockfd);
 end:
-  if (some_error)
+  if (some_error && ICE_SOCK_ERROR != accepted_sockfd)
     {
       close (accepted_sockfd);
       accepted_sockfd = ICE_SOCK_ERROR;
@@ -422,7 +497,7 @@ srv_allocate_server_io_watcher (httpr_server_t * ap_server)
   rc = tiz_srv_io_watcher_init (
     ap_server->p_parent, &(ap_server->p_srv_ev_io), ap_server->lstn_sockfd,
     TIZ_EVENT_READ, /* Interested in read events only */
-    true            /* Only one event at a time */
+    false           /* Stays armed; the backlog is drained on every event */
     );
   if (OMX_ErrorNone != rc)
     {
@@ -454,54 +529,65 @@ srv_stop_server_io_watcher (httpr_server_t * ap_server)
   return tiz_srv_io_watcher_stop (ap_server->p_parent, ap_server->p_srv_ev_io);
 }
 
+static OMX_ERRORTYPE
+srv_start_listener_rd_watcher (httpr_listener_t * ap_lstnr)
+{
+  assert (ap_lstnr);
+  assert (ap_lstnr->p_server);
+  assert (ap_lstnr->p_con);
+  return tiz_srv_io_watcher_start (ap_lstnr->p_server->p_parent,
+                                   ap_lstnr->p_con->p_ev_rd);
+}
+
 static OMX_ERRORTYPE
 srv_start_listener_io_watcher (httpr_listener_t * ap_lstnr)
 {
   assert (ap_lstnr);
   assert (ap_lstnr->p_server);
   assert (ap_lstnr->p_con);
+  /* Both watchers are one-shot, so they only need arming, and only when the
+   * socket would block; the event loop disarms them when they fire */
+  ap_lstnr->blocked = true;
   return tiz_srv_io_watcher_start (ap_lstnr->p_server->p_parent,
                                    ap_lstnr->p_con->p_ev_io);
 }
 
 static void
-srv_stop_listener_io_watcher (httpr_listener_t * ap_lstnr)
+srv_stop_listener_io_watchers (httpr_listener_t * ap_lstnr)
 {
   assert (ap_lstnr);
   assert (ap_lstnr->p_con);
+  (void) tiz_srv_io_watcher_stop (ap_lstnr->p_server->p_parent,
+                                  ap_lstnr->p_con->p_ev_rd);
   (void) tiz_srv_io_watcher_stop (ap_lstnr->p_server->p_parent,
                                   ap_lstnr->p_con->p_ev_io);
+  ap_lstnr->blocked = false;
 }
 
 static OMX_ERRORTYPE
-srv_start_listener_timer_watcher (httpr_listener_t * ap_lstnr,
-                                  const double a_wait_time)
+srv_start_timer_watcher (httpr_server_t * ap_server)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
-  assert (ap_lstnr);
-  if (!ap_lstnr->timer_started)
+  assert (ap_server);
+  if (!ap_server->timer_started)
     {
-      assert (ap_lstnr->p_server);
-      assert (ap_lstnr->p_con);
       tiz_check_omx (tiz_srv_timer_watcher_start (
-        ap_lstnr->p_server->p_parent, ap_lstnr->p_con->p_ev_timer, a_wait_time,
-        a_wait_time));
-      ap_lstnr->timer_started = true;
+        ap_server->p_parent, ap_server->p_ev_timer, ap_server->wait_time,
+        ap_server->wait_time));
+      ap_server->timer_started = true;
     }
   return rc;
 }
 
 static void
-srv_stop_listener_timer_watcher (httpr_listener_t * ap_lstnr)
+srv_stop_timer_watcher (httpr_server_t * ap_server)
 {
-  assert (ap_lstnr);
-  if (ap_lstnr->timer_started)
+  assert (ap_server);
+  if (ap_server->timer_started)
     {
-      assert (ap_lstnr->p_server);
-      assert (ap_lstnr->p_con);
-      (void) tiz_srv_timer_watcher_stop (ap_lstnr->p_server->p_parent,
-                                         ap_lstnr->p_con->p_ev_timer);
-      ap_lstnr->timer_started = false;
+      (void) tiz_srv_timer_watcher_stop (ap_server->p_parent,
+                                         ap_server->p_ev_timer);
+      ap_server->timer_started = false;
     }
 }
 
@@ -517,10 +603,10 @@ srv_destroy_connection (httpr_connection_t * ap_con)
       tiz_mem_free (ap_con->p_ip);
       tiz_mem_free (ap_con->p_host);
       assert (ap_con->p_lstnr && ap_con->p_lstnr->p_server);
+      tiz_srv_io_watcher_destroy (ap_con->p_lstnr->p_server->p_parent,
+                                  ap_con->p_ev_rd);
       tiz_srv_io_watcher_destroy (ap_con->p_lstnr->p_server->p_parent,
                                   ap_con->p_ev_io);
-      tiz_srv_timer_watcher_destroy (ap_con->p_lstnr->p_server->p_parent,
-                                     ap_con->p_ev_timer);
       tiz_mem_free (ap_con);
     }
 }
@@ -530,12 +616,12 @@ srv_destroy_listener (httpr_listener_t * ap_lstnr)
 {
   if (ap_lstnr)
     {
-      srv_stop_listener_timer_watcher (ap_lstnr);
       if (ap_lstnr->p_parser)
         {
           tiz_http_parser_destroy (ap_lstnr->p_parser);
         }
       tiz_mem_free (ap_lstnr->buf.p_data);
+      srv_icy_block_unref (ap_lstnr->p_icy);
       srv_destroy_connection (ap_lstnr->p_con);
       tiz_mem_free (ap_lstnr);
     }
@@ -585,28 +671,30 @@ srv_create_connection (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
   p_con->p_lstnr = ap_lstnr;
   p_con->con_time = 0; /* time (NULL); */
   p_con->sent_total = 0;
-  p_con->sent_last = 0;
-  p_con->burst_bytes = 0;
-  p_con->initial_burst_bytes = ap_server->mountpoint.initial_burst_size;
   p_con->sockfd = connected_sockfd;
   p_con->p_host = NULL;
   p_con->p_ip = ap_ip;
   p_con->port = ap_port;
+  p_con->p_ev_rd = NULL;
   p_con->p_ev_io = NULL;
-  p_con->p_ev_timer = NULL;
 
-  /* We are interested in knowing when a listener socket is available for
-   * writing */
+  /* The request is read when it arrives... */
+  rc = tiz_srv_io_watcher_init (ap_server->p_parent, &(p_con->p_ev_rd),
+                                p_con->sockfd, TIZ_EVENT_READ, true);
+  goto_end_on_omx_error (rc, p_hdl, "Unable to init the client's read event");
+
+  /* ...and after that, we only want to know when a full socket has become
+   * writable again */
   rc = tiz_srv_io_watcher_init (ap_server->p_parent, &(p_con->p_ev_io),
                                 p_con->sockfd, TIZ_EVENT_WRITE, true);
   goto_end_on_omx_error (rc, p_hdl, "Unable to init the client's io event");
 
-  rc = tiz_srv_timer_watcher_init (ap_server->p_parent, &(p_con->p_ev_timer));
-  goto_end_on_omx_error (rc, p_hdl, "Unable to init the client's timer event");
-
 end:
-  if (OMX_ErrorNone != rc)
+  if (OMX_ErrorNone != rc && p_con)
     {
+      /* The socket and the address remain the caller's */
+      p_con->sockfd = ICE_SOCK_ERROR;
+      p_con->p_ip = NULL;
       srv_destroy_connection (p_con);
       p_con = NULL;
     }
@@ -631,27 +719,34 @@ srv_create_listener (httpr_server_t * ap_server, httpr_listener_t ** app_lstnr,
   assert (ap_ip);
   p_hdl = handleOf (ap_server->p_parent);
 
+  /* NOTE: The listener owns the socket and the address from here on, even if
+   * this fails */
+
   p_lstnr = (httpr_listener_t *) tiz_mem_calloc (1, sizeof (httpr_listener_t));
   rc = p_lstnr ? OMX_ErrorNone : OMX_ErrorInsufficientResources;
   goto_end_on_omx_error (rc, p_hdl, "Unable to alloc the listener structure");
 
+  p_lstnr->p_server = ap_server;
   p_con = srv_create_connection (ap_server, p_lstnr, a_connected_sockfd, ap_ip,
                                  ap_port, ap_server->wait_time);
   rc = p_con ? OMX_ErrorNone : OMX_ErrorInsufficientResources;
   goto_end_on_omx_error (rc, p_hdl, "Unable to init the listener's connection");
 
-  p_lstnr->p_server = ap_server;
   p_lstnr->p_con = p_con;
   p_lstnr->respcode = 200;
   p_lstnr->intro_offset = 0;
-  p_lstnr->pos = 0;
+  p_lstnr->rd = 0;
+  p_lstnr->burst_end = 0;
+  p_lstnr->metaint_left = 0;
+  p_lstnr->p_icy = NULL;
+  p_lstnr->p_icy_out = NULL;
+  p_lstnr->icy_pos = 0;
   p_lstnr->buf.len = ICE_LISTENER_BUF_SIZE;
-  p_lstnr->buf.metadata_offset = 0;
-  p_lstnr->buf.metadata_bytes = 0;
   p_lstnr->p_parser = NULL;
   p_lstnr->need_response = true;
-  p_lstnr->timer_started = false;
   p_lstnr->want_metadata = false;
+  p_lstnr->blocked = false;
+  p_lstnr->evict = false;
 
   p_lstnr->buf.p_data = (char *) tiz_mem_alloc (ICE_LISTENER_BUF_SIZE);
   rc = p_lstnr->buf.p_data ? OMX_ErrorNone : OMX_ErrorInsufficientResources;
@@ -661,10 +756,6 @@ srv_create_listener (httpr_server_t * ap_server, httpr_listener_t ** app_lstnr,
   rc = tiz_http_parser_init (&(p_lstnr->p_parser), ETIZHttpParserTypeRequest);
   goto_end_on_omx_error (rc, p_hdl, "Unable to init the http parser");
 
-  sockrc = srv_set_non_blocking (p_lstnr->p_con->sockfd);
-  rc = sockrc < 0 ? OMX_ErrorInsufficientResources : OMX_ErrorNone;
-  goto_end_on_socket_error (sockrc, p_hdl, strerror (errno));
-
   sockrc = srv_set_nodelay (p_lstnr->p_con->sockfd);
   rc = sockrc < 0 ? OMX_ErrorInsufficientResources : OMX_ErrorNone;
   goto_end_on_socket_error (sockrc, p_hdl, strerror (errno));
@@ -675,6 +766,11 @@ end:
 
   if (OMX_ErrorNone != rc)
     {
+      if (!p_con)
+        {
+          close (a_connected_sockfd);
+          tiz_mem_free (ap_ip);
+        }
       srv_destroy_listener (p_lstnr);
       p_lstnr = NULL;
     }
@@ -896,6 +992,63 @@ srv_send_http_response (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
   return sent_bytes;
 }
 
+static inline OMX_U32
+srv_get_max_clients (const httpr_server_t * ap_server)
+{
+  assert (ap_server);
+  /* The mount point may further restrict the server-wide limit */
+  return (ap_server->mountpoint.max_clients > 0
+            ? MIN (ap_server->max_clients, ap_server->mountpoint.max_clients)
+            : ap_server->max_clients);
+}
+
+static inline uint64_t
+srv_ring_oldest (const httpr_ring_t * ap_ring)
+{
+  assert (ap_ring);
+  return ap_ring->head > ap_ring->capacity ? ap_ring->head - ap_ring->capacity
+                                           : 0;
+}
+
+static void
+srv_ring_write (httpr_ring_t * ap_ring, const OMX_U8 * ap_src, size_t a_len)
+{
+  size_t off = 0;
+  size_t chunk = 0;
+
+  assert (ap_ring);
+  assert (ap_ring->p_data);
+  assert (a_len <= ap_ring->capacity);
+
+  off = ap_ring->head % ap_ring->capacity;
+  chunk = MIN (a_len, ap_ring->capacity - off);
+  memcpy (ap_ring->p_data + off, ap_src, chunk);
+  memcpy (ap_ring->p_data, ap_src + chunk, a_len - chunk);
+  ap_ring->head += a_len;
+}
+
+static void
+srv_position_listener (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
+{
+  httpr_ring_t * p_ring = NULL;
+  uint64_t burst = 0;
+
+  assert (ap_server);
+  assert (ap_lstnr);
+  p_ring = &ap_server->ring;
+
+  /* The initial burst is served from the stream history when there is enough
+   * of it. Otherwise, the server will read ahead of the real-time pace until
+   * 'burst_end' is in the ring. */
+  burst = ap_server->mountpoint.initial_burst_size;
+  ap_lstnr->rd
+    = p_ring->head - MIN (burst, p_ring->head - srv_ring_oldest (p_ring));
+  ap_lstnr->burst_end = ap_lstnr->rd + burst;
+  ap_lstnr->metaint_left = ap_server->mountpoint.metadata_period;
+  ap_lstnr->p_icy_out = NULL;
+  ap_lstnr->icy_pos = 0;
+}
+
 static OMX_ERRORTYPE
 srv_handle_listeners_request (httpr_server_t * ap_server,
                               httpr_listener_t * ap_lstnr)
@@ -927,7 +1080,8 @@ srv_handle_listeners_request (httpr_server_t * ap_server,
   assert (ap_lstnr->p_con);
   assert (ap_lstnr->p_parser);
 
-  some_error = (srv_get_listeners_count (ap_server) > ap_server->max_clients);
+  some_error
+    = (srv_get_listeners_count (ap_server) > srv_get_max_clients (ap_server));
   bail_on_request_error (some_error, 400, "Client limit reached");
 
   /*   some_error */
@@ -980,6 +1134,7 @@ srv_handle_listeners_request (httpr_server_t * ap_server,
 
   some_error = false;
   ap_lstnr->need_response = false;
+  srv_position_listener (ap_server, ap_lstnr);
 
 end:
   if (some_error && OMX_ErrorNone == rc)
@@ -990,37 +1145,17 @@ end:
   return rc;
 }
 
-static OMX_S32
-srv_remove_existing_listener (OMX_PTR ap_key, OMX_PTR ap_value, OMX_PTR ap_arg)
-{
-  httpr_server_t * p_server = ap_arg;
-  httpr_listener_t * p_lstnr = NULL;
-
-  assert (p_server);
-  assert (ap_key);
-  assert (ap_value);
-
-  p_lstnr = (httpr_listener_t *) ap_value;
-
-  srv_remove_listener (p_server, p_lstnr);
-
-  return 0;
-}
-
 inline static void
 srv_release_empty_buffer (httpr_server_t * ap_server,
-                          httpr_listener_t * ap_lstnr,
                           OMX_BUFFERHEADERTYPE ** app_hdr)
 {
   OMX_BUFFERHEADERTYPE * p_hdr = NULL;
 
   assert (ap_server);
-  assert (ap_lstnr);
   assert (app_hdr);
 
   p_hdr = *app_hdr;
 
-  ap_lstnr->pos = 0;
   p_hdr->nFilledLen = 0;
   ap_server->pf_release_buf (p_hdr, ap_server->p_arg);
   *app_hdr = NULL;
@@ -1045,7 +1180,7 @@ srv_is_listener_ready (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
           if (OMX_ErrorNotReady == rc)
             {
               TIZ_ERROR (p_hdl, "no data yet lets wait some time ");
-              (void) srv_start_listener_io_watcher (ap_lstnr);
+              (void) srv_start_listener_rd_watcher (ap_lstnr);
             }
           else
             {
@@ -1061,560 +1196,520 @@ srv_is_listener_ready (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
   return lstnr_ready;
 }
 
-static inline bool
-srv_is_time_to_send_metadata (httpr_server_t * ap_server,
-                              httpr_listener_t * ap_lstnr)
+static httpr_icy_block_t *
+srv_next_icy_block (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
 {
-  if (ap_lstnr->p_con->sent_total == 0)
-    {
-      return false;
-    }
-
-  if (((ap_lstnr->p_con->sent_total + ap_server->burst_size)
-       % ap_server->mountpoint.metadata_period)
-      <= ap_server->burst_size)
-    {
-      return true;
-    }
-
-  return false;
-}
+  assert (ap_server);
+  assert (ap_lstnr);
 
-static inline size_t
-srv_get_metadata_offset (const httpr_server_t * ap_server,
-                         const httpr_listener_t * ap_lstnr)
-{
-  size_t offset = 0;
-  if (ap_lstnr->p_con->sent_total != 0)
+  /* A listener gets the title block once after every title change, and
+   * empty blocks the rest of the time */
+  if (ap_server->p_icy && ap_lstnr->p_icy != ap_server->p_icy)
     {
-      offset = (ap_server->mountpoint.metadata_period
-                * ((ap_lstnr->p_con->sent_total + ap_server->burst_size)
-                   / ap_server->mountpoint.metadata_period))
-               - ap_lstnr->p_con->sent_total;
+      srv_icy_block_unref (ap_lstnr->p_icy);
+      ap_lstnr->p_icy = srv_icy_block_ref (ap_server->p_icy);
+      return ap_lstnr->p_icy;
     }
-
-  return offset;
+  return ap_server->p_icy_empty;
 }
 
-static inline size_t
-srv_get_metadata_length (const httpr_server_t * ap_server,
-                         const httpr_listener_t * ap_lstnr)
+static int
+srv_ring_segments (const httpr_ring_t * ap_ring, const uint64_t a_offset,
+                   const size_t a_len, struct iovec * ap_iov)
 {
-  if (ap_lstnr->p_con->sent_total == 0 || ap_lstnr->p_con->metadata_delivered)
+  size_t off = 0;
+  size_t chunk = 0;
+  int niov = 0;
+
+  assert (ap_ring);
+  assert (ap_iov);
+  assert (a_offset >= srv_ring_oldest (ap_ring));
+  assert (a_offset + a_len <= ap_ring->head);
+
+  /* At most two segments, as the data may wrap around the end of the ring */
+  off = a_offset % ap_ring->capacity;
+  chunk = MIN (a_len, ap_ring->capacity - off);
+  ap_iov[niov].iov_base = ap_ring->p_data + off;
+  ap_iov[niov++].iov_len = chunk;
+  if (a_len > chunk)
     {
-      return 0;
+      ap_iov[niov].iov_base = ap_ring->p_data;
+      ap_iov[niov++].iov_len = a_len - chunk;
     }
-
-  return strnlen ((char *) ap_server->mountpoint.stream_title,
-                  OMX_TIZONIA_MAX_SHOUTCAST_METADATA_SIZE);
+  return niov;
 }
 
-static void
-srv_arrange_metadata (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
-                      OMX_U8 ** app_buffer, size_t * ap_len)
+static size_t
+srv_arrange_iovecs (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
+                    struct iovec * ap_iov, int * ap_niov)
 {
-  size_t len = 0;
-  httpr_listener_buffer_t * p_lstnr_buf = NULL;
+  bool metadata = false;
+  size_t audio = 0;
+  int niov = 0;
 
   assert (ap_server);
   assert (ap_lstnr);
-  assert (app_buffer);
-  assert (ap_len);
+  assert (ap_iov);
+  assert (ap_niov);
 
-  len = *ap_len;
-  p_lstnr_buf = &ap_lstnr->buf;
+  metadata = (ap_lstnr->want_metadata
+              && ap_server->mountpoint.metadata_period > 0);
 
-  if (0 == len || !ap_lstnr->want_metadata
-      || 0 == ap_server->mountpoint.metadata_period
-      || !srv_is_time_to_send_metadata (ap_server, ap_lstnr))
+  if (!metadata || ap_lstnr->metaint_left > 0)
     {
-      /* p_lstnr_buf->metadata_bytes = 0; */
-      return;
+      /* Audio goes straight from the shared ring to the socket */
+      audio = ap_server->ring.head - ap_lstnr->rd;
+      if (metadata)
+        {
+          audio = MIN (audio, ap_lstnr->metaint_left);
+        }
+      if (audio > 0)
+        {
+          niov = srv_ring_segments (&ap_server->ring, ap_lstnr->rd, audio,
+                                    ap_iov);
+        }
+    }
+
+  if (metadata && audio == ap_lstnr->metaint_left)
+    {
+      /* A metadata block is due after this audio; it goes out in the same
+       * call */
+      if (!ap_lstnr->p_icy_out)
+        {
+          ap_lstnr->p_icy_out = srv_next_icy_block (ap_server, ap_lstnr);
+          ap_lstnr->icy_pos = 0;
+        }
+      ap_iov[niov].iov_base = ap_lstnr->p_icy_out->data + ap_lstnr->icy_pos;
+      ap_iov[niov++].iov_len = ap_lstnr->p_icy_out->len - ap_lstnr->icy_pos;
     }
 
-  {
-    OMX_U8 * p_buffer = *app_buffer;
-    size_t metadata_offset = srv_get_metadata_offset (ap_server, ap_lstnr);
-
-    if (metadata_offset < len && 0 == p_lstnr_buf->metadata_bytes)
-      {
-        OMX_U8 * p_dest = NULL;
-        OMX_U8 * p_src = NULL;
-        size_t metadata_len = srv_get_metadata_length (ap_server, ap_lstnr);
-        size_t metadata_total = 0;
-        size_t metadata_byte = 0;
-
-        if (metadata_len > 0)
-          {
-            metadata_byte = metadata_len / 16;
-            if (metadata_len % 16)
-              {
-                metadata_byte++;
-              }
-          }
-        else
-          {
-            metadata_byte = 0;
-          }
-
-        metadata_total = (metadata_byte * 16) + 1;
-        p_dest = p_buffer + metadata_offset + metadata_total;
-        p_src = p_buffer + metadata_offset;
-
-        /* Move content to make space for the metadata */
-        memmove (p_dest, p_src, len - metadata_offset);
-
-        p_lstnr_buf->metadata_bytes += metadata_total;
-        p_lstnr_buf->metadata_offset += metadata_offset;
-
-        if (metadata_len)
-          {
-            snprintf ((char *) p_src, metadata_total, "%c%s",
-                      (int) metadata_byte,
-                      (char *) ap_server->mountpoint.stream_title);
-            ap_lstnr->p_con->metadata_delivered = true;
-          }
-        else
-          {
-            p_src[0] = metadata_byte;
-          }
-
-        len += metadata_total;
-        p_lstnr_buf->len = len;
-
-        *ap_len = len;
-        *app_buffer = p_buffer;
-      }
-  }
+  *ap_niov = niov;
+  return audio;
 }
 
 static void
-srv_arrange_data (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
-                  OMX_U8 ** app_buffer, size_t * ap_len)
+srv_consume_bytes (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
+                   const size_t a_audio, const size_t a_bytes)
 {
-  OMX_U8 * p_buffer = NULL;
-  size_t len = 0;
-  httpr_listener_buffer_t * p_lstnr_buf = NULL;
-  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  size_t audio = 0;
 
   assert (ap_server);
   assert (ap_lstnr);
-  assert (app_buffer);
-  assert (ap_len);
 
-  p_lstnr_buf = &ap_lstnr->buf;
-  p_hdr = ap_server->p_hdr;
+  audio = MIN (a_audio, a_bytes);
+  ap_lstnr->rd += audio;
 
-  if (p_hdr && p_hdr->pBuffer && p_hdr->nFilledLen > 0)
+  if (ap_lstnr->want_metadata && ap_server->mountpoint.metadata_period > 0)
     {
-      int to_copy = 0;
-      if (ap_server->burst_size > p_lstnr_buf->len)
-        {
-          to_copy = ap_server->burst_size - p_lstnr_buf->len;
-        }
-      if (to_copy > p_hdr->nFilledLen)
+      ap_lstnr->metaint_left -= audio;
+      if (a_bytes > audio)
         {
-          to_copy = p_hdr->nFilledLen;
+          assert (ap_lstnr->p_icy_out);
+          ap_lstnr->icy_pos += (a_bytes - audio);
+          assert (ap_lstnr->icy_pos <= ap_lstnr->p_icy_out->len);
+          if (ap_lstnr->icy_pos == ap_lstnr->p_icy_out->len)
+            {
+              /* Metadata block delivered */
+              ap_lstnr->p_icy_out = NULL;
+              ap_lstnr->icy_pos = 0;
+              ap_lstnr->metaint_left = ap_server->mountpoint.metadata_period;
+            }
         }
-      memcpy (p_lstnr_buf->p_data + p_lstnr_buf->len,
-              p_hdr->pBuffer + p_hdr->nOffset, to_copy);
-      p_lstnr_buf->len += to_copy;
-      p_hdr->nFilledLen -= to_copy;
-      p_hdr->nOffset += to_copy;
     }
-
-  p_buffer = (OMX_U8 *) p_lstnr_buf->p_data;
-  len = p_lstnr_buf->len;
-
-  srv_arrange_metadata (ap_server, ap_lstnr, &p_buffer, &len);
-
-  *ap_len = len;
-  *app_buffer = p_buffer;
 }
 
 static OMX_ERRORTYPE
-srv_write_to_listener (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
-                       const void * ap_buffer, const size_t a_buf_len,
-                       int * a_bytes_written)
+srv_flush_listener (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
-  int bytes = 0;
   httpr_connection_t * p_con = NULL;
-  int sock = ICE_SOCK_ERROR;
+  struct iovec iov[ICE_MAX_IOVECS];
+  struct msghdr msg;
+  ssize_t bytes = 0;
 
   assert (ap_server);
   assert (ap_lstnr);
-  assert (ap_buffer);
-  assert (a_bytes_written);
+  assert (ap_lstnr->p_con);
 
   p_con = ap_lstnr->p_con;
-  sock = p_con->sockfd;
-  *a_bytes_written = 0;
-  errno = 0;
-
-  bytes = send (sock, (const void *) ap_buffer, a_buf_len, MSG_NOSIGNAL);
+  tiz_mem_set (&msg, 0, sizeof (msg));
+  msg.msg_iov = iov;
 
-  if (bytes < 0)
+  while (true)
     {
-      if (!srv_is_recoverable_error (ap_server, sock, errno))
+      size_t total = 0;
+      size_t audio = 0;
+      int niov = 0;
+      int i = 0;
+
+      audio = srv_arrange_iovecs (ap_server, ap_lstnr, iov, &niov);
+      if (0 == niov)
         {
-          TIZ_PRINTF_DBG_RED (
-            "Non-recoverable error while writing to the socket (will destroy "
-            "listener)\n");
-          /* Mark the listener as failed, so that it will get removed */
-          rc = OMX_ErrorNoMore;
+          /* This listener is up to date */
+          break;
         }
-      else
+
+      for (i = 0; i < niov; ++i)
         {
-          TIZ_PRINTF_DBG_RED (
-            "Recoverable error while writing to the socket"
-            "(re-starting io watcher)\n");
+          total += iov[i].iov_len;
+        }
+
+      msg.msg_iovlen = niov;
+      errno = 0;
+      bytes = sendmsg (p_con->sockfd, &msg, MSG_NOSIGNAL);
+
+      if (bytes < 0)
+        {
+          if (!srv_is_recoverable_error (ap_server, p_con->sockfd, errno))
+            {
+              return OMX_ErrorNoMore;
+            }
+          bytes = 0;
+        }
+
+      if (p_con->con_time == 0)
+        {
+          p_con->con_time = time (NULL);
+        }
+      p_con->sent_total += bytes;
+      srv_consume_bytes (ap_server, ap_lstnr, audio, bytes);
+
+      if ((size_t) bytes < total)
+        {
+          /* The socket's send buffer is full; this listener will resume
+           * from where it left off when the socket becomes writable
+           * again */
           (void) srv_start_listener_io_watcher (ap_lstnr);
-          srv_stop_listener_timer_watcher (ap_lstnr);
-          rc = OMX_ErrorNotReady;
+          return OMX_ErrorNotReady;
         }
     }
-  else
-    {
-      *a_bytes_written = bytes;
-    }
-  return rc;
+
+  return OMX_ErrorNone;
 }
 
-static OMX_ERRORTYPE
-srv_write_omx_buffer (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
+static OMX_S32
+srv_scan_listener (OMX_PTR ap_key, OMX_PTR ap_value, OMX_PTR ap_arg)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
-  httpr_connection_t * p_con = NULL;
-  int sock = ICE_SOCK_ERROR;
+  httpr_scan_t * p_scan = ap_arg;
+  httpr_listener_t * p_lstnr = ap_value;
+  uint64_t lag = 0;
 
-  assert (ap_server);
-  assert (ap_lstnr);
-  assert (ap_lstnr->p_con);
-
-  p_con = ap_lstnr->p_con;
-  sock = p_con->sockfd;
-
-  p_con->sent_last = 0;
+  assert (p_scan);
+  assert (p_lstnr);
 
-  if (!srv_is_valid_socket (sock))
+  if (p_lstnr->need_response || p_lstnr->evict)
     {
-      TIZ_WARN (handleOf (ap_server->p_parent),
-                "Will destroy listener "
-                "(Invalid listener socket fd [%d])",
-                sock);
-      /* The socket is not valid anymore. The listener will be removed. */
-      rc = OMX_ErrorNoMore;
+      return 0;
     }
-  else
+
+  lag = p_scan->p_server->ring.head - p_lstnr->rd;
+  if (p_scan->evict_lag > 0 && lag >= p_scan->evict_lag)
     {
-      httpr_listener_buffer_t * p_lstnr_buf = &ap_lstnr->buf;
-      OMX_U8 * p_buffer = NULL;
-      size_t len = 0;
-      int bytes = 0;
+      TIZ_NOTICE (handleOf (p_scan->p_server->p_parent),
+                  "Evicting slow client [%s:%u] (%llu bytes behind)",
+                  p_lstnr->p_con->p_ip, p_lstnr->p_con->port,
+                  (unsigned long long) lag);
+      p_lstnr->evict = true;
+      p_scan->nevicted++;
+      return 0;
+    }
 
-      /* Obtain a pointer to the data and the amount of data to be written */
-      srv_arrange_data (ap_server, ap_lstnr, &p_buffer, &len);
+  p_scan->nready++;
+  p_scan->min_rd = MIN (p_scan->min_rd, p_lstnr->rd);
+  p_scan->max_burst_end = MAX (p_scan->max_burst_end, p_lstnr->burst_end);
+  return 0;
+}
 
-      if (len > 0)
+static OMX_S32
+srv_flush_listener_cback (OMX_PTR ap_key, OMX_PTR ap_value, OMX_PTR ap_arg)
+{
+  httpr_scan_t * p_scan = ap_arg;
+  httpr_listener_t * p_lstnr = ap_value;
+
+  assert (p_scan);
+  assert (p_lstnr);
+
+  /* Listeners whose sockets are full are left alone until the event loop
+   * reports them writable again */
+  if (!p_lstnr->need_response && !p_lstnr->evict && !p_lstnr->blocked
+      && OMX_ErrorNoMore == srv_flush_listener (p_scan->p_server, p_lstnr))
+    {
+      /* Removal is deferred; the map can't be modified while iterating */
+      p_lstnr->evict = true;
+      p_scan->nevicted++;
+    }
+  return 0;
+}
+
+static void
+srv_remove_evicted_listeners (httpr_server_t * ap_server)
+{
+  OMX_S32 i = 0;
+  assert (ap_server);
+  for (i = srv_get_listeners_count (ap_server) - 1; i >= 0; --i)
+    {
+      httpr_listener_t * p_lstnr = tiz_map_value_at (ap_server->p_lstnrs, i);
+      assert (p_lstnr);
+      if (p_lstnr->evict)
         {
-          int metadata_sent = 0;
-          tiz_check_omx (
-            srv_write_to_listener (ap_server, ap_lstnr, p_buffer, len, &bytes));
-          assert (bytes >= 0);
+          srv_remove_listener (ap_server, p_lstnr);
+        }
+    }
+}
 
-          p_lstnr_buf->len
-            = bytes > p_lstnr_buf->len ? 0 : (p_lstnr_buf->len - bytes);
+static void
+srv_scan_listeners (httpr_server_t * ap_server, httpr_scan_t * ap_scan,
+                    const uint64_t a_evict_lag)
+{
+  assert (ap_server);
+  assert (ap_scan);
+  ap_scan->p_server = ap_server;
+  ap_scan->min_rd = ap_server->ring.head;
+  ap_scan->max_burst_end = 0;
+  ap_scan->evict_lag = a_evict_lag;
+  ap_scan->nready = 0;
+  (void) tiz_map_for_each (ap_server->p_lstnrs, srv_scan_listener, ap_scan);
+}
 
-          if (p_lstnr_buf->len > 0)
-            {
-              memmove (p_lstnr_buf->p_data, p_lstnr_buf->p_data + bytes,
-                       p_lstnr_buf->len);
-            }
+static size_t
+srv_fill_ring (httpr_server_t * ap_server, const size_t a_len)
+{
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  size_t filled = 0;
 
-          if (bytes > p_lstnr_buf->metadata_offset)
-            {
-              metadata_sent = MIN ((bytes - p_lstnr_buf->metadata_offset),
-                                   p_lstnr_buf->metadata_bytes);
-            }
+  assert (ap_server);
 
-          if (p_con->initial_burst_bytes > 0)
-            {
-              p_con->initial_burst_bytes -= (bytes - metadata_sent);
-            }
-          else
+  p_hdr = ap_server->p_hdr;
+  while (filled < a_len)
+    {
+      size_t len = 0;
+      if (NULL == p_hdr)
+        {
+          if (NULL == (p_hdr = ap_server->pf_acquire_buf (ap_server->p_arg)))
             {
-              if (p_con->con_time == 0)
-                {
-                  p_con->con_time = time (NULL);
-                }
+              /* no more buffers available at the moment */
+              ap_server->need_more_data = true;
+              break;
             }
+          ap_server->need_more_data = false;
+          ap_server->p_hdr = p_hdr;
+        }
 
-          p_con->sent_total += (bytes - metadata_sent);
-          p_con->sent_last = (bytes - metadata_sent);
-          p_con->burst_bytes += (bytes - metadata_sent);
-
-          {
-            time_t t = time (NULL);
-            double d = difftime (t, p_con->con_time);
-            uint64_t rate = d ? p_con->sent_total / (uint64_t) d : 0;
-            TIZ_PRINTF_DBG_BLU (
-              "total [%lld] last [%d] burst [%d] time [%f] rate [%lld] "
-              "server burst [%d] bytes [%d]\n",
-              p_con->sent_total, p_con->sent_last, p_con->burst_bytes, d, rate,
-              ap_server->burst_size, bytes);
-          }
-
-          TIZ_PRINTF_DBG_GRN (
-            "metadata_bytes [%u] < metadata_offset [%u] metadata_sent [%u]\n",
-            p_lstnr_buf->metadata_bytes, p_lstnr_buf->metadata_offset,
-            metadata_sent);
-
-          p_lstnr_buf->metadata_bytes -= metadata_sent;
-          if (p_lstnr_buf->metadata_offset > 0 && p_lstnr_buf->metadata_bytes)
-            {
-              p_lstnr_buf->metadata_offset -= ((unsigned int) bytes);
-            }
-          else
-            {
-              p_lstnr_buf->metadata_offset = 0;
-            }
+      len = MIN (p_hdr->nFilledLen, a_len - filled);
+      if (len > 0)
+        {
+          srv_ring_write (&ap_server->ring, p_hdr->pBuffer + p_hdr->nOffset,
+                          len);
+          p_hdr->nFilledLen -= len;
+          p_hdr->nOffset += len;
+          filled += len;
+        }
 
-          if (bytes < len)
-            {
-              TIZ_PRINTF_DBG_RED (
-                "NEED TO STOP bytes [%d] < len [%u] p_lstnr_buf->len [%u]\n",
-                bytes, len, p_lstnr_buf->len);
-              (void) srv_start_listener_io_watcher (ap_lstnr);
-              srv_stop_listener_timer_watcher (ap_lstnr);
-              rc = OMX_ErrorNotReady;
-            }
-          else
-            {
-              if ((p_con->initial_burst_bytes <= 0)
-                  && (p_con->burst_bytes >= ap_server->burst_size))
-                {
-                  rc = srv_start_listener_timer_watcher (ap_lstnr,
-                                                         ap_server->wait_time);
-                }
-            }
+      if (0 == p_hdr->nFilledLen)
+        {
+          /* Buffer emptied */
+          srv_release_empty_buffer (ap_server, &p_hdr);
         }
     }
 
-  return rc;
+  return filled;
 }
 
 static OMX_ERRORTYPE
-srv_accept_connection (httpr_server_t * ap_server)
+srv_pump (httpr_server_t * ap_server)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
-  char * p_ip = NULL;
-  httpr_listener_t * p_lstnr = NULL;
-  httpr_connection_t * p_con = NULL;
-  int connected_sockfd = ICE_SOCK_ERROR;
-  bool all_ok = false;
-  OMX_HANDLETYPE p_hdl = NULL;
+  httpr_ring_t * p_ring = NULL;
+  httpr_scan_t scan;
+  uint64_t target = 0;
 
   assert (ap_server);
-  p_hdl = handleOf (ap_server->p_parent);
+  p_ring = &ap_server->ring;
+  tiz_mem_set (&scan, 0, sizeof (scan));
 
-  if (srv_get_listeners_count (ap_server) > 0)
+  srv_scan_listeners (ap_server, &scan, 0);
+  if (scan.nready > 0)
     {
-      /* This is a simple solution to prevent more than one connection at
-       * a time. One day this could be a multi-client renderer */
-      tiz_map_for_each (ap_server->p_lstnrs, srv_remove_existing_listener,
-                        ap_server);
-    }
-
-  if ((p_ip = (char *) tiz_mem_alloc (ICE_RENDERER_MAX_ADDR_LEN)))
-    {
-      unsigned short port = 0;
-      OMX_U32 index = 0;
-
-      connected_sockfd
-        = srv_accept_socket (ap_server, p_ip, ICE_RENDERER_MAX_ADDR_LEN, &port);
-      goto_end_on_socket_error (connected_sockfd, p_hdl,
-                                "Unable to accept the connection");
-
-      rc = srv_create_listener (ap_server, &p_lstnr, connected_sockfd, p_ip,
-                                port);
-      goto_end_on_omx_error (rc, p_hdl, "Unable to instantiate the listener");
+      /* The ring advances at the real-time pace, or faster when a listener
+       * is still owed part of its initial burst */
+      target = MAX (p_ring->head + ap_server->credit, scan.max_burst_end);
+      if (target > p_ring->head)
+        {
+          size_t want = target - p_ring->head;
+          size_t space = p_ring->capacity - (p_ring->head - scan.min_rd);
+          size_t need = MIN (want, ap_server->burst_size);
+          size_t filled = 0;
 
-      assert (p_lstnr);
-      assert (p_lstnr->p_con);
-      p_con = p_lstnr->p_con;
+          if (space < need)
+            {
+              /* The slowest listeners are holding the ring full; evict them
+               * rather than stalling everyone else */
+              srv_scan_listeners (ap_server, &scan, p_ring->capacity - need);
+              space = p_ring->capacity - (p_ring->head - scan.min_rd);
+            }
 
-      rc = tiz_map_insert (ap_server->p_lstnrs, &(p_con->sockfd), p_lstnr,
-                           &index);
-      goto_end_on_omx_error (rc, p_hdl,
-                             "Unable to add the listener to the map");
+          filled = srv_fill_ring (ap_server, MIN (want, space));
+          ap_server->credit -= MIN (ap_server->credit, filled);
+        }
 
-      rc = srv_start_listener_io_watcher (p_lstnr);
-      goto_end_on_omx_error (rc, p_hdl,
-                             "Unable to start the listener's io watcher");
+      (void) tiz_map_for_each (ap_server->p_lstnrs, srv_flush_listener_cback,
+                               &scan);
+    }
 
-      all_ok = true;
+  if (scan.nevicted > 0)
+    {
+      srv_remove_evicted_listeners (ap_server);
     }
 
-end:
+  return OMX_ErrorNone;
+}
 
-  if (!all_ok)
-    {
-      if (ICE_SOCK_ERROR != connected_sockfd)
-        {
-          close (connected_sockfd);
-          connected_sockfd = ICE_SOCK_ERROR;
-        }
+static OMX_ERRORTYPE
+srv_service_listener (httpr_server_t * ap_server, const int a_fd)
+{
+  httpr_listener_t * p_lstnr = NULL;
+  int fd = a_fd;
 
-      if (p_lstnr)
-        {
-          srv_remove_listener (ap_server, p_lstnr);
-          p_lstnr = NULL;
-        }
+  assert (ap_server);
 
-      if (p_ip)
-        {
-          tiz_mem_free (p_ip);
-          p_ip = NULL;
-        }
+  if (!(p_lstnr = tiz_map_find (ap_server->p_lstnrs, &fd)))
+    {
+      /* Stale event from a listener that has already gone */
+      return OMX_ErrorNone;
+    }
 
-      if (OMX_ErrorInsufficientResources != rc)
+  /* The watcher that fired was a one-shot one, so it is already disarmed */
+  if (p_lstnr->need_response)
+    {
+      if (srv_is_listener_ready (ap_server, p_lstnr))
         {
-          /* Use OMX_ErrorNotReady to signal an error other than OOM */
-          rc = OMX_ErrorNotReady;
+          /* A new listener; get its initial burst going */
+          (void) srv_pump (ap_server);
         }
     }
   else
     {
-      TIZ_NOTICE (p_hdl, "Client [%s:%u] fd [%d] now connected", p_con->p_ip,
-                  p_con->port, p_con->sockfd);
-
-      TIZ_PRINTF_DBG_RED ("Client connected [%s:%u]\n", p_con->p_ip,
-                          p_con->port);
-      TIZ_PRINTF_DBG_GRN (
-        "\tburst [%d] sample rate [%u] bitrate [%u] "
-        "burst_size [%u] bytes per frame [%u] wait_time [%f] "
-        "pkts/s [%f].\n",
-        (unsigned int) p_con->initial_burst_bytes,
-        (unsigned int) ap_server->sample_rate,
-        (unsigned int) ap_server->bitrate, (unsigned int) ap_server->burst_size,
-        (unsigned int) ap_server->bytes_per_frame, ap_server->wait_time,
-        ap_server->pkts_per_sec);
+      p_lstnr->blocked = false;
+      if (OMX_ErrorNoMore == srv_flush_listener (ap_server, p_lstnr))
+        {
+          srv_remove_listener (ap_server, p_lstnr);
+        }
     }
 
-  /* Always restart the server's watcher, even if an error occurred */
-  srv_start_server_io_watcher (ap_server);
-
-  return rc;
+  return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
-srv_write (httpr_server_t * ap_server)
+srv_accept_connection (httpr_server_t * ap_server)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
-  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  char * p_ip = NULL;
   httpr_listener_t * p_lstnr = NULL;
   httpr_connection_t * p_con = NULL;
+  int connected_sockfd = ICE_SOCK_ERROR;
+  unsigned short port = 0;
+  OMX_U32 index = 0;
+  OMX_HANDLETYPE p_hdl = NULL;
 
   assert (ap_server);
+  p_hdl = handleOf (ap_server->p_parent);
 
-  if (srv_get_listeners_count (ap_server) <= 0)
+  if (!(p_ip = (char *) tiz_mem_alloc (ICE_RENDERER_MAX_ADDR_LEN)))
     {
-      return OMX_ErrorNoMore;
+      return OMX_ErrorInsufficientResources;
     }
 
-  /* Until support for multiple listeners gets implemented, there will only be
-     one listener in the map */
-  p_lstnr = srv_get_first_listener (ap_server);
-  assert (p_lstnr);
-  p_con = p_lstnr->p_con;
-  assert (p_con);
-
-  srv_stop_listener_io_watcher (p_lstnr);
-  if (!srv_is_listener_ready (ap_server, p_lstnr))
+  connected_sockfd
+    = srv_accept_socket (ap_server, p_ip, ICE_RENDERER_MAX_ADDR_LEN, &port);
+  if (ICE_SOCK_ERROR == connected_sockfd)
     {
-      return OMX_ErrorNotReady;
+      tiz_mem_free (p_ip);
+      /* Use OMX_ErrorNoMore to signal that the backlog is empty, and
+       * OMX_ErrorInsufficientResources for anything that would make the
+       * next accept fail too (e.g. EMFILE) */
+      return (EAGAIN == errno || EWOULDBLOCK == errno)
+               ? OMX_ErrorNoMore
+               : OMX_ErrorInsufficientResources;
     }
 
-  srv_start_listener_timer_watcher (p_lstnr, ap_server->wait_time);
+  /* The listener takes ownership of the socket and the address */
+  rc = srv_create_listener (ap_server, &p_lstnr, connected_sockfd, p_ip, port);
+  goto_end_on_omx_error (rc, p_hdl, "Unable to instantiate the listener");
+
+  assert (p_lstnr);
+  assert (p_lstnr->p_con);
+  p_con = p_lstnr->p_con;
 
-  if (p_con->initial_burst_bytes <= 0)
+  rc = tiz_map_insert (ap_server->p_lstnrs, &(p_con->sockfd), p_lstnr, &index);
+  if (OMX_ErrorNone != rc)
     {
-      p_con->burst_bytes = 0;
+      TIZ_ERROR (p_hdl, "[%s] : Unable to add the listener to the map",
+                 tiz_err_to_str (rc));
+      srv_destroy_listener (p_lstnr);
+      goto end;
     }
 
-  while (1)
+  /* Wait for the client's request */
+  rc = srv_start_listener_rd_watcher (p_lstnr);
+  if (OMX_ErrorNone != rc)
     {
-      if (NULL == p_hdr)
-        {
-          if (NULL == (p_hdr = ap_server->pf_acquire_buf (ap_server->p_arg)))
-            {
-              /* no more buffers available at the moment */
-              ap_server->need_more_data = true;
-              srv_stop_listener_timer_watcher (p_lstnr);
-              rc = OMX_ErrorNone;
-              break;
-            }
-          ap_server->need_more_data = false;
-          ap_server->p_hdr = p_hdr;
-        }
+      TIZ_ERROR (p_hdl, "[%s] : Unable to start the listener's io watcher",
+                 tiz_err_to_str (rc));
+      srv_remove_listener (ap_server, p_lstnr);
+      goto end;
+    }
 
-      rc = srv_write_omx_buffer (ap_server, p_lstnr);
+  TIZ_NOTICE (p_hdl, "Client [%s:%u] fd [%d] now connected", p_con->p_ip,
+              p_con->port, p_con->sockfd);
 
-      if (OMX_ErrorNoMore == rc)
-        {
-          srv_remove_listener (ap_server, p_lstnr);
-          break;
-        }
+  TIZ_PRINTF_DBG_RED ("Client connected [%s:%u]\n", p_con->p_ip, p_con->port);
+  TIZ_PRINTF_DBG_GRN (
+    "\tburst [%d] sample rate [%u] bitrate [%u] "
+    "burst_size [%u] bytes per frame [%u] wait_time [%f] "
+    "pkts/s [%f].\n",
+    (unsigned int) ap_server->mountpoint.initial_burst_size,
+    (unsigned int) ap_server->sample_rate, (unsigned int) ap_server->bitrate,
+    (unsigned int) ap_server->burst_size,
+    (unsigned int) ap_server->bytes_per_frame, ap_server->wait_time,
+    ap_server->pkts_per_sec);
 
-      if (OMX_ErrorNotReady == rc
-          || ((p_con->initial_burst_bytes <= 0)
-              && (p_con->burst_bytes >= ap_server->burst_size)))
-        {
-          rc = OMX_ErrorNotReady;
-          break;
-        }
+end:
 
-      /*       if (p_lstnr->pos == ap_server->p_hdr->nFilledLen) */
-      if (0 == ap_server->p_hdr->nFilledLen)
-        {
-          /* Buffer emptied */
-          (void) srv_release_empty_buffer (ap_server, p_lstnr, &p_hdr);
-        }
-    };
+  if (OMX_ErrorNone != rc && OMX_ErrorInsufficientResources != rc)
+    {
+      /* Use OMX_ErrorNotReady to signal an error other than OOM */
+      rc = OMX_ErrorNotReady;
+    }
 
   return rc;
 }
 
 static OMX_ERRORTYPE
-srv_stream_to_client (httpr_server_t * ap_server)
+srv_accept_connections (httpr_server_t * ap_server)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
+
   assert (ap_server);
 
-  rc = srv_write (ap_server);
-  switch (rc)
+  /* The server watcher stays armed, so drain the whole backlog now instead
+   * of taking one event per pending connection */
+  do
     {
-      case OMX_ErrorNone:
-      case OMX_ErrorNoMore:
-      /* Socket not ready, send buffer is full, or the burst limit has been
-         reached */
-      case OMX_ErrorNotReady:
-        {
-          /* No connected clients just yet */
-          rc = OMX_ErrorNone;
-        }
-        break;
+      rc = srv_accept_connection (ap_server);
+    }
+  while (OMX_ErrorNone == rc || OMX_ErrorNotReady == rc);
 
-      default:
-        {
-          TIZ_ERROR (handleOf (ap_server->p_parent), "[%s]",
-                     tiz_err_to_str (rc));
-          assert (0);
-        }
-        break;
-    };
-  return rc;
+  if (OMX_ErrorInsufficientResources == rc)
+    {
+      /* Out of memory or descriptors. Stop watching the server socket so that
+       * a pending connection does not keep the loop spinning; the timer will
+       * retry later */
+      TIZ_ERROR (handleOf (ap_server->p_parent),
+                 "Unable to accept connections [%s]; pausing the server",
+                 strerror (errno));
+      (void) srv_stop_server_io_watcher (ap_server);
+      ap_server->accept_paused = true;
+    }
+
+  return OMX_ErrorNone;
 }
 
 static int
@@ -1624,6 +1719,21 @@ srv_get_descriptor (const httpr_server_t * ap_server)
   return ap_server->lstn_sockfd;
 }
 
+static OMX_S32
+srv_hasten_listener_cback (OMX_PTR ap_key, OMX_PTR ap_value,
+                                   OMX_PTR ap_arg)
+{
+  httpr_server_t * p_server = ap_arg;
+  httpr_listener_t * p_lstnr = ap_value;
+  assert (p_server);
+  assert (p_lstnr);
+  /* A short burst gets the new title to the listener sooner */
+  p_lstnr->burst_end
+    = MAX (p_lstnr->burst_end,
+           p_server->ring.head + p_server->mountpoint.initial_burst_size / 10);
+  return 0;
+}
+
 /*               */
 /* httpr con APIs */
 /*               */
@@ -1634,6 +1744,8 @@ httpr_srv_destroy (httpr_server_t * ap_server)
   if (ap_server)
     {
       srv_destroy_server_io_watcher (ap_server);
+      tiz_srv_timer_watcher_destroy (ap_server->p_parent,
+                                     ap_server->p_ev_timer);
       if (ICE_SOCK_ERROR != ap_server->lstn_sockfd)
         {
           close (ap_server->lstn_sockfd);
@@ -1645,6 +1757,9 @@ httpr_srv_destroy (httpr_server_t * ap_server)
           tiz_map_clear (ap_server->p_lstnrs);
           tiz_map_destroy (ap_server->p_lstnrs);
         }
+      tiz_mem_free (ap_server->ring.p_data);
+      srv_icy_block_unref (ap_server->p_icy);
+      srv_icy_block_unref (ap_server->p_icy_empty);
       tiz_mem_free (ap_server);
     }
 }
@@ -1673,8 +1788,16 @@ httpr_srv_init (httpr_server_t ** app_server, void * ap_parent,
   p_server->lstn_sockfd = ICE_SOCK_ERROR;
   p_server->p_ip = NULL;
   p_server->p_srv_ev_io = NULL;
+  p_server->p_ev_timer = NULL;
+  p_server->timer_started = false;
   p_server->max_clients = a_max_clients;
   p_server->p_lstnrs = NULL;
+  p_server->ring.p_data = NULL;
+  p_server->ring.capacity = 0;
+  p_server->ring.head = 0;
+  p_server->credit = 0;
+  p_server->p_icy = NULL;
+  p_server->p_icy_empty = NULL;
   p_server->p_hdr = NULL;
   p_server->pf_release_buf = a_pf_release_buf;
   p_server->pf_acquire_buf = a_pf_acquire_buf;
@@ -1704,6 +1827,11 @@ httpr_srv_init (httpr_server_t ** app_server, void * ap_parent,
   goto_end_on_omx_error (rc, handleOf (ap_parent),
                          "Unable to duo the server ip address");
 
+  p_server->p_icy_empty = srv_icy_block_create ("");
+  rc = p_server->p_icy_empty ? OMX_ErrorNone : OMX_ErrorInsufficientResources;
+  goto_end_on_omx_error (rc, handleOf (ap_parent),
+                         "Unable to alloc the empty metadata block");
+
   rc = tiz_map_init (&(p_server->p_lstnrs), listeners_map_compare_func,
                      listeners_map_free_func, NULL);
   goto_end_on_omx_error (rc, handleOf (ap_parent),
@@ -1718,6 +1846,10 @@ httpr_srv_init (httpr_server_t ** app_server, void * ap_parent,
   goto_end_on_omx_error (rc, handleOf (ap_parent),
                          "Unable to alloc the server's io event");
 
+  rc = tiz_srv_timer_watcher_init (p_server->p_parent, &(p_server->p_ev_timer));
+  goto_end_on_omx_error (rc, handleOf (ap_parent),
+                         "Unable to alloc the server's timer event");
+
   /* All good so far */
   all_ok = true;
 
@@ -1740,10 +1872,28 @@ httpr_srv_start (httpr_server_t * ap_server)
   OMX_HANDLETYPE p_hdl = NULL;
   int listen_rc = ICE_SOCK_ERROR;
   bool all_ok = false;
+  size_t capacity = 0;
 
   assert (ap_server);
   p_hdl = handleOf (ap_server->p_parent);
 
+  /* The ring must hold every listener's initial burst, plus room for the
+   * live stream to move on while slow listeners catch up */
+  capacity
+    = MAX (ICE_RING_MIN_SIZE, 2 * ap_server->mountpoint.initial_burst_size);
+  if (capacity != ap_server->ring.capacity)
+    {
+      tiz_mem_free (ap_server->ring.p_data);
+      ap_server->ring.capacity = 0;
+      ap_server->ring.p_data = (char *) tiz_mem_alloc (capacity);
+      rc = ap_server->ring.p_data ? OMX_ErrorNone
+                                  : OMX_ErrorInsufficientResources;
+      goto_end_on_omx_error (rc, p_hdl, "Unable to alloc the stream ring");
+      ap_server->ring.capacity = capacity;
+    }
+  ap_server->ring.head = 0;
+  ap_server->credit = 0;
+
   errno = 0;
   listen_rc = listen (ap_server->lstn_sockfd, ICE_LISTEN_QUEUE);
   goto_end_on_socket_error (listen_rc, p_hdl, strerror (errno));
@@ -1753,9 +1903,14 @@ httpr_srv_start (httpr_server_t * ap_server)
 
   rc = srv_start_server_io_watcher (ap_server);
   goto_end_on_omx_error (rc, p_hdl, "Unable to start the server io watcher");
+  ap_server->accept_paused = false;
+
+  rc = srv_start_timer_watcher (ap_server);
+  goto_end_on_omx_error (rc, p_hdl, "Unable to start the server timer");
 
   /* so far so good */
   ap_server->running = true;
+  ap_server->need_more_data = true;
   all_ok = true;
 
 end:
@@ -1769,20 +1924,15 @@ end:
 OMX_ERRORTYPE
 httpr_srv_stop (httpr_server_t * ap_server)
 {
-  httpr_listener_t * p_lstnr = NULL;
   assert (ap_server);
   (void) srv_stop_server_io_watcher (ap_server);
-  if (ap_server->p_lstnrs)
+  srv_stop_timer_watcher (ap_server);
+  while (srv_get_listeners_count (ap_server) > 0)
     {
-      /* Until support for multiple listeners gets implemented, there will only
-         be one listener in the map */
-      p_lstnr = srv_get_first_listener (ap_server);
-      if (p_lstnr)
-        {
-          srv_stop_listener_io_watcher (p_lstnr);
-          srv_stop_listener_timer_watcher (p_lstnr);
-          srv_remove_listener (ap_server, p_lstnr);
-        }
+      httpr_listener_t * p_lstnr = tiz_map_value_at (ap_server->p_lstnrs, 0);
+      assert (p_lstnr);
+      srv_stop_listener_io_watchers (p_lstnr);
+      srv_remove_listener (ap_server, p_lstnr);
     }
   ap_server->running = false;
   ap_server->need_more_data = false;
@@ -1821,12 +1971,10 @@ httpr_srv_set_mp3_settings (httpr_server_t * ap_server, const OMX_U32 a_bitrate,
 
   ap_server->wait_time = (1 / ap_server->pkts_per_sec);
 
-  if (srv_get_listeners_count (ap_server) > 0)
+  if (ap_server->timer_started)
     {
-      httpr_listener_t * p_lstnr = srv_get_first_listener (ap_server);
-      assert (p_lstnr);
-      srv_stop_listener_timer_watcher (p_lstnr);
-      srv_start_listener_timer_watcher (p_lstnr, ap_server->wait_time);
+      srv_stop_timer_watcher (ap_server);
+      (void) srv_start_timer_watcher (ap_server);
     }
 
   TIZ_PRINTF_DBG_MAG (
@@ -1904,16 +2052,23 @@ httpr_srv_set_stream_title (httpr_server_t * ap_server,
            OMX_TIZONIA_MAX_SHOUTCAST_METADATA_SIZE);
   p_mount->stream_title[OMX_TIZONIA_MAX_SHOUTCAST_METADATA_SIZE - 1] = '\0';
 
-  if (srv_get_listeners_count (ap_server) > 0)
+  /* The ICY block is encoded here once; listeners that are in the middle of
+   * sending the previous one keep it alive until they are done with it */
+  srv_icy_block_unref (ap_server->p_icy);
+  ap_server->p_icy = NULL;
+  if ('\0' != p_mount->stream_title[0]
+      && !(ap_server->p_icy
+           = srv_icy_block_create ((const char *) p_mount->stream_title)))
     {
-      httpr_listener_t * p_lstnr = srv_get_first_listener (ap_server);
-      assert (p_lstnr);
-      assert (p_lstnr->p_con);
-      p_lstnr->p_con->metadata_delivered = false;
-      p_lstnr->p_con->initial_burst_bytes
-        = ap_server->mountpoint.initial_burst_size * 0.1;
-      srv_stop_listener_timer_watcher (p_lstnr);
-      srv_start_listener_timer_watcher (p_lstnr, ap_server->wait_time);
+      TIZ_ERROR (handleOf (ap_server->p_parent),
+                 "[OMX_ErrorInsufficientResources] : "
+                 "Unable to alloc the stream title's metadata block");
+    }
+
+  if (ap_server->p_lstnrs)
+    {
+      (void) tiz_map_for_each (ap_server->p_lstnrs,
+                               srv_hasten_listener_cback, ap_server);
     }
 }
 
@@ -1922,7 +2077,7 @@ httpr_srv_buffer_event (httpr_server_t * ap_server)
 {
   assert (ap_server);
   return ((ap_server->running && ap_server->need_more_data)
-            ? srv_stream_to_client (ap_server)
+            ? srv_pump (ap_server)
             : OMX_ErrorNone);
 }
 
@@ -1935,17 +2090,13 @@ httpr_srv_io_event (httpr_server_t * ap_server, const int a_fd)
     {
       if (a_fd == srv_get_descriptor (ap_server))
         {
-          /* A new connection event. Try to accept it */
-          rc = srv_accept_connection (ap_server);
-          if (OMX_ErrorInsufficientResources != rc)
-            {
-              rc = OMX_ErrorNone;
-            }
+          /* New connections. Accept them all */
+          rc = srv_accept_connections (ap_server);
         }
       else
         {
-          /* The client socket is ready */
-          rc = srv_stream_to_client (ap_server);
+          /* A client socket is ready */
+          rc = srv_service_listener (ap_server, a_fd);
         }
     }
   return rc;
@@ -1955,5 +2106,18 @@ OMX_ERRORTYPE
 httpr_srv_timer_event (httpr_server_t * ap_server)
 {
   assert (ap_server);
-  return ap_server->running ? srv_stream_to_client (ap_server) : OMX_ErrorNone;
+  if (!ap_server->running)
+    {
+      return OMX_ErrorNone;
+    }
+  if (ap_server->accept_paused
+      && OMX_ErrorNone == srv_start_server_io_watcher (ap_server))
+    {
+      ap_server->accept_paused = false;
+    }
+  /* Each tick allows another burst into the ring. Unused credit is capped so
+   * that a stall upstream doesn't turn into a flood later. */
+  ap_server->credit = MIN (ap_server->credit + ap_server->burst_size,
+                           ICE_MAX_CREDIT_BURSTS * ap_server->burst_size);
+  return srv_pump (ap_server);
 }
@@ -43,6 +43,7 @@
 #include <tizscheduler.h>
 
 #include "httpsrc.h"
+#include "httpsrctrans.h"
 #include "dirbleprc.h"
 #include "dirbleprc_decls.h"
 
@@ -703,6 +704,15 @@ dirble_prc_dtor (void * ap_obj)
  * from tizsrv class
  */
 
+/* The shared curl multi handle or the range prefetcher has news */
+static void
+transfer_notification (OMX_PTR ap_arg)
+{
+  dirble_prc_t * p_prc = ap_arg;
+  assert (p_prc);
+  httpsrc_trans_notify (p_prc, &(p_prc->p_trans_), NULL);
+}
+
 static OMX_ERRORTYPE
 dirble_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
 {
@@ -740,6 +750,11 @@ dirble_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
       {
         tiz_urltrans_set_connect_timeout(p_prc->p_trans_, 3L);
       }
+    if (OMX_ErrorNone == rc)
+      {
+        rc = httpsrc_trans_configure (p_prc->p_trans_, transfer_notification,
+                                      false);
+      }
   }
   return rc;
 }
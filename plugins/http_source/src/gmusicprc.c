@@ -34,6 +34,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <string.h>
+#include <stdio.h>
 
 #include <OMX_TizoniaExt.h>
 
@@ -43,6 +44,7 @@
 #include <tizscheduler.h>
 
 #include "httpsrc.h"
+#include "httpsrctrans.h"
 #include "gmusicprc.h"
 #include "gmusicprc_decls.h"
 
@@ -713,6 +715,31 @@ gmusic_prc_dtor (void * ap_obj)
  * from tizsrv class
  */
 
+/* Identify the current track for the track cache, using artist, album, track number and title, as the stream URLs expire */
+static void
+update_cache_key (gmusic_prc_t * ap_prc)
+{
+  char key[PATH_MAX];
+  assert (ap_prc);
+  assert (ap_prc->p_trans_);
+
+  snprintf (key, sizeof (key), "gmusic:%s/%s/%s/%s",
+            tiz_gmusic_get_current_song_artist (ap_prc->p_gmusic_),
+            tiz_gmusic_get_current_song_album (ap_prc->p_gmusic_),
+            tiz_gmusic_get_current_song_track_number (ap_prc->p_gmusic_),
+            tiz_gmusic_get_current_song_title (ap_prc->p_gmusic_));
+  tiz_urltrans_set_cache_key (ap_prc->p_trans_, key);
+}
+
+/* The shared curl multi handle or the range prefetcher has news */
+static void
+transfer_notification (OMX_PTR ap_arg)
+{
+  gmusic_prc_t * p_prc = ap_arg;
+  assert (p_prc);
+  httpsrc_trans_notify (p_prc, &(p_prc->p_trans_), NULL);
+}
+
 static OMX_ERRORTYPE
 gmusic_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
 {
@@ -753,6 +780,15 @@ gmusic_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
                            ARATELIA_HTTP_SOURCE_PORT_MIN_BUF_SIZE,
                            ARATELIA_HTTP_SOURCE_DEFAULT_RECONNECT_TIMEOUT,
                            buffer_cbacks, info_cbacks, io_cbacks, timer_cbacks);
+    if (OMX_ErrorNone == rc)
+      {
+        rc = httpsrc_trans_configure (p_prc->p_trans_, transfer_notification,
+                                      false);
+      }
+    if (OMX_ErrorNone == rc)
+      {
+        update_cache_key (p_prc);
+      }
   }
   return rc;
 }
@@ -936,6 +972,7 @@ gmusic_prc_config_change (void * ap_prc, OMX_U32 TIZ_UNUSED (a_pid),
       /* Changing the URL has the side effect of halting the current
          download */
       tiz_urltrans_set_uri (p_prc->p_trans_, p_prc->p_uri_param_);
+      update_cache_key (p_prc);
       if (p_prc->port_disabled_)
         {
           /* Record that the URI has changed, so that when the port is
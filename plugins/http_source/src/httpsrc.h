@@ -57,6 +57,11 @@ extern "C" {
 #define ARATELIA_HTTP_SOURCE_DEFAULT_RECONNECT_TIMEOUT 3.0F
 #define ARATELIA_HTTP_SOURCE_DEFAULT_BIT_RATE_KBITS 128
 #define ARATELIA_HTTP_SOURCE_DEFAULT_CACHE_SECONDS 20
+#define ARATELIA_HTTP_SOURCE_MIN_CACHE_SECONDS 8
+#define ARATELIA_HTTP_SOURCE_MAX_CACHE_SECONDS 60
+#define ARATELIA_HTTP_SOURCE_CACHE_SHRINK_INTERVAL_SECONDS 30
+#define ARATELIA_HTTP_SOURCE_JITTER_WINDOW_SECONDS 30
+#define ARATELIA_HTTP_SOURCE_YOUTUBE_PREFETCH_URLS 2
 
 #ifdef __cplusplus
 }
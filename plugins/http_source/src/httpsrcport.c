@@ -59,6 +59,7 @@ httpsrc_port_ctor (void * ap_obj, va_list * app)
   tiz_port_register_index (p_obj, OMX_IndexParamAudioMp3);
   tiz_port_register_index (p_obj, OMX_IndexParamAudioAac);
   tiz_port_register_index (p_obj, OMX_TizoniaIndexParamAudioOpus);
+  tiz_port_register_index (p_obj, OMX_TizoniaIndexConfigHttpSourceBuffering);
 
   p_obj->mp3type_.nSize = sizeof (OMX_AUDIO_PARAM_MP3TYPE);
   p_obj->mp3type_.nVersion.nVersion = OMX_VERSION;
@@ -98,6 +99,16 @@ httpsrc_port_ctor (void * ap_obj, va_list * app)
   p_obj->opustype_.eChannelMode = OMX_AUDIO_ChannelModeStereo;
   p_obj->opustype_.eFormat = OMX_AUDIO_OPUSStreamFormatVBR;
 
+  p_obj->buffering_.nSize = sizeof (OMX_TIZONIA_CONFIG_HTTPSOURCEBUFFERINGTYPE);
+  p_obj->buffering_.nVersion.nVersion = OMX_VERSION;
+  p_obj->buffering_.nPortIndex = ARATELIA_HTTP_SOURCE_PORT_INDEX;
+  p_obj->buffering_.nFillBytes = 0;
+  p_obj->buffering_.nFillMs = 0;
+  p_obj->buffering_.nTargetBytes = 0;
+  p_obj->buffering_.nTargetMs = 0;
+  p_obj->buffering_.nJitterMs = 0;
+  p_obj->buffering_.nUnderruns = 0;
+
   return p_obj;
 }
 
@@ -325,6 +336,81 @@ httpsrc_port_SetParameter (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
   return rc;
 }
 
+static OMX_ERRORTYPE
+httpsrc_port_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                        OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  const httpsrc_port_t * p_obj = ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (p_obj);
+
+  if (OMX_TizoniaIndexConfigHttpSourceBuffering == a_index)
+    {
+      OMX_TIZONIA_CONFIG_HTTPSOURCEBUFFERINGTYPE * p_buffering
+        = (OMX_TIZONIA_CONFIG_HTTPSOURCEBUFFERINGTYPE *) ap_struct;
+      *p_buffering = p_obj->buffering_;
+    }
+  else
+    {
+      /* Try the parent's indexes */
+      rc = super_GetConfig (typeOf (ap_obj, "httpsrcport"), ap_obj, ap_hdl,
+                            a_index, ap_struct);
+    }
+  return rc;
+}
+
+static OMX_ERRORTYPE
+httpsrc_port_SetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                        OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (ap_obj);
+
+  if (OMX_TizoniaIndexConfigHttpSourceBuffering == a_index)
+    {
+      /* The buffering status can only be updated by the processor */
+      TIZ_TRACE (ap_hdl, "[OMX_ErrorUnsupportedSetting] : [%s] is read-only",
+                 tiz_idx_to_str (a_index));
+      rc = OMX_ErrorUnsupportedSetting;
+    }
+  else
+    {
+      /* Try the parent's indexes */
+      rc = super_SetConfig (typeOf (ap_obj, "httpsrcport"), ap_obj, ap_hdl,
+                            a_index, ap_struct);
+    }
+  return rc;
+}
+
+static OMX_ERRORTYPE
+httpsrc_port_SetConfig_internal (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                                 OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  httpsrc_port_t * p_obj = (httpsrc_port_t *) ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (p_obj);
+
+  if (OMX_TizoniaIndexConfigHttpSourceBuffering == a_index)
+    {
+      const OMX_TIZONIA_CONFIG_HTTPSOURCEBUFFERINGTYPE * p_buffering
+        = (OMX_TIZONIA_CONFIG_HTTPSOURCEBUFFERINGTYPE *) ap_struct;
+      p_obj->buffering_.nFillBytes = p_buffering->nFillBytes;
+      p_obj->buffering_.nFillMs = p_buffering->nFillMs;
+      p_obj->buffering_.nTargetBytes = p_buffering->nTargetBytes;
+      p_obj->buffering_.nTargetMs = p_buffering->nTargetMs;
+      p_obj->buffering_.nJitterMs = p_buffering->nJitterMs;
+      p_obj->buffering_.nUnderruns = p_buffering->nUnderruns;
+    }
+  else
+    {
+      rc = httpsrc_port_SetConfig (ap_obj, ap_hdl, a_index, ap_struct);
+    }
+  return rc;
+}
+
 static bool
 httpsrc_port_check_tunnel_compat (const void * ap_obj,
                                   OMX_PARAM_PORTDEFINITIONTYPE * ap_this_def,
@@ -621,6 +707,12 @@ httpsrc_port_init (void * ap_tos, void * ap_hdl)
      /* TIZ_CLASS_COMMENT: */
      tiz_api_SetParameter, httpsrc_port_SetParameter,
      /* TIZ_CLASS_COMMENT: */
+     tiz_api_GetConfig, httpsrc_port_GetConfig,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_SetConfig, httpsrc_port_SetConfig,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_port_SetConfig_internal, httpsrc_port_SetConfig_internal,
+     /* TIZ_CLASS_COMMENT: */
      tiz_port_check_tunnel_compat, httpsrc_port_check_tunnel_compat,
      /* TIZ_CLASS_COMMENT: */
      tiz_port_apply_slaving_behaviour, httpsrc_port_apply_slaving_behaviour,
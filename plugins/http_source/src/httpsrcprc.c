@@ -34,6 +34,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <string.h>
+#include <time.h>
 
 #include <OMX_TizoniaExt.h>
 
@@ -43,6 +44,7 @@
 #include <tizscheduler.h>
 
 #include "httpsrc.h"
+#include "httpsrctrans.h"
 #include "httpsrcprc.h"
 #include "httpsrcprc_decls.h"
 
@@ -379,13 +381,37 @@ set_audio_info_on_port (httpsrc_prc_t * ap_prc)
   return rc;
 }
 
+static uint64_t
+now_ms (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int
+ms_to_bytes (const httpsrc_prc_t * ap_prc, const int a_ms)
+{
+  assert (ap_prc);
+  /* kbit/s is the same as bit/ms */
+  return (int) (((int64_t) ap_prc->bitrate_ * a_ms) / 8);
+}
+
+static OMX_U32
+bytes_to_ms (const httpsrc_prc_t * ap_prc, const OMX_U32 a_nbytes)
+{
+  assert (ap_prc);
+  return ap_prc->bitrate_ > 0
+           ? (OMX_U32) (((uint64_t) a_nbytes * 8) / ap_prc->bitrate_)
+           : 0;
+}
+
 static void
 update_cache_size (httpsrc_prc_t * ap_prc)
 {
   assert (ap_prc);
   assert (ap_prc->bitrate_ > 0);
-  ap_prc->cache_bytes_ = ((ap_prc->bitrate_ * 1000) / 8)
-                         * ARATELIA_HTTP_SOURCE_DEFAULT_CACHE_SECONDS;
+  ap_prc->cache_bytes_ = ms_to_bytes (ap_prc, ap_prc->cache_ms_);
   if (ap_prc->p_trans_)
     {
       tiz_urltrans_set_internal_buffer_size (ap_prc->p_trans_,
@@ -393,6 +419,141 @@ update_cache_size (httpsrc_prc_t * ap_prc)
     }
 }
 
+static void
+reset_buffering_stats (httpsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  ap_prc->cache_full_ = false;
+  ap_prc->underruns_ = 0;
+  ap_prc->trans_underruns_
+    = ap_prc->p_trans_ ? tiz_urltrans_underruns (ap_prc->p_trans_) : 0;
+  ap_prc->last_arrival_ms_ = 0;
+  ap_prc->jitter_window_start_ms_ = now_ms ();
+  ap_prc->jitter_window_gap_ms_ = 0;
+  ap_prc->prev_jitter_window_gap_ms_ = 0;
+  ap_prc->last_adjustment_ms_ = ap_prc->jitter_window_start_ms_;
+  ap_prc->last_report_ms_ = 0;
+}
+
+/* The longest gap between two data arrivals seen in the last one or two
+   jitter windows */
+static OMX_U32
+jitter_ms (const httpsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  return MAX (ap_prc->jitter_window_gap_ms_,
+              ap_prc->prev_jitter_window_gap_ms_);
+}
+
+static void
+track_data_arrival (httpsrc_prc_t * ap_prc)
+{
+  const uint64_t now = now_ms ();
+  assert (ap_prc);
+
+  /* While the buffer is full the transfer may be paused on purpose; those
+     gaps say nothing about the network */
+  if (ap_prc->last_arrival_ms_ > 0 && !ap_prc->cache_full_)
+    {
+      const OMX_U32 gap = (OMX_U32) (now - ap_prc->last_arrival_ms_);
+      ap_prc->jitter_window_gap_ms_ = MAX (ap_prc->jitter_window_gap_ms_, gap);
+    }
+  ap_prc->last_arrival_ms_ = now;
+
+  if (now - ap_prc->jitter_window_start_ms_
+      >= ARATELIA_HTTP_SOURCE_JITTER_WINDOW_SECONDS * 1000)
+    {
+      ap_prc->prev_jitter_window_gap_ms_ = ap_prc->jitter_window_gap_ms_;
+      ap_prc->jitter_window_gap_ms_ = 0;
+      ap_prc->jitter_window_start_ms_ = now;
+    }
+}
+
+static void
+report_buffering_status (httpsrc_prc_t * ap_prc, const OMX_U32 a_fill_bytes)
+{
+  OMX_TIZONIA_CONFIG_HTTPSOURCEBUFFERINGTYPE buffering;
+  assert (ap_prc);
+
+  TIZ_INIT_OMX_PORT_STRUCT (buffering, ARATELIA_HTTP_SOURCE_PORT_INDEX);
+  buffering.nFillBytes = a_fill_bytes;
+  buffering.nFillMs = bytes_to_ms (ap_prc, a_fill_bytes);
+  buffering.nTargetBytes = ap_prc->cache_bytes_;
+  buffering.nTargetMs = ap_prc->cache_ms_;
+  buffering.nJitterMs = jitter_ms (ap_prc);
+  buffering.nUnderruns = ap_prc->underruns_;
+  (void) tiz_krn_SetConfig_internal (
+    tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+    OMX_TizoniaIndexConfigHttpSourceBuffering, &buffering);
+}
+
+/* Grow the buffering target by half after each underrun. While the data
+   keeps coming, shrink it a second at a time, but not below a few times the
+   longest recent gap between arrivals. */
+static void
+adapt_buffering (httpsrc_prc_t * ap_prc)
+{
+  const uint64_t now = now_ms ();
+  OMX_U32 underruns = 0;
+  OMX_U32 fill_bytes = 0;
+  int cache_ms = 0;
+  bool report = false;
+  assert (ap_prc);
+
+  if (!ap_prc->p_trans_ || ap_prc->bitrate_ <= 0)
+    {
+      return;
+    }
+
+  underruns = tiz_urltrans_underruns (ap_prc->p_trans_);
+  fill_bytes = tiz_urltrans_bytes_available (ap_prc->p_trans_);
+  cache_ms = ap_prc->cache_ms_;
+  ap_prc->cache_full_ = (fill_bytes >= (OMX_U32) ap_prc->cache_bytes_);
+
+  if (underruns != ap_prc->trans_underruns_)
+    {
+      ap_prc->underruns_ += underruns - ap_prc->trans_underruns_;
+      ap_prc->trans_underruns_ = underruns;
+      cache_ms = MIN (ARATELIA_HTTP_SOURCE_MAX_CACHE_SECONDS * 1000,
+                      cache_ms + cache_ms / 2);
+      ap_prc->last_adjustment_ms_ = now;
+      report = true;
+    }
+  else if (now - ap_prc->last_adjustment_ms_
+           >= ARATELIA_HTTP_SOURCE_CACHE_SHRINK_INTERVAL_SECONDS * 1000)
+    {
+      const int floor_ms
+        = MAX (ARATELIA_HTTP_SOURCE_MIN_CACHE_SECONDS * 1000,
+               (int) MIN (jitter_ms (ap_prc) * 4,
+                          ARATELIA_HTTP_SOURCE_MAX_CACHE_SECONDS * 1000));
+      if (cache_ms > floor_ms)
+        {
+          cache_ms = MAX (floor_ms, cache_ms - 1000);
+        }
+      ap_prc->last_adjustment_ms_ = now;
+    }
+
+  if (cache_ms != ap_prc->cache_ms_)
+    {
+      TIZ_NOTICE (handleOf (ap_prc),
+                  "buffering target [%d ms -> %d ms] underruns [%u] "
+                  "jitter [%u ms]",
+                  ap_prc->cache_ms_, cache_ms, ap_prc->underruns_,
+                  jitter_ms (ap_prc));
+      ap_prc->cache_ms_ = cache_ms;
+      ap_prc->cache_bytes_ = ms_to_bytes (ap_prc, cache_ms);
+      tiz_urltrans_adjust_internal_buffer_size (ap_prc->p_trans_,
+                                                ap_prc->cache_bytes_);
+      report = true;
+    }
+
+  if (report || now - ap_prc->last_report_ms_ >= 1000)
+    {
+      report_buffering_status (ap_prc, fill_bytes);
+      ap_prc->last_report_ms_ = now;
+    }
+}
+
 static OMX_ERRORTYPE
 store_metadata (httpsrc_prc_t * ap_prc, const char * ap_header_name,
                 const char * ap_header_info)
@@ -673,6 +834,11 @@ data_available (OMX_PTR ap_arg, const void * ap_ptr, const size_t a_nbytes)
   assert (p_prc);
   assert (ap_ptr);
 
+  if (a_nbytes > 0)
+    {
+      track_data_arrival (p_prc);
+    }
+
   if (p_prc->auto_detect_on_ && a_nbytes > 0)
     {
       p_prc->auto_detect_on_ = false;
@@ -695,6 +861,8 @@ data_available (OMX_PTR ap_arg, const void * ap_ptr, const size_t a_nbytes)
          OMX_EventPortSettingsChanged events or a
          OMX_ErrorFormatNotDetected event */
       send_port_auto_detect_events (p_prc);
+      /* The wait for the port to be reconfigured is not network jitter */
+      p_prc->last_arrival_ms_ = 0;
     }
   return pause_needed;
 }
@@ -706,6 +874,7 @@ connection_lost (OMX_PTR ap_arg)
   assert (p_prc);
   prepare_for_port_auto_detection (p_prc);
   p_prc->connection_closed_ = true;
+  p_prc->last_arrival_ms_ = 0;
   /* Return true to indicate that the automatic reconnection procedure needs to
      be started */
   return true;
@@ -753,6 +922,8 @@ httpsrc_prc_ctor (void * ap_obj, va_list * app)
   p_prc->bitrate_ = ARATELIA_HTTP_SOURCE_DEFAULT_BIT_RATE_KBITS;
   p_prc->connection_closed_ = false;
   p_prc->first_buffer_delivered_ = false;
+  p_prc->cache_ms_ = ARATELIA_HTTP_SOURCE_DEFAULT_CACHE_SECONDS * 1000;
+  reset_buffering_stats (p_prc);
   update_cache_size (p_prc);
   return p_prc;
 }
@@ -768,6 +939,22 @@ httpsrc_prc_dtor (void * ap_obj)
  * from tizsrv class
  */
 
+/* Each notification may have changed the buffer fill level */
+static void
+transfer_notified (OMX_PTR ap_prc)
+{
+  adapt_buffering (ap_prc);
+}
+
+/* The shared curl multi handle or the range prefetcher has news */
+static void
+transfer_notification (OMX_PTR ap_arg)
+{
+  httpsrc_prc_t * p_prc = ap_arg;
+  assert (p_prc);
+  httpsrc_trans_notify (p_prc, &(p_prc->p_trans_), transfer_notified);
+}
+
 static OMX_ERRORTYPE
 httpsrc_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
 {
@@ -795,6 +982,11 @@ httpsrc_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
                            ARATELIA_HTTP_SOURCE_PORT_MIN_BUF_SIZE,
                            ARATELIA_HTTP_SOURCE_DEFAULT_RECONNECT_TIMEOUT,
                            buffer_cbacks, info_cbacks, io_cbacks, timer_cbacks);
+    if (OMX_ErrorNone == rc)
+      {
+        rc = httpsrc_trans_configure (p_prc->p_trans_, transfer_notification,
+                                      false);
+      }
   }
   return rc;
 }
@@ -831,6 +1023,7 @@ httpsrc_prc_transfer_and_process (void * ap_prc, OMX_U32 a_pid)
     {
       p_prc->connection_closed_ = false;
       p_prc->first_buffer_delivered_ = false;
+      reset_buffering_stats (p_prc);
       rc = tiz_urltrans_start (p_prc->p_trans_);
     }
   return rc;
@@ -857,8 +1050,11 @@ static OMX_ERRORTYPE
 httpsrc_prc_buffers_ready (const void * ap_prc)
 {
   httpsrc_prc_t * p_prc = (httpsrc_prc_t *) ap_prc;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (p_prc);
-  return tiz_urltrans_on_buffers_ready (p_prc->p_trans_);
+  rc = tiz_urltrans_on_buffers_ready (p_prc->p_trans_);
+  adapt_buffering (p_prc);
+  return rc;
 }
 
 static OMX_ERRORTYPE
@@ -866,8 +1062,11 @@ httpsrc_prc_io_ready (void * ap_prc, tiz_event_io_t * ap_ev_io, int a_fd,
                       int a_events)
 {
   httpsrc_prc_t * p_prc = ap_prc;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (p_prc);
-  return tiz_urltrans_on_io_ready (p_prc->p_trans_, ap_ev_io, a_fd, a_events);
+  rc = tiz_urltrans_on_io_ready (p_prc->p_trans_, ap_ev_io, a_fd, a_events);
+  adapt_buffering (p_prc);
+  return rc;
 }
 
 static OMX_ERRORTYPE
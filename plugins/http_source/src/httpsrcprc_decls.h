@@ -33,6 +33,7 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include <OMX_Core.h>
 
@@ -58,6 +59,17 @@ struct httpsrc_prc
   int cache_bytes_;
   bool connection_closed_;
   bool first_buffer_delivered_;
+  /* Adaptive buffering */
+  int cache_ms_;
+  bool cache_full_;
+  OMX_U32 underruns_;
+  OMX_U32 trans_underruns_;
+  uint64_t last_arrival_ms_;
+  uint64_t jitter_window_start_ms_;
+  OMX_U32 jitter_window_gap_ms_;
+  OMX_U32 prev_jitter_window_gap_ms_;
+  uint64_t last_adjustment_ms_;
+  uint64_t last_report_ms_;
 };
 
 typedef struct httpsrc_prc_class httpsrc_prc_class_t;
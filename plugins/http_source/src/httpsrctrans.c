@@ -0,0 +1,137 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file   httpsrctrans.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - HTTP source url transfer helpers
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include <tizkernel.h>
+#include <tizscheduler.h>
+
+#include "httpsrctrans.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.http_source.trans"
+#endif
+
+/* The pluggable event posted on every notification; the event must remain
+   the first member, so that the handler can free the whole thing */
+typedef struct httpsrc_trans_event httpsrc_trans_event_t;
+struct httpsrc_trans_event
+{
+  tiz_event_pluggable_t event;
+  tiz_urltrans_t ** pp_trans;
+  httpsrc_trans_notified_f pf_notified;
+};
+
+static bool
+use_shared_curl_multi (void)
+{
+  const char * p_value = tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION,
+    "OMX.Aratelia.audio_source.http.shared_curl_multi");
+  return (p_value && 0 == strncmp (p_value, "true", 4));
+}
+
+static int
+range_prefetch_connections (void)
+{
+  const char * p_value = tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION,
+    "OMX.Aratelia.audio_source.http.range_prefetch_connections");
+  return (p_value ? atoi (p_value) : 0);
+}
+
+static void
+transfer_notification_handler (OMX_PTR ap_prc,
+                               tiz_event_pluggable_t * ap_event)
+{
+  httpsrc_trans_event_t * p_trans_ev = (httpsrc_trans_event_t *) ap_event;
+  assert (ap_prc);
+  assert (p_trans_ev);
+  assert (p_trans_ev->pp_trans);
+
+  if (*(p_trans_ev->pp_trans))
+    {
+      (void) tiz_urltrans_on_notification (*(p_trans_ev->pp_trans));
+      if (p_trans_ev->pf_notified)
+        {
+          p_trans_ev->pf_notified (ap_prc);
+        }
+    }
+  tiz_mem_free (p_trans_ev);
+}
+
+OMX_ERRORTYPE
+httpsrc_trans_configure (tiz_urltrans_t * ap_trans,
+                         tiz_urltrans_notify_f apf_notify,
+                         const bool a_range_prefetch)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  const int prefetch_connections
+    = a_range_prefetch ? range_prefetch_connections () : 0;
+  assert (ap_trans);
+  assert (apf_notify);
+
+  if (use_shared_curl_multi ())
+    {
+      rc = tiz_urltrans_use_shared_multi (ap_trans, apf_notify);
+    }
+  if (OMX_ErrorNone == rc && prefetch_connections > 0)
+    {
+      rc = tiz_urltrans_use_range_prefetch (ap_trans, prefetch_connections,
+                                            apf_notify);
+    }
+  return rc;
+}
+
+void
+httpsrc_trans_notify (OMX_PTR ap_prc, tiz_urltrans_t ** app_trans,
+                      httpsrc_trans_notified_f apf_notified)
+{
+  httpsrc_trans_event_t * p_trans_ev = NULL;
+  assert (ap_prc);
+  assert (app_trans);
+
+  p_trans_ev = tiz_mem_calloc (1, sizeof (httpsrc_trans_event_t));
+  if (p_trans_ev)
+    {
+      p_trans_ev->event.p_servant = ap_prc;
+      p_trans_ev->event.p_data = NULL;
+      p_trans_ev->event.pf_hdlr = transfer_notification_handler;
+      p_trans_ev->pp_trans = app_trans;
+      p_trans_ev->pf_notified = apf_notified;
+      tiz_comp_event_pluggable (handleOf (ap_prc), &(p_trans_ev->event));
+    }
+}
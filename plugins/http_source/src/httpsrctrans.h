@@ -0,0 +1,90 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file   httpsrctrans.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - HTTP source url transfer helpers
+ *
+ * The rc file settings and the notification plumbing that every processor
+ * in this plugin needs when its transfer is driven by the shared curl multi
+ * handle or by the range prefetcher.
+ */
+
+#ifndef HTTPSRCTRANS_H
+#define HTTPSRCTRANS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+#include <tizplatform.h>
+
+/* Invoked from the processor's thread after the transfer has processed a
+ * notification */
+typedef void (*httpsrc_trans_notified_f) (OMX_PTR ap_prc);
+
+/**
+ * Move the transfer to the shared curl multi handle and, if requested, to
+ * the range prefetcher, according to the rc file settings. Must be called
+ * before the transfer is started.
+ *
+ * @param ap_trans The URL transfer object.
+ *
+ * @param apf_notify The processor's notification callback, which should
+ * just call httpsrc_trans_notify.
+ *
+ * @param a_range_prefetch Whether the processor's streams may be downloaded
+ * with concurrent Range requests.
+ *
+ * @return OMX_ErrorNone if success, OMX_ErrorInsufficientResources otherwise.
+ */
+OMX_ERRORTYPE
+httpsrc_trans_configure (tiz_urltrans_t * ap_trans,
+                         tiz_urltrans_notify_f apf_notify,
+                         const bool a_range_prefetch);
+
+/**
+ * Forward a notification from the shared curl multi handle or the range
+ * prefetcher to the processor's thread, where
+ * tiz_urltrans_on_notification is called on *app_trans (unless it is NULL
+ * by then), followed by apf_notified, if not NULL.
+ *
+ * @note This function may be called from the event loop thread!
+ *
+ * @param ap_prc The processor.
+ *
+ * @param app_trans The location of the processor's transfer object.
+ *
+ * @param apf_notified An optional callback.
+ */
+void
+httpsrc_trans_notify (OMX_PTR ap_prc, tiz_urltrans_t ** app_trans,
+                      httpsrc_trans_notified_f apf_notified);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPSRCTRANS_H */
@@ -34,6 +34,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <string.h>
+#include <stdio.h>
 
 #include <OMX_TizoniaExt.h>
 
@@ -43,6 +44,7 @@
 #include <tizscheduler.h>
 
 #include "httpsrc.h"
+#include "httpsrctrans.h"
 #include "plexprc.h"
 #include "plexprc_decls.h"
 
@@ -756,6 +758,29 @@ plex_prc_dtor (void * ap_obj)
  * from tizsrv class
  */
 
+/* Identify the current track for the track cache, using the track's URL on the Plex server, which does not change */
+static void
+update_cache_key (plex_prc_t * ap_prc)
+{
+  char key[PATH_MAX + NAME_MAX];
+  assert (ap_prc);
+  assert (ap_prc->p_trans_);
+  assert (ap_prc->p_uri_param_);
+
+  snprintf (key, sizeof (key), "plex:%s",
+            (const char *) ap_prc->p_uri_param_->contentURI);
+  tiz_urltrans_set_cache_key (ap_prc->p_trans_, key);
+}
+
+/* The shared curl multi handle or the range prefetcher has news */
+static void
+transfer_notification (OMX_PTR ap_arg)
+{
+  plex_prc_t * p_prc = ap_arg;
+  assert (p_prc);
+  httpsrc_trans_notify (p_prc, &(p_prc->p_trans_), NULL);
+}
+
 static OMX_ERRORTYPE
 plex_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
 {
@@ -790,6 +815,15 @@ plex_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
                            ARATELIA_HTTP_SOURCE_PORT_MIN_BUF_SIZE,
                            ARATELIA_HTTP_SOURCE_DEFAULT_RECONNECT_TIMEOUT,
                            buffer_cbacks, info_cbacks, io_cbacks, timer_cbacks);
+    if (OMX_ErrorNone == rc)
+      {
+        rc = httpsrc_trans_configure (p_prc->p_trans_, transfer_notification,
+                                      true);
+      }
+    if (OMX_ErrorNone == rc)
+      {
+        update_cache_key (p_prc);
+      }
   }
   return rc;
 }
@@ -954,6 +988,7 @@ plex_prc_config_change (void * ap_prc, OMX_U32 TIZ_UNUSED (a_pid),
       /* Changing the URL has the side effect of halting the current
          download */
       tiz_urltrans_set_uri (p_prc->p_trans_, p_prc->p_uri_param_);
+      update_cache_key (p_prc);
 
       if (p_prc->port_disabled_)
         {
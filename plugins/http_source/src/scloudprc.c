@@ -34,6 +34,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <string.h>
+#include <stdio.h>
 
 #include <OMX_TizoniaExt.h>
 
@@ -43,6 +44,7 @@
 #include <tizscheduler.h>
 
 #include "httpsrc.h"
+#include "httpsrctrans.h"
 #include "scloudprc.h"
 #include "scloudprc_decls.h"
 
@@ -687,6 +689,32 @@ scloud_prc_dtor (void * ap_obj)
  * from tizsrv class
  */
 
+/* Identify the current track for the track cache, using the track's permalink */
+static void
+update_cache_key (scloud_prc_t * ap_prc)
+{
+  const char * p_permalink = NULL;
+  assert (ap_prc);
+  assert (ap_prc->p_trans_);
+
+  p_permalink = tiz_scloud_get_current_track_permalink (ap_prc->p_scloud_);
+  if (p_permalink && strlen (p_permalink) > 0)
+    {
+      char key[PATH_MAX];
+      snprintf (key, sizeof (key), "soundcloud:%s", p_permalink);
+      tiz_urltrans_set_cache_key (ap_prc->p_trans_, key);
+    }
+}
+
+/* The shared curl multi handle or the range prefetcher has news */
+static void
+transfer_notification (OMX_PTR ap_arg)
+{
+  scloud_prc_t * p_prc = ap_arg;
+  assert (p_prc);
+  httpsrc_trans_notify (p_prc, &(p_prc->p_trans_), NULL);
+}
+
 static OMX_ERRORTYPE
 scloud_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
 {
@@ -720,6 +748,15 @@ scloud_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
                            ARATELIA_HTTP_SOURCE_PORT_MIN_BUF_SIZE,
                            ARATELIA_HTTP_SOURCE_DEFAULT_RECONNECT_TIMEOUT,
                            buffer_cbacks, info_cbacks, io_cbacks, timer_cbacks);
+    if (OMX_ErrorNone == rc)
+      {
+        rc = httpsrc_trans_configure (p_prc->p_trans_, transfer_notification,
+                                      false);
+      }
+    if (OMX_ErrorNone == rc)
+      {
+        update_cache_key (p_prc);
+      }
   }
   return rc;
 }
@@ -884,6 +921,7 @@ scloud_prc_config_change (void * ap_prc, OMX_U32 TIZ_UNUSED (a_pid),
       /* Changing the URL has the side effect of halting the current
          download */
       tiz_urltrans_set_uri (p_prc->p_trans_, p_prc->p_uri_param_);
+      update_cache_key (p_prc);
       if (p_prc->port_disabled_)
         {
           /* Record that the URI has changed, so that when the port is
@@ -34,6 +34,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <string.h>
+#include <stdio.h>
 
 #include <OMX_TizoniaExt.h>
 
@@ -43,8 +44,10 @@
 #include <tizscheduler.h>
 
 #include "httpsrc.h"
+#include "httpsrctrans.h"
 #include "youtubeprc.h"
 #include "youtubeprc_decls.h"
+#include "youtuberesolver.h"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
 #undef TIZ_LOG_CATEGORY_NAME
@@ -62,21 +65,8 @@ static OMX_ERRORTYPE
 youtube_prc_prepare_to_transfer (void * ap_prc, OMX_U32 a_pid);
 static OMX_ERRORTYPE
 youtube_prc_transfer_and_process (void * ap_prc, OMX_U32 a_pid);
-
-#define on_youtube_error_ret_omx_oom(expr)                                   \
-  do                                                                         \
-    {                                                                        \
-      int youtube_error = 0;                                                 \
-      if (0 != (youtube_error = (expr)))                                     \
-        {                                                                    \
-          TIZ_ERROR (handleOf (p_prc),                                       \
-                     "[OMX_ErrorInsufficientResources] : error while using " \
-                     "libtizyoutube [error %d]",                             \
-                     youtube_error);                                         \
-          return OMX_ErrorInsufficientResources;                             \
-        }                                                                    \
-    }                                                                        \
-  while (0)
+static void
+next_url_ready (void * ap_arg, youtube_track_t * ap_track);
 
 static inline bool
 is_valid_character (const char c)
@@ -359,60 +349,46 @@ delete_uri (youtube_prc_t * ap_prc)
 static OMX_ERRORTYPE
 update_metadata (youtube_prc_t * ap_prc)
 {
+  const youtube_track_t * p_track = NULL;
   assert (ap_prc);
+  assert (ap_prc->p_track_);
+  p_track = ap_prc->p_track_;
 
   /* Clear previous metadata items */
   tiz_krn_clear_metadata (tiz_get_krn (handleOf (ap_prc)));
 
   /* Audio stream title */
-  tiz_check_omx (store_metadata (
-    ap_prc, tiz_youtube_get_current_audio_stream_author (ap_prc->p_youtube_),
-    tiz_youtube_get_current_audio_stream_title (ap_prc->p_youtube_)));
+  tiz_check_omx (store_metadata (ap_prc, p_track->p_author, p_track->p_title));
 
   /*  */
-  tiz_check_omx (store_metadata (
-    ap_prc, "Stream #",
-    tiz_youtube_get_current_queue_progress (ap_prc->p_youtube_)));
+  tiz_check_omx (
+    store_metadata (ap_prc, "Stream #", p_track->p_queue_progress));
 
   /* ID */
-  tiz_check_omx (store_metadata (
-    ap_prc, "YouTube Id",
-    tiz_youtube_get_current_audio_stream_video_id (ap_prc->p_youtube_)));
+  tiz_check_omx (store_metadata (ap_prc, "YouTube Id", p_track->p_video_id));
 
   /* Duration */
-  tiz_check_omx (store_metadata (
-    ap_prc, "Duration",
-    tiz_youtube_get_current_audio_stream_duration (ap_prc->p_youtube_)));
+  tiz_check_omx (store_metadata (ap_prc, "Duration", p_track->p_duration));
 
   /* File Format */
-  tiz_check_omx (store_metadata (
-    ap_prc, "File Format",
-    tiz_youtube_get_current_audio_stream_file_extension (ap_prc->p_youtube_)));
+  tiz_check_omx (
+    store_metadata (ap_prc, "File Format", p_track->p_file_extension));
 
   /* Bitrate */
-  tiz_check_omx (store_metadata (
-    ap_prc, "Bitrate",
-    tiz_youtube_get_current_audio_stream_bitrate (ap_prc->p_youtube_)));
+  tiz_check_omx (store_metadata (ap_prc, "Bitrate", p_track->p_bitrate));
 
   /* File Size */
-  tiz_check_omx (store_metadata (
-    ap_prc, "Size",
-    tiz_youtube_get_current_audio_stream_file_size (ap_prc->p_youtube_)));
+  tiz_check_omx (store_metadata (ap_prc, "Size", p_track->p_file_size));
 
   /* View count */
-  tiz_check_omx (store_metadata (
-    ap_prc, "View Count",
-    tiz_youtube_get_current_audio_stream_view_count (ap_prc->p_youtube_)));
+  tiz_check_omx (store_metadata (ap_prc, "View Count", p_track->p_view_count));
 
   /* Description */
-  tiz_check_omx (store_metadata (
-    ap_prc, "Description",
-    tiz_youtube_get_current_audio_stream_description (ap_prc->p_youtube_)));
+  tiz_check_omx (
+    store_metadata (ap_prc, "Description", p_track->p_description));
 
   /* Publication date/time */
-  tiz_check_omx (store_metadata (
-    ap_prc, "Published",
-    tiz_youtube_get_current_audio_stream_published (ap_prc->p_youtube_)));
+  tiz_check_omx (store_metadata (ap_prc, "Published", p_track->p_published));
 
   /* Signal that a new set of metadata items is available */
   (void) tiz_srv_issue_event ((OMX_PTR) ap_prc, OMX_EventIndexSettingChanged,
@@ -425,14 +401,19 @@ update_metadata (youtube_prc_t * ap_prc)
   return OMX_ErrorNone;
 }
 
+/* Make the track the current one; the processor takes ownership of it */
 static OMX_ERRORTYPE
-obtain_next_url (youtube_prc_t * ap_prc, int a_skip_value)
+set_current_track (youtube_prc_t * ap_prc, youtube_track_t * ap_track)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   const long pathname_max = PATH_MAX + NAME_MAX;
 
   assert (ap_prc);
-  assert (ap_prc->p_youtube_);
+  assert (ap_track);
+  assert (ap_track->p_url);
+
+  youtube_track_free (ap_prc->p_track_);
+  ap_prc->p_track_ = ap_track;
 
   if (!ap_prc->p_uri_param_)
     {
@@ -447,40 +428,45 @@ obtain_next_url (youtube_prc_t * ap_prc, int a_skip_value)
   ap_prc->p_uri_param_->nVersion.nVersion = OMX_VERSION;
 
   {
-    const char * p_next_url
-      = a_skip_value > 0 ? tiz_youtube_get_next_url (ap_prc->p_youtube_,
-                                                    ap_prc->remove_current_url_)
-                         : tiz_youtube_get_prev_url (
-                             ap_prc->p_youtube_, ap_prc->remove_current_url_);
-    ap_prc->remove_current_url_ = false;
-    tiz_check_null_ret_oom (p_next_url);
-
-    {
-      const OMX_U32 url_len = strnlen (p_next_url, pathname_max);
-      TIZ_TRACE (handleOf (ap_prc), "URL [%s]", p_next_url);
-
-      /* Verify we are getting an http scheme */
-      if (!p_next_url || !url_len
-          || (strncasecmp (p_next_url, "http://", 7) != 0
-              && strncasecmp (p_next_url, "https://", 8) != 0))
-        {
-          rc = OMX_ErrorContentURIError;
-        }
-      else
-        {
-          strncpy ((char *) ap_prc->p_uri_param_->contentURI, p_next_url,
-                   url_len);
-          ap_prc->p_uri_param_->contentURI[url_len] = '\0';
+    const char * p_next_url = ap_track->p_url;
+    const OMX_U32 url_len = strnlen (p_next_url, pathname_max);
+    TIZ_TRACE (handleOf (ap_prc), "URL [%s]", p_next_url);
+
+    /* Verify we are getting an http scheme */
+    if (!url_len
+        || (strncasecmp (p_next_url, "http://", 7) != 0
+            && strncasecmp (p_next_url, "https://", 8) != 0))
+      {
+        rc = OMX_ErrorContentURIError;
+      }
+    else
+      {
+        strncpy ((char *) ap_prc->p_uri_param_->contentURI, p_next_url,
+                 url_len);
+        ap_prc->p_uri_param_->contentURI[url_len] = '\0';
 
-          /* Song metadata is now available, update the IL client */
-          rc = update_metadata (ap_prc);
-        }
-    }
+        /* Song metadata is now available, update the IL client */
+        rc = update_metadata (ap_prc);
+      }
   }
 
   return rc;
 }
 
+/* Blocks until the url has been resolved; only used to get the first one */
+static OMX_ERRORTYPE
+obtain_next_url (youtube_prc_t * ap_prc, int a_skip_value)
+{
+  youtube_track_t * p_track = NULL;
+  assert (ap_prc);
+  assert (ap_prc->p_resolver_);
+  tiz_check_omx (youtube_resolver_resolve (ap_prc->p_resolver_, a_skip_value,
+                                           ap_prc->remove_current_url_,
+                                           &p_track));
+  ap_prc->remove_current_url_ = false;
+  return set_current_track (ap_prc, p_track);
+}
+
 static OMX_ERRORTYPE
 release_buffer (youtube_prc_t * ap_prc)
 {
@@ -666,21 +652,23 @@ retrieve_playlist (youtube_prc_t * ap_prc)
     OMX_TizoniaIndexParamAudioYoutubePlaylist, &(ap_prc->playlist_));
 }
 
+/* NOTE: This runs on the resolver's thread */
 static OMX_ERRORTYPE
-enqueue_playlist_items (youtube_prc_t * ap_prc)
+enqueue_playlist_items (void * ap_arg, tiz_youtube_t * ap_youtube)
 {
+  youtube_prc_t * ap_prc = ap_arg;
   int rc = 1;
 
   assert (ap_prc);
-  assert (ap_prc->p_youtube_);
+  assert (ap_youtube);
 
   {
     const char * p_playlist = (const char *) ap_prc->playlist_.cPlaylistName;
     const OMX_BOOL shuffle = ap_prc->playlist_.bShuffle;
 
     tiz_youtube_set_playback_mode (
-      ap_prc->p_youtube_, (shuffle == OMX_TRUE ? ETIZYoutubePlaybackModeShuffle
-                                              : ETIZYoutubePlaybackModeNormal));
+      ap_youtube, (shuffle == OMX_TRUE ? ETIZYoutubePlaybackModeShuffle
+                                       : ETIZYoutubePlaybackModeNormal));
 
     switch (ap_prc->playlist_.ePlaylistType)
       {
@@ -692,37 +680,37 @@ enqueue_playlist_items (youtube_prc_t * ap_prc)
           break;
         case OMX_AUDIO_YoutubePlaylistTypeAudioStream:
           {
-            rc = tiz_youtube_play_audio_stream (ap_prc->p_youtube_, p_playlist);
+            rc = tiz_youtube_play_audio_stream (ap_youtube, p_playlist);
           }
           break;
         case OMX_AUDIO_YoutubePlaylistTypeAudioPlaylist:
           {
-            rc = tiz_youtube_play_audio_playlist (ap_prc->p_youtube_, p_playlist);
+            rc = tiz_youtube_play_audio_playlist (ap_youtube, p_playlist);
           }
           break;
         case OMX_AUDIO_YoutubePlaylistTypeAudioMix:
           {
-            rc = tiz_youtube_play_audio_mix (ap_prc->p_youtube_, p_playlist);
+            rc = tiz_youtube_play_audio_mix (ap_youtube, p_playlist);
           }
           break;
         case OMX_AUDIO_YoutubePlaylistTypeAudioSearch:
           {
-            rc = tiz_youtube_play_audio_search (ap_prc->p_youtube_, p_playlist);
+            rc = tiz_youtube_play_audio_search (ap_youtube, p_playlist);
           }
           break;
         case OMX_AUDIO_YoutubePlaylistTypeAudioMixSearch:
           {
-            rc = tiz_youtube_play_audio_mix_search (ap_prc->p_youtube_, p_playlist);
+            rc = tiz_youtube_play_audio_mix_search (ap_youtube, p_playlist);
           }
           break;
         case OMX_AUDIO_YoutubePlaylistTypeAudioChannelUploads:
           {
-            rc = tiz_youtube_play_audio_channel_uploads (ap_prc->p_youtube_, p_playlist);
+            rc = tiz_youtube_play_audio_channel_uploads (ap_youtube, p_playlist);
           }
           break;
         case OMX_AUDIO_YoutubePlaylistTypeAudioChannelPlaylist:
           {
-            rc = tiz_youtube_play_audio_channel_playlist (ap_prc->p_youtube_, p_playlist);
+            rc = tiz_youtube_play_audio_channel_playlist (ap_youtube, p_playlist);
           }
           break;
         default:
@@ -749,7 +737,9 @@ youtube_prc_ctor (void * ap_obj, va_list * app)
   TIZ_INIT_OMX_STRUCT (p_prc->playlist_skip_);
   p_prc->p_uri_param_ = NULL;
   p_prc->p_trans_ = NULL;
-  p_prc->p_youtube_ = NULL;
+  p_prc->p_resolver_ = NULL;
+  p_prc->p_track_ = NULL;
+  p_prc->pending_urls_ = 0;
   p_prc->eos_ = false;
   p_prc->port_disabled_ = false;
   p_prc->uri_changed_ = false;
@@ -762,13 +752,22 @@ youtube_prc_ctor (void * ap_obj, va_list * app)
   p_prc->bitrate_ = ARATELIA_HTTP_SOURCE_DEFAULT_BIT_RATE_KBITS;
   update_cache_size (p_prc);
   p_prc->remove_current_url_ = false;
+  /* The resolver's thread lives as long as the processor, so that every call
+   * into the YouTube client is made from the same thread */
+  (void) youtube_resolver_init (&(p_prc->p_resolver_),
+                                ARATELIA_HTTP_SOURCE_YOUTUBE_PREFETCH_URLS,
+                                next_url_ready, p_prc);
   return p_prc;
 }
 
 static void *
 youtube_prc_dtor (void * ap_obj)
 {
+  youtube_prc_t * p_prc = ap_obj;
+  assert (p_prc);
   (void) youtube_prc_deallocate_resources (ap_obj);
+  youtube_resolver_destroy (p_prc->p_resolver_);
+  p_prc->p_resolver_ = NULL;
   return super_dtor (typeOf (ap_obj, "youtubeprc"), ap_obj);
 }
 
@@ -776,6 +775,106 @@ youtube_prc_dtor (void * ap_obj)
  * from tizsrv class
  */
 
+/* Identify the current track for the track cache, using the video id */
+static void
+update_cache_key (youtube_prc_t * ap_prc)
+{
+  const char * p_video_id = NULL;
+  assert (ap_prc);
+  assert (ap_prc->p_trans_);
+  assert (ap_prc->p_track_);
+
+  p_video_id = ap_prc->p_track_->p_video_id;
+  if (p_video_id && strlen (p_video_id) > 0)
+    {
+      char key[PATH_MAX];
+      snprintf (key, sizeof (key), "youtube:%s", p_video_id);
+      tiz_urltrans_set_cache_key (ap_prc->p_trans_, key);
+    }
+}
+
+static void
+next_url_ready_handler (OMX_PTR ap_prc, tiz_event_pluggable_t * ap_event)
+{
+  youtube_prc_t * p_prc = ap_prc;
+  youtube_track_t * p_track = NULL;
+  assert (p_prc);
+  assert (ap_event);
+
+  p_track = ap_event->p_data;
+  tiz_mem_free (ap_event);
+
+  if (p_prc->pending_urls_ > 0)
+    {
+      p_prc->pending_urls_--;
+    }
+
+  if (!p_track || !p_prc->p_trans_ || p_prc->pending_urls_ > 0)
+    {
+      /* Either there is nothing to play, or the user has already skipped past
+         this stream */
+      youtube_track_free (p_track);
+      return;
+    }
+
+  if (OMX_ErrorNone == set_current_track (p_prc, p_track))
+    {
+      /* Changing the URL has the side effect of halting the current
+         download */
+      tiz_urltrans_set_uri (p_prc->p_trans_, p_prc->p_uri_param_);
+      update_cache_key (p_prc);
+      if (p_prc->port_disabled_)
+        {
+          /* Record that the URI has changed, so that when the port is
+             re-enabled, we restart the transfer */
+          p_prc->uri_changed_ = true;
+        }
+
+      /* Get ready to auto-detect another stream */
+      set_auto_detect_on_port (p_prc);
+      prepare_for_port_auto_detection (p_prc);
+
+      /* Re-start the transfer */
+      tiz_urltrans_start (p_prc->p_trans_);
+    }
+}
+
+/**
+ * Called by the url resolver when the url requested by a playlist skip is
+ * ready.
+ *
+ * @note This function is called from the resolver's thread!
+ */
+static void
+next_url_ready (void * ap_arg, youtube_track_t * ap_track)
+{
+  youtube_prc_t * p_prc = ap_arg;
+  tiz_event_pluggable_t * p_event = NULL;
+  assert (p_prc);
+
+  p_event = tiz_mem_calloc (1, sizeof (tiz_event_pluggable_t));
+  if (p_event)
+    {
+      p_event->p_servant = p_prc;
+      p_event->p_data = ap_track;
+      p_event->pf_hdlr = next_url_ready_handler;
+      tiz_comp_event_pluggable (handleOf (p_prc), p_event);
+    }
+  else
+    {
+      youtube_track_free (ap_track);
+    }
+}
+
+/* The shared curl multi handle or the range prefetcher has news */
+static void
+transfer_notification (OMX_PTR ap_arg)
+{
+  youtube_prc_t * p_prc = ap_arg;
+  assert (p_prc);
+  httpsrc_trans_notify (p_prc, &(p_prc->p_trans_), NULL);
+}
+
 static OMX_ERRORTYPE
 youtube_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
 {
@@ -785,9 +884,10 @@ youtube_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
   tiz_check_omx (retrieve_session_configuration (p_prc));
   tiz_check_omx (retrieve_playlist (p_prc));
 
-  on_youtube_error_ret_omx_oom (tiz_youtube_init (&(p_prc->p_youtube_)));
+  tiz_check_null_ret_oom (p_prc->p_resolver_);
 
-  tiz_check_omx (enqueue_playlist_items (p_prc));
+  tiz_check_omx (
+    youtube_resolver_open (p_prc->p_resolver_, enqueue_playlist_items));
   tiz_check_omx (obtain_next_url (p_prc, 1));
 
   {
@@ -808,6 +908,15 @@ youtube_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
                            ARATELIA_HTTP_SOURCE_PORT_MIN_BUF_SIZE,
                            ARATELIA_HTTP_SOURCE_DEFAULT_RECONNECT_TIMEOUT,
                            buffer_cbacks, info_cbacks, io_cbacks, timer_cbacks);
+    if (OMX_ErrorNone == rc)
+      {
+        rc = httpsrc_trans_configure (p_prc->p_trans_, transfer_notification,
+                                      true);
+      }
+    if (OMX_ErrorNone == rc)
+      {
+        update_cache_key (p_prc);
+      }
   }
   return rc;
 }
@@ -820,8 +929,12 @@ youtube_prc_deallocate_resources (void * ap_prc)
   tiz_urltrans_destroy (p_prc->p_trans_);
   p_prc->p_trans_ = NULL;
   delete_uri (p_prc);
-  tiz_youtube_destroy (p_prc->p_youtube_);
-  p_prc->p_youtube_ = NULL;
+  if (p_prc->p_resolver_)
+    {
+      youtube_resolver_close (p_prc->p_resolver_);
+    }
+  youtube_track_free (p_prc->p_track_);
+  p_prc->p_track_ = NULL;
   return OMX_ErrorNone;
 }
 
@@ -967,24 +1080,16 @@ youtube_prc_config_change (void * ap_prc, OMX_U32 TIZ_UNUSED (a_pid),
       tiz_check_omx (tiz_api_GetConfig (
         tiz_get_krn (handleOf (p_prc)), handleOf (p_prc),
         OMX_TizoniaIndexConfigPlaylistSkip, &p_prc->playlist_skip_));
-      p_prc->playlist_skip_.nValue > 0 ? obtain_next_url (p_prc, 1)
-                                       : obtain_next_url (p_prc, -1);
-      /* Changing the URL has the side effect of halting the current
-         download */
-      tiz_urltrans_set_uri (p_prc->p_trans_, p_prc->p_uri_param_);
-      if (p_prc->port_disabled_)
+      /* The current stream keeps playing until the new url is ready (see
+         next_url_ready_handler) */
+      rc = youtube_resolver_request (
+        p_prc->p_resolver_, p_prc->playlist_skip_.nValue > 0 ? 1 : -1,
+        p_prc->remove_current_url_);
+      if (OMX_ErrorNone == rc)
         {
-          /* Record that the URI has changed, so that when the port is
-             re-enabled, we restart the transfer */
-          p_prc->uri_changed_ = true;
+          p_prc->remove_current_url_ = false;
+          p_prc->pending_urls_++;
         }
-
-      /* Get ready to auto-detect another stream */
-      set_auto_detect_on_port (p_prc);
-      prepare_for_port_auto_detection (p_prc);
-
-      /* Re-start the transfer */
-      tiz_urltrans_start (p_prc->p_trans_);
     }
   return rc;
 }
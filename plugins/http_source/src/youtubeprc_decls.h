@@ -41,6 +41,8 @@ extern "C" {
 #include <tizplatform.h>
 #include <tizyoutube_c.h>
 
+#include "youtuberesolver.h"
+
 typedef struct youtube_prc youtube_prc_t;
 struct youtube_prc
 {
@@ -52,7 +54,9 @@ struct youtube_prc
   OMX_TIZONIA_PLAYLISTSKIPTYPE playlist_skip_;
   OMX_PARAM_CONTENTURITYPE * p_uri_param_;
   tiz_urltrans_t * p_trans_;
-  tiz_youtube_t * p_youtube_;
+  youtube_resolver_t * p_resolver_;
+  youtube_track_t * p_track_;
+  int pending_urls_;
   bool eos_;
   bool port_disabled_;
   bool uri_changed_;
@@ -0,0 +1,412 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   youtuberesolver.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - YouTube stream url resolver
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include "youtuberesolver.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.http_source.youtube.resolver"
+#endif
+
+/* Maximum number of requests that can be queued up */
+#define YOUTUBE_RESOLVER_QUEUE_CAPACITY 32
+
+typedef enum youtube_job_type youtube_job_type_t;
+enum youtube_job_type
+{
+  EJobOpen,
+  EJobClose,
+  EJobResolve
+};
+
+typedef struct youtube_job youtube_job_t;
+struct youtube_job
+{
+  youtube_job_type_t type;
+  youtube_resolver_setup_f pf_setup;
+  int skip_value;
+  bool remove_current_url;
+  /* Synchronous jobs live on the requester's stack; the requester waits
+   * until 'done' is set */
+  bool wait;
+  bool done;
+  OMX_ERRORTYPE rc;
+  youtube_track_t * p_track;
+};
+
+struct youtube_resolver
+{
+  tiz_youtube_t * p_youtube;
+  unsigned int nprefetch;
+  tiz_thread_t thread;
+  bool started;
+  tiz_queue_t * p_queue;
+  tiz_mutex_t mutex;
+  tiz_cond_t cond;
+  youtube_resolver_ready_f pf_ready;
+  void * p_arg;
+};
+
+static char *
+dup_str (const char * ap_str)
+{
+  char * p_dup = NULL;
+  if (ap_str)
+    {
+      const size_t len = strlen (ap_str);
+      if ((p_dup = tiz_mem_alloc (len + 1)))
+        {
+          memcpy (p_dup, ap_str, len + 1);
+        }
+    }
+  return p_dup;
+}
+
+/* NOTE: The getters return pointers into the client's own strings, which the
+ * next url change overwrites; hence the copies */
+static youtube_track_t *
+snapshot_track (tiz_youtube_t * ap_youtube, const char * ap_url)
+{
+  youtube_track_t * p_track = NULL;
+  assert (ap_youtube);
+  assert (ap_url);
+
+  if ((p_track = tiz_mem_calloc (1, sizeof (youtube_track_t))))
+    {
+      p_track->p_url = dup_str (ap_url);
+      p_track->p_author
+        = dup_str (tiz_youtube_get_current_audio_stream_author (ap_youtube));
+      p_track->p_title
+        = dup_str (tiz_youtube_get_current_audio_stream_title (ap_youtube));
+      p_track->p_queue_progress
+        = dup_str (tiz_youtube_get_current_queue_progress (ap_youtube));
+      p_track->p_video_id
+        = dup_str (tiz_youtube_get_current_audio_stream_video_id (ap_youtube));
+      p_track->p_duration
+        = dup_str (tiz_youtube_get_current_audio_stream_duration (ap_youtube));
+      p_track->p_file_extension = dup_str (
+        tiz_youtube_get_current_audio_stream_file_extension (ap_youtube));
+      p_track->p_bitrate
+        = dup_str (tiz_youtube_get_current_audio_stream_bitrate (ap_youtube));
+      p_track->p_file_size
+        = dup_str (tiz_youtube_get_current_audio_stream_file_size (ap_youtube));
+      p_track->p_view_count = dup_str (
+        tiz_youtube_get_current_audio_stream_view_count (ap_youtube));
+      p_track->p_description = dup_str (
+        tiz_youtube_get_current_audio_stream_description (ap_youtube));
+      p_track->p_published
+        = dup_str (tiz_youtube_get_current_audio_stream_published (ap_youtube));
+      if (!p_track->p_url)
+        {
+          youtube_track_free (p_track);
+          p_track = NULL;
+        }
+    }
+  return p_track;
+}
+
+static void
+run_job (youtube_resolver_t * ap_res, youtube_job_t * ap_job)
+{
+  assert (ap_res);
+  assert (ap_job);
+
+  switch (ap_job->type)
+    {
+      case EJobOpen:
+        {
+          assert (!ap_res->p_youtube);
+          ap_job->rc = OMX_ErrorInsufficientResources;
+          if (0 == tiz_youtube_init (&(ap_res->p_youtube)))
+            {
+              ap_job->rc = ap_job->pf_setup (ap_res->p_arg, ap_res->p_youtube);
+              if (OMX_ErrorNone != ap_job->rc)
+                {
+                  tiz_youtube_destroy (ap_res->p_youtube);
+                  ap_res->p_youtube = NULL;
+                }
+            }
+        }
+        break;
+      case EJobClose:
+        {
+          tiz_youtube_destroy (ap_res->p_youtube);
+          ap_res->p_youtube = NULL;
+          ap_job->rc = OMX_ErrorNone;
+        }
+        break;
+      case EJobResolve:
+        {
+          const char * p_url = NULL;
+          ap_job->rc = OMX_ErrorInsufficientResources;
+          if (ap_res->p_youtube)
+            {
+              p_url = ap_job->skip_value > 0
+                        ? tiz_youtube_get_next_url (
+                            ap_res->p_youtube, ap_job->remove_current_url)
+                        : tiz_youtube_get_prev_url (
+                            ap_res->p_youtube, ap_job->remove_current_url);
+            }
+          if (p_url)
+            {
+              ap_job->p_track = snapshot_track (ap_res->p_youtube, p_url);
+              ap_job->rc = ap_job->p_track ? OMX_ErrorNone
+                                           : OMX_ErrorInsufficientResources;
+            }
+        }
+        break;
+      default:
+        {
+          assert (0);
+        }
+        break;
+    };
+}
+
+static void *
+resolver_thread_func (void * ap_arg)
+{
+  youtube_resolver_t * p_res = ap_arg;
+  /* Number of upcoming streams resolved since the last move in the queue */
+  unsigned int nprefetched = 0;
+
+  assert (p_res);
+
+  for (;;)
+    {
+      OMX_PTR p_item = NULL;
+      youtube_job_t * p_job = NULL;
+
+      /* Use the idle time to resolve the streams that come next, one at a
+       * time so that a request doesn't wait for more than one of them */
+      if (p_res->p_youtube && nprefetched < p_res->nprefetch
+          && 0 == tiz_queue_length (p_res->p_queue))
+        {
+          nprefetched = (0 == tiz_youtube_prefetch_url (p_res->p_youtube,
+                                                        nprefetched + 1))
+                          ? nprefetched + 1
+                          : p_res->nprefetch;
+          continue;
+        }
+
+      /* The resolver itself is the termination request */
+      if (OMX_ErrorNone != tiz_queue_receive (p_res->p_queue, &p_item)
+          || p_item == (OMX_PTR) p_res)
+        {
+          break;
+        }
+      p_job = p_item;
+
+      run_job (p_res, p_job);
+      nprefetched = 0;
+
+      if (p_job->wait)
+        {
+          (void) tiz_mutex_lock (&(p_res->mutex));
+          p_job->done = true;
+          (void) tiz_cond_broadcast (&(p_res->cond));
+          (void) tiz_mutex_unlock (&(p_res->mutex));
+        }
+      else
+        {
+          p_res->pf_ready (p_res->p_arg, p_job->p_track);
+          tiz_mem_free (p_job);
+        }
+    }
+
+  /* In case the owner didn't close the client */
+  tiz_youtube_destroy (p_res->p_youtube);
+  p_res->p_youtube = NULL;
+  return NULL;
+}
+
+static OMX_ERRORTYPE
+run_job_and_wait (youtube_resolver_t * ap_res, youtube_job_t * ap_job)
+{
+  assert (ap_res);
+  assert (ap_job);
+
+  ap_job->wait = true;
+  ap_job->done = false;
+  tiz_check_omx (tiz_queue_send (ap_res->p_queue, ap_job));
+
+  (void) tiz_mutex_lock (&(ap_res->mutex));
+  while (!ap_job->done)
+    {
+      (void) tiz_cond_wait (&(ap_res->cond), &(ap_res->mutex));
+    }
+  (void) tiz_mutex_unlock (&(ap_res->mutex));
+  return ap_job->rc;
+}
+
+void
+youtube_track_free (youtube_track_t * ap_track)
+{
+  if (ap_track)
+    {
+      tiz_mem_free (ap_track->p_url);
+      tiz_mem_free (ap_track->p_author);
+      tiz_mem_free (ap_track->p_title);
+      tiz_mem_free (ap_track->p_queue_progress);
+      tiz_mem_free (ap_track->p_video_id);
+      tiz_mem_free (ap_track->p_duration);
+      tiz_mem_free (ap_track->p_file_extension);
+      tiz_mem_free (ap_track->p_bitrate);
+      tiz_mem_free (ap_track->p_file_size);
+      tiz_mem_free (ap_track->p_view_count);
+      tiz_mem_free (ap_track->p_description);
+      tiz_mem_free (ap_track->p_published);
+      tiz_mem_free (ap_track);
+    }
+}
+
+OMX_ERRORTYPE
+youtube_resolver_init (youtube_resolver_ptr_t * app_res,
+                       unsigned int a_nprefetch,
+                       youtube_resolver_ready_f apf_ready, void * ap_arg)
+{
+  youtube_resolver_t * p_res = NULL;
+
+  assert (app_res);
+  assert (apf_ready);
+
+  *app_res = NULL;
+  tiz_check_null_ret_oom (
+    (p_res = tiz_mem_calloc (1, sizeof (youtube_resolver_t))));
+
+  p_res->nprefetch = a_nprefetch;
+  p_res->pf_ready = apf_ready;
+  p_res->p_arg = ap_arg;
+
+  if (OMX_ErrorNone != tiz_mutex_init (&(p_res->mutex))
+      || OMX_ErrorNone != tiz_cond_init (&(p_res->cond))
+      || OMX_ErrorNone != tiz_queue_init (&(p_res->p_queue),
+                                          YOUTUBE_RESOLVER_QUEUE_CAPACITY)
+      || OMX_ErrorNone != tiz_thread_create (&(p_res->thread), 0, 0,
+                                             resolver_thread_func, p_res))
+    {
+      youtube_resolver_destroy (p_res);
+      return OMX_ErrorInsufficientResources;
+    }
+  p_res->started = true;
+  (void) tiz_thread_setname (&(p_res->thread), (const OMX_STRING) "tizytresolv");
+
+  *app_res = p_res;
+  return OMX_ErrorNone;
+}
+
+void
+youtube_resolver_destroy (youtube_resolver_t * ap_res)
+{
+  if (!ap_res)
+    {
+      return;
+    }
+
+  if (ap_res->started)
+    {
+      void * p_result = NULL;
+      (void) tiz_queue_send (ap_res->p_queue, ap_res);
+      (void) tiz_thread_join (&(ap_res->thread), &p_result);
+    }
+
+  tiz_queue_destroy (ap_res->p_queue);
+  (void) tiz_cond_destroy (&(ap_res->cond));
+  (void) tiz_mutex_destroy (&(ap_res->mutex));
+  tiz_mem_free (ap_res);
+}
+
+OMX_ERRORTYPE
+youtube_resolver_open (youtube_resolver_t * ap_res,
+                       youtube_resolver_setup_f apf_setup)
+{
+  youtube_job_t job;
+  assert (ap_res);
+  assert (apf_setup);
+  memset (&job, 0, sizeof (job));
+  job.type = EJobOpen;
+  job.pf_setup = apf_setup;
+  return run_job_and_wait (ap_res, &job);
+}
+
+void
+youtube_resolver_close (youtube_resolver_t * ap_res)
+{
+  youtube_job_t job;
+  assert (ap_res);
+  memset (&job, 0, sizeof (job));
+  job.type = EJobClose;
+  (void) run_job_and_wait (ap_res, &job);
+}
+
+OMX_ERRORTYPE
+youtube_resolver_resolve (youtube_resolver_t * ap_res, int a_skip_value,
+                          bool a_remove_current_url,
+                          youtube_track_t ** app_track)
+{
+  youtube_job_t job;
+  assert (ap_res);
+  assert (app_track);
+  memset (&job, 0, sizeof (job));
+  job.type = EJobResolve;
+  job.skip_value = a_skip_value;
+  job.remove_current_url = a_remove_current_url;
+  *app_track = NULL;
+  tiz_check_omx (run_job_and_wait (ap_res, &job));
+  *app_track = job.p_track;
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE
+youtube_resolver_request (youtube_resolver_t * ap_res, int a_skip_value,
+                          bool a_remove_current_url)
+{
+  youtube_job_t * p_job = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (ap_res);
+
+  tiz_check_null_ret_oom ((p_job = tiz_mem_calloc (1, sizeof (youtube_job_t))));
+  p_job->type = EJobResolve;
+  p_job->skip_value = a_skip_value;
+  p_job->remove_current_url = a_remove_current_url;
+  p_job->wait = false;
+  if (OMX_ErrorNone != (rc = tiz_queue_send (ap_res->p_queue, p_job)))
+    {
+      tiz_mem_free (p_job);
+    }
+  return rc;
+}
@@ -0,0 +1,114 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   youtuberesolver.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - YouTube stream url resolver
+ *
+ * Resolving a YouTube stream url goes through Python and may take from
+ * hundreds of milliseconds to several seconds. The resolver owns the
+ * tiz_youtube_t object and makes every call into it from a dedicated thread,
+ * so that the component's thread never waits for it. While idle, the thread
+ * resolves the next few streams in the playback queue ahead of time.
+ */
+
+#ifndef YOUTUBERESOLVER_H
+#define YOUTUBERESOLVER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+#include <tizyoutube_c.h>
+
+/* A snapshot of the url and the metadata of a stream */
+typedef struct youtube_track youtube_track_t;
+struct youtube_track
+{
+  char * p_url;
+  char * p_author;
+  char * p_title;
+  char * p_queue_progress;
+  char * p_video_id;
+  char * p_duration;
+  char * p_file_extension;
+  char * p_bitrate;
+  char * p_file_size;
+  char * p_view_count;
+  char * p_description;
+  char * p_published;
+};
+
+void
+youtube_track_free (youtube_track_t * ap_track);
+
+typedef struct youtube_resolver youtube_resolver_t;
+typedef /*@null@ */ youtube_resolver_t * youtube_resolver_ptr_t;
+
+/* Invoked from the resolver thread to fill the playback queue */
+typedef OMX_ERRORTYPE (*youtube_resolver_setup_f) (void * ap_arg,
+                                                   tiz_youtube_t * ap_youtube);
+
+/* Invoked from the resolver thread with the outcome of a request. The track
+ * is owned by the callee; it is NULL if no url could be obtained. */
+typedef void (*youtube_resolver_ready_f) (void * ap_arg,
+                                          youtube_track_t * ap_track);
+
+OMX_ERRORTYPE
+youtube_resolver_init (youtube_resolver_ptr_t * app_res,
+                       unsigned int a_nprefetch,
+                       youtube_resolver_ready_f apf_ready, void * ap_arg);
+
+void
+youtube_resolver_destroy (youtube_resolver_t * ap_res);
+
+/* Create the YouTube client and fill its playback queue. Blocks until done. */
+OMX_ERRORTYPE
+youtube_resolver_open (youtube_resolver_t * ap_res,
+                       youtube_resolver_setup_f apf_setup);
+
+/* Destroy the YouTube client. Blocks until done. */
+void
+youtube_resolver_close (youtube_resolver_t * ap_res);
+
+/* Move to the next (a_skip_value > 0) or previous stream and wait for its
+ * url. */
+OMX_ERRORTYPE
+youtube_resolver_resolve (youtube_resolver_t * ap_res, int a_skip_value,
+                          bool a_remove_current_url,
+                          youtube_track_t ** app_track);
+
+/* Same as youtube_resolver_resolve, but the track is delivered through the
+ * ready callback. */
+OMX_ERRORTYPE
+youtube_resolver_request (youtube_resolver_t * ap_res, int a_skip_value,
+                          bool a_remove_current_url);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* YOUTUBERESOLVER_H */
@@ -21,7 +21,7 @@
  * @file   inprocsrcprc.c
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket reader
+ * @brief  Tizonia - Shared memory ring reader
  *
  *
  */
@@ -30,7 +30,15 @@
 #include <config.h>
 #endif
 
+#define _GNU_SOURCE
+
 #include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include <tizplatform.h>
 
@@ -46,6 +54,628 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.inproc_reader.prc"
 #endif
 
+#define INPROCSRC_SHM_URI_SCHEME "unix:"
+#define INPROCSRC_ZMQ_URI_SCHEME "inproc://"
+#define INPROCSRC_DEFAULT_RING_SIZE (256 * 1024)
+#define INPROCSRC_BUFFER_MAGIC 0x49505342 /* 'IPSB' */
+/* The name of the zmq context shared with the inproc writers; inproc
+   endpoints are only visible within the same context */
+#define INPROCSRC_ZMQ_CTX_NAME "tiz.zmq.inproc"
+
+/* Port-private data of the buffers allocated by the output port. A header
+   may be pointing at the data of a zmq message, which is then kept here
+   until the header comes back. */
+typedef struct inprocsrc_buffer inprocsrc_buffer_t;
+struct inprocsrc_buffer
+{
+  OMX_U32 magic;
+  OMX_U8 * p_data;
+  zmq_msg_t msg;
+  bool has_msg;
+};
+
+OMX_U8 *
+inprocsrc_prc_alloc_buffer_hook (OMX_U32 * ap_size, OMX_PTR * app_port_priv,
+                                 void * ap_args)
+{
+  inprocsrc_buffer_t * p_buf = NULL;
+  assert (ap_size && *ap_size > 0);
+  assert (app_port_priv);
+
+  if ((p_buf = tiz_mem_calloc (1, sizeof (inprocsrc_buffer_t))))
+    {
+      if (!(p_buf->p_data = tiz_mem_calloc ((size_t) *ap_size, 1)))
+        {
+          tiz_mem_free (p_buf);
+          return NULL;
+        }
+      p_buf->magic = INPROCSRC_BUFFER_MAGIC;
+      (void) zmq_msg_init (&(p_buf->msg));
+      *app_port_priv = p_buf;
+      return p_buf->p_data;
+    }
+  return NULL;
+}
+
+static void
+release_buffer_msg (inprocsrc_buffer_t * ap_buf)
+{
+  assert (ap_buf);
+  if (ap_buf->has_msg)
+    {
+      /* This lets the writer have its header back */
+      (void) zmq_msg_close (&(ap_buf->msg));
+      (void) zmq_msg_init (&(ap_buf->msg));
+      ap_buf->has_msg = false;
+    }
+}
+
+void
+inprocsrc_prc_free_buffer_hook (OMX_PTR ap_buf, OMX_PTR ap_port_priv,
+                                void * ap_args)
+{
+  inprocsrc_buffer_t * p_buf = ap_port_priv;
+  if (p_buf)
+    {
+      /* Don't trust ap_buf; it may be pointing at a message's data */
+      assert (INPROCSRC_BUFFER_MAGIC == p_buf->magic);
+      release_buffer_msg (p_buf);
+      (void) zmq_msg_close (&(p_buf->msg));
+      tiz_mem_free (p_buf->p_data);
+      tiz_mem_free (p_buf);
+    }
+  else
+    {
+      tiz_mem_free (ap_buf);
+    }
+}
+
+static inline inprocsrc_buffer_t *
+own_buffer (OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  inprocsrc_buffer_t * p_buf = NULL;
+  assert (ap_hdr);
+  p_buf = ap_hdr->pOutputPortPrivate;
+  return (p_buf && INPROCSRC_BUFFER_MAGIC == p_buf->magic) ? p_buf : NULL;
+}
+
+/* The ring's size, from the config file, or the default */
+static size_t
+obtain_ring_size (void)
+{
+  const char * p_value = tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION,
+    "OMX.Aratelia.inproc_reader.binary.shm_ring_kb");
+  return (p_value && atoi (p_value) > 0) ? (size_t) atoi (p_value) * 1024
+                                         : INPROCSRC_DEFAULT_RING_SIZE;
+}
+
+/* The content URI is either a zmq 'inproc://' endpoint that a writer in this
+   process publishes on, or the path of the Unix socket the writer connects
+   to, optionally prefixed with 'unix:' */
+static OMX_ERRORTYPE
+obtain_uri (inprocsrc_prc_t * ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_PARAM_CONTENTURITYPE * p_uri = NULL;
+  const size_t uri_max = sizeof (ap_prc->sock_path_)
+                         + strlen (INPROCSRC_SHM_URI_SCHEME);
+  const char * p_path = NULL;
+
+  assert (ap_prc);
+
+  tiz_check_null_ret_oom (
+    (p_uri = tiz_mem_calloc (1, sizeof (OMX_PARAM_CONTENTURITYPE) + uri_max)));
+  p_uri->nSize = sizeof (OMX_PARAM_CONTENTURITYPE) + uri_max;
+  p_uri->nVersion.nVersion = OMX_VERSION;
+
+  if (OMX_ErrorNone
+      != (rc = tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)),
+                                     handleOf (ap_prc),
+                                     OMX_IndexParamContentURI, p_uri)))
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[%s] : Error retrieving the URI param from port",
+                 tiz_err_to_str (rc));
+    }
+  else if (0 == strncmp ((const char *) p_uri->contentURI,
+                         INPROCSRC_ZMQ_URI_SCHEME,
+                         strlen (INPROCSRC_ZMQ_URI_SCHEME)))
+    {
+      if (!(ap_prc->p_endpoint_ = strdup ((const char *) p_uri->contentURI)))
+        {
+          rc = OMX_ErrorInsufficientResources;
+        }
+      else
+        {
+          TIZ_NOTICE (handleOf (ap_prc), "Endpoint [%s]", ap_prc->p_endpoint_);
+        }
+    }
+  else
+    {
+      p_path = (const char *) p_uri->contentURI;
+      if (0 == strncmp (p_path, INPROCSRC_SHM_URI_SCHEME,
+                        strlen (INPROCSRC_SHM_URI_SCHEME)))
+        {
+          p_path += strlen (INPROCSRC_SHM_URI_SCHEME);
+        }
+      if (0 == strlen (p_path)
+          || strlen (p_path) >= sizeof (ap_prc->sock_path_))
+        {
+          TIZ_ERROR (handleOf (ap_prc), "Invalid socket path [%s]", p_path);
+          rc = OMX_ErrorContentURIError;
+        }
+      else
+        {
+          strcpy (ap_prc->sock_path_, p_path);
+          TIZ_NOTICE (handleOf (ap_prc), "Socket [%s]", ap_prc->sock_path_);
+        }
+    }
+
+  tiz_mem_free (p_uri);
+  return rc;
+}
+
+static OMX_ERRORTYPE
+open_listen_socket (inprocsrc_prc_t * ap_prc)
+{
+  struct sockaddr_un addr;
+  assert (ap_prc);
+  assert (ap_prc->listen_fd_ < 0);
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  strcpy (addr.sun_path, ap_prc->sock_path_);
+
+  /* A stale socket from a previous run would make bind fail */
+  (void) unlink (ap_prc->sock_path_);
+
+  ap_prc->listen_fd_
+    = socket (AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (ap_prc->listen_fd_ < 0
+      || 0 != bind (ap_prc->listen_fd_, (struct sockaddr *) &addr,
+                    sizeof (addr))
+      || 0 != listen (ap_prc->listen_fd_, 1))
+    {
+      TIZ_ERROR (handleOf (ap_prc), "Unable to listen on [%s] (%s)",
+                 ap_prc->sock_path_, strerror (errno));
+      return OMX_ErrorInsufficientResources;
+    }
+  return OMX_ErrorNone;
+}
+
+/* Only one writer at a time can attach to the ring */
+static void
+close_listen_socket (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  tiz_srv_io_watcher_destroy (ap_prc, ap_prc->p_ev_listen_);
+  ap_prc->p_ev_listen_ = NULL;
+  ap_prc->awaiting_listen_ev_ = false;
+  if (ap_prc->listen_fd_ >= 0)
+    {
+      (void) close (ap_prc->listen_fd_);
+      ap_prc->listen_fd_ = -1;
+      (void) unlink (ap_prc->sock_path_);
+    }
+}
+
+static inline OMX_ERRORTYPE
+start_io_watcher (inprocsrc_prc_t * ap_prc, tiz_event_io_t * ap_ev_io,
+                  bool * ap_awaiting)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (ap_prc);
+  assert (ap_ev_io);
+  assert (ap_awaiting);
+  if (!*ap_awaiting)
+    {
+      rc = tiz_srv_io_watcher_start (ap_prc, ap_ev_io);
+    }
+  *ap_awaiting = true;
+  return rc;
+}
+
+static inline void
+stop_data_watcher (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_ev_data_ && ap_prc->awaiting_data_ev_)
+    {
+      (void) tiz_srv_io_watcher_stop (ap_prc, ap_prc->p_ev_data_);
+    }
+  ap_prc->awaiting_data_ev_ = false;
+  if (ap_prc->p_ev_zmq_ && ap_prc->awaiting_zmq_ev_)
+    {
+      (void) tiz_srv_io_watcher_stop (ap_prc, ap_prc->p_ev_zmq_);
+    }
+  ap_prc->awaiting_zmq_ev_ = false;
+}
+
+static OMX_ERRORTYPE
+start_listening (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  tiz_check_omx (open_listen_socket (ap_prc));
+  tiz_check_omx (tiz_srv_io_watcher_init (ap_prc, &(ap_prc->p_ev_listen_),
+                                          ap_prc->listen_fd_, TIZ_EVENT_READ,
+                                          true));
+  return start_io_watcher (ap_prc, ap_prc->p_ev_listen_,
+                           &(ap_prc->awaiting_listen_ev_));
+}
+
+static OMX_ERRORTYPE
+create_ring (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  assert (!ap_prc->p_ring_);
+  tiz_check_omx (tiz_shm_ring_create (&(ap_prc->p_ring_), "tizinprocsrc",
+                                      obtain_ring_size ()));
+  tiz_check_omx (tiz_srv_io_watcher_init (
+    ap_prc, &(ap_prc->p_ev_data_), tiz_shm_ring_data_fd (ap_prc->p_ring_),
+    TIZ_EVENT_READ, true));
+  TIZ_NOTICE (handleOf (ap_prc), "Ring of [%u] bytes waiting on [%s]",
+              (unsigned int) tiz_shm_ring_capacity (ap_prc->p_ring_),
+              ap_prc->sock_path_);
+  return OMX_ErrorNone;
+}
+
+static void
+destroy_ring (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  stop_data_watcher (ap_prc);
+  tiz_srv_io_watcher_destroy (ap_prc, ap_prc->p_ev_data_);
+  ap_prc->p_ev_data_ = NULL;
+  tiz_shm_ring_destroy (ap_prc->p_ring_);
+  ap_prc->p_ring_ = NULL;
+  ap_prc->attached_ = false;
+}
+
+/* A closed ring can't carry another stream. Offer a new one to the next
+   writer that connects. */
+static OMX_ERRORTYPE
+renew_ring (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  close_listen_socket (ap_prc);
+  destroy_ring (ap_prc);
+  tiz_check_omx (create_ring (ap_prc));
+  return start_listening (ap_prc);
+}
+
+static bool
+ready_to_process (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  return (ap_prc->attached_ && !ap_prc->eos_ && !ap_prc->paused_
+          && !ap_prc->port_disabled_ && !ap_prc->stopped_);
+}
+
+static OMX_BUFFERHEADERTYPE *
+get_header (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (!ap_prc->p_outhdr_)
+    {
+      (void) tiz_krn_claim_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                   ARATELIA_INPROC_READER_PORT_INDEX, 0,
+                                   &ap_prc->p_outhdr_);
+      if (ap_prc->p_outhdr_)
+        {
+          inprocsrc_buffer_t * p_buf = own_buffer (ap_prc->p_outhdr_);
+          TIZ_TRACE (handleOf (ap_prc), "Claimed HEADER [%p]...",
+                     ap_prc->p_outhdr_);
+          if (p_buf && p_buf->has_msg)
+            {
+              /* Done with the message it was carrying */
+              release_buffer_msg (p_buf);
+              ap_prc->p_outhdr_->pBuffer = p_buf->p_data;
+            }
+          ap_prc->p_outhdr_->nOffset = 0;
+          ap_prc->p_outhdr_->nFilledLen = 0;
+          ap_prc->p_outhdr_->nFlags = 0;
+        }
+    }
+  return ap_prc->p_outhdr_;
+}
+
+static OMX_ERRORTYPE
+release_header (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_outhdr_)
+    {
+      TIZ_TRACE (handleOf (ap_prc), "Releasing HEADER [%p] nFilledLen [%d]",
+                 ap_prc->p_outhdr_, ap_prc->p_outhdr_->nFilledLen);
+      tiz_check_omx (tiz_krn_release_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                             ARATELIA_INPROC_READER_PORT_INDEX,
+                                             ap_prc->p_outhdr_));
+      ap_prc->p_outhdr_ = NULL;
+    }
+  return OMX_ErrorNone;
+}
+
+/* Move whatever the ring holds into the output buffers. A buffer goes
+   downstream as soon as it is full, or as soon as the ring runs dry, so
+   that no data sits here waiting for more to arrive */
+static OMX_ERRORTYPE
+read_from_ring (inprocsrc_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  assert (ap_prc);
+
+  while (ready_to_process (ap_prc) && (p_hdr = get_header (ap_prc)))
+    {
+      const size_t space = p_hdr->nAllocLen - p_hdr->nOffset
+                           - p_hdr->nFilledLen;
+      const size_t n = tiz_shm_ring_read (
+        ap_prc->p_ring_, p_hdr->pBuffer + p_hdr->nOffset + p_hdr->nFilledLen,
+        space);
+      p_hdr->nFilledLen += n;
+
+      if (n == space)
+        {
+          tiz_check_omx (release_header (ap_prc));
+        }
+      else if (0 == n)
+        {
+          if (tiz_shm_ring_eos (ap_prc->p_ring_))
+            {
+              TIZ_NOTICE (handleOf (ap_prc), "End of stream in HEADER [%p]",
+                          p_hdr);
+              p_hdr->nFlags |= OMX_BUFFERFLAG_EOS;
+              ap_prc->eos_ = true;
+              tiz_check_omx (release_header (ap_prc));
+              tiz_check_omx (renew_ring (ap_prc));
+            }
+          else
+            {
+              if (p_hdr->nFilledLen > 0)
+                {
+                  tiz_check_omx (release_header (ap_prc));
+                }
+              /* The ring has asked the writer for a wake-up */
+              tiz_check_omx (start_io_watcher (ap_prc, ap_prc->p_ev_data_,
+                                               &(ap_prc->awaiting_data_ev_)));
+            }
+          break;
+        }
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+accept_writer (inprocsrc_prc_t * ap_prc)
+{
+  int conn_fd = -1;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (ap_prc);
+
+  conn_fd = accept4 (ap_prc->listen_fd_, NULL, NULL, SOCK_CLOEXEC);
+  if (conn_fd < 0)
+    {
+      if (EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno)
+        {
+          return start_io_watcher (ap_prc, ap_prc->p_ev_listen_,
+                                   &(ap_prc->awaiting_listen_ev_));
+        }
+      TIZ_ERROR (handleOf (ap_prc), "accept (%s)", strerror (errno));
+      return OMX_ErrorInsufficientResources;
+    }
+
+  /* The writer maps the ring and no longer needs the connection */
+  rc = tiz_shm_ring_send (ap_prc->p_ring_, conn_fd);
+  (void) close (conn_fd);
+  if (OMX_ErrorNone == rc)
+    {
+      TIZ_NOTICE (handleOf (ap_prc), "Writer attached to [%s]",
+                  ap_prc->sock_path_);
+      ap_prc->attached_ = true;
+      /* A new stream, if the previous one has ended */
+      ap_prc->eos_ = false;
+      close_listen_socket (ap_prc);
+      rc = read_from_ring (ap_prc);
+    }
+  else
+    {
+      /* Wait for the writer to try again */
+      rc = start_io_watcher (ap_prc, ap_prc->p_ev_listen_,
+                             &(ap_prc->awaiting_listen_ev_));
+    }
+  return rc;
+}
+
+static OMX_ERRORTYPE
+open_zmq_sock (inprocsrc_prc_t * ap_prc)
+{
+  const int linger = 0;
+  int fd = -1;
+  size_t fd_len = sizeof (fd);
+  assert (ap_prc);
+  assert (ap_prc->p_endpoint_);
+
+  /* Get hold of the zmq context shared with the writers */
+  ap_prc->p_zmq_ctx_
+    = tiz_shared_acquire (INPROCSRC_ZMQ_CTX_NAME, zmq_ctx_new, zmq_ctx_term);
+  if (!ap_prc->p_zmq_ctx_)
+    {
+      TIZ_ERROR (handleOf (ap_prc), "zmq_ctx_new (%s)", zmq_strerror (errno));
+      return OMX_ErrorInsufficientResources;
+    }
+
+  /* The writer may bind later on; zmq connects as soon as it does */
+  if (!(ap_prc->p_zmq_sock_ = zmq_socket (ap_prc->p_zmq_ctx_, ZMQ_SUB))
+      || 0 != zmq_setsockopt (ap_prc->p_zmq_sock_, ZMQ_LINGER, &linger,
+                              sizeof (linger))
+      || 0 != zmq_setsockopt (ap_prc->p_zmq_sock_, ZMQ_SUBSCRIBE, "", 0)
+      || 0 != zmq_connect (ap_prc->p_zmq_sock_, ap_prc->p_endpoint_)
+      || 0 != zmq_getsockopt (ap_prc->p_zmq_sock_, ZMQ_FD, &fd, &fd_len))
+    {
+      TIZ_ERROR (handleOf (ap_prc), "Unable to subscribe to [%s] (%s)",
+                 ap_prc->p_endpoint_, zmq_strerror (errno));
+      return OMX_ErrorInsufficientResources;
+    }
+
+  tiz_check_omx (tiz_srv_io_watcher_init (ap_prc, &(ap_prc->p_ev_zmq_), fd,
+                                          TIZ_EVENT_READ, true));
+  TIZ_NOTICE (handleOf (ap_prc), "Subscribed to [%s]", ap_prc->p_endpoint_);
+  ap_prc->attached_ = true;
+  return OMX_ErrorNone;
+}
+
+static void
+close_zmq_sock (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  stop_data_watcher (ap_prc);
+  tiz_srv_io_watcher_destroy (ap_prc, ap_prc->p_ev_zmq_);
+  ap_prc->p_ev_zmq_ = NULL;
+  if (ap_prc->has_msg_)
+    {
+      (void) zmq_msg_close (&(ap_prc->msg_));
+      ap_prc->has_msg_ = false;
+    }
+  if (ap_prc->p_zmq_sock_)
+    {
+      (void) zmq_close (ap_prc->p_zmq_sock_);
+      ap_prc->p_zmq_sock_ = NULL;
+    }
+  if (ap_prc->p_zmq_ctx_)
+    {
+      tiz_shared_release (INPROCSRC_ZMQ_CTX_NAME);
+      ap_prc->p_zmq_ctx_ = NULL;
+    }
+  ap_prc->attached_ = false;
+}
+
+/* Picks up the next message, if there is one. A message with a second part
+   carries the flags of the writer's header, i.e. EOS. */
+static OMX_ERRORTYPE
+receive_msg (inprocsrc_prc_t * ap_prc)
+{
+  int more = 0;
+  size_t more_len = sizeof (more);
+  assert (ap_prc);
+  assert (!ap_prc->has_msg_);
+
+  (void) zmq_msg_init (&(ap_prc->msg_));
+  if (-1 == zmq_msg_recv (&(ap_prc->msg_), ap_prc->p_zmq_sock_, ZMQ_DONTWAIT))
+    {
+      const int error = errno;
+      (void) zmq_msg_close (&(ap_prc->msg_));
+      if (EAGAIN != error)
+        {
+          TIZ_ERROR (handleOf (ap_prc), "zmq_msg_recv (%s)",
+                     zmq_strerror (error));
+          return OMX_ErrorInsufficientResources;
+        }
+      return OMX_ErrorNone;
+    }
+
+  ap_prc->has_msg_ = true;
+  ap_prc->msg_offset_ = 0;
+  ap_prc->msg_flags_ = 0;
+
+  if (0 == zmq_getsockopt (ap_prc->p_zmq_sock_, ZMQ_RCVMORE, &more,
+                           &more_len)
+      && more)
+    {
+      /* The parts of a message arrive together */
+      zmq_msg_t flags;
+      (void) zmq_msg_init (&flags);
+      if (sizeof (OMX_U32) == zmq_msg_recv (&flags, ap_prc->p_zmq_sock_, 0))
+        {
+          memcpy (&(ap_prc->msg_flags_), zmq_msg_data (&flags),
+                  sizeof (OMX_U32));
+        }
+      (void) zmq_msg_close (&flags);
+    }
+  return OMX_ErrorNone;
+}
+
+/* The header carries the message's data where it can, i.e. when it is one
+   of ours and big enough, and otherwise gets a copy of it */
+static void
+fill_header (inprocsrc_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  inprocsrc_buffer_t * p_buf = NULL;
+  size_t size = 0;
+  assert (ap_prc);
+  assert (ap_hdr);
+  assert (ap_prc->has_msg_);
+
+  p_buf = own_buffer (ap_hdr);
+  size = zmq_msg_size (&(ap_prc->msg_));
+
+  if (p_buf && 0 == ap_prc->msg_offset_ && size > 0
+      && size <= ap_hdr->nAllocLen)
+    {
+      /* The message's data may live inside the zmq_msg_t itself, so it is
+         looked up after the move */
+      assert (!p_buf->has_msg);
+      (void) zmq_msg_move (&(p_buf->msg), &(ap_prc->msg_));
+      p_buf->has_msg = true;
+      ap_hdr->pBuffer = zmq_msg_data (&(p_buf->msg));
+      ap_hdr->nFilledLen = size;
+      ap_prc->msg_offset_ = size;
+    }
+  else
+    {
+      const size_t n = MIN (size - ap_prc->msg_offset_,
+                            (size_t) ap_hdr->nAllocLen);
+      memcpy (ap_hdr->pBuffer,
+              (OMX_U8 *) zmq_msg_data (&(ap_prc->msg_)) + ap_prc->msg_offset_,
+              n);
+      ap_hdr->nFilledLen = n;
+      ap_prc->msg_offset_ += n;
+    }
+
+  if (ap_prc->msg_offset_ >= size)
+    {
+      (void) zmq_msg_close (&(ap_prc->msg_));
+      ap_prc->has_msg_ = false;
+      if ((ap_prc->msg_flags_ & OMX_BUFFERFLAG_EOS) != 0)
+        {
+          /* The next message, if any, starts a new stream */
+          TIZ_NOTICE (handleOf (ap_prc), "End of stream in HEADER [%p]",
+                      ap_hdr);
+          ap_hdr->nFlags |= OMX_BUFFERFLAG_EOS;
+        }
+    }
+}
+
+/* One message per buffer, sent downstream straight away */
+static OMX_ERRORTYPE
+read_from_zmq (inprocsrc_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  assert (ap_prc);
+
+  while (ready_to_process (ap_prc) && (p_hdr = get_header (ap_prc)))
+    {
+      if (!ap_prc->has_msg_)
+        {
+          tiz_check_omx (receive_msg (ap_prc));
+          if (!ap_prc->has_msg_)
+            {
+              return start_io_watcher (ap_prc, ap_prc->p_ev_zmq_,
+                                       &(ap_prc->awaiting_zmq_ev_));
+            }
+        }
+      fill_header (ap_prc, p_hdr);
+      tiz_check_omx (release_header (ap_prc));
+    }
+  return OMX_ErrorNone;
+}
+
+static inline OMX_ERRORTYPE
+read_data (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  return ap_prc->p_endpoint_ ? read_from_zmq (ap_prc) : read_from_ring (ap_prc);
+}
+
 /*
  * inprocsrcprc
  */
@@ -55,6 +685,26 @@ inprocsrc_prc_ctor (void *ap_obj, va_list * app)
 {
   inprocsrc_prc_t *p_obj = super_ctor (typeOf (ap_obj, "inprocsrcprc"), ap_obj, app);
   p_obj->eos_ = false;
+  p_obj->port_disabled_ = false;
+  p_obj->paused_ = false;
+  p_obj->stopped_ = true;
+  p_obj->p_outhdr_ = NULL;
+  p_obj->sock_path_[0] = '\0';
+  p_obj->listen_fd_ = -1;
+  p_obj->p_ev_listen_ = NULL;
+  p_obj->awaiting_listen_ev_ = false;
+  p_obj->p_ring_ = NULL;
+  p_obj->attached_ = false;
+  p_obj->p_ev_data_ = NULL;
+  p_obj->awaiting_data_ev_ = false;
+  p_obj->p_endpoint_ = NULL;
+  p_obj->p_zmq_ctx_ = NULL;
+  p_obj->p_zmq_sock_ = NULL;
+  p_obj->p_ev_zmq_ = NULL;
+  p_obj->awaiting_zmq_ev_ = false;
+  p_obj->has_msg_ = false;
+  p_obj->msg_offset_ = 0;
+  p_obj->msg_flags_ = 0;
   return p_obj;
 }
 
@@ -64,12 +714,6 @@ inprocsrc_prc_dtor (void *ap_obj)
   return super_dtor (typeOf (ap_obj, "inprocsrcprc"), ap_obj);
 }
 
-static OMX_ERRORTYPE
-inprocsrc_prc_read_buffer (const void *ap_obj, OMX_BUFFERHEADERTYPE * p_hdr)
-{
-  return OMX_ErrorNone;
-}
-
 /*
  * from tizsrv class
  */
@@ -77,31 +721,80 @@ inprocsrc_prc_read_buffer (const void *ap_obj, OMX_BUFFERHEADERTYPE * p_hdr)
 static OMX_ERRORTYPE
 inprocsrc_prc_allocate_resources (void *ap_obj, OMX_U32 a_pid)
 {
-  return OMX_ErrorNone;
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+
+  tiz_check_omx (obtain_uri (p_prc));
+  if (p_prc->p_endpoint_)
+    {
+      return open_zmq_sock (p_prc);
+    }
+  tiz_check_omx (create_ring (p_prc));
+
+  /* Let the writer attach while still in Idle */
+  return start_listening (p_prc);
 }
 
 static OMX_ERRORTYPE
 inprocsrc_prc_deallocate_resources (void *ap_obj)
 {
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+  close_zmq_sock (p_prc);
+  free (p_prc->p_endpoint_);
+  p_prc->p_endpoint_ = NULL;
+  close_listen_socket (p_prc);
+  destroy_ring (p_prc);
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
 inprocsrc_prc_prepare_to_transfer (void *ap_obj, OMX_U32 a_pid)
 {
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+  p_prc->eos_ = false;
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
 inprocsrc_prc_transfer_and_process (void *ap_obj, OMX_U32 a_pid)
 {
-  return OMX_ErrorNone;
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+  p_prc->stopped_ = false;
+  return read_data (p_prc);
 }
 
 static OMX_ERRORTYPE
 inprocsrc_prc_stop_and_return (void *ap_obj)
 {
-  return OMX_ErrorNone;
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+  p_prc->stopped_ = true;
+  p_prc->paused_ = false;
+  stop_data_watcher (p_prc);
+  return release_header (p_prc);
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_io_ready (void *ap_obj, tiz_event_io_t * ap_ev_io, int a_fd,
+                        int a_events)
+{
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+  if (ap_ev_io == p_prc->p_ev_listen_)
+    {
+      p_prc->awaiting_listen_ev_ = false;
+      return p_prc->listen_fd_ >= 0 ? accept_writer (p_prc) : OMX_ErrorNone;
+    }
+  if (ap_ev_io == p_prc->p_ev_zmq_)
+    {
+      p_prc->awaiting_zmq_ev_ = false;
+      return read_from_zmq (p_prc);
+    }
+  p_prc->awaiting_data_ev_ = false;
+  return read_from_ring (p_prc);
 }
 
 /*
@@ -111,9 +804,53 @@ inprocsrc_prc_stop_and_return (void *ap_obj)
 static OMX_ERRORTYPE
 inprocsrc_prc_buffers_ready (const void *ap_obj)
 {
+  return read_data ((inprocsrc_prc_t *) ap_obj);
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_pause (const void *ap_obj)
+{
+  inprocsrc_prc_t *p_prc = (inprocsrc_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->paused_ = true;
+  stop_data_watcher (p_prc);
   return OMX_ErrorNone;
 }
 
+static OMX_ERRORTYPE
+inprocsrc_prc_resume (const void *ap_obj)
+{
+  inprocsrc_prc_t *p_prc = (inprocsrc_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->paused_ = false;
+  return read_data (p_prc);
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_port_flush (const void *ap_obj, OMX_U32 a_pid)
+{
+  return release_header ((inprocsrc_prc_t *) ap_obj);
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_port_disable (const void *ap_obj, OMX_U32 a_pid)
+{
+  inprocsrc_prc_t *p_prc = (inprocsrc_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->port_disabled_ = true;
+  stop_data_watcher (p_prc);
+  return release_header (p_prc);
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_port_enable (const void *ap_obj, OMX_U32 a_pid)
+{
+  inprocsrc_prc_t *p_prc = (inprocsrc_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->port_disabled_ = false;
+  return read_data (p_prc);
+}
+
 /*
  * inprocsrc_prc_class
  */
@@ -171,7 +908,19 @@ inprocsrc_prc_init (void * ap_tos, void * ap_hdl)
      /* TIZ_CLASS_COMMENT: */
      tiz_srv_stop_and_return, inprocsrc_prc_stop_and_return,
      /* TIZ_CLASS_COMMENT: */
+     tiz_srv_io_ready, inprocsrc_prc_io_ready,
+     /* TIZ_CLASS_COMMENT: */
      tiz_prc_buffers_ready, inprocsrc_prc_buffers_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_pause, inprocsrc_prc_pause,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_resume, inprocsrc_prc_resume,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_flush, inprocsrc_prc_port_flush,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_disable, inprocsrc_prc_port_disable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_enable, inprocsrc_prc_port_enable,
      /* TIZ_CLASS_COMMENT: stop value */
      0);
 
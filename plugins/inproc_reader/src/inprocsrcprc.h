@@ -37,6 +37,14 @@ extern "C"
   void * inprocsrc_prc_class_init (void * ap_tos, void * ap_hdl);
   void * inprocsrc_prc_init (void * ap_tos, void * ap_hdl);
 
+  /* Buffer allocation hooks of the output port. These let the processor
+     hand out the data of the zmq messages received, without copying it */
+  OMX_U8 * inprocsrc_prc_alloc_buffer_hook (OMX_U32 * ap_size,
+                                            OMX_PTR * app_port_priv,
+                                            void * ap_args);
+  void inprocsrc_prc_free_buffer_hook (OMX_PTR ap_buf, OMX_PTR ap_port_priv,
+                                       void * ap_args);
+
 #ifdef __cplusplus
 }
 #endif
@@ -35,8 +35,13 @@ extern "C"
 
 #include <stdbool.h>
 
+#include <sys/un.h>
+
+#include <zmq.h>
+
 #include <OMX_Core.h>
 
+#include <tizplatform.h>
 #include <tizprc_decls.h>
 
   typedef struct inprocsrc_prc inprocsrc_prc_t;
@@ -45,6 +50,27 @@ extern "C"
     /* Object */
     const tiz_prc_t _;
     bool eos_;
+    bool port_disabled_;
+    bool paused_;
+    bool stopped_;
+    OMX_BUFFERHEADERTYPE * p_outhdr_;
+    char sock_path_[sizeof (((struct sockaddr_un *) 0)->sun_path)];
+    int listen_fd_;
+    tiz_event_io_t * p_ev_listen_;
+    bool awaiting_listen_ev_;
+    tiz_shm_ring_t * p_ring_;
+    bool attached_;
+    tiz_event_io_t * p_ev_data_;
+    bool awaiting_data_ev_;
+    char * p_endpoint_;
+    void * p_zmq_ctx_;
+    void * p_zmq_sock_;
+    tiz_event_io_t * p_ev_zmq_;
+    bool awaiting_zmq_ev_;
+    zmq_msg_t msg_;
+    bool has_msg_;
+    size_t msg_offset_;
+    OMX_U32 msg_flags_;
   };
 
   typedef struct inprocsrc_prc_class inprocsrc_prc_class_t;
@@ -31,6 +31,12 @@
 #endif
 
 #include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include <tizplatform.h>
 
@@ -46,6 +52,18 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.inproc_writer.prc"
 #endif
 
+#define INPROCRND_RETURN_TIMEOUT_MS 2000
+#define INPROCRND_CLOSE_TIMEOUT_MS 500
+#define INPROCRND_BIND_RETRIES 50
+#define INPROCRND_BIND_RETRY_US 10000
+#define INPROCRND_SHM_URI_SCHEME "unix:"
+#define INPROCRND_ZMQ_URI_SCHEME "inproc://"
+#define INPROCRND_ZMQ_DEFAULT_ENDPOINT "inproc://broadcast"
+/* The name of the zmq context shared with the inproc readers; inproc
+   endpoints are only visible within the same context */
+#define INPROCRND_ZMQ_CTX_NAME "tiz.zmq.inproc"
+#define INPROCRND_ATTACH_RETRY_S 0.1
+
 #define goto_end_on_zmq_null_pointer(expr, prc, msg)  \
   do                                                  \
     {                                                 \
@@ -127,64 +145,765 @@ static bool ready_to_write_to_zmq_sock (inprocrnd_prc_t *ap_prc)
   return sock_ready;
 }
 
-static OMX_ERRORTYPE release_header (inprocrnd_prc_t *ap_prc)
+static OMX_ERRORTYPE release_header (inprocrnd_prc_t *ap_prc,
+                                     OMX_BUFFERHEADERTYPE *ap_hdr)
+{
+  assert (ap_prc);
+  assert (ap_hdr);
+
+  if ((ap_hdr->nFlags & OMX_BUFFERFLAG_EOS) != 0)
+    {
+      TIZ_DEBUG (handleOf (ap_prc), "OMX_BUFFERFLAG_EOS in HEADER [%p]",
+                 ap_hdr);
+      tiz_srv_issue_event ((OMX_PTR)ap_prc, OMX_EventBufferFlag, 0,
+                           ap_hdr->nFlags, NULL);
+    }
+
+  TIZ_TRACE (handleOf (ap_prc), "Releasing HEADER [%p] emptied", ap_hdr);
+  ap_hdr->nOffset = 0;
+  ap_hdr->nFilledLen = 0;
+  return tiz_krn_release_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                 ARATELIA_INPROC_WRITER_PORT_INDEX, ap_hdr);
+}
+
+static void msg_handler (OMX_PTR ap_prc, tiz_event_pluggable_t *ap_event);
+
+static void destroy_msgs (inprocrnd_msgs_t *ap_msgs)
+{
+  if (ap_msgs)
+    {
+      if (ap_msgs->cond)
+        {
+          (void)tiz_cond_destroy (&(ap_msgs->cond));
+        }
+      if (ap_msgs->mutex)
+        {
+          (void)tiz_mutex_destroy (&(ap_msgs->mutex));
+        }
+      tiz_mem_free (ap_msgs);
+    }
+}
+
+static OMX_ERRORTYPE create_msgs (inprocrnd_prc_t *ap_prc)
+{
+  inprocrnd_msgs_t *p_msgs = NULL;
+  assert (ap_prc);
+  assert (!ap_prc->p_msgs_);
+
+  tiz_check_null_ret_oom ((p_msgs = tiz_mem_calloc (1, sizeof(*p_msgs))));
+  if (OMX_ErrorNone != tiz_mutex_init (&(p_msgs->mutex))
+      || OMX_ErrorNone != tiz_cond_init (&(p_msgs->cond)))
+    {
+      destroy_msgs (p_msgs);
+      return OMX_ErrorInsufficientResources;
+    }
+  p_msgs->p_prc = ap_prc;
+  ap_prc->p_msgs_ = p_msgs;
+  return OMX_ErrorNone;
+}
+
+/* Called from the dtor; the messages still held by the receivers keep the
+   block alive, and the last one to be freed destroys it */
+static void orphan_msgs (inprocrnd_prc_t *ap_prc)
+{
+  inprocrnd_msgs_t *p_msgs = NULL;
+  bool orphaned = false;
+  assert (ap_prc);
+
+  if ((p_msgs = ap_prc->p_msgs_))
+    {
+      ap_prc->p_msgs_ = NULL;
+      (void)tiz_mutex_lock (&(p_msgs->mutex));
+      p_msgs->p_prc = NULL;
+      orphaned = (0 == p_msgs->nmsgs);
+      (void)tiz_mutex_unlock (&(p_msgs->mutex));
+      if (orphaned)
+        {
+          destroy_msgs (p_msgs);
+        }
+    }
+}
+
+/**
+ * Called by zmq when a message is no longer needed, i.e. when the receiver
+ * has closed it, or when the socket had to drop it.
+ *
+ * @note This function may be called from a foreign thread, and after the
+ * processor has been destroyed!
+ */
+static void msg_free (void *ap_data, void *ap_hint)
+{
+  inprocrnd_msg_t *p_msg = ap_hint;
+  inprocrnd_msgs_t *p_msgs = NULL;
+  inprocrnd_prc_t *p_prc = NULL;
+  bool orphaned = false;
+  assert (p_msg);
+
+  p_msgs = p_msg->p_msgs;
+  assert (p_msgs);
+
+  (void)tiz_mutex_lock (&(p_msgs->mutex));
+  p_prc = p_msgs->p_prc;
+  if (p_prc && p_msg->p_hdr)
+    {
+      p_msg->returned = true;
+      if (!p_msgs->notified)
+        {
+          /* Posted with the lock held, so that the processor can't go away
+             in the meantime */
+          tiz_event_pluggable_t *p_event
+              = tiz_mem_calloc (1, sizeof(tiz_event_pluggable_t));
+          if (p_event)
+            {
+              p_event->p_servant = p_prc;
+              p_event->p_data = NULL;
+              p_event->pf_hdlr = msg_handler;
+              tiz_comp_event_pluggable (handleOf (p_prc), p_event);
+              p_msgs->notified = true;
+            }
+        }
+    }
+  else
+    {
+      /* The message was never sent, or its header was already taken back
+         (see abandon_msgs) */
+      p_msg->busy = false;
+      p_msgs->nmsgs--;
+    }
+  orphaned = (!p_prc && 0 == p_msgs->nmsgs);
+  (void)tiz_cond_broadcast (&(p_msgs->cond));
+  (void)tiz_mutex_unlock (&(p_msgs->mutex));
+
+  if (orphaned)
+    {
+      destroy_msgs (p_msgs);
+    }
+}
+
+/* Hand back the headers of the messages that zmq has finished with */
+static OMX_ERRORTYPE release_returned_headers (inprocrnd_prc_t *ap_prc)
 {
+  inprocrnd_msgs_t *p_msgs = NULL;
+  OMX_BUFFERHEADERTYPE *hdrs[INPROCRND_MAX_MSGS_IN_FLIGHT];
+  size_t nhdrs = 0;
+  size_t i = 0;
   assert (ap_prc);
+  assert (ap_prc->p_msgs_);
+
+  p_msgs = ap_prc->p_msgs_;
+  (void)tiz_mutex_lock (&(p_msgs->mutex));
+  for (i = 0; i < INPROCRND_MAX_MSGS_IN_FLIGHT; ++i)
+    {
+      inprocrnd_msg_t *p_msg = &(p_msgs->msgs[i]);
+      if (p_msg->busy && p_msg->returned)
+        {
+          hdrs[nhdrs++] = p_msg->p_hdr;
+          p_msg->p_hdr = NULL;
+          p_msg->returned = false;
+          p_msg->busy = false;
+          p_msgs->nmsgs--;
+        }
+    }
+  p_msgs->notified = false;
+  (void)tiz_mutex_unlock (&(p_msgs->mutex));
+
+  for (i = 0; i < nhdrs; ++i)
+    {
+      tiz_check_omx (release_header (ap_prc, hdrs[i]));
+    }
+  return OMX_ErrorNone;
+}
+
+/* Must be called with the mutex held */
+static bool msgs_pending (inprocrnd_msgs_t *ap_msgs)
+{
+  OMX_U32 i = 0;
+  assert (ap_msgs);
+  for (i = 0; i < INPROCRND_MAX_MSGS_IN_FLIGHT; ++i)
+    {
+      if (ap_msgs->msgs[i].busy && !ap_msgs->msgs[i].returned
+          && ap_msgs->msgs[i].p_hdr)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+/* Wait, for a while, for zmq to free the messages sent. Returns true if some
+   are still out there. */
+static bool wait_for_returns (inprocrnd_prc_t *ap_prc, const OMX_U32 a_ms)
+{
+  inprocrnd_msgs_t *p_msgs = NULL;
+  bool pending = false;
+  assert (ap_prc);
+  assert (ap_prc->p_msgs_);
+
+  p_msgs = ap_prc->p_msgs_;
+  (void)tiz_mutex_lock (&(p_msgs->mutex));
+  while ((pending = msgs_pending (p_msgs))
+         && OMX_ErrorNone
+                == tiz_cond_timedwait (&(p_msgs->cond), &(p_msgs->mutex), a_ms))
+    {
+    }
+  (void)tiz_mutex_unlock (&(p_msgs->mutex));
+  return pending;
+}
+
+/* Takes back the headers of the messages that the receivers still hold. When
+   zmq frees those messages later on, the free callback finds no header and
+   only recycles the message. */
+static OMX_ERRORTYPE abandon_msgs (inprocrnd_prc_t *ap_prc)
+{
+  inprocrnd_msgs_t *p_msgs = NULL;
+  OMX_BUFFERHEADERTYPE *hdrs[INPROCRND_MAX_MSGS_IN_FLIGHT];
+  size_t nhdrs = 0;
+  size_t i = 0;
+  assert (ap_prc);
+  assert (ap_prc->p_msgs_);
+
+  p_msgs = ap_prc->p_msgs_;
+  (void)tiz_mutex_lock (&(p_msgs->mutex));
+  for (i = 0; i < INPROCRND_MAX_MSGS_IN_FLIGHT; ++i)
+    {
+      inprocrnd_msg_t *p_msg = &(p_msgs->msgs[i]);
+      if (p_msg->busy && !p_msg->returned && p_msg->p_hdr)
+        {
+          hdrs[nhdrs++] = p_msg->p_hdr;
+          p_msg->p_hdr = NULL;
+        }
+    }
+  (void)tiz_mutex_unlock (&(p_msgs->mutex));
+
+  for (i = 0; i < nhdrs; ++i)
+    {
+      tiz_check_omx (release_header (ap_prc, hdrs[i]));
+    }
+  return OMX_ErrorNone;
+}
+
+static void close_zmq_sock (inprocrnd_prc_t *ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_zmq_sock_)
+    {
+      (void)zmq_close (ap_prc->p_zmq_sock_);
+      ap_prc->p_zmq_sock_ = NULL;
+      ap_prc->zmq_fd_ = -1;
+    }
+}
+
+static OMX_ERRORTYPE open_zmq_sock (inprocrnd_prc_t *ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
+  const int linger = 0;
+  size_t fd_len = sizeof(ap_prc->zmq_fd_);
+  int zmq_rc = 0;
+  int retries = INPROCRND_BIND_RETRIES;
+  assert (ap_prc);
+  assert (ap_prc->p_zmq_ctx_);
+  assert (!ap_prc->p_zmq_sock_);
+
+  /* Create the zmq PUB socket */
+  ap_prc->p_zmq_sock_ = zmq_socket (ap_prc->p_zmq_ctx_, ZMQ_PUB);
+  goto_end_on_zmq_null_pointer (ap_prc->p_zmq_sock_, ap_prc,
+                                zmq_strerror (errno));
+
+  /* Closing must not wait for the messages queued to the receivers; they
+     are dropped, and freed, instead */
+  zmq_rc = zmq_setsockopt (ap_prc->p_zmq_sock_, ZMQ_LINGER, &linger,
+                           sizeof(linger));
+  goto_end_on_zmq_error (zmq_rc, ap_prc, zmq_strerror (errno));
+
+  /* Bind the socket to the inproc address. A socket closed a moment ago
+     may still hold the endpoint, until zmq has finished tearing it down. */
+  while (0 != (zmq_rc = zmq_bind (ap_prc->p_zmq_sock_, ap_prc->p_endpoint_))
+         && EADDRINUSE == errno && retries-- > 0)
+    {
+      (void)usleep (INPROCRND_BIND_RETRY_US);
+    }
+  goto_end_on_zmq_error (zmq_rc, ap_prc, zmq_strerror (errno));
+
+  zmq_rc = zmq_getsockopt (ap_prc->p_zmq_sock_, ZMQ_FD, &ap_prc->zmq_fd_,
+                           &fd_len);
+  goto_end_on_zmq_error (zmq_rc, ap_prc, zmq_strerror (errno));
+
+  TIZ_NOTICE (handleOf (ap_prc), "Publishing on [%s]", ap_prc->p_endpoint_);
+
+  /* All good */
+  rc = OMX_ErrorNone;
+
+end:
+
+  if (OMX_ErrorNone != rc)
+    {
+      close_zmq_sock (ap_prc);
+    }
+  return rc;
+}
+
+/* Wait, for a while, for the receivers to finish with the messages sent, as
+   all the headers must be returned */
+static OMX_ERRORTYPE wait_for_msgs (inprocrnd_prc_t *ap_prc)
+{
+  bool pending = false;
+  assert (ap_prc);
+
+  if (ap_prc->p_msgs_)
+    {
+      pending = wait_for_returns (ap_prc, INPROCRND_RETURN_TIMEOUT_MS);
+      tiz_check_omx (release_returned_headers (ap_prc));
+    }
+
+  if (pending && ap_prc->p_zmq_sock_)
+    {
+      /* Drop whatever the receivers haven't picked up yet; zmq frees those
+         messages as the receivers notice the socket is gone. The socket is
+         opened again when the transfer restarts. */
+      TIZ_WARN (handleOf (ap_prc),
+                "Timed out waiting for the receivers; closing the socket");
+      close_zmq_sock (ap_prc);
+      pending = wait_for_returns (ap_prc, INPROCRND_CLOSE_TIMEOUT_MS);
+      tiz_check_omx (release_returned_headers (ap_prc));
+    }
+
+  if (pending)
+    {
+      /* These are being held by the receivers themselves; the bookkeeping
+         survives them, but their data may be overwritten under their feet */
+      TIZ_WARN (handleOf (ap_prc),
+                "Receivers still hold messages; returning their headers");
+      tiz_check_omx (abandon_msgs (ap_prc));
+    }
 
   if (ap_prc->p_inhdr_)
     {
-      TIZ_TRACE (handleOf (ap_prc), "Releasing HEADER [%p] emptied",
-                 ap_prc->p_inhdr_);
-      ap_prc->p_inhdr_->nOffset = 0;
-      ap_prc->p_inhdr_->nFilledLen = 0;
-      tiz_check_omx (tiz_krn_release_buffer (
-          tiz_get_krn (handleOf (ap_prc)), ARATELIA_INPROC_WRITER_PORT_INDEX,
-          ap_prc->p_inhdr_));
+      tiz_check_omx (release_header (ap_prc, ap_prc->p_inhdr_));
       ap_prc->p_inhdr_ = NULL;
     }
   return OMX_ErrorNone;
 }
 
-static OMX_ERRORTYPE buffer_emptied (inprocrnd_prc_t *ap_prc)
+static inprocrnd_msg_t *get_free_msg (inprocrnd_prc_t *ap_prc)
 {
+  inprocrnd_msgs_t *p_msgs = NULL;
+  inprocrnd_msg_t *p_msg = NULL;
+  OMX_U32 i = 0;
   assert (ap_prc);
-  assert (ap_prc->p_inhdr_);
-  assert (ap_prc->p_inhdr_->nFilledLen == 0);
+  assert (ap_prc->p_msgs_);
 
-  if ((ap_prc->p_inhdr_->nFlags & OMX_BUFFERFLAG_EOS) != 0)
+  p_msgs = ap_prc->p_msgs_;
+  (void)tiz_mutex_lock (&(p_msgs->mutex));
+  for (i = 0; i < INPROCRND_MAX_MSGS_IN_FLIGHT && !p_msg; ++i)
     {
-      TIZ_DEBUG (handleOf (ap_prc), "OMX_BUFFERFLAG_EOS in HEADER [%p]",
-                 ap_prc->p_inhdr_);
-      tiz_srv_issue_event ((OMX_PTR)ap_prc, OMX_EventBufferFlag, 0,
-                           ap_prc->p_inhdr_->nFlags, NULL);
+      if (!p_msgs->msgs[i].busy)
+        {
+          p_msg = &(p_msgs->msgs[i]);
+          p_msg->p_msgs = p_msgs;
+          p_msg->p_hdr = NULL;
+          p_msg->returned = false;
+          p_msg->busy = true;
+          p_msgs->nmsgs++;
+        }
     }
+  (void)tiz_mutex_unlock (&(p_msgs->mutex));
+  return p_msg;
+}
 
-  return release_header (ap_prc);
+static void set_msg_header (inprocrnd_prc_t *ap_prc, inprocrnd_msg_t *ap_msg,
+                            OMX_BUFFERHEADERTYPE *ap_hdr)
+{
+  assert (ap_prc);
+  assert (ap_msg);
+  (void)tiz_mutex_lock (&(ap_prc->p_msgs_->mutex));
+  ap_msg->p_hdr = ap_hdr;
+  (void)tiz_mutex_unlock (&(ap_prc->p_msgs_->mutex));
 }
 
-static OMX_ERRORTYPE write_buffer (inprocrnd_prc_t *ap_prc)
+/* On return, the message is either sent or still owned by the caller */
+static OMX_ERRORTYPE send_frame (inprocrnd_prc_t *ap_prc, zmq_msg_t *ap_msg,
+                                 const int a_flags, bool *ap_sent)
+{
+  assert (ap_prc);
+  assert (ap_msg);
+  assert (ap_sent);
+
+  *ap_sent = (-1 != zmq_msg_send (ap_msg, ap_prc->p_zmq_sock_, a_flags));
+  if (!*ap_sent && EAGAIN != errno)
+    {
+      TIZ_ERROR (handleOf (ap_prc), "zmq_msg_send (%s)", zmq_strerror (errno));
+      return OMX_ErrorInsufficientResources;
+    }
+  return OMX_ErrorNone;
+}
+
+/* The message points at the header's data, and the header is only returned
+   once the message has been released; no copies are made. A header with EOS
+   is sent as a two-part message, the second part carrying its flags. */
+static OMX_ERRORTYPE send_header (inprocrnd_prc_t *ap_prc,
+                                  OMX_BUFFERHEADERTYPE *ap_hdr, bool *ap_sent)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  inprocrnd_msg_t *p_msg = NULL;
+  zmq_msg_t msg;
+  const bool eos = (ap_hdr->nFlags & OMX_BUFFERFLAG_EOS) != 0;
+  const int flags = ZMQ_DONTWAIT | (eos ? ZMQ_SNDMORE : 0);
+  assert (ap_prc);
+  assert (ap_hdr);
+  assert (ap_sent);
+
+  *ap_sent = false;
+  if (!ap_prc->p_zmq_sock_)
+    {
+      /* Closed after a timeout; the buffers wait for the next transfer */
+      return OMX_ErrorNone;
+    }
+
+  if (0 == ap_hdr->nFilledLen)
+    {
+      /* Only the flags to carry; the header goes back straight away */
+      (void)zmq_msg_init (&msg);
+      if (OMX_ErrorNone != (rc = send_frame (ap_prc, &msg, flags, ap_sent))
+          || !*ap_sent)
+        {
+          (void)zmq_msg_close (&msg);
+          return rc;
+        }
+    }
+  else
+    {
+      if (!(p_msg = get_free_msg (ap_prc)))
+        {
+          /* Too many messages in flight already */
+          return OMX_ErrorNone;
+        }
+
+      if (0 != zmq_msg_init_data (&msg, ap_hdr->pBuffer + ap_hdr->nOffset,
+                                  ap_hdr->nFilledLen, msg_free, p_msg))
+        {
+          TIZ_ERROR (handleOf (ap_prc), "zmq_msg_init_data (%s)",
+                     zmq_strerror (errno));
+          (void)tiz_mutex_lock (&(ap_prc->p_msgs_->mutex));
+          p_msg->busy = false;
+          ap_prc->p_msgs_->nmsgs--;
+          (void)tiz_mutex_unlock (&(ap_prc->p_msgs_->mutex));
+          return OMX_ErrorInsufficientResources;
+        }
+
+      /* Set before sending, as the message may be freed straight away */
+      set_msg_header (ap_prc, p_msg, ap_hdr);
+      if (OMX_ErrorNone != (rc = send_frame (ap_prc, &msg, flags, ap_sent))
+          || !*ap_sent)
+        {
+          /* Keep the header, and let the free callback recycle the
+             message */
+          set_msg_header (ap_prc, p_msg, NULL);
+          (void)zmq_msg_close (&msg);
+          return rc;
+        }
+    }
+
+  if (eos)
+    {
+      /* Once the first part is in, the last one can't be refused */
+      bool sent = false;
+      if (0 != zmq_msg_init_size (&msg, sizeof(OMX_U32)))
+        {
+          return OMX_ErrorInsufficientResources;
+        }
+      memcpy (zmq_msg_data (&msg), &(ap_hdr->nFlags), sizeof(OMX_U32));
+      if (OMX_ErrorNone != (rc = send_frame (ap_prc, &msg, 0, &sent)) || !sent)
+        {
+          (void)zmq_msg_close (&msg);
+        }
+    }
+
+  return rc;
+}
+
+/* With a 'unix:<path>' content URI, the data goes to a shared memory ring
+   served by an inproc reader on that socket, possibly in another process.
+   Otherwise it is published on a zmq inproc endpoint, for the readers in
+   this process. */
+static OMX_ERRORTYPE obtain_uri (inprocrnd_prc_t *ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_PARAM_CONTENTURITYPE *p_uri = NULL;
+  const size_t uri_max = sizeof(((struct sockaddr_un *)0)->sun_path)
+                         + strlen (INPROCRND_SHM_URI_SCHEME);
+  const char *p_content = NULL;
+  assert (ap_prc);
+  assert (!ap_prc->p_sock_path_);
+  assert (!ap_prc->p_endpoint_);
+
+  tiz_check_null_ret_oom (
+      (p_uri = tiz_mem_calloc (1, sizeof(OMX_PARAM_CONTENTURITYPE) + uri_max)));
+  p_uri->nSize = sizeof(OMX_PARAM_CONTENTURITYPE) + uri_max;
+  p_uri->nVersion.nVersion = OMX_VERSION;
+
+  /* No URI simply means the default zmq endpoint */
+  if (OMX_ErrorNone
+      == tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)),
+                               handleOf (ap_prc), OMX_IndexParamContentURI,
+                               p_uri))
+    {
+      p_content = (const char *)p_uri->contentURI;
+    }
+
+  if (p_content && 0 == strncmp (p_content, INPROCRND_SHM_URI_SCHEME,
+                                 strlen (INPROCRND_SHM_URI_SCHEME)))
+    {
+      const char *p_path = p_content + strlen (INPROCRND_SHM_URI_SCHEME);
+      if (0 == strlen (p_path)
+          || strlen (p_path) >= sizeof(((struct sockaddr_un *)0)->sun_path))
+        {
+          TIZ_ERROR (handleOf (ap_prc), "Invalid socket path [%s]", p_path);
+          rc = OMX_ErrorContentURIError;
+        }
+      else if (!(ap_prc->p_sock_path_ = strdup (p_path)))
+        {
+          rc = OMX_ErrorInsufficientResources;
+        }
+    }
+  else
+    {
+      if (!p_content || 0 != strncmp (p_content, INPROCRND_ZMQ_URI_SCHEME,
+                                      strlen (INPROCRND_ZMQ_URI_SCHEME)))
+        {
+          p_content = INPROCRND_ZMQ_DEFAULT_ENDPOINT;
+        }
+      if (!(ap_prc->p_endpoint_ = strdup (p_content)))
+        {
+          rc = OMX_ErrorInsufficientResources;
+        }
+    }
+
+  tiz_mem_free (p_uri);
+  return rc;
+}
+
+static void close_attach_sock (inprocrnd_prc_t *ap_prc)
+{
+  assert (ap_prc);
+  tiz_srv_io_watcher_destroy (ap_prc, ap_prc->p_ev_attach_);
+  ap_prc->p_ev_attach_ = NULL;
+  if (ap_prc->attach_fd_ >= 0)
+    {
+      (void)close (ap_prc->attach_fd_);
+      ap_prc->attach_fd_ = -1;
+    }
+}
+
+/* Stop trying to attach, e.g. when the transfer stops */
+static void cancel_attach (inprocrnd_prc_t *ap_prc)
+{
+  assert (ap_prc);
+  close_attach_sock (ap_prc);
+  if (ap_prc->p_ev_retry_)
+    {
+      (void)tiz_srv_timer_watcher_stop (ap_prc, ap_prc->p_ev_retry_);
+    }
+}
+
+/* Connect to the reader without blocking the component's thread. The reader
+   replies with the ring's descriptors as soon as it accepts, and the socket
+   becomes readable. While the reader isn't listening (e.g. it is still
+   draining the previous stream), try again a bit later. */
+static OMX_ERRORTYPE start_attach (inprocrnd_prc_t *ap_prc)
+{
+  struct sockaddr_un addr;
+  assert (ap_prc);
+  assert (ap_prc->p_sock_path_);
+
+  if (ap_prc->p_ring_ || ap_prc->attach_fd_ >= 0)
+    {
+      /* Attached already, or waiting for the reader's reply */
+      return OMX_ErrorNone;
+    }
+
+  memset (&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy (addr.sun_path, ap_prc->p_sock_path_);
+
+  ap_prc->attach_fd_
+      = socket (AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (ap_prc->attach_fd_ < 0)
+    {
+      TIZ_ERROR (handleOf (ap_prc), "socket (%s)", strerror (errno));
+      return OMX_ErrorInsufficientResources;
+    }
+
+  if (0 != connect (ap_prc->attach_fd_, (struct sockaddr *)&addr,
+                    sizeof(addr)))
+    {
+      const int error = errno;
+      close_attach_sock (ap_prc);
+      if (ENOENT != error && ECONNREFUSED != error && EAGAIN != error)
+        {
+          TIZ_ERROR (handleOf (ap_prc), "Unable to connect to [%s] (%s)",
+                     ap_prc->p_sock_path_, strerror (error));
+          return OMX_ErrorInsufficientResources;
+        }
+      TIZ_DEBUG (handleOf (ap_prc), "Reader not listening on [%s] (%s)",
+                 ap_prc->p_sock_path_, strerror (error));
+      return tiz_srv_timer_watcher_start (ap_prc, ap_prc->p_ev_retry_,
+                                          INPROCRND_ATTACH_RETRY_S, 0);
+    }
+
+  tiz_check_omx (tiz_srv_io_watcher_init (ap_prc, &(ap_prc->p_ev_attach_),
+                                          ap_prc->attach_fd_, TIZ_EVENT_READ,
+                                          true));
+  return tiz_srv_io_watcher_start (ap_prc, ap_prc->p_ev_attach_);
+}
+
+/* The reader's reply has arrived */
+static OMX_ERRORTYPE finish_attach (inprocrnd_prc_t *ap_prc)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (ap_prc);
+  assert (!ap_prc->p_ring_);
+
+  rc = tiz_shm_ring_receive (&(ap_prc->p_ring_), ap_prc->attach_fd_);
+  close_attach_sock (ap_prc);
+
+  if (OMX_ErrorNone != rc)
+    {
+      /* E.g. the reader went away before replying */
+      return tiz_srv_timer_watcher_start (ap_prc, ap_prc->p_ev_retry_,
+                                          INPROCRND_ATTACH_RETRY_S, 0);
+    }
+
+  TIZ_NOTICE (handleOf (ap_prc), "Attached to a ring of [%u] bytes",
+              (unsigned int)tiz_shm_ring_capacity (ap_prc->p_ring_));
+  return tiz_srv_io_watcher_init (ap_prc, &(ap_prc->p_ev_space_),
+                                  tiz_shm_ring_space_fd (ap_prc->p_ring_),
+                                  TIZ_EVENT_READ, true);
+}
+
+static void stop_space_watcher (inprocrnd_prc_t *ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_ev_space_ && ap_prc->awaiting_space_ev_)
+    {
+      (void)tiz_srv_io_watcher_stop (ap_prc, ap_prc->p_ev_space_);
+    }
+  ap_prc->awaiting_space_ev_ = false;
+}
+
+/* A closed ring can't carry another stream; the next one attaches to a new
+   ring */
+static void detach_from_ring (inprocrnd_prc_t *ap_prc)
+{
+  assert (ap_prc);
+  stop_space_watcher (ap_prc);
+  tiz_srv_io_watcher_destroy (ap_prc, ap_prc->p_ev_space_);
+  ap_prc->p_ev_space_ = NULL;
+  tiz_shm_ring_destroy (ap_prc->p_ring_);
+  ap_prc->p_ring_ = NULL;
+}
+
+/* Copy the headers into the ring until it fills up; the reader's progress
+   then wakes us up through the 'space' descriptor */
+static OMX_ERRORTYPE write_to_ring (inprocrnd_prc_t *ap_prc)
+{
   OMX_BUFFERHEADERTYPE *p_hdr = NULL;
   assert (ap_prc);
+  assert (ap_prc->p_ring_);
 
-  while ((p_hdr = get_header (ap_prc)))
+  while (ready_to_process (ap_prc) && (p_hdr = get_header (ap_prc)))
     {
       if (p_hdr->nFilledLen > 0)
         {
-          const int bytes_to_write = 0;
-          p_hdr->nFilledLen -= bytes_to_write;
-          p_hdr->nOffset += bytes_to_write;
+          const size_t n = tiz_shm_ring_write (
+              ap_prc->p_ring_, p_hdr->pBuffer + p_hdr->nOffset,
+              p_hdr->nFilledLen);
+          p_hdr->nOffset += n;
+          p_hdr->nFilledLen -= n;
+        }
+
+      if (p_hdr->nFilledLen > 0)
+        {
+          if (!ap_prc->awaiting_space_ev_)
+            {
+              tiz_check_omx (
+                  tiz_srv_io_watcher_start (ap_prc, ap_prc->p_ev_space_));
+              ap_prc->awaiting_space_ev_ = true;
+            }
+          break;
         }
 
-      if (0 == p_hdr->nFilledLen)
+      ap_prc->p_inhdr_ = NULL;
+      if ((p_hdr->nFlags & OMX_BUFFERFLAG_EOS) != 0)
         {
-          rc = buffer_emptied (ap_prc);
-          p_hdr = NULL;
+          tiz_shm_ring_close (ap_prc->p_ring_);
+          detach_from_ring (ap_prc);
+          tiz_check_omx (release_header (ap_prc, p_hdr));
+          /* If the next stream has started arriving already */
+          return ready_to_process (ap_prc) ? start_attach (ap_prc)
+                                           : OMX_ErrorNone;
         }
+      tiz_check_omx (release_header (ap_prc, p_hdr));
     }
 
-  return rc;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE write_buffer (inprocrnd_prc_t *ap_prc)
+{
+  OMX_BUFFERHEADERTYPE *p_hdr = NULL;
+  assert (ap_prc);
+
+  if (ap_prc->p_sock_path_)
+    {
+      /* Without a ring (e.g. a new stream after EOS), the buffers wait
+         until the reader has handed one over */
+      return ap_prc->p_ring_ ? write_to_ring (ap_prc) : start_attach (ap_prc);
+    }
+
+  while ((p_hdr = get_header (ap_prc)))
+    {
+      if (p_hdr->nFilledLen > 0 || (p_hdr->nFlags & OMX_BUFFERFLAG_EOS) != 0)
+        {
+          bool sent = false;
+          tiz_check_omx (send_header (ap_prc, p_hdr, &sent));
+          if (!sent)
+            {
+              break;
+            }
+          if (0 == p_hdr->nFilledLen)
+            {
+              /* No data was shared, so it's done with already */
+              tiz_check_omx (release_header (ap_prc, p_hdr));
+            }
+        }
+      else
+        {
+          tiz_check_omx (release_header (ap_prc, p_hdr));
+        }
+      ap_prc->p_inhdr_ = NULL;
+    }
+
+  return OMX_ErrorNone;
+}
+
+static void msg_handler (OMX_PTR ap_prc, tiz_event_pluggable_t *ap_event)
+{
+  inprocrnd_prc_t *p_prc = ap_prc;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (p_prc);
+  assert (ap_event);
+
+  rc = release_returned_headers (p_prc);
+  if (OMX_ErrorNone == rc && ready_to_process (p_prc)
+      && ready_to_write_to_zmq_sock (p_prc))
+    {
+      rc = write_buffer (p_prc);
+    }
+  if (OMX_ErrorNone != rc)
+    {
+      tiz_srv_issue_err_event ((OMX_PTR)p_prc, rc);
+    }
+  tiz_mem_free (ap_event);
 }
 
 /*
@@ -198,15 +917,27 @@ static void *inprocrnd_prc_ctor (void *ap_prc, va_list *app)
   p_prc->port_disabled_ = false;
   p_prc->paused_ = false;
   p_prc->stopped_ = true;
+  p_prc->p_endpoint_ = NULL;
   p_prc->p_zmq_ctx_ = NULL;
   p_prc->p_zmq_sock_ = NULL;
   p_prc->zmq_fd_ = -1;
   p_prc->eos_ = false;
+  p_prc->p_sock_path_ = NULL;
+  p_prc->p_ring_ = NULL;
+  p_prc->p_ev_space_ = NULL;
+  p_prc->awaiting_space_ev_ = false;
+  p_prc->attach_fd_ = -1;
+  p_prc->p_ev_attach_ = NULL;
+  p_prc->p_ev_retry_ = NULL;
+  p_prc->p_msgs_ = NULL;
   return p_prc;
 }
 
 static void *inprocrnd_prc_dtor (void *ap_prc)
 {
+  inprocrnd_prc_t *p_prc = ap_prc;
+  assert (p_prc);
+  orphan_msgs (p_prc);
   return super_dtor (typeOf (ap_prc, "inprocrndprc"), ap_prc);
 }
 
@@ -218,48 +949,51 @@ static OMX_ERRORTYPE inprocrnd_prc_allocate_resources (void *ap_prc,
                                                        OMX_U32 a_pid)
 {
   inprocrnd_prc_t *p_prc = ap_prc;
-  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
-  int zmq_rc = 0;
   assert (p_prc);
 
-  /* Create the zmq context */
-  p_prc->p_zmq_ctx_ = zmq_ctx_new ();
-  goto_end_on_zmq_null_pointer (p_prc->p_zmq_ctx_, p_prc, zmq_strerror (errno));
-
-  /* No need for io threads (since inproc transport) */
-  zmq_ctx_set (p_prc->p_zmq_ctx_, ZMQ_IO_THREADS, 0);
-
-  /* Create the zmq PUB socket */
-  p_prc->p_zmq_sock_ = zmq_socket (p_prc->p_zmq_ctx_, ZMQ_PUB);
-  goto_end_on_zmq_null_pointer (p_prc->p_zmq_sock_, p_prc,
-                                zmq_strerror (errno));
-
-  /* Bind the socket to the inproc address */
-  zmq_rc = zmq_bind (p_prc->p_zmq_sock_, "inproc://broadcast");
-  goto_end_on_zmq_error (zmq_rc, p_prc, zmq_strerror (errno));
+  tiz_check_omx (obtain_uri (p_prc));
+  if (p_prc->p_sock_path_)
+    {
+      /* The ring is attached to when the transfer starts */
+      return tiz_srv_timer_watcher_init (p_prc, &(p_prc->p_ev_retry_));
+    }
 
-  /* All good */
-  rc = OMX_ErrorNone;
+  if (!p_prc->p_msgs_)
+    {
+      tiz_check_omx (create_msgs (p_prc));
+    }
 
-end:
+  /* Get hold of the zmq context shared with the readers */
+  p_prc->p_zmq_ctx_
+      = tiz_shared_acquire (INPROCRND_ZMQ_CTX_NAME, zmq_ctx_new, zmq_ctx_term);
+  if (!p_prc->p_zmq_ctx_)
+    {
+      TIZ_ERROR (handleOf (p_prc), "zmq_ctx_new (%s)", zmq_strerror (errno));
+      return OMX_ErrorInsufficientResources;
+    }
 
-  return rc;
+  return open_zmq_sock (p_prc);
 }
 
 static OMX_ERRORTYPE inprocrnd_prc_deallocate_resources (void *ap_prc)
 {
   inprocrnd_prc_t *p_prc = ap_prc;
   assert (p_prc);
-  if (p_prc->p_zmq_sock_)
-    {
-      zmq_close (p_prc->p_zmq_sock_);
-      p_prc->p_zmq_sock_ = NULL;
-    }
+  (void)wait_for_msgs (p_prc);
+  close_zmq_sock (p_prc);
   if (p_prc->p_zmq_ctx_)
     {
-      zmq_ctx_shutdown (p_prc->p_zmq_ctx_);
+      tiz_shared_release (INPROCRND_ZMQ_CTX_NAME);
       p_prc->p_zmq_ctx_ = NULL;
     }
+  free (p_prc->p_endpoint_);
+  p_prc->p_endpoint_ = NULL;
+  cancel_attach (p_prc);
+  tiz_srv_timer_watcher_destroy (p_prc, p_prc->p_ev_retry_);
+  p_prc->p_ev_retry_ = NULL;
+  detach_from_ring (p_prc);
+  free (p_prc->p_sock_path_);
+  p_prc->p_sock_path_ = NULL;
   return OMX_ErrorNone;
 }
 
@@ -267,33 +1001,45 @@ static OMX_ERRORTYPE inprocrnd_prc_prepare_to_transfer (void *ap_prc,
                                                         OMX_U32 a_pid)
 {
   inprocrnd_prc_t *p_prc = ap_prc;
-  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
-  int zmq_rc = 0;
-  size_t fd_len = 0;
   assert (p_prc);
 
-  fd_len = sizeof(p_prc->zmq_fd_);
-  zmq_rc
-      = zmq_getsockopt (p_prc->p_zmq_sock_, ZMQ_FD, &p_prc->zmq_fd_, &fd_len);
-  goto_end_on_zmq_error (zmq_rc, p_prc, zmq_strerror (errno));
-
-  /* All goood */
-  rc = OMX_ErrorNone;
+  if (p_prc->p_sock_path_)
+    {
+      p_prc->stopped_ = false;
+      return start_attach (p_prc);
+    }
 
-end:
+  if (!p_prc->p_zmq_sock_)
+    {
+      /* It was closed when the previous transfer stopped */
+      tiz_check_omx (open_zmq_sock (p_prc));
+    }
 
-  return rc;
+  p_prc->stopped_ = false;
+  return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE inprocrnd_prc_transfer_and_process (void *ap_prc,
                                                          OMX_U32 a_pid)
 {
+  inprocrnd_prc_t *p_prc = ap_prc;
+  assert (p_prc);
+  p_prc->stopped_ = false;
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE inprocrnd_prc_stop_and_return (void *ap_prc)
 {
-  return OMX_ErrorNone;
+  inprocrnd_prc_t *p_prc = ap_prc;
+  assert (p_prc);
+  p_prc->stopped_ = true;
+  p_prc->paused_ = false;
+  stop_space_watcher (p_prc);
+  if (p_prc->p_sock_path_)
+    {
+      cancel_attach (p_prc);
+    }
+  return wait_for_msgs (p_prc);
 }
 
 /*
@@ -307,13 +1053,36 @@ static OMX_ERRORTYPE inprocrnd_prc_io_ready (void *ap_prc,
   inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (p_prc);
-  if (ready_to_process (p_prc) && ready_to_write_to_zmq_sock (p_prc))
+  if (p_prc->p_sock_path_)
+    {
+      if (ap_ev_io == p_prc->p_ev_attach_)
+        {
+          rc = finish_attach (p_prc);
+        }
+      else
+        {
+          p_prc->awaiting_space_ev_ = false;
+        }
+      if (OMX_ErrorNone == rc && p_prc->p_ring_ && ready_to_process (p_prc))
+        {
+          rc = write_to_ring (p_prc);
+        }
+    }
+  else if (ready_to_process (p_prc) && ready_to_write_to_zmq_sock (p_prc))
     {
       rc = write_buffer (p_prc);
     }
   return rc;
 }
 
+static OMX_ERRORTYPE inprocrnd_prc_timer_ready (void *ap_prc,
+                                                tiz_event_timer_t *ap_ev_timer)
+{
+  inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
+  assert (p_prc);
+  return p_prc->stopped_ ? OMX_ErrorNone : start_attach (p_prc);
+}
+
 static OMX_ERRORTYPE inprocrnd_prc_buffers_ready (const void *ap_prc)
 {
   inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
@@ -326,6 +1095,48 @@ static OMX_ERRORTYPE inprocrnd_prc_buffers_ready (const void *ap_prc)
   return rc;
 }
 
+static OMX_ERRORTYPE inprocrnd_prc_pause (const void *ap_prc)
+{
+  inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
+  assert (p_prc);
+  p_prc->paused_ = true;
+  stop_space_watcher (p_prc);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE inprocrnd_prc_resume (const void *ap_prc)
+{
+  inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
+  assert (p_prc);
+  p_prc->paused_ = false;
+  return ready_to_process (p_prc) ? write_buffer (p_prc) : OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE inprocrnd_prc_port_flush (const void *ap_prc,
+                                               OMX_U32 a_pid)
+{
+  return wait_for_msgs ((inprocrnd_prc_t *)ap_prc);
+}
+
+static OMX_ERRORTYPE inprocrnd_prc_port_disable (const void *ap_prc,
+                                                 OMX_U32 a_pid)
+{
+  inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
+  assert (p_prc);
+  p_prc->port_disabled_ = true;
+  stop_space_watcher (p_prc);
+  return wait_for_msgs (p_prc);
+}
+
+static OMX_ERRORTYPE inprocrnd_prc_port_enable (const void *ap_prc,
+                                                OMX_U32 a_pid)
+{
+  inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
+  assert (p_prc);
+  p_prc->port_disabled_ = false;
+  return OMX_ErrorNone;
+}
+
 /*
  * inprocrnd_prc_class
  */
@@ -383,7 +1194,19 @@ void *inprocrnd_prc_init (void *ap_tos, void *ap_hdl)
        /* TIZ_CLASS_COMMENT: */
        tiz_srv_io_ready, inprocrnd_prc_io_ready,
        /* TIZ_CLASS_COMMENT: */
+       tiz_srv_timer_ready, inprocrnd_prc_timer_ready,
+       /* TIZ_CLASS_COMMENT: */
        tiz_prc_buffers_ready, inprocrnd_prc_buffers_ready,
+       /* TIZ_CLASS_COMMENT: */
+       tiz_prc_pause, inprocrnd_prc_pause,
+       /* TIZ_CLASS_COMMENT: */
+       tiz_prc_resume, inprocrnd_prc_resume,
+       /* TIZ_CLASS_COMMENT: */
+       tiz_prc_port_flush, inprocrnd_prc_port_flush,
+       /* TIZ_CLASS_COMMENT: */
+       tiz_prc_port_disable, inprocrnd_prc_port_disable,
+       /* TIZ_CLASS_COMMENT: */
+       tiz_prc_port_enable, inprocrnd_prc_port_enable,
        /* TIZ_CLASS_COMMENT: stop value */
        0);
 
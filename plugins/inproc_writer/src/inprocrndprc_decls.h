@@ -40,9 +40,37 @@ extern "C"
 
 #include <OMX_Core.h>
 
+#include <tizplatform.h>
 #include <tizprc_decls.h>
 
+#define INPROCRND_MAX_MSGS_IN_FLIGHT 16
+
   typedef struct inprocrnd_prc inprocrnd_prc_t;
+  typedef struct inprocrnd_msgs inprocrnd_msgs_t;
+
+  /* A header whose data is being carried by a zmq message */
+  typedef struct inprocrnd_msg inprocrnd_msg_t;
+  struct inprocrnd_msg
+  {
+    inprocrnd_msgs_t *p_msgs;
+    OMX_BUFFERHEADERTYPE *p_hdr;
+    bool busy;
+    bool returned;
+  };
+
+  /* The messages in flight. This is allocated on its own, as zmq may free a
+     message after the processor is gone; the last one out frees it. */
+  struct inprocrnd_msgs
+  {
+    inprocrnd_msg_t msgs[INPROCRND_MAX_MSGS_IN_FLIGHT];
+    /* The members below are protected by the mutex */
+    tiz_mutex_t mutex;
+    tiz_cond_t cond;
+    inprocrnd_prc_t *p_prc; /* NULL once the processor is gone */
+    OMX_U32 nmsgs;
+    bool notified;
+  };
+
   struct inprocrnd_prc
   {
     /* Object */
@@ -51,10 +79,19 @@ extern "C"
     bool port_disabled_;
     bool paused_;
     bool stopped_;
+    char * p_endpoint_;
     void * p_zmq_ctx_;
     void * p_zmq_sock_;
     int zmq_fd_;
     bool eos_;
+    char * p_sock_path_;
+    tiz_shm_ring_t * p_ring_;
+    tiz_event_io_t * p_ev_space_;
+    bool awaiting_space_ev_;
+    int attach_fd_;
+    tiz_event_io_t * p_ev_attach_;
+    tiz_event_timer_t * p_ev_retry_;
+    inprocrnd_msgs_t * p_msgs_;
   };
 
   typedef struct inprocrnd_prc_class inprocrnd_prc_class_t;
@@ -31,7 +31,6 @@
 #endif
 
 #include <assert.h>
-#include <limits.h>
 #include <string.h>
 
 #include <tizplatform.h>
@@ -56,6 +55,7 @@ reset_stream_parameters (mp3d_prc_t * ap_prc)
   tiz_mem_set (ap_prc->in_buff_, 0, INPUT_BUFFER_SIZE + MAD_BUFFER_GUARD);
   ap_prc->remaining_ = 0;
   ap_prc->frame_count_ = 0;
+  ap_prc->pcm_pos_ = 0;
   ap_prc->next_synth_sample_ = 0;
   ap_prc->eos_ = false;
 }
@@ -280,7 +280,7 @@ store_stream_metadata (mp3d_prc_t * ap_prc, struct mad_header * Header)
              Emphasis, Header->samplerate);
 }
 
-static signed short
+static inline signed short
 mad_fixed_to_sshort (mad_fixed_t fixed)
 {
   /* A fixed point number is formed of the following bit pattern:
@@ -303,21 +303,31 @@ mad_fixed_to_sshort (mad_fixed_t fixed)
    * algorithms.
    */
 
-  /* Clipping */
-  if (fixed >= MAD_F_ONE)
-    {
-      return (SHRT_MAX);
-    }
-
-  if (fixed <= -MAD_F_ONE)
-    {
-      return (-SHRT_MAX);
-    }
+  /* Clipping. Written as a min/max pair so that the conversion loop below
+   * has no branches and can be vectorised by the compiler. */
+  fixed = fixed > MAD_F_ONE - 1 ? MAD_F_ONE - 1 : fixed;
+  fixed = fixed < -MAD_F_ONE ? -MAD_F_ONE : fixed;
 
   /* Conversion. */
-  fixed = fixed >> (MAD_F_FRACBITS - 15);
+  return (signed short) (fixed >> (MAD_F_FRACBITS - 15));
+}
 
-  return (signed short) fixed;
+/* Converts a run of synthesized samples to interleaved 16-bit big endian
+ * stereo. For monophonic streams, ap_right is the left channel. */
+static void
+synth_to_s16be (const mad_fixed_t * ap_left, const mad_fixed_t * ap_right,
+                unsigned char * ap_out, const int a_nsamples)
+{
+  int i;
+  for (i = 0; i < a_nsamples; i++)
+    {
+      const signed short left = mad_fixed_to_sshort (ap_left[i]);
+      const signed short right = mad_fixed_to_sshort (ap_right[i]);
+      ap_out[4 * i] = (unsigned char) ((unsigned short) left >> 8);
+      ap_out[4 * i + 1] = (unsigned char) (left & 0xff);
+      ap_out[4 * i + 2] = (unsigned char) ((unsigned short) right >> 8);
+      ap_out[4 * i + 3] = (unsigned char) (right & 0xff);
+    }
 }
 
 static size_t
@@ -385,79 +395,65 @@ static int
 synthesize_samples (const void * ap_obj, int next_sample)
 {
   mp3d_prc_t * p_prc = (mp3d_prc_t *) ap_obj;
-  const unsigned char * p_bufend
-    = p_prc->p_outhdr_->pBuffer + p_prc->p_outhdr_->nAllocLen;
-  unsigned char * p_output
-    = p_prc->p_outhdr_->pBuffer + p_prc->p_outhdr_->nFilledLen;
-  bool buffer_full = (p_bufend == p_output);
-  int i;
+  OMX_BUFFERHEADERTYPE * p_hdr = p_prc->p_outhdr_;
+  const struct mad_pcm * p_pcm = &(p_prc->synth_.pcm);
+  const mad_fixed_t * p_right = NULL;
+  int avail = 0;
+  int nsamples = 0;
 
-  for (i = next_sample; i < p_prc->synth_.pcm.length && !buffer_full; i++)
-    {
-      signed short sample;
-
-      /* Left channel */
-      sample = mad_fixed_to_sshort (p_prc->synth_.pcm.samples[0][i]);
-      *(p_output++) = sample >> 8;
-      *(p_output++) = sample & 0xff;
+  assert (p_hdr);
 
-      /* Right channel. If the decoded stream is monophonic then
-       * the right output channel is the same as the left one.
+  if (0 == next_sample
+      && (p_prc->frame_.header.samplerate != p_prc->pcmmode_.nSamplingRate
+          || p_prc->pcmmode_.nChannels < 2))
+    {
+      /* We're outputting two channels, also for mono streams.
        */
-      if (MAD_NCHANNELS (&p_prc->frame_.header) == 2)
-        {
-          sample = mad_fixed_to_sshort (p_prc->synth_.pcm.samples[1][i]);
-        }
-      *(p_output++) = sample >> 8;
-      *(p_output++) = sample & 0xff;
+      const OMX_U32 nchannels = 2;
+      store_stream_metadata (p_prc, &(p_prc->frame_.header));
+      (void) update_pcm_mode (p_prc, p_pcm->samplerate, nchannels);
+    }
 
-      p_prc->p_outhdr_->nFilledLen += 4;
+  /* The whole run of samples that fits in the output buffer is converted in
+   * one go. The stream is always output as stereo; the right output channel
+   * of a monophonic stream is the same as the left one.
+   */
+  avail = (int) (p_hdr->nAllocLen - p_hdr->nFilledLen) / 4;
+  nsamples = MIN (p_pcm->length - next_sample, avail);
+  p_right = (MAD_NCHANNELS (&p_prc->frame_.header) == 2)
+              ? p_pcm->samples[1]
+              : p_pcm->samples[0];
 
-      if (p_prc->frame_.header.samplerate != p_prc->pcmmode_.nSamplingRate
-          || p_prc->pcmmode_.nChannels < 2)
-        {
-          /* We're outputting two channels, also for mono streams.
-           */
-          const OMX_U32 nchannels = 2;
-          TIZ_PRINTF_DBG_GRN ("samplerate [%d] NCHANNELS [%d] channels [%d].",
-                              p_prc->frame_.header.samplerate,
-                              MAD_NCHANNELS (&p_prc->frame_.header),
-                              p_prc->synth_.pcm.channels);
-          store_stream_metadata (p_prc, &(p_prc->frame_.header));
-          (void) update_pcm_mode (p_prc, p_prc->synth_.pcm.samplerate,
-                                  nchannels);
-        }
+  if (0 == p_hdr->nFilledLen && p_prc->pcmmode_.nSamplingRate > 0)
+    {
+      p_hdr->nTimeStamp
+        = (OMX_TICKS) (((p_prc->pcm_pos_ + next_sample) * 1000000)
+                       / p_prc->pcmmode_.nSamplingRate);
+    }
 
-      /* release the output buffer if it is full, or if we are at the early stages
-         of the decoding */
-      if (p_output == p_bufend)
-        {
-          p_output = p_prc->p_outhdr_->pBuffer;
-          p_prc->p_outhdr_->nFilledLen = p_prc->p_outhdr_->nAllocLen;
-          (void) release_headers (p_prc,
-                                  ARATELIA_MP3_DECODER_OUTPUT_PORT_INDEX);
-          buffer_full = true;
-        }
-      else if (p_prc->frame_count_ < 5
-               && p_prc->p_outhdr_->nFilledLen
-                    >= (int) (ARATELIA_MP3_DECODER_PORT_MIN_OUTPUT_BUF_SIZE
-                              * .2))
-        {
-          p_output = p_prc->p_outhdr_->pBuffer;
-          (void) release_headers (p_prc,
-                                  ARATELIA_MP3_DECODER_OUTPUT_PORT_INDEX);
-          buffer_full = true;
-        }
+  synth_to_s16be (p_pcm->samples[0] + next_sample, p_right + next_sample,
+                  p_hdr->pBuffer + p_hdr->nFilledLen, nsamples);
+  p_hdr->nFilledLen += nsamples * 4;
+  next_sample += nsamples;
+
+  /* release the output buffer if it is full, or if we are at the early stages
+     of the decoding */
+  if (p_hdr->nAllocLen - p_hdr->nFilledLen < 4
+      || (p_prc->frame_count_ < 5
+          && p_hdr->nFilledLen
+               >= (int) (ARATELIA_MP3_DECODER_PORT_MIN_OUTPUT_BUF_SIZE * .2)))
+    {
+      (void) release_headers (p_prc, ARATELIA_MP3_DECODER_OUTPUT_PORT_INDEX);
     }
 
   /* Return the sample index if there are more samples to process */
-  if (i < p_prc->synth_.pcm.length)
+  if (next_sample < p_pcm->length)
     {
-      return i;
+      return next_sample;
     }
 
-  /* Otherwise return 0 */
-
+  /* Otherwise the frame is complete and the next one starts at sample 0 */
+  p_prc->pcm_pos_ += p_pcm->length;
   return 0;
 }
 
@@ -497,6 +493,8 @@ decode_buffer (const void * ap_obj)
 
           if (p_obj->stream_.next_frame != NULL)
             {
+              /* Only the incomplete frame at the end of the bucket is moved
+               * to the front; everything before it has been decoded */
               p_obj->remaining_
                 = p_obj->stream_.bufend - p_obj->stream_.next_frame;
               memmove (p_obj->in_buff_, p_obj->stream_.next_frame,
@@ -708,6 +706,7 @@ mp3d_proc_ctor (void * ap_obj, va_list * app)
   mp3d_prc_t * p_obj = super_ctor (typeOf (ap_obj, "mp3dprc"), ap_obj, app);
   p_obj->remaining_ = 0;
   p_obj->frame_count_ = 0;
+  p_obj->pcm_pos_ = 0;
   p_obj->p_inhdr_ = 0;
   p_obj->p_outhdr_ = 0;
   p_obj->next_synth_sample_ = 0;
@@ -791,8 +790,9 @@ mp3d_proc_stop_and_return (void * ap_obj)
   assert (ap_obj);
   mad_timer_string (p_obj->timer_, buffer, "%lu:%02lu.%03u", MAD_UNITS_MINUTES,
                     MAD_UNITS_MILLISECONDS, 0);
-  TIZ_TRACE (handleOf (p_obj), "%lu frames decoded (%s)", p_obj->frame_count_,
-             buffer);
+  TIZ_TRACE (handleOf (p_obj),
+             "%lu frames decoded (%s) - %llu samples", p_obj->frame_count_,
+             buffer, (unsigned long long) p_obj->pcm_pos_);
   /* NOTE: de-init the decoder here, as there seems to be no obvious flush
      functionality that could be used instead */
   deinit_mad_decoder (ap_obj);
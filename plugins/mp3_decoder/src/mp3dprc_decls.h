@@ -55,6 +55,7 @@ struct mp3d_prc
   size_t remaining_;
   mad_timer_t timer_;
   unsigned long frame_count_;
+  OMX_U64 pcm_pos_;       /* samples synthesized before the current frame */
   unsigned char in_buff_[INPUT_BUFFER_SIZE + MAD_BUFFER_GUARD];
   OMX_BUFFERHEADERTYPE * p_inhdr_;
   OMX_BUFFERHEADERTYPE * p_outhdr_;
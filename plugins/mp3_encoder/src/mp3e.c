@@ -58,6 +58,10 @@
  * - Component name : "OMX.Aratelia.audio_encoder.mp3"
  * - Implements role: "audio_encoder.mp3"
  *
+ * Segments of the stream can optionally be encoded in parallel on a pool of
+ * worker threads, see 'OMX.Aratelia.audio_encoder.mp3.encoder_threads' in
+ * tizonia.conf.
+ *
  *@ingroup plugins
  */
 
@@ -49,6 +49,10 @@ extern "C" {
 #define ARATELIA_MP3_ENCODER_PORT_NONCONTIGUOUS OMX_FALSE
 #define ARATELIA_MP3_ENCODER_PORT_ALIGNMENT 0
 #define ARATELIA_MP3_ENCODER_PORT_SUPPLIERPREF OMX_BufferSupplyInput
+/* Parallel encoding: MP3 frames per segment (about 1.5 s at 44.1 kHz) and
+   upper limit on the number of encoder threads */
+#define ARATELIA_MP3_ENCODER_FRAMES_PER_SEGMENT 64
+#define ARATELIA_MP3_ENCODER_MAX_THREADS 16
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,249 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   mp3ebench.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - MP3 encoder throughput benchmark
+ *
+ * Encodes a synthetic stereo signal with a single LAME context, the way the
+ * component does on its own thread, and then with the segmented worker pool
+ * using an increasing number of threads. Throughput is reported in multiples
+ * of realtime. Not built by default; use 'make mp3ebench'.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <lame/lame.h>
+
+#include <tizplatform.h>
+
+#include "mp3e.h"
+#include "mp3epool.h"
+
+#define BENCH_RATE 44100
+#define BENCH_CHANNELS 2
+#define BENCH_BITRATE 192
+#define BENCH_QUALITY 2
+#define BENCH_SECONDS 120
+/* Same order of magnitude as the component's input buffers */
+#define BENCH_CHUNK_FRAMES 4800
+#define BENCH_OUT_LEN (1024 * 1024)
+
+static double
+now_s (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static short int *
+make_signal (const size_t a_nframes)
+{
+  short int * p_pcm
+    = malloc (a_nframes * BENCH_CHANNELS * sizeof (short int));
+  size_t i = 0;
+
+  if (!p_pcm)
+    {
+      return NULL;
+    }
+
+  srand (BENCH_RATE);
+  for (i = 0; i < a_nframes; ++i)
+    {
+      /* A few partials plus some noise, so that the psychoacoustic model
+       * has something to work on */
+      const double t = (double) i / BENCH_RATE;
+      const double tone = 0.3 * sin (2 * M_PI * 220 * t)
+                          + 0.2 * sin (2 * M_PI * 1375 * t)
+                          + 0.1 * sin (2 * M_PI * 5210 * t);
+      const double noise = ((rand () % 2001) - 1000) / 20000.0;
+      p_pcm[2 * i] = (short int) (32767 * (tone + noise));
+      p_pcm[2 * i + 1] = (short int) (32767 * (0.8 * tone - noise));
+    }
+
+  return p_pcm;
+}
+
+static double
+bench_serial (short int * ap_pcm, const size_t a_nframes, size_t * ap_bytes)
+{
+  unsigned char * p_out = malloc (BENCH_OUT_LEN);
+  lame_t lame = lame_init ();
+  double start = 0;
+  size_t offset = 0;
+  int rc = 0;
+
+  *ap_bytes = 0;
+  if (!p_out || !lame)
+    {
+      free (p_out);
+      return 0;
+    }
+
+  (void) lame_set_num_channels (lame, BENCH_CHANNELS);
+  (void) lame_set_in_samplerate (lame, BENCH_RATE);
+  (void) lame_set_brate (lame, BENCH_BITRATE);
+  (void) lame_set_mode (lame, JOINT_STEREO);
+  (void) lame_set_quality (lame, BENCH_QUALITY);
+  (void) lame_init_params (lame);
+
+  start = now_s ();
+  while (offset < a_nframes)
+    {
+      const size_t n = MIN (BENCH_CHUNK_FRAMES, a_nframes - offset);
+      rc = lame_encode_buffer_interleaved (lame, ap_pcm + offset * 2, n,
+                                           p_out, BENCH_OUT_LEN);
+      *ap_bytes += MAX (rc, 0);
+      offset += n;
+    }
+  rc = lame_encode_flush (lame, p_out, BENCH_OUT_LEN);
+  *ap_bytes += MAX (rc, 0);
+
+  lame_close (lame);
+  free (p_out);
+  return now_s () - start;
+}
+
+static void
+segment_encoded (void * ap_arg)
+{
+  (void) tiz_sem_post ((tiz_sem_t *) ap_arg);
+}
+
+static double
+bench_parallel (short int * ap_pcm, const size_t a_nframes,
+                const unsigned int a_nthreads, size_t * ap_bytes)
+{
+  const unsigned char * p_in = (const unsigned char *) ap_pcm;
+  const size_t in_len = a_nframes * BENCH_CHANNELS * sizeof (short int);
+  const size_t chunk_len = BENCH_CHUNK_FRAMES * BENCH_CHANNELS
+                           * sizeof (short int);
+  mp3e_pool_params_t params = {BENCH_CHANNELS, BENCH_RATE, BENCH_BITRATE,
+                               JOINT_STEREO, BENCH_QUALITY,
+                               ARATELIA_MP3_ENCODER_FRAMES_PER_SEGMENT};
+  unsigned char * p_out = malloc (BENCH_OUT_LEN);
+  mp3e_pool_t * p_pool = NULL;
+  tiz_sem_t sem;
+  double start = 0;
+  double elapsed = 0;
+  size_t offset = 0;
+
+  *ap_bytes = 0;
+  if (!p_out || OMX_ErrorNone != tiz_sem_init (&sem, 0))
+    {
+      free (p_out);
+      return 0;
+    }
+
+  if (OMX_ErrorNone
+        != mp3e_pool_init (&p_pool, a_nthreads, segment_encoded, &sem)
+      || OMX_ErrorNone != mp3e_pool_start (p_pool, &params))
+    {
+      mp3e_pool_destroy (p_pool);
+      (void) tiz_sem_destroy (&sem);
+      free (p_out);
+      return 0;
+    }
+
+  start = now_s ();
+  while (!mp3e_pool_finished (p_pool))
+    {
+      size_t consumed = 0;
+      size_t produced = 0;
+      if (offset < in_len)
+        {
+          consumed = mp3e_pool_write (p_pool, p_in + offset,
+                                      MIN (chunk_len, in_len - offset));
+          offset += consumed;
+          if (offset == in_len)
+            {
+              (void) mp3e_pool_drain (p_pool);
+            }
+        }
+      produced = mp3e_pool_read (p_pool, p_out, BENCH_OUT_LEN);
+      *ap_bytes += produced;
+      if (0 == consumed && 0 == produced && !mp3e_pool_finished (p_pool))
+        {
+          /* Every segment is busy; wait for a worker */
+          (void) tiz_sem_wait (&sem);
+        }
+    }
+  elapsed = now_s () - start;
+
+  mp3e_pool_destroy (p_pool);
+  (void) tiz_sem_destroy (&sem);
+  free (p_out);
+  return elapsed;
+}
+
+int
+main (void)
+{
+  const size_t nframes = (size_t) BENCH_SECONDS * BENCH_RATE;
+  const long ncpus = sysconf (_SC_NPROCESSORS_ONLN);
+  short int * p_pcm = make_signal (nframes);
+  unsigned int nthreads = 0;
+  size_t bytes = 0;
+  double serial = 0;
+  double elapsed = 0;
+
+  if (!p_pcm)
+    {
+      return EXIT_FAILURE;
+    }
+
+  printf ("%d s of %d Hz stereo at %d kbps, %d frames per segment\n",
+          BENCH_SECONDS, BENCH_RATE, BENCH_BITRATE,
+          ARATELIA_MP3_ENCODER_FRAMES_PER_SEGMENT);
+  printf ("%-10s %10s %12s %10s\n", "threads", "x realtime", "bytes",
+          "speedup");
+
+  serial = bench_serial (p_pcm, nframes, &bytes);
+  printf ("%-10s %10.1f %12zu %10.2f\n", "serial", BENCH_SECONDS / serial,
+          bytes, 1.0);
+
+  for (nthreads = 1;
+       nthreads <= (unsigned int) MIN (ncpus, ARATELIA_MP3_ENCODER_MAX_THREADS);
+       nthreads *= 2)
+    {
+      elapsed = bench_parallel (p_pcm, nframes, nthreads, &bytes);
+      if (elapsed <= 0)
+        {
+          fprintf (stderr, "Unable to run the encoder pool\n");
+          break;
+        }
+      printf ("%-10u %10.1f %12zu %10.2f\n", nthreads,
+              BENCH_SECONDS / elapsed, bytes, serial / elapsed);
+    }
+
+  free (p_pcm);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,780 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   mp3epool.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - MP3 encoder worker pool
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <lame/lame.h>
+
+#include <tizplatform.h>
+
+#include "mp3epool.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.mp3_encoder.pool"
+#endif
+
+/* Segments per worker; while a worker encodes one segment, the component
+ * thread can be filling the next one */
+#define MP3E_SEGMENTS_PER_WORKER 2
+/* Frames of the previous segment encoded (and then dropped) ahead of each
+ * segment. They absorb the encoder delay and warm up the psychoacoustic
+ * model. */
+#define MP3E_PREROLL_FRAMES 2
+/* Frames of the next segment encoded (and then dropped) after each segment,
+ * so that the last kept frames are not encoded against the flush padding */
+#define MP3E_LOOKAHEAD_FRAMES 2
+#define MP3E_MAX_CHANNELS 2
+/* Worst case output size, as documented in lame.h */
+#define MP3E_MAX_OUTPUT_LEN(nsamples) ((nsamples) * 5 / 4 + 7200)
+
+typedef enum mp3e_segment_state mp3e_segment_state_t;
+enum mp3e_segment_state
+{
+  ESegmentFree = 0, /* Owned by the component thread (possibly filling) */
+  ESegmentQueued,   /* Owned by the workers */
+  ESegmentDone      /* Encoded; owned by the component thread again */
+};
+
+typedef struct mp3e_segment mp3e_segment_t;
+struct mp3e_segment
+{
+  mp3e_segment_state_t state;
+  short int * p_pcm;
+  size_t nframes;     /* pcm frames, including preroll and lookahead */
+  size_t skip;        /* mp3 frames to drop at the start */
+  size_t keep;        /* mp3 frames to keep after those; 0 means all */
+  OMX_U8 * p_out;
+  size_t out_len;
+  size_t out_alloc;
+  size_t out_read;
+  bool failed;
+};
+
+typedef struct mp3e_worker mp3e_worker_t;
+struct mp3e_worker
+{
+  mp3e_pool_t * p_pool;
+  tiz_thread_t thread;
+  bool started;
+};
+
+struct mp3e_pool
+{
+  mp3e_pool_params_t params;
+  size_t framesize;  /* pcm frames per mp3 frame */
+  size_t body_len;   /* pcm frames kept per segment */
+  size_t preroll_len;
+  size_t overlap_len; /* preroll + lookahead */
+  size_t pcm_frame_len;
+  mp3e_worker_t * p_workers;
+  unsigned int nworkers;
+  mp3e_segment_t * p_segments;
+  unsigned int nsegments;
+  unsigned int head; /* next segment to be read */
+  unsigned int tail; /* segment being filled */
+  unsigned int nsubmitted;
+  /* Tail of the last submitted segment; the head of the next one */
+  short int * p_overlap;
+  bool have_overlap;
+  OMX_U8 carry[MP3E_MAX_CHANNELS * sizeof (short int)];
+  size_t carry_len;
+  bool drained;
+  bool last_submitted;
+  tiz_queue_t * p_queue;
+  tiz_mutex_t mutex;
+  tiz_cond_t cond;
+  mp3e_pool_notify_f pf_notify;
+  void * p_notify_arg;
+};
+
+static void
+lame_quiet (const char * format, va_list ap)
+{
+}
+
+/* Length of the MPEG audio layer III frame starting at ap_hdr, or zero if
+ * there isn't a valid frame header there */
+static size_t
+frame_length (const OMX_U8 * ap_hdr, size_t a_avail)
+{
+  static const OMX_U16 mpeg1_kbps[16]
+    = {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0};
+  static const OMX_U16 mpeg2_kbps[16]
+    = {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0};
+  static const OMX_U32 mpeg1_rates[3] = {44100, 48000, 32000};
+  unsigned int version = 0;
+  unsigned int kbps_idx = 0;
+  unsigned int rate_idx = 0;
+  unsigned int padding = 0;
+
+  if (a_avail < 4 || 0xFF != ap_hdr[0] || 0xE0 != (ap_hdr[1] & 0xE0))
+    {
+      return 0;
+    }
+
+  /* 0 = MPEG 2.5, 1 = reserved, 2 = MPEG 2, 3 = MPEG 1; layer 1 = III */
+  version = (ap_hdr[1] >> 3) & 0x03;
+  kbps_idx = ap_hdr[2] >> 4;
+  rate_idx = (ap_hdr[2] >> 2) & 0x03;
+  padding = (ap_hdr[2] >> 1) & 0x01;
+  if (1 == version || 1 != ((ap_hdr[1] >> 1) & 0x03) || 0 == kbps_idx
+      || 15 == kbps_idx || 3 == rate_idx)
+    {
+      return 0;
+    }
+
+  if (3 == version)
+    {
+      return 144000 * mpeg1_kbps[kbps_idx] / mpeg1_rates[rate_idx] + padding;
+    }
+  return 72000 * mpeg2_kbps[kbps_idx]
+           / (mpeg1_rates[rate_idx] >> (2 == version ? 1 : 2))
+         + padding;
+}
+
+/* Drop the frames that belong to the neighbouring segments */
+static bool
+splice_segment (mp3e_segment_t * ap_seg)
+{
+  size_t pos = 0;
+  size_t kept_start = 0;
+  size_t kept_len = 0;
+  size_t frame = 0;
+
+  while (pos < ap_seg->out_len)
+    {
+      const size_t len
+        = frame_length (ap_seg->p_out + pos, ap_seg->out_len - pos);
+      if (0 == len || pos + len > ap_seg->out_len)
+        {
+          return false;
+        }
+      if (frame == ap_seg->skip)
+        {
+          kept_start = pos;
+        }
+      if (frame >= ap_seg->skip
+          && (0 == ap_seg->keep || frame < ap_seg->skip + ap_seg->keep))
+        {
+          kept_len += len;
+        }
+      pos += len;
+      ++frame;
+    }
+
+  memmove (ap_seg->p_out, ap_seg->p_out + kept_start, kept_len);
+  ap_seg->out_len = kept_len;
+  return true;
+}
+
+static bool
+encode_segment (const mp3e_pool_t * ap_pool, mp3e_segment_t * ap_seg)
+{
+  const mp3e_pool_params_t * p_params = &(ap_pool->params);
+  lame_t lame = NULL;
+  int rc = 0;
+
+  if (NULL == (lame = lame_init ()))
+    {
+      return false;
+    }
+
+  (void) lame_set_errorf (lame, lame_quiet);
+  (void) lame_set_debugf (lame, lame_quiet);
+  (void) lame_set_msgf (lame, lame_quiet);
+  (void) lame_set_num_channels (lame, p_params->channels);
+  (void) lame_set_in_samplerate (lame, p_params->sample_rate);
+  /* No resampling, so that all segments share the same frame grid */
+  (void) lame_set_out_samplerate (lame, p_params->sample_rate);
+  (void) lame_set_brate (lame, p_params->bitrate);
+  (void) lame_set_mode (lame, p_params->mode);
+  (void) lame_set_quality (lame, p_params->quality);
+  /* Frames must not borrow bits from the segment before */
+  (void) lame_set_disable_reservoir (lame, 1);
+  (void) lame_set_bWriteVbrTag (lame, 0);
+
+  if (lame_init_params (lame) < 0)
+    {
+      lame_close (lame);
+      return false;
+    }
+
+  if (1 == p_params->channels)
+    {
+      rc = lame_encode_buffer (lame, ap_seg->p_pcm, ap_seg->p_pcm,
+                               ap_seg->nframes, ap_seg->p_out,
+                               ap_seg->out_alloc);
+    }
+  else
+    {
+      rc = lame_encode_buffer_interleaved (lame, ap_seg->p_pcm,
+                                           ap_seg->nframes, ap_seg->p_out,
+                                           ap_seg->out_alloc);
+    }
+
+  if (rc >= 0)
+    {
+      ap_seg->out_len = rc;
+      rc = lame_encode_flush (lame, ap_seg->p_out + ap_seg->out_len,
+                              ap_seg->out_alloc - ap_seg->out_len);
+      if (rc >= 0)
+        {
+          ap_seg->out_len += rc;
+        }
+    }
+
+  lame_close (lame);
+  return rc >= 0 && splice_segment (ap_seg);
+}
+
+static void *
+worker_thread_func (void * ap_arg)
+{
+  mp3e_worker_t * p_worker = ap_arg;
+  mp3e_pool_t * p_pool = NULL;
+
+  assert (p_worker);
+  p_pool = p_worker->p_pool;
+  assert (p_pool);
+
+  for (;;)
+    {
+      OMX_PTR p_item = NULL;
+      mp3e_segment_t * p_seg = NULL;
+      /* The pool itself is the termination request */
+      if (OMX_ErrorNone != tiz_queue_receive (p_pool->p_queue, &p_item)
+          || p_item == (OMX_PTR) p_pool)
+        {
+          break;
+        }
+      p_seg = p_item;
+
+      p_seg->out_len = 0;
+      p_seg->out_read = 0;
+      p_seg->failed = !encode_segment (p_pool, p_seg);
+      if (p_seg->failed)
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR,
+                   "Encoding of a segment of [%zu] pcm frames failed",
+                   p_seg->nframes);
+          /* Drop the whole segment, the decoder will resync on the next
+           * frame */
+          p_seg->out_len = 0;
+        }
+
+      (void) tiz_mutex_lock (&(p_pool->mutex));
+      p_seg->state = ESegmentDone;
+      (void) tiz_cond_broadcast (&(p_pool->cond));
+      (void) tiz_mutex_unlock (&(p_pool->mutex));
+
+      if (p_pool->pf_notify)
+        {
+          p_pool->pf_notify (p_pool->p_notify_arg);
+        }
+    }
+
+  return NULL;
+}
+
+static mp3e_segment_state_t
+segment_state (mp3e_pool_t * ap_pool, const mp3e_segment_t * ap_seg)
+{
+  mp3e_segment_state_t state = ESegmentFree;
+  (void) tiz_mutex_lock (&(ap_pool->mutex));
+  state = ap_seg->state;
+  (void) tiz_mutex_unlock (&(ap_pool->mutex));
+  return state;
+}
+
+static void
+free_segments (mp3e_pool_t * ap_pool)
+{
+  unsigned int i = 0;
+  assert (ap_pool);
+  for (i = 0; i < ap_pool->nsegments; ++i)
+    {
+      tiz_mem_free (ap_pool->p_segments[i].p_pcm);
+      ap_pool->p_segments[i].p_pcm = NULL;
+      tiz_mem_free (ap_pool->p_segments[i].p_out);
+      ap_pool->p_segments[i].p_out = NULL;
+      ap_pool->p_segments[i].out_alloc = 0;
+    }
+  tiz_mem_free (ap_pool->p_overlap);
+  ap_pool->p_overlap = NULL;
+}
+
+/* Number of pcm frames at which the segment being filled is complete */
+static size_t
+segment_target (const mp3e_pool_t * ap_pool)
+{
+  return (ap_pool->have_overlap ? ap_pool->preroll_len : 0)
+         + ap_pool->body_len + ap_pool->overlap_len - ap_pool->preroll_len;
+}
+
+/* Seed an empty segment with the tail of the previous one */
+static void
+start_segment (mp3e_pool_t * ap_pool, mp3e_segment_t * ap_seg)
+{
+  assert (ap_pool);
+  assert (ap_seg);
+  assert (0 == ap_seg->nframes);
+
+  if (ap_pool->have_overlap)
+    {
+      memcpy (ap_seg->p_pcm, ap_pool->p_overlap,
+              ap_pool->overlap_len * ap_pool->pcm_frame_len);
+      ap_seg->nframes = ap_pool->overlap_len;
+      ap_seg->skip = MP3E_PREROLL_FRAMES;
+    }
+  else
+    {
+      ap_seg->skip = 0;
+    }
+}
+
+static OMX_ERRORTYPE
+submit_segment (mp3e_pool_t * ap_pool, const bool a_last)
+{
+  mp3e_segment_t * p_seg = &(ap_pool->p_segments[ap_pool->tail]);
+  const size_t channels = ap_pool->params.channels;
+
+  assert (ESegmentFree == p_seg->state);
+  assert (p_seg->nframes > 0);
+
+  if (a_last)
+    {
+      p_seg->keep = 0;
+      ap_pool->last_submitted = true;
+    }
+  else
+    {
+      p_seg->keep = ap_pool->params.frames_per_segment;
+      memcpy (ap_pool->p_overlap,
+              p_seg->p_pcm + (p_seg->nframes - ap_pool->overlap_len) * channels,
+              ap_pool->overlap_len * ap_pool->pcm_frame_len);
+      ap_pool->have_overlap = true;
+    }
+
+  ap_pool->tail = (ap_pool->tail + 1) % ap_pool->nsegments;
+  ap_pool->nsubmitted++;
+
+  (void) tiz_mutex_lock (&(ap_pool->mutex));
+  p_seg->state = ESegmentQueued;
+  (void) tiz_mutex_unlock (&(ap_pool->mutex));
+
+  return tiz_queue_send (ap_pool->p_queue, p_seg);
+}
+
+/* Once the stream has been drained, submit whatever is left as soon as a
+ * segment is available */
+static OMX_ERRORTYPE
+submit_last_segment (mp3e_pool_t * ap_pool)
+{
+  mp3e_segment_t * p_seg = NULL;
+
+  assert (ap_pool);
+
+  if (!ap_pool->drained || ap_pool->last_submitted)
+    {
+      return OMX_ErrorNone;
+    }
+
+  p_seg = &(ap_pool->p_segments[ap_pool->tail]);
+  if (ESegmentFree != segment_state (ap_pool, p_seg))
+    {
+      return OMX_ErrorNone;
+    }
+
+  if (0 == p_seg->nframes)
+    {
+      start_segment (ap_pool, p_seg);
+    }
+
+  /* The lookahead of the previous segment has not been kept yet, so there
+   * is always something to encode after the first segment */
+  if (p_seg->nframes > (ap_pool->have_overlap ? ap_pool->preroll_len : 0))
+    {
+      return submit_segment (ap_pool, true);
+    }
+
+  ap_pool->last_submitted = true;
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE
+mp3e_pool_init (mp3e_pool_ptr_t * app_pool, unsigned int a_nworkers,
+                mp3e_pool_notify_f apf_notify, void * ap_arg)
+{
+  mp3e_pool_t * p_pool = NULL;
+  unsigned int i = 0;
+  char name[16];
+
+  assert (app_pool);
+  assert (a_nworkers > 0);
+
+  if (NULL == (p_pool = tiz_mem_calloc (1, sizeof (mp3e_pool_t))))
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+
+  p_pool->nworkers = a_nworkers;
+  p_pool->nsegments = a_nworkers * MP3E_SEGMENTS_PER_WORKER;
+  p_pool->pf_notify = apf_notify;
+  p_pool->p_notify_arg = ap_arg;
+
+  if (NULL
+        == (p_pool->p_workers
+            = tiz_mem_calloc (p_pool->nworkers, sizeof (mp3e_worker_t)))
+      || NULL
+           == (p_pool->p_segments
+               = tiz_mem_calloc (p_pool->nsegments, sizeof (mp3e_segment_t)))
+      || OMX_ErrorNone != tiz_mutex_init (&(p_pool->mutex))
+      || OMX_ErrorNone != tiz_cond_init (&(p_pool->cond))
+      /* Room for every segment plus one termination request per worker, so
+       * that sending never blocks */
+      || OMX_ErrorNone
+           != tiz_queue_init (&(p_pool->p_queue),
+                              p_pool->nsegments + p_pool->nworkers))
+    {
+      mp3e_pool_destroy (p_pool);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  for (i = 0; i < p_pool->nworkers; ++i)
+    {
+      mp3e_worker_t * p_worker = &(p_pool->p_workers[i]);
+      p_worker->p_pool = p_pool;
+      if (OMX_ErrorNone
+          != tiz_thread_create (&(p_worker->thread), 0, 0, worker_thread_func,
+                                p_worker))
+        {
+          mp3e_pool_destroy (p_pool);
+          return OMX_ErrorInsufficientResources;
+        }
+      p_worker->started = true;
+      (void) snprintf (name, sizeof (name), "tizmp3enc-%u", i);
+      (void) tiz_thread_setname (&(p_worker->thread), name);
+    }
+
+  *app_pool = p_pool;
+  return OMX_ErrorNone;
+}
+
+void
+mp3e_pool_destroy (mp3e_pool_t * ap_pool)
+{
+  unsigned int i = 0;
+
+  if (!ap_pool)
+    {
+      return;
+    }
+
+  if (ap_pool->p_workers)
+    {
+      for (i = 0; i < ap_pool->nworkers; ++i)
+        {
+          if (ap_pool->p_workers[i].started)
+            {
+              (void) tiz_queue_send (ap_pool->p_queue, ap_pool);
+            }
+        }
+      for (i = 0; i < ap_pool->nworkers; ++i)
+        {
+          mp3e_worker_t * p_worker = &(ap_pool->p_workers[i]);
+          if (p_worker->started)
+            {
+              void * p_result = NULL;
+              (void) tiz_thread_join (&(p_worker->thread), &p_result);
+            }
+        }
+      tiz_mem_free (ap_pool->p_workers);
+    }
+
+  if (ap_pool->p_segments)
+    {
+      free_segments (ap_pool);
+      tiz_mem_free (ap_pool->p_segments);
+    }
+
+  tiz_queue_destroy (ap_pool->p_queue);
+  (void) tiz_cond_destroy (&(ap_pool->cond));
+  (void) tiz_mutex_destroy (&(ap_pool->mutex));
+  tiz_mem_free (ap_pool);
+}
+
+OMX_ERRORTYPE
+mp3e_pool_start (mp3e_pool_t * ap_pool, const mp3e_pool_params_t * ap_params)
+{
+  unsigned int i = 0;
+  size_t capacity = 0;
+
+  assert (ap_pool);
+  assert (ap_params);
+
+  switch (ap_params->sample_rate)
+    {
+      case 8000:
+      case 11025:
+      case 12000:
+      case 16000:
+      case 22050:
+      case 24000:
+      case 32000:
+      case 44100:
+      case 48000:
+        break;
+      default:
+        return OMX_ErrorUnsupportedSetting;
+    };
+
+  if (ap_params->channels < 1 || ap_params->channels > MP3E_MAX_CHANNELS
+      || ap_params->frames_per_segment
+           < MP3E_PREROLL_FRAMES + MP3E_LOOKAHEAD_FRAMES)
+    {
+      return OMX_ErrorUnsupportedSetting;
+    }
+
+  mp3e_pool_reset (ap_pool);
+  free_segments (ap_pool);
+
+  ap_pool->params = *ap_params;
+  /* MPEG-1 frames carry two granules, MPEG-2 and 2.5 frames just one */
+  ap_pool->framesize = ap_params->sample_rate >= 32000 ? 1152 : 576;
+  ap_pool->body_len = ap_pool->framesize * ap_params->frames_per_segment;
+  ap_pool->preroll_len = ap_pool->framesize * MP3E_PREROLL_FRAMES;
+  ap_pool->overlap_len
+    = ap_pool->preroll_len + ap_pool->framesize * MP3E_LOOKAHEAD_FRAMES;
+  ap_pool->pcm_frame_len = ap_params->channels * sizeof (short int);
+  capacity = ap_pool->body_len + ap_pool->overlap_len;
+
+  if (NULL
+      == (ap_pool->p_overlap
+          = tiz_mem_alloc (ap_pool->overlap_len * ap_pool->pcm_frame_len)))
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+
+  for (i = 0; i < ap_pool->nsegments; ++i)
+    {
+      mp3e_segment_t * p_seg = &(ap_pool->p_segments[i]);
+      p_seg->out_alloc = MP3E_MAX_OUTPUT_LEN (capacity);
+      if (NULL
+            == (p_seg->p_pcm = tiz_mem_alloc (capacity * ap_pool->pcm_frame_len))
+          || NULL == (p_seg->p_out = tiz_mem_alloc (p_seg->out_alloc)))
+        {
+          free_segments (ap_pool);
+          return OMX_ErrorInsufficientResources;
+        }
+    }
+
+  return OMX_ErrorNone;
+}
+
+void
+mp3e_pool_reset (mp3e_pool_t * ap_pool)
+{
+  unsigned int i = 0;
+  bool busy = true;
+
+  assert (ap_pool);
+
+  (void) tiz_mutex_lock (&(ap_pool->mutex));
+  while (busy)
+    {
+      busy = false;
+      for (i = 0; i < ap_pool->nsegments; ++i)
+        {
+          if (ESegmentQueued == ap_pool->p_segments[i].state)
+            {
+              busy = true;
+              break;
+            }
+        }
+      if (busy)
+        {
+          (void) tiz_cond_wait (&(ap_pool->cond), &(ap_pool->mutex));
+        }
+    }
+  for (i = 0; i < ap_pool->nsegments; ++i)
+    {
+      mp3e_segment_t * p_seg = &(ap_pool->p_segments[i]);
+      p_seg->state = ESegmentFree;
+      p_seg->nframes = 0;
+      p_seg->out_len = 0;
+      p_seg->out_read = 0;
+    }
+  (void) tiz_mutex_unlock (&(ap_pool->mutex));
+
+  ap_pool->head = 0;
+  ap_pool->tail = 0;
+  ap_pool->nsubmitted = 0;
+  ap_pool->have_overlap = false;
+  ap_pool->carry_len = 0;
+  ap_pool->drained = false;
+  ap_pool->last_submitted = false;
+}
+
+size_t
+mp3e_pool_write (mp3e_pool_t * ap_pool, const OMX_U8 * ap_pcm,
+                 size_t a_nbytes)
+{
+  const size_t frame_len = ap_pool->pcm_frame_len;
+  size_t consumed = 0;
+
+  assert (ap_pool);
+  assert (ap_pcm);
+  assert (!ap_pool->drained);
+
+  while (consumed < a_nbytes)
+    {
+      mp3e_segment_t * p_seg = &(ap_pool->p_segments[ap_pool->tail]);
+      const size_t target = segment_target (ap_pool);
+      OMX_U8 * p_dst = NULL;
+      size_t nframes = 0;
+
+      if (ESegmentFree != segment_state (ap_pool, p_seg))
+        {
+          /* All segments are busy */
+          break;
+        }
+
+      if (0 == p_seg->nframes)
+        {
+          start_segment (ap_pool, p_seg);
+        }
+
+      p_dst = (OMX_U8 *) p_seg->p_pcm + p_seg->nframes * frame_len;
+      if (ap_pool->carry_len > 0 || a_nbytes - consumed < frame_len)
+        {
+          /* A pcm frame straddles two buffers */
+          const size_t n
+            = MIN (frame_len - ap_pool->carry_len, a_nbytes - consumed);
+          memcpy (ap_pool->carry + ap_pool->carry_len, ap_pcm + consumed, n);
+          ap_pool->carry_len += n;
+          consumed += n;
+          if (ap_pool->carry_len < frame_len)
+            {
+              break;
+            }
+          memcpy (p_dst, ap_pool->carry, frame_len);
+          ap_pool->carry_len = 0;
+          nframes = 1;
+        }
+      else
+        {
+          nframes = MIN ((a_nbytes - consumed) / frame_len,
+                         target - p_seg->nframes);
+          memcpy (p_dst, ap_pcm + consumed, nframes * frame_len);
+          consumed += nframes * frame_len;
+        }
+
+      p_seg->nframes += nframes;
+      if (p_seg->nframes == target)
+        {
+          (void) submit_segment (ap_pool, false);
+        }
+    }
+
+  return consumed;
+}
+
+OMX_ERRORTYPE
+mp3e_pool_drain (mp3e_pool_t * ap_pool)
+{
+  assert (ap_pool);
+
+  if (ap_pool->drained)
+    {
+      return OMX_ErrorNone;
+    }
+
+  ap_pool->drained = true;
+  return submit_last_segment (ap_pool);
+}
+
+size_t
+mp3e_pool_read (mp3e_pool_t * ap_pool, OMX_U8 * ap_dst, size_t a_nbytes)
+{
+  size_t copied = 0;
+
+  assert (ap_pool);
+  assert (ap_dst);
+
+  while (copied < a_nbytes && ap_pool->nsubmitted > 0)
+    {
+      mp3e_segment_t * p_seg = &(ap_pool->p_segments[ap_pool->head]);
+      size_t n = 0;
+
+      if (ESegmentDone != segment_state (ap_pool, p_seg))
+        {
+          /* Keep the output in order */
+          break;
+        }
+
+      n = MIN (p_seg->out_len - p_seg->out_read, a_nbytes - copied);
+      memcpy (ap_dst + copied, p_seg->p_out + p_seg->out_read, n);
+      p_seg->out_read += n;
+      copied += n;
+
+      if (p_seg->out_read == p_seg->out_len)
+        {
+          (void) tiz_mutex_lock (&(ap_pool->mutex));
+          p_seg->state = ESegmentFree;
+          (void) tiz_mutex_unlock (&(ap_pool->mutex));
+          p_seg->nframes = 0;
+          ap_pool->head = (ap_pool->head + 1) % ap_pool->nsegments;
+          ap_pool->nsubmitted--;
+          (void) submit_last_segment (ap_pool);
+        }
+    }
+
+  return copied;
+}
+
+bool
+mp3e_pool_finished (const mp3e_pool_t * ap_pool)
+{
+  assert (ap_pool);
+  return ap_pool->drained && ap_pool->last_submitted
+         && 0 == ap_pool->nsubmitted;
+}
+
+unsigned int
+mp3e_pool_workers (const mp3e_pool_t * ap_pool)
+{
+  assert (ap_pool);
+  return ap_pool->nworkers;
+}
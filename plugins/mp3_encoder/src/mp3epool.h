@@ -0,0 +1,109 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   mp3epool.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - MP3 encoder worker pool
+ *
+ * The PCM stream is cut into segments of a whole number of MP3 frames and
+ * each segment is encoded by its own LAME context on a worker thread. The
+ * bit reservoir is disabled, so that every frame is self-contained and any
+ * frame boundary is a valid splice point. Each segment is encoded with a
+ * few frames of the neighbouring segments on either side, so that the
+ * encoder delay and the flush padding fall outside the frames that are
+ * kept. The kept frames line up with the frame grid of a serial encode and
+ * are emitted strictly in input order.
+ */
+
+#ifndef MP3EPOOL_H
+#define MP3EPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+typedef struct mp3e_pool mp3e_pool_t;
+typedef /*@null@ */ mp3e_pool_t * mp3e_pool_ptr_t;
+
+/* Invoked from a worker thread whenever a segment has been encoded */
+typedef void (*mp3e_pool_notify_f) (void * ap_arg);
+
+typedef struct mp3e_pool_params mp3e_pool_params_t;
+struct mp3e_pool_params
+{
+  unsigned int channels;    /* input channels, 16-bit interleaved */
+  unsigned int sample_rate; /* must be an MPEG sample rate */
+  unsigned int bitrate;     /* kbps */
+  int mode;                 /* lame MPEG_mode */
+  int quality;              /* lame quality, 0 (best) - 9 */
+  unsigned int frames_per_segment;
+};
+
+OMX_ERRORTYPE
+mp3e_pool_init (mp3e_pool_ptr_t * app_pool, unsigned int a_nworkers,
+                mp3e_pool_notify_f apf_notify, void * ap_arg);
+
+void
+mp3e_pool_destroy (mp3e_pool_t * ap_pool);
+
+/* Configure a new stream. Any data from a previous stream is discarded. */
+OMX_ERRORTYPE
+mp3e_pool_start (mp3e_pool_t * ap_pool, const mp3e_pool_params_t * ap_params);
+
+/* Discard all pending input and output. Blocks until in-flight segments have
+ * been encoded. */
+void
+mp3e_pool_reset (mp3e_pool_t * ap_pool);
+
+/* Copy interleaved 16-bit PCM into the pool. Returns the number of bytes
+ * consumed, which is less than a_nbytes when all segments are busy. */
+size_t
+mp3e_pool_write (mp3e_pool_t * ap_pool, const OMX_U8 * ap_pcm,
+                 size_t a_nbytes);
+
+/* Submit the last, possibly partial, segment of the stream. */
+OMX_ERRORTYPE
+mp3e_pool_drain (mp3e_pool_t * ap_pool);
+
+/* Copy encoded data, in stream order, into ap_dst. Returns the number of
+ * bytes copied; zero if the next segment is not ready yet. */
+size_t
+mp3e_pool_read (mp3e_pool_t * ap_pool, OMX_U8 * ap_dst, size_t a_nbytes);
+
+/* True once the stream has been drained and all of it has been read. */
+bool
+mp3e_pool_finished (const mp3e_pool_t * ap_pool);
+
+/* Number of worker threads */
+unsigned int
+mp3e_pool_workers (const mp3e_pool_t * ap_pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MP3EPOOL_H */
@@ -32,11 +32,14 @@
 
 #include <assert.h>
 #include <limits.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <tizplatform.h>
 
 #include <tizkernel.h>
+#include <tizscheduler.h>
 
 #include "mp3e.h"
 #include "mp3eprc.h"
@@ -49,6 +52,9 @@
 
 #define TIZ_LAME_MP3_ENC_MIN_BUFFER_SIZE 7200
 
+static OMX_ERRORTYPE
+mp3e_proc_buffers_ready (const void * ap_obj);
+
 static OMX_ERRORTYPE
 release_buffers (const void * ap_obj)
 {
@@ -242,6 +248,212 @@ claim_output (const void * ap_obj)
   return rc;
 }
 
+static unsigned int
+get_num_threads (mp3e_prc_t * ap_prc)
+{
+  const char * p_threads = tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION,
+    "OMX.Aratelia.audio_encoder.mp3.encoder_threads");
+  long nthreads = p_threads ? strtol (p_threads, NULL, 10) : 1;
+
+  if (0 == nthreads)
+    {
+      /* Use one thread per online CPU */
+      nthreads = sysconf (_SC_NPROCESSORS_ONLN);
+    }
+
+  nthreads = MAX (1, MIN (nthreads, ARATELIA_MP3_ENCODER_MAX_THREADS));
+  TIZ_TRACE (handleOf (ap_prc), "Using [%ld] encoder threads", nthreads);
+  return (unsigned int) nthreads;
+}
+
+static void
+segment_encoded_handler (OMX_PTR ap_prc, tiz_event_pluggable_t * ap_event)
+{
+  mp3e_prc_t * p_prc = ap_prc;
+  assert (p_prc);
+  assert (ap_event);
+
+  if (!p_prc->stopped_)
+    {
+      (void) mp3e_proc_buffers_ready (p_prc);
+    }
+  tiz_mem_free (ap_event);
+}
+
+/**
+ * Called by the encoder pool when a segment is ready.
+ *
+ * @note This function is called from a worker thread!
+ */
+static void
+segment_encoded (void * ap_arg)
+{
+  mp3e_prc_t * p_prc = ap_arg;
+  tiz_event_pluggable_t * p_event = NULL;
+  assert (p_prc);
+
+  p_event = tiz_mem_calloc (1, sizeof (tiz_event_pluggable_t));
+  if (p_event)
+    {
+      p_event->p_servant = p_prc;
+      p_event->p_data = NULL;
+      p_event->pf_hdlr = segment_encoded_handler;
+      tiz_comp_event_pluggable (handleOf (p_prc), p_event);
+    }
+}
+
+static void
+reset_pool (mp3e_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->parallel_)
+    {
+      ap_prc->eos_ = false;
+      mp3e_pool_reset (ap_prc->p_pool_);
+    }
+}
+
+static OMX_ERRORTYPE
+release_output (mp3e_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  assert (ap_prc->p_outhdr_);
+  ap_prc->p_outhdr_->nOffset = 0;
+  tiz_check_omx (tiz_krn_release_buffer (
+    tiz_get_krn (handleOf (ap_prc)), ARATELIA_MP3_ENCODER_OUTPUT_PORT_INDEX,
+    ap_prc->p_outhdr_));
+  ap_prc->p_outhdr_ = NULL;
+  return OMX_ErrorNone;
+}
+
+/* Hand PCM data over to the encoder pool. Returns true if any progress was
+ * made. */
+static bool
+feed_pool (mp3e_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_in = NULL;
+  size_t consumed = 0;
+
+  assert (ap_prc);
+
+  if (ap_prc->eos_ || (!ap_prc->p_inhdr_ && !claim_input (ap_prc)))
+    {
+      return false;
+    }
+
+  p_in = ap_prc->p_inhdr_;
+  if (p_in->nFilledLen > 0)
+    {
+      consumed = mp3e_pool_write (
+        ap_prc->p_pool_, p_in->pBuffer + p_in->nOffset, p_in->nFilledLen);
+      p_in->nOffset += consumed;
+      p_in->nFilledLen -= consumed;
+    }
+
+  if (0 == p_in->nFilledLen)
+    {
+      if (p_in->nFlags & OMX_BUFFERFLAG_EOS)
+        {
+          TIZ_TRACE (handleOf (ap_prc), "EOS received on INPUT HEADER [%p]",
+                     p_in);
+          ap_prc->eos_ = true;
+          (void) mp3e_pool_drain (ap_prc->p_pool_);
+        }
+      p_in->nOffset = 0;
+      (void) tiz_krn_release_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                     ARATELIA_MP3_ENCODER_INPUT_PORT_INDEX,
+                                     p_in);
+      ap_prc->p_inhdr_ = NULL;
+      return true;
+    }
+
+  return consumed > 0;
+}
+
+/* Collect encoded frames, in stream order. Returns true if any progress was
+ * made. */
+static bool
+collect_pool (mp3e_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_out = NULL;
+  size_t produced = 0;
+
+  assert (ap_prc);
+
+  if (!ap_prc->p_outhdr_ && !claim_output (ap_prc))
+    {
+      return false;
+    }
+
+  p_out = ap_prc->p_outhdr_;
+  produced = mp3e_pool_read (ap_prc->p_pool_,
+                             p_out->pBuffer + p_out->nFilledLen,
+                             p_out->nAllocLen - p_out->nFilledLen);
+  p_out->nFilledLen += produced;
+
+  if (mp3e_pool_finished (ap_prc->p_pool_))
+    {
+      /* All the input has been encoded and read out; propagate EOS */
+      TIZ_TRACE (handleOf (ap_prc), "Propagating EOS on OUTPUT HEADER [%p]",
+                 p_out);
+      p_out->nFlags |= OMX_BUFFERFLAG_EOS;
+      (void) release_output (ap_prc);
+      reset_pool (ap_prc);
+      return false;
+    }
+
+  /* Pass the buffer on when it is full, or when nothing else is ready, so
+   * that downstream gets data as soon as a segment completes */
+  if (p_out->nFilledLen == p_out->nAllocLen
+      || (0 == produced && p_out->nFilledLen > 0))
+    {
+      (void) release_output (ap_prc);
+    }
+
+  return produced > 0;
+}
+
+static OMX_ERRORTYPE
+start_pool (mp3e_prc_t * ap_prc)
+{
+  mp3e_pool_params_t params;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (ap_prc);
+  assert (ap_prc->lame_);
+
+  ap_prc->parallel_ = false;
+  if (!ap_prc->p_pool_)
+    {
+      return OMX_ErrorNone;
+    }
+
+  params.channels = ap_prc->pcmmode_.nChannels;
+  params.sample_rate = ap_prc->pcmmode_.nSamplingRate;
+  params.bitrate = lame_get_brate (ap_prc->lame_);
+  params.mode = lame_get_mode (ap_prc->lame_);
+  params.quality = lame_get_quality (ap_prc->lame_);
+  params.frames_per_segment = ARATELIA_MP3_ENCODER_FRAMES_PER_SEGMENT;
+
+  rc = 16 == ap_prc->pcmmode_.nBitPerSample
+         ? mp3e_pool_start (ap_prc->p_pool_, &params)
+         : OMX_ErrorUnsupportedSetting;
+  if (OMX_ErrorNone != rc)
+    {
+      /* Not fatal; the stream is encoded on the component thread instead */
+      TIZ_WARN (handleOf (ap_prc),
+                "[%s] : Parallel encoding not possible with these settings",
+                tiz_err_to_str (rc));
+      return OMX_ErrorInsufficientResources == rc ? rc : OMX_ErrorNone;
+    }
+
+  TIZ_TRACE (handleOf (ap_prc), "Encoding on [%u] threads",
+             mp3e_pool_workers (ap_prc->p_pool_));
+  ap_prc->parallel_ = true;
+  return OMX_ErrorNone;
+}
+
 static OMX_ERRORTYPE
 set_lame_pcm_settings (void * ap_obj, OMX_HANDLETYPE ap_hdl, void * ap_krn)
 {
@@ -367,6 +579,9 @@ mp3e_proc_ctor (void * ap_obj, va_list * app)
   p_prc->p_outhdr_ = 0;
   p_prc->eos_ = false;
   p_prc->lame_flushed_ = true;
+  p_prc->p_pool_ = NULL;
+  p_prc->parallel_ = false;
+  p_prc->stopped_ = true;
   return p_prc;
 }
 
@@ -382,6 +597,9 @@ mp3e_proc_dtor (void * ap_obj)
       p_prc->lame_ = NULL;
     }
 
+  mp3e_pool_destroy (p_prc->p_pool_);
+  p_prc->p_pool_ = NULL;
+
   return super_dtor (typeOf (ap_obj, "mp3eprc"), ap_obj);
 }
 
@@ -393,6 +611,7 @@ static OMX_ERRORTYPE
 mp3e_proc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
 {
   mp3e_prc_t * p_prc = ap_obj;
+  unsigned int nthreads = 0;
   assert (p_prc);
 
   if (NULL == (p_prc->lame_ = lame_init ()))
@@ -410,6 +629,19 @@ mp3e_proc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
   (void) lame_set_debugf (p_prc->lame_, lame_debugf);
   (void) lame_set_msgf (p_prc->lame_, lame_debugf);
 
+  /* Segmented encoding is opt-in, as it turns off the bit reservoir */
+  nthreads = get_num_threads (p_prc);
+  if (nthreads > 1
+      && OMX_ErrorNone
+           != mp3e_pool_init (&(p_prc->p_pool_), nthreads, segment_encoded,
+                              p_prc))
+    {
+      TIZ_ERROR (handleOf (p_prc),
+                 "[OMX_ErrorInsufficientResources] : "
+                 "Unable to create the encoder threads");
+      return OMX_ErrorInsufficientResources;
+    }
+
   return OMX_ErrorNone;
 }
 
@@ -425,6 +657,10 @@ mp3e_proc_deallocate_resources (void * ap_obj)
       p_prc->lame_ = NULL;
     }
 
+  mp3e_pool_destroy (p_prc->p_pool_);
+  p_prc->p_pool_ = NULL;
+  p_prc->parallel_ = false;
+
   return OMX_ErrorNone;
 }
 
@@ -464,19 +700,27 @@ mp3e_proc_prepare_to_transfer (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
     }
 
   p_prc->lame_flushed_ = false;
+  p_prc->eos_ = false;
 
-  return OMX_ErrorNone;
+  return start_pool (p_prc);
 }
 
 static OMX_ERRORTYPE
 mp3e_proc_transfer_and_process (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
 {
+  mp3e_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  p_prc->stopped_ = false;
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
 mp3e_proc_stop_and_return (void * ap_obj)
 {
+  mp3e_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  p_prc->stopped_ = true;
+  reset_pool (p_prc);
   return release_buffers (ap_obj);
 }
 
@@ -490,6 +734,19 @@ mp3e_proc_buffers_ready (const void * ap_obj)
   mp3e_prc_t * p_prc = (mp3e_prc_t *) ap_obj;
   assert (p_prc);
 
+  if (p_prc->parallel_)
+    {
+      bool progress = true;
+      while (progress && !p_prc->stopped_)
+        {
+          /* Both calls are made on every iteration: input keeps the workers
+           * busy while output drains the segments they have finished */
+          progress = feed_pool (p_prc);
+          progress |= collect_pool (p_prc);
+        }
+      return OMX_ErrorNone;
+    }
+
   while (1)
     {
 
@@ -539,6 +796,8 @@ mp3e_proc_buffers_ready (const void * ap_obj)
 static OMX_ERRORTYPE
 mp3e_proc_port_flush (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
 {
+  /* Whatever is in flight belongs to the stream being flushed */
+  reset_pool ((mp3e_prc_t *) ap_obj);
   /* Release all buffers, regardless of the port this is received on */
   return release_buffers (ap_obj);
 }
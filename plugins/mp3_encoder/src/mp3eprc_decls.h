@@ -33,6 +33,7 @@
 extern "C" {
 #endif
 
+#include "mp3epool.h"
 #include "mp3eprc.h"
 #include "tizprc_decls.h"
 
@@ -57,6 +58,10 @@ struct mp3e_prc
   OMX_BUFFERHEADERTYPE * p_outhdr_;
   bool eos_;
   bool lame_flushed_;
+  /* Only created when more than one encoder thread is configured */
+  mp3e_pool_t * p_pool_;
+  bool parallel_;
+  bool stopped_;
 };
 
 typedef struct mp3e_prc_class mp3e_prc_class_t;
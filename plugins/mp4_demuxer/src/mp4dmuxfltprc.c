@@ -137,6 +137,16 @@ mp4_log_cback (MP4LogLevel loglevel, const char * fmt, va_list ap)
     };
 }
 
+/* The input is spilled to an unlinked temporary file rather than kept in
+   memory, as mp4v2 may need to seek anywhere in the stream (e.g. to reach a
+   'moov' atom stored after the media data). */
+static inline off_t
+spill_available (const mp4dmuxflt_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  return ap_prc->spill_len_ - ap_prc->spill_pos_;
+}
+
 static void *
 mp4_open_cback (const char * name, MP4FileMode mode)
 {
@@ -151,7 +161,11 @@ mp4_seek_cback (void * ap_handle, int64_t pos)
   assert (gp_prc == ap_handle);
   assert (p_prc);
   TIZ_TRACE(handleOf(gp_prc), "pos [%lld]", pos);
-  (void)tiz_buffer_seek (p_prc->p_mp4_store_, pos, TIZ_BUFFER_SEEK_SET);
+  if (pos < 0 || pos > p_prc->spill_len_)
+    {
+      return 1;
+    }
+  p_prc->spill_pos_ = pos;
   return 0;
 }
 
@@ -169,8 +183,7 @@ mp4_read_cback (void * ap_handle, void * ap_buffer, int64_t a_size,
 
   *ap_nin = 0;
 
-  if (tiz_filter_prc_is_eos (p_prc)
-      && tiz_buffer_available (p_prc->p_mp4_store_) == 0)
+  if (tiz_filter_prc_is_eos (p_prc) && spill_available (p_prc) == 0)
     {
       TIZ_DEBUG (handleOf (p_prc), "out of compressed data");
       return 1;
@@ -180,10 +193,11 @@ mp4_read_cback (void * ap_handle, void * ap_buffer, int64_t a_size,
 
   if (ap_buffer && a_size > 0)
     {
-      if (tiz_buffer_available (p_prc->p_mp4_store_) >= a_size)
+      if (spill_available (p_prc) >= a_size
+          && pread (p_prc->tmp_fd_1_, ap_buffer, a_size, p_prc->spill_pos_)
+               == a_size)
         {
-          memcpy (ap_buffer, tiz_buffer_get (p_prc->p_mp4_store_), a_size);
-          tiz_buffer_advance (p_prc->p_mp4_store_, a_size);
+          p_prc->spill_pos_ += a_size;
           *ap_nin = a_size;
           retval = 0;
         }
@@ -229,8 +243,7 @@ propagate_eos_if_required (mp4dmuxflt_prc_t * ap_prc,
   assert (ap_out_hdr);
 
   /* If EOS, propagate the flag to the next component */
-  if (tiz_filter_prc_is_eos (ap_prc)
-      && tiz_buffer_available (ap_prc->p_mp4_store_) == 0)
+  if (tiz_filter_prc_is_eos (ap_prc) && spill_available (ap_prc) == 0)
     {
       ap_out_hdr->nFlags |= OMX_BUFFERFLAG_EOS;
       tiz_filter_prc_update_eos_flag (ap_prc, false);
@@ -464,7 +477,7 @@ get_temp_file(mp4dmuxflt_prc_t * ap_prc)
   assert(ap_prc);
 
   static char template[] = "/tmp/tizonia-mp4dmux-XXXXXX";
-  if (!ap_prc->tmp_fd_1_)
+  if (-1 == ap_prc->tmp_fd_1_)
     {
       char fname[PATH_MAX];
       strcpy(fname, template);
@@ -474,6 +487,13 @@ get_temp_file(mp4dmuxflt_prc_t * ap_prc)
                      strerror (errno));
           rc = OMX_ErrorInsufficientResources;
         }
+      else
+        {
+          /* Nobody else needs to see this file; it goes away with the fd */
+          (void) unlink (fname);
+          ap_prc->spill_len_ = 0;
+          ap_prc->spill_pos_ = 0;
+        }
     }
   return rc;
 }
@@ -489,13 +509,19 @@ store_data (mp4dmuxflt_prc_t * ap_prc)
     {
       const void *p_buf = p_in->pBuffer + p_in->nOffset;
       const size_t count = p_in->nFilledLen;
+      ssize_t written = 0;
       tiz_check_omx (get_temp_file (ap_prc));
-      if (write (ap_prc->tmp_fd_1_, p_buf, count) != count)
+      if ((written = pwrite (ap_prc->tmp_fd_1_, p_buf, count,
+                             ap_prc->spill_len_)) != (ssize_t) count)
         {
           TIZ_ERROR (handleOf (ap_prc),
                      "Error writing to temp file (%s)",
                      strerror (errno));
         }
+      if (written > 0)
+        {
+          ap_prc->spill_len_ += written;
+        }
       rc = release_input_header (ap_prc);
     }
   return rc;
@@ -607,20 +633,8 @@ store_data (mp4dmuxflt_prc_t * ap_prc)
 static OMX_ERRORTYPE
 alloc_input_store (mp4dmuxflt_prc_t * ap_prc)
 {
-  OMX_PARAM_PORTDEFINITIONTYPE port_def;
   assert (ap_prc);
-
-  TIZ_INIT_OMX_PORT_STRUCT (port_def, ARATELIA_MP4_DEMUXER_FILTER_PORT_0_INDEX);
-  tiz_check_omx (
-    tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
-                          OMX_IndexParamPortDefinition, &port_def));
-
-  assert (ap_prc->p_mp4_store_ == NULL);
-  tiz_check_omx (
-    tiz_buffer_init (&(ap_prc->p_mp4_store_), port_def.nBufferSize * 4));
-
-  /* Will need to seek on this buffer  */
-  return tiz_buffer_seek_mode (ap_prc->p_mp4_store_, TIZ_BUFFER_SEEKABLE);
+  return get_temp_file (ap_prc);
 }
 
 static OMX_ERRORTYPE
@@ -698,7 +712,7 @@ alloc_mp4v2 (mp4dmuxflt_prc_t * ap_prc)
              we'll also give up after the max number of failed attempts. */
           dealloc_mp4v2 (ap_prc);
           reset_mp4v2_members (ap_prc);
-          tiz_buffer_seek (ap_prc->p_mp4_store_, 0, TIZ_BUFFER_SEEK_SET);
+          ap_prc->spill_pos_ = 0;
           ap_prc->mp4v2_failed_init_count_ += 1;
           rc = OMX_ErrorNotReady;
           TIZ_ERROR (handleOf (ap_prc),
@@ -743,7 +757,12 @@ reset_stream_parameters (mp4dmuxflt_prc_t * ap_prc)
   reset_mp4v2_members (ap_prc);
   ap_prc->mp4v2_failed_init_count_ = 0;
 
-  tiz_buffer_clear (ap_prc->p_mp4_store_);
+  if (-1 != ap_prc->tmp_fd_1_)
+    {
+      (void) ftruncate (ap_prc->tmp_fd_1_, 0);
+    }
+  ap_prc->spill_len_ = 0;
+  ap_prc->spill_pos_ = 0;
   tiz_buffer_clear (ap_prc->p_aud_store_);
   tiz_buffer_clear (ap_prc->p_vid_store_);
   tiz_vector_clear (ap_prc->p_aud_header_lengths_);
@@ -755,12 +774,15 @@ reset_stream_parameters (mp4dmuxflt_prc_t * ap_prc)
 static inline void
 dealloc_input_store (
   /*@special@ */ mp4dmuxflt_prc_t * ap_prc)
-/*@releases ap_prc->p_mp4_store_@ */
-/*@ensures isnull ap_prc->p_mp4_store_@ */
 {
   assert (ap_prc);
-  tiz_buffer_destroy (ap_prc->p_mp4_store_);
-  ap_prc->p_mp4_store_ = NULL;
+  if (-1 != ap_prc->tmp_fd_1_)
+    {
+      close (ap_prc->tmp_fd_1_);
+      ap_prc->tmp_fd_1_ = -1;
+    }
+  ap_prc->spill_len_ = 0;
+  ap_prc->spill_pos_ = 0;
 }
 
 static inline void
@@ -1003,7 +1025,8 @@ mp4dmuxflt_prc_ctor (void * ap_prc, va_list * app)
   p_prc->mp4v2_hdl_ = MP4_INVALID_FILE_HANDLE;
   p_prc->mp4v2_inited_ = false;
   p_prc->mp4v2_duration_ = 0;
-  p_prc->p_mp4_store_ = NULL;
+  p_prc->spill_len_ = 0;
+  p_prc->spill_pos_ = 0;
   p_prc->p_aud_store_ = NULL;
   p_prc->p_vid_store_ = NULL;
   p_prc->p_aud_header_lengths_ = NULL;
@@ -33,6 +33,7 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <sys/types.h>
 
 #include <mp4v2/mp4v2.h>
 
@@ -52,6 +53,8 @@ struct mp4dmuxflt_prc
   const tiz_filter_prc_t _;
   int tmp_fd_1_;
   int tmp_fd_2_;
+  off_t spill_len_;
+  off_t spill_pos_;
   MP4FileHandle mp4v2_hdl_;
   bool mp4v2_inited_;
   uint64_t mp4v2_duration_;
@@ -59,7 +62,6 @@ struct mp4dmuxflt_prc
   mp4_audio_type_t audio_type_;
   mp4_video_type_t video_type_;
   int mp4v2_failed_init_count_;
-  tiz_buffer_t * p_mp4_store_;
   tiz_buffer_t * p_aud_store_;
   tiz_buffer_t * p_vid_store_;
   tiz_vector_t * p_aud_header_lengths_;
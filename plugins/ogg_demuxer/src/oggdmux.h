@@ -51,6 +51,8 @@ extern "C" {
 #define ARATELIA_OGG_DEMUXER_PORT_SUPPLIERPREF OMX_BufferSupplyInput
 #define TIZ_OGG_DEMUXER_INITIAL_READ_BLOCKSIZE 16384
 #define TIZ_OGG_DEMUXER_DEFAULT_READ_BLOCKSIZE 512
+#define TIZ_OGG_DEMUXER_MAX_READ_BLOCKSIZE 65536
+#define TIZ_OGG_DEMUXER_READAHEAD_SIZE (256 * 1024)
 #define TIZ_OGG_DEMUXER_DEFAULT_BUFFER_UTILISATION .75
 #define ALL_OGG_STREAMS -1
 
@@ -35,6 +35,10 @@
 #include <errno.h>
 #include <unistd.h>
 #include <limits.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <tizplatform.h>
 
@@ -103,17 +107,87 @@ is_video_content (const OggzStreamContent content)
     };
 }
 
+static size_t
+read_from_map (oggdmux_prc_t * ap_prc, void * ap_buf, size_t n)
+{
+  assert (ap_prc);
+  assert (ap_prc->p_map_);
+  if (ap_prc->file_pos_ >= ap_prc->file_size_)
+    {
+      return 0;
+    }
+  n = MIN (n, (size_t) (ap_prc->file_size_ - ap_prc->file_pos_));
+  memcpy (ap_buf, ap_prc->p_map_ + ap_prc->file_pos_, n);
+  ap_prc->file_pos_ += (off_t) n;
+  return n;
+}
+
+static bool
+fill_readahead (oggdmux_prc_t * ap_prc)
+{
+  ssize_t n = 0;
+  assert (ap_prc);
+  assert (ap_prc->p_ra_buf_);
+
+  do
+    {
+      n = pread (ap_prc->fd_, ap_prc->p_ra_buf_,
+                 TIZ_OGG_DEMUXER_READAHEAD_SIZE, ap_prc->file_pos_);
+    }
+  while (n < 0 && EINTR == errno);
+
+  if (n < 0)
+    {
+      TIZ_ERROR (handleOf (ap_prc), "pread (%s)", strerror (errno));
+      n = 0;
+    }
+  ap_prc->ra_offset_ = ap_prc->file_pos_;
+  ap_prc->ra_len_ = (size_t) n;
+  return n > 0;
+}
+
+static size_t
+read_from_readahead (oggdmux_prc_t * ap_prc, OMX_U8 * ap_buf, size_t n)
+{
+  size_t copied = 0;
+  assert (ap_prc);
+
+  while (copied < n)
+    {
+      size_t avail = 0;
+      size_t count = 0;
+      if (ap_prc->file_pos_ < ap_prc->ra_offset_
+          || ap_prc->file_pos_
+               >= ap_prc->ra_offset_ + (off_t) ap_prc->ra_len_)
+        {
+          /* One large read serves many small oggz_read requests */
+          if (!fill_readahead (ap_prc))
+            {
+              break;
+            }
+        }
+      avail = ap_prc->ra_len_
+              - (size_t) (ap_prc->file_pos_ - ap_prc->ra_offset_);
+      count = MIN (avail, n - copied);
+      memcpy (ap_buf + copied,
+              ap_prc->p_ra_buf_ + (ap_prc->file_pos_ - ap_prc->ra_offset_),
+              count);
+      copied += count;
+      ap_prc->file_pos_ += (off_t) count;
+    }
+  return copied;
+}
+
 static size_t
 og_io_read (void * ap_user_handle, void * ap_buf, size_t n)
 {
   oggdmux_prc_t * p_prc = ap_user_handle;
-  FILE * f = NULL;
-  ssize_t bytes_read = 0;
+  size_t bytes_read = 0;
 
   assert (p_prc);
-  f = p_prc->p_file_;
 
-  bytes_read = read (fileno (f), ap_buf, n);
+  bytes_read = p_prc->p_map_ ? read_from_map (p_prc, ap_buf, n)
+                             : read_from_readahead (p_prc, ap_buf, n);
   if (0 == bytes_read)
     {
       TIZ_TRACE (handleOf (p_prc), "Zero bytes_read buf [%p] n [%d]", ap_buf,
@@ -126,20 +200,45 @@ static int
 og_io_seek (void * ap_user_handle, long offset, int whence)
 {
   oggdmux_prc_t * p_prc = ap_user_handle;
-  FILE * f = NULL;
+  off_t pos = 0;
   assert (p_prc);
-  f = p_prc->p_file_;
-  return (fseek (f, offset, whence));
+
+  switch (whence)
+    {
+      case SEEK_SET:
+        pos = offset;
+        break;
+      case SEEK_CUR:
+        pos = p_prc->file_pos_ + offset;
+        break;
+      case SEEK_END:
+        pos = p_prc->file_size_ + offset;
+        break;
+      default:
+        return -1;
+    };
+
+  if (pos < 0)
+    {
+      return -1;
+    }
+
+  if (pos != p_prc->file_pos_)
+    {
+      /* Let the kernel start fetching the new position's pages now */
+      (void) posix_fadvise (p_prc->fd_, pos, TIZ_OGG_DEMUXER_READAHEAD_SIZE,
+                            POSIX_FADV_WILLNEED);
+    }
+  p_prc->file_pos_ = pos;
+  return 0;
 }
 
 static long
 og_io_tell (void * ap_user_handle)
 {
   oggdmux_prc_t * p_prc = ap_user_handle;
-  FILE * f = NULL;
   assert (p_prc);
-  f = p_prc->p_file_;
-  return ftell (f);
+  return (long) p_prc->file_pos_;
 }
 
 static OMX_ERRORTYPE
@@ -182,15 +281,67 @@ alloc_uri (oggdmux_prc_t * ap_prc)
   return rc;
 }
 
+static void
+map_file (oggdmux_prc_t * ap_prc)
+{
+  void * p_map = NULL;
+
+  assert (ap_prc);
+  assert (!ap_prc->p_map_);
+
+  if (ap_prc->file_size_ <= 0 || (uintmax_t) ap_prc->file_size_ > SIZE_MAX)
+    {
+      return;
+    }
+
+  p_map = mmap (NULL, (size_t) ap_prc->file_size_, PROT_READ, MAP_PRIVATE,
+                ap_prc->fd_, 0);
+  if (MAP_FAILED == p_map)
+    {
+      TIZ_WARN (handleOf (ap_prc),
+                "Unable to map the file (%s); will use buffered reads",
+                strerror (errno));
+      return;
+    }
+
+  (void) madvise (p_map, (size_t) ap_prc->file_size_, MADV_SEQUENTIAL);
+  ap_prc->p_map_ = p_map;
+  TIZ_NOTICE (handleOf (ap_prc), "Mapped [%lld] bytes",
+              (long long) ap_prc->file_size_);
+}
+
 static OMX_ERRORTYPE
 alloc_file (oggdmux_prc_t * ap_prc)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  struct stat st;
+
   assert (ap_prc);
-  assert (!ap_prc->p_file_);
-  tiz_check_null_ret_oom (
-    (ap_prc->p_file_ = fopen ((const char *) ap_prc->p_uri_->contentURI, "r")));
-  return rc;
+  assert (ap_prc->fd_ < 0);
+
+  if ((ap_prc->fd_
+       = open ((const char *) ap_prc->p_uri_->contentURI, O_RDONLY | O_CLOEXEC))
+        < 0
+      || 0 != fstat (ap_prc->fd_, &st))
+    {
+      TIZ_ERROR (handleOf (ap_prc), "[OMX_ErrorInsufficientResources] : %s",
+                 strerror (errno));
+      return OMX_ErrorInsufficientResources;
+    }
+
+  ap_prc->file_size_ = st.st_size;
+  ap_prc->file_pos_ = 0;
+  (void) posix_fadvise (ap_prc->fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  map_file (ap_prc);
+  if (!ap_prc->p_map_)
+    {
+      tiz_check_null_ret_oom (
+        (ap_prc->p_ra_buf_ = tiz_mem_alloc (TIZ_OGG_DEMUXER_READAHEAD_SIZE)));
+      ap_prc->ra_offset_ = 0;
+      ap_prc->ra_len_ = 0;
+    }
+
+  return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
@@ -253,15 +404,26 @@ alloc_oggz (oggdmux_prc_t * ap_prc)
 
 static inline void
 dealloc_file (/*@special@ */ oggdmux_prc_t * ap_prc)
-/*@releases ap_prc->p_file_ @ */
-/*@ensures isnull ap_prc->p_file_@ */
+/*@releases ap_prc->p_map_, ap_prc->p_ra_buf_ @ */
+/*@ensures isnull ap_prc->p_map_, ap_prc->p_ra_buf_ @ */
 {
   assert (ap_prc);
-  if (ap_prc->p_file_)
+  if (ap_prc->p_map_)
+    {
+      (void) munmap (ap_prc->p_map_, (size_t) ap_prc->file_size_);
+      ap_prc->p_map_ = NULL;
+    }
+  tiz_mem_free (ap_prc->p_ra_buf_);
+  ap_prc->p_ra_buf_ = NULL;
+  ap_prc->ra_offset_ = 0;
+  ap_prc->ra_len_ = 0;
+  if (ap_prc->fd_ >= 0)
     {
-      (void) fclose (ap_prc->p_file_);
-      ap_prc->p_file_ = NULL;
+      (void) close (ap_prc->fd_);
+      ap_prc->fd_ = -1;
     }
+  ap_prc->file_size_ = 0;
+  ap_prc->file_pos_ = 0;
 }
 
 static inline void
@@ -1030,6 +1192,41 @@ buffers_available (oggdmux_prc_t * ap_prc)
   return rc;
 }
 
+static long
+port_space (oggdmux_prc_t * ap_prc, const OMX_U32 a_pid,
+            const OMX_U32 a_buf_size)
+{
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  long space = 0;
+  assert (ap_prc);
+
+  if (*(get_port_disabled_ptr (ap_prc, a_pid)))
+    {
+      return 0;
+    }
+  p_hdr = *(get_header_ptr (ap_prc, a_pid));
+  space = p_hdr ? (long) (p_hdr->nAllocLen - p_hdr->nFilledLen)
+                : (long) a_buf_size;
+  return MAX (0, space - (long) *(get_store_offset_ptr (ap_prc, a_pid)));
+}
+
+/* Read roughly as much as the buffers currently held downstream can take, so
+   that filling one decoder buffer costs one oggz_read, and a small buffer does
+   not pull in more data than it can hold */
+static long
+read_blocksize (oggdmux_prc_t * ap_prc)
+{
+  long blocksize = 0;
+  assert (ap_prc);
+  blocksize
+    = port_space (ap_prc, ARATELIA_OGG_DEMUXER_AUDIO_PORT_BASE_INDEX,
+                  ap_prc->aud_buf_size_)
+      + port_space (ap_prc, ARATELIA_OGG_DEMUXER_VIDEO_PORT_BASE_INDEX,
+                    ap_prc->vid_buf_size_);
+  return MIN (TIZ_OGG_DEMUXER_MAX_READ_BLOCKSIZE,
+              MAX (TIZ_OGG_DEMUXER_DEFAULT_READ_BLOCKSIZE, blocksize));
+}
+
 static OMX_ERRORTYPE
 demux_file (oggdmux_prc_t * ap_prc)
 {
@@ -1038,8 +1235,7 @@ demux_file (oggdmux_prc_t * ap_prc)
 
   do
     {
-      run_status
-        = oggz_read (ap_prc->p_oggz_, TIZ_OGG_DEMUXER_DEFAULT_READ_BLOCKSIZE);
+      run_status = oggz_read (ap_prc->p_oggz_, read_blocksize (ap_prc));
       TIZ_TRACE (handleOf (ap_prc), "run_status [%d]", run_status);
     }
   while (buffers_available (ap_prc) && run_status > 0);
@@ -1080,7 +1276,13 @@ oggdmux_prc_ctor (void * ap_obj, va_list * app)
   oggdmux_prc_t * p_prc
     = super_ctor (typeOf (ap_obj, "oggdmuxprc"), ap_obj, app);
   assert (p_prc);
-  p_prc->p_file_ = NULL;
+  p_prc->fd_ = -1;
+  p_prc->p_map_ = NULL;
+  p_prc->p_ra_buf_ = NULL;
+  p_prc->file_size_ = 0;
+  p_prc->file_pos_ = 0;
+  p_prc->ra_offset_ = 0;
+  p_prc->ra_len_ = 0;
   p_prc->p_uri_ = NULL;
   p_prc->p_oggz_ = NULL;
 
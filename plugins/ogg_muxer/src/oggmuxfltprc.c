@@ -30,9 +30,8 @@
 #include <config.h>
 #endif
 
-#include <alloca.h>
-
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
@@ -133,41 +132,272 @@ le16 (unsigned char * p, int v)
   p[1] = (v >> 8) & 0xff;
 }
 
+/* Number of 48 kHz samples in an Opus packet, from its TOC byte (see RFC
+   6716, section 3.1) */
+static long
+opus_packet_samples (const OMX_U8 * ap_data, const OMX_U32 a_len)
+{
+  long frame_samples = 0;
+  long nframes = 0;
+  OMX_U8 toc = 0;
+
+  if (!ap_data || a_len < 1)
+    {
+      return 0;
+    }
+
+  toc = ap_data[0];
+  if (toc & 0x80)
+    {
+      /* CELT-only: 2.5, 5, 10 or 20 ms */
+      frame_samples = 120 << ((toc >> 3) & 0x3);
+    }
+  else if (0x60 == (toc & 0x60))
+    {
+      /* Hybrid: 10 or 20 ms */
+      frame_samples = (toc & 0x08) ? 960 : 480;
+    }
+  else
+    {
+      /* SILK-only: 10, 20, 40 or 60 ms */
+      frame_samples
+        = (3 == ((toc >> 3) & 0x3)) ? 2880 : (480 << ((toc >> 3) & 0x3));
+    }
+
+  switch (toc & 0x3)
+    {
+      case 0:
+        nframes = 1;
+        break;
+      case 1:
+      case 2:
+        nframes = 2;
+        break;
+      default:
+        nframes = a_len < 2 ? 0 : (ap_data[1] & 0x3f);
+        break;
+    };
+
+  return frame_samples * nframes;
+}
+
+static OMX_ERRORTYPE
+release_slot (oggmuxflt_prc_t * ap_prc, oggmuxflt_slot_t * ap_slot)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (ap_prc);
+  assert (ap_slot);
+  if (ap_slot->p_hdr)
+    {
+      ap_slot->p_hdr->nFilledLen = 0;
+      ap_slot->p_hdr->nOffset = 0;
+      rc = tiz_krn_release_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                   ap_slot->pid, ap_slot->p_hdr);
+      ap_slot->p_hdr = NULL;
+      ap_slot->guard = 0;
+    }
+  return rc;
+}
+
+/* Returns to their ports the headers that oggz has finished with */
+static OMX_ERRORTYPE
+reclaim_slots (oggmuxflt_prc_t * ap_prc)
+{
+  int i = 0;
+  assert (ap_prc);
+  for (i = 0; i < OGGMUXFLT_FEED_SLOTS; ++i)
+    {
+      oggmuxflt_slot_t * p_slot = &(ap_prc->slots_[i]);
+      if (p_slot->p_hdr && p_slot->guard)
+        {
+          tiz_check_omx (release_slot (ap_prc, p_slot));
+        }
+    }
+  return OMX_ErrorNone;
+}
+
+static oggmuxflt_slot_t *
+get_free_slot (oggmuxflt_prc_t * ap_prc)
+{
+  int i = 0;
+  assert (ap_prc);
+  for (i = 0; i < OGGMUXFLT_FEED_SLOTS; ++i)
+    {
+      if (!ap_prc->slots_[i].p_hdr)
+        {
+          return &(ap_prc->slots_[i]);
+        }
+    }
+  return NULL;
+}
+
+/* Takes a header away from the filter, so that it stays with the muxer after
+   the port moves on to its next buffer */
+static OMX_BUFFERHEADERTYPE *
+take_input_header (oggmuxflt_prc_t * ap_prc, const OMX_U32 a_pid)
+{
+  OMX_BUFFERHEADERTYPE ** pp_hdr = NULL;
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  assert (ap_prc);
+  pp_hdr = tiz_filter_prc_get_header_ptr (ap_prc, a_pid);
+  assert (pp_hdr);
+  p_hdr = *pp_hdr;
+  *pp_hdr = NULL;
+  return p_hdr;
+}
+
+/* When the packet comes from an input header, oggz is given a guard instead
+   of making its own copy of the data, and the header is kept in a slot until
+   oggz is done with it. The packets built on the stack (the Opus headers)
+   are copied by oggz. */
+static OMX_ERRORTYPE
+feed_packet (oggmuxflt_prc_t * ap_prc, ogg_packet * ap_op, const long a_serialno,
+             const int a_flush, OMX_BUFFERHEADERTYPE * ap_hdr,
+             const OMX_U32 a_pid)
+{
+  oggmuxflt_slot_t * p_slot = NULL;
+  int * p_guard = NULL;
+
+  assert (ap_prc);
+  assert (ap_op);
+
+  if (ap_hdr)
+    {
+      tiz_check_omx (reclaim_slots (ap_prc));
+      if (!(p_slot = get_free_slot (ap_prc)))
+        {
+          /* oggz still holds all the slots; try again when it has written
+             some pages out */
+          return OMX_ErrorNotReady;
+        }
+      p_slot->guard = 0;
+      p_guard = &(p_slot->guard);
+    }
+
+  on_oggz_error_ret_omx_oom (
+    oggz_write_feed (ap_prc->p_oggz_, ap_op, a_serialno, a_flush, p_guard));
+
+  if (p_slot)
+    {
+      p_slot->p_hdr = ap_hdr;
+      p_slot->pid = a_pid;
+    }
+  return OMX_ErrorNone;
+}
+
+/* Makes oggz let go of all the packets it was given, so that their headers
+   can be returned to the ports; whatever it had still to write is dropped */
+static void
+drain_oggz (oggmuxflt_prc_t * ap_prc)
+{
+  unsigned char scratch[1024];
+  assert (ap_prc);
+  if (ap_prc->p_oggz_)
+    {
+      ap_prc->draining_ = true;
+      while (oggz_write_output (ap_prc->p_oggz_, scratch, sizeof (scratch)) > 0)
+        {
+        }
+      ap_prc->draining_ = false;
+    }
+}
+
+static OMX_ERRORTYPE
+release_held_headers (oggmuxflt_prc_t * ap_prc, const OMX_U32 a_pid)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  int i = 0;
+  assert (ap_prc);
+
+  drain_oggz (ap_prc);
+
+  for (i = 0; i < OGGMUXFLT_FEED_SLOTS; ++i)
+    {
+      oggmuxflt_slot_t * p_slot = &(ap_prc->slots_[i]);
+      if (p_slot->p_hdr && (OMX_ALL == a_pid || p_slot->pid == a_pid))
+        {
+          OMX_ERRORTYPE slot_rc = release_slot (ap_prc, p_slot);
+          rc = (OMX_ErrorNone == rc ? slot_rc : rc);
+        }
+    }
+
+  if (ap_prc->p_held_aud_hdr_
+      && (OMX_ALL == a_pid || ARATELIA_OGG_MUXER_FILTER_PORT_0_INDEX == a_pid))
+    {
+      OMX_BUFFERHEADERTYPE * p_hdr = ap_prc->p_held_aud_hdr_;
+      OMX_ERRORTYPE hdr_rc = OMX_ErrorNone;
+      ap_prc->p_held_aud_hdr_ = NULL;
+      p_hdr->nFilledLen = 0;
+      p_hdr->nOffset = 0;
+      hdr_rc = tiz_krn_release_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                       ARATELIA_OGG_MUXER_FILTER_PORT_0_INDEX,
+                                       p_hdr);
+      rc = (OMX_ErrorNone == rc ? hdr_rc : rc);
+    }
+  return rc;
+}
+
+/* An OpusHead in a codec config buffer from the encoder carries the pre-skip
+   of the stream (see RFC 7845, section 5.1) */
+static void
+read_opus_head (oggmuxflt_prc_t * ap_prc, const OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  const OMX_U8 * p_data = NULL;
+  assert (ap_prc);
+  assert (ap_hdr);
+  p_data = ap_hdr->pBuffer + ap_hdr->nOffset;
+  if (ap_hdr->nFilledLen >= 19 && 0 == memcmp (p_data, "OpusHead", 8))
+    {
+      ap_prc->pre_skip_ = p_data[10] | (p_data[11] << 8);
+      TIZ_TRACE (handleOf (ap_prc), "pre-skip [%ld]", ap_prc->pre_skip_);
+    }
+}
+
 /* OpusHead packet */
 static OMX_ERRORTYPE
 enqueue_opus_head (oggmuxflt_prc_t * ap_prc)
 {
-  int size = 19;
-  unsigned char * data = tiz_mem_calloc (size, sizeof (unsigned char));
+  unsigned char data[19];
   ogg_packet op;
+  OMX_BUFFERHEADERTYPE * p_hdr = get_aud_hdr (ap_prc);
 
   OGGMUXFLT_LOG_STATE (ap_prc);
 
-  tiz_check_null_ret_oom (data);
+  assert (ap_prc);
+
+  /* The first audio buffer tells whether the encoder needs a pre-skip */
+  if (!p_hdr)
+    {
+      return OMX_ErrorNotReady;
+    }
+  if (p_hdr->nFlags & OMX_BUFFERFLAG_CODECCONFIG)
+    {
+      read_opus_head (ap_prc, p_hdr);
+      p_hdr->nFilledLen = 0;
+      tiz_check_omx (release_input_header (
+        ap_prc, ARATELIA_OGG_MUXER_FILTER_PORT_0_INDEX, p_hdr));
+    }
 
   memcpy (data, "OpusHead", 8); /* identifier */
   data[8] = 1;                  /* version */
-  data[9] = 2;                  /* channels */
-  le16 (data + 10, 0);          /* pre-skip */
-  le32 (data + 12, 48000);      /* original sample rate */
-  le16 (data + 16, 0);          /* gain */
-  data[18] = 0;                 /* channel mapping family */
+  data[9] = MIN (ap_prc->opustype_.nChannels, 255); /* channels */
+  le16 (data + 10, ap_prc->pre_skip_);              /* pre-skip */
+  le32 (data + 12, ap_prc->opustype_.nSampleRate); /* original sample rate */
+  le16 (data + 16, 0);                             /* gain */
+  data[18] = 0; /* channel mapping family */
 
   op.packet = data;
-  op.bytes = size;
+  op.bytes = sizeof (data);
   op.b_o_s = 1;
   op.e_o_s = 0;
   op.granulepos = 0;
   op.packetno = 0;
 
-  assert (ap_prc);
-  on_oggz_error_ret_omx_oom (oggz_write_feed (ap_prc->p_oggz_, &op,
-                                              ap_prc->oggz_audio_serialno_,
-                                              OGGZ_FLUSH_AFTER, NULL));
+  /* The identification header must be alone in the first page */
+  tiz_check_omx (feed_packet (ap_prc, &op, ap_prc->oggz_audio_serialno_,
+                              OGGZ_FLUSH_AFTER, NULL, 0));
   ap_prc->oggz_audio_packetno_++;
 
-  tiz_mem_free (data);
-
   return OMX_ErrorNone;
 }
 
@@ -176,14 +406,14 @@ static OMX_ERRORTYPE
 enqueue_opus_tags (oggmuxflt_prc_t * ap_prc)
 {
   ogg_packet op;
-  char * identifier = "OpusTags";
-  char * vendor = "Tizonia";
-  int size = strlen (identifier) + 4 + strlen (vendor) + 4;
-  unsigned char * data = tiz_mem_calloc (size, sizeof (unsigned char));
+  const char * identifier = "OpusTags";
+  const char * vendor = "Tizonia";
+  unsigned char data[8 + 4 + 7 + 4];
 
   OGGMUXFLT_LOG_STATE (ap_prc);
 
-  tiz_check_null_ret_oom (data);
+  assert (ap_prc);
+  assert (sizeof (data) == strlen (identifier) + 4 + strlen (vendor) + 4);
 
   memcpy (data, identifier, 8);
   le32 (data + 8, strlen (vendor));
@@ -191,51 +421,121 @@ enqueue_opus_tags (oggmuxflt_prc_t * ap_prc)
   le32 (data + 12 + strlen (vendor), 0);
 
   op.packet = data;
-  op.bytes = size;
+  op.bytes = sizeof (data);
   op.b_o_s = 0;
   op.e_o_s = 0;
   op.granulepos = 0;
   op.packetno = 1;
 
-  assert (ap_prc);
-  on_oggz_error_ret_omx_oom (oggz_write_feed (ap_prc->p_oggz_, &op,
-                                              ap_prc->oggz_audio_serialno_,
-                                              OGGZ_FLUSH_AFTER, NULL));
+  /* Audio data must start on a fresh page */
+  tiz_check_omx (feed_packet (ap_prc, &op, ap_prc->oggz_audio_serialno_,
+                              OGGZ_FLUSH_AFTER, NULL, 0));
   ap_prc->oggz_audio_packetno_++;
 
-  tiz_mem_free (data);
+  return OMX_ErrorNone;
+}
+
+/* a_end is the time at which the audio ends, or -1 if unknown */
+static OMX_ERRORTYPE
+feed_opus_packet (oggmuxflt_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr,
+                  const bool a_eos, const OMX_TICKS a_end)
+{
+  ogg_packet op;
+  int flush = 0;
+
+  assert (ap_prc);
+  assert (ap_hdr);
+
+  op.packet = ap_hdr->pBuffer + ap_hdr->nOffset;
+  op.bytes = ap_hdr->nFilledLen;
+  /* The granule position of an Opus packet is the number of 48 kHz samples
+     decoded by the end of it, counting the ones that pre-skip discards */
+  op.granulepos = ap_prc->oggz_audio_granulepos_
+                  + opus_packet_samples (op.packet, ap_hdr->nFilledLen);
+  op.packetno = ap_prc->oggz_audio_packetno_;
+  op.b_o_s = 0;
+  op.e_o_s = a_eos ? 1 : 0;
 
+  if (a_eos && a_end >= 0)
+    {
+      /* An end position short of the last packet's end tells the decoder
+         to drop the padding (RFC 7845, section 4.5) */
+      const long end = ap_prc->pre_skip_ + (long) ((a_end * 48000) / 1000000);
+      op.granulepos
+        = MAX (ap_prc->oggz_audio_granulepos_, MIN (op.granulepos, end));
+    }
+
+  /* Complete the page once it holds enough audio; otherwise libogg fills
+     it up to its usual size of about 4 KB */
+  if (0 == ap_prc->page_duration_granules_ || op.e_o_s
+      || op.granulepos - ap_prc->oggz_audio_page_granulepos_
+           >= ap_prc->page_duration_granules_)
+    {
+      flush = OGGZ_FLUSH_AFTER;
+    }
+
+  TIZ_DEBUG (handleOf (ap_prc), "written [%d] granulepos [%lld]", op.bytes,
+             (long long) op.granulepos);
+  tiz_check_omx (feed_packet (ap_prc, &op, ap_prc->oggz_audio_serialno_, flush,
+                              ap_hdr, ARATELIA_OGG_MUXER_FILTER_PORT_0_INDEX));
+  if (flush)
+    {
+      ap_prc->oggz_audio_page_granulepos_ = op.granulepos;
+    }
+  ap_prc->oggz_audio_granulepos_ = op.granulepos;
+  ap_prc->oggz_audio_packetno_++;
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
 enqueue_opus_packet (oggmuxflt_prc_t * ap_prc)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNotReady;
-  ogg_packet op;
   OMX_BUFFERHEADERTYPE * p_hdr = get_aud_hdr (ap_prc);
+  const bool eos = p_hdr && (p_hdr->nFlags & OMX_BUFFERFLAG_EOS) > 0;
 
   OGGMUXFLT_LOG_STATE (ap_prc);
-  if (p_hdr)
+
+  if (!p_hdr)
     {
-      op.packet = p_hdr->pBuffer + p_hdr->nOffset;
-      op.bytes = p_hdr->nFilledLen;
-      op.granulepos = ap_prc->oggz_audio_granulepos_;
-      op.packetno = ap_prc->oggz_audio_packetno_;
-      op.b_o_s = 0;
-      op.e_o_s = (((p_hdr->nFlags & OMX_BUFFERFLAG_EOS) > 0) ? 1 : 0);
-      TIZ_DEBUG (handleOf (ap_prc), "written [%d]", op.bytes);
-      on_oggz_error_ret_omx_oom (oggz_write_feed (ap_prc->p_oggz_, &op,
-                                                  ap_prc->oggz_audio_serialno_,
-                                                  OGGZ_FLUSH_AFTER, NULL));
+      return OMX_ErrorNotReady;
+    }
+
+  if (0 == p_hdr->nFilledLen || (p_hdr->nFlags & OMX_BUFFERFLAG_CODECCONFIG))
+    {
+      /* Nothing to mux; but an empty EOS buffer is stamped with the time at
+         which the audio ends */
+      if (ap_prc->p_held_aud_hdr_)
+        {
+          tiz_check_omx (feed_opus_packet (ap_prc, ap_prc->p_held_aud_hdr_, eos,
+                                           eos ? p_hdr->nTimeStamp : -1));
+          ap_prc->p_held_aud_hdr_ = NULL;
+        }
       p_hdr->nFilledLen = 0;
-      rc = release_input_header (ap_prc, ARATELIA_OGG_MUXER_FILTER_PORT_0_INDEX,
-                                 p_hdr);
-      ap_prc->oggz_audio_granulepos_ += 100;
-      ap_prc->oggz_audio_packetno_++;
+      return release_input_header (ap_prc,
+                                   ARATELIA_OGG_MUXER_FILTER_PORT_0_INDEX, p_hdr);
     }
 
-  return rc;
+  if (ap_prc->p_held_aud_hdr_)
+    {
+      tiz_check_omx (
+        feed_opus_packet (ap_prc, ap_prc->p_held_aud_hdr_, false, -1));
+      ap_prc->p_held_aud_hdr_ = NULL;
+    }
+
+  if (eos)
+    {
+      /* The stream ends with this packet, at whatever length it has */
+      tiz_check_omx (feed_opus_packet (ap_prc, p_hdr, true, -1));
+      (void) take_input_header (ap_prc, ARATELIA_OGG_MUXER_FILTER_PORT_0_INDEX);
+      tiz_filter_prc_update_eos_flag (ap_prc, true);
+    }
+  else
+    {
+      ap_prc->p_held_aud_hdr_
+        = take_input_header (ap_prc, ARATELIA_OGG_MUXER_FILTER_PORT_0_INDEX);
+    }
+
+  return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
@@ -274,11 +574,15 @@ video_hungry (oggmuxflt_prc_t * ap_prc)
       op.packetno = ap_prc->oggz_video_packetno_;
       op.b_o_s = (0 == ap_prc->oggz_video_packetno_ ? 1 : 0);
       op.e_o_s = (((p_hdr->nFlags & OMX_BUFFERFLAG_EOS) > 0) ? 1 : 0);
-      oggz_write_feed (ap_prc->p_oggz_, &op, ap_prc->oggz_video_serialno_,
-                       OGGZ_FLUSH_AFTER, NULL);
-      p_hdr->nFilledLen = 0;
-      rc = release_input_header (ap_prc, ARATELIA_OGG_MUXER_FILTER_PORT_1_INDEX,
-                                 p_hdr);
+      tiz_check_omx (feed_packet (ap_prc, &op, ap_prc->oggz_video_serialno_,
+                                  OGGZ_FLUSH_AFTER, p_hdr,
+                                  ARATELIA_OGG_MUXER_FILTER_PORT_1_INDEX));
+      (void) take_input_header (ap_prc, ARATELIA_OGG_MUXER_FILTER_PORT_1_INDEX);
+      if (op.e_o_s)
+        {
+          tiz_filter_prc_update_eos_flag (ap_prc, true);
+        }
+      rc = OMX_ErrorNone;
       ap_prc->oggz_video_granulepos_ += 1;
       ap_prc->oggz_video_packetno_++;
     }
@@ -305,6 +609,10 @@ og_hungry (OGGZ * oggz, int empty, void * user_data)
   assert (p_prc);
   TIZ_DEBUG (handleOf (p_prc), "ogg queue is [%s]",
              (empty == 0 ? "NOT EMPTY" : "EMPTY"));
+  if (p_prc->draining_)
+    {
+      return OGGZ_ERR_STOP_OK;
+    }
   audio_rc = audio_hungry (p_prc);
   video_rc = video_hungry (p_prc);
   if (OMX_ErrorNone == audio_rc || OMX_ErrorNone == video_rc)
@@ -396,6 +704,32 @@ alloc_oggz (oggmuxflt_prc_t * ap_prc)
   return rc;
 }
 
+static OMX_ERRORTYPE
+obtain_opus_params (oggmuxflt_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  TIZ_INIT_OMX_PORT_STRUCT (ap_prc->opustype_,
+                            ARATELIA_OGG_MUXER_FILTER_PORT_0_INDEX);
+  tiz_check_omx (tiz_api_GetParameter (
+    tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+    OMX_TizoniaIndexParamAudioOpus, &ap_prc->opustype_));
+  TIZ_TRACE (handleOf (ap_prc), "nChannels = [%d] nSampleRate = [%d]",
+             ap_prc->opustype_.nChannels, ap_prc->opustype_.nSampleRate);
+  return OMX_ErrorNone;
+}
+
+static void
+obtain_page_policy (oggmuxflt_prc_t * ap_prc)
+{
+  const char * p_value = tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION,
+    "OMX.Aratelia.container_muxer.ogg.page_duration_ms");
+  assert (ap_prc);
+  /* Opus granule positions are always in 48 kHz samples */
+  ap_prc->page_duration_granules_
+    = (p_value && atoi (p_value) > 0) ? atoi (p_value) * 48 : 0;
+}
+
 static bool
 able_to_mux (oggmuxflt_prc_t * ap_prc)
 {
@@ -441,6 +775,10 @@ do_flush (oggmuxflt_prc_t * ap_prc, OMX_U32 a_pid)
       reset_stream_parameters (ap_prc);
     }
   /* Release any buffers held  */
+  if (ARATELIA_OGG_MUXER_FILTER_PORT_2_INDEX != a_pid)
+    {
+      tiz_check_omx (release_held_headers (ap_prc, a_pid));
+    }
   return tiz_filter_prc_release_header (ap_prc, a_pid);
 }
 
@@ -506,8 +844,11 @@ mux_streams (oggmuxflt_prc_t * ap_prc)
   long oggz_rc = OGGZ_ERR_OK;
   while ((OGGZ_ERR_OK == oggz_rc) && (p_hdr = get_out_hdr (ap_prc)))
     {
-      long n = MIN (32, TIZ_OMX_BUF_AVAIL (p_hdr));
+      /* Write straight into the output buffer, as much as fits */
+      long n = TIZ_OMX_BUF_AVAIL (p_hdr);
       oggz_rc = oggz_write (ap_prc->p_oggz_, n);
+      /* Give back the headers of the packets that oggz has consumed */
+      tiz_check_omx (reclaim_slots (ap_prc));
       if (oggz_rc > 0)
         {
           oggz_rc = OGGZ_ERR_OK;
@@ -558,6 +899,16 @@ oggmuxflt_prc_ctor (void * ap_prc, va_list * app)
   p_prc->oggz_video_granulepos_ = 0;
   p_prc->oggz_audio_packetno_ = 0;
   p_prc->oggz_video_packetno_ = 0;
+  p_prc->oggz_audio_page_granulepos_ = 0;
+  p_prc->page_duration_granules_ = 0;
+  p_prc->pre_skip_ = 0;
+  TIZ_INIT_OMX_PORT_STRUCT (p_prc->opustype_,
+                            ARATELIA_OGG_MUXER_FILTER_PORT_0_INDEX);
+  p_prc->opustype_.nChannels = 2;
+  p_prc->opustype_.nSampleRate = 48000;
+  memset (p_prc->slots_, 0, sizeof (p_prc->slots_));
+  p_prc->p_held_aud_hdr_ = NULL;
+  p_prc->draining_ = false;
   reset_stream_parameters (p_prc);
   return p_prc;
 }
@@ -578,6 +929,8 @@ oggmuxflt_prc_allocate_resources (void * ap_prc, OMX_U32 a_pid)
 {
   oggmuxflt_prc_t * p_prc = ap_prc;
   assert (p_prc);
+  tiz_check_omx (obtain_opus_params (p_prc));
+  obtain_page_policy (p_prc);
   tiz_check_omx (alloc_oggz (p_prc));
   return OMX_ErrorNone;
 }
@@ -659,7 +1012,15 @@ static OMX_ERRORTYPE
 oggmuxflt_prc_port_disable (const void * ap_prc, OMX_U32 a_pid)
 {
   oggmuxflt_prc_t * p_prc = (oggmuxflt_prc_t *) ap_prc;
-  OMX_ERRORTYPE rc = tiz_filter_prc_release_header (p_prc, a_pid);
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  if (ARATELIA_OGG_MUXER_FILTER_PORT_2_INDEX != a_pid)
+    {
+      rc = release_held_headers (p_prc, a_pid);
+    }
+  if (OMX_ErrorNone == rc)
+    {
+      rc = tiz_filter_prc_release_header (p_prc, a_pid);
+    }
   reset_stream_parameters (p_prc);
   tiz_filter_prc_update_port_disabled_flag (p_prc, a_pid, true);
   return rc;
@@ -37,12 +37,25 @@ extern "C" {
 #include <oggz/oggz.h>
 
 #include <OMX_Core.h>
+#include <OMX_TizoniaExt.h>
 
 #include <tizplatform.h>
 
 #include <tizfilterprc.h>
 #include <tizfilterprc_decls.h>
 
+#define OGGMUXFLT_FEED_SLOTS 4
+
+/* An input header whose data was handed to oggz, kept until oggz signals
+   through the guard that it is done with it */
+typedef struct oggmuxflt_slot oggmuxflt_slot_t;
+struct oggmuxflt_slot
+{
+  OMX_BUFFERHEADERTYPE * p_hdr;
+  OMX_U32 pid;
+  int guard;
+};
+
 typedef struct oggmuxflt_prc oggmuxflt_prc_t;
 struct oggmuxflt_prc
 {
@@ -55,6 +68,15 @@ struct oggmuxflt_prc
   long oggz_video_granulepos_;
   long oggz_audio_packetno_;
   long oggz_video_packetno_;
+  long oggz_audio_page_granulepos_;
+  long page_duration_granules_;
+  long pre_skip_;
+  OMX_TIZONIA_AUDIO_PARAM_OPUSTYPE opustype_;
+  oggmuxflt_slot_t slots_[OGGMUXFLT_FEED_SLOTS];
+  /* The last audio packet received; it is fed to oggz once the next one
+     arrives, so that the final packet can get the stream's end position */
+  OMX_BUFFERHEADERTYPE * p_held_aud_hdr_;
+  bool draining_;
 };
 
 typedef struct oggmuxflt_prc_class oggmuxflt_prc_class_t;
@@ -0,0 +1,69 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   opuse.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Opus encoder component constants
+ *
+ *
+ */
+#ifndef OPUSE_H
+#define OPUSE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+#include <OMX_TizoniaExt.h>
+
+/* 60ms at 48000 */
+#define OPUS_MAX_FRAME_SIZE (960 * 3)
+/* Largest packet libopus may produce (RFC 6716, section 3.2.5) */
+#define OPUS_MAX_PACKET_SIZE (3 * 1275 + 7)
+
+#define ARATELIA_OPUS_ENCODER_DEFAULT_ROLE OMX_ROLE_AUDIO_ENCODER_OPUS
+#define ARATELIA_OPUS_ENCODER_COMPONENT_NAME "OMX.Aratelia.audio_encoder.opus"
+/* With libtizonia, port indexes must start at index 0 */
+#define ARATELIA_OPUS_ENCODER_INPUT_PORT_INDEX 0
+#define ARATELIA_OPUS_ENCODER_OUTPUT_PORT_INDEX 1
+#define ARATELIA_OPUS_ENCODER_PORT_MIN_BUF_COUNT 4
+#define ARATELIA_OPUS_ENCODER_PORT_MIN_INPUT_BUF_SIZE 8192
+/* One Opus packet per output buffer */
+#define ARATELIA_OPUS_ENCODER_PORT_MIN_OUTPUT_BUF_SIZE OPUS_MAX_PACKET_SIZE
+#define ARATELIA_OPUS_ENCODER_PORT_NONCONTIGUOUS OMX_FALSE
+#define ARATELIA_OPUS_ENCODER_PORT_ALIGNMENT 0
+#define ARATELIA_OPUS_ENCODER_PORT_SUPPLIERPREF OMX_BufferSupplyInput
+/* Defaults: 48 kbps per channel, 20 ms frames, mid complexity */
+/* The pcm rates taken; the ones libopus doesn't take are resampled to
+   48 kHz */
+#define ARATELIA_OPUS_ENCODER_MIN_SAMPLING_RATE 8000
+#define ARATELIA_OPUS_ENCODER_MAX_SAMPLING_RATE 192000
+#define ARATELIA_OPUS_ENCODER_DEFAULT_BIT_RATE_KBPS 48
+#define ARATELIA_OPUS_ENCODER_DEFAULT_FRAME_DURATION 20
+#define ARATELIA_OPUS_ENCODER_DEFAULT_COMPLEXITY 5
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OPUSE_H */
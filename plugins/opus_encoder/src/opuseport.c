@@ -0,0 +1,165 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   opuseport.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Opus encoder's pcm input port
+ *
+ * A pcm port that only takes the pcm streams libopus can encode, so that an
+ * unsupported setting is refused when it is made rather than when the
+ * encoder is created.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+
+#include <tizplatform.h>
+
+#include "opuse.h"
+#include "opuseport.h"
+#include "opuseport_decls.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.opus_encoder.port"
+#endif
+
+static bool
+is_supported_pcm_mode (const OMX_AUDIO_PARAM_PCMMODETYPE * ap_pcmmode)
+{
+  assert (ap_pcmmode);
+
+  /* The rates libopus doesn't take are resampled by the processor */
+  if (ap_pcmmode->nSamplingRate < ARATELIA_OPUS_ENCODER_MIN_SAMPLING_RATE
+      || ap_pcmmode->nSamplingRate > ARATELIA_OPUS_ENCODER_MAX_SAMPLING_RATE)
+    {
+      return false;
+    }
+
+  return (16 == ap_pcmmode->nBitPerSample
+          && OMX_NumericalDataSigned == ap_pcmmode->eNumData
+          && OMX_TRUE == ap_pcmmode->bInterleaved
+          && OMX_EndianLittle == ap_pcmmode->eEndian
+          && ap_pcmmode->nChannels >= 1 && ap_pcmmode->nChannels <= 2);
+}
+
+/*
+ * opuseport class
+ */
+
+static void *
+opuse_port_ctor (void * ap_obj, va_list * app)
+{
+  return super_ctor (typeOf (ap_obj, "opuseport"), ap_obj, app);
+}
+
+static void *
+opuse_port_dtor (void * ap_obj)
+{
+  return super_dtor (typeOf (ap_obj, "opuseport"), ap_obj);
+}
+
+/*
+ * from tiz_api
+ */
+
+static OMX_ERRORTYPE
+opuse_port_SetParameter (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                         OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  TIZ_TRACE (ap_hdl, "[%s]...", tiz_idx_to_str (a_index));
+
+  if (OMX_IndexParamAudioPcm == a_index
+      && !is_supported_pcm_mode ((OMX_AUDIO_PARAM_PCMMODETYPE *) ap_struct))
+    {
+      const OMX_AUDIO_PARAM_PCMMODETYPE * p_pcmmode = ap_struct;
+      TIZ_ERROR (ap_hdl,
+                 "[OMX_ErrorUnsupportedSetting] : sampling rate [%d] "
+                 "channels [%d] bits [%d] - only 16-bit signed little-endian "
+                 "interleaved mono or stereo pcm at 8 to 192 kHz is supported",
+                 p_pcmmode->nSamplingRate, p_pcmmode->nChannels,
+                 p_pcmmode->nBitPerSample);
+      return OMX_ErrorUnsupportedSetting;
+    }
+
+  /* Delegate to the base port */
+  return super_SetParameter (typeOf (ap_obj, "opuseport"), ap_obj, ap_hdl,
+                             a_index, ap_struct);
+}
+
+/*
+ * opuse_port_class
+ */
+
+static void *
+opuse_port_class_ctor (void * ap_obj, va_list * app)
+{
+  /* NOTE: Class methods might be added in the future. None for now. */
+  return super_ctor (typeOf (ap_obj, "opuseport_class"), ap_obj, app);
+}
+
+/*
+ * initialization
+ */
+
+void *
+opuse_port_class_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizpcmport = tiz_get_type (ap_hdl, "tizpcmport");
+  void * opuseport_class = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (classOf (tizpcmport), "opuseport_class", classOf (tizpcmport),
+     sizeof (opuse_port_class_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, opuse_port_class_ctor,
+     /* TIZ_CLASS_COMMENT: stop value*/
+     0);
+  return opuseport_class;
+}
+
+void *
+opuse_port_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizpcmport = tiz_get_type (ap_hdl, "tizpcmport");
+  void * opuseport_class = tiz_get_type (ap_hdl, "opuseport_class");
+  TIZ_LOG_CLASS (opuseport_class);
+  void * opuseport = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (opuseport_class, "opuseport", tizpcmport, sizeof (opuse_port_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, opuse_port_ctor,
+     /* TIZ_CLASS_COMMENT: class destructor */
+     dtor, opuse_port_dtor,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_SetParameter, opuse_port_SetParameter,
+     /* TIZ_CLASS_COMMENT: stop value*/
+     0);
+
+  return opuseport;
+}
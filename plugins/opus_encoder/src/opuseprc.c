@@ -0,0 +1,884 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   opuseprc.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Opus Encoder processor
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include <tizkernel.h>
+
+#include "opuse.h"
+#include "opuseprc.h"
+#include "opuseprc_decls.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.opus_encoder.prc"
+#endif
+
+/* Packet loss percentage the encoder is told to expect when
+   bPacketLossResilience is set */
+#define OPUSE_EXPECTED_PACKET_LOSS_PERC 10
+
+/* Size of an OpusHead packet with channel mapping family 0 */
+#define OPUSE_OPUS_HEAD_SIZE 19
+
+static int
+frame_duration_to_samples (opuse_prc_t * ap_prc, const OMX_S32 a_duration,
+                           const OMX_U32 a_rate)
+{
+  /* nFrameDuration is in ms; 2 stands for 2.5 ms */
+  switch (a_duration)
+    {
+      case 2:
+        return a_rate / 400;
+      case 5:
+        return a_rate / 200;
+      case 10:
+        return a_rate / 100;
+      case 20:
+        return a_rate / 50;
+      case 40:
+        return a_rate / 25;
+      case 60:
+        return (a_rate * 3) / 50;
+      default:
+        {
+          TIZ_WARN (handleOf (ap_prc),
+                    "Unsupported frame duration [%d]; using [%d] ms",
+                    a_duration, ARATELIA_OPUS_ENCODER_DEFAULT_FRAME_DURATION);
+        }
+        break;
+    };
+  return a_rate / (1000 / ARATELIA_OPUS_ENCODER_DEFAULT_FRAME_DURATION);
+}
+
+/* The rates libopus takes */
+static bool
+is_opus_rate (const OMX_U32 a_rate)
+{
+  return (8000 == a_rate || 12000 == a_rate || 16000 == a_rate
+          || 24000 == a_rate || 48000 == a_rate);
+}
+
+static void
+destroy_encoder (opuse_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_opus_enc_)
+    {
+      opus_encoder_destroy (ap_prc->p_opus_enc_);
+      ap_prc->p_opus_enc_ = NULL;
+    }
+  if (ap_prc->p_resampler_)
+    {
+      speex_resampler_destroy (ap_prc->p_resampler_);
+      ap_prc->p_resampler_ = NULL;
+    }
+  tiz_mem_free (ap_prc->p_frame_);
+  ap_prc->p_frame_ = NULL;
+  ap_prc->frame_size_ = 0;
+  ap_prc->frame_fill_ = 0;
+}
+
+static OMX_ERRORTYPE
+retrieve_settings (opuse_prc_t * ap_prc)
+{
+  assert (ap_prc);
+
+  TIZ_INIT_OMX_PORT_STRUCT (ap_prc->pcmmode_,
+                            ARATELIA_OPUS_ENCODER_INPUT_PORT_INDEX);
+  tiz_check_omx (tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)),
+                                       handleOf (ap_prc),
+                                       OMX_IndexParamAudioPcm,
+                                       &ap_prc->pcmmode_));
+
+  TIZ_INIT_OMX_PORT_STRUCT (ap_prc->opustype_,
+                            ARATELIA_OPUS_ENCODER_OUTPUT_PORT_INDEX);
+  tiz_check_omx (tiz_api_GetParameter (
+    tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+    OMX_TizoniaIndexParamAudioOpus, &ap_prc->opustype_));
+
+  TIZ_TRACE (handleOf (ap_prc),
+             "nChannels = [%d] nBitPerSample = [%d] nSamplingRate = [%d] "
+             "eEndian = [%d] "
+             "nBitRate = [%d] nFrameDuration = [%d] nEncoderComplexity = [%d] "
+             "eFormat = [%d]",
+             ap_prc->pcmmode_.nChannels, ap_prc->pcmmode_.nBitPerSample,
+             ap_prc->pcmmode_.nSamplingRate, ap_prc->pcmmode_.eEndian,
+             ap_prc->opustype_.nBitRate,
+             ap_prc->opustype_.nFrameDuration,
+             ap_prc->opustype_.nEncoderComplexity, ap_prc->opustype_.eFormat);
+
+  if (16 != ap_prc->pcmmode_.nBitPerSample
+      || OMX_NumericalDataSigned != ap_prc->pcmmode_.eNumData
+      || OMX_TRUE != ap_prc->pcmmode_.bInterleaved
+      || OMX_EndianLittle != ap_prc->pcmmode_.eEndian
+      || ap_prc->pcmmode_.nChannels < 1 || ap_prc->pcmmode_.nChannels > 2
+      || ap_prc->pcmmode_.nSamplingRate
+           < ARATELIA_OPUS_ENCODER_MIN_SAMPLING_RATE
+      || ap_prc->pcmmode_.nSamplingRate
+           > ARATELIA_OPUS_ENCODER_MAX_SAMPLING_RATE)
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorUnsupportedSetting] : Only 16-bit signed "
+                 "little-endian interleaved mono or stereo pcm at 8 to "
+                 "192 kHz is supported");
+      return OMX_ErrorUnsupportedSetting;
+    }
+
+  return OMX_ErrorNone;
+}
+
+/* The output port describes the stream that is actually encoded, which has
+ * the channels of the pcm coming in and the rate the encoder runs at */
+static OMX_ERRORTYPE
+update_opus_type (opuse_prc_t * ap_prc)
+{
+  OMX_TIZONIA_AUDIO_PARAM_OPUSTYPE * p_opus = NULL;
+  assert (ap_prc);
+
+  p_opus = &(ap_prc->opustype_);
+  if (p_opus->nSampleRate != ap_prc->enc_rate_
+      || p_opus->nChannels != ap_prc->pcmmode_.nChannels)
+    {
+      TIZ_DEBUG (handleOf (ap_prc),
+                 "Updating opus type : samplerate [%d] -> [%d] "
+                 "channels [%d] -> [%d]",
+                 p_opus->nSampleRate, ap_prc->enc_rate_, p_opus->nChannels,
+                 ap_prc->pcmmode_.nChannels);
+      p_opus->nSampleRate = ap_prc->enc_rate_;
+      p_opus->nChannels = ap_prc->pcmmode_.nChannels;
+      p_opus->eChannelMode = 1 == p_opus->nChannels
+                               ? OMX_AUDIO_ChannelModeMono
+                               : OMX_AUDIO_ChannelModeStereo;
+      tiz_check_omx (tiz_krn_SetParameter_internal (
+        tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+        OMX_TizoniaIndexParamAudioOpus, p_opus));
+      tiz_srv_issue_event ((OMX_PTR) ap_prc, OMX_EventPortSettingsChanged,
+                           ARATELIA_OPUS_ENCODER_OUTPUT_PORT_INDEX,
+                           OMX_TizoniaIndexParamAudioOpus, /* the index of the
+                                                              struct that has
+                                                              been modififed */
+                           NULL);
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+create_encoder (opuse_prc_t * ap_prc)
+{
+  const OMX_TIZONIA_AUDIO_PARAM_OPUSTYPE * p_opus = NULL;
+  const OMX_U32 in_rate = ap_prc->pcmmode_.nSamplingRate;
+  const int channels = ap_prc->pcmmode_.nChannels;
+  OMX_U32 rate = 0;
+  OMX_U32 kbps = 0;
+  int application = OPUS_APPLICATION_AUDIO;
+  int error = OPUS_OK;
+
+  assert (ap_prc);
+  assert (!ap_prc->p_opus_enc_);
+  assert (!ap_prc->p_resampler_);
+
+  /* Any other rate is resampled to the one libopus works at internally */
+  rate = is_opus_rate (in_rate) ? in_rate : 48000;
+  ap_prc->enc_rate_ = rate;
+  if (rate != in_rate)
+    {
+      ap_prc->p_resampler_
+        = speex_resampler_init (channels, in_rate, rate,
+                                SPEEX_RESAMPLER_QUALITY_DESKTOP, &error);
+      if (!ap_prc->p_resampler_)
+        {
+          TIZ_ERROR (handleOf (ap_prc),
+                     "[OMX_ErrorInsufficientResources] : "
+                     "speex_resampler_init failed ([%d] -> [%d]) : [%s]",
+                     in_rate, rate, speex_resampler_strerror (error));
+          return OMX_ErrorInsufficientResources;
+        }
+      /* Skip the filter's leading zeros, so that the output lines up with
+         the input */
+      (void) speex_resampler_skip_zeros (ap_prc->p_resampler_);
+      TIZ_TRACE (handleOf (ap_prc), "Resampling [%d] -> [%d]", in_rate, rate);
+    }
+
+  tiz_check_omx (update_opus_type (ap_prc));
+  p_opus = &(ap_prc->opustype_);
+
+  /* The shortest frames are only useful when latency matters most; the
+   * restricted low-delay mode also cuts the encoder's lookahead from 6.5 to
+   * 2.5 ms */
+  if (p_opus->nFrameDuration < 10)
+    {
+      application = OPUS_APPLICATION_RESTRICTED_LOWDELAY;
+    }
+
+  ap_prc->p_opus_enc_
+    = opus_encoder_create (rate, channels, application, &error);
+  if (OPUS_OK != error || !ap_prc->p_opus_enc_)
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorUnsupportedSetting] : "
+                 "opus_encoder_create failed (rate [%d] channels [%d]) : [%s]",
+                 rate, channels, opus_strerror (error));
+      ap_prc->p_opus_enc_ = NULL;
+      return OMX_ErrorUnsupportedSetting;
+    }
+
+  /* nBitRate is in kbps per channel */
+  kbps = p_opus->nBitRate > 0 ? p_opus->nBitRate
+                              : ARATELIA_OPUS_ENCODER_DEFAULT_BIT_RATE_KBPS;
+  kbps = MAX (6, MIN (kbps, 256));
+  (void) opus_encoder_ctl (ap_prc->p_opus_enc_,
+                           OPUS_SET_BITRATE (kbps * 1000 * channels));
+  (void) opus_encoder_ctl (ap_prc->p_opus_enc_,
+                           OPUS_SET_COMPLEXITY (
+                             MIN (p_opus->nEncoderComplexity, 10)));
+  (void) opus_encoder_ctl (
+    ap_prc->p_opus_enc_,
+    OPUS_SET_VBR (OMX_AUDIO_OPUSStreamFormatCBR != p_opus->eFormat
+                  && OMX_AUDIO_OPUSStreamFormatHardCBR != p_opus->eFormat));
+  (void) opus_encoder_ctl (
+    ap_prc->p_opus_enc_,
+    OPUS_SET_VBR_CONSTRAINT (OMX_AUDIO_OPUSStreamFormatConstrainedVBR
+                             == p_opus->eFormat));
+  (void) opus_encoder_ctl (
+    ap_prc->p_opus_enc_,
+    OPUS_SET_INBAND_FEC (OMX_TRUE == p_opus->bForwardErrorCorrection));
+  (void) opus_encoder_ctl (
+    ap_prc->p_opus_enc_,
+    OPUS_SET_PACKET_LOSS_PERC (OMX_TRUE == p_opus->bPacketLossResilience
+                                 ? OPUSE_EXPECTED_PACKET_LOSS_PERC
+                                 : 0));
+  (void) opus_encoder_ctl (ap_prc->p_opus_enc_,
+                           OPUS_SET_DTX (OMX_TRUE == p_opus->bDtx));
+  ap_prc->lookahead_ = 0;
+  (void) opus_encoder_ctl (ap_prc->p_opus_enc_,
+                           OPUS_GET_LOOKAHEAD (&ap_prc->lookahead_));
+
+  ap_prc->frame_size_
+    = frame_duration_to_samples (ap_prc, p_opus->nFrameDuration, rate);
+  ap_prc->frame_fill_ = 0;
+  ap_prc->p_frame_
+    = tiz_mem_calloc (ap_prc->frame_size_ * channels, sizeof (opus_int16));
+  tiz_check_null_ret_oom (ap_prc->p_frame_);
+
+  TIZ_TRACE (handleOf (ap_prc),
+             "Opus encoder ready : [%d] bps frame size [%d] complexity [%d] "
+             "lookahead [%d]",
+             kbps * 1000 * channels, ap_prc->frame_size_,
+             p_opus->nEncoderComplexity, ap_prc->lookahead_);
+
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+release_buffers (opuse_prc_t * ap_prc)
+{
+  assert (ap_prc);
+
+  if (ap_prc->p_inhdr_)
+    {
+      tiz_check_omx (tiz_krn_release_buffer (
+        tiz_get_krn (handleOf (ap_prc)), ARATELIA_OPUS_ENCODER_INPUT_PORT_INDEX,
+        ap_prc->p_inhdr_));
+      ap_prc->p_inhdr_ = NULL;
+    }
+
+  if (ap_prc->p_outhdr_)
+    {
+      tiz_check_omx (tiz_krn_release_buffer (
+        tiz_get_krn (handleOf (ap_prc)),
+        ARATELIA_OPUS_ENCODER_OUTPUT_PORT_INDEX, ap_prc->p_outhdr_));
+      ap_prc->p_outhdr_ = NULL;
+    }
+
+  return OMX_ErrorNone;
+}
+
+static void
+reset_stream (opuse_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  ap_prc->frame_fill_ = 0;
+  ap_prc->partial_len_ = 0;
+  ap_prc->samples_in_ = 0;
+  ap_prc->samples_out_ = 0;
+  ap_prc->drain_left_ = 0;
+  ap_prc->head_sent_ = false;
+  ap_prc->eos_ = false;
+  if (ap_prc->p_opus_enc_)
+    {
+      (void) opus_encoder_ctl (ap_prc->p_opus_enc_, OPUS_RESET_STATE);
+    }
+  if (ap_prc->p_resampler_)
+    {
+      (void) speex_resampler_reset_mem (ap_prc->p_resampler_);
+      (void) speex_resampler_skip_zeros (ap_prc->p_resampler_);
+    }
+}
+
+static bool
+claim_input (opuse_prc_t * ap_prc)
+{
+  bool rc = false;
+  assert (ap_prc);
+
+  if (OMX_ErrorNone
+      == tiz_krn_claim_buffer (tiz_get_krn (handleOf (ap_prc)),
+                               ARATELIA_OPUS_ENCODER_INPUT_PORT_INDEX, 0,
+                               &ap_prc->p_inhdr_))
+    {
+      if (ap_prc->p_inhdr_)
+        {
+          TIZ_TRACE (handleOf (ap_prc), "Claimed INPUT HEADER [%p]...",
+                     ap_prc->p_inhdr_);
+          rc = true;
+        }
+    }
+
+  return rc;
+}
+
+static bool
+claim_output (opuse_prc_t * ap_prc)
+{
+  bool rc = false;
+  assert (ap_prc);
+
+  if (OMX_ErrorNone
+      == tiz_krn_claim_buffer (tiz_get_krn (handleOf (ap_prc)),
+                               ARATELIA_OPUS_ENCODER_OUTPUT_PORT_INDEX, 0,
+                               &ap_prc->p_outhdr_))
+    {
+      if (ap_prc->p_outhdr_)
+        {
+          TIZ_TRACE (handleOf (ap_prc), "Claimed OUTPUT HEADER [%p]...",
+                     ap_prc->p_outhdr_);
+          ap_prc->p_outhdr_->nFilledLen = 0;
+          ap_prc->p_outhdr_->nOffset = 0;
+          ap_prc->p_outhdr_->nFlags = 0;
+          rc = true;
+        }
+    }
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+release_output (opuse_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_out = NULL;
+  assert (ap_prc);
+  assert (ap_prc->p_outhdr_);
+  p_out = ap_prc->p_outhdr_;
+  ap_prc->p_outhdr_ = NULL;
+  return tiz_krn_release_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                 ARATELIA_OPUS_ENCODER_OUTPUT_PORT_INDEX,
+                                 p_out);
+}
+
+/* The first output buffer of a stream is a codec config buffer with the
+ * OpusHead (RFC 7845, section 5.1). Its pre-skip is the encoder's lookahead,
+ * which the decoder must discard from the start of the stream. */
+static OMX_ERRORTYPE
+send_opus_head (opuse_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_out = NULL;
+  OMX_U8 * p_data = NULL;
+  /* The rate of the original input, which may have been resampled */
+  const OMX_U32 rate = ap_prc->pcmmode_.nSamplingRate;
+  /* pre-skip is always counted in 48 kHz samples */
+  const OMX_U32 pre_skip
+    = ((OMX_U64) ap_prc->lookahead_ * 48000) / ap_prc->enc_rate_;
+
+  assert (ap_prc);
+  assert (ap_prc->p_outhdr_);
+  assert (ap_prc->p_outhdr_->nAllocLen >= OPUSE_OPUS_HEAD_SIZE);
+
+  p_out = ap_prc->p_outhdr_;
+  p_data = p_out->pBuffer;
+  memcpy (p_data, "OpusHead", 8);
+  p_data[8] = 1; /* version */
+  p_data[9] = ap_prc->pcmmode_.nChannels;
+  p_data[10] = pre_skip & 0xff;
+  p_data[11] = (pre_skip >> 8) & 0xff;
+  p_data[12] = rate & 0xff; /* input sample rate */
+  p_data[13] = (rate >> 8) & 0xff;
+  p_data[14] = (rate >> 16) & 0xff;
+  p_data[15] = (rate >> 24) & 0xff;
+  p_data[16] = 0; /* output gain */
+  p_data[17] = 0;
+  p_data[18] = 0; /* channel mapping family */
+
+  p_out->nFilledLen = OPUSE_OPUS_HEAD_SIZE;
+  p_out->nTimeStamp = 0;
+  p_out->nFlags |= OMX_BUFFERFLAG_CODECCONFIG;
+  ap_prc->head_sent_ = true;
+
+  TIZ_TRACE (handleOf (ap_prc), "OpusHead : pre-skip [%d]", pre_skip);
+  return release_output (ap_prc);
+}
+
+/* Encodes the pending frame into the output buffer held and releases it;
+ * each output buffer carries exactly one Opus packet, which is what the
+ * ogg muxer expects. A partial frame is padded with silence. */
+static OMX_ERRORTYPE
+encode_frame (opuse_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_out = NULL;
+  const int channels = ap_prc->pcmmode_.nChannels;
+  opus_int32 nbytes = 0;
+
+  assert (ap_prc);
+  assert (ap_prc->p_outhdr_);
+  assert (ap_prc->p_opus_enc_);
+
+  p_out = ap_prc->p_outhdr_;
+
+  if (ap_prc->frame_fill_ < ap_prc->frame_size_)
+    {
+      memset (ap_prc->p_frame_ + ap_prc->frame_fill_ * channels, 0,
+              (ap_prc->frame_size_ - ap_prc->frame_fill_) * channels
+                * sizeof (opus_int16));
+    }
+
+  nbytes = opus_encode (ap_prc->p_opus_enc_, ap_prc->p_frame_,
+                        ap_prc->frame_size_, p_out->pBuffer,
+                        (opus_int32) p_out->nAllocLen);
+  if (nbytes < 0)
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorInsufficientResources] : opus_encode : [%s]",
+                 opus_strerror (nbytes));
+      return OMX_ErrorInsufficientResources;
+    }
+
+  p_out->nFilledLen = nbytes;
+  p_out->nTimeStamp
+    = (OMX_TICKS) ((ap_prc->samples_out_ * 1000000) / ap_prc->enc_rate_);
+  ap_prc->samples_out_ += ap_prc->frame_size_;
+  ap_prc->frame_fill_ = 0;
+
+  return release_output (ap_prc);
+}
+
+/* The stream ends with an empty EOS buffer stamped with the time at which the
+ * input pcm ended, so that the muxer can trim the padding off the last
+ * packet */
+static OMX_ERRORTYPE
+send_eos (opuse_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_out = NULL;
+
+  assert (ap_prc);
+  assert (ap_prc->p_outhdr_);
+
+  p_out = ap_prc->p_outhdr_;
+  p_out->nFilledLen = 0;
+  p_out->nTimeStamp = (OMX_TICKS) (
+    (ap_prc->samples_in_ * 1000000) / ap_prc->pcmmode_.nSamplingRate);
+  p_out->nFlags |= OMX_BUFFERFLAG_EOS;
+
+  TIZ_TRACE (handleOf (ap_prc), "Propagating EOS on OUTPUT HEADER [%p]",
+             p_out);
+  return release_output (ap_prc);
+}
+
+/* Appends pcm, or silence if ap_pcm is NULL, to the pending frame,
+ * resampling it on the way if needed; returns the number of input samples
+ * per channel consumed */
+static size_t
+append_to_frame (opuse_prc_t * ap_prc, const opus_int16 * ap_pcm,
+                 const size_t a_nsamples)
+{
+  const int channels = ap_prc->pcmmode_.nChannels;
+  opus_int16 * p_dst = NULL;
+  spx_uint32_t in_len = a_nsamples;
+  spx_uint32_t out_len = 0;
+
+  assert (ap_prc);
+  assert (ap_prc->frame_fill_ < ap_prc->frame_size_);
+
+  p_dst = ap_prc->p_frame_ + ap_prc->frame_fill_ * channels;
+  out_len = ap_prc->frame_size_ - ap_prc->frame_fill_;
+
+  if (!ap_prc->p_resampler_)
+    {
+      out_len = in_len = MIN (in_len, out_len);
+      if (ap_pcm)
+        {
+          memcpy (p_dst, ap_pcm, in_len * channels * sizeof (opus_int16));
+        }
+      else
+        {
+          memset (p_dst, 0, in_len * channels * sizeof (opus_int16));
+        }
+    }
+  else
+    {
+      const int err = speex_resampler_process_interleaved_int (
+        ap_prc->p_resampler_, ap_pcm, &in_len, p_dst, &out_len);
+      if (RESAMPLER_ERR_SUCCESS != err)
+        {
+          TIZ_WARN (handleOf (ap_prc), "speex_resampler : [%s]",
+                    speex_resampler_strerror (err));
+        }
+    }
+
+  ap_prc->frame_fill_ += out_len;
+  return in_len;
+}
+
+/* Moves pcm from the input buffer held into the pending frame. A sample
+ * frame split across two input buffers is carried over in partial_. */
+static OMX_ERRORTYPE
+fill_frame (opuse_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_in = NULL;
+  const size_t frame_len = ap_prc->pcmmode_.nChannels * sizeof (opus_int16);
+  size_t nsamples = 0;
+
+  assert (ap_prc);
+  assert (ap_prc->p_inhdr_);
+  assert (frame_len <= sizeof (ap_prc->partial_));
+
+  p_in = ap_prc->p_inhdr_;
+
+  if (ap_prc->partial_len_ > 0)
+    {
+      const size_t len
+        = MIN (frame_len - ap_prc->partial_len_, (size_t) p_in->nFilledLen);
+      memcpy (ap_prc->partial_ + ap_prc->partial_len_,
+              p_in->pBuffer + p_in->nOffset, len);
+      ap_prc->partial_len_ += len;
+      p_in->nOffset += len;
+      p_in->nFilledLen -= len;
+      if (ap_prc->partial_len_ == frame_len)
+        {
+          opus_int16 sample[OPUSE_MAX_SAMPLE_FRAME_SIZE / sizeof (opus_int16)];
+          memcpy (sample, ap_prc->partial_, frame_len);
+          /* This is retried on the next call if there was no room */
+          if (append_to_frame (ap_prc, sample, 1) > 0)
+            {
+              ap_prc->partial_len_ = 0;
+              ap_prc->samples_in_ += 1;
+            }
+          return OMX_ErrorNone;
+        }
+    }
+  else
+    {
+      nsamples = append_to_frame (
+        ap_prc, (const opus_int16 *) (p_in->pBuffer + p_in->nOffset),
+        p_in->nFilledLen / frame_len);
+      ap_prc->samples_in_ += nsamples;
+      p_in->nOffset += nsamples * frame_len;
+      p_in->nFilledLen -= nsamples * frame_len;
+    }
+
+  if (p_in->nFilledLen < frame_len)
+    {
+      if (p_in->nFilledLen > 0)
+        {
+          assert (0 == ap_prc->partial_len_);
+          memcpy (ap_prc->partial_, p_in->pBuffer + p_in->nOffset,
+                  p_in->nFilledLen);
+          ap_prc->partial_len_ = p_in->nFilledLen;
+        }
+      if (p_in->nFlags & OMX_BUFFERFLAG_EOS)
+        {
+          TIZ_TRACE (handleOf (ap_prc), "EOS received on INPUT HEADER [%p]",
+                     p_in);
+          if (ap_prc->partial_len_ > 0)
+            {
+              TIZ_DEBUG (handleOf (ap_prc),
+                         "Discarding [%d] bytes of an incomplete sample "
+                         "frame at EOS",
+                         ap_prc->partial_len_);
+              ap_prc->partial_len_ = 0;
+            }
+          /* The resampler still holds the last input samples in its
+             filter; zeros are fed through it to get them out */
+          ap_prc->drain_left_
+            = ap_prc->p_resampler_
+                ? speex_resampler_get_input_latency (ap_prc->p_resampler_)
+                : 0;
+          ap_prc->eos_ = true;
+        }
+      p_in->nFilledLen = 0;
+      p_in->nOffset = 0;
+      ap_prc->p_inhdr_ = NULL;
+      tiz_check_omx (
+        tiz_krn_release_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                ARATELIA_OPUS_ENCODER_INPUT_PORT_INDEX, p_in));
+    }
+
+  return OMX_ErrorNone;
+}
+
+/*
+ * opuseprc
+ */
+
+static void *
+opuse_proc_ctor (void * ap_obj, va_list * app)
+{
+  opuse_prc_t * p_prc = super_ctor (typeOf (ap_obj, "opuseprc"), ap_obj, app);
+  assert (p_prc);
+  p_prc->p_opus_enc_ = NULL;
+  p_prc->p_resampler_ = NULL;
+  p_prc->enc_rate_ = 0;
+  p_prc->drain_left_ = 0;
+  p_prc->p_inhdr_ = NULL;
+  p_prc->p_outhdr_ = NULL;
+  p_prc->p_frame_ = NULL;
+  p_prc->frame_size_ = 0;
+  p_prc->frame_fill_ = 0;
+  p_prc->partial_len_ = 0;
+  p_prc->samples_in_ = 0;
+  p_prc->samples_out_ = 0;
+  p_prc->lookahead_ = 0;
+  p_prc->head_sent_ = false;
+  p_prc->eos_ = false;
+  return p_prc;
+}
+
+static void *
+opuse_proc_dtor (void * ap_obj)
+{
+  destroy_encoder (ap_obj);
+  return super_dtor (typeOf (ap_obj, "opuseprc"), ap_obj);
+}
+
+/*
+ * from tiz_srv class
+ */
+
+static OMX_ERRORTYPE
+opuse_proc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
+{
+  TIZ_TRACE (handleOf (ap_obj), "libopus version [%s]",
+             opus_get_version_string ());
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+opuse_proc_deallocate_resources (void * ap_obj)
+{
+  destroy_encoder (ap_obj);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+opuse_proc_prepare_to_transfer (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  opuse_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+
+  /* Settings may have changed since the last run */
+  destroy_encoder (p_prc);
+  tiz_check_omx (retrieve_settings (p_prc));
+  tiz_check_omx (create_encoder (p_prc));
+  reset_stream (p_prc);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+opuse_proc_transfer_and_process (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+opuse_proc_stop_and_return (void * ap_obj)
+{
+  opuse_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  reset_stream (p_prc);
+  return release_buffers (p_prc);
+}
+
+/*
+ * from tiz_prc class
+ */
+
+static OMX_ERRORTYPE
+opuse_proc_buffers_ready (const void * ap_obj)
+{
+  opuse_prc_t * p_prc = (opuse_prc_t *) ap_obj;
+  assert (p_prc);
+
+  if (!p_prc->p_opus_enc_)
+    {
+      return OMX_ErrorNone;
+    }
+
+  while (p_prc->p_outhdr_ || claim_output (p_prc))
+    {
+      if (!p_prc->head_sent_)
+        {
+          tiz_check_omx (send_opus_head (p_prc));
+        }
+      else if (p_prc->frame_fill_ == p_prc->frame_size_)
+        {
+          tiz_check_omx (encode_frame (p_prc));
+        }
+      else if (p_prc->eos_)
+        {
+          /* samples_in_ counted at the rate the encoder runs at */
+          const OMX_U64 samples_in
+            = (p_prc->samples_in_ * p_prc->enc_rate_)
+              / p_prc->pcmmode_.nSamplingRate;
+          if (p_prc->drain_left_ > 0)
+            {
+              p_prc->drain_left_
+                -= append_to_frame (p_prc, NULL, p_prc->drain_left_);
+            }
+          else if (p_prc->samples_out_ < samples_in + p_prc->lookahead_)
+            {
+              /* The decoder drops the first lookahead samples, so the last
+                 ones only come out if enough (silent) frames follow them */
+              tiz_check_omx (encode_frame (p_prc));
+            }
+          else
+            {
+              tiz_check_omx (send_eos (p_prc));
+              reset_stream (p_prc);
+            }
+        }
+      else if (p_prc->p_inhdr_ || claim_input (p_prc))
+        {
+          tiz_check_omx (fill_frame (p_prc));
+        }
+      else
+        {
+          break;
+        }
+    }
+
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+opuse_proc_port_flush (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  opuse_prc_t * p_prc = (opuse_prc_t *) ap_obj;
+  reset_stream (p_prc);
+  /* Release all buffers, regardless of the port this is received on */
+  return release_buffers (p_prc);
+}
+
+static OMX_ERRORTYPE
+opuse_proc_port_disable (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  /* Release all buffers, regardless of the port this is received on */
+  return release_buffers ((opuse_prc_t *) ap_obj);
+}
+
+static OMX_ERRORTYPE
+opuse_proc_port_enable (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  return OMX_ErrorNone;
+}
+
+/*
+ * opuse_prc_class
+ */
+
+static void *
+opuse_prc_class_ctor (void * ap_obj, va_list * app)
+{
+  /* NOTE: Class methods might be added in the future. None for now. */
+  return super_ctor (typeOf (ap_obj, "opuseprc_class"), ap_obj, app);
+}
+
+/*
+ * initialization
+ */
+
+void *
+opuse_prc_class_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizprc = tiz_get_type (ap_hdl, "tizprc");
+  void * opuseprc_class = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (classOf (tizprc), "opuseprc_class", classOf (tizprc),
+     sizeof (opuse_prc_class_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, opuse_prc_class_ctor,
+     /* TIZ_CLASS_COMMENT: stop value */
+     0);
+  return opuseprc_class;
+}
+
+void *
+opuse_prc_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizprc = tiz_get_type (ap_hdl, "tizprc");
+  void * opuseprc_class = tiz_get_type (ap_hdl, "opuseprc_class");
+  TIZ_LOG_CLASS (opuseprc_class);
+  void * opuseprc = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (opuseprc_class, "opuseprc", tizprc, sizeof (opuse_prc_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, opuse_proc_ctor,
+     /* TIZ_CLASS_COMMENT: class destructor */
+     dtor, opuse_proc_dtor,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_allocate_resources, opuse_proc_allocate_resources,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_deallocate_resources, opuse_proc_deallocate_resources,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_prepare_to_transfer, opuse_proc_prepare_to_transfer,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_transfer_and_process, opuse_proc_transfer_and_process,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_stop_and_return, opuse_proc_stop_and_return,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_buffers_ready, opuse_proc_buffers_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_flush, opuse_proc_port_flush,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_disable, opuse_proc_port_disable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_enable, opuse_proc_port_enable,
+     /* TIZ_CLASS_COMMENT: stop value */
+     0);
+
+  return opuseprc;
+}
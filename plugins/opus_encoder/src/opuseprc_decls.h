@@ -0,0 +1,90 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   opuseprc_decls.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Opus Encoder processor class decls
+ *
+ *
+ */
+
+#ifndef OPUSEPRC_DECLS_H
+#define OPUSEPRC_DECLS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+#include <opus.h>
+#include <speex/speex_resampler.h>
+
+#include <OMX_Core.h>
+#include <OMX_TizoniaExt.h>
+
+#include "tizprc_decls.h"
+
+/* The largest pcm sample frame taken, i.e. 16-bit stereo */
+#define OPUSE_MAX_SAMPLE_FRAME_SIZE 4
+
+typedef struct opuse_prc opuse_prc_t;
+struct opuse_prc
+{
+  /* Object */
+  const tiz_prc_t _;
+  OMX_AUDIO_PARAM_PCMMODETYPE pcmmode_;
+  OMX_TIZONIA_AUDIO_PARAM_OPUSTYPE opustype_;
+  OpusEncoder * p_opus_enc_;
+  /* Only for the rates libopus doesn't take */
+  SpeexResamplerState * p_resampler_;
+  OMX_U32 enc_rate_;        /* the rate the encoder runs at */
+  spx_uint32_t drain_left_; /* zeros still to push through the resampler */
+  OMX_BUFFERHEADERTYPE * p_inhdr_;
+  OMX_BUFFERHEADERTYPE * p_outhdr_;
+  /* One frame worth of interleaved pcm */
+  opus_int16 * p_frame_;
+  int frame_size_;      /* samples per channel in a frame */
+  int frame_fill_;      /* samples per channel currently in p_frame_ */
+  /* A sample frame split across input buffers */
+  OMX_U8 partial_[OPUSE_MAX_SAMPLE_FRAME_SIZE];
+  size_t partial_len_;
+  OMX_U64 samples_in_;  /* samples per channel received so far, at the
+                           input rate */
+  OMX_U64 samples_out_; /* samples per channel encoded so far */
+  opus_int32 lookahead_; /* encoder delay, in samples per channel */
+  bool head_sent_;
+  bool eos_;
+};
+
+typedef struct opuse_prc_class opuse_prc_class_t;
+struct opuse_prc_class
+{
+  /* Class */
+  const tiz_prc_class_t _;
+  /* NOTE: Class methods might be added in the future */
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OPUSEPRC_DECLS_H */
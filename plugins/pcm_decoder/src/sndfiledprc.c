@@ -89,17 +89,18 @@ release_in_hdr (sndfiled_prc_t * ap_prc)
 }
 
 OMX_ERRORTYPE
-release_out_hdr (sndfiled_prc_t * ap_prc)
+release_out_hdr (sndfiled_prc_t * ap_prc, const bool a_eos)
 {
   OMX_BUFFERHEADERTYPE * p_out = tiz_filter_prc_get_header (
     ap_prc, ARATELIA_PCM_DECODER_OUTPUT_PORT_INDEX);
   assert (ap_prc);
   if (p_out)
     {
-      if (tiz_filter_prc_is_eos (ap_prc))
+      if (a_eos)
         {
           TIZ_TRACE (handleOf (ap_prc), "Propagating EOS flag");
           tiz_util_set_eos_flag (p_out);
+          tiz_filter_prc_update_eos_flag (ap_prc, false);
         }
       TIZ_TRACE (handleOf (ap_prc),
                  "Releasing OUT HEADER [%p] nFilledLen [%d] nAllocLen [%d]",
@@ -184,6 +185,57 @@ sf_io_seek (sf_count_t offset, int whence, void * user_data)
   return EBADF;
 }
 
+/* Once the header has been parsed, reads are served from whatever is left
+   in the store, and then straight from the input buffers */
+static sf_count_t
+read_from_input (sndfiled_prc_t * ap_prc, void * ap_ptr, sf_count_t count)
+{
+  OMX_BUFFERHEADERTYPE * p_in = NULL;
+  sf_count_t bytes_read = 0;
+  sf_count_t n = 0;
+
+  assert (ap_prc);
+  assert (ap_ptr);
+
+  n = MIN (count, tiz_buffer_available (ap_prc->p_store_));
+  if (n > 0)
+    {
+      memcpy (ap_ptr, tiz_buffer_get (ap_prc->p_store_), n);
+      tiz_buffer_advance (ap_prc->p_store_, n);
+      bytes_read += n;
+    }
+
+  while (bytes_read < count && (p_in = get_in_hdr (ap_prc)))
+    {
+      n = MIN (count - bytes_read, (sf_count_t) p_in->nFilledLen);
+      memcpy ((OMX_U8 *) ap_ptr + bytes_read, p_in->pBuffer + p_in->nOffset,
+              n);
+      p_in->nOffset += n;
+      p_in->nFilledLen -= n;
+      bytes_read += n;
+      if (0 == p_in->nFilledLen)
+        {
+          (void) release_in_hdr (ap_prc);
+        }
+    }
+
+  /* Never hand over part of a frame of uncompressed data, as libsndfile
+     would drop it; keep it for the next read */
+  if (bytes_read < count && ap_prc->in_frame_size_ > 1)
+    {
+      const sf_count_t partial = bytes_read % ap_prc->in_frame_size_;
+      if (partial > 0)
+        {
+          bytes_read -= partial;
+          (void) tiz_buffer_push (ap_prc->p_store_,
+                                  (OMX_U8 *) ap_ptr + bytes_read, partial);
+        }
+    }
+
+  ap_prc->stream_pos_ += bytes_read;
+  return bytes_read;
+}
+
 static sf_count_t
 sf_io_read (void * ap_ptr, sf_count_t count, void * user_data)
 {
@@ -193,27 +245,23 @@ sf_io_read (void * ap_ptr, sf_count_t count, void * user_data)
   assert (ap_ptr);
   assert (p_prc);
 
-  if (!tiz_filter_prc_is_eos (p_prc) && store_data (p_prc)
-      && tiz_buffer_available (p_prc->p_store_) > 0)
+  if (p_prc->decoder_inited_)
+    {
+      bytes_read = read_from_input (p_prc, ap_ptr, count);
+    }
+  else if (!tiz_filter_prc_is_eos (p_prc) && store_data (p_prc)
+           && tiz_buffer_available (p_prc->p_store_) > 0)
     {
-      TIZ_TRACE (handleOf (p_prc),
-                 "count [%d] decoder_inited_ [%s] store bytes [%d] offset [%d]",
-                 count, (p_prc->decoder_inited_ ? "YES" : "NO"),
-                 tiz_buffer_available (p_prc->p_store_), p_prc->store_offset_);
+      /* While the header is being parsed, the data is kept in the store, as
+         libsndfile may need to go over it again if the open fails */
+      TIZ_TRACE (handleOf (p_prc), "count [%d] store bytes [%d] offset [%d]",
+                 count, tiz_buffer_available (p_prc->p_store_),
+                 p_prc->store_offset_);
       bytes_read = MIN (
         count, tiz_buffer_available (p_prc->p_store_) - p_prc->store_offset_);
       memcpy (ap_ptr, tiz_buffer_get (p_prc->p_store_) + p_prc->store_offset_,
               bytes_read);
-      if (p_prc->decoder_inited_)
-        {
-          tiz_buffer_advance (p_prc->p_store_,
-                              bytes_read + p_prc->store_offset_);
-          p_prc->store_offset_ = 0;
-        }
-      else
-        {
-          p_prc->store_offset_ += bytes_read;
-        }
+      p_prc->store_offset_ += bytes_read;
     }
   TIZ_TRACE (handleOf (p_prc), "Satisfied callback ? [%s]",
              (bytes_read == count ? "YES" : "NO"));
@@ -232,7 +280,161 @@ sf_io_tell (void * user_data)
 {
   sndfiled_prc_t * p_prc = (sndfiled_prc_t *) user_data;
   assert (p_prc);
-  return p_prc->store_offset_;
+  return p_prc->decoder_inited_ ? p_prc->stream_pos_
+                                : (sf_count_t) p_prc->store_offset_;
+}
+
+static sndfiled_sample_type_t
+native_sample_type (const SF_INFO * ap_info)
+{
+  assert (ap_info);
+  switch (ap_info->format & SF_FORMAT_SUBMASK)
+    {
+      case SF_FORMAT_PCM_24:
+        {
+          return ESndfiledSampleS24;
+        }
+      /* 32 bits on the output port means float, so that is also the widest
+         container available for 32-bit integer samples */
+      case SF_FORMAT_PCM_32:
+      case SF_FORMAT_FLOAT:
+      case SF_FORMAT_DOUBLE:
+        {
+          return ESndfiledSampleFloat;
+        }
+      default:
+        {
+          return ESndfiledSampleS16;
+        }
+    };
+}
+
+/* The size of a frame in the stream, for uncompressed formats, or 1 */
+static OMX_U32
+input_frame_size (const SF_INFO * ap_info)
+{
+  OMX_U32 sample_size = 1;
+  assert (ap_info);
+  switch (ap_info->format & SF_FORMAT_TYPEMASK)
+    {
+      case SF_FORMAT_FLAC:
+      case SF_FORMAT_OGG:
+        {
+          return 1;
+        }
+      default:
+        break;
+    };
+  switch (ap_info->format & SF_FORMAT_SUBMASK)
+    {
+      case SF_FORMAT_PCM_16:
+        {
+          sample_size = 2;
+        }
+        break;
+      case SF_FORMAT_PCM_24:
+        {
+          sample_size = 3;
+        }
+        break;
+      case SF_FORMAT_PCM_32:
+      case SF_FORMAT_FLOAT:
+        {
+          sample_size = 4;
+        }
+        break;
+      case SF_FORMAT_DOUBLE:
+        {
+          sample_size = 8;
+        }
+        break;
+      default:
+        {
+          /* 8-bit PCM, or compressed */
+          return 1;
+        }
+    };
+  return sample_size * ap_info->channels;
+}
+
+static size_t
+frame_size (const sndfiled_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  switch (ap_prc->sample_type_)
+    {
+      case ESndfiledSampleS24:
+        {
+          return 3 * ap_prc->sf_info_.channels;
+        }
+      case ESndfiledSampleFloat:
+        {
+          return sizeof (float) * ap_prc->sf_info_.channels;
+        }
+      default:
+        {
+          return sizeof (short int) * ap_prc->sf_info_.channels;
+        }
+    };
+}
+
+/* The space a frame takes while it is being read. 24-bit samples are read
+   as ints and packed in place afterwards */
+static size_t
+read_frame_size (const sndfiled_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  return ESndfiledSampleS24 == ap_prc->sample_type_
+           ? sizeof (int) * ap_prc->sf_info_.channels
+           : frame_size (ap_prc);
+}
+
+static OMX_ERRORTYPE
+update_pcm_mode (sndfiled_prc_t * ap_prc)
+{
+  OMX_U32 bits = 16;
+  assert (ap_prc);
+
+  /* With 32 bits, the renderers expect floats */
+  if (ESndfiledSampleS24 == ap_prc->sample_type_)
+    {
+      bits = 24;
+    }
+  else if (ESndfiledSampleFloat == ap_prc->sample_type_)
+    {
+      bits = 32;
+    }
+
+  TIZ_INIT_OMX_PORT_STRUCT (ap_prc->pcmmode_,
+                            ARATELIA_PCM_DECODER_OUTPUT_PORT_INDEX);
+  tiz_check_omx (
+    tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+                          OMX_IndexParamAudioPcm, &(ap_prc->pcmmode_)));
+
+  if ((OMX_U32) ap_prc->sf_info_.samplerate != ap_prc->pcmmode_.nSamplingRate
+      || (OMX_U32) ap_prc->sf_info_.channels != ap_prc->pcmmode_.nChannels
+      || bits != ap_prc->pcmmode_.nBitPerSample)
+    {
+      TIZ_DEBUG (handleOf (ap_prc),
+                 "Updating pcm mode : samplerate [%d] channels [%d] "
+                 "bits [%d]",
+                 ap_prc->sf_info_.samplerate, ap_prc->sf_info_.channels, bits);
+      ap_prc->pcmmode_.nSamplingRate = ap_prc->sf_info_.samplerate;
+      ap_prc->pcmmode_.nChannels = ap_prc->sf_info_.channels;
+      ap_prc->pcmmode_.nBitPerSample = bits;
+      ap_prc->pcmmode_.eNumData = OMX_NumericalDataSigned;
+      ap_prc->pcmmode_.eEndian = OMX_EndianLittle;
+      tiz_check_omx (tiz_krn_SetParameter_internal (
+        tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+        OMX_IndexParamAudioPcm, &(ap_prc->pcmmode_)));
+      tiz_srv_issue_event ((OMX_PTR) ap_prc, OMX_EventPortSettingsChanged,
+                           ARATELIA_PCM_DECODER_OUTPUT_PORT_INDEX,
+                           OMX_IndexParamAudioPcm, /* the index of the
+                                                      struct that has
+                                                      been modififed */
+                           NULL);
+    }
+  return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
@@ -260,6 +462,10 @@ open_sf (sndfiled_prc_t * ap_prc)
               SF_INFO * p = &(ap_prc->sf_info_);
               ap_prc->decoder_inited_ = true;
               tiz_buffer_advance (ap_prc->p_store_, ap_prc->store_offset_);
+              ap_prc->stream_pos_ = ap_prc->store_offset_;
+              ap_prc->store_offset_ = 0;
+              ap_prc->sample_type_ = native_sample_type (p);
+              ap_prc->in_frame_size_ = input_frame_size (p);
 
               TIZ_TRACE (handleOf (ap_prc), "frames [%d]", p->frames);
               TIZ_TRACE (handleOf (ap_prc), "samplerate [%d]", p->samplerate);
@@ -267,6 +473,7 @@ open_sf (sndfiled_prc_t * ap_prc)
               TIZ_TRACE (handleOf (ap_prc), "format [%d]", p->format);
               TIZ_TRACE (handleOf (ap_prc), "sections [%d]", p->sections);
               TIZ_TRACE (handleOf (ap_prc), "seekable [%d]", p->seekable);
+              rc = update_pcm_mode (ap_prc);
             }
         }
     }
@@ -274,28 +481,74 @@ open_sf (sndfiled_prc_t * ap_prc)
   return rc;
 }
 
+static sf_count_t
+read_frames (sndfiled_prc_t * ap_prc, OMX_U8 * ap_dst, const sf_count_t a_frames)
+{
+  sf_count_t num_frames = 0;
+  assert (ap_prc);
+  assert (ap_dst);
+
+  switch (ap_prc->sample_type_)
+    {
+      case ESndfiledSampleS24:
+        {
+          const int * p_samples = (const int *) ap_dst;
+          sf_count_t i = 0;
+          num_frames = sf_readf_int (ap_prc->p_sf_, (int *) ap_dst, a_frames);
+          /* libsndfile returns the samples left-justified in 32 bits; keep
+             the three most significant bytes, little endian, like the flac
+             decoder does. Writing never overtakes reading, so this can be
+             done in place. */
+          for (i = 0; i < num_frames * ap_prc->sf_info_.channels; ++i)
+            {
+              const unsigned int word32 = (unsigned int) p_samples[i];
+              ap_dst[3 * i] = (OMX_U8) (word32 >> 8);
+              ap_dst[3 * i + 1] = (OMX_U8) (word32 >> 16);
+              ap_dst[3 * i + 2] = (OMX_U8) (word32 >> 24);
+            }
+        }
+        break;
+      case ESndfiledSampleFloat:
+        {
+          num_frames = sf_readf_float (ap_prc->p_sf_, (float *) ap_dst,
+                                       a_frames);
+        }
+        break;
+      default:
+        {
+          num_frames = sf_readf_short (ap_prc->p_sf_, (short int *) ap_dst,
+                                       a_frames);
+        }
+        break;
+    };
+  return num_frames;
+}
+
 static OMX_ERRORTYPE
 transform_buffer (sndfiled_prc_t * ap_prc)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNotReady;
   OMX_BUFFERHEADERTYPE * p_out = get_out_hdr (ap_prc);
 
-  (void) store_data (ap_prc);
-
   assert (ap_prc);
   assert (ap_prc->p_sf_);
 
-  if (p_out && tiz_buffer_available (ap_prc->p_store_) > 0)
+  if (p_out
+      && (tiz_buffer_available (ap_prc->p_store_) > 0 || get_in_hdr (ap_prc)
+          || tiz_filter_prc_is_eos (ap_prc)))
     {
-      size_t frame_size = sizeof (short int) * ap_prc->sf_info_.channels;
-      sf_count_t read_frames = p_out->nAllocLen / frame_size;
-      sf_count_t num_frames = sf_readf_short (
-        ap_prc->p_sf_, (short int *) (p_out->pBuffer + p_out->nOffset),
-        read_frames);
-      p_out->nFilledLen = num_frames * frame_size;
-      if (num_frames > 0 || tiz_filter_prc_is_eos (ap_prc))
+      const size_t fsize = frame_size (ap_prc);
+      const sf_count_t max_frames
+        = p_out->nAllocLen / read_frame_size (ap_prc);
+      const sf_count_t num_frames
+        = read_frames (ap_prc, p_out->pBuffer + p_out->nOffset, max_frames);
+      /* A short read with no more input to come means we're done */
+      const bool eos
+        = num_frames < max_frames && tiz_filter_prc_is_eos (ap_prc);
+      p_out->nFilledLen = num_frames * fsize;
+      if (num_frames > 0 || eos)
         {
-          (void) release_out_hdr (ap_prc);
+          (void) release_out_hdr (ap_prc, eos);
         }
       rc = num_frames > 0 ? OMX_ErrorNone : OMX_ErrorNotReady;
     }
@@ -309,6 +562,9 @@ reset_stream_parameters (sndfiled_prc_t * ap_prc)
   ap_prc->decoder_inited_ = false;
   tiz_buffer_clear (ap_prc->p_store_);
   ap_prc->store_offset_ = 0;
+  ap_prc->stream_pos_ = 0;
+  ap_prc->sample_type_ = ESndfiledSampleS16;
+  ap_prc->in_frame_size_ = 1;
   tiz_filter_prc_update_eos_flag (ap_prc, false);
 }
 
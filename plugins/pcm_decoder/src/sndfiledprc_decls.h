@@ -40,6 +40,16 @@ extern "C" {
 #include <tizfilterprc.h>
 #include <tizfilterprc_decls.h>
 
+/* The sample format handed downstream, as close to the file's as the
+   renderer allows */
+typedef enum sndfiled_sample_type sndfiled_sample_type_t;
+enum sndfiled_sample_type
+{
+  ESndfiledSampleS16,
+  ESndfiledSampleS24, /* packed in 3 bytes */
+  ESndfiledSampleFloat
+};
+
 typedef struct sndfiled_prc sndfiled_prc_t;
 struct sndfiled_prc
 {
@@ -51,6 +61,10 @@ struct sndfiled_prc
   bool decoder_inited_;
   tiz_buffer_t * p_store_;
   OMX_U32 store_offset_;
+  sf_count_t stream_pos_;
+  sndfiled_sample_type_t sample_type_;
+  OMX_U32 in_frame_size_;
+  OMX_AUDIO_PARAM_PCMMODETYPE pcmmode_;
 };
 
 typedef struct sndfiled_prc_class sndfiled_prc_class_t;
@@ -0,0 +1,210 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   eq.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM equalizer component
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <string.h>
+
+#include <OMX_Core.h>
+#include <OMX_Component.h>
+#include <OMX_Types.h>
+
+#include <tizplatform.h>
+
+#include <tizport.h>
+#include <tizscheduler.h>
+
+#include "eqport.h"
+#include "eqprc.h"
+#include "eq.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.pcm_equalizer"
+#endif
+
+/**
+ *@defgroup libtizpcmeq 'libtizpcmeq' : OpenMAX IL PCM equalizer
+ *
+ * - Component name : "OMX.Aratelia.audio_processor.pcm.equalizer"
+ * - Implements role: "audio_processor.pcm.equalizer"
+ *
+ *@ingroup plugins
+ */
+
+static OMX_VERSIONTYPE pcm_equalizer_version = {{1, 0, 0, 0}};
+
+static void
+init_pcm_structs (const OMX_U32 a_pid, OMX_AUDIO_PARAM_PCMMODETYPE * ap_pcmmode,
+                  OMX_AUDIO_CONFIG_VOLUMETYPE * ap_volume,
+                  OMX_AUDIO_CONFIG_MUTETYPE * ap_mute)
+{
+  assert (ap_pcmmode);
+  assert (ap_volume);
+  assert (ap_mute);
+
+  ap_pcmmode->nSize = sizeof (OMX_AUDIO_PARAM_PCMMODETYPE);
+  ap_pcmmode->nVersion.nVersion = OMX_VERSION;
+  ap_pcmmode->nPortIndex = a_pid;
+  ap_pcmmode->nChannels = 2;
+  ap_pcmmode->eNumData = OMX_NumericalDataSigned;
+  ap_pcmmode->eEndian = OMX_EndianLittle;
+  ap_pcmmode->bInterleaved = OMX_TRUE;
+  ap_pcmmode->nBitPerSample = 16;
+  ap_pcmmode->nSamplingRate = 48000;
+  ap_pcmmode->ePCMMode = OMX_AUDIO_PCMModeLinear;
+  ap_pcmmode->eChannelMapping[0] = OMX_AUDIO_ChannelLF;
+  ap_pcmmode->eChannelMapping[1] = OMX_AUDIO_ChannelRF;
+
+  ap_volume->nSize = sizeof (OMX_AUDIO_CONFIG_VOLUMETYPE);
+  ap_volume->nVersion.nVersion = OMX_VERSION;
+  ap_volume->nPortIndex = a_pid;
+  ap_volume->bLinear = OMX_FALSE;
+  ap_volume->sVolume.nValue = 50;
+  ap_volume->sVolume.nMin = 0;
+  ap_volume->sVolume.nMax = 100;
+
+  ap_mute->nSize = sizeof (OMX_AUDIO_CONFIG_MUTETYPE);
+  ap_mute->nVersion.nVersion = OMX_VERSION;
+  ap_mute->nPortIndex = a_pid;
+  ap_mute->bMute = OMX_FALSE;
+}
+
+static OMX_PTR
+instantiate_input_port (OMX_HANDLETYPE ap_hdl)
+{
+  OMX_AUDIO_PARAM_PCMMODETYPE pcmmode;
+  OMX_AUDIO_CONFIG_VOLUMETYPE volume;
+  OMX_AUDIO_CONFIG_MUTETYPE mute;
+  OMX_AUDIO_CODINGTYPE encodings[] = {OMX_AUDIO_CodingPCM, OMX_AUDIO_CodingMax};
+  tiz_port_options_t pcm_port_opts = {
+    OMX_PortDomainAudio,
+    OMX_DirInput,
+    ARATELIA_PCM_EQUALIZER_PORT_MIN_BUF_COUNT,
+    ARATELIA_PCM_EQUALIZER_PORT_MIN_BUF_SIZE,
+    ARATELIA_PCM_EQUALIZER_PORT_NONCONTIGUOUS,
+    ARATELIA_PCM_EQUALIZER_PORT_ALIGNMENT,
+    ARATELIA_PCM_EQUALIZER_PORT_SUPPLIERPREF,
+    {ARATELIA_PCM_EQUALIZER_INPUT_PORT_INDEX, NULL, NULL, NULL},
+    1 /* slave port */
+  };
+
+  init_pcm_structs (ARATELIA_PCM_EQUALIZER_INPUT_PORT_INDEX, &pcmmode, &volume,
+                    &mute);
+
+  /* The input port is the one that carries the equalizer settings */
+  return factory_new (tiz_get_type (ap_hdl, "eqport"), &pcm_port_opts,
+                      &encodings, &pcmmode, &volume, &mute);
+}
+
+static OMX_PTR
+instantiate_output_port (OMX_HANDLETYPE ap_hdl)
+{
+  OMX_AUDIO_PARAM_PCMMODETYPE pcmmode;
+  OMX_AUDIO_CONFIG_VOLUMETYPE volume;
+  OMX_AUDIO_CONFIG_MUTETYPE mute;
+  OMX_AUDIO_CODINGTYPE encodings[] = {OMX_AUDIO_CodingPCM, OMX_AUDIO_CodingMax};
+  tiz_port_options_t pcm_port_opts = {
+    OMX_PortDomainAudio,
+    OMX_DirOutput,
+    ARATELIA_PCM_EQUALIZER_PORT_MIN_BUF_COUNT,
+    ARATELIA_PCM_EQUALIZER_PORT_MIN_BUF_SIZE,
+    ARATELIA_PCM_EQUALIZER_PORT_NONCONTIGUOUS,
+    ARATELIA_PCM_EQUALIZER_PORT_ALIGNMENT,
+    ARATELIA_PCM_EQUALIZER_PORT_SUPPLIERPREF,
+    {ARATELIA_PCM_EQUALIZER_OUTPUT_PORT_INDEX, NULL, NULL, NULL},
+    0 /* Master port */
+  };
+
+  init_pcm_structs (ARATELIA_PCM_EQUALIZER_OUTPUT_PORT_INDEX, &pcmmode,
+                    &volume, &mute);
+
+  return factory_new (tiz_get_type (ap_hdl, "tizpcmport"), &pcm_port_opts,
+                      &encodings, &pcmmode, &volume, &mute);
+}
+
+static OMX_PTR
+instantiate_config_port (OMX_HANDLETYPE ap_hdl)
+{
+  return factory_new (tiz_get_type (ap_hdl, "tizconfigport"),
+                      NULL, /* this port does not take options */
+                      ARATELIA_PCM_EQUALIZER_COMPONENT_NAME,
+                      pcm_equalizer_version);
+}
+
+static OMX_PTR
+instantiate_processor (OMX_HANDLETYPE ap_hdl)
+{
+  return factory_new (tiz_get_type (ap_hdl, "eqprc"));
+}
+
+OMX_ERRORTYPE
+OMX_ComponentInit (OMX_HANDLETYPE ap_hdl)
+{
+  tiz_role_factory_t role_factory;
+  const tiz_role_factory_t * rf_list[] = {&role_factory};
+  tiz_type_factory_t eqprc_type;
+  tiz_type_factory_t eqport_type;
+  const tiz_type_factory_t * tf_list[] = {&eqprc_type, &eqport_type};
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE,
+           "OMX_ComponentInit: "
+           "Inititializing [%s]",
+           ARATELIA_PCM_EQUALIZER_COMPONENT_NAME);
+
+  strcpy ((OMX_STRING) role_factory.role, ARATELIA_PCM_EQUALIZER_DEFAULT_ROLE);
+  role_factory.pf_cport = instantiate_config_port;
+  role_factory.pf_port[0] = instantiate_input_port;
+  role_factory.pf_port[1] = instantiate_output_port;
+  role_factory.nports = 2;
+  role_factory.pf_proc = instantiate_processor;
+
+  strcpy ((OMX_STRING) eqprc_type.class_name, "eqprc_class");
+  eqprc_type.pf_class_init = eq_prc_class_init;
+  strcpy ((OMX_STRING) eqprc_type.object_name, "eqprc");
+  eqprc_type.pf_object_init = eq_prc_init;
+
+  strcpy ((OMX_STRING) eqport_type.class_name, "eqport_class");
+  eqport_type.pf_class_init = eq_port_class_init;
+  strcpy ((OMX_STRING) eqport_type.object_name, "eqport");
+  eqport_type.pf_object_init = eq_port_init;
+
+  /* Initialize the component infrastructure */
+  tiz_check_omx (tiz_comp_init (ap_hdl, ARATELIA_PCM_EQUALIZER_COMPONENT_NAME));
+
+  /* Register the "eqprc" and "eqport" classes */
+  tiz_check_omx (tiz_comp_register_types (ap_hdl, tf_list, 2));
+
+  /* Register the component role */
+  tiz_check_omx (tiz_comp_register_roles (ap_hdl, rf_list, 1));
+
+  return OMX_ErrorNone;
+}
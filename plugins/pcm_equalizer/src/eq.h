@@ -0,0 +1,70 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   eq.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM equalizer component constants
+ *
+ *
+ */
+#ifndef EQ_H
+#define EQ_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+#define ARATELIA_PCM_EQUALIZER_DEFAULT_ROLE "audio_processor.pcm.equalizer"
+#define ARATELIA_PCM_EQUALIZER_COMPONENT_NAME \
+  "OMX.Aratelia.audio_processor.pcm.equalizer"
+/* With libtizonia, port indexes must start at index 0 */
+#define ARATELIA_PCM_EQUALIZER_INPUT_PORT_INDEX 0
+#define ARATELIA_PCM_EQUALIZER_OUTPUT_PORT_INDEX 1
+#define ARATELIA_PCM_EQUALIZER_PORT_MIN_BUF_COUNT 2
+/* Assuming worst case of 16 bit per sample per channel and 48khz, lets try to
+   fit 25ms of audio (1200 samples per channel) */
+#define ARATELIA_PCM_EQUALIZER_PORT_MIN_BUF_SIZE (2 * 4800)
+#define ARATELIA_PCM_EQUALIZER_PORT_NONCONTIGUOUS OMX_FALSE
+#define ARATELIA_PCM_EQUALIZER_PORT_ALIGNMENT 0
+#define ARATELIA_PCM_EQUALIZER_PORT_SUPPLIERPREF OMX_BufferSupplyInput
+
+/* Ten octave bands, ISO 266 centre frequencies (Hz) */
+#define ARATELIA_PCM_EQUALIZER_NUM_BANDS 10
+#define ARATELIA_PCM_EQUALIZER_BAND_FREQS                                  \
+  {                                                                        \
+    31, 62, 125, 250, 500, 1000, 2000, 4000, 8000, 16000                   \
+  }
+/* Roughly one octave of bandwidth */
+#define ARATELIA_PCM_EQUALIZER_BAND_Q 1.41
+#define ARATELIA_PCM_EQUALIZER_MIN_FREQ 20
+#define ARATELIA_PCM_EQUALIZER_MAX_FREQ 20000
+/* Band levels are in millibels (1/100 dB) */
+#define ARATELIA_PCM_EQUALIZER_MIN_LEVEL -1200
+#define ARATELIA_PCM_EQUALIZER_MAX_LEVEL 1200
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EQ_H */
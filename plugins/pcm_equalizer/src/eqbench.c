@@ -0,0 +1,125 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   eqbench.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM equalizer micro-benchmark
+ *
+ * Reports the cost of the 10-band cascade per channel per 1024-sample block.
+ * Not built by default; use 'make eqbench'.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "eq.h"
+#include "eqbiquad.h"
+
+#define BENCH_BLOCK_FRAMES 1024
+#define BENCH_ITERATIONS 20000
+
+static double
+now_ns (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double
+bench (const unsigned int a_rate, const unsigned int a_channels)
+{
+  static const unsigned int freqs[] = ARATELIA_PCM_EQUALIZER_BAND_FREQS;
+  eq_coeffs_t coeffs[EQ_MAX_BANDS];
+  float gains[EQ_MAX_BANDS];
+  eq_cascade_t eq;
+  int16_t * p_pcm = NULL;
+  double start = 0;
+  double elapsed = 0;
+  unsigned int i = 0;
+
+  for (i = 0; i < ARATELIA_PCM_EQUALIZER_NUM_BANDS; ++i)
+    {
+      /* Alternate boosts and cuts so that every band is active */
+      gains[i] = (i % 2) ? -6.0f : 6.0f;
+      eq_peaking_coeffs (&coeffs[i], a_rate, freqs[i],
+                         ARATELIA_PCM_EQUALIZER_BAND_Q, gains[i]);
+    }
+
+  eq_cascade_init (&eq, a_channels);
+  eq_cascade_set_bands (&eq, coeffs, gains, ARATELIA_PCM_EQUALIZER_NUM_BANDS);
+
+  p_pcm = malloc (BENCH_BLOCK_FRAMES * a_channels * sizeof (int16_t));
+  if (!p_pcm)
+    {
+      return 0;
+    }
+  srand (a_rate);
+  for (i = 0; i < BENCH_BLOCK_FRAMES * a_channels; ++i)
+    {
+      p_pcm[i] = (int16_t) ((rand () % 20000) - 10000);
+    }
+
+  start = now_ns ();
+  for (i = 0; i < BENCH_ITERATIONS; ++i)
+    {
+      eq_cascade_process_s16 (&eq, p_pcm, p_pcm, BENCH_BLOCK_FRAMES);
+    }
+  elapsed = now_ns () - start;
+
+  free (p_pcm);
+  return elapsed / BENCH_ITERATIONS / a_channels;
+}
+
+int
+main (void)
+{
+  static const unsigned int rates[] = {44100, 48000, 96000};
+  static const unsigned int channels[] = {1, 2, 4, 6};
+  unsigned int r = 0;
+  unsigned int c = 0;
+
+  printf ("%d bands, %d lanes, ns per channel per %d-sample block\n",
+          ARATELIA_PCM_EQUALIZER_NUM_BANDS, EQ_LANES, BENCH_BLOCK_FRAMES);
+  printf ("%8s", "rate");
+  for (c = 0; c < sizeof (channels) / sizeof (channels[0]); ++c)
+    {
+      printf ("%10u ch", channels[c]);
+    }
+  printf ("\n");
+
+  for (r = 0; r < sizeof (rates) / sizeof (rates[0]); ++r)
+    {
+      printf ("%8u", rates[r]);
+      for (c = 0; c < sizeof (channels) / sizeof (channels[0]); ++c)
+        {
+          printf ("%13.0f", bench (rates[r], channels[c]));
+        }
+      printf ("\n");
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,271 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   eqbiquad.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM equalizer biquad cascade
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include "eqbiquad.h"
+
+/* Gains smaller than this (in dB) are treated as flat */
+#define EQ_FLAT_GAIN_DB 0.01f
+/* Delay elements below this are flushed to zero to avoid denormals on
+   silence */
+#define EQ_DENORMAL_THRESHOLD 1e-18f
+
+void
+eq_peaking_coeffs (eq_coeffs_t * ap_coeffs, double a_sample_rate,
+                   double a_freq, double a_q, double a_gain_db)
+{
+  assert (ap_coeffs);
+  assert (a_sample_rate > 0);
+  assert (a_q > 0);
+
+  if (a_freq <= 0 || a_freq >= 0.49 * a_sample_rate)
+    {
+      /* Band not representable at this sample rate; leave it flat */
+      ap_coeffs->b0 = 1.0f;
+      ap_coeffs->b1 = ap_coeffs->b2 = ap_coeffs->a1 = ap_coeffs->a2 = 0.0f;
+    }
+  else
+    {
+      /* RBJ Audio EQ Cookbook peaking filter, normalised by a0 */
+      const double A = pow (10.0, a_gain_db / 40.0);
+      const double w0 = 2.0 * M_PI * a_freq / a_sample_rate;
+      const double alpha = sin (w0) / (2.0 * a_q);
+      const double cosw0 = cos (w0);
+      const double a0 = 1.0 + alpha / A;
+      ap_coeffs->b0 = (float) ((1.0 + alpha * A) / a0);
+      ap_coeffs->b1 = (float) ((-2.0 * cosw0) / a0);
+      ap_coeffs->b2 = (float) ((1.0 - alpha * A) / a0);
+      ap_coeffs->a1 = (float) ((-2.0 * cosw0) / a0);
+      ap_coeffs->a2 = (float) ((1.0 - alpha / A) / a0);
+    }
+}
+
+void
+eq_cascade_init (eq_cascade_t * ap_eq, unsigned int a_nchannels)
+{
+  assert (ap_eq);
+  assert (a_nchannels > 0 && a_nchannels <= EQ_MAX_CHANNELS);
+  memset (ap_eq, 0, sizeof (eq_cascade_t));
+  ap_eq->nchannels = a_nchannels;
+}
+
+void
+eq_cascade_reset (eq_cascade_t * ap_eq)
+{
+  assert (ap_eq);
+  memset (ap_eq->state, 0, sizeof (ap_eq->state));
+}
+
+void
+eq_cascade_set_bands (eq_cascade_t * ap_eq, const eq_coeffs_t * ap_coeffs,
+                      const float * ap_gains_db, unsigned int a_nbands)
+{
+  unsigned int was_active[EQ_MAX_BANDS];
+  unsigned int i = 0;
+  unsigned int g = 0;
+
+  assert (ap_eq);
+  assert (ap_coeffs);
+  assert (ap_gains_db);
+  assert (a_nbands <= EQ_MAX_BANDS);
+
+  memset (was_active, 0, sizeof (was_active));
+  for (i = 0; i < ap_eq->nactive; ++i)
+    {
+      was_active[ap_eq->active[i]] = 1;
+    }
+
+  /* The delay lines of bands that stay active are preserved, so that a
+   * coefficient change does not produce a discontinuity; bands that become
+   * active start from silence. */
+  ap_eq->nactive = 0;
+  for (i = 0; i < a_nbands; ++i)
+    {
+      ap_eq->coeffs[i] = ap_coeffs[i];
+      if (fabsf (ap_gains_db[i]) >= EQ_FLAT_GAIN_DB
+          && ap_coeffs[i].b0 != 1.0f)
+        {
+          if (!was_active[i])
+            {
+              for (g = 0; g < EQ_MAX_GROUPS; ++g)
+                {
+                  memset (ap_eq->state[g][i], 0, sizeof (ap_eq->state[g][i]));
+                }
+            }
+          ap_eq->active[ap_eq->nactive++] = i;
+        }
+    }
+}
+
+int
+eq_cascade_is_bypassed (const eq_cascade_t * ap_eq)
+{
+  assert (ap_eq);
+  return 0 == ap_eq->nactive;
+}
+
+static void
+run_cascade (const eq_cascade_t * ap_eq, float (*ap_block)[EQ_LANES],
+             const size_t a_nframes, float (*ap_z)[2][EQ_LANES])
+{
+  eq_coeffs_t c[EQ_MAX_BANDS];
+  float z[EQ_MAX_BANDS][2][EQ_LANES];
+  const unsigned int nstages = ap_eq->nactive;
+  unsigned int s = 0;
+  size_t i = 0;
+  int l = 0;
+
+  for (s = 0; s < nstages; ++s)
+    {
+      c[s] = ap_eq->coeffs[ap_eq->active[s]];
+      memcpy (z[s], ap_z[ap_eq->active[s]], sizeof (z[s]));
+    }
+
+  /* All the stages are run on a frame before moving on to the next one.
+   * Each stage's recursion is latency bound, but consecutive stages on
+   * consecutive frames are independent, so the CPU can overlap them. */
+  for (i = 0; i < a_nframes; ++i)
+    {
+      float x[EQ_LANES];
+      for (l = 0; l < EQ_LANES; ++l)
+        {
+          x[l] = ap_block[i][l];
+        }
+      for (s = 0; s < nstages; ++s)
+        {
+          /* One iteration per lane; this is the loop that gets vectorised */
+          for (l = 0; l < EQ_LANES; ++l)
+            {
+              const float y = c[s].b0 * x[l] + z[s][0][l];
+              z[s][0][l] = c[s].b1 * x[l] - c[s].a1 * y + z[s][1][l];
+              z[s][1][l] = c[s].b2 * x[l] - c[s].a2 * y;
+              x[l] = y;
+            }
+        }
+      for (l = 0; l < EQ_LANES; ++l)
+        {
+          ap_block[i][l] = x[l];
+        }
+    }
+
+  for (s = 0; s < nstages; ++s)
+    {
+      float * p_z = ap_z[ap_eq->active[s]][0];
+      for (l = 0; l < 2 * EQ_LANES; ++l)
+        {
+          const float v = z[s][l / EQ_LANES][l % EQ_LANES];
+          p_z[l] = fabsf (v) < EQ_DENORMAL_THRESHOLD ? 0.0f : v;
+        }
+    }
+}
+
+static inline int16_t
+float_to_s16 (const float a_sample)
+{
+  const float f = a_sample * 32768.0f;
+  if (f >= 32767.0f)
+    {
+      return 32767;
+    }
+  if (f <= -32768.0f)
+    {
+      return -32768;
+    }
+  return (int16_t) lrintf (f);
+}
+
+void
+eq_cascade_process_s16 (eq_cascade_t * ap_eq, const int16_t * ap_in,
+                        int16_t * ap_out, size_t a_nframes)
+{
+  float block[EQ_BLOCK_FRAMES][EQ_LANES];
+  const unsigned int nch = ap_eq->nchannels;
+  size_t offset = 0;
+
+  assert (ap_eq);
+  assert (ap_in);
+  assert (ap_out);
+
+  if (eq_cascade_is_bypassed (ap_eq))
+    {
+      if (ap_in != ap_out)
+        {
+          memmove (ap_out, ap_in, a_nframes * nch * sizeof (int16_t));
+        }
+      return;
+    }
+
+  while (offset < a_nframes)
+    {
+      const size_t nframes = (a_nframes - offset) < EQ_BLOCK_FRAMES
+                               ? (a_nframes - offset)
+                               : EQ_BLOCK_FRAMES;
+      const int16_t * p_in = ap_in + offset * nch;
+      int16_t * p_out = ap_out + offset * nch;
+      unsigned int g = 0;
+
+      for (g = 0; g * EQ_LANES < nch; ++g)
+        {
+          const unsigned int c0 = g * EQ_LANES;
+          const unsigned int nlanes
+            = (nch - c0) < EQ_LANES ? (nch - c0) : EQ_LANES;
+          unsigned int l = 0;
+          size_t i = 0;
+
+          /* Interleaved s16 -> frame-major float lanes. Unused lanes are
+           * zero and simply ride along. */
+          for (i = 0; i < nframes; ++i)
+            {
+              for (l = 0; l < EQ_LANES; ++l)
+                {
+                  block[i][l] = l < nlanes
+                                  ? p_in[i * nch + c0 + l] * (1.0f / 32768.0f)
+                                  : 0.0f;
+                }
+            }
+
+          run_cascade (ap_eq, block, nframes, ap_eq->state[g]);
+
+          for (i = 0; i < nframes; ++i)
+            {
+              for (l = 0; l < nlanes; ++l)
+                {
+                  p_out[i * nch + c0 + l] = float_to_s16 (block[i][l]);
+                }
+            }
+        }
+      offset += nframes;
+    }
+}
@@ -0,0 +1,92 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   eqbiquad.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM equalizer biquad cascade
+ *
+ * Channels are processed in groups of EQ_LANES. Each group is transposed
+ * into a small frame-major scratch block so that the inner loop of every
+ * filter stage runs across channels (one SIMD vector per frame), which the
+ * compiler vectorises without intrinsics.
+ */
+
+#ifndef EQBIQUAD_H
+#define EQBIQUAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define EQ_MAX_BANDS 10
+#define EQ_MAX_CHANNELS 8
+#define EQ_LANES 4
+#define EQ_MAX_GROUPS ((EQ_MAX_CHANNELS + EQ_LANES - 1) / EQ_LANES)
+/* Frames per scratch block */
+#define EQ_BLOCK_FRAMES 256
+
+typedef struct eq_coeffs eq_coeffs_t;
+struct eq_coeffs
+{
+  float b0, b1, b2, a1, a2;
+};
+
+typedef struct eq_cascade eq_cascade_t;
+struct eq_cascade
+{
+  unsigned int nchannels;
+  eq_coeffs_t coeffs[EQ_MAX_BANDS];
+  /* Indexes of the bands that are not flat; flat bands are skipped */
+  unsigned int active[EQ_MAX_BANDS];
+  unsigned int nactive;
+  /* Transposed direct form II delay elements: [group][band][z1/z2][lane] */
+  float state[EQ_MAX_GROUPS][EQ_MAX_BANDS][2][EQ_LANES];
+};
+
+void
+eq_peaking_coeffs (eq_coeffs_t * ap_coeffs, double a_sample_rate,
+                   double a_freq, double a_q, double a_gain_db);
+
+void
+eq_cascade_init (eq_cascade_t * ap_eq, unsigned int a_nchannels);
+
+void
+eq_cascade_reset (eq_cascade_t * ap_eq);
+
+void
+eq_cascade_set_bands (eq_cascade_t * ap_eq, const eq_coeffs_t * ap_coeffs,
+                      const float * ap_gains_db, unsigned int a_nbands);
+
+int
+eq_cascade_is_bypassed (const eq_cascade_t * ap_eq);
+
+void
+eq_cascade_process_s16 (eq_cascade_t * ap_eq, const int16_t * ap_in,
+                        int16_t * ap_out, size_t a_nframes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EQBIQUAD_H */
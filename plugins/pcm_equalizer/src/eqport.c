@@ -0,0 +1,226 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   eqport.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM equalizer's specialised pcm port
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include "eq.h"
+#include "eqport.h"
+#include "eqport_decls.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.pcm_equalizer.port"
+#endif
+
+/*
+ * eqport class
+ */
+
+static void *
+eq_port_ctor (void * ap_obj, va_list * app)
+{
+  eq_port_t * p_obj = super_ctor (typeOf (ap_obj, "eqport"), ap_obj, app);
+  const OMX_U32 freqs[] = ARATELIA_PCM_EQUALIZER_BAND_FREQS;
+  assert (p_obj);
+
+  tiz_port_register_index (p_obj, OMX_IndexConfigAudioEqualizer);
+
+  p_obj->enabled_ = OMX_TRUE;
+  memcpy (p_obj->freqs_, freqs, sizeof (p_obj->freqs_));
+  memset (p_obj->levels_, 0, sizeof (p_obj->levels_));
+
+  return p_obj;
+}
+
+static void *
+eq_port_dtor (void * ap_obj)
+{
+  return super_dtor (typeOf (ap_obj, "eqport"), ap_obj);
+}
+
+/*
+ * from tiz_api
+ */
+
+static OMX_ERRORTYPE
+eq_port_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                   OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  const eq_port_t * p_obj = ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  TIZ_TRACE (ap_hdl, "[%s]...", tiz_idx_to_str (a_index));
+
+  assert (p_obj);
+
+  if (OMX_IndexConfigAudioEqualizer == a_index)
+    {
+      /* The band to be retrieved is selected by the client through
+       * sBandIndex.nValue */
+      OMX_AUDIO_CONFIG_EQUALIZERTYPE * p_eq
+        = (OMX_AUDIO_CONFIG_EQUALIZERTYPE *) ap_struct;
+      const OMX_U32 band = p_eq->sBandIndex.nValue;
+      if (band >= ARATELIA_PCM_EQUALIZER_NUM_BANDS)
+        {
+          rc = OMX_ErrorBadParameter;
+        }
+      else
+        {
+          p_eq->bEnable = p_obj->enabled_;
+          p_eq->sBandIndex.nMin = 0;
+          p_eq->sBandIndex.nMax = ARATELIA_PCM_EQUALIZER_NUM_BANDS - 1;
+          p_eq->sCenterFreq.nValue = p_obj->freqs_[band];
+          p_eq->sCenterFreq.nMin = ARATELIA_PCM_EQUALIZER_MIN_FREQ;
+          p_eq->sCenterFreq.nMax = ARATELIA_PCM_EQUALIZER_MAX_FREQ;
+          p_eq->sBandLevel.nValue = p_obj->levels_[band];
+          p_eq->sBandLevel.nMin = ARATELIA_PCM_EQUALIZER_MIN_LEVEL;
+          p_eq->sBandLevel.nMax = ARATELIA_PCM_EQUALIZER_MAX_LEVEL;
+        }
+    }
+  else
+    {
+      /* Delegate to the base port */
+      rc = super_GetConfig (typeOf (ap_obj, "eqport"), ap_obj, ap_hdl, a_index,
+                            ap_struct);
+    }
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+eq_port_SetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                   OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  eq_port_t * p_obj = (eq_port_t *) ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  TIZ_TRACE (ap_hdl, "[%s]...", tiz_idx_to_str (a_index));
+
+  assert (p_obj);
+
+  if (OMX_IndexConfigAudioEqualizer == a_index)
+    {
+      const OMX_AUDIO_CONFIG_EQUALIZERTYPE * p_eq
+        = (OMX_AUDIO_CONFIG_EQUALIZERTYPE *) ap_struct;
+      const OMX_U32 band = p_eq->sBandIndex.nValue;
+      if (band >= ARATELIA_PCM_EQUALIZER_NUM_BANDS
+          || p_eq->sCenterFreq.nValue < ARATELIA_PCM_EQUALIZER_MIN_FREQ
+          || p_eq->sCenterFreq.nValue > ARATELIA_PCM_EQUALIZER_MAX_FREQ
+          || p_eq->sBandLevel.nValue < ARATELIA_PCM_EQUALIZER_MIN_LEVEL
+          || p_eq->sBandLevel.nValue > ARATELIA_PCM_EQUALIZER_MAX_LEVEL)
+        {
+          TIZ_ERROR (ap_hdl,
+                     "[OMX_ErrorBadParameter] : band [%u] freq [%u] "
+                     "level [%d]",
+                     band, p_eq->sCenterFreq.nValue, p_eq->sBandLevel.nValue);
+          rc = OMX_ErrorBadParameter;
+        }
+      else
+        {
+          /* bEnable applies to the whole equalizer, not just this band */
+          p_obj->enabled_ = p_eq->bEnable;
+          p_obj->freqs_[band] = p_eq->sCenterFreq.nValue;
+          p_obj->levels_[band] = p_eq->sBandLevel.nValue;
+          TIZ_TRACE (ap_hdl, "band [%u] freq [%u] level [%d] enabled [%s]",
+                     band, p_obj->freqs_[band], p_obj->levels_[band],
+                     p_obj->enabled_ ? "TRUE" : "FALSE");
+        }
+    }
+  else
+    {
+      /* Delegate to the base port */
+      rc = super_SetConfig (typeOf (ap_obj, "eqport"), ap_obj, ap_hdl, a_index,
+                            ap_struct);
+    }
+
+  return rc;
+}
+
+/*
+ * eq_port_class
+ */
+
+static void *
+eq_port_class_ctor (void * ap_obj, va_list * app)
+{
+  /* NOTE: Class methods might be added in the future. None for now. */
+  return super_ctor (typeOf (ap_obj, "eqport_class"), ap_obj, app);
+}
+
+/*
+ * initialization
+ */
+
+void *
+eq_port_class_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizpcmport = tiz_get_type (ap_hdl, "tizpcmport");
+  void * eqport_class = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (classOf (tizpcmport), "eqport_class", classOf (tizpcmport),
+     sizeof (eq_port_class_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, eq_port_class_ctor,
+     /* TIZ_CLASS_COMMENT: stop value*/
+     0);
+  return eqport_class;
+}
+
+void *
+eq_port_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizpcmport = tiz_get_type (ap_hdl, "tizpcmport");
+  void * eqport_class = tiz_get_type (ap_hdl, "eqport_class");
+  TIZ_LOG_CLASS (eqport_class);
+  void * eqport = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (eqport_class, "eqport", tizpcmport, sizeof (eq_port_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, eq_port_ctor,
+     /* TIZ_CLASS_COMMENT: class destructor */
+     dtor, eq_port_dtor,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_GetConfig, eq_port_GetConfig,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_SetConfig, eq_port_SetConfig,
+     /* TIZ_CLASS_COMMENT: stop value*/
+     0);
+
+  return eqport;
+}
@@ -0,0 +1,64 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   eqport_decls.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM equalizer input port class decls
+ *
+ *
+ */
+
+#ifndef EQPORT_DECLS_H
+#define EQPORT_DECLS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <OMX_Types.h>
+
+#include <tizpcmport_decls.h>
+
+#include "eq.h"
+
+typedef struct eq_port eq_port_t;
+struct eq_port
+{
+  /* Object */
+  const tiz_pcmport_t _;
+  OMX_BOOL enabled_;
+  OMX_U32 freqs_[ARATELIA_PCM_EQUALIZER_NUM_BANDS];  /* Hz */
+  OMX_S32 levels_[ARATELIA_PCM_EQUALIZER_NUM_BANDS]; /* mB */
+};
+
+typedef struct eq_port_class eq_port_class_t;
+struct eq_port_class
+{
+  /* Class */
+  const tiz_pcmport_class_t _;
+  /* NOTE: Class methods might be added in the future */
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EQPORT_DECLS_H */
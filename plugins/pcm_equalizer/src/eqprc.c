@@ -0,0 +1,549 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   eqprc.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM equalizer processor
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include <tizkernel.h>
+
+#include "eq.h"
+#include "eqprc.h"
+#include "eqprc_decls.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.pcm_equalizer.prc"
+#endif
+
+static OMX_ERRORTYPE
+release_buffers (eq_prc_t * ap_prc)
+{
+  assert (ap_prc);
+
+  if (ap_prc->p_inhdr_)
+    {
+      tiz_check_omx (tiz_krn_release_buffer (
+        tiz_get_krn (handleOf (ap_prc)),
+        ARATELIA_PCM_EQUALIZER_INPUT_PORT_INDEX, ap_prc->p_inhdr_));
+      ap_prc->p_inhdr_ = NULL;
+    }
+
+  if (ap_prc->p_outhdr_)
+    {
+      tiz_check_omx (tiz_krn_release_buffer (
+        tiz_get_krn (handleOf (ap_prc)),
+        ARATELIA_PCM_EQUALIZER_OUTPUT_PORT_INDEX, ap_prc->p_outhdr_));
+      ap_prc->p_outhdr_ = NULL;
+    }
+
+  /* A partial frame can't be completed by the buffers of another stream */
+  ap_prc->partial_len_ = 0;
+
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+retrieve_pcm_settings (eq_prc_t * ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (ap_prc);
+
+  TIZ_INIT_OMX_PORT_STRUCT (ap_prc->pcmmode_,
+                            ARATELIA_PCM_EQUALIZER_INPUT_PORT_INDEX);
+  if (OMX_ErrorNone
+      != (rc = tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)),
+                                     handleOf (ap_prc), OMX_IndexParamAudioPcm,
+                                     &ap_prc->pcmmode_)))
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[%s] : Error retrieving pcm params from port",
+                 tiz_err_to_str (rc));
+      return rc;
+    }
+
+  /* The cascade works on interleaved, native endian, signed 16-bit pcm.
+   * Anything else is passed through untouched. */
+  ap_prc->supported_format_
+    = (16 == ap_prc->pcmmode_.nBitPerSample
+       && OMX_NumericalDataSigned == ap_prc->pcmmode_.eNumData
+       && OMX_EndianLittle == ap_prc->pcmmode_.eEndian
+       && OMX_TRUE == ap_prc->pcmmode_.bInterleaved
+       && ap_prc->pcmmode_.nChannels > 0
+       && ap_prc->pcmmode_.nChannels <= EQ_MAX_CHANNELS);
+
+  TIZ_TRACE (handleOf (ap_prc),
+             "nChannels = [%d] nBitPerSample = [%d] nSamplingRate = [%d] "
+             "supported = [%s]",
+             ap_prc->pcmmode_.nChannels, ap_prc->pcmmode_.nBitPerSample,
+             ap_prc->pcmmode_.nSamplingRate,
+             ap_prc->supported_format_ ? "YES" : "NO");
+
+  if (ap_prc->supported_format_)
+    {
+      eq_cascade_init (&(ap_prc->cascade_), ap_prc->pcmmode_.nChannels);
+    }
+  ap_prc->coeffs_dirty_ = true;
+  ap_prc->partial_len_ = 0;
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+update_coeffs (eq_prc_t * ap_prc)
+{
+  eq_coeffs_t coeffs[ARATELIA_PCM_EQUALIZER_NUM_BANDS];
+  float gains[ARATELIA_PCM_EQUALIZER_NUM_BANDS];
+  OMX_AUDIO_CONFIG_EQUALIZERTYPE eq;
+  OMX_U32 band = 0;
+
+  assert (ap_prc);
+
+  for (band = 0; band < ARATELIA_PCM_EQUALIZER_NUM_BANDS; ++band)
+    {
+      TIZ_INIT_OMX_PORT_STRUCT (eq, ARATELIA_PCM_EQUALIZER_INPUT_PORT_INDEX);
+      eq.sBandIndex.nValue = band;
+      tiz_check_omx (tiz_api_GetConfig (
+        tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+        OMX_IndexConfigAudioEqualizer, &eq));
+      gains[band] = eq.bEnable ? eq.sBandLevel.nValue / 100.0f : 0.0f;
+      eq_peaking_coeffs (&coeffs[band], ap_prc->pcmmode_.nSamplingRate,
+                         eq.sCenterFreq.nValue, ARATELIA_PCM_EQUALIZER_BAND_Q,
+                         gains[band]);
+    }
+
+  eq_cascade_set_bands (&(ap_prc->cascade_), coeffs, gains,
+                        ARATELIA_PCM_EQUALIZER_NUM_BANDS);
+  ap_prc->coeffs_dirty_ = false;
+
+  TIZ_TRACE (handleOf (ap_prc), "active bands [%u]",
+             ap_prc->cascade_.nactive);
+
+  return OMX_ErrorNone;
+}
+
+static bool
+claim_input (eq_prc_t * ap_prc)
+{
+  bool rc = false;
+  assert (ap_prc);
+
+  if (OMX_ErrorNone
+      == tiz_krn_claim_buffer (tiz_get_krn (handleOf (ap_prc)),
+                               ARATELIA_PCM_EQUALIZER_INPUT_PORT_INDEX, 0,
+                               &ap_prc->p_inhdr_))
+    {
+      if (ap_prc->p_inhdr_)
+        {
+          TIZ_TRACE (handleOf (ap_prc), "Claimed INPUT HEADER [%p]...",
+                     ap_prc->p_inhdr_);
+          rc = true;
+        }
+    }
+
+  return rc;
+}
+
+static bool
+claim_output (eq_prc_t * ap_prc)
+{
+  bool rc = false;
+  assert (ap_prc);
+
+  if (OMX_ErrorNone
+      == tiz_krn_claim_buffer (tiz_get_krn (handleOf (ap_prc)),
+                               ARATELIA_PCM_EQUALIZER_OUTPUT_PORT_INDEX, 0,
+                               &ap_prc->p_outhdr_))
+    {
+      if (ap_prc->p_outhdr_)
+        {
+          TIZ_TRACE (handleOf (ap_prc), "Claimed OUTPUT HEADER [%p]...",
+                     ap_prc->p_outhdr_);
+          ap_prc->p_outhdr_->nFilledLen = 0;
+          ap_prc->p_outhdr_->nOffset = 0;
+          ap_prc->p_outhdr_->nFlags = 0;
+          rc = true;
+        }
+    }
+
+  return rc;
+}
+
+static void
+process_frames (eq_prc_t * ap_prc, const OMX_U8 * ap_src, OMX_U8 * ap_dst,
+                const OMX_U32 a_nbytes, const OMX_U32 a_frame_size)
+{
+  assert (ap_prc);
+  if (ap_prc->supported_format_)
+    {
+      eq_cascade_process_s16 (&(ap_prc->cascade_), (const int16_t *) ap_src,
+                              (int16_t *) ap_dst, a_nbytes / a_frame_size);
+    }
+  else
+    {
+      memcpy (ap_dst, ap_src, a_nbytes);
+    }
+}
+
+static inline void
+consume_input (OMX_BUFFERHEADERTYPE * ap_in, const OMX_U32 a_nbytes)
+{
+  assert (ap_in);
+  ap_in->nOffset += a_nbytes;
+  ap_in->nFilledLen -= a_nbytes;
+}
+
+static OMX_ERRORTYPE
+equalize_buffer (eq_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_in = NULL;
+  OMX_BUFFERHEADERTYPE * p_out = NULL;
+  OMX_U8 * p_dst = NULL;
+  OMX_U32 frame_size = 0;
+  OMX_U32 avail = 0;
+  OMX_U32 nbytes = 0;
+
+  assert (ap_prc);
+  assert (ap_prc->p_inhdr_);
+  assert (ap_prc->p_outhdr_);
+
+  p_in = ap_prc->p_inhdr_;
+  p_out = ap_prc->p_outhdr_;
+
+  /* New coefficients are only picked up between buffers; the filters' delay
+   * lines are kept, so the change is applied without a discontinuity. */
+  if (ap_prc->coeffs_dirty_ && ap_prc->supported_format_)
+    {
+      tiz_check_omx (update_coeffs (ap_prc));
+    }
+
+  frame_size = (ap_prc->pcmmode_.nBitPerSample / 8) * ap_prc->pcmmode_.nChannels;
+  if (0 == frame_size || frame_size > EQPRC_MAX_FRAME_SIZE)
+    {
+      frame_size = 1;
+    }
+
+  p_dst = p_out->pBuffer + p_out->nOffset + p_out->nFilledLen;
+  avail = p_out->nAllocLen - p_out->nOffset - p_out->nFilledLen;
+
+  /* Complete the frame left over from the previous buffer first, so that the
+   * channels stay aligned */
+  if (ap_prc->partial_len_ > 0 && avail >= frame_size)
+    {
+      nbytes = MIN (frame_size - ap_prc->partial_len_, p_in->nFilledLen);
+      memcpy (ap_prc->partial_ + ap_prc->partial_len_,
+              p_in->pBuffer + p_in->nOffset, nbytes);
+      ap_prc->partial_len_ += nbytes;
+      consume_input (p_in, nbytes);
+      if (ap_prc->partial_len_ == frame_size)
+        {
+          process_frames (ap_prc, ap_prc->partial_, p_dst, frame_size,
+                          frame_size);
+          p_dst += frame_size;
+          avail -= frame_size;
+          p_out->nFilledLen += frame_size;
+          ap_prc->partial_len_ = 0;
+        }
+    }
+
+  if (0 == ap_prc->partial_len_)
+    {
+      nbytes = MIN (p_in->nFilledLen, avail);
+      nbytes -= nbytes % frame_size;
+      if (nbytes > 0)
+        {
+          process_frames (ap_prc, p_in->pBuffer + p_in->nOffset, p_dst, nbytes,
+                          frame_size);
+          consume_input (p_in, nbytes);
+          p_out->nFilledLen += nbytes;
+        }
+
+      if (p_in->nFilledLen > 0 && p_in->nFilledLen < frame_size)
+        {
+          /* A trailing partial frame is kept until the next buffer */
+          memcpy (ap_prc->partial_, p_in->pBuffer + p_in->nOffset,
+                  p_in->nFilledLen);
+          ap_prc->partial_len_ = p_in->nFilledLen;
+          consume_input (p_in, p_in->nFilledLen);
+        }
+    }
+
+  if (p_out->nFilledLen > 0)
+    {
+      p_out->nTimeStamp = p_in->nTimeStamp;
+    }
+
+  if (0 == p_in->nFilledLen && (p_in->nFlags & OMX_BUFFERFLAG_EOS))
+    {
+      TIZ_TRACE (handleOf (ap_prc), "Propagating EOS...");
+      p_out->nFlags |= OMX_BUFFERFLAG_EOS;
+      if (ap_prc->partial_len_ > 0)
+        {
+          TIZ_WARN (handleOf (ap_prc),
+                    "Dropping an incomplete frame of [%d] bytes at EOS",
+                    ap_prc->partial_len_);
+          ap_prc->partial_len_ = 0;
+        }
+    }
+
+  if (p_out->nFilledLen > 0 || (p_out->nFlags & OMX_BUFFERFLAG_EOS))
+    {
+      tiz_check_omx (tiz_krn_release_buffer (
+        tiz_get_krn (handleOf (ap_prc)),
+        ARATELIA_PCM_EQUALIZER_OUTPUT_PORT_INDEX, p_out));
+      ap_prc->p_outhdr_ = NULL;
+    }
+
+  if (0 == p_in->nFilledLen)
+    {
+      p_in->nOffset = 0;
+      p_in->nFlags = 0;
+      tiz_check_omx (tiz_krn_release_buffer (
+        tiz_get_krn (handleOf (ap_prc)),
+        ARATELIA_PCM_EQUALIZER_INPUT_PORT_INDEX, p_in));
+      ap_prc->p_inhdr_ = NULL;
+    }
+
+  return OMX_ErrorNone;
+}
+
+/*
+ * eqprc
+ */
+
+static void *
+eq_prc_ctor (void * ap_obj, va_list * app)
+{
+  eq_prc_t * p_prc = super_ctor (typeOf (ap_obj, "eqprc"), ap_obj, app);
+  assert (p_prc);
+  TIZ_INIT_OMX_PORT_STRUCT (p_prc->pcmmode_,
+                            ARATELIA_PCM_EQUALIZER_INPUT_PORT_INDEX);
+  memset (&(p_prc->cascade_), 0, sizeof (p_prc->cascade_));
+  p_prc->supported_format_ = false;
+  p_prc->coeffs_dirty_ = true;
+  p_prc->p_inhdr_ = NULL;
+  p_prc->p_outhdr_ = NULL;
+  p_prc->partial_len_ = 0;
+  return p_prc;
+}
+
+static void *
+eq_prc_dtor (void * ap_obj)
+{
+  return super_dtor (typeOf (ap_obj, "eqprc"), ap_obj);
+}
+
+/*
+ * from tiz_srv class
+ */
+
+static OMX_ERRORTYPE
+eq_prc_allocate_resources (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  /* Nothing to allocate; the filter state lives in the object itself */
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+eq_prc_deallocate_resources (void * ap_obj)
+{
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+eq_prc_prepare_to_transfer (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  return retrieve_pcm_settings (ap_obj);
+}
+
+static OMX_ERRORTYPE
+eq_prc_transfer_and_process (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+eq_prc_stop_and_return (void * ap_obj)
+{
+  return release_buffers (ap_obj);
+}
+
+/*
+ * from tiz_prc class
+ */
+
+static OMX_ERRORTYPE
+eq_prc_buffers_ready (const void * ap_obj)
+{
+  eq_prc_t * p_prc = (eq_prc_t *) ap_obj;
+  assert (p_prc);
+
+  while (1)
+    {
+      if (!p_prc->p_inhdr_ && !claim_input (p_prc))
+        {
+          break;
+        }
+
+      if (!p_prc->p_outhdr_ && !claim_output (p_prc))
+        {
+          break;
+        }
+
+      tiz_check_omx (equalize_buffer (p_prc));
+    }
+
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+eq_prc_port_flush (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  eq_prc_t * p_prc = (eq_prc_t *) ap_obj;
+  assert (p_prc);
+  /* Start the next stream from silence */
+  eq_cascade_reset (&(p_prc->cascade_));
+  /* Release all buffers, regardless of the port this is received on */
+  return release_buffers (p_prc);
+}
+
+static OMX_ERRORTYPE
+eq_prc_port_disable (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  /* Release all buffers, regardless of the port this is received on */
+  return release_buffers ((eq_prc_t *) ap_obj);
+}
+
+static OMX_ERRORTYPE
+eq_prc_port_enable (const void * ap_obj, OMX_U32 a_pid)
+{
+  eq_prc_t * p_prc = (eq_prc_t *) ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (p_prc);
+  if (ARATELIA_PCM_EQUALIZER_INPUT_PORT_INDEX == a_pid
+      || OMX_ALL == a_pid)
+    {
+      /* The pcm settings may have changed while the port was disabled */
+      rc = retrieve_pcm_settings (p_prc);
+    }
+  return rc;
+}
+
+static OMX_ERRORTYPE
+eq_prc_config_change (void * ap_obj, OMX_U32 a_pid,
+                      OMX_INDEXTYPE a_config_idx)
+{
+  eq_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+
+  if (ARATELIA_PCM_EQUALIZER_INPUT_PORT_INDEX == a_pid
+      && OMX_IndexConfigAudioEqualizer == a_config_idx)
+    {
+      TIZ_TRACE (handleOf (p_prc), "[OMX_IndexConfigAudioEqualizer]");
+      p_prc->coeffs_dirty_ = true;
+    }
+  return OMX_ErrorNone;
+}
+
+/*
+ * eq_prc_class
+ */
+
+static void *
+eq_prc_class_ctor (void * ap_obj, va_list * app)
+{
+  /* NOTE: Class methods might be added in the future. None for now. */
+  return super_ctor (typeOf (ap_obj, "eqprc_class"), ap_obj, app);
+}
+
+/*
+ * initialization
+ */
+
+void *
+eq_prc_class_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizprc = tiz_get_type (ap_hdl, "tizprc");
+  void * eqprc_class = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (classOf (tizprc), "eqprc_class", classOf (tizprc),
+     sizeof (eq_prc_class_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, eq_prc_class_ctor,
+     /* TIZ_CLASS_COMMENT: stop value */
+     0);
+  return eqprc_class;
+}
+
+void *
+eq_prc_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizprc = tiz_get_type (ap_hdl, "tizprc");
+  void * eqprc_class = tiz_get_type (ap_hdl, "eqprc_class");
+  TIZ_LOG_CLASS (eqprc_class);
+  void * eqprc = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (eqprc_class, "eqprc", tizprc, sizeof (eq_prc_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, eq_prc_ctor,
+     /* TIZ_CLASS_COMMENT: class destructor */
+     dtor, eq_prc_dtor,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_allocate_resources, eq_prc_allocate_resources,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_deallocate_resources, eq_prc_deallocate_resources,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_prepare_to_transfer, eq_prc_prepare_to_transfer,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_transfer_and_process, eq_prc_transfer_and_process,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_stop_and_return, eq_prc_stop_and_return,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_buffers_ready, eq_prc_buffers_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_flush, eq_prc_port_flush,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_disable, eq_prc_port_disable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_enable, eq_prc_port_enable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_config_change, eq_prc_config_change,
+     /* TIZ_CLASS_COMMENT: stop value */
+     0);
+
+  return eqprc;
+}
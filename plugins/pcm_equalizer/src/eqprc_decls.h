@@ -0,0 +1,77 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   eqprc_decls.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM equalizer processor class decls
+ *
+ *
+ */
+
+#ifndef EQPRC_DECLS_H
+#define EQPRC_DECLS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+#include <OMX_Core.h>
+#include <OMX_Audio.h>
+
+#include <tizprc_decls.h>
+
+#include "eqbiquad.h"
+#include "eqprc.h"
+
+/* Enough for one frame of 32-bit samples on every channel */
+#define EQPRC_MAX_FRAME_SIZE (4 * OMX_AUDIO_MAXCHANNELS)
+
+typedef struct eq_prc eq_prc_t;
+struct eq_prc
+{
+  /* Object */
+  const tiz_prc_t _;
+  OMX_AUDIO_PARAM_PCMMODETYPE pcmmode_;
+  eq_cascade_t cascade_;
+  bool supported_format_;
+  bool coeffs_dirty_;
+  OMX_BUFFERHEADERTYPE * p_inhdr_;
+  OMX_BUFFERHEADERTYPE * p_outhdr_;
+  /* The incomplete frame at the end of the last input buffer */
+  OMX_U8 partial_[EQPRC_MAX_FRAME_SIZE];
+  OMX_U32 partial_len_;
+};
+
+typedef struct eq_prc_class eq_prc_class_t;
+struct eq_prc_class
+{
+  /* Class */
+  const tiz_prc_class_t _;
+  /* NOTE: Class methods might be added in the future */
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EQPRC_DECLS_H */
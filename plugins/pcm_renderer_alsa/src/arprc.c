@@ -36,6 +36,8 @@
 #include <string.h>
 #include <byteswap.h>
 
+#include <OMX_TizoniaExt.h>
+
 #include <tizplatform.h>
 
 #include <tizutils.h>
@@ -198,14 +200,14 @@ check_alsa_support_pcm_format (ar_prc_t * ap_prc,
               *ap_snd_pcm_format = SND_PCM_FORMAT_FLOAT_LE;
             }
             break;
-          case SND_PCM_FORMAT_S24:
+          case SND_PCM_FORMAT_S24_3LE:
             {
-              *ap_snd_pcm_format = SND_PCM_FORMAT_S24_BE;
+              *ap_snd_pcm_format = SND_PCM_FORMAT_S24_3BE;
             }
             break;
-          case SND_PCM_FORMAT_S24_BE:
+          case SND_PCM_FORMAT_S24_3BE:
             {
-              *ap_snd_pcm_format = SND_PCM_FORMAT_S24;
+              *ap_snd_pcm_format = SND_PCM_FORMAT_S24_3LE;
             }
             break;
           case SND_PCM_FORMAT_S16:
@@ -272,11 +274,13 @@ retrieve_alsa_pcm_format_and_num_channels (ar_prc_t * ap_prc,
     tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
                           OMX_IndexParamAudioPcm, &ap_prc->pcmmode_));
 
+  /* NOTE: 24-bit samples are packed in 3 bytes, as produced by the flac and
+     pcm decoders */
   if (ap_prc->pcmmode_.nBitPerSample == 24)
     {
       *ap_snd_pcm_format = ap_prc->pcmmode_.eEndian == OMX_EndianLittle
-                             ? SND_PCM_FORMAT_S24
-                             : SND_PCM_FORMAT_S24_BE;
+                             ? SND_PCM_FORMAT_S24_3LE
+                             : SND_PCM_FORMAT_S24_3BE;
     }
   /* NOTE: this is to allow float pcm streams coming from the the vorbis or
      opusfile decoders */
@@ -467,33 +471,82 @@ float_to_sint (const float a_sample)
   return (int) f;
 }
 
+/* Applies the loudness normalization gain (ReplayGain/R128). The user's
+ * volume is not part of it; that is set on ALSA's mixer (see set_volume). */
 static void
 adjust_gain (const ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr,
              const snd_pcm_uframes_t a_samples_per_channel)
 {
+  float gain = 0.f;
+  snd_pcm_uframes_t nsamples = 0;
+  snd_pcm_uframes_t i = 0;
+
   assert (ap_prc);
   assert (ap_hdr);
 
-  if (ARATELIA_AUDIO_RENDERER_DEFAULT_GAIN_VALUE != ap_prc->gain_)
+  if (ARATELIA_AUDIO_RENDERER_DEFAULT_GAIN_VALUE == ap_prc->gain_)
     {
-      int i;
-      int gainadj = (int) (ap_prc->gain_ * 256.);
-      float gain = pow (10., gainadj / 5120.);
-      /*       gain = 3.1f; */
-      /*       fprintf (stderr, "%f samples %ld\n", gain, a_samples_per_channel); */
-      OMX_S16 * pcm = (OMX_S16 *) (ap_hdr->pBuffer + ap_hdr->nOffset);
-      for (i = 0; i < a_samples_per_channel; i++)
+      return;
+    }
+
+  gain = powf (10.f, ap_prc->gain_ / 20.f);
+  nsamples = a_samples_per_channel * ap_prc->pcmmode_.nChannels;
+
+  switch (ap_prc->pcmmode_.nBitPerSample)
+    {
+      case 16:
         {
-          float f = sint_to_float (*pcm);
-          f *= gain;
-          int v = float_to_sint (f);
-          *(pcm++) = (v > 32767) ? 32767 : ((v < -32768) ? -32768 : v);
-          f = sint_to_float (*pcm);
-          f *= gain;
-          v = float_to_sint (f);
-          *(pcm++) = (v > 32767) ? 32767 : ((v < -32768) ? -32768 : v);
+          OMX_S16 * pcm = (OMX_S16 *) (ap_hdr->pBuffer + ap_hdr->nOffset);
+          for (i = 0; i < nsamples; i++)
+            {
+              const float f = sint_to_float (*pcm) * gain;
+              *(pcm++) = float_to_sint (f);
+            }
         }
-    }
+        break;
+      case 24:
+        {
+          /* Packed in 3 bytes, in the port's byte order */
+          const int lsb = OMX_EndianLittle == ap_prc->pcmmode_.eEndian ? 0 : 2;
+          const int msb = 2 - lsb;
+          OMX_U8 * p = ap_hdr->pBuffer + ap_hdr->nOffset;
+          for (i = 0; i < nsamples; i++, p += 3)
+            {
+              OMX_S32 s = p[lsb] | (p[1] << 8) | (p[msb] << 16);
+              float f = 0.f;
+              if (s & 0x800000)
+                {
+                  s -= 0x1000000;
+                }
+              f = s * gain;
+              if (f > 8388607.f)
+                {
+                  f = 8388607.f;
+                }
+              else if (f < -8388608.f)
+                {
+                  f = -8388608.f;
+                }
+              s = (OMX_S32) f;
+              p[lsb] = s & 0xff;
+              p[1] = (s >> 8) & 0xff;
+              p[msb] = (s >> 16) & 0xff;
+            }
+        }
+        break;
+      case 32:
+        {
+          /* Float; anything beyond full scale is clipped by ALSA */
+          float * pcm = (float *) (ap_hdr->pBuffer + ap_hdr->nOffset);
+          for (i = 0; i < nsamples; i++)
+            {
+              pcm[i] *= gain;
+            }
+        }
+        break;
+      default:
+        break;
+    };
 }
 
 static void
@@ -1405,6 +1458,22 @@ ar_prc_config_change (void * ap_prc, OMX_U32 a_pid, OMX_INDEXTYPE a_config_idx)
                      (mute.bMute == OMX_FALSE ? "FALSE" : "TRUE"));
           toggle_mute (p_prc, mute.bMute == OMX_TRUE ? true : false);
         }
+      else if (OMX_TizoniaIndexConfigAudioReplayGain == a_config_idx)
+        {
+          OMX_TIZONIA_AUDIO_CONFIG_REPLAYGAINTYPE replaygain;
+          TIZ_INIT_OMX_PORT_STRUCT (replaygain,
+                                    ARATELIA_AUDIO_RENDERER_PORT_INDEX);
+          tiz_check_omx (tiz_api_GetConfig (
+            tiz_get_krn (handleOf (p_prc)), handleOf (p_prc),
+            OMX_TizoniaIndexConfigAudioReplayGain, &replaygain));
+          p_prc->gain_ = tiz_util_replaygain_to_db (
+            &replaygain, ARATELIA_AUDIO_RENDERER_MIN_GAIN_VALUE,
+            ARATELIA_AUDIO_RENDERER_MAX_GAIN_VALUE);
+          TIZ_TRACE (handleOf (p_prc),
+                     "[OMX_TizoniaIndexConfigAudioReplayGain] : mode [%d] "
+                     "gain [%.2f dB]",
+                     replaygain.eMode, p_prc->gain_);
+        }
     }
   return rc;
 }
@@ -33,6 +33,8 @@
 #include <stdlib.h>
 #include <assert.h>
 
+#include <OMX_TizoniaExt.h>
+
 #include <tizplatform.h>
 
 #include <tizkernel.h>
@@ -824,9 +826,13 @@ set_pa_sink_volume (pulsear_prc_t * ap_prc, const long a_volume)
                    pa_stream_get_state (ap_prc->p_pa_stream_)),
                  ap_prc->pa_vol_.channels);
 
+      /* The loudness normalization gain is folded into the stream's
+       * software volume, so pulseaudio applies both in the same pass */
       (void) pa_cvolume_set (
         &cvolume, ap_prc->pcmmode_.nChannels,
-        (pa_volume_t) a_volume * PA_VOLUME_NORM / 100 + 0.5);
+        pa_sw_volume_multiply (
+          (pa_volume_t) a_volume * PA_VOLUME_NORM / 100 + 0.5,
+          pa_sw_volume_from_dB (ap_prc->gain_)));
       pa_threaded_mainloop_lock (ap_prc->p_pa_loop_);
       p_op = pa_context_set_sink_input_volume (
         ap_prc->p_pa_context_, pa_stream_get_index (ap_prc->p_pa_stream_),
@@ -1253,6 +1259,24 @@ pulsear_prc_config_change (void * ap_obj, OMX_U32 a_pid,
                      (mute.bMute == OMX_FALSE ? "FALSE" : "TRUE"));
           toggle_mute (p_prc, mute.bMute == OMX_TRUE ? true : false);
         }
+      else if (OMX_TizoniaIndexConfigAudioReplayGain == a_config_idx)
+        {
+          OMX_TIZONIA_AUDIO_CONFIG_REPLAYGAINTYPE replaygain;
+          TIZ_INIT_OMX_PORT_STRUCT (replaygain,
+                                    ARATELIA_PCM_RENDERER_PORT_INDEX);
+          tiz_check_omx (tiz_api_GetConfig (
+            tiz_get_krn (handleOf (p_prc)), handleOf (p_prc),
+            OMX_TizoniaIndexConfigAudioReplayGain, &replaygain));
+          p_prc->gain_ = tiz_util_replaygain_to_db (
+            &replaygain, ARATELIA_PCM_RENDERER_MIN_GAIN_VALUE,
+            ARATELIA_PCM_RENDERER_MAX_GAIN_VALUE);
+          TIZ_DEBUG (handleOf (p_prc),
+                     "[OMX_TizoniaIndexConfigAudioReplayGain] : mode [%d] "
+                     "gain [%.2f dB]",
+                     replaygain.eMode, p_prc->gain_);
+          /* Re-apply the current volume, now with the new gain */
+          set_volume (p_prc, p_prc->volume_);
+        }
     }
   return rc;
 }
@@ -75,6 +75,9 @@ extern "C" {
 #define ARATELIA_WEBM_DEMUXER_DEFAULT_BIT_RATE_KBITS 128
 #define ARATELIA_WEBM_DEMUXER_DEFAULT_CACHE_SECONDS 10
 
+/* Filter role - additional configs */
+#define ARATELIA_WEBM_DEMUXER_DEFAULT_SEEK_WINDOW_KB 256
+
 #ifdef __cplusplus
 }
 #endif
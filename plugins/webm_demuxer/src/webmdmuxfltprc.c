@@ -36,6 +36,7 @@
 #include <alloca.h>
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <OMX_TizoniaExt.h>
@@ -161,24 +162,33 @@ static int
 ne_io_seek (int64_t offset, int whence, void * userdata)
 {
   webmdmuxflt_prc_t * p_prc = userdata;
-  int tb_whence = TIZ_BUFFER_SEEK_SET;
+  tiz_buffer_t * p_store = NULL;
+  int64_t position = 0;
+  int64_t end = 0;
   assert (p_prc);
   TIZ_DEBUG (handleOf (userdata), "offset %lld - whence %d", offset, whence);
+
+  /* The store only holds a window of the stream; its first byte is at
+     webm_store_base_ */
+  p_store = p_prc->p_webm_store_;
+  end = p_prc->webm_store_base_ + tiz_buffer_offset (p_store)
+        + tiz_buffer_available (p_store);
   switch (whence)
     {
       case NESTEGG_SEEK_SET:
         {
-          tb_whence = TIZ_BUFFER_SEEK_SET;
+          position = offset;
         }
         break;
       case NESTEGG_SEEK_CUR:
         {
-          tb_whence = TIZ_BUFFER_SEEK_CUR;
+          position
+            = p_prc->webm_store_base_ + tiz_buffer_offset (p_store) + offset;
         }
         break;
       case NESTEGG_SEEK_END:
         {
-          tb_whence = TIZ_BUFFER_SEEK_END;
+          position = end + offset;
         }
         break;
       default:
@@ -187,7 +197,16 @@ ne_io_seek (int64_t offset, int whence, void * userdata)
         }
         break;
     };
-  return tiz_buffer_seek (p_prc->p_webm_store_, offset, tb_whence);
+
+  if (position < p_prc->webm_store_base_ || position > end)
+    {
+      TIZ_DEBUG (handleOf (userdata),
+                 "position %lld is outside the window [%lld, %lld]", position,
+                 p_prc->webm_store_base_, end);
+      return -1;
+    }
+  return tiz_buffer_seek (p_store, position - p_prc->webm_store_base_,
+                          TIZ_BUFFER_SEEK_SET);
 }
 
 /** User supplied tell callback.
@@ -201,7 +220,7 @@ ne_io_tell (void * userdata)
 {
   webmdmuxflt_prc_t * p_prc = userdata;
   assert (p_prc);
-  return tiz_buffer_offset (p_prc->p_webm_store_);
+  return p_prc->webm_store_base_ + tiz_buffer_offset (p_prc->p_webm_store_);
 }
 
 /** nestegg logging callback function. */
@@ -620,6 +639,27 @@ able_to_demux (webmdmuxflt_prc_t * ap_prc)
   return rc;
 }
 
+/* nestegg never goes back further than the position where the last call to
+   nestegg_read_packet started (see nestegg_read_reset), so once the headers
+   have been parsed, the data behind that position is only kept up to the
+   size of the window. */
+static void
+trim_input_store (webmdmuxflt_prc_t * ap_prc)
+{
+  int behind = 0;
+  assert (ap_prc);
+
+  behind = tiz_buffer_offset (ap_prc->p_webm_store_);
+  if (ap_prc->ne_inited_ && behind >= 2 * ap_prc->webm_window_bytes_)
+    {
+      ap_prc->webm_store_base_ += tiz_buffer_discard (
+        ap_prc->p_webm_store_, behind - ap_prc->webm_window_bytes_);
+      TIZ_TRACE (handleOf (ap_prc), "window start [%lld] store [%d]",
+                 ap_prc->webm_store_base_,
+                 tiz_buffer_available (ap_prc->p_webm_store_));
+    }
+}
+
 static OMX_ERRORTYPE
 read_packet (webmdmuxflt_prc_t * ap_prc)
 {
@@ -633,6 +673,11 @@ read_packet (webmdmuxflt_prc_t * ap_prc)
       nestegg_read_reset (ap_prc->p_ne_);
     }
 
+  if (!ap_prc->p_ne_pkt_)
+    {
+      trim_input_store (ap_prc);
+    }
+
   if (ap_prc->p_ne_pkt_
       || (ap_prc->ne_read_err_
           = nestegg_read_packet (ap_prc->p_ne_, &ap_prc->p_ne_pkt_))
@@ -679,6 +724,20 @@ demux_stream (webmdmuxflt_prc_t * ap_prc)
   return rc;
 }
 
+static int
+seek_window_bytes (void)
+{
+  int window_kb = ARATELIA_WEBM_DEMUXER_DEFAULT_SEEK_WINDOW_KB;
+  const char * p_value = tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION,
+    "OMX.Aratelia.container_demuxer.webm.seek_window_kb");
+  if (p_value && atoi (p_value) > 0)
+    {
+      window_kb = atoi (p_value);
+    }
+  return window_kb * 1024;
+}
+
 static OMX_ERRORTYPE
 alloc_input_store (webmdmuxflt_prc_t * ap_prc)
 {
@@ -694,6 +753,8 @@ alloc_input_store (webmdmuxflt_prc_t * ap_prc)
   assert (ap_prc->p_webm_store_ == NULL);
   tiz_check_omx (
     tiz_buffer_init (&(ap_prc->p_webm_store_), port_def.nBufferSize * 4));
+  ap_prc->webm_store_base_ = 0;
+  ap_prc->webm_window_bytes_ = seek_window_bytes ();
 
   /* Will need to seek on this buffer  */
   return tiz_buffer_seek_mode (ap_prc->p_webm_store_, TIZ_BUFFER_SEEKABLE);
@@ -792,6 +853,7 @@ reset_stream_parameters (webmdmuxflt_prc_t * ap_prc)
   reset_nestegg_members (ap_prc);
 
   tiz_buffer_clear (ap_prc->p_webm_store_);
+  ap_prc->webm_store_base_ = 0;
   tiz_buffer_clear (ap_prc->p_aud_store_);
   tiz_buffer_clear (ap_prc->p_vid_store_);
   tiz_vector_clear (ap_prc->p_aud_header_lengths_);
@@ -1128,6 +1190,8 @@ webmdmuxflt_prc_ctor (void * ap_prc, va_list * app)
     = super_ctor (typeOf (ap_prc, "webmdmuxfltprc"), ap_prc, app);
   assert (p_prc);
   p_prc->p_webm_store_ = NULL;
+  p_prc->webm_store_base_ = 0;
+  p_prc->webm_window_bytes_ = ARATELIA_WEBM_DEMUXER_DEFAULT_SEEK_WINDOW_KB * 1024;
   p_prc->p_aud_store_ = NULL;
   p_prc->p_vid_store_ = NULL;
   p_prc->p_aud_header_lengths_ = NULL;
@@ -33,6 +33,7 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include <OMX_Core.h>
 
@@ -49,6 +50,8 @@ struct webmdmuxflt_prc
   /* Object */
   const tiz_filter_prc_t _;
   tiz_buffer_t * p_webm_store_;
+  int64_t webm_store_base_;
+  int webm_window_bytes_;
   tiz_buffer_t * p_aud_store_;
   tiz_buffer_t * p_vid_store_;
   tiz_vector_t * p_aud_header_lengths_;